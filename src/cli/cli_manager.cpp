@@ -1,12 +1,22 @@
 #include "cli_manager.h"
 
+#include <ctype.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define DEBUG_TAG "CLI"
 #include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/DeferredLog.h"
+#include "../debug/include/debug/MemBudget.h"
+#include "../debug/include/debug/Pool.h"
+#include "../debug/include/debug/Profile.h"
+#include "../debug/include/debug/Telemetry.h"
+#include "../debug/include/debug/Trace.h"
+#include "attr_ingest.h"
 #include "bluetooth_manager.h"
+#include "console_mux.h"
 #include "esp_console.h"
 #include "esp_err.h"
 #include "esp_log.h"
@@ -15,50 +25,45 @@
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "h2_log.h"
+#include "h2_ota.h"
+#include "history.h"
 #include "linenoise/linenoise.h"
 #include "lwip/inet.h"
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
+#include "ota_client.h"
 #include "ping/ping_sock.h"
+#include "radio_scheduler.h"
 #include "sdkconfig.h"
 #include "uart_link.h"
 #include "wifi_manager.h"
+#include "zb_command.h"
+#include "zb_devices.h"
+#include "zigbee_manager.h"
 
-static const char* TAG = DEBUG_TAG;
+#ifndef CONFIG_APP_CLI_ARENA_KB
+#define CONFIG_APP_CLI_ARENA_KB 32
+#endif
 
-/* Auto-pause logging logic */
-static bool g_logging_paused = false;
-static esp_timer_handle_t g_resume_timer;
-static vprintf_like_t g_default_vprintf;
+static const char* TAG = DEBUG_TAG;
 
-static void resume_logging_timer_cb(void* arg) {
-  g_logging_paused = false;
-}
+/* Scratch for command output, released when the command returns. Console task only. */
+static debug::pool::ArenaBuffer<CONFIG_APP_CLI_ARENA_KB * 1024> s_response_arena("cli_response");
 
+/* Hold log output while the user is editing a line (see console_mux.h) */
 static char* custom_hints_cb(const char* buf, int* color, int* bold) {
-  // User is typing, pause logging
-  g_logging_paused = true;
-  // Reset timer (5 seconds)
-  esp_timer_stop(g_resume_timer);
-  esp_timer_start_once(g_resume_timer, 5000000);
+  console_mux_note_typing(buf);
   return NULL;
 }
 
-static int custom_vprintf(const char* fmt, va_list args) {
-  if (g_logging_paused) {
-    return 0;
-  }
-  if (g_default_vprintf) {
-    return g_default_vprintf(fmt, args);
-  }
-  return vprintf(fmt, args);
-}
-
 /* Command Handlers */
 
 static int restart_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   ESP_LOGI(TAG, "Restarting...");
+  history_flush();  // keep the samples still in RAM
+  console_mux_flush();
   esp_restart();
   return 0;
 }
@@ -69,28 +74,520 @@ static int free_mem_console(int argc, char** argv) {
   return 0;
 }
 
+static void print_rate(uint32_t count, uint32_t window_ms) {
+  // count per second with two decimals
+  const uint64_t centi = window_ms ? (uint64_t)count * 100000 / window_ms : 0;
+  printf("%6" PRIu32 ".%02" PRIu32, (uint32_t)(centi / 100), (uint32_t)(centi % 100));
+}
+
+static void print_link_histogram(const char* name, const uart_link_histogram_t* h) {
+  if (h->count == 0) {
+    printf("  %-20s no samples\n", name);
+    return;
+  }
+  printf("  %-20s n=%-7" PRIu32 " min=%-7" PRIu32 " p50=%-7" PRIu32 " p90=%-7" PRIu32 " p99=%-7" PRIu32
+         " max=%-7" PRIu32 " mean=%" PRIu32 "\n",
+         name, h->count, h->min, h->p50, h->p90, h->p99, h->max, h->mean);
+}
+
 static int zb_info_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   uart_link_print_status();
+  if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+    uart_link_reset_metrics();
+    printf("Link histograms cleared\n");
+    return 0;
+  }
+
+  uart_link_metrics_t metrics;
+  uart_link_get_metrics(&metrics);
+  printf("%-8s %9s %9s %9s %9s %9s\n", "window", "rx fr/s", "rx B/s", "tx fr/s", "tx B/s", "crc err");
+  for (int i = 0; i < UART_LINK_METRIC_WINDOWS; ++i) {
+    const uart_link_window_t* w = &metrics.windows[i];
+    if (w->window_ms == 0) {
+      continue;
+    }
+    printf("%5" PRIu32 " s ", (w->window_ms + 500) / 1000);
+    print_rate(w->frames_rx, w->window_ms);
+    printf("   ");
+    print_rate(w->bytes_rx, w->window_ms);
+    printf("   ");
+    print_rate(w->frames_tx, w->window_ms);
+    printf("   ");
+    print_rate(w->bytes_tx, w->window_ms);
+    // CRC errors as a share of everything that looked like a frame
+    const uint32_t attempts = w->frames_rx + w->crc_errors;
+    const uint32_t permille = attempts ? (uint32_t)((uint64_t)w->crc_errors * 1000 / attempts) : 0;
+    printf("   %3" PRIu32 ".%" PRIu32 "%%", permille / 10, permille % 10);
+    if (w->dropped_frames) {
+      printf("  (%" PRIu32 " dropped)", w->dropped_frames);
+    }
+    printf("\n");
+  }
+  print_link_histogram("frame bytes", &metrics.frame_bytes);
+  print_link_histogram("rx inter-arrival us", &metrics.rx_interarrival_us);
+  print_link_histogram("tx latency us", &metrics.tx_latency_us);
+  return 0;
+}
+
+static int zb_codec_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || strcmp(argv[1], "status") == 0) {
+    uart_link_stats_t stats;
+    uart_link_get_stats(&stats);
+    printf("Compression: %s\n", stats.compression ? "negotiated" : "off (peer or config)");
+    printf("  tx: %" PRIu32 " frames, %" PRIu32 " -> %" PRIu32 " bytes\n", stats.compressed_frames_tx,
+           stats.compressed_raw_bytes_tx, stats.compressed_bytes_tx);
+    printf("  rx: %" PRIu32 " frames, %" PRIu32 " -> %" PRIu32 " bytes, %" PRIu32 " decode errors\n",
+           stats.compressed_frames_rx, stats.compressed_bytes_rx, stats.compressed_raw_bytes_rx,
+           stats.decompress_errors);
+    return 0;
+  }
+  if (strcmp(argv[1], "bench") == 0) {
+    uint32_t iterations = 200;
+    if (argc == 3) {
+      iterations = (uint32_t)atoi(argv[2]);
+    }
+    uart_link_codec_bench_t result;
+    esp_err_t err = uart_link_codec_benchmark(iterations, &result);
+    if (err != ESP_OK) {
+      printf("Benchmark failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    const uint32_t mhz = result.cpu_mhz ? result.cpu_mhz : 1;
+    printf("Codec over %" PRIu32 " iterations of %" PRIu32 " sample frames (%" PRIu32 " MHz):\n", result.iterations,
+           result.frames, result.cpu_mhz);
+    printf("  size:       %" PRIu32 " -> %" PRIu32 " bytes\n", result.raw_bytes, result.compressed_bytes);
+    printf("  compress:   %" PRIu32 " cycles/KB (%" PRIu32 " us/KB)\n", result.compress_cycles_per_kb,
+           result.compress_cycles_per_kb / mhz);
+    printf("  decompress: %" PRIu32 " cycles/KB (%" PRIu32 " us/KB)\n", result.decompress_cycles_per_kb,
+           result.decompress_cycles_per_kb / mhz);
+    printf("  payload throughput at link baud: %" PRIu32 " B/s plain, %" PRIu32 " B/s compressed\n",
+           result.plain_payload_bps, result.compressed_payload_bps);
+    return 0;
+  }
+  printf("Usage: zb_codec [status|bench [iterations]]\n");
+  return 1;
+}
+
+static int zb_stress_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc > 2) {
+    printf("Usage: zb_stress [seconds]\n");
+    return 1;
+  }
+  const uint32_t seconds = argc == 2 ? (uint32_t)atoi(argv[1]) : 10;
+  if (seconds == 0 || seconds > 600) {
+    printf("Seconds must be 1-600\n");
+    return 1;
+  }
+  uart_link_stats_t link;
+  uart_link_get_stats(&link);
+  printf("Links suspended for %" PRIu32 " s; frames loop back inside UART%u while NVS is rewritten...\n", seconds,
+         link.port);
+  uart_link_stress_t result;
+  const esp_err_t err = uart_link_flash_stress(seconds * 1000, &result);
+  if (err != ESP_OK) {
+    printf("Stress run failed: %s\n", esp_err_to_name(err));
+    return 1;
+  }
+  printf("Flash stress, %" PRIu32 " baud, IRAM profile %s (%" PRIu32 " MHz):\n", result.baud,
+         result.iram_profile ? "on" : "off", result.cpu_mhz);
+  printf("  frames:    %" PRIu32 " sent, %" PRIu32 " received, %" PRIu32 " lost, %" PRIu32 " CRC errors\n",
+         result.frames_sent, result.frames_received, result.frames_lost, result.crc_errors);
+  printf("  overflows: %" PRIu32 " RX FIFO, %" PRIu32 " driver buffer\n", result.fifo_overflows, result.buffer_full);
+  printf("  flash:     %" PRIu32 " NVS writes, longest %" PRIu32 " us\n", result.flash_writes,
+         result.max_flash_write_us);
+  printf("  parse:     %" PRIu32 " cycles/frame, worst chunk %" PRIu32 " us, longest read gap %" PRIu32 " us\n",
+         result.avg_parse_cycles, result.max_parse_us, result.max_read_gap_us);
+  return 0;
+}
+
+static int zb_chan_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+    uart_link_reset_channel_stats();
+    return 0;
+  }
+  const uint8_t link = argc == 2 ? (uint8_t)strtoul(argv[1], NULL, 0) : UART_LINK_PRIMARY;
+  if (argc > 2 || link >= uart_link_count()) {
+    printf("Usage: zb_chan [link|reset]\n");
+    return 1;
+  }
+  uart_link_stats_t link_stats;
+  uart_link_get_stats_on(link, &link_stats);
+  printf("Link %u channel framing: %s\n", link,
+         link_stats.channels ? "negotiated" : "off (plain frames, one frame per message)");
+  printf("%-8s %8s %8s %10s %9s %9s %7s %7s %6s %8s %7s\n", "channel", "msgs", "frags", "bytes", "wait us",
+         "max us", "queued", "credits", "stalls", "rx", "rx lost");
+  for (uint8_t i = 0; i < UART_LINK_CHANNEL_COUNT; ++i) {
+    uart_link_channel_stats_t stats;
+    if (uart_link_get_channel_stats_on(link, (uart_link_channel_t)i, &stats) != ESP_OK) {
+      printf("Channel stats unavailable\n");
+      return 1;
+    }
+    char credits[8];
+    if (stats.credits == UINT16_MAX) {
+      snprintf(credits, sizeof(credits), "-");
+    } else {
+      snprintf(credits, sizeof(credits), "%u", stats.credits);
+    }
+    printf("%-8s %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %9" PRIu32 " %9" PRIu32 " %7u %7s %6" PRIu32 " %8" PRIu32
+           " %7" PRIu32 "\n",
+           uart_link_channel_name(i), stats.messages_tx, stats.fragments_tx, stats.bytes_tx, stats.last_wait_us,
+           stats.max_wait_us, stats.queued_bytes, credits, stats.credit_stalls, stats.messages_rx,
+           stats.messages_rx_dropped);
+    if (stats.refused || stats.dropped) {
+      printf("%-8s %" PRIu32 " enqueue attempts found the queue full, %" PRIu32 " messages too large for the peer\n", "",
+             stats.refused, stats.dropped);
+    }
+  }
+  return 0;
+}
+
+static void print_link_window(const char* name, const uart_link_window_t* w) {
+  printf("  %-6s", name);
+  print_rate(w->frames_rx, w->window_ms);
+  printf("   ");
+  print_rate(w->bytes_rx, w->window_ms);
+  printf("   ");
+  print_rate(w->frames_tx, w->window_ms);
+  printf("   ");
+  print_rate(w->bytes_tx, w->window_ms);
+  printf("\n");
+}
+
+static int zb_links_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc != 1) {
+    printf("Usage: zb_links\n");
+    return 1;
+  }
+  // Windows 0 and 1 are the last 1 s and 10 s; summed across links for the total
+  uart_link_window_t total[2] = {};
+  for (uint8_t i = 0; i < uart_link_count(); ++i) {
+    uart_link_stats_t stats;
+    uart_link_metrics_t metrics;
+    uart_link_get_stats_on(i, &stats);
+    uart_link_get_metrics_on(i, &metrics);
+    printf("Link %u: UART%u %s, peer %s, rx %" PRIu32 " frames / %" PRIu32 " B, tx %" PRIu32 " frames / %" PRIu32
+           " B\n",
+           i, stats.port, uart_link_state_name(stats.link_state), uart_link_peer_state_name(stats.peer_state),
+           stats.frames_rx, stats.bytes_rx, stats.frames_tx, stats.bytes_tx);
+    printf("  %-6s %9s %9s %9s %9s\n", "window", "rx fr/s", "rx B/s", "tx fr/s", "tx B/s");
+    print_link_window("1 s", &metrics.windows[0]);
+    print_link_window("10 s", &metrics.windows[1]);
+    for (int w = 0; w < 2; ++w) {
+      const uart_link_window_t* src = &metrics.windows[w];
+      // the links start together, so their windows only differ by a tick
+      if (src->window_ms > total[w].window_ms) {
+        total[w].window_ms = src->window_ms;
+      }
+      total[w].frames_rx += src->frames_rx;
+      total[w].bytes_rx += src->bytes_rx;
+      total[w].frames_tx += src->frames_tx;
+      total[w].bytes_tx += src->bytes_tx;
+    }
+  }
+  if (uart_link_count() > 1) {
+    printf("All links:\n");
+    print_link_window("1 s", &total[0]);
+    print_link_window("10 s", &total[1]);
+  }
+  zigbee_manager_stats_t native;
+  zigbee_manager_get_stats(&native);
+  if (native.enabled) {
+    if (native.up) {
+      printf("C6 radio: up, PAN 0x%04X, channel %u", native.pan_id, native.channel);
+    } else {
+      printf("C6 radio: forming");
+    }
+    printf(", %" PRIu32 " devices announced\n", native.devices_announced);
+    printf("  requests %" PRIu32 ", answered %" PRIu32 ", refused %" PRIu32 ", timed out %" PRIu32 ", late %" PRIu32
+           ", pending %" PRIu32 "; %" PRIu32 " reports\n",
+           native.requests, native.answered, native.refused, native.timeouts, native.late, native.pending,
+           native.reports);
+  }
+  return 0;
+}
+
+// A zb_devices network as typed: a link index or "c6".
+static bool parse_network(const char* text, uint8_t* out) {
+  if (strcmp(text, "c6") == 0) {
+    *out = ZB_DEVICES_NATIVE;
+    return true;
+  }
+  char* end = NULL;
+  const unsigned long network = strtoul(text, &end, 10);
+  if (end == text || *end != '\0' || network >= ZB_DEVICES_NATIVE) {
+    return false;
+  }
+  *out = (uint8_t)network;
+  return true;
+}
+
+// "<network>:<short>", or a bare short address resolved through zb_devices when resolve is set;
+// one no network has reported from goes to the primary link. Prints why on failure.
+static bool parse_device(const char* text, bool resolve, uint8_t* network, uint16_t* short_addr) {
+  const char* colon = strchr(text, ':');
+  const char* addr = colon ? colon + 1 : text;
+  char* end = NULL;
+  const unsigned long value = strtoul(addr, &end, 0);
+  if (end == addr || *end != '\0' || value > 0xFFFF) {
+    printf("Bad device address '%s'; use [network:]short, e.g. 0:0x7c10 or c6:0x1234\n", text);
+    return false;
+  }
+  *short_addr = (uint16_t)value;
+  if (colon) {
+    char net[4] = {0};
+    const size_t len = (size_t)(colon - text);
+    if (len >= sizeof(net)) {
+      printf("Bad network in '%s'\n", text);
+      return false;
+    }
+    memcpy(net, text, len);
+    if (!parse_network(net, network)) {
+      printf("Bad network in '%s'\n", text);
+      return false;
+    }
+    return true;
+  }
+  if (!resolve) {
+    printf("Name the network: <network>:0x%04X\n", *short_addr);
+    return false;
+  }
+  const esp_err_t err = zb_devices_resolve(*short_addr, network);
+  if (err == ESP_ERR_INVALID_STATE) {
+    printf("0x%04X is on more than one network; use <network>:0x%04X\n", *short_addr, *short_addr);
+    return false;
+  }
+  if (err != ESP_OK) {
+    *network = UART_LINK_PRIMARY;
+  }
+  return true;
+}
+
+static void format_device(char* out, size_t size, uint8_t network, uint16_t short_addr) {
+  snprintf(out, size, "%s:0x%04X", zb_devices_network_name(network), short_addr);
+}
+
+static int zb_devices_console(int argc, char** argv) {
+  console_mux_release();
+  uint8_t network;
+  uint16_t short_addr;
+  if (argc == 3 && strcmp(argv[1], "pin") == 0) {
+    if (!parse_device(argv[2], false, &network, &short_addr)) {
+      return 1;
+    }
+    const esp_err_t err = zb_devices_pin(network, short_addr);
+    if (err != ESP_OK) {
+      printf("Pin failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    return 0;
+  }
+  if (argc == 3 && strcmp(argv[1], "forget") == 0) {
+    if (!parse_device(argv[2], false, &network, &short_addr)) {
+      return 1;
+    }
+    const esp_err_t err = zb_devices_forget(network, short_addr);
+    if (err != ESP_OK) {
+      printf("Forget failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    return 0;
+  }
+  if (argc != 1) {
+    printf("Usage: zb_devices [pin <network:short>|forget <network:short>]\n");
+    return 1;
+  }
+  static zb_device_route_t routes[64];
+  const size_t count = zb_devices_list(routes, sizeof(routes) / sizeof(routes[0]));
+  printf("%-10s %6s %10s\n", "device", "pinned", "age ms");
+  for (size_t i = 0; i < count; ++i) {
+    char device[12];
+    format_device(device, sizeof(device), routes[i].network, routes[i].short_addr);
+    printf("%-10s %6s %10" PRIu32 "\n", device, routes[i].pinned ? "yes" : "", routes[i].age_ms);
+  }
+  zb_devices_stats_t stats;
+  zb_devices_get_stats(&stats);
+  if (stats.devices > count) {
+    printf("(%" PRIu32 " more)\n", stats.devices - (uint32_t)count);
+  }
+  printf("%" PRIu32 " devices: %" PRIu32 " learned, %" PRIu32 " evicted; bare addresses %" PRIu32 " resolved, %" PRIu32
+         " unknown, %" PRIu32 " on several networks\n",
+         stats.devices, stats.learned, stats.evicted, stats.resolved, stats.unknown, stats.ambiguous);
+  return 0;
+}
+
+static int ota_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || strcmp(argv[1], "status") == 0) {
+    ota_client_status_t status;
+    ota_client_get_status(&status);
+    printf("OTA: %s\n", ota_client_state_name(status.state));
+    if (status.state == OTA_CLIENT_IDLE) {
+      return 0;
+    }
+    printf("  slot %s, %" PRIu32 "/%" PRIu32 " bytes written (%" PRIu32 " received), %" PRIu32 " resumes\n",
+           status.partition, status.written_bytes, status.image_size, status.received_bytes, status.resumes);
+    const uint32_t kb_per_s = status.bytes_per_s / 1000;
+    printf("  %" PRIu32 " ms, %" PRIu32 ".%02" PRIu32 " MB/s; writer waited %" PRIu32 " ms for data, download %" PRIu32
+           " ms for flash\n",
+           status.elapsed_ms, kb_per_s / 1000, (kb_per_s % 1000) / 10, status.net_wait_ms, status.flash_wait_ms);
+    if (status.state == OTA_CLIENT_FAILED) {
+      printf("  error: %s\n", esp_err_to_name(status.error));
+    }
+    return 0;
+  }
+  esp_err_t err = ESP_ERR_INVALID_ARG;
+  if (strcmp(argv[1], "update") == 0 && (argc == 3 || argc == 4)) {
+    err = ota_client_start(argv[2], argc == 4 ? argv[3] : NULL);
+  } else if (strcmp(argv[1], "abort") == 0) {
+    err = ota_client_abort();
+  } else {
+    printf("Usage: ota [status|update <url> [sha256]|abort]\n");
+    return 1;
+  }
+  if (err != ESP_OK) {
+    printf("ota %s failed: %s\n", argv[1], esp_err_to_name(err));
+    return 1;
+  }
+  return 0;
+}
+
+static void print_h2_ota_status(uint8_t link) {
+  h2_ota_status_t status;
+  h2_ota_get_status_on(link, &status);
+  printf("H2 OTA on link %u: %s\n", link, h2_ota_state_name(status.state));
+  if (status.state == H2_OTA_IDLE) {
+    return;
+  }
+  printf("  image: %" PRIu32 " bytes, crc32=0x%08" PRIx32 ", staged %" PRIu32 "\n", status.image_size,
+         status.image_crc32, status.staged_bytes);
+  if (status.state >= H2_OTA_CONNECTING) {
+    const uint32_t pct = status.image_size ? (uint32_t)((uint64_t)status.acked_bytes * 100 / status.image_size) : 0;
+    printf("  sent:  %" PRIu32 "/%" PRIu32 " bytes (%" PRIu32 "%%), resumed at %" PRIu32 "\n", status.acked_bytes,
+           status.image_size, pct, status.resumed_from);
+    printf("  %" PRIu32 " chunks, %" PRIu32 " retransmitted, %" PRIu32 " timeouts, %" PRIu32 " ms, %" PRIu32
+           " B/s\n",
+           status.chunks_sent, status.retransmits, status.timeouts, status.elapsed_ms, status.bytes_per_s);
+  }
+  if (status.state == H2_OTA_FAILED) {
+    printf("  failure status 0x%02X\n", status.failure);
+  }
+}
+
+static int h2_ota_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || strcmp(argv[1], "status") == 0) {
+    for (uint8_t link = 0; link < uart_link_count(); ++link) {
+      print_h2_ota_status(link);
+    }
+    return 0;
+  }
+  // start and abort take the link whose H2 is updated; the primary when omitted.
+  const uint8_t link = argc == 3 ? (uint8_t)strtoul(argv[2], NULL, 0) : UART_LINK_PRIMARY;
+  esp_err_t err = ESP_ERR_INVALID_ARG;
+  if (strcmp(argv[1], "fetch") == 0 && (argc == 3 || argc == 4)) {
+    err = ota_client_fetch_h2(argv[2], argc == 4 ? (uint32_t)strtoul(argv[3], NULL, 16) : 0);
+    if (err == ESP_OK) {
+      printf("Downloading; 'ota' shows progress, then 'h2_ota start [link]' sends the image\n");
+    }
+  } else if (strcmp(argv[1], "start") == 0 && argc <= 3) {
+    err = h2_ota_start_on(link);
+  } else if (strcmp(argv[1], "abort") == 0 && argc <= 3) {
+    err = h2_ota_abort_on(link);
+  } else {
+    printf("Usage: h2_ota [status|fetch <url> [crc32]|start [link]|abort [link]]\n");
+    return 1;
+  }
+  if (err != ESP_OK) {
+    printf("h2_ota %s failed: %s\n", argv[1], esp_err_to_name(err));
+    return 1;
+  }
   return 0;
 }
 
+static int zb_log_console(int argc, char** argv) {
+  console_mux_release();
+  h2_log_stats_t stats;
+  h2_log_get_stats(&stats);
+  if (argc == 1 || strcmp(argv[1], "status") == 0) {
+    printf("H2 log: level %u, %u records/s max, metrics every %u ms\n", stats.level, stats.max_records_per_s,
+           stats.metrics_period_ms);
+    printf("  %" PRIu32 " records, %" PRIu32 " printed, %" PRIu32 " rate limited here, %" PRIu32
+           " dropped on the H2\n",
+           stats.records, stats.printed, stats.rate_limited, stats.h2_dropped);
+    printf("  %" PRIu32 " metrics frames, %" PRIu32 " malformed frames, %" PRIu32 " bytes\n", stats.metrics_frames,
+           stats.malformed_frames, stats.bytes);
+    return 0;
+  }
+  if (strcmp(argv[1], "tail") == 0 && argc <= 3) {
+    h2_log_print_tail(argc == 3 ? (uint32_t)atoi(argv[2]) : 0);
+    return 0;
+  }
+  if (strcmp(argv[1], "metrics") == 0 && argc == 2) {
+    h2_metrics_t metrics;
+    h2_log_get_metrics(&metrics);
+    if (!metrics.valid) {
+      printf("No metrics received from the H2 yet\n");
+      return 0;
+    }
+    printf("H2 metrics (%" PRIu32 " ms old, H2 uptime %" PRIu32 " ms)\n", metrics.age_ms, metrics.h2_uptime_ms);
+    printf("  zigbee queue:   %" PRIu32 " (high water %" PRIu32 ")\n", metrics.zb_queue_depth,
+           metrics.zb_queue_high_water);
+    printf("  mac:            %" PRIu32 " retries, %" PRIu32 " tx failures\n", metrics.mac_retries,
+           metrics.mac_tx_failures);
+    printf("  children:       %" PRIu32 ", neighbors %" PRIu32 "\n", metrics.child_count, metrics.neighbor_count);
+    printf("  heap:           %" PRIu32 " free, %" PRIu32 " minimum\n", metrics.free_heap, metrics.min_free_heap);
+    printf("  log dropped:    %" PRIu32 "\n", metrics.log_dropped);
+    return 0;
+  }
+  if (argc == 3) {
+    const int value = atoi(argv[2]);
+    uint8_t level = stats.level;
+    uint16_t rate = stats.max_records_per_s;
+    uint16_t period = stats.metrics_period_ms;
+    bool known = true;
+    if (strcmp(argv[1], "level") == 0) {
+      level = (uint8_t)value;
+    } else if (strcmp(argv[1], "rate") == 0) {
+      rate = (uint16_t)value;
+    } else if (strcmp(argv[1], "period") == 0) {
+      period = (uint16_t)value;
+    } else {
+      known = false;
+    }
+    if (known) {
+      const esp_err_t err = value < 0 || value > UINT16_MAX ? ESP_ERR_INVALID_ARG : h2_log_configure(level, rate, period);
+      if (err != ESP_OK) {
+        printf("zb_log %s failed: %s\n", argv[1], esp_err_to_name(err));
+        return 1;
+      }
+      return 0;
+    }
+  }
+  printf("Usage: zb_log [status|tail [n]|metrics|level <0-5>|rate <n>|period <ms>]\n");
+  return 1;
+}
+
 static int zb_suspend_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   uart_link_suspend();
   printf("Zigbee UART bridge paused\n");
   return 0;
 }
 
 static int zb_resume_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   uart_link_resume();
   printf("Zigbee UART bridge resumed\n");
   return 0;
 }
 
 static int zb_debug_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   if (argc == 1) {
     printf("Zigbee UART debug is %s\n", uart_link_is_debug_enabled() ? "ON" : "OFF");
     return 0;
@@ -116,13 +613,13 @@ static int zb_debug_console(int argc, char** argv) {
 }
 
 static int zb_handshake_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   uart_link_send_manual_handshake();
   return 0;
 }
 
 static int zb_check_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   uint32_t timeout_ms = CONFIG_APP_UART_LINK_HANDSHAKE_TIMEOUT_MS;
   if (argc == 2) {
     timeout_ms = (uint32_t)atoi(argv[1]);
@@ -143,23 +640,68 @@ static int zb_check_console(int argc, char** argv) {
   return err == ESP_OK ? 0 : 1;
 }
 
+static const char* zb_role_name(uint8_t role) {
+  switch (role) {
+    case ZB_ROLE_ROUTER:
+      return "router";
+    case ZB_ROLE_END_DEVICE:
+      return "end device";
+    default:
+      return "unknown";
+  }
+}
+
+/* Waits for a typed command and prints anything but success. Returns the CLI exit code. */
+static int zb_command_finish(ZbCommand& command, const char* what) {
+  const esp_err_t err = command.wait(1000);
+  if (err != ESP_OK && command.send_error() != ESP_OK) {
+    printf("%s not sent: %s\n", what, esp_err_to_name(err));
+    return 1;
+  }
+  if (command.status() != ZB_CMD_STATUS_OK) {
+    printf("%s: %s", what, zb_command_status_name(command.status()));
+    if (command.status() == ZB_CMD_STATUS_ZCL_ERROR) {
+      printf(" (0x%02X)", command.detail());
+    }
+    printf("\n");
+    return 1;
+  }
+  return 0;
+}
+
 static int zb_mode_console(int argc, char** argv) {
-  g_logging_paused = false;
+  console_mux_release();
   if (argc != 2) {
     printf("Usage: zb_mode <status|end|router>\n");
     return 1;
   }
   char buffer[32] = {0};
+  uint8_t role = ZB_ROLE_QUERY;
   if (strcmp(argv[1], "status") == 0 || strcmp(argv[1], "?") == 0) {
     strcpy(buffer, "mode?");
   } else if (strcmp(argv[1], "router") == 0 || strcmp(argv[1], "hub") == 0) {
     strcpy(buffer, "mode:router");
+    role = ZB_ROLE_ROUTER;
   } else if (strcmp(argv[1], "end") == 0 || strcmp(argv[1], "enddevice") == 0) {
     strcpy(buffer, "mode:end");
+    role = ZB_ROLE_END_DEVICE;
   } else {
     printf("Usage: zb_mode <status|end|router>\n");
     return 1;
   }
+  if (zb_command_supported()) {
+    const zb_cmd_set_mode_t request = {role};
+    ZbCommand command = zb_command_send(UART_LINK_PRIMARY, request);
+    if (zb_command_finish(command, "Zigbee mode command") != 0) {
+      return 1;
+    }
+    zb_rsp_mode_t mode = {};
+    command.response(&mode);
+    printf("Zigbee role: %s%s (%" PRIu32 " us round trip)\n", zb_role_name(mode.role),
+           mode.restart_pending ? ", applies after the H2 restarts" : "", command.round_trip_us());
+    return 0;
+  }
+  // Older H2 firmware without typed commands parses the text form.
   esp_err_t err = uart_link_send_text(buffer);
   if (err != ESP_OK) {
     printf("Failed to send Zigbee mode command: %s\n", esp_err_to_name(err));
@@ -169,35 +711,606 @@ static int zb_mode_console(int argc, char** argv) {
   return 0;
 }
 
+static int zb_cmd_bench(uint32_t iterations) {
+  // The same commands in the old text form and as typed frames; 7 bytes of framing each.
+  static const struct {
+    const char* name;
+    const char* text;
+    size_t typed;
+  } kForms[] = {
+      {"mode", "mode:router", sizeof(zb_cmd_set_mode_t)},
+      {"on/off", "onoff:0x7c10:1:on", sizeof(zb_cmd_on_off_t)},
+      {"level", "level:0x7c10:1:254:10", sizeof(zb_cmd_level_t)},
+      {"color", "color:0x7c10:1:24939:24701:10", sizeof(zb_cmd_color_t)},
+      {"bind", "bind:00124b0022110f01:1:0x0006:00124b0001020304:1", sizeof(zb_cmd_bind_t)},
+      {"read", "read:0x7c10:1:0x0006:0x0000", sizeof(zb_cmd_read_attr_t)},
+  };
+  const uint32_t byte_us = 10 * 1000000 / CONFIG_APP_UART_LINK_UART_BAUDRATE;  // 8N1
+  printf("%-8s %10s %10s %12s %12s\n", "command", "text B", "typed B", "text wire us", "typed wire us");
+  for (size_t i = 0; i < sizeof(kForms) / sizeof(kForms[0]); ++i) {
+    const uint32_t text = (uint32_t)strlen(kForms[i].text) + 7;
+    const uint32_t typed = (uint32_t)(sizeof(zb_cmd_header_t) + kForms[i].typed) + 7;
+    printf("%-8s %10" PRIu32 " %10" PRIu32 " %12" PRIu32 " %12" PRIu32 "\n", kForms[i].name, text, typed,
+           text * byte_us, typed * byte_us);
+  }
+  printf("Text commands carry no request id, so their round trip cannot be measured.\n");
+
+  zb_command_bench_t bench;
+  const esp_err_t err = zb_command_benchmark(iterations, &bench);
+  if (err != ESP_OK) {
+    printf("Round trip benchmark failed: %s\n", esp_err_to_name(err));
+    return 1;
+  }
+  printf("SET_MODE query round trip over %" PRIu32 "/%" PRIu32 ": min %" PRIu32 " us, avg %" PRIu32 " us, max %" PRIu32
+         " us\n",
+         bench.completed, bench.iterations, bench.min_round_trip_us, bench.avg_round_trip_us, bench.max_round_trip_us);
+  return 0;
+}
+
+static int zb_cmd_flood(void) {
+  zb_stage_bench_t bench;
+  if (zb_command_stage_benchmark(&bench) != ESP_OK) {
+    printf("Staging benchmark unavailable\n");
+    return 1;
+  }
+  printf("Synthetic floods at %u commands/s per device, burst %u, flush every %" PRIu32 " ms:\n", bench.rate_per_s,
+         bench.burst, bench.flush_ms);
+  printf("Scenario             commands  frames  saved  bytes saved  delay avg  max  settled\n");
+  for (int i = 0; i < ZB_STAGE_BENCH_SCENARIOS; ++i) {
+    const zb_stage_bench_scenario_t* run = &bench.scenarios[i];
+    const uint32_t saved = run->commands ? (run->commands - run->frames) * 100 / run->commands : 0;
+    printf("%-20s %8" PRIu32 " %7" PRIu32 " %5" PRIu32 "%% %12" PRIu32 " %7" PRIu32 " ms %4" PRIu32 " %5" PRIu32
+           " ms%s\n",
+           run->name, run->commands, run->frames, saved, run->link_bytes_saved, run->avg_delay_ms, run->max_delay_ms,
+           run->final_delay_ms, run->final_state_sent ? "" : "  (final value lost!)");
+  }
+  printf("Delay is counted from the arrival of the command each frame carried; settled is the last\n"
+         "command until nothing was left waiting.\n");
+  return 0;
+}
+
+static int zb_cmd_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || strcmp(argv[1], "status") == 0) {
+    zb_command_stats_t stats;
+    zb_command_get_stats(&stats);
+    printf("Typed commands: %s\n", stats.supported ? "supported by the H2" : "not supported by the H2 (text only)");
+    printf("  %" PRIu32 " sent, %" PRIu32 " answered, %" PRIu32 " failed, %" PRIu32 " in flight\n", stats.sent,
+           stats.completed, stats.failed, stats.in_flight);
+    printf("  %" PRIu32 " late, %" PRIu32 " malformed, %" PRIu32 " refused (all slots busy)\n", stats.late,
+           stats.malformed, stats.no_slot);
+    printf("  round trip: last %" PRIu32 " us, avg %" PRIu32 " us, max %" PRIu32 " us\n", stats.last_round_trip_us,
+           stats.avg_round_trip_us, stats.max_round_trip_us);
+    return 0;
+  }
+  if (strcmp(argv[1], "reset") == 0 && argc == 2) {
+    zb_command_reset_stats();
+    return 0;
+  }
+  if (strcmp(argv[1], "stage") == 0 && argc == 2) {
+    zb_stage_stats_t stats;
+    zb_command_get_stage_stats(&stats);
+    printf("Staging: %u commands/s per device, burst %u, %" PRIu32 " waiting\n", stats.rate_per_s, stats.burst,
+           stats.staged);
+    printf("  %" PRIu32 " offered: %" PRIu32 " sent at once, %" PRIu32 " deferred (%" PRIu32 " flushed), %" PRIu32
+           " coalesced, %" PRIu32 " bypassed\n",
+           stats.offered, stats.sent_now, stats.deferred, stats.flushed, stats.coalesced, stats.bypassed);
+    printf("  %" PRIu32 " restaged, %" PRIu32 " send errors\n", stats.restaged, stats.send_errors);
+    printf("  deferred wait: avg %" PRIu32 " ms, max %" PRIu32 " ms\n", stats.avg_delay_ms, stats.max_delay_ms);
+    return 0;
+  }
+  if (strcmp(argv[1], "limit") == 0 && argc == 4) {
+    const esp_err_t err = zb_command_set_rate_limit((uint16_t)atoi(argv[2]), (uint8_t)atoi(argv[3]));
+    if (err != ESP_OK) {
+      printf("Rate limit not set: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    return 0;
+  }
+  if (strcmp(argv[1], "flood") == 0 && argc == 2) {
+    return zb_cmd_flood();
+  }
+  if (strcmp(argv[1], "bench") == 0 && argc <= 3) {
+    const uint32_t iterations = argc == 3 ? (uint32_t)atoi(argv[2]) : 100;
+    return zb_cmd_bench(iterations ? iterations : 100);
+  }
+  uint8_t network;
+  uint16_t short_addr;
+  if (argc >= 4 && parse_device(argv[2], true, &network, &short_addr)) {
+    const zb_cmd_target_t target = {short_addr, (uint8_t)strtoul(argv[3], NULL, 0)};
+    if (strcmp(argv[1], "onoff") == 0 && argc == 5) {
+      zb_cmd_on_off_t request = {target, ZB_ON_OFF_TOGGLE};
+      if (strcmp(argv[4], "on") == 0) {
+        request.action = ZB_ON_OFF_ON;
+      } else if (strcmp(argv[4], "off") == 0) {
+        request.action = ZB_ON_OFF_OFF;
+      }
+      ZbCommand command = zb_command_send(network, request);
+      return zb_command_finish(command, "onoff");
+    }
+    if (strcmp(argv[1], "level") == 0 && (argc == 5 || argc == 6)) {
+      const zb_cmd_level_t request = {target, (uint8_t)strtoul(argv[4], NULL, 0),
+                                      (uint16_t)(argc == 6 ? strtoul(argv[5], NULL, 0) : 0)};
+      ZbCommand command = zb_command_send(network, request);
+      return zb_command_finish(command, "level");
+    }
+    if (strcmp(argv[1], "read") == 0 && argc == 6) {
+      const zb_cmd_read_attr_t request = {target, (uint16_t)strtoul(argv[4], NULL, 0),
+                                          (uint16_t)strtoul(argv[5], NULL, 0)};
+      ZbCommand command = zb_command_send(network, request);
+      if (zb_command_finish(command, "read") != 0) {
+        return 1;
+      }
+      zb_rsp_read_attr_t value = {};
+      command.response(&value);
+      printf("cluster 0x%04X attr 0x%04X type 0x%02X:", value.cluster, value.attribute, value.zcl_type);
+      for (uint8_t i = 0; i < value.length && i < sizeof(value.value); ++i) {
+        printf(" %02X", value.value[i]);
+      }
+      printf(" (%" PRIu32 " us)\n", command.round_trip_us());
+      return 0;
+    }
+  }
+  printf("Usage: zb_cmd [status|reset|bench [n]|stage|limit <per_s> <burst>|flood|onoff <[net:]addr> <ep> "
+         "<on|off|toggle>|level <[net:]addr> <ep> <0-254> [ds]|read <[net:]addr> <ep> <cluster> <attr>]\n");
+  return 1;
+}
+
+// Share of received reports that did not reach subscribers, as "12.3%".
+static void print_filter_rate(uint32_t received, uint32_t forwarded) {
+  const uint32_t permille = received ? (uint32_t)((uint64_t)(received - forwarded) * 1000 / received) : 0;
+  printf("%3" PRIu32 ".%" PRIu32 "%%", permille / 10, permille % 10);
+}
+
+static uint16_t parse_attr_id(const char* text) {
+  return strcmp(text, "*") == 0 ? ATTR_INGEST_ANY : (uint16_t)strtoul(text, NULL, 0);
+}
+
+static int zb_attr_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || (argc == 2 && strcmp(argv[1], "status") == 0)) {
+    attr_ingest_stats_t stats;
+    attr_ingest_get_stats(&stats);
+    printf("Attribute reports: %" PRIu32 " received, %" PRIu32 " forwarded, filter rate ", stats.received,
+           stats.forwarded);
+    print_filter_rate(stats.received, stats.forwarded);
+    printf("\n  %" PRIu32 " within deadband, %" PRIu32 " coalesced, %" PRIu32 " held now\n", stats.filtered,
+           stats.coalesced, stats.held);
+    printf("  %" PRIu32 " attributes from %" PRIu32 " devices tracked, %" PRIu32 " evicted, %" PRIu32
+           " passed untracked, %" PRIu32 " malformed frames\n",
+           stats.entries, stats.devices, stats.evictions, stats.untracked, stats.malformed_frames);
+    return 0;
+  }
+  if (argc == 2 && strcmp(argv[1], "devices") == 0) {
+    attr_ingest_device_t devices[32];
+    const size_t count = attr_ingest_get_devices(devices, sizeof(devices) / sizeof(devices[0]));
+    printf("Device      received  forwarded  deadband  coalesced  filtered\n");
+    for (size_t i = 0; i < count; ++i) {
+      const attr_ingest_device_t* device = &devices[i];
+      char name[12];
+      format_device(name, sizeof(name), device->network, device->short_addr);
+      printf("%-10s %9" PRIu32 " %10" PRIu32 " %9" PRIu32 " %10" PRIu32 "    ", name, device->received,
+             device->forwarded, device->filtered, device->coalesced);
+      print_filter_rate(device->received, device->forwarded);
+      printf("\n");
+    }
+    return 0;
+  }
+  if (argc == 2 && strcmp(argv[1], "rules") == 0) {
+    attr_ingest_rule_t rules[16];
+    const size_t count = attr_ingest_get_rules(rules, sizeof(rules) / sizeof(rules[0]));
+    printf("Cluster Attr    deadband  permille  min_ms    max_ms\n");
+    for (size_t i = 0; i < count; ++i) {
+      const attr_ingest_rule_t* rule = &rules[i];
+      char cluster[8];
+      char attribute[8];
+      snprintf(cluster, sizeof(cluster), rule->cluster == ATTR_INGEST_ANY ? "*" : "0x%04X", rule->cluster);
+      snprintf(attribute, sizeof(attribute), rule->attribute == ATTR_INGEST_ANY ? "*" : "0x%04X", rule->attribute);
+      printf("%-7s %-7s %8" PRIu32 " %9u %7" PRIu32 " %9" PRIu32 "\n", cluster, attribute, rule->deadband_abs,
+             rule->deadband_permille, rule->min_interval_ms, rule->max_interval_ms);
+    }
+    return 0;
+  }
+  if (argc == 8 && strcmp(argv[1], "rule") == 0) {
+    const attr_ingest_rule_t rule = {parse_attr_id(argv[2]),
+                                     parse_attr_id(argv[3]),
+                                     (uint32_t)strtoul(argv[4], NULL, 0),
+                                     (uint16_t)strtoul(argv[5], NULL, 0),
+                                     (uint32_t)strtoul(argv[6], NULL, 0),
+                                     (uint32_t)strtoul(argv[7], NULL, 0)};
+    const esp_err_t err = attr_ingest_set_rule(&rule);
+    if (err != ESP_OK) {
+      printf("Rule not set: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    return 0;
+  }
+  if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+    attr_ingest_reset_stats();
+    printf("Attribute filter counters cleared\n");
+    return 0;
+  }
+  printf("Usage: zb_attr [status|devices|rules|reset|rule <cluster|*> <attr|*> <abs> <permille> <min_ms> "
+         "<max_ms>]\n");
+  return 1;
+}
+
+// "42m", "5h" or "12.5d" for a span of seconds.
+static void format_span(char* out, size_t size, uint32_t seconds) {
+  if (seconds < 7200) {
+    snprintf(out, size, "%" PRIu32 "m", seconds / 60);
+  } else if (seconds < 2 * 86400) {
+    snprintf(out, size, "%" PRIu32 "h", seconds / 3600);
+  } else {
+    snprintf(out, size, "%" PRIu32 ".%" PRIu32 "d", seconds / 86400, seconds % 86400 * 10 / 86400);
+  }
+}
+
+// Series open in RAM, copied into the response arena; NULL if there are none.
+static history_series_t* history_series_copy(size_t* count) {
+  history_stats_t stats;
+  history_get_stats(&stats);
+  *count = 0;
+  if (stats.series == 0) {
+    return NULL;
+  }
+  history_series_t* series = s_response_arena.allocate_array<history_series_t>(stats.max_series);
+  if (series) {
+    *count = history_get_series(series, stats.max_series);
+  }
+  return series;
+}
+
+static int history_query_console(int argc, char** argv) {
+  debug::pool::ArenaScope response(s_response_arena);
+  size_t count;
+  const size_t mark = s_response_arena.mark();
+  history_series_t* series = history_series_copy(&count);
+  const size_t index = (size_t)strtoul(argv[2], NULL, 0);
+  if (index >= count) {
+    printf("No series %u; see 'history series'\n", (unsigned)index);
+    return 1;
+  }
+  const history_key_t key = series[index].key;
+  s_response_arena.rewind(mark);
+  history_tier_t tier = HISTORY_MINUTE;
+  if (argc >= 4) {
+    if (strcmp(argv[3], "raw") == 0) {
+      tier = HISTORY_RAW;
+    } else if (strcmp(argv[3], "1h") == 0) {
+      tier = HISTORY_HOUR;
+    } else if (strcmp(argv[3], "1m") != 0) {
+      printf("Tier must be raw, 1m or 1h\n");
+      return 1;
+    }
+  }
+  const uint32_t hours = argc == 5 ? (uint32_t)strtoul(argv[4], NULL, 0) : 24;
+  const uint32_t now = history_now();
+  const uint32_t from = hours * 3600 < now ? now - hours * 3600 : 0;
+  size_t max_points = s_response_arena.room_for<history_point_t>();
+  if (max_points > 800) {
+    max_points = 800;  // a month of hours
+  }
+  history_point_t* points = s_response_arena.allocate_array<history_point_t>(max_points);
+  if (!points) {
+    printf("Response arena too small (APP_CLI_ARENA_KB)\n");
+    return 1;
+  }
+  history_query_stats_t stats;
+  const size_t found = history_query(&key, tier, from, now, points, max_points, &stats);
+  const size_t shown = 48;
+  char device[12];
+  format_device(device, sizeof(device), key.network, key.short_addr);
+  printf("%s/%u 0x%04X/0x%04X, %s, last %" PRIu32 " h: %u points", device, key.endpoint, key.cluster, key.attribute,
+         history_tier_name(tier), hours, (unsigned)found);
+  printf(" (%" PRIu32 " us, %" PRIu32 " sectors skipped, %" PRIu32 " headers read, %" PRIu32 " blocks decoded)\n",
+         stats.elapsed_us, stats.sectors_skipped, stats.headers_read, stats.blocks_decoded);
+  if (found > shown) {
+    printf("  ... %u older points not shown\n", (unsigned)(found - shown));
+  }
+  printf("     age        mean         min         max  count\n");
+  for (size_t i = found > shown ? found - shown : 0; i < found; ++i) {
+    const history_point_t* point = &points[i];
+    char age[12];
+    format_span(age, sizeof(age), now - point->t);
+    printf("%8s %11.2f %11.2f %11.2f %6" PRIu32 "\n", age, point->mean, point->min, point->max, point->count);
+  }
+  return 0;
+}
+
+static int history_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || (argc == 2 && strcmp(argv[1], "status") == 0)) {
+    history_stats_t stats;
+    history_get_stats(&stats);
+    if (!stats.mounted) {
+      printf("Sensor history not running\n");
+      return 1;
+    }
+    printf("Sensor history: %" PRIu32 " KB, mounted in %" PRIu32 " ms\n", stats.region_bytes / 1024, stats.mount_ms);
+    printf("  %" PRIu32 " samples since boot, %" PRIu32 "/%" PRIu32 " series open, %" PRIu32 " evicted, %" PRIu32
+           " dropped, %" PRIu32 " non-numeric\n",
+           stats.samples, stats.series, stats.max_series, stats.evictions, stats.dropped, stats.unsupported);
+    printf("  %" PRIu32 " flash errors, %" PRIu32 " corrupt blocks\n", stats.flash_errors, stats.corrupt_blocks);
+    printf("Tier  sectors  blocks   points  bytes/pt  retained  written  erases\n");
+    const uint32_t now = history_now();
+    for (int t = 0; t < HISTORY_TIERS; ++t) {
+      const history_tier_stats_t* tier = &stats.tier[t];
+      const uint32_t centi = tier->points ? (uint32_t)((uint64_t)tier->payload_bytes * 100 / tier->points) : 0;
+      char retained[12] = "-";
+      if (tier->oldest_t && tier->oldest_t <= now) {
+        format_span(retained, sizeof(retained), now - tier->oldest_t);
+      }
+      printf("%-4s %8" PRIu32 " %7" PRIu32 " %8" PRIu32 " %6" PRIu32 ".%02" PRIu32 " %9s %8" PRIu32 " %7" PRIu32 "\n",
+             history_tier_name((history_tier_t)t), tier->sectors, tier->blocks, tier->points, centi / 100, centi % 100,
+             retained, tier->blocks_written, tier->erases);
+    }
+    return 0;
+  }
+  if (argc == 2 && strcmp(argv[1], "series") == 0) {
+    debug::pool::ArenaScope response(s_response_arena);
+    size_t count;
+    history_series_t* series = history_series_copy(&count);
+    const uint32_t now = history_now();
+    printf("  #  Device/ep      Cluster/attr   samples        last  age\n");
+    for (size_t i = 0; i < count; ++i) {
+      const history_series_t* entry = &series[i];
+      char device[12];
+      format_device(device, sizeof(device), entry->key.network, entry->key.short_addr);
+      printf("%3u  %9s/%-3u 0x%04X/0x%04X %8" PRIu32 " %11.2f  %" PRIu32 "s\n", (unsigned)i, device,
+             entry->key.endpoint, entry->key.cluster, entry->key.attribute, entry->samples, entry->last_value,
+             now - entry->last_t);
+    }
+    return 0;
+  }
+  if ((argc >= 3 && argc <= 5) && strcmp(argv[1], "query") == 0) {
+    return history_query_console(argc, argv);
+  }
+  if (argc == 2 && strcmp(argv[1], "flush") == 0) {
+    const esp_err_t err = history_flush();
+    printf("%s\n", err == ESP_OK ? "Open blocks written" : esp_err_to_name(err));
+    return err == ESP_OK ? 0 : 1;
+  }
+  printf("Usage: history [status|series|query <n> [raw|1m|1h] [hours]|flush]\n");
+  return 1;
+}
+
+static int zb_latency_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+    uart_link_reset_latency();
+    printf("Latency histograms cleared\n");
+    return 0;
+  }
+  const uint8_t link = argc == 2 ? (uint8_t)strtoul(argv[1], NULL, 0) : UART_LINK_PRIMARY;
+  if (argc > 2 || link >= uart_link_count()) {
+    printf("Usage: zb_latency [link|reset]\n");
+    return 1;
+  }
+  uart_link_latency_t latency;
+  uart_link_get_latency_on(link, &latency);
+  const uart_link_clock_t* clock = &latency.clock;
+  printf("Link %u\n", link);
+  if (clock->synced) {
+    printf("Clock: H2 %+" PRId64 " us from C6 (+/-%" PRIu32 " us), drift %+" PRId32 " ppb, trusted %" PRIu32
+           " ms ago\n",
+           clock->offset_us, clock->error_us, clock->drift_ppb, clock->age_ms);
+  } else {
+    printf("Clock: not synchronised (H2 %s)\n",
+           uart_link_handshake_ok_on(link) ? "does not advertise clock sync" : "link not up");
+  }
+  printf("  %" PRIu32 " exchanges, %" PRIu32 " rejected, %" PRIu32 " clock jumps\n", clock->samples,
+         clock->rejected, clock->jumps);
+  printf("Stamped frames: %" PRIu32 " (%" PRIu32 " before sync)\n", latency.stamped_frames,
+         latency.unsynced_frames);
+  printf("Per-hop latency (us):\n");
+  for (int hop = 0; hop < UART_LINK_HOP_COUNT; ++hop) {
+    print_link_histogram(uart_link_hop_name((uint8_t)hop), &latency.hops_us[hop]);
+  }
+  return 0;
+}
+
 static int log_level_console(int argc, char** argv) {
-  if (argc != 2) {
-    printf("Usage: log_level <none|error|warn|info|debug|verbose>\n");
+  if (argc != 2 && argc != 3) {
+    printf("Usage: log_level [tag] <none|error|warn|info|debug|verbose>\n");
     return 1;
   }
+  const char* tag = argc == 3 ? argv[1] : "*";
+  const char* name = argv[argc - 1];
 
   esp_log_level_t level = ESP_LOG_NONE;
-  if (strcmp(argv[1], "none") == 0) {
+  if (strcmp(name, "none") == 0) {
     level = ESP_LOG_NONE;
-  } else if (strcmp(argv[1], "error") == 0) {
+  } else if (strcmp(name, "error") == 0) {
     level = ESP_LOG_ERROR;
-  } else if (strcmp(argv[1], "warn") == 0) {
+  } else if (strcmp(name, "warn") == 0) {
     level = ESP_LOG_WARN;
-  } else if (strcmp(argv[1], "info") == 0) {
+  } else if (strcmp(name, "info") == 0) {
     level = ESP_LOG_INFO;
-  } else if (strcmp(argv[1], "debug") == 0) {
+  } else if (strcmp(name, "debug") == 0) {
     level = ESP_LOG_DEBUG;
-  } else if (strcmp(argv[1], "verbose") == 0) {
+  } else if (strcmp(name, "verbose") == 0) {
     level = ESP_LOG_VERBOSE;
   } else {
     printf("Invalid log level. Use: none, error, warn, info, debug, verbose\n");
     return 1;
   }
 
-  esp_log_level_set("*", level);
-  printf("Log level set to %s\n", argv[1]);
+  esp_log_level_set(tag, level);
+  printf("Log level for %s set to %s\n", tag, name);
+  return 0;
+}
+
+static int dlog_console(int argc, char** argv) {
+  if (argc == 1 || strcmp(argv[1], "stats") == 0) {
+    deferred_log_stats_t stats;
+    deferred_log_get_stats(&stats);
+    printf("Deferred log: captured=%" PRIu32 " written=%" PRIu32 " pending=%" PRIu32 " dropped=%" PRIu32
+           " truncated=%" PRIu32 "\n",
+           stats.captured, stats.written, deferred_log_pending(), stats.dropped, stats.truncated);
+    printf("Ring: capacity=%" PRIu32 " slots high_water=%" PRIu32 " held=%s hold_spills=%" PRIu32 "\n",
+           stats.capacity, stats.high_water, console_mux_is_holding() ? "yes" : "no", stats.hold_spills);
+    return 0;
+  }
+  if (strcmp(argv[1], "flush") == 0) {
+    printf("Flushed %" PRIu32 " records\n", deferred_log_flush());
+    return 0;
+  }
+  if (strcmp(argv[1], "bench") == 0) {
+    uint32_t iterations = 1000;
+    if (argc == 3) {
+      iterations = (uint32_t)atoi(argv[2]);
+    }
+    deferred_log_bench_t result;
+    esp_err_t err = deferred_log_benchmark(iterations, &result);
+    if (err != ESP_OK) {
+      printf("Benchmark failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    const uint32_t mhz = result.cpu_mhz ? result.cpu_mhz : 1;
+    printf("Log call cost over %" PRIu32 " iterations (%" PRIu32 "-byte line, %" PRIu32 " MHz):\n", result.iterations,
+           result.line_bytes, result.cpu_mhz);
+    printf("  synchronous vsnprintf: %" PRIu32 " cycles (%" PRIu32 " us) + %" PRIu32 " us console wire time\n",
+           result.format_cycles, result.format_cycles / mhz, result.console_wire_us);
+    printf("  deferred capture:      %" PRIu32 " cycles (%" PRIu32 " us)\n", result.capture_cycles,
+           result.capture_cycles / mhz);
+    return 0;
+  }
+  printf("Usage: dlog [stats|flush|bench [iterations]]\n");
+  return 1;
+}
+
+static int trace_console(int argc, char** argv) {
+  if (argc == 1 || strcmp(argv[1], "dump") == 0) {
+    uint32_t max_events = 32;
+    if (argc == 3) {
+      max_events = (uint32_t)atoi(argv[2]);
+    }
+    debug_trace_dump(max_events);
+    return 0;
+  }
+  if (strcmp(argv[1], "status") == 0) {
+    debug_trace_stats_t stats;
+    debug_trace_get_stats(&stats);
+    printf("Trace: %s, %" PRIu32 " events recorded, ring holds %" PRIu32 "\n", stats.enabled ? "ON" : "OFF",
+           stats.recorded, stats.capacity);
+    return 0;
+  }
+  if (strcmp(argv[1], "clear") == 0) {
+    debug_trace_clear();
+    return 0;
+  }
+  if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0) {
+    debug_trace_set_enabled(strcmp(argv[1], "on") == 0);
+    printf("Trace recording %s\n", argv[1]);
+    return 0;
+  }
+  if (strcmp(argv[1], "bench") == 0) {
+    uint32_t iterations = 1000;
+    if (argc == 3) {
+      iterations = (uint32_t)atoi(argv[2]);
+    }
+    debug_trace_bench_t result;
+    esp_err_t err = debug_trace_benchmark(iterations, &result);
+    if (err != ESP_OK) {
+      printf("Benchmark failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    const uint32_t mhz = result.cpu_mhz ? result.cpu_mhz : 1;
+    printf("Traced call over %" PRIu32 " iterations (%" PRIu32 " MHz):\n", result.iterations, result.cpu_mhz);
+    printf("  binary trace event:  %" PRIu32 " cycles (%" PRIu32 " ns)\n", result.traced_cycles,
+           result.traced_cycles * 1000 / mhz);
+    printf("  ESP_LOGD formatting: %" PRIu32 " cycles (%" PRIu32 " ns), before any console output\n",
+           result.log_format_cycles, result.log_format_cycles * 1000 / mhz);
+    printf("  disabled site:       0 cycles (compiled out)\n");
+    return 0;
+  }
+  printf("Usage: trace [dump [n]|status|clear|on|off|bench [iterations]]\n");
+  return 1;
+}
+
+static int prof_console(int argc, char** argv) {
+  if (argc == 1 || strcmp(argv[1], "dump") == 0) {
+    debug_profile_dump();
+    return 0;
+  }
+  if (strcmp(argv[1], "reset") == 0) {
+    debug_profile_reset();
+    printf("Profiling zones cleared\n");
+    return 0;
+  }
+  printf("Usage: prof [dump|reset]\n");
+  return 1;
+}
+
+static int top_console(int argc, char** argv) {
+  if (argc == 1) {
+    telemetry_print_top();
+    return 0;
+  }
+  if (strcmp(argv[1], "history") == 0) {
+    uint32_t max_samples = 0;
+    const char* task = NULL;
+    for (int i = 2; i < argc; ++i) {
+      if (isdigit((unsigned char)argv[i][0])) {
+        max_samples = (uint32_t)atoi(argv[i]);
+      } else {
+        task = argv[i];
+      }
+    }
+    telemetry_print_history(max_samples, task);
+    return 0;
+  }
+  if (strcmp(argv[1], "reset") == 0) {
+    telemetry_reset();
+    printf("Telemetry history cleared\n");
+    return 0;
+  }
+  printf("Usage: top [history [n] [task]|reset]\n");
+  return 1;
+}
+
+static int mem_console(int argc, char** argv) {
+  mem_budget_print();
   return 0;
 }
 
+static int pool_console(int argc, char** argv) {
+  if (argc == 1 || strcmp(argv[1], "stats") == 0) {
+    debug_pool_dump();
+    return 0;
+  }
+  if (strcmp(argv[1], "reset") == 0) {
+    debug_pool_reset();
+    printf("Pool peaks and counters cleared\n");
+    return 0;
+  }
+  if (strcmp(argv[1], "bench") == 0) {
+    uint32_t iterations = 10000;
+    if (argc == 3) {
+      iterations = (uint32_t)atoi(argv[2]);
+    }
+    debug_pool_bench_t result;
+    esp_err_t err = debug_pool_benchmark(iterations, &result);
+    if (err != ESP_OK) {
+      printf("Benchmark failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    static const char* const kScenarios[DEBUG_POOL_BENCH_COUNT] = {
+        "64 B per frame", "160 B records, 32 live", "24-part response"};
+    printf("Cycles per allocate + free over %" PRIu32 " iterations (%" PRIu32 " MHz):\n", result.iterations,
+           result.cpu_mhz);
+    printf("  %-24s %8s %8s\n", "", "malloc", "pool");
+    for (int i = 0; i < DEBUG_POOL_BENCH_COUNT; ++i) {
+      printf("  %-24s %8" PRIu32 " %8" PRIu32 "%s\n", kScenarios[i], result.malloc_cycles[i], result.pool_cycles[i],
+             i == DEBUG_POOL_BENCH_RESPONSE ? " (arena)" : "");
+    }
+    return 0;
+  }
+  printf("Usage: pool [stats|reset|bench [iterations]]\n");
+  return 1;
+}
+
 static int wifi_set_console(int argc, char** argv) {
   if (argc != 3) {
     printf("Usage: wifi_set <ssid> <password>\n");
@@ -221,34 +1334,151 @@ static int ble_scan_console(int argc, char** argv) {
   return 0;
 }
 
+static const char* const kPsModeNames[WIFI_MANAGER_PS_MODES] = {"none", "min", "max"};
+
+static int wifi_ps_status(void) {
+  wifi_manager_ps_stats_t stats;
+  wifi_manager_get_ps_stats(&stats);
+  printf("Power save: %s (%s), %" PRIu32 " switches, %" PRIu32 " refused by the driver, %" PRIu32
+         " pinned sessions, %" PRIu32 " pending commands\n",
+         stats.mode < WIFI_MANAGER_PS_MODES ? kPsModeNames[stats.mode] : "?", stats.adaptive ? "adaptive" : "forced",
+         stats.switches, stats.rejected, stats.pins, stats.pending);
+  uint64_t total_ms = 0;
+  for (int i = 0; i < WIFI_MANAGER_PS_MODES; ++i) {
+    total_ms += stats.residency_ms[i];
+  }
+  printf("%-5s %12s %6s %9s %9s %9s %9s\n", "mode", "time ms", "share", "commands", "p50 us", "p90 us", "max us");
+  for (int i = 0; i < WIFI_MANAGER_PS_MODES; ++i) {
+    const uint32_t permille = total_ms ? (uint32_t)((uint64_t)stats.residency_ms[i] * 1000 / total_ms) : 0;
+    const wifi_manager_latency_t* latency = &stats.latency[i];
+    printf("%-5s %12" PRIu32 " %3" PRIu32 ".%" PRIu32 "%% %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 "\n",
+           kPsModeNames[i], stats.residency_ms[i], permille / 10, permille % 10, latency->count, latency->p50_us,
+           latency->p90_us, latency->max_us);
+  }
+  return 0;
+}
+
 static int wifi_ps_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || (argc == 2 && strcmp(argv[1], "status") == 0)) {
+    return wifi_ps_status();
+  }
   if (argc != 2) {
-    printf("Usage: wifi_ps <none|min|max>\n");
+    printf("Usage: wifi_ps [status|reset|auto|none|min|max]\n");
     return 1;
   }
+  if (strcmp(argv[1], "reset") == 0) {
+    wifi_manager_reset_ps_stats();
+    return 0;
+  }
 
-  esp_err_t err = ESP_OK;
-  if (strcmp(argv[1], "none") == 0) {
-    err = esp_wifi_set_ps(WIFI_PS_NONE);
-    printf("WiFi Power Save set to NONE\n");
-  } else if (strcmp(argv[1], "min") == 0) {
-    err = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
-    printf("WiFi Power Save set to MIN_MODEM\n");
-  } else if (strcmp(argv[1], "max") == 0) {
-    err = esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
-    printf("WiFi Power Save set to MAX_MODEM\n");
+  esp_err_t err = ESP_ERR_INVALID_ARG;
+  if (strcmp(argv[1], "auto") == 0) {
+    err = wifi_manager_auto_ps();
   } else {
-    printf("Invalid mode. Use: none, min, max\n");
+    for (uint8_t i = 0; i < WIFI_MANAGER_PS_MODES; ++i) {
+      if (strcmp(argv[1], kPsModeNames[i]) == 0) {
+        err = wifi_manager_force_ps(i);
+      }
+    }
+  }
+  if (err == ESP_ERR_INVALID_ARG) {
+    printf("Invalid mode. Use: auto, none, min, max\n");
     return 1;
   }
-
   if (err != ESP_OK) {
     printf("Failed to set PS mode: %s\n", esp_err_to_name(err));
     return 1;
   }
+  printf("WiFi power save: %s\n", strcmp(argv[1], "auto") == 0 ? "adaptive" : argv[1]);
   return 0;
 }
 
+static bool parse_radio_priority(const char* name, radio_priority_t* out) {
+  for (int i = 0; i < RADIO_PRIORITY_COUNT; ++i) {
+    if (strcmp(name, radio_scheduler_priority_name((radio_priority_t)i)) == 0) {
+      *out = (radio_priority_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int radio_status(void) {
+  radio_scheduler_plan_t plan;
+  radio_scheduler_get_plan(&plan);
+  printf("Priority: %s. BLE %s scan, %u of %u ms (%u%%); coexistence prefers %s\n",
+         radio_scheduler_priority_name(plan.priority), plan.passive ? "passive" : "active", plan.scan_window_ms,
+         plan.scan_interval_ms, plan.ble_share_pct, plan.coex);
+  printf("WiFi power save: at least %s, MIN_MODEM after %" PRIu32 " ms idle, ",
+         plan.ps_floor < WIFI_MANAGER_PS_MODES ? kPsModeNames[plan.ps_floor] : "?", plan.ps_idle_ms);
+  if (plan.ps_sleep_ms) {
+    printf("MAX_MODEM after %" PRIu32 " ms\n", plan.ps_sleep_ms);
+  } else {
+    printf("never MAX_MODEM\n");
+  }
+
+  printf("%-8s %10s %10s %7s %7s %9s %6s %5s %7s %7s %7s %8s\n", "priority", "time ms", "scan ms", "BLE air",
+         "WiFi", "adverts/s", "pings", "lost", "p50 ms", "p90 ms", "max ms", "rx kB/s");
+  for (int i = 0; i < RADIO_PRIORITY_COUNT; ++i) {
+    radio_scheduler_stats_t stats;
+    radio_scheduler_get_stats((radio_priority_t)i, &stats);
+    const uint32_t air = stats.active_ms ? (uint32_t)((uint64_t)stats.ble_air_ms * 1000 / stats.active_ms) : 0;
+    const uint32_t rate = stats.scan_ms ? (uint32_t)((uint64_t)stats.adverts * 10000 / stats.scan_ms) : 0;
+    printf("%-8s %10" PRIu32 " %10" PRIu32 " %3" PRIu32 ".%" PRIu32 "%% %3" PRIu32 ".%" PRIu32 "%% %7" PRIu32
+           ".%" PRIu32 " %6" PRIu32 " %5" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %8" PRIu32 "\n",
+           radio_scheduler_priority_name((radio_priority_t)i), stats.active_ms, stats.scan_ms, air / 10, air % 10,
+           (1000 - air) / 10, (1000 - air) % 10, rate / 10, rate % 10, stats.pings, stats.ping_lost, stats.rtt_p50_ms,
+           stats.rtt_p90_ms, stats.rtt_max_ms, stats.rx_ms ? stats.rx_bytes / stats.rx_ms : 0);
+  }
+  return 0;
+}
+
+static int radio_console(int argc, char** argv) {
+  console_mux_release();
+  if (argc == 1 || (argc == 2 && strcmp(argv[1], "status") == 0)) {
+    return radio_status();
+  }
+  if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+    radio_scheduler_reset_stats();
+    return 0;
+  }
+
+  radio_priority_t priority;
+  if (strcmp(argv[1], "bench") == 0 && argc >= 3 && argc <= 5 && parse_radio_priority(argv[2], &priority)) {
+    const uint32_t seconds = argc >= 4 ? (uint32_t)atoi(argv[3]) : 10;
+    const int share = argc == 5 ? atoi(argv[4]) : 0;
+    if (seconds == 0 || seconds > 300 || share < 0 || share > 100) {
+      printf("Seconds must be 1-300, share 0-100\n");
+      return 1;
+    }
+    printf("Benchmarking %s for %" PRIu32 " s...\n", argv[2], seconds);
+    const esp_err_t err = radio_scheduler_bench(priority, (uint8_t)share, seconds);
+    if (err != ESP_OK) {
+      printf("Bench failed: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    return radio_status();
+  }
+
+  if (argc <= 3 && parse_radio_priority(argv[1], &priority)) {
+    const int share = argc == 3 ? atoi(argv[2]) : 0;
+    if (share < 0 || share > 100) {
+      printf("Share must be 0-100\n");
+      return 1;
+    }
+    const esp_err_t err = radio_scheduler_set_priority(priority, (uint8_t)share);
+    if (err != ESP_OK) {
+      printf("Failed to set radio priority: %s\n", esp_err_to_name(err));
+      return 1;
+    }
+    return radio_status();
+  }
+
+  printf("Usage: radio [status|reset|wifi|balanced|ble [share%%]|bench <priority> [seconds] [share%%]]\n");
+  return 1;
+}
+
 /* Ping Command */
 
 static void cmd_ping_on_ping_end(esp_ping_handle_t hdl, void* args) {
@@ -393,7 +1623,7 @@ esp_err_t cli_manager_init(void) {
 
   const esp_console_cmd_t zb_info_cmd = {
       .command = "zb_info",
-      .help = "Print Zigbee link status",
+      .help = "Zigbee link status, rates and latency histograms: zb_info [reset]",
       .hint = NULL,
       .func = &zb_info_console,
       .argtable = NULL,
@@ -402,6 +1632,95 @@ esp_err_t cli_manager_init(void) {
   };
   ESP_ERROR_CHECK(esp_console_cmd_register(&zb_info_cmd));
 
+  const esp_console_cmd_t zb_codec_cmd = {
+      .command = "zb_codec",
+      .help = "UART link compression counters and codec benchmark: zb_codec [status|bench [iterations]]",
+      .hint = NULL,
+      .func = &zb_codec_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_codec_cmd));
+
+  const esp_console_cmd_t zb_stress_cmd = {
+      .command = "zb_stress",
+      .help = "UART link loss and parse latency under NVS writes, in internal loopback: zb_stress [seconds]",
+      .hint = NULL,
+      .func = &zb_stress_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_stress_cmd));
+
+  const esp_console_cmd_t zb_chan_cmd = {
+      .command = "zb_chan",
+      .help = "UART link channel queues, credits and worst-case wait: zb_chan [link|reset]",
+      .hint = NULL,
+      .func = &zb_chan_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_chan_cmd));
+
+  const esp_console_cmd_t zb_links_cmd = {
+      .command = "zb_links",
+      .help = "Per co-processor link state, counters and 1 s / 10 s throughput: zb_links",
+      .hint = NULL,
+      .func = &zb_links_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_links_cmd));
+
+  const esp_console_cmd_t zb_devices_cmd = {
+      .command = "zb_devices",
+      .help = "Which link reaches each Zigbee device: zb_devices [pin <short> <link|c6>|forget <short>]",
+      .hint = NULL,
+      .func = &zb_devices_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_devices_cmd));
+
+  const esp_console_cmd_t h2_ota_cmd = {
+      .command = "h2_ota",
+      .help = "Stage and relay an ESP32-H2 firmware image: "
+              "h2_ota [status|fetch <url> [crc32]|start [link]|abort [link]]",
+      .hint = NULL,
+      .func = &h2_ota_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&h2_ota_cmd));
+
+  const esp_console_cmd_t zb_log_cmd = {
+      .command = "zb_log",
+      .help = "H2 log and metrics stream: zb_log [status|tail [n]|metrics|level <0-5>|rate <n>|period <ms>]",
+      .hint = NULL,
+      .func = &zb_log_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_log_cmd));
+
+  const esp_console_cmd_t ota_cmd = {
+      .command = "ota",
+      .help = "Update this hub's firmware over HTTP(S): ota [status|update <url> [sha256]|abort]",
+      .hint = NULL,
+      .func = &ota_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&ota_cmd));
+
   const esp_console_cmd_t zb_suspend_cmd = {
       .command = "zb_suspend",
       .help = "Pause the Zigbee UART bridge",
@@ -468,9 +1787,53 @@ esp_err_t cli_manager_init(void) {
   };
   ESP_ERROR_CHECK(esp_console_cmd_register(&zb_mode_cmd));
 
+  const esp_console_cmd_t zb_cmd_cmd = {
+      .command = "zb_cmd",
+      .help = "Typed Zigbee device commands: zb_cmd [status|reset|bench [n]|stage|limit|flood|onoff|level|read ...]",
+      .hint = NULL,
+      .func = &zb_cmd_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_cmd_cmd));
+
+  const esp_console_cmd_t zb_attr_cmd = {
+      .command = "zb_attr",
+      .help = "Attribute report filter: zb_attr [status|devices|rules|reset|rule ...]",
+      .hint = NULL,
+      .func = &zb_attr_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_attr_cmd));
+
+  const esp_console_cmd_t history_cmd = {
+      .command = "history",
+      .help = "Sensor history store: history [status|series|query <n> [raw|1m|1h] [hours]|flush]",
+      .hint = NULL,
+      .func = &history_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&history_cmd));
+
+  const esp_console_cmd_t zb_latency_cmd = {
+      .command = "zb_latency",
+      .help = "C6/H2 clock sync and per-hop event latency: zb_latency [link|reset]",
+      .hint = NULL,
+      .func = &zb_latency_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&zb_latency_cmd));
+
   const esp_console_cmd_t log_level_cmd = {
       .command = "log_level",
-      .help = "Set the log level (none, error, warn, info, debug, verbose)",
+      .help = "Set the log level, globally or for one tag: log_level [tag] <none|error|warn|info|debug|verbose>",
       .hint = NULL,
       .func = &log_level_console,
       .argtable = NULL,
@@ -479,6 +1842,73 @@ esp_err_t cli_manager_init(void) {
   };
   ESP_ERROR_CHECK(esp_console_cmd_register(&log_level_cmd));
 
+  const esp_console_cmd_t dlog_cmd = {
+      .command = "dlog",
+      .help = "Deferred log backend: dlog [stats|flush|bench [iterations]]",
+      .hint = NULL,
+      .func = &dlog_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&dlog_cmd));
+
+  const esp_console_cmd_t trace_cmd = {
+      .command = "trace",
+      .help = "Function trace ring: trace [dump [n]|status|clear|on|off|bench [iterations]]",
+      .hint = NULL,
+      .func = &trace_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&trace_cmd));
+
+  const esp_console_cmd_t prof_cmd = {
+      .command = "prof",
+      .help = "Profiling zones: prof [dump|reset]",
+      .hint = NULL,
+      .func = &prof_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&prof_cmd));
+
+  const esp_console_cmd_t top_cmd = {
+      .command = "top",
+      .help = "Per-task CPU, stack headroom and heap: top [history [n] [task]|reset]",
+      .hint = NULL,
+      .func = &top_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&top_cmd));
+
+  const esp_console_cmd_t mem_cmd = {
+      .command = "mem",
+      .help = "RAM held by each subsystem's tasks, queues and buffers against the static budget",
+      .hint = NULL,
+      .func = &mem_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&mem_cmd));
+
+  const esp_console_cmd_t pool_cmd = {
+      .command = "pool",
+      .help = "Fixed-block pools and arenas: pool [stats|reset|bench [iterations]]",
+      .hint = NULL,
+      .func = &pool_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&pool_cmd));
+  mem_budget_charge(MEM_BUDGET_CLI, MEM_BUDGET_BUFFER, sizeof(s_response_arena), false);
+
   const esp_console_cmd_t ble_scan_cmd = {
       .command = "ble_scan",
       .help = "Scan for BLE devices: ble_scan [duration_sec]",
@@ -514,7 +1944,7 @@ esp_err_t cli_manager_init(void) {
 
   const esp_console_cmd_t wifi_ps_cmd = {
       .command = "wifi_ps",
-      .help = "Set WiFi Power Save mode: wifi_ps <none|min|max>",
+      .help = "WiFi power save residency and latency, or force a mode: wifi_ps [status|reset|auto|none|min|max]",
       .hint = NULL,
       .func = &wifi_ps_console,
       .argtable = NULL,
@@ -523,6 +1953,18 @@ esp_err_t cli_manager_init(void) {
   };
   ESP_ERROR_CHECK(esp_console_cmd_register(&wifi_ps_cmd));
 
+  const esp_console_cmd_t radio_cmd = {
+      .command = "radio",
+      .help = "WiFi/BLE airtime by priority, switch or benchmark one: radio [status|reset|<priority> [share%]|bench "
+              "<priority> [seconds] [share%]]",
+      .hint = NULL,
+      .func = &radio_console,
+      .argtable = NULL,
+      .func_w_context = NULL,
+      .context = NULL,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&radio_cmd));
+
   const esp_console_cmd_t ping_cmd = {
       .command = "ping",
       .help = "Ping a host: ping <ip_address>",
@@ -549,17 +1991,8 @@ esp_err_t cli_manager_init(void) {
   esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
   ESP_ERROR_CHECK(esp_console_new_repl_uart(&hw_config, &repl_config, &repl));
 
-  // Setup auto-pause logging
-  const esp_timer_create_args_t timer_args = {
-      .callback = &resume_logging_timer_cb,
-      .arg = NULL,
-      .dispatch_method = ESP_TIMER_TASK,
-      .name = "resume_log",
-      .skip_unhandled_events = false,
-  };
-  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &g_resume_timer));
-
-  g_default_vprintf = esp_log_set_vprintf(custom_vprintf);
+  // Route ESP_LOG output through the console multiplexer
+  ESP_ERROR_CHECK(console_mux_init());
   linenoiseSetHintsCallback(custom_hints_cb);
 
   ESP_ERROR_CHECK(esp_console_start_repl(repl));
@@ -0,0 +1,74 @@
+#include "console_mux.h"
+
+#include <stdio.h>
+
+#include "../debug/include/debug/DeferredLog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/* Release a hold when no key was pressed for this long (user walked away mid-line). */
+#define TYPING_IDLE_RELEASE_US (5 * 1000 * 1000)
+
+static esp_timer_handle_t g_idle_timer;
+static bool g_initialized = false;
+
+static void idle_release_timer_cb(void* arg) {
+  deferred_log_set_hold(false);
+}
+
+esp_err_t console_mux_init(void) {
+  if (g_initialized) {
+    return ESP_OK;
+  }
+  const esp_timer_create_args_t timer_args = {
+      .callback = &idle_release_timer_cb,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "console_idle",
+      .skip_unhandled_events = false,
+  };
+  esp_err_t err = esp_timer_create(&timer_args, &g_idle_timer);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  // The previous hook (normally vprintf to the console UART) becomes the writer task's sink.
+  vprintf_like_t console_vprintf = esp_log_set_vprintf(deferred_log_vprintf);
+  err = deferred_log_init(console_vprintf);
+  if (err != ESP_OK) {
+    esp_log_set_vprintf(console_vprintf);
+    return err;
+  }
+  g_initialized = true;
+  return ESP_OK;
+}
+
+void console_mux_note_typing(const char* line) {
+  if (!g_initialized) {
+    return;
+  }
+  if (line == NULL || line[0] == '\0') {
+    console_mux_release();
+    return;
+  }
+  deferred_log_set_hold(true);
+  esp_timer_stop(g_idle_timer);
+  esp_timer_start_once(g_idle_timer, TYPING_IDLE_RELEASE_US);
+}
+
+void console_mux_release(void) {
+  if (!g_initialized) {
+    return;
+  }
+  esp_timer_stop(g_idle_timer);
+  deferred_log_set_hold(false);
+}
+
+void console_mux_flush(void) {
+  deferred_log_flush();
+  fflush(stdout);
+}
+
+bool console_mux_is_holding(void) {
+  return deferred_log_is_held();
+}
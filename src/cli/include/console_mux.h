@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+/*
+ * Console output multiplexer.
+ *
+ * All ESP_LOG output goes through the deferred log ring and is written by a single
+ * writer task at the console's pace, so logging never blocks the calling task on the
+ * console UART. While the user is editing a command line the writer holds the output
+ * back and flushes it once the line is finished, instead of dropping it.
+ */
+
+/**
+ * @brief Install the esp_log hook and start the console writer.
+ *
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t console_mux_init(void);
+
+/**
+ * @brief Report the current line buffer on each keystroke (linenoise hints callback).
+ *        A non-empty line holds log output until it is released or the user stops typing.
+ *
+ * @param line Current contents of the edit buffer.
+ */
+void console_mux_note_typing(const char* line);
+
+/**
+ * @brief Stop holding log output (the line was submitted or abandoned).
+ */
+void console_mux_release(void);
+
+/**
+ * @brief Write out everything pending from the calling task (e.g. before a restart).
+ */
+void console_mux_flush(void);
+
+/**
+ * @brief Check whether log output is currently held back.
+ * @return true while the user is editing a line.
+ */
+bool console_mux_is_holding(void);
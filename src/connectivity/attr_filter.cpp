@@ -0,0 +1,293 @@
+#include "attr_filter.h"
+
+#include <cstring>
+
+namespace {
+
+// Integer ZCL types: 0x20-0x27 unsigned, 0x28-0x2F signed, 1 to 8 bytes.
+struct Integer {
+  uint64_t magnitude;
+  bool negative;
+};
+
+// Value of an integer ZCL type; false for anything else.
+bool as_integer(const zb_rsp_read_attr_t& attr, Integer* out) {
+  uint8_t size;
+  bool is_signed;
+  if (attr.zcl_type >= 0x20 && attr.zcl_type <= 0x27) {
+    size = attr.zcl_type - 0x1F;
+    is_signed = false;
+  } else if (attr.zcl_type >= 0x28 && attr.zcl_type <= 0x2F) {
+    size = attr.zcl_type - 0x27;
+    is_signed = true;
+  } else {
+    return false;
+  }
+  if (attr.length != size) {
+    return false;
+  }
+  uint64_t raw = 0;
+  for (uint8_t i = 0; i < size; ++i) {
+    raw |= static_cast<uint64_t>(attr.value[i]) << (8 * i);
+  }
+  if (is_signed && size < 8 && (raw >> (8 * size - 1)) & 1) {
+    raw |= ~0ull << (8 * size);
+  }
+  out->negative = is_signed && static_cast<int64_t>(raw) < 0;
+  out->magnitude = out->negative ? 0 - raw : raw;
+  return true;
+}
+
+// |a - b|, saturating where the true difference of two 64-bit values would not fit.
+uint64_t distance(const Integer& a, const Integer& b) {
+  if (a.negative == b.negative) {
+    return a.magnitude > b.magnitude ? a.magnitude - b.magnitude : b.magnitude - a.magnitude;
+  }
+  const uint64_t sum = a.magnitude + b.magnitude;
+  return sum < a.magnitude ? UINT64_MAX : sum;
+}
+
+bool matches(const attr_ingest_rule_t& rule, uint16_t cluster, uint16_t attribute) {
+  return (rule.cluster == ATTR_INGEST_ANY || rule.cluster == cluster) &&
+         (rule.attribute == ATTR_INGEST_ANY || rule.attribute == attribute);
+}
+
+}  // namespace
+
+AttrFilter::AttrFilter(const attr_ingest_rule_t& fallback) {
+  rules_[0] = fallback;
+  rules_[0].cluster = ATTR_INGEST_ANY;
+  rules_[0].attribute = ATTR_INGEST_ANY;
+  rule_count_ = 1;
+}
+
+bool AttrFilter::set_rule(const attr_ingest_rule_t& rule) {
+  for (int i = 0; i < rule_count_; ++i) {
+    if (rules_[i].cluster == rule.cluster && rules_[i].attribute == rule.attribute) {
+      rules_[i] = rule;
+      return true;
+    }
+  }
+  if (rule_count_ == kRules) {
+    return false;
+  }
+  rules_[rule_count_++] = rule;
+  return true;
+}
+
+const attr_ingest_rule_t& AttrFilter::rule_for(uint16_t cluster, uint16_t attribute) const {
+  int best = 0;
+  int best_score = 0;
+  for (int i = 1; i < rule_count_; ++i) {
+    const attr_ingest_rule_t& rule = rules_[i];
+    if (!matches(rule, cluster, attribute)) {
+      continue;
+    }
+    const int score = (rule.cluster != ATTR_INGEST_ANY ? 2 : 0) + (rule.attribute != ATTR_INGEST_ANY ? 1 : 0);
+    if (score > best_score) {
+      best = i;
+      best_score = score;
+    }
+  }
+  return rules_[best];
+}
+
+bool AttrFilter::significant(const attr_ingest_rule_t& rule, const zb_rsp_read_attr_t& last,
+                             const zb_rsp_read_attr_t& next) {
+  if (last.zcl_type != next.zcl_type || last.length != next.length) {
+    return true;
+  }
+  Integer before;
+  Integer after;
+  if (!as_integer(last, &before) || !as_integer(next, &after)) {
+    const size_t len = next.length < sizeof(next.value) ? next.length : sizeof(next.value);
+    return memcmp(last.value, next.value, len) != 0;
+  }
+  const uint64_t change = distance(before, after);
+  if (change == 0) {
+    return false;
+  }
+  const uint64_t base = before.magnitude;
+  // base * permille / 1000 without overflowing for 64-bit attributes.
+  const uint64_t relative = base / 1000 * rule.deadband_permille + base % 1000 * rule.deadband_permille / 1000;
+  const uint64_t threshold = relative > rule.deadband_abs ? relative : rule.deadband_abs;
+  return change >= threshold;
+}
+
+AttrFilter::Verdict AttrFilter::offer(uint8_t network, const zb_attr_report_t& report, uint32_t now_ms) {
+  stats_.received++;
+  attr_ingest_device_t* device = device_for(network, report.source.short_addr);
+  if (device) {
+    device->received++;
+  }
+  bool fresh = false;
+  Entry* entry = find_or_claim(network, report, now_ms, &fresh);
+  if (!entry) {
+    stats_.untracked++;
+    stats_.forwarded++;
+    if (device) {
+      device->forwarded++;
+    }
+    return Verdict::kForward;
+  }
+  entry->seen_ms = now_ms;
+  if (fresh) {
+    forward(*entry, report.attr, now_ms, device);
+    return Verdict::kForward;
+  }
+
+  const attr_ingest_rule_t& rule = rule_for(entry->cluster, entry->attribute);
+  const uint32_t since = now_ms - entry->forwarded_ms;
+  if (since < rule.min_interval_ms) {
+    if (entry->held) {
+      // Last value wins: whatever was held is superseded, significant or not.
+      stats_.coalesced++;
+      if (device) {
+        device->coalesced++;
+      }
+    } else if (significant(rule, entry->last, report.attr)) {
+      entry->held = true;
+      stats_.held++;
+    } else {
+      stats_.filtered++;
+      if (device) {
+        device->filtered++;
+      }
+      return Verdict::kFiltered;
+    }
+    entry->pending = report.attr;
+    entry->held_ms = now_ms;
+    return Verdict::kHeld;
+  }
+
+  if (entry->held) {
+    // The interval closed before take_due() ran; this newer value replaces the held one.
+    entry->held = false;
+    stats_.held--;
+    stats_.coalesced++;
+    if (device) {
+      device->coalesced++;
+    }
+  }
+  if (significant(rule, entry->last, report.attr) || (rule.max_interval_ms && since >= rule.max_interval_ms)) {
+    forward(*entry, report.attr, now_ms, device);
+    return Verdict::kForward;
+  }
+  stats_.filtered++;
+  if (device) {
+    device->filtered++;
+  }
+  return Verdict::kFiltered;
+}
+
+size_t AttrFilter::take_due(uint32_t now_ms, Released* out, size_t max) {
+  size_t count = 0;
+  for (int i = 0; i < kEntries && stats_.held && count < max; ++i) {
+    Entry& entry = entries_[i];
+    if (!entry.used || !entry.held) {
+      continue;
+    }
+    const attr_ingest_rule_t& rule = rule_for(entry.cluster, entry.attribute);
+    if (now_ms - entry.forwarded_ms < rule.min_interval_ms) {
+      continue;
+    }
+    entry.held = false;
+    stats_.held--;
+    attr_ingest_device_t* device = device_for(entry.network, entry.source.short_addr);
+    if (!significant(rule, entry.last, entry.pending)) {
+      stats_.filtered++;
+      if (device) {
+        device->filtered++;
+      }
+      continue;
+    }
+    forward(entry, entry.pending, now_ms, device);
+    out[count].network = entry.network;
+    out[count].report.source = entry.source;
+    out[count].report.attr = entry.last;
+    out[count].rx_ms = entry.held_ms;
+    count++;
+  }
+  return count;
+}
+
+void AttrFilter::reset_stats() {
+  const uint32_t held = stats_.held;
+  stats_ = {};
+  stats_.held = held;
+  device_count_ = 0;
+}
+
+void AttrFilter::fill_stats(attr_ingest_stats_t* out) const {
+  *out = stats_;
+  out->entries = 0;
+  for (const Entry& entry : entries_) {
+    out->entries += entry.used ? 1 : 0;
+  }
+  out->devices = static_cast<uint32_t>(device_count_);
+}
+
+AttrFilter::Entry* AttrFilter::find_or_claim(uint8_t network, const zb_attr_report_t& report, uint32_t now_ms,
+                                             bool* fresh) {
+  Entry* free_entry = nullptr;
+  Entry* idle = nullptr;  // least recently seen entry with nothing held
+  for (Entry& entry : entries_) {
+    if (!entry.used) {
+      if (!free_entry) {
+        free_entry = &entry;
+      }
+      continue;
+    }
+    if (entry.network == network && entry.source.short_addr == report.source.short_addr &&
+        entry.source.endpoint == report.source.endpoint && entry.cluster == report.attr.cluster &&
+        entry.attribute == report.attr.attribute) {
+      *fresh = false;
+      return &entry;
+    }
+    if (!entry.held && (!idle || now_ms - entry.seen_ms > now_ms - idle->seen_ms)) {
+      idle = &entry;
+    }
+  }
+  Entry* claimed = free_entry;
+  if (!claimed && idle) {
+    stats_.evictions++;
+    claimed = idle;
+  }
+  if (!claimed) {
+    return nullptr;
+  }
+  *claimed = {};
+  claimed->used = true;
+  claimed->source = report.source;
+  claimed->network = network;
+  claimed->cluster = report.attr.cluster;
+  claimed->attribute = report.attr.attribute;
+  *fresh = true;
+  return claimed;
+}
+
+attr_ingest_device_t* AttrFilter::device_for(uint8_t network, uint16_t short_addr) {
+  for (int i = 0; i < device_count_; ++i) {
+    if (devices_[i].network == network && devices_[i].short_addr == short_addr) {
+      return &devices_[i];
+    }
+  }
+  if (device_count_ == kDevices) {
+    return nullptr;  // counted in the totals only
+  }
+  attr_ingest_device_t& device = devices_[device_count_++];
+  device = {};
+  device.network = network;
+  device.short_addr = short_addr;
+  return &device;
+}
+
+void AttrFilter::forward(Entry& entry, const zb_rsp_read_attr_t& value, uint32_t now_ms,
+                         attr_ingest_device_t* device) {
+  entry.last = value;
+  entry.forwarded_ms = now_ms;
+  stats_.forwarded++;
+  if (device) {
+    device->forwarded++;
+  }
+}
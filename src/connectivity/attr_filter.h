@@ -0,0 +1,94 @@
+#ifndef ATTR_FILTER_H_
+#define ATTR_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "include/attr_ingest.h"
+#include "zb_command_schema.h"
+
+/*
+ * Per-attribute change filter in front of everything that consumes attribute reports.
+ * A fixed table keeps, per (network, device, endpoint, cluster, attribute), the last value that
+ * was forwarded and at most one held value. A report inside the rule's minimum interval is
+ * held, replacing any value held before it, and take_due() releases it when the interval
+ * closes if it is still significant. Idle attributes are evicted least recently seen first.
+ * Every report ends up forwarded, filtered or coalesced, per device as well as in total.
+ * offer() runs on the RX task and take_due() on the flush timer; both move entries between
+ * held and forwarded, so they and the rule and stats calls share one lock.
+ */
+class AttrFilter {
+ public:
+  static constexpr int kEntries = 64;
+  static constexpr int kRules = 16;
+  static constexpr int kDevices = 32;
+
+  enum class Verdict : uint8_t { kForward, kFiltered, kHeld };
+
+  struct Released {
+    uint8_t network;
+    zb_attr_report_t report;
+    uint32_t rx_ms;  // when the released value arrived
+  };
+
+  // The ANY/ANY rule is always present and applies when nothing more specific matches.
+  explicit AttrFilter(const attr_ingest_rule_t& fallback);
+
+  bool set_rule(const attr_ingest_rule_t& rule);
+  const attr_ingest_rule_t& rule_for(uint16_t cluster, uint16_t attribute) const;
+  int rule_count() const {
+    return rule_count_;
+  }
+  const attr_ingest_rule_t& rule(int index) const {
+    return rules_[index];
+  }
+
+  // network: the zb_devices network the report arrived from.
+  Verdict offer(uint8_t network, const zb_attr_report_t& report, uint32_t now_ms);
+  // Releases up to max held values whose interval has closed; returns how many were written.
+  size_t take_due(uint32_t now_ms, Released* out, size_t max);
+
+  void malformed_frame() {
+    stats_.malformed_frames++;
+  }
+  // Counters only; entries and rules are kept.
+  void reset_stats();
+  void fill_stats(attr_ingest_stats_t* out) const;
+  int device_count() const {
+    return device_count_;
+  }
+  const attr_ingest_device_t& device(int index) const {
+    return devices_[index];
+  }
+
+  static bool significant(const attr_ingest_rule_t& rule, const zb_rsp_read_attr_t& last,
+                          const zb_rsp_read_attr_t& next);
+
+ private:
+  struct Entry {
+    zb_cmd_target_t source;
+    uint8_t network;
+    bool used;
+    bool held;
+    uint16_t cluster;
+    uint16_t attribute;
+    uint32_t forwarded_ms;  // when `last` went out
+    uint32_t seen_ms;       // latest report, for eviction
+    uint32_t held_ms;       // when `pending` arrived
+    zb_rsp_read_attr_t last;
+    zb_rsp_read_attr_t pending;
+  };
+
+  Entry* find_or_claim(uint8_t network, const zb_attr_report_t& report, uint32_t now_ms, bool* fresh);
+  attr_ingest_device_t* device_for(uint8_t network, uint16_t short_addr);
+  void forward(Entry& entry, const zb_rsp_read_attr_t& value, uint32_t now_ms, attr_ingest_device_t* device);
+
+  Entry entries_[kEntries] = {};
+  attr_ingest_rule_t rules_[kRules] = {};
+  int rule_count_ = 0;
+  attr_ingest_device_t devices_[kDevices] = {};
+  int device_count_ = 0;
+  attr_ingest_stats_t stats_ = {};
+};
+
+#endif  // ATTR_FILTER_H_
@@ -0,0 +1,270 @@
+#include "include/attr_ingest.h"
+
+#include <cstring>
+
+#define DEBUG_TAG "ATTR"
+#include "../debug/include/debug/Debug.h"
+#include "attr_filter.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "include/uart_link.h"
+#include "include/zb_devices.h"
+#include "include/zigbee_manager.h"
+#include "sdkconfig.h"
+#include "uart_link_protocol.h"
+
+#if CONFIG_APP_ENABLE_UART_LINK
+
+#ifndef CONFIG_APP_ATTR_MIN_INTERVAL_MS
+#define CONFIG_APP_ATTR_MIN_INTERVAL_MS 1000
+#endif
+#ifndef CONFIG_APP_ATTR_MAX_INTERVAL_MS
+#define CONFIG_APP_ATTR_MAX_INTERVAL_MS 300000
+#endif
+#ifndef CONFIG_APP_ATTR_DEADBAND_PERMILLE
+#define CONFIG_APP_ATTR_DEADBAND_PERMILLE 0
+#endif
+
+namespace {
+const char* kTag = DEBUG_TAG;
+
+constexpr size_t kMaxSubscribers = 4;
+constexpr uint32_t kFlushTickMs = 100;  // granularity of the end of a minimum interval
+constexpr size_t kReleaseBatch = 8;
+
+constexpr attr_ingest_rule_t kFallbackRule = {
+    ATTR_INGEST_ANY,
+    ATTR_INGEST_ANY,
+    0,
+    CONFIG_APP_ATTR_DEADBAND_PERMILLE,
+    CONFIG_APP_ATTR_MIN_INTERVAL_MS,
+    CONFIG_APP_ATTR_MAX_INTERVAL_MS,
+};
+
+// Sensors known to report far finer than anything downstream acts on.
+constexpr attr_ingest_rule_t kBuiltinRules[] = {
+    {0x0402, 0x0000, 10, 0, CONFIG_APP_ATTR_MIN_INTERVAL_MS, CONFIG_APP_ATTR_MAX_INTERVAL_MS},  // temperature, 0.1 degC
+    {0x0405, 0x0000, 50, 0, CONFIG_APP_ATTR_MIN_INTERVAL_MS, CONFIG_APP_ATTR_MAX_INTERVAL_MS},  // humidity, 0.5 %RH
+    {0x0400, 0x0000, 1, 50, CONFIG_APP_ATTR_MIN_INTERVAL_MS, CONFIG_APP_ATTR_MAX_INTERVAL_MS},  // illuminance, 5%
+    {0x0702, 0x0400, 1, 20, CONFIG_APP_ATTR_MIN_INTERVAL_MS, CONFIG_APP_ATTR_MAX_INTERVAL_MS},  // instantaneous demand, 2%
+    {0x0B04, 0x050B, 1, 20, CONFIG_APP_ATTR_MIN_INTERVAL_MS, CONFIG_APP_ATTR_MAX_INTERVAL_MS},  // active power, 2%
+};
+
+struct Subscriber {
+  attr_ingest_cb_t cb;
+  void* ctx;
+};
+
+// Guards s_filter; the RX task offers reports, the flush timer releases them, the CLI reads.
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+AttrFilter s_filter(kFallbackRule);
+Subscriber s_subscribers[kMaxSubscribers] = {};  // written at startup only
+esp_timer_handle_t s_flush_timer = nullptr;
+
+void publish(uint8_t network, const zb_attr_report_t& report, int64_t rx_us) {
+  for (const Subscriber& subscriber : s_subscribers) {
+    if (subscriber.cb) {
+      subscriber.cb(network, &report, rx_us, subscriber.ctx);
+    }
+  }
+}
+
+// Reports from network: the uart_link index or ZB_DEVICES_NATIVE.
+void ingest(const uint8_t* payload, uint16_t len, uint8_t network) {
+  if (len == 0 || len % sizeof(zb_attr_report_t) != 0) {
+    portENTER_CRITICAL(&s_lock);
+    s_filter.malformed_frame();
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGW(kTag, "Malformed ATTR_UPDATE (%u bytes)", len);
+    return;
+  }
+  uart_link_stamp_t stamp;
+  const int64_t rx_us = uart_link_frame_stamp(&stamp) ? stamp.c6_rx_us : esp_timer_get_time();
+  const uint32_t now = static_cast<uint32_t>(rx_us / 1000);
+  for (uint16_t pos = 0; pos < len; pos += sizeof(zb_attr_report_t)) {
+    zb_attr_report_t report;
+    memcpy(&report, payload + pos, sizeof(report));
+    zb_devices_note(network, report.source.short_addr);
+    portENTER_CRITICAL(&s_lock);
+    const AttrFilter::Verdict verdict = s_filter.offer(network, report, now);
+    portEXIT_CRITICAL(&s_lock);
+    if (verdict == AttrFilter::Verdict::kForward) {
+      publish(network, report, rx_us);
+    }
+  }
+}
+
+void on_attr_frame(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  // Frame handlers run on the RX task of the link that delivered the frame.
+  const int link = uart_link_current();
+  ingest(payload, len, link >= 0 ? static_cast<uint8_t>(link) : UART_LINK_PRIMARY);
+}
+
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+void on_native_attr_frame(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  ingest(payload, len, ZB_DEVICES_NATIVE);
+}
+#endif
+
+void flush_tick(void*) {
+  AttrFilter::Released released[kReleaseBatch];
+  const int64_t now_us = esp_timer_get_time();
+  const uint32_t now = static_cast<uint32_t>(now_us / 1000);
+  size_t count;
+  do {
+    portENTER_CRITICAL(&s_lock);
+    count = s_filter.take_due(now, released, kReleaseBatch);
+    portEXIT_CRITICAL(&s_lock);
+    for (size_t i = 0; i < count; ++i) {
+      const int64_t rx_us = now_us - static_cast<int64_t>(now - released[i].rx_ms) * 1000;
+      publish(released[i].network, released[i].report, rx_us);
+    }
+  } while (count == kReleaseBatch);
+}
+
+}  // namespace
+
+esp_err_t attr_ingest_init(void) {
+  DEBUG_FUNC_ENTER();
+  portENTER_CRITICAL(&s_lock);
+  for (const attr_ingest_rule_t& rule : kBuiltinRules) {
+    s_filter.set_rule(rule);
+  }
+  portEXIT_CRITICAL(&s_lock);
+
+  const esp_timer_create_args_t flush_timer_args = {
+      .callback = &flush_tick,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "attr_flush",
+      .skip_unhandled_events = true,
+  };
+  esp_err_t err = esp_timer_create(&flush_timer_args, &s_flush_timer);
+  if (err == ESP_OK) {
+    err = esp_timer_start_periodic(s_flush_timer, kFlushTickMs * 1000);
+  }
+  if (err == ESP_OK) {
+    err = uart_link_register_frame_handler(UART_LINK_MSG_ATTR_UPDATE, on_attr_frame, nullptr);
+  }
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+  if (err == ESP_OK) {
+    err = zigbee_manager_register_frame_handler(UART_LINK_MSG_ATTR_UPDATE, on_native_attr_frame, nullptr);
+  }
+#endif
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+esp_err_t attr_ingest_subscribe(attr_ingest_cb_t cb, void* ctx) {
+  if (!cb) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (Subscriber& subscriber : s_subscribers) {
+    if (!subscriber.cb || subscriber.cb == cb) {
+      subscriber.ctx = ctx;
+      subscriber.cb = cb;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t attr_ingest_set_rule(const attr_ingest_rule_t* rule) {
+  if (!rule || (rule->max_interval_ms && rule->max_interval_ms < rule->min_interval_ms)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const bool stored = s_filter.set_rule(*rule);
+  portEXIT_CRITICAL(&s_lock);
+  return stored ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+size_t attr_ingest_get_rules(attr_ingest_rule_t* out_rules, size_t max_rules) {
+  if (!out_rules) {
+    return 0;
+  }
+  size_t count = 0;
+  portENTER_CRITICAL(&s_lock);
+  for (int i = 0; i < s_filter.rule_count() && count < max_rules; ++i) {
+    out_rules[count++] = s_filter.rule(i);
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return count;
+}
+
+void attr_ingest_get_stats(attr_ingest_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_filter.fill_stats(out_stats);
+  portEXIT_CRITICAL(&s_lock);
+}
+
+size_t attr_ingest_get_devices(attr_ingest_device_t* out_devices, size_t max_devices) {
+  if (!out_devices) {
+    return 0;
+  }
+  size_t count = 0;
+  portENTER_CRITICAL(&s_lock);
+  for (int i = 0; i < s_filter.device_count() && count < max_devices; ++i) {
+    out_devices[count++] = s_filter.device(i);
+  }
+  portEXIT_CRITICAL(&s_lock);
+  // Busiest first; a few dozen entries, outside the lock.
+  for (size_t i = 1; i < count; ++i) {
+    const attr_ingest_device_t device = out_devices[i];
+    size_t j = i;
+    for (; j > 0 && out_devices[j - 1].received < device.received; --j) {
+      out_devices[j] = out_devices[j - 1];
+    }
+    out_devices[j] = device;
+  }
+  return count;
+}
+
+void attr_ingest_reset_stats(void) {
+  portENTER_CRITICAL(&s_lock);
+  s_filter.reset_stats();
+  portEXIT_CRITICAL(&s_lock);
+}
+
+#else
+
+esp_err_t attr_ingest_init(void) {
+  return ESP_OK;
+}
+
+esp_err_t attr_ingest_subscribe(attr_ingest_cb_t cb, void* ctx) {
+  (void)cb;
+  (void)ctx;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t attr_ingest_set_rule(const attr_ingest_rule_t* rule) {
+  (void)rule;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+size_t attr_ingest_get_rules(attr_ingest_rule_t* out_rules, size_t max_rules) {
+  (void)out_rules;
+  (void)max_rules;
+  return 0;
+}
+
+void attr_ingest_get_stats(attr_ingest_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+size_t attr_ingest_get_devices(attr_ingest_device_t* out_devices, size_t max_devices) {
+  (void)out_devices;
+  (void)max_devices;
+  return 0;
+}
+
+void attr_ingest_reset_stats(void) {}
+
+#endif  // CONFIG_APP_ENABLE_UART_LINK
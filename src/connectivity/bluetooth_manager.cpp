@@ -1,11 +1,16 @@
 #include "bluetooth_manager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <string>
-#include <vector>
 
+#define DEBUG_TAG "BT_MGR"
+#include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/MemBudget.h"
+#include "../debug/include/debug/Pool.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
@@ -17,15 +22,51 @@
 #include "nimble/nimble_port_freertos.h"
 #include "services/gap/ble_svc_gap.h"
 
-static const char* TAG = "BT_MGR";
+static const char* TAG = DEBUG_TAG;
 
 struct DiscoveredDevice {
   ble_addr_t addr;
   int rssi;
-  char name[129];  // Max 128 + null terminator
+  char* name;  // from s_names, NULL until the device advertises one
 };
 
-static std::vector<DiscoveredDevice> discovered_devices;
+/* Fixed table so repeated scans never touch the heap; devices past it are only counted. */
+static const int kMaxDiscovered = 64;
+static const int kMaxName = 128;
+static DiscoveredDevice discovered_devices[kMaxDiscovered];
+static int discovered_count = 0;
+static int discovered_missed = 0;
+static int names_missed = 0;
+
+/* Names are taken per scan and all returned when the next one starts. Most are short, so size
+ * classes hold names for twice the devices in less RAM than a 129-byte array in each entry. */
+static debug::pool::FixedPool<16, 40> s_names_short("ble_name16");
+static debug::pool::FixedPool<48, 20> s_names_mid("ble_name48");
+static debug::pool::FixedPool<kMaxName + 1, 6> s_names_long("ble_name129");
+static debug::pool::Pool* const s_name_classes[] = {&s_names_short, &s_names_mid, &s_names_long};
+static debug::pool::PoolSet<3> s_names(s_name_classes);
+
+static char* copy_name(const char* name, int name_len) {
+  if (name_len > kMaxName) {
+    name_len = kMaxName;
+  }
+  char* copy = static_cast<char*>(s_names.allocate(name_len + 1));
+  if (!copy) {
+    names_missed++;
+    return NULL;
+  }
+  memcpy(copy, name, name_len);
+  copy[name_len] = '\0';
+  return copy;
+}
+
+/* Scan parameters for the next scan; all zero is the controller's default active scan. */
+static bluetooth_scan_params_t s_scan_params = {};
+static std::atomic<uint32_t> s_adverts{0};
+/* Scan time: finished scans in s_scan_ms, the running one since s_scan_start_us (0 when idle). */
+static portMUX_TYPE s_scan_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_scan_ms = 0;
+static int64_t s_scan_start_us = 0;
 
 static int ble_gap_event(struct ble_gap_event* event, void* arg);
 
@@ -59,16 +100,21 @@ esp_err_t bluetooth_manager_init(void) {
   ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
 
   nimble_port_freertos_init(host_task);
+  mem_budget_charge(MEM_BUDGET_NET, MEM_BUDGET_BUFFER,
+                    sizeof(discovered_devices) + sizeof(s_names_short) + sizeof(s_names_mid) + sizeof(s_names_long),
+                    false);
 
   return ESP_OK;
 }
 
 static int ble_gap_event(struct ble_gap_event* event, void* arg) {
+  DEBUG_PROFILE();
   struct ble_hs_adv_fields adv_fields;
   int rc;
 
   switch (event->type) {
     case BLE_GAP_EVENT_DISC: {
+      s_adverts.fetch_add(1, std::memory_order_relaxed);
       const char* name = NULL;
       int name_len = 0;
       const int MAX_NAME_PRINT = 128;
@@ -121,48 +167,56 @@ static int ble_gap_event(struct ble_gap_event* event, void* arg) {
 
       /* Update or Add to Discovered Devices List */
       bool found = false;
-      for (auto& device : discovered_devices) {
+      for (int i = 0; i < discovered_count; i++) {
+        DiscoveredDevice& device = discovered_devices[i];
         if (memcmp(device.addr.val, event->disc.addr.val, 6) == 0) {
           found = true;
           device.rssi = event->disc.rssi;  // Update RSSI to latest
 
-          // If we found a name and the stored one is empty, update it
-          if (name != NULL && name_len > 0 && strlen(device.name) == 0) {
-            int copy_len = (name_len > 128) ? 128 : name_len;
-            memcpy(device.name, name, copy_len);
-            device.name[copy_len] = '\0';
+          // If we found a name and none is stored yet, keep it
+          if (name != NULL && name_len > 0 && device.name == NULL) {
+            device.name = copy_name(name, name_len);
           }
           break;
         }
       }
 
-      if (!found) {
-        DiscoveredDevice new_device;
+      if (!found && discovered_count == kMaxDiscovered) {
+        discovered_missed++;
+      } else if (!found) {
+        DiscoveredDevice& new_device = discovered_devices[discovered_count++];
         new_device.addr = event->disc.addr;
         new_device.rssi = event->disc.rssi;
-        memset(new_device.name, 0, sizeof(new_device.name));
-        if (name != NULL && name_len > 0) {
-          int copy_len = (name_len > 128) ? 128 : name_len;
-          memcpy(new_device.name, name, copy_len);
-          new_device.name[copy_len] = '\0';
-        }
-        discovered_devices.push_back(new_device);
+        new_device.name = (name != NULL && name_len > 0) ? copy_name(name, name_len) : NULL;
       }
       return 0;
     }
 
     case BLE_GAP_EVENT_DISC_COMPLETE:
-      ESP_LOGI(TAG, "BLE Scan complete. Found %d unique devices:", discovered_devices.size());
+      portENTER_CRITICAL(&s_scan_lock);
+      if (s_scan_start_us) {
+        s_scan_ms += static_cast<uint32_t>((esp_timer_get_time() - s_scan_start_us) / 1000);
+        s_scan_start_us = 0;
+      }
+      portEXIT_CRITICAL(&s_scan_lock);
+      ESP_LOGI(TAG, "BLE Scan complete. Found %d unique devices:", discovered_count + discovered_missed);
       ESP_LOGI(TAG, "----------------------------------------------------------------");
       ESP_LOGI(TAG, "%-20s | %-5s | %s", "Address", "RSSI", "Name");
       ESP_LOGI(TAG, "----------------------------------------------------------------");
 
-      for (const auto& device : discovered_devices) {
-        const char* display_name = (strlen(device.name) > 0) ? device.name : "(Unknown)";
+      for (int i = 0; i < discovered_count; i++) {
+        const DiscoveredDevice& device = discovered_devices[i];
+        const char* display_name = device.name ? device.name : "(Unknown)";
         ESP_LOGI(TAG, "%02x:%02x:%02x:%02x:%02x:%02x   | %-5d | %s", device.addr.val[5], device.addr.val[4],
                  device.addr.val[3], device.addr.val[2], device.addr.val[1], device.addr.val[0], device.rssi,
                  display_name);
       }
+      if (discovered_missed > 0) {
+        ESP_LOGI(TAG, "(%d more not kept)", discovered_missed);
+      }
+      if (names_missed > 0) {
+        ESP_LOGI(TAG, "(%d names not kept; see 'pool')", names_missed);
+      }
       ESP_LOGI(TAG, "----------------------------------------------------------------");
       return 0;
 
@@ -181,22 +235,66 @@ esp_err_t bluetooth_manager_start_scan(int duration_sec) {
     return ESP_FAIL;
   }
 
+  // Interval and window are in 0.625 ms units; 0 leaves the controller default.
   disc_params.filter_duplicates = 0;  // Disable duplicate filtering to see all packets
-  disc_params.passive = 0;            // Active scanning
-  disc_params.itvl = 0;               // Default interval
-  disc_params.window = 0;             // Default window
+  disc_params.passive = s_scan_params.passive ? 1 : 0;
+  disc_params.itvl = static_cast<uint16_t>(s_scan_params.interval_ms * 8 / 5);
+  disc_params.window = static_cast<uint16_t>(s_scan_params.window_ms * 8 / 5);
   disc_params.filter_policy = 0;
   disc_params.limited = 0;
 
-  ESP_LOGI(TAG, "Starting BLE scan for %d seconds...", duration_sec);
+  ESP_LOGI(TAG, "Starting %s BLE scan for %d seconds (interval %u ms, window %u ms)...",
+           s_scan_params.passive ? "passive" : "active", duration_sec, s_scan_params.interval_ms,
+           s_scan_params.window_ms);
+
+  // The callback owns the table while a scan runs.
+  if (ble_gap_disc_active()) {
+    ESP_LOGW(TAG, "A scan is already running");
+    return ESP_ERR_INVALID_STATE;
+  }
 
   // Clear previous results
-  discovered_devices.clear();
+  for (int i = 0; i < discovered_count; i++) {
+    s_names.deallocate(discovered_devices[i].name);
+  }
+  discovered_count = 0;
+  discovered_missed = 0;
+  names_missed = 0;
 
   rc = ble_gap_disc(0, duration_sec * 1000, &disc_params, ble_gap_event, NULL);
   if (rc != 0) {
     ESP_LOGE(TAG, "Failed to start scan (rc=%d)", rc);
     return ESP_FAIL;
   }
+  portENTER_CRITICAL(&s_scan_lock);
+  s_scan_start_us = esp_timer_get_time();
+  portEXIT_CRITICAL(&s_scan_lock);
   return ESP_OK;
 }
+
+esp_err_t bluetooth_manager_set_scan_params(const bluetooth_scan_params_t* params) {
+  if (!params) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const bool is_default = params->interval_ms == 0 && params->window_ms == 0;
+  if (!is_default && (params->interval_ms < 3 || params->interval_ms > 10240 || params->window_ms < 3 ||
+                      params->window_ms > params->interval_ms)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  s_scan_params = *params;
+  return ESP_OK;
+}
+
+void bluetooth_manager_get_scan_stats(bluetooth_scan_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  out_stats->adverts = s_adverts.load(std::memory_order_relaxed);
+  portENTER_CRITICAL(&s_scan_lock);
+  out_stats->scanning = s_scan_start_us != 0;
+  out_stats->scan_ms = s_scan_ms;
+  if (s_scan_start_us) {
+    out_stats->scan_ms += static_cast<uint32_t>((esp_timer_get_time() - s_scan_start_us) / 1000);
+  }
+  portEXIT_CRITICAL(&s_scan_lock);
+}
@@ -0,0 +1,103 @@
+#include "clock_sync.h"
+
+bool ClockSync::add_sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+  const int64_t delay = (t4 - t1) - (t3 - t2);
+  if (t4 < t1 || t3 < t2 || delay < 0 || delay > kMaxDelayUs) {
+    rejected_++;
+    return false;
+  }
+  samples_++;
+  // Midpoint of the two legs: exact when they are symmetric, off by half the asymmetry otherwise.
+  const Sample sample = {((t2 - t1) + (t3 - t4)) / 2, t4, static_cast<uint32_t>(delay)};
+  if (!estimate_.valid) {
+    // First exchange: usable straight away, refined as the window fills.
+    estimate_ = {true, sample.offset_us, sample.at_us, 0, sample.delay_us};
+  }
+  window_[window_count_++] = sample;
+  if (window_count_ < kWindow) {
+    return true;
+  }
+  const Sample* best = &window_[0];
+  for (int i = 1; i < kWindow; ++i) {
+    if (window_[i].delay_us < best->delay_us) {
+      best = &window_[i];
+    }
+  }
+  window_count_ = 0;
+  add_point(*best);
+  return true;
+}
+
+void ClockSync::add_point(const Sample& point) {
+  if (point_count_ > 0) {
+    const int64_t error = point.offset_us - offset_at(point.at_us);
+    if (error > kJumpUs || error < -kJumpUs) {
+      jumps_++;
+      point_count_ = 0;
+      point_next_ = 0;
+      estimate_.drift_ppb = 0;
+    }
+  }
+  points_[point_next_] = point;
+  point_next_ = (point_next_ + 1) % kPoints;
+  if (point_count_ < kPoints) {
+    point_count_++;
+  }
+  fit();
+}
+
+void ClockSync::fit() {
+  const Sample& latest = points_[(point_next_ + kPoints - 1) % kPoints];
+  estimate_.valid = true;
+  estimate_.delay_us = latest.delay_us;
+  if (point_count_ < 3) {
+    estimate_.offset_us = latest.offset_us;
+    estimate_.at_us = latest.at_us;
+    return;
+  }
+  // Least squares around the latest point; runs once per kWindow exchanges, so doubles are fine.
+  double st = 0, so = 0, stt = 0, sto = 0;
+  for (int i = 0; i < point_count_; ++i) {
+    const double t = static_cast<double>(points_[i].at_us - latest.at_us);
+    const double o = static_cast<double>(points_[i].offset_us - latest.offset_us);
+    st += t;
+    so += o;
+    stt += t * t;
+    sto += t * o;
+  }
+  const double n = point_count_;
+  const double denom = n * stt - st * st;
+  if (denom <= 0) {
+    return;
+  }
+  const double slope = (n * sto - st * so) / denom;
+  const double intercept = (so - slope * st) / n;  // fitted offset at the latest point
+  double ppb = slope * 1e9;
+  if (ppb > kMaxDriftPpb) {
+    ppb = kMaxDriftPpb;
+  } else if (ppb < -kMaxDriftPpb) {
+    ppb = -kMaxDriftPpb;
+  }
+  estimate_.drift_ppb = static_cast<int32_t>(ppb);
+  estimate_.offset_us = latest.offset_us + static_cast<int64_t>(intercept);
+  estimate_.at_us = latest.at_us;
+}
+
+void ClockSync::reset() {
+  *this = ClockSync();
+}
+
+int64_t ClockSync::offset_at(int64_t now_us) const {
+  if (!estimate_.valid) {
+    return 0;
+  }
+  return estimate_.offset_us + (now_us - estimate_.at_us) * estimate_.drift_ppb / 1000000000;
+}
+
+int64_t ClockSync::remote32_to_local(uint32_t remote_us, int64_t now_us) const {
+  const int64_t offset = offset_at(now_us);
+  const int64_t remote_now = now_us + offset;
+  // The stamp is at most a few seconds old, so it lies within 2^31 us before remote_now.
+  const int32_t age = static_cast<int32_t>(static_cast<uint32_t>(remote_now) - remote_us);
+  return now_us - age;
+}
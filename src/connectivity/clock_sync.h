@@ -0,0 +1,108 @@
+#ifndef CLOCK_SYNC_H_
+#define CLOCK_SYNC_H_
+
+#include <cstdint>
+
+// Marks a heartbeat payload as a clock sync request or reply rather than free text.
+#ifndef UART_LINK_HEARTBEAT_CLOCK_SYNC
+#define UART_LINK_HEARTBEAT_CLOCK_SYNC 0xC5
+#endif
+#ifndef UART_LINK_HANDSHAKE_FLAG_CLOCK_SYNC
+#define UART_LINK_HANDSHAKE_FLAG_CLOCK_SYNC 0x10  // peer answers sync heartbeats and may send STAMPED frames
+#endif
+#ifndef UART_LINK_MSG_STAMPED
+#define UART_LINK_MSG_STAMPED 0x42  // H2 -> C6: StampHeader, then the payload of `type`
+#endif
+
+namespace clock_wire {
+
+// Heartbeat payload while clock sync is negotiated; times are esp_timer microseconds. The C6 sends
+// t1 with t2/t3 zero and the H2 replies with t1 echoed, t2 when the request arrived and t3 when
+// the reply left. Request and reply are the same size so both legs take the same wire time.
+struct __attribute__((packed)) Sync {
+  uint8_t marker;  // UART_LINK_HEARTBEAT_CLOCK_SYNC
+  uint64_t t1_us;  // C6 clock
+  uint64_t t2_us;  // H2 clock
+  uint64_t t3_us;  // H2 clock
+};
+
+// H2 clock (low 32 bits) at its input and output for what the frame reports. Events: the Zigbee
+// frame arrived (rx) and the report was written to the UART (tx). ZB_RESPONSE: the request came
+// off the UART (rx) and the command went out over the air (tx).
+struct __attribute__((packed)) StampHeader {
+  uint8_t type;
+  uint32_t rx_us;
+  uint32_t tx_us;
+};
+
+}  // namespace clock_wire
+
+/*
+ * NTP-style offset and drift estimate between the C6 clock (local) and the H2 clock
+ * (remote) from request/reply exchanges. Each exchange gives an offset whose error is at
+ * most half its round trip. Of every kWindow exchanges the one with the shortest round
+ * trip is trusted, which filters out those delayed by queueing on either side, and a
+ * least-squares line through the last kPoints trusted offsets gives the drift. A trusted
+ * offset far off that line means a clock jumped (the H2 restarted) and the estimate
+ * starts over. Pure logic; the caller supplies the timestamps and the locking.
+ */
+class ClockSync {
+ public:
+  static constexpr int kWindow = 8;
+  static constexpr int kPoints = 16;
+  static constexpr int64_t kMaxDelayUs = 500000;   // slower exchanges are useless
+  static constexpr int64_t kJumpUs = 20000;        // trusted offset this far off the line: clock jumped
+  static constexpr int32_t kMaxDriftPpb = 500000;  // 500 ppm; crystals are within 50
+
+  struct Estimate {
+    bool valid;
+    int64_t offset_us;  // remote minus local, at local time `at_us`
+    int64_t at_us;
+    int32_t drift_ppb;  // remote clock rate relative to local; 0 until three trusted points
+    uint32_t delay_us;  // round trip of the latest trusted sample; the offset error is at most half
+  };
+
+  // t1/t4 local, t2/t3 remote. Returns false if the exchange was rejected.
+  bool add_sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+  void reset();
+
+  // Remote minus local at local time now_us, drift applied.
+  int64_t offset_at(int64_t now_us) const;
+  // Local time of a recent remote timestamp given by its low 32 bits.
+  int64_t remote32_to_local(uint32_t remote_us, int64_t now_us) const;
+
+  const Estimate& estimate() const {
+    return estimate_;
+  }
+  uint32_t samples() const {
+    return samples_;
+  }
+  uint32_t rejected() const {
+    return rejected_;
+  }
+  uint32_t jumps() const {
+    return jumps_;
+  }
+
+ private:
+  struct Sample {
+    int64_t offset_us;
+    int64_t at_us;
+    uint32_t delay_us;
+  };
+
+  void add_point(const Sample& point);
+  void fit();
+
+  Sample window_[kWindow] = {};
+  int window_count_ = 0;
+  Sample points_[kPoints] = {};
+  int point_count_ = 0;
+  int point_next_ = 0;
+  Estimate estimate_ = {};
+  uint32_t samples_ = 0;
+  uint32_t rejected_ = 0;
+  uint32_t jumps_ = 0;
+};
+
+#endif  // CLOCK_SYNC_H_
@@ -0,0 +1,247 @@
+#include "cmd_stager.h"
+
+#include <cstring>
+
+void CommandStager::configure(uint16_t rate_per_s, uint8_t burst) {
+  rate_per_s_ = rate_per_s ? rate_per_s : 1;
+  burst_ = burst ? burst : 1;
+  for (Device& device : devices_) {
+    if (device.used && device.tokens_milli > burst_ * 1000u) {
+      device.tokens_milli = burst_ * 1000u;
+    }
+  }
+}
+
+bool CommandStager::target_of(uint8_t command, const void* request, uint16_t len, zb_cmd_target_t* target) {
+  switch (command) {
+    case ZB_CMD_ON_OFF:
+    case ZB_CMD_LEVEL:
+    case ZB_CMD_COLOR:
+    case ZB_CMD_READ_ATTR:
+      break;
+    default:
+      return false;
+  }
+  if (len != zb_cmd_request_size(command)) {
+    return false;
+  }
+  // Every request addressed by short address starts with its target.
+  memcpy(target, request, sizeof(*target));
+  return true;
+}
+
+bool CommandStager::mergeable(uint8_t command, const void* request, uint16_t len, zb_cmd_target_t* target) {
+  if (command == ZB_CMD_READ_ATTR || !target_of(command, request, len, target)) {
+    return false;
+  }
+  if (command == ZB_CMD_ON_OFF) {
+    zb_cmd_on_off_t on_off;
+    memcpy(&on_off, request, sizeof(on_off));
+    return on_off.action != ZB_ON_OFF_TOGGLE;  // two toggles are not one
+  }
+  return true;
+}
+
+CommandStager::Verdict CommandStager::offer(uint8_t network, uint8_t command, const void* request, uint16_t len,
+                                            uint32_t now_ms) {
+  stats_.offered++;
+  zb_cmd_target_t target;
+  if (!mergeable(command, request, len, &target)) {
+    stats_.bypassed++;
+    const bool addressed = target_of(command, request, len, &target);
+    return addressed && has_staged(network, target.short_addr) ? Verdict::kFlushFirst : Verdict::kSendNow;
+  }
+  if (Slot* slot = find(network, command, target)) {
+    // The superseded command never goes out, so the slot now holds a command that arrived now.
+    memcpy(slot->command.body, request, len);
+    slot->command.staged_ms = now_ms;
+    stats_.coalesced++;
+    return Verdict::kCoalesced;
+  }
+  Device* device = device_for(network, target.short_addr, now_ms);
+  if (!device) {
+    stats_.bypassed++;
+    return Verdict::kSendNow;
+  }
+  refill(*device, now_ms);
+  const bool has_token = device->tokens_milli >= 1000;
+  if (has_token && !has_staged(network, target.short_addr)) {
+    device->tokens_milli -= 1000;
+    stats_.sent_now++;
+    return Verdict::kSendNow;
+  }
+  for (Slot& slot : slots_) {
+    if (slot.used) {
+      continue;
+    }
+    slot.used = true;
+    slot.target = target;
+    slot.command.network = network;
+    slot.command.command = command;
+    slot.command.len = len;
+    memcpy(slot.command.body, request, len);
+    slot.command.staged_ms = now_ms;
+    return Verdict::kStaged;
+  }
+  // No room to stage: limit nothing rather than drop a command.
+  if (has_token) {
+    device->tokens_milli -= 1000;
+  }
+  stats_.bypassed++;
+  return has_staged(network, target.short_addr) ? Verdict::kFlushFirst : Verdict::kSendNow;
+}
+
+size_t CommandStager::take_due(uint32_t now_ms, Command* out, size_t max) {
+  size_t count = 0;
+  while (count < max) {
+    Slot* oldest = nullptr;
+    Device* oldest_device = nullptr;
+    for (Slot& slot : slots_) {
+      if (!slot.used || (oldest && now_ms - slot.command.staged_ms <= now_ms - oldest->command.staged_ms)) {
+        continue;
+      }
+      Device* device = device_for(slot.command.network, slot.target.short_addr, now_ms);
+      if (!device) {
+        continue;
+      }
+      refill(*device, now_ms);
+      if (device->tokens_milli >= 1000) {
+        oldest = &slot;
+        oldest_device = device;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+    oldest_device->tokens_milli -= 1000;
+    oldest->used = false;
+    out[count++] = oldest->command;
+    released(oldest->command, now_ms);
+  }
+  return count;
+}
+
+size_t CommandStager::take_device(uint8_t network, uint16_t short_addr, uint32_t now_ms, Command* out, size_t max) {
+  Device* device = device_for(network, short_addr, now_ms);
+  if (device) {
+    refill(*device, now_ms);
+  }
+  size_t count = 0;
+  while (count < max) {
+    Slot* oldest = nullptr;
+    for (Slot& slot : slots_) {
+      if (slot.used && slot.command.network == network && slot.target.short_addr == short_addr &&
+          (!oldest || now_ms - slot.command.staged_ms > now_ms - oldest->command.staged_ms)) {
+        oldest = &slot;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+    // Spends what the bucket holds; the device's next commands wait for it to refill.
+    if (device) {
+      device->tokens_milli -= device->tokens_milli < 1000 ? device->tokens_milli : 1000;
+    }
+    oldest->used = false;
+    out[count++] = oldest->command;
+    released(oldest->command, now_ms);
+    stats_.flushed++;
+  }
+  return count;
+}
+
+bool CommandStager::restage(const Command& command) {
+  zb_cmd_target_t target;
+  if (!mergeable(command.command, command.body, command.len, &target)) {
+    return false;
+  }
+  stats_.restaged++;
+  if (find(command.network, command.command, target)) {
+    stats_.coalesced++;  // a newer value for the same target is already waiting
+    return true;
+  }
+  for (Slot& slot : slots_) {
+    if (!slot.used) {
+      slot.used = true;
+      slot.target = target;
+      slot.command = command;  // keeps staged_ms, so it goes out before anything staged later
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t CommandStager::staged() const {
+  size_t count = 0;
+  for (const Slot& slot : slots_) {
+    count += slot.used ? 1 : 0;
+  }
+  return count;
+}
+
+CommandStager::Device* CommandStager::device_for(uint8_t network, uint16_t short_addr, uint32_t now_ms) {
+  Device* free_device = nullptr;
+  Device* idle = nullptr;  // longest untouched device with nothing staged
+  for (Device& device : devices_) {
+    if (!device.used) {
+      if (!free_device) {
+        free_device = &device;
+      }
+      continue;
+    }
+    if (device.network == network && device.short_addr == short_addr) {
+      return &device;
+    }
+    if (!has_staged(device.network, device.short_addr) &&
+        (!idle || now_ms - device.refill_ms > now_ms - idle->refill_ms)) {
+      idle = &device;
+    }
+  }
+  Device* claimed = free_device ? free_device : idle;
+  if (!claimed) {
+    return nullptr;
+  }
+  // An evicted device is forgotten with whatever tokens it had; it starts over with a full bucket.
+  claimed->used = true;
+  claimed->network = network;
+  claimed->short_addr = short_addr;
+  claimed->tokens_milli = burst_ * 1000u;
+  claimed->refill_ms = now_ms;
+  return claimed;
+}
+
+void CommandStager::refill(Device& device, uint32_t now_ms) const {
+  // rate_per_s_ tokens per second is rate_per_s_ thousandths per millisecond.
+  const uint64_t tokens = device.tokens_milli + static_cast<uint64_t>(now_ms - device.refill_ms) * rate_per_s_;
+  const uint32_t cap = burst_ * 1000u;
+  device.tokens_milli = tokens > cap ? cap : static_cast<uint32_t>(tokens);
+  device.refill_ms = now_ms;
+}
+
+CommandStager::Slot* CommandStager::find(uint8_t network, uint8_t command, const zb_cmd_target_t& target) {
+  for (Slot& slot : slots_) {
+    if (slot.used && slot.command.network == network && slot.command.command == command &&
+        slot.target.short_addr == target.short_addr && slot.target.endpoint == target.endpoint) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+void CommandStager::released(const Command& command, uint32_t now_ms) {
+  const uint32_t delay_ms = now_ms - command.staged_ms;
+  stats_.deferred++;
+  stats_.total_delay_ms += delay_ms;
+  if (delay_ms > stats_.max_delay_ms) {
+    stats_.max_delay_ms = delay_ms;
+  }
+}
+
+bool CommandStager::has_staged(uint8_t network, uint16_t short_addr) const {
+  for (const Slot& slot : slots_) {
+    if (slot.used && slot.command.network == network && slot.target.short_addr == short_addr) {
+      return true;
+    }
+  }
+  return false;
+}
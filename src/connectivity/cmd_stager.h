@@ -0,0 +1,113 @@
+#ifndef CMD_STAGER_H_
+#define CMD_STAGER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "zb_command_schema.h"
+
+/*
+ * Staging area for outbound device commands. Each device, a short address on one network,
+ * gets a token bucket; a command goes out at once while its device has a token and nothing
+ * staged, otherwise it waits in a fixed set of slots. A newer command for the same device,
+ * endpoint and command id replaces the staged one (latest wins) and, like any new arrival,
+ * goes to the back of the line. take_due() releases staged commands oldest first as tokens
+ * come back. Only absolute commands merge: level, colour and on/off. A toggle, bind or read
+ * is never delayed, and neither is anything that finds the slots or the device table full;
+ * when such a command addresses a device with commands staged, those are flushed ahead of
+ * it so a device sees its commands in arrival order. Keeping that order across the send is
+ * the caller's job: the commands take_due() and take_device() hand back must reach the link
+ * before the next offer() for the same device does.
+ */
+class CommandStager {
+ public:
+  static constexpr int kSlots = 16;
+  static constexpr int kDevices = 16;
+
+  enum class Verdict : uint8_t {
+    kSendNow,    // send it; a token was taken if the device had one
+    kStaged,     // queued until the device's bucket refills
+    kCoalesced,  // replaced a staged command for the same target
+    kFlushFirst,  // send it, but only after take_device() has released the device's staged commands
+  };
+
+  struct Command {
+    uint8_t network;  // zb_devices network the command goes to
+    uint8_t command;
+    uint16_t len;
+    uint8_t body[sizeof(zb_cmd_any_request_t)];
+    uint32_t staged_ms;  // arrival of the command in the slot
+  };
+
+  struct Stats {
+    uint32_t offered;
+    uint32_t sent_now;
+    uint32_t deferred;   // released by take_due() or take_device()
+    uint32_t flushed;    // of those, released early by take_device()
+    uint32_t coalesced;  // superseded before they went out
+    uint32_t bypassed;   // not mergeable, or no room; sent at once
+    uint32_t restaged;   // handed back by restage() after a failed send
+    uint64_t total_delay_ms;  // of deferred commands, from staged_ms
+    uint32_t max_delay_ms;
+  };
+
+  // rate_per_s commands per second per device, bursts of up to burst.
+  void configure(uint16_t rate_per_s, uint8_t burst);
+  uint16_t rate_per_s() const {
+    return rate_per_s_;
+  }
+  uint8_t burst() const {
+    return burst_;
+  }
+
+  Verdict offer(uint8_t network, uint8_t command, const void* request, uint16_t len, uint32_t now_ms);
+  // Releases up to max staged commands whose device has a token; returns how many were written.
+  size_t take_due(uint32_t now_ms, Command* out, size_t max);
+  // After kFlushFirst: releases the device's staged commands oldest first, tokens or not.
+  size_t take_device(uint8_t network, uint16_t short_addr, uint32_t now_ms, Command* out, size_t max);
+  // A released command the caller could not send goes back ahead of anything staged after it,
+  // unless a newer command for the same target has been staged meanwhile. False if no slot is free.
+  bool restage(const Command& command);
+  size_t staged() const;
+
+  const Stats& stats() const {
+    return stats_;
+  }
+  void reset_stats() {
+    stats_ = {};
+  }
+
+  // Target device of a mergeable command; false for anything that must not be merged.
+  static bool mergeable(uint8_t command, const void* request, uint16_t len, zb_cmd_target_t* target);
+  // Target device of any command addressed by short address; false for SET_MODE and BIND.
+  static bool target_of(uint8_t command, const void* request, uint16_t len, zb_cmd_target_t* target);
+
+ private:
+  struct Slot {
+    bool used;
+    zb_cmd_target_t target;
+    Command command;
+  };
+
+  struct Device {
+    bool used;
+    uint8_t network;
+    uint16_t short_addr;
+    uint32_t tokens_milli;  // thousandths of a command
+    uint32_t refill_ms;     // last refill
+  };
+
+  Device* device_for(uint8_t network, uint16_t short_addr, uint32_t now_ms);
+  void refill(Device& device, uint32_t now_ms) const;
+  bool has_staged(uint8_t network, uint16_t short_addr) const;
+  Slot* find(uint8_t network, uint8_t command, const zb_cmd_target_t& target);
+  void released(const Command& command, uint32_t now_ms);
+
+  Slot slots_[kSlots] = {};
+  Device devices_[kDevices] = {};
+  uint16_t rate_per_s_ = 5;
+  uint8_t burst_ = 3;
+  Stats stats_ = {};
+};
+
+#endif  // CMD_STAGER_H_
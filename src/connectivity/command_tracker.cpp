@@ -0,0 +1,100 @@
+#include "command_tracker.h"
+
+#include <cstring>
+
+int CommandTracker::open(uint8_t command, uint32_t now_us, zb_cmd_header_t* header, bool detached) {
+  int free_slot = -1;
+  for (int i = 0; i < kSlots && free_slot < 0; ++i) {
+    if (slots_[i].state == State::kFree) {
+      free_slot = i;
+    }
+  }
+  for (int i = 0; i < kSlots && free_slot < 0; ++i) {
+    const Slot& slot = slots_[i];
+    if (slot.state == State::kPending && slot.detached && now_us - slot.sent_us >= kDetachedTimeoutUs) {
+      fail(i, ZB_CMD_STATUS_TIMEOUT, now_us);  // nobody waits for it; frees the slot
+      free_slot = i;
+    }
+  }
+  if (free_slot < 0) {
+    stats_.no_slot++;
+    return -1;
+  }
+  Slot& slot = slots_[free_slot];
+  slot.state = State::kPending;
+  slot.detached = detached;
+  slot.header = {command, 0, next_request_id_++};
+  if (next_request_id_ == 0) {
+    next_request_id_ = 1;  // 0 never goes on the wire, so a zeroed response cannot match
+  }
+  slot.sent_us = now_us;
+  slot.result = {};
+  *header = slot.header;
+  stats_.sent++;
+  return free_slot;
+}
+
+int CommandTracker::on_response(const uint8_t* payload, uint16_t len, uint32_t now_us) {
+  zb_rsp_header_t header;
+  if (!payload || len < sizeof(header) || len - sizeof(header) > sizeof(zb_cmd_any_response_t)) {
+    stats_.malformed++;
+    return -1;
+  }
+  memcpy(&header, payload, sizeof(header));
+  for (int i = 0; i < kSlots; ++i) {
+    Slot& slot = slots_[i];
+    if (slot.state != State::kPending || slot.header.request_id != header.request_id) {
+      continue;
+    }
+    if (slot.header.command != header.command) {
+      stats_.malformed++;
+      return -1;
+    }
+    const uint16_t body_len = static_cast<uint16_t>(len - sizeof(header));
+    memcpy(slot.body, payload + sizeof(header), body_len);
+    slot.result.detail = header.detail;
+    slot.result.length = body_len;
+    finish(slot, header.status, now_us);
+    stats_.completed++;
+    stats_.last_round_trip_us = slot.result.round_trip_us;
+    stats_.total_round_trip_us += slot.result.round_trip_us;
+    if (slot.result.round_trip_us > stats_.max_round_trip_us) {
+      stats_.max_round_trip_us = slot.result.round_trip_us;
+    }
+    return i;
+  }
+  stats_.late++;
+  return -1;
+}
+
+bool CommandTracker::fail(int slot, uint8_t status, uint32_t now_us) {
+  if (!valid(slot) || slots_[slot].state != State::kPending) {
+    return false;
+  }
+  slots_[slot].result.length = 0;
+  finish(slots_[slot], status, now_us);
+  stats_.failed++;
+  return true;
+}
+
+uint32_t CommandTracker::fail_all(uint8_t status, uint32_t now_us) {
+  uint32_t completed = 0;
+  for (int i = 0; i < kSlots; ++i) {
+    if (fail(i, status, now_us) && slots_[i].state == State::kDone) {
+      completed |= 1u << i;
+    }
+  }
+  return completed;
+}
+
+void CommandTracker::release(int slot) {
+  if (valid(slot)) {
+    slots_[slot].state = State::kFree;
+  }
+}
+
+void CommandTracker::finish(Slot& slot, uint8_t status, uint32_t now_us) {
+  slot.state = slot.detached ? State::kFree : State::kDone;
+  slot.result.status = status;
+  slot.result.round_trip_us = now_us - slot.sent_us;
+}
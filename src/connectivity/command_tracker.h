@@ -0,0 +1,95 @@
+#ifndef COMMAND_TRACKER_H_
+#define COMMAND_TRACKER_H_
+
+#include <cstdint>
+
+#include "zb_command_schema.h"
+
+/*
+ * Correlates typed command responses with the requests waiting for them. A fixed set of
+ * slots, each holding one outstanding request until its owner releases it; request ids
+ * keep counting across slots, so a late response for a released request matches nothing.
+ * Detached requests have no owner: their slot frees itself when the request completes, and
+ * open() reclaims one that has gone unanswered for kDetachedTimeoutUs. Responses complete
+ * slots from the RX tasks while senders open, wait on and release them, so every call,
+ * the const ones included, goes under the caller's one lock.
+ */
+class CommandTracker {
+ public:
+  static constexpr int kSlots = 8;
+  static constexpr uint32_t kDetachedTimeoutUs = 2000000;
+
+  enum class State : uint8_t { kFree, kPending, kDone };
+
+  struct Result {
+    uint8_t status;  // zb_cmd_status_t
+    uint8_t detail;
+    uint16_t length;  // response body bytes
+    uint32_t round_trip_us;
+  };
+
+  struct Stats {
+    uint32_t sent;
+    uint32_t completed;       // responses matched to a request
+    uint32_t failed;          // completed locally: timeout or link down
+    uint32_t late;            // responses for a request nobody waits for any more
+    uint32_t malformed;
+    uint32_t no_slot;         // open() with every slot in use
+    uint32_t last_round_trip_us;
+    uint32_t max_round_trip_us;
+    uint64_t total_round_trip_us;
+  };
+
+  // Claims a slot and fills in the request header. Returns the slot, or -1 if all are in use.
+  int open(uint8_t command, uint32_t now_us, zb_cmd_header_t* header, bool detached = false);
+  // Matches one RESPONSE frame payload. Returns the slot it completed (free again if detached), or -1.
+  int on_response(const uint8_t* payload, uint16_t len, uint32_t now_us);
+  // Completes a pending slot locally (timeout, link down). No-op once done.
+  bool fail(int slot, uint8_t status, uint32_t now_us);
+  // Fails every pending slot; returns a bit per slot completed that has an owner to wake.
+  uint32_t fail_all(uint8_t status, uint32_t now_us);
+  void release(int slot);
+
+  State state(int slot) const {
+    return valid(slot) ? slots_[slot].state : State::kFree;
+  }
+  uint16_t request_id(int slot) const {
+    return valid(slot) ? slots_[slot].header.request_id : 0;
+  }
+  uint32_t sent_us(int slot) const {
+    return valid(slot) ? slots_[slot].sent_us : 0;
+  }
+  const Result& result(int slot) const {
+    return slots_[valid(slot) ? slot : 0].result;
+  }
+  const uint8_t* body(int slot) const {
+    return slots_[valid(slot) ? slot : 0].body;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  void reset_stats() {
+    stats_ = {};
+  }
+
+ private:
+  struct Slot {
+    State state = State::kFree;
+    bool detached = false;
+    zb_cmd_header_t header = {};
+    uint32_t sent_us = 0;
+    Result result = {};
+    uint8_t body[sizeof(zb_cmd_any_response_t)] = {};
+  };
+
+  static bool valid(int slot) {
+    return slot >= 0 && slot < kSlots;
+  }
+  void finish(Slot& slot, uint8_t status, uint32_t now_us);
+
+  Slot slots_[kSlots];
+  uint16_t next_request_id_ = 1;
+  Stats stats_ = {};
+};
+
+#endif  // COMMAND_TRACKER_H_
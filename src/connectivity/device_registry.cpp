@@ -0,0 +1,106 @@
+#include "device_registry.h"
+
+#include <cstring>
+
+size_t DeviceRegistry::lower_bound(uint32_t target) const {
+  size_t lo = 0;
+  size_t hi = size_;
+  while (lo < hi) {
+    const size_t mid = (lo + hi) / 2;
+    if (key(entries_[mid].network, entries_[mid].short_addr) < target) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+DeviceRegistry::Entry* DeviceRegistry::find(uint8_t network, uint16_t short_addr) {
+  const size_t i = lower_bound(key(network, short_addr));
+  return i < size_ && entries_[i].short_addr == short_addr && entries_[i].network == network ? &entries_[i] : nullptr;
+}
+
+// Drops the unpinned device heard from least recently; pinned entries are never evicted.
+bool DeviceRegistry::evict() {
+  size_t victim = size_;
+  for (size_t i = 0; i < size_; ++i) {
+    const Entry& entry = entries_[i];
+    if (entry.pinned) {
+      continue;
+    }
+    if (victim == size_ || static_cast<int32_t>(entry.seen_ms - entries_[victim].seen_ms) < 0) {
+      victim = i;
+    }
+  }
+  if (victim == size_) {
+    return false;
+  }
+  memmove(&entries_[victim], &entries_[victim + 1], (size_ - victim - 1) * sizeof(Entry));
+  size_--;
+  stats_.evicted++;
+  return true;
+}
+
+DeviceRegistry::Entry* DeviceRegistry::insert(uint8_t network, uint16_t short_addr, uint32_t now_ms) {
+  if (size_ == kCapacity && !evict()) {
+    return nullptr;
+  }
+  const size_t i = lower_bound(key(network, short_addr));
+  memmove(&entries_[i + 1], &entries_[i], (size_ - i) * sizeof(Entry));
+  size_++;
+  entries_[i] = {short_addr, network, false, now_ms};
+  return &entries_[i];
+}
+
+bool DeviceRegistry::note(uint8_t network, uint16_t short_addr, uint32_t now_ms) {
+  Entry* entry = find(network, short_addr);
+  if (entry) {
+    entry->seen_ms = now_ms;
+    return false;
+  }
+  if (!insert(network, short_addr, now_ms)) {
+    return false;
+  }
+  stats_.learned++;
+  return true;
+}
+
+bool DeviceRegistry::pin(uint8_t network, uint16_t short_addr, uint32_t now_ms) {
+  Entry* entry = find(network, short_addr);
+  if (!entry) {
+    entry = insert(network, short_addr, now_ms);
+    if (!entry) {
+      return false;
+    }
+  }
+  entry->pinned = true;
+  entry->seen_ms = now_ms;
+  return true;
+}
+
+bool DeviceRegistry::forget(uint8_t network, uint16_t short_addr) {
+  Entry* entry = find(network, short_addr);
+  if (!entry) {
+    return false;
+  }
+  const size_t i = static_cast<size_t>(entry - entries_);
+  memmove(&entries_[i], &entries_[i + 1], (size_ - i - 1) * sizeof(Entry));
+  size_--;
+  return true;
+}
+
+uint8_t DeviceRegistry::resolve(uint16_t short_addr) {
+  // Every network's entry for short_addr sits in one run, starting at network 0.
+  const size_t i = lower_bound(key(0, short_addr));
+  if (i >= size_ || entries_[i].short_addr != short_addr) {
+    stats_.unknown++;
+    return kUnknown;
+  }
+  if (i + 1 < size_ && entries_[i + 1].short_addr == short_addr) {
+    stats_.ambiguous++;
+    return kAmbiguous;
+  }
+  stats_.resolved++;
+  return entries_[i].network;
+}
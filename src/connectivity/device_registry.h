@@ -0,0 +1,74 @@
+#ifndef DEVICE_REGISTRY_H_
+#define DEVICE_REGISTRY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Zigbee devices the hub has heard from, keyed by network and short address: a short
+ * address is only unique inside one PAN, and every co-processor link (and the C6's own
+ * radio) runs its own. Sorted by address, then network, for a binary search per lookup,
+ * so a bare short address resolves to the one network that has it. A pinned entry stands
+ * for a device that only ever receives commands. When the table is full the unpinned
+ * device heard from least recently makes room; pinned entries are never evicted.
+ * note() inserts from the RX tasks and moves entries, so resolve() and lookups from
+ * command senders need the same lock held across the call.
+ */
+class DeviceRegistry {
+ public:
+  static constexpr size_t kCapacity = 256;
+  static constexpr uint8_t kUnknown = 0xFF;    // resolve(): no network has the address
+  static constexpr uint8_t kAmbiguous = 0xFE;  // resolve(): several do
+
+  struct Entry {
+    uint16_t short_addr;
+    uint8_t network;
+    bool pinned;
+    uint32_t seen_ms;  // last frame from the device, or when it was pinned
+  };
+
+  struct Stats {
+    uint32_t learned;  // devices added by note()
+    uint32_t evicted;
+    uint32_t resolved;   // resolve() lookups that found one network
+    uint32_t unknown;    // found none
+    uint32_t ambiguous;  // found several
+  };
+
+  // A frame from short_addr arrived on network; true when that added the device.
+  bool note(uint8_t network, uint16_t short_addr, uint32_t now_ms);
+  // Keeps the device until forget(); false only if the table is full of pinned devices.
+  bool pin(uint8_t network, uint16_t short_addr, uint32_t now_ms);
+  bool forget(uint8_t network, uint16_t short_addr);
+  // Network of short_addr when exactly one has it, else kUnknown or kAmbiguous.
+  uint8_t resolve(uint16_t short_addr);
+
+  size_t size() const {
+    return size_;
+  }
+  const Entry& entry(size_t i) const {
+    return entries_[i];
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  void reset_stats() {
+    stats_ = {};
+  }
+
+ private:
+  static uint32_t key(uint8_t network, uint16_t short_addr) {
+    return static_cast<uint32_t>(short_addr) << 8 | network;
+  }
+  // Index of the device, or where it would be inserted.
+  size_t lower_bound(uint32_t target) const;
+  Entry* find(uint8_t network, uint16_t short_addr);
+  Entry* insert(uint8_t network, uint16_t short_addr, uint32_t now_ms);
+  bool evict();
+
+  Entry entries_[kCapacity] = {};
+  size_t size_ = 0;
+  Stats stats_ = {};
+};
+
+#endif  // DEVICE_REGISTRY_H_
@@ -0,0 +1,293 @@
+#include "include/h2_log.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#define DEBUG_TAG "H2_LOG"
+#include "../debug/include/debug/Debug.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "include/uart_link.h"
+#include "remote_log.h"
+#include "sdkconfig.h"
+
+#if CONFIG_APP_ENABLE_UART_LINK
+
+#ifndef CONFIG_APP_H2_LOG_LEVEL
+#define CONFIG_APP_H2_LOG_LEVEL 3
+#endif
+#ifndef CONFIG_APP_H2_LOG_MAX_RATE
+#define CONFIG_APP_H2_LOG_MAX_RATE 20
+#endif
+#ifndef CONFIG_APP_H2_METRICS_PERIOD_MS
+#define CONFIG_APP_H2_METRICS_PERIOD_MS 5000
+#endif
+
+namespace {
+const char* kTag = DEBUG_TAG;
+// Tag of the forwarded records; `log_level H2 <level>` filters them on the console.
+const char* kRemoteTag = "H2";
+
+constexpr size_t kTailLines = 16;
+constexpr size_t kTailTextSize = 88;
+
+// A record as received, tag then message, cut to kTailTextSize; `zb_log` formats it.
+struct TailRecord {
+  uint32_t timestamp_ms;
+  uint8_t level;
+  uint8_t tag_len;
+  uint8_t msg_len;
+  char text[kTailTextSize];
+};
+
+// Guards everything below; the RX task writes, the CLI reads.
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+h2_log_stats_t s_stats = {};
+RateLimiter s_limiter;
+uint32_t s_suppressed = 0;  // rate-limited since the last record that got through
+uint32_t s_metrics[remote_log_wire::kMetricIdCount] = {};
+uint32_t s_h2_uptime_ms = 0;
+int64_t s_metrics_us = 0;
+TailRecord s_tail[kTailLines];
+uint32_t s_tail_next = 0;  // total records written; index is modulo kTailLines
+
+uint32_t now_ms() {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+char level_letter(uint8_t level) {
+  switch (level) {
+    case ESP_LOG_ERROR:
+      return 'E';
+    case ESP_LOG_WARN:
+      return 'W';
+    case ESP_LOG_INFO:
+      return 'I';
+    case ESP_LOG_DEBUG:
+      return 'D';
+    default:
+      return 'V';
+  }
+}
+
+void send_config(uint8_t link) {
+  portENTER_CRITICAL(&s_lock);
+  const remote_log_wire::Config config = {s_stats.level, 0, s_stats.max_records_per_s, s_stats.metrics_period_ms};
+  portEXIT_CRITICAL(&s_lock);
+  // Never block the caller (the link task on link-up): a full queue means the next link-up retries.
+  const esp_err_t err =
+      uart_link_channel_send_on(link, UART_LINK_CHANNEL_EVENT, UART_LINK_MSG_H2_LOG_CONFIG, &config, sizeof(config), 0);
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "H2 log config not sent: %s", esp_err_to_name(err));
+  }
+}
+
+void on_link_event(uart_link_event_t event, void*) {
+  const int link = uart_link_current();
+  if (event == UART_LINK_EVENT_STATE_CHANGED && link >= 0 &&
+      uart_link_get_state_on(static_cast<uint8_t>(link)) == UART_LINK_STATE_UP) {
+    send_config(static_cast<uint8_t>(link));
+  }
+}
+
+void emit(const RemoteLogReader::Record& record, uint32_t suppressed) {
+  if (suppressed) {
+    esp_log_write(ESP_LOG_WARN, kRemoteTag, "W (H2) %" PRIu32 " records dropped by the C6 rate limit\n", suppressed);
+  }
+  uint8_t level = record.level;
+  if (level < ESP_LOG_ERROR || level > ESP_LOG_VERBOSE) {
+    level = ESP_LOG_INFO;
+  }
+  // Copied by value into the deferred log ring; the RX task returns to the UART at once.
+  esp_log_write(static_cast<esp_log_level_t>(level), kRemoteTag, "%c (H2 %" PRIu32 ") %.*s: %.*s\n",
+                level_letter(level), record.timestamp_ms, record.tag_len, record.tag, record.msg_len, record.msg);
+
+  TailRecord tail;
+  tail.timestamp_ms = record.timestamp_ms;
+  tail.level = level;
+  tail.tag_len = static_cast<uint8_t>(record.tag_len < kTailTextSize ? record.tag_len : kTailTextSize);
+  const size_t room = kTailTextSize - tail.tag_len;
+  tail.msg_len = static_cast<uint8_t>(record.msg_len < room ? record.msg_len : room);
+  memcpy(tail.text, record.tag, tail.tag_len);
+  memcpy(tail.text + tail.tag_len, record.msg, tail.msg_len);
+  portENTER_CRITICAL(&s_lock);
+  s_tail[s_tail_next % kTailLines] = tail;
+  s_tail_next++;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void on_log_frame(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  RemoteLogReader reader(payload, len);
+  RemoteLogReader::Record record;
+  const uint32_t now = now_ms();
+  while (reader.next(&record)) {
+    portENTER_CRITICAL(&s_lock);
+    s_stats.records++;
+    s_stats.h2_dropped += record.dropped;
+    const bool allowed = s_limiter.allow(now);
+    uint32_t suppressed = 0;
+    if (allowed) {
+      s_stats.printed++;
+      suppressed = s_suppressed;
+      s_suppressed = 0;
+    } else {
+      s_stats.rate_limited++;
+      s_suppressed++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (allowed) {
+      emit(record, suppressed);
+    }
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_stats.bytes += len;
+  if (reader.malformed()) {
+    s_stats.malformed_frames++;
+  }
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void on_metrics_frame(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  remote_log_wire::MetricsHeader header;
+  if (len < sizeof(header) || (len - sizeof(header)) % sizeof(remote_log_wire::Metric) != 0) {
+    portENTER_CRITICAL(&s_lock);
+    s_stats.malformed_frames++;
+    portEXIT_CRITICAL(&s_lock);
+    return;
+  }
+  memcpy(&header, payload, sizeof(header));
+  portENTER_CRITICAL(&s_lock);
+  for (size_t pos = sizeof(header); pos < len; pos += sizeof(remote_log_wire::Metric)) {
+    remote_log_wire::Metric metric;
+    memcpy(&metric, payload + pos, sizeof(metric));
+    if (metric.id < remote_log_wire::kMetricIdCount) {
+      s_metrics[metric.id] = metric.value;
+    }
+  }
+  s_h2_uptime_ms = header.uptime_ms;
+  s_metrics_us = esp_timer_get_time();
+  s_stats.metrics_frames++;
+  s_stats.bytes += len;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+}  // namespace
+
+esp_err_t h2_log_init(void) {
+  DEBUG_FUNC_ENTER();
+  s_stats.level = CONFIG_APP_H2_LOG_LEVEL;
+  s_stats.max_records_per_s = CONFIG_APP_H2_LOG_MAX_RATE;
+  s_stats.metrics_period_ms = CONFIG_APP_H2_METRICS_PERIOD_MS;
+  s_limiter.set_rate(CONFIG_APP_H2_LOG_MAX_RATE, now_ms());
+  esp_err_t err = uart_link_register_frame_handler(UART_LINK_MSG_H2_LOG, on_log_frame, nullptr);
+  if (err == ESP_OK) {
+    err = uart_link_register_frame_handler(UART_LINK_MSG_H2_METRICS, on_metrics_frame, nullptr);
+  }
+  if (err == ESP_OK) {
+    err = uart_link_register_event_cb(on_link_event, nullptr);
+  }
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+esp_err_t h2_log_configure(uint8_t level, uint16_t max_records_per_s, uint16_t metrics_period_ms) {
+  if (level > ESP_LOG_VERBOSE || (metrics_period_ms && metrics_period_ms < 100)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_stats.level = level;
+  s_stats.max_records_per_s = max_records_per_s;
+  s_stats.metrics_period_ms = metrics_period_ms;
+  s_limiter.set_rate(max_records_per_s, now_ms());
+  portEXIT_CRITICAL(&s_lock);
+  for (uint8_t link = 0; link < uart_link_count(); ++link) {
+    const uart_link_state_t state = uart_link_get_state_on(link);
+    if (state == UART_LINK_STATE_UP || state == UART_LINK_STATE_DEGRADED) {
+      send_config(link);
+    }
+  }
+  return ESP_OK;
+}
+
+void h2_log_get_stats(h2_log_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  *out_stats = s_stats;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void h2_log_get_metrics(h2_metrics_t* out_metrics) {
+  if (!out_metrics) {
+    return;
+  }
+  memset(out_metrics, 0, sizeof(*out_metrics));
+  portENTER_CRITICAL(&s_lock);
+  const int64_t at_us = s_metrics_us;
+  out_metrics->h2_uptime_ms = s_h2_uptime_ms;
+  out_metrics->zb_queue_depth = s_metrics[remote_log_wire::kZbQueueDepth];
+  out_metrics->zb_queue_high_water = s_metrics[remote_log_wire::kZbQueueHighWater];
+  out_metrics->mac_retries = s_metrics[remote_log_wire::kMacRetries];
+  out_metrics->mac_tx_failures = s_metrics[remote_log_wire::kMacTxFailures];
+  out_metrics->child_count = s_metrics[remote_log_wire::kChildCount];
+  out_metrics->neighbor_count = s_metrics[remote_log_wire::kNeighborCount];
+  out_metrics->free_heap = s_metrics[remote_log_wire::kFreeHeap];
+  out_metrics->min_free_heap = s_metrics[remote_log_wire::kMinFreeHeap];
+  out_metrics->log_dropped = s_metrics[remote_log_wire::kLogDropped];
+  portEXIT_CRITICAL(&s_lock);
+  out_metrics->valid = at_us != 0;
+  if (at_us) {
+    out_metrics->age_ms = static_cast<uint32_t>((esp_timer_get_time() - at_us) / 1000);
+  }
+}
+
+void h2_log_print_tail(uint32_t count) {
+  portENTER_CRITICAL(&s_lock);
+  const uint32_t total = s_tail_next;
+  portEXIT_CRITICAL(&s_lock);
+  const uint32_t available = total < kTailLines ? total : kTailLines;
+  if (count == 0 || count > available) {
+    count = available;
+  }
+  for (uint32_t i = total - count; i < total; ++i) {
+    portENTER_CRITICAL(&s_lock);
+    const TailRecord tail = s_tail[i % kTailLines];
+    portEXIT_CRITICAL(&s_lock);
+    printf("%c (%" PRIu32 ") %.*s: %.*s\n", level_letter(tail.level), tail.timestamp_ms, tail.tag_len, tail.text,
+           tail.msg_len, tail.text + tail.tag_len);
+  }
+}
+
+#else
+
+esp_err_t h2_log_init(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_log_configure(uint8_t level, uint16_t max_records_per_s, uint16_t metrics_period_ms) {
+  (void)level;
+  (void)max_records_per_s;
+  (void)metrics_period_ms;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void h2_log_get_stats(h2_log_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+void h2_log_get_metrics(h2_metrics_t* out_metrics) {
+  if (out_metrics) {
+    memset(out_metrics, 0, sizeof(*out_metrics));
+  }
+}
+
+void h2_log_print_tail(uint32_t count) {
+  (void)count;
+}
+
+#endif  // CONFIG_APP_ENABLE_UART_LINK
@@ -0,0 +1,535 @@
+#include "include/h2_ota.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#define DEBUG_TAG "H2_OTA"
+#include "../debug/include/debug/Debug.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "include/uart_link.h"
+#include "link_channels.h"
+#include "ota_relay.h"
+#include "sdkconfig.h"
+#include "uart_link_protocol.h"
+
+#if CONFIG_APP_ENABLE_UART_LINK
+
+#ifndef CONFIG_APP_H2_OTA_WINDOW
+#define CONFIG_APP_H2_OTA_WINDOW 8
+#endif
+#ifndef CONFIG_APP_H2_OTA_ACK_TIMEOUT_MS
+#define CONFIG_APP_H2_OTA_ACK_TIMEOUT_MS 600
+#endif
+
+namespace {
+const char* kTag = DEBUG_TAG;
+
+constexpr char kPartitionLabel[] = "storage";
+constexpr uint32_t kHeaderMagic = 0x4D493248;  // "H2IM"
+constexpr size_t kSectorSize = 0x1000;
+constexpr size_t kImageOffset = kSectorSize;  // first sector holds the header
+// Sized so a chunk travels as a single bulk-channel fragment; a peer without channels gets
+// plain frames, which fit it too.
+constexpr size_t kChunkSize =
+    UART_LINK_MAX_PAYLOAD - sizeof(channel_wire::FragmentHeader) - sizeof(ota_wire::ChunkHeader);
+static_assert(kChunkSize == OtaRelay::Config().chunk_size, "keep the OtaRelay default in step");
+constexpr UBaseType_t kRelayPriority = 3;  // below the link (4) and RX (5) tasks
+
+// Written last when staging completes, so a half-staged image is never picked up after a reboot.
+struct StageHeader {
+  uint32_t magic;
+  uint32_t size;
+  uint32_t crc32;
+  uint32_t header_crc;
+};
+
+// One relay per UART link, so every H2 can take the staged image at its own pace.
+struct Relay {
+  uint8_t link;
+  OtaRelay relay;
+  h2_ota_state_t state;  // IDLE until the relay first starts
+  TaskHandle_t task;
+  int64_t start_us;
+  int64_t end_us;
+  volatile bool abort;
+  uint8_t frame[UART_LINK_MAX_PAYLOAD];  // its task only
+};
+
+const esp_partition_t* s_partition = nullptr;
+// Guards the relays and the fields below; the RX tasks feed acks under it. Staging claims
+// s_state (STAGING) under it first, so no relay can start on a half-written image; the
+// flash work then runs outside it from the one staging caller. The relays only read flash.
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+h2_ota_state_t s_state = H2_OTA_IDLE;  // IDLE, STAGING or STAGED
+uint32_t s_image_size = 0;
+uint32_t s_image_crc = 0;
+uint32_t s_staged = 0;
+uint32_t s_erased_to = 0;
+Relay s_relays[UART_LINK_MAX_LINKS];
+
+uint32_t now_ms() {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+// The rest of the partition holds sensor history.
+uint32_t staging_bytes() {
+  return s_partition->size < H2_OTA_STAGING_BYTES ? s_partition->size : H2_OTA_STAGING_BYTES;
+}
+
+uint32_t header_crc(const StageHeader& header) {
+  return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&header), offsetof(StageHeader, header_crc));
+}
+
+void set_state(h2_ota_state_t state) {
+  portENTER_CRITICAL(&s_lock);
+  s_state = state;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void set_relay_state(Relay& relay, h2_ota_state_t state) {
+  portENTER_CRITICAL(&s_lock);
+  relay.state = state;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+h2_ota_state_t state_for(OtaRelay::Phase phase) {
+  switch (phase) {
+    case OtaRelay::Phase::kBegin:
+      return H2_OTA_CONNECTING;
+    case OtaRelay::Phase::kStreaming:
+      return H2_OTA_STREAMING;
+    case OtaRelay::Phase::kVerifying:
+      return H2_OTA_VERIFYING;
+    case OtaRelay::Phase::kDone:
+      return H2_OTA_DONE;
+    case OtaRelay::Phase::kFailed:
+      return H2_OTA_FAILED;
+    default:
+      return H2_OTA_STAGED;
+  }
+}
+
+void on_ack_frame(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  const int link = uart_link_current();
+  if (link < 0 || link >= UART_LINK_MAX_LINKS) {
+    return;
+  }
+  if (len != sizeof(ota_wire::Ack)) {
+    ESP_LOGW(kTag, "Malformed OTA ack (%u bytes) on link %d", len, link);
+    return;
+  }
+  ota_wire::Ack ack;
+  memcpy(&ack, payload, sizeof(ack));
+  Relay& relay = s_relays[link];
+  portENTER_CRITICAL(&s_lock);
+  relay.relay.on_ack(ack, now_ms());
+  const TaskHandle_t task = relay.task;
+  portEXIT_CRITICAL(&s_lock);
+  if (task) {
+    xTaskNotifyGive(task);
+  }
+}
+
+esp_err_t send_output(Relay& relay, const OtaRelay::Output& out) {
+  uint8_t* frame = relay.frame;
+  size_t len = 0;
+  if (out.type == UART_LINK_MSG_OTA_BEGIN) {
+    const ota_wire::Begin begin = {s_image_size, s_image_crc, static_cast<uint16_t>(kChunkSize),
+                                   static_cast<uint8_t>(CONFIG_APP_H2_OTA_WINDOW)};
+    memcpy(frame, &begin, sizeof(begin));
+    len = sizeof(begin);
+  } else if (out.type == UART_LINK_MSG_OTA_END) {
+    const ota_wire::End end = {s_image_size, s_image_crc};
+    memcpy(frame, &end, sizeof(end));
+    len = sizeof(end);
+  } else {
+    uint8_t* data = frame + sizeof(ota_wire::ChunkHeader);
+    const esp_err_t err = esp_partition_read(s_partition, kImageOffset + out.offset, data, out.length);
+    if (err != ESP_OK) {
+      return err;
+    }
+    const ota_wire::ChunkHeader header = {out.offset, esp_rom_crc16_le(0, data, out.length)};
+    memcpy(frame, &header, sizeof(header));
+    len = sizeof(header) + out.length;
+  }
+  // Bulk channel: commands and Zigbee events overtake the image between chunks.
+  return uart_link_channel_send_on(relay.link, UART_LINK_CHANNEL_BULK, out.type, frame, len,
+                                   CONFIG_APP_H2_OTA_ACK_TIMEOUT_MS);
+}
+
+bool link_up(uint8_t link) {
+  const uart_link_state_t state = uart_link_get_state_on(link);
+  return state == UART_LINK_STATE_UP || state == UART_LINK_STATE_DEGRADED;
+}
+
+bool any_relay_running() {
+  for (const Relay& relay : s_relays) {
+    if (relay.task) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Keeps the window full: sends whenever the relay allows, otherwise sleeps until an ack or timeout.
+void relay_task(void* arg) {
+  Relay& relay = *static_cast<Relay*>(arg);
+  bool was_up = true;
+  while (!relay.abort) {
+    if (!link_up(relay.link)) {
+      if (was_up) {
+        ESP_LOGW(kTag, "Link %u down; transfer paused", relay.link);
+        portENTER_CRITICAL(&s_lock);
+        relay.relay.pause();
+        portEXIT_CRITICAL(&s_lock);
+      }
+      was_up = false;
+      vTaskDelay(pdMS_TO_TICKS(200));
+      continue;
+    }
+    was_up = true;
+    const uint32_t now = now_ms();
+    OtaRelay::Output out;
+    portENTER_CRITICAL(&s_lock);
+    const bool send = relay.relay.next(now, &out);
+    const bool active = relay.relay.active();
+    const uint32_t idle = relay.relay.idle_ms(now);
+    relay.state = state_for(relay.relay.phase());
+    portEXIT_CRITICAL(&s_lock);
+    if (!active) {
+      break;
+    }
+    if (!send) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle ? idle : 1));
+      continue;
+    }
+    const esp_err_t err = send_output(relay, out);
+    if (err != ESP_OK) {
+      // Counted as lost; the ack timeout resends it.
+      ESP_LOGD(kTag, "OTA frame 0x%02X @%lu not sent on link %u: %s", out.type, (unsigned long)out.offset,
+               relay.link, esp_err_to_name(err));
+    }
+  }
+
+  relay.end_us = esp_timer_get_time();
+  portENTER_CRITICAL(&s_lock);
+  const OtaRelay::Phase phase = relay.relay.phase();
+  const uint8_t failure = relay.relay.failure();
+  relay.state = relay.abort ? H2_OTA_STAGED : state_for(phase);
+  relay.task = nullptr;
+  portEXIT_CRITICAL(&s_lock);
+  if (relay.abort) {
+    ESP_LOGW(kTag, "Link %u: transfer aborted; H2 keeps its progress for a later resume", relay.link);
+  } else if (phase == OtaRelay::Phase::kDone) {
+    ESP_LOGI(kTag, "Link %u: H2 accepted the image (%lu bytes in %lld ms)", relay.link, (unsigned long)s_image_size,
+             (relay.end_us - relay.start_us) / 1000);
+  } else {
+    ESP_LOGE(kTag, "Link %u: transfer failed (status 0x%02X)", relay.link, failure);
+  }
+  vTaskDelete(nullptr);
+}
+
+}  // namespace
+
+esp_err_t h2_ota_init(void) {
+  DEBUG_FUNC_ENTER();
+  s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, kPartitionLabel);
+  if (!s_partition) {
+    ESP_LOGW(kTag, "No '%s' partition; H2 OTA relay disabled", kPartitionLabel);
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NOT_FOUND);
+    return ESP_ERR_NOT_FOUND;
+  }
+  OtaRelay::Config config;
+  config.chunk_size = kChunkSize;
+  config.window = CONFIG_APP_H2_OTA_WINDOW;
+  config.ack_timeout_ms = CONFIG_APP_H2_OTA_ACK_TIMEOUT_MS;
+  for (uint8_t i = 0; i < UART_LINK_MAX_LINKS; ++i) {
+    s_relays[i].link = i;
+    s_relays[i].relay = OtaRelay(config);
+  }
+  esp_err_t err = uart_link_register_frame_handler(UART_LINK_MSG_OTA_ACK, on_ack_frame, nullptr);
+  if (err != ESP_OK) {
+    DEBUG_FUNC_EXIT_RC(err);
+    return err;
+  }
+
+  StageHeader header = {};
+  err = esp_partition_read(s_partition, 0, &header, sizeof(header));
+  if (err == ESP_OK && header.magic == kHeaderMagic && header.header_crc == header_crc(header) &&
+      header.size <= staging_bytes() - kImageOffset) {
+    s_image_size = header.size;
+    s_image_crc = header.crc32;
+    s_staged = header.size;
+    s_state = H2_OTA_STAGED;
+    ESP_LOGI(kTag, "Staged H2 image found: %lu bytes, crc32=0x%08lx", (unsigned long)s_image_size,
+             (unsigned long)s_image_crc);
+  }
+  DEBUG_FUNC_EXIT_RC(ESP_OK);
+  return ESP_OK;
+}
+
+esp_err_t h2_ota_stage_begin(uint32_t image_size) {
+  if (!s_partition) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (image_size == 0 || image_size > staging_bytes() - kImageOffset) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const bool idle = !any_relay_running();
+  if (idle) {
+    s_state = H2_OTA_STAGING;
+    s_image_size = image_size;
+    s_image_crc = 0;
+    s_staged = 0;
+    for (Relay& relay : s_relays) {
+      relay.state = H2_OTA_IDLE;  // a new image starts every relay over
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (!idle) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  s_erased_to = kImageOffset;
+  // Invalidate the old header first so a reboot mid-staging never offers a mixed image.
+  const esp_err_t err = esp_partition_erase_range(s_partition, 0, kSectorSize);
+  if (err != ESP_OK) {
+    set_state(H2_OTA_IDLE);
+    return err;
+  }
+  return ESP_OK;
+}
+
+esp_err_t h2_ota_stage_write(const void* data, size_t len) {
+  portENTER_CRITICAL(&s_lock);
+  const h2_ota_state_t state = s_state;
+  portEXIT_CRITICAL(&s_lock);
+  if (state != H2_OTA_STAGING) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!data || s_staged + len > s_image_size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  const size_t end = kImageOffset + s_staged + len;
+  while (s_erased_to < end) {
+    const esp_err_t err = esp_partition_erase_range(s_partition, s_erased_to, kSectorSize);
+    if (err != ESP_OK) {
+      return err;
+    }
+    s_erased_to += kSectorSize;
+  }
+  const esp_err_t err = esp_partition_write(s_partition, kImageOffset + s_staged, data, len);
+  if (err != ESP_OK) {
+    return err;
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_staged += len;
+  portEXIT_CRITICAL(&s_lock);
+  return ESP_OK;
+}
+
+esp_err_t h2_ota_stage_finish(uint32_t expected_crc32) {
+  portENTER_CRITICAL(&s_lock);
+  const h2_ota_state_t state = s_state;
+  portEXIT_CRITICAL(&s_lock);
+  if (state != H2_OTA_STAGING) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (s_staged != s_image_size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  // Verify what actually landed in flash, not what the caller meant to write.
+  uint8_t buffer[256];
+  uint32_t crc = 0;
+  for (uint32_t offset = 0; offset < s_image_size; offset += sizeof(buffer)) {
+    const size_t chunk = s_image_size - offset < sizeof(buffer) ? s_image_size - offset : sizeof(buffer);
+    const esp_err_t err = esp_partition_read(s_partition, kImageOffset + offset, buffer, chunk);
+    if (err != ESP_OK) {
+      return err;
+    }
+    crc = esp_rom_crc32_le(crc, buffer, chunk);
+  }
+  if (expected_crc32 && crc != expected_crc32) {
+    ESP_LOGE(kTag, "Staged image CRC 0x%08lx, expected 0x%08lx", (unsigned long)crc, (unsigned long)expected_crc32);
+    set_state(H2_OTA_IDLE);
+    return ESP_ERR_INVALID_CRC;
+  }
+  StageHeader header = {kHeaderMagic, s_image_size, crc, 0};
+  header.header_crc = header_crc(header);
+  const esp_err_t err = esp_partition_write(s_partition, 0, &header, sizeof(header));
+  if (err != ESP_OK) {
+    return err;
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_image_crc = crc;
+  s_state = H2_OTA_STAGED;
+  portEXIT_CRITICAL(&s_lock);
+  ESP_LOGI(kTag, "H2 image staged: %lu bytes, crc32=0x%08lx", (unsigned long)s_image_size, (unsigned long)crc);
+  return ESP_OK;
+}
+
+esp_err_t h2_ota_start(void) {
+  return h2_ota_start_on(UART_LINK_PRIMARY);
+}
+
+esp_err_t h2_ota_start_on(uint8_t link) {
+  DEBUG_FUNC_ENTER();
+  if (link >= uart_link_count()) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_INVALID_ARG);
+    return ESP_ERR_INVALID_ARG;
+  }
+  Relay& relay = s_relays[link];
+  portENTER_CRITICAL(&s_lock);
+  const bool ready = !relay.task && s_state == H2_OTA_STAGED;
+  if (ready) {
+    relay.relay.start(s_image_size, s_image_crc);
+    relay.state = H2_OTA_CONNECTING;
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (!ready) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_INVALID_STATE);
+    return ESP_ERR_INVALID_STATE;
+  }
+  relay.abort = false;
+  relay.start_us = esp_timer_get_time();
+  relay.end_us = 0;
+  char name[configMAX_TASK_NAME_LEN];
+  snprintf(name, sizeof(name), "h2_ota%u", link);
+  if (xTaskCreate(relay_task, name, 3072, &relay, kRelayPriority, &relay.task) != pdPASS) {
+    relay.task = nullptr;
+    set_relay_state(relay, H2_OTA_STAGED);
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+    return ESP_ERR_NO_MEM;
+  }
+  ESP_LOGI(kTag, "Relaying %lu-byte image to the H2 on link %u", (unsigned long)s_image_size, link);
+  DEBUG_FUNC_EXIT_RC(ESP_OK);
+  return ESP_OK;
+}
+
+esp_err_t h2_ota_abort(void) {
+  return h2_ota_abort_on(UART_LINK_PRIMARY);
+}
+
+esp_err_t h2_ota_abort_on(uint8_t link) {
+  if (link >= UART_LINK_MAX_LINKS || !s_relays[link].task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  s_relays[link].abort = true;
+  xTaskNotifyGive(s_relays[link].task);
+  return ESP_OK;
+}
+
+void h2_ota_get_status(h2_ota_status_t* out_status) {
+  h2_ota_get_status_on(UART_LINK_PRIMARY, out_status);
+}
+
+void h2_ota_get_status_on(uint8_t link, h2_ota_status_t* out_status) {
+  if (!out_status) {
+    return;
+  }
+  memset(out_status, 0, sizeof(*out_status));
+  if (link >= UART_LINK_MAX_LINKS) {
+    return;
+  }
+  const Relay& relay = s_relays[link];
+  portENTER_CRITICAL(&s_lock);
+  // A relay that has not run since the image was staged reports the staging state.
+  const bool relayed = s_state == H2_OTA_STAGED && relay.state >= H2_OTA_CONNECTING;
+  out_status->state = relayed ? relay.state : s_state;
+  out_status->image_size = s_image_size;
+  out_status->image_crc32 = s_image_crc;
+  out_status->staged_bytes = s_staged;
+  if (relayed) {
+    const OtaRelay::Stats& stats = relay.relay.stats();
+    out_status->acked_bytes = relay.relay.acked();
+    out_status->resumed_from = stats.resumed_from;
+    out_status->chunks_sent = stats.chunks_sent;
+    out_status->retransmits = stats.retransmits;
+    out_status->timeouts = stats.timeouts;
+    out_status->failure = relay.relay.failure();
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (relayed && relay.start_us) {
+    const int64_t end_us = relay.end_us ? relay.end_us : esp_timer_get_time();
+    out_status->elapsed_ms = static_cast<uint32_t>((end_us - relay.start_us) / 1000);
+    if (out_status->elapsed_ms) {
+      out_status->bytes_per_s = static_cast<uint32_t>(
+          static_cast<uint64_t>(out_status->acked_bytes - out_status->resumed_from) * 1000 / out_status->elapsed_ms);
+    }
+  }
+}
+
+#else
+
+esp_err_t h2_ota_init(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_stage_begin(uint32_t image_size) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_stage_write(const void* data, size_t len) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_stage_finish(uint32_t expected_crc32) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_start(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_start_on(uint8_t link) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_abort(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t h2_ota_abort_on(uint8_t link) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void h2_ota_get_status(h2_ota_status_t* out_status) {
+  if (out_status) {
+    memset(out_status, 0, sizeof(*out_status));
+  }
+}
+
+void h2_ota_get_status_on(uint8_t link, h2_ota_status_t* out_status) {
+  h2_ota_get_status(out_status);
+}
+
+#endif  // CONFIG_APP_ENABLE_UART_LINK
+
+const char* h2_ota_state_name(h2_ota_state_t state) {
+  switch (state) {
+    case H2_OTA_IDLE:
+      return "idle";
+    case H2_OTA_STAGING:
+      return "staging";
+    case H2_OTA_STAGED:
+      return "staged";
+    case H2_OTA_CONNECTING:
+      return "connecting";
+    case H2_OTA_STREAMING:
+      return "streaming";
+    case H2_OTA_VERIFYING:
+      return "verifying";
+    case H2_OTA_DONE:
+      return "done";
+    case H2_OTA_FAILED:
+      return "failed";
+    default:
+      return "?";
+  }
+}
@@ -0,0 +1,347 @@
+#include "include/history.h"
+
+#include <cstring>
+#include <ctime>
+
+#define DEBUG_TAG "HISTORY"
+#include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/StaticAlloc.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "history_store.h"
+#include "include/attr_ingest.h"
+#include "include/h2_ota.h"
+#include "sdkconfig.h"
+
+#if CONFIG_APP_ENABLE_UART_LINK
+
+#ifndef CONFIG_APP_HISTORY_MAX_SERIES
+#define CONFIG_APP_HISTORY_MAX_SERIES 32
+#endif
+
+namespace {
+const char* kTag = DEBUG_TAG;
+
+constexpr char kPartitionLabel[] = "storage";
+constexpr size_t kQueueLength = 32;
+constexpr uint32_t kWriterStackSize = 3072;
+constexpr UBaseType_t kWriterPriority = 2;  // below the link tasks; flash writes can wait
+constexpr time_t kClockSet = 1577836800;    // 2020-01-01; anything earlier is an unset clock
+// The history region of the default partition table is 224 sectors.
+constexpr uint32_t kMaxSectors = 256;
+
+struct Sample {
+  history_key_t key;
+  uint32_t t;
+  double value;
+};
+
+const esp_partition_t* s_partition = nullptr;
+uint32_t s_region_bytes = 0;
+// Guards s_store. Held across flash access, so only the writer task and the API take it.
+SemaphoreHandle_t s_lock = nullptr;
+HistoryStore s_store;
+QueueHandle_t s_queue = nullptr;
+TaskHandle_t s_task = nullptr;
+debug::StaticMutex s_lock_storage;
+debug::StaticQueue<Sample, kQueueLength> s_queue_storage;
+debug::StaticTask<kWriterStackSize> s_task_storage;
+#if CONFIG_APP_STATIC_ALLOCATION
+HistoryStore::Storage<CONFIG_APP_HISTORY_MAX_SERIES, kMaxSectors> s_store_storage;
+#endif
+uint32_t s_base_s = 0;  // newest stored timestamp when mounted
+uint32_t s_mount_ms = 0;
+// Guards the counters below; bumped from the RX and esp_timer tasks.
+portMUX_TYPE s_count_lock = portMUX_INITIALIZER_UNLOCKED;
+uint32_t s_dropped = 0;
+uint32_t s_unsupported = 0;
+
+bool flash_read(void*, uint32_t offset, void* out, size_t len) {
+  return esp_partition_read(s_partition, H2_OTA_STAGING_BYTES + offset, out, len) == ESP_OK;
+}
+
+bool flash_write(void*, uint32_t offset, const void* data, size_t len) {
+  return esp_partition_write(s_partition, H2_OTA_STAGING_BYTES + offset, data, len) == ESP_OK;
+}
+
+bool flash_erase(void*, uint32_t offset, size_t len) {
+  return esp_partition_erase_range(s_partition, H2_OTA_STAGING_BYTES + offset, len) == ESP_OK;
+}
+
+void count(uint32_t* counter) {
+  portENTER_CRITICAL(&s_count_lock);
+  (*counter)++;
+  portEXIT_CRITICAL(&s_count_lock);
+}
+
+// Numeric ZCL types: boolean, unsigned, signed, enum, single and double precision.
+bool numeric_value(const zb_rsp_read_attr_t& attr, double* out) {
+  uint8_t size;
+  bool is_signed = false;
+  if (attr.zcl_type == 0x10) {
+    size = 1;
+  } else if (attr.zcl_type >= 0x20 && attr.zcl_type <= 0x27) {
+    size = attr.zcl_type - 0x1F;
+  } else if (attr.zcl_type >= 0x28 && attr.zcl_type <= 0x2F) {
+    size = attr.zcl_type - 0x27;
+    is_signed = true;
+  } else if (attr.zcl_type == 0x30 || attr.zcl_type == 0x31) {
+    size = attr.zcl_type - 0x2F;
+  } else if (attr.zcl_type == 0x39 && attr.length == sizeof(float)) {
+    float value;
+    memcpy(&value, attr.value, sizeof(value));
+    *out = value;
+    return true;
+  } else if (attr.zcl_type == 0x3A && attr.length == sizeof(double)) {
+    memcpy(out, attr.value, sizeof(*out));
+    return true;
+  } else {
+    return false;
+  }
+  if (attr.length != size) {
+    return false;
+  }
+  uint64_t raw = 0;
+  for (uint8_t i = 0; i < size; ++i) {
+    raw |= static_cast<uint64_t>(attr.value[i]) << (8 * i);
+  }
+  if (is_signed && size < 8 && (raw >> (8 * size - 1)) & 1) {
+    raw |= ~0ull << (8 * size);
+  }
+  *out = is_signed ? static_cast<double>(static_cast<int64_t>(raw)) : static_cast<double>(raw);
+  return true;
+}
+
+void on_report(uint8_t network, const zb_attr_report_t* report, int64_t rx_us, void*) {
+  Sample sample;
+  if (!numeric_value(report->attr, &sample.value)) {
+    count(&s_unsupported);
+    return;
+  }
+  sample.key = {network, report->source.short_addr, report->source.endpoint, report->attr.cluster,
+                report->attr.attribute};
+  const int64_t age_s = (esp_timer_get_time() - rx_us) / 1000000;
+  sample.t = history_now() - static_cast<uint32_t>(age_s > 0 ? age_s : 0);
+  if (xQueueSend(s_queue, &sample, 0) != pdTRUE) {
+    count(&s_dropped);
+  }
+}
+
+void writer_task(void*) {
+  Sample sample;
+  while (true) {
+    xQueueReceive(s_queue, &sample, portMAX_DELAY);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    do {
+      s_store.record(sample.key, sample.t, sample.value);
+    } while (xQueueReceive(s_queue, &sample, 0) == pdTRUE);
+    xSemaphoreGive(s_lock);
+  }
+}
+
+}  // namespace
+
+esp_err_t history_init(void) {
+  DEBUG_FUNC_ENTER();
+  s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, kPartitionLabel);
+  if (!s_partition || s_partition->size < H2_OTA_STAGING_BYTES + HistoryStore::kMinSectors * HistoryStore::kSectorBytes) {
+    ESP_LOGW(kTag, "No room for history after the H2 staging area of '%s'; flash the current partition table",
+             kPartitionLabel);
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NOT_FOUND);
+    return ESP_ERR_NOT_FOUND;
+  }
+  s_region_bytes = s_partition->size - H2_OTA_STAGING_BYTES;
+  if (s_region_bytes > kMaxSectors * HistoryStore::kSectorBytes) {
+    ESP_LOGW(kTag, "History region of %lu KB clamped to %lu KB", (unsigned long)(s_region_bytes / 1024),
+             (unsigned long)(kMaxSectors * HistoryStore::kSectorBytes / 1024));
+    s_region_bytes = kMaxSectors * HistoryStore::kSectorBytes;
+  }
+  s_lock = s_lock_storage.create(MEM_BUDGET_HISTORY);
+  s_queue = s_queue_storage.create(MEM_BUDGET_HISTORY);
+  if (!s_lock || !s_queue) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+    return ESP_ERR_NO_MEM;
+  }
+
+  const HistoryStore::Flash flash = {flash_read, flash_write, flash_erase, nullptr};
+  const int64_t start_us = esp_timer_get_time();
+#if CONFIG_APP_STATIC_ALLOCATION
+  const bool mounted = s_store.mount(flash, s_region_bytes, s_store_storage);
+#else
+  const bool mounted = s_store.mount(flash, s_region_bytes, CONFIG_APP_HISTORY_MAX_SERIES);
+#endif
+  if (!mounted) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+    return ESP_ERR_NO_MEM;
+  }
+  // Series slots and the sector index, at most; the heap mount takes only what the region needs.
+  mem_budget_charge(MEM_BUDGET_HISTORY, MEM_BUDGET_BUFFER,
+                    sizeof(HistoryStore::Storage<CONFIG_APP_HISTORY_MAX_SERIES, kMaxSectors>),
+                    !debug::kStaticAllocation);
+  mem_budget_charge(MEM_BUDGET_HISTORY, MEM_BUDGET_BUFFER, sizeof(s_store), false);
+  s_mount_ms = static_cast<uint32_t>((esp_timer_get_time() - start_us) / 1000);
+  s_base_s = s_store.newest_t();
+  history_stats_t stats = {};
+  s_store.fill_stats(&stats);
+  ESP_LOGI(kTag, "History: %lu KB, %lu raw / %lu minute / %lu hour points, mounted in %lu ms",
+           (unsigned long)(s_region_bytes / 1024), (unsigned long)stats.tier[HISTORY_RAW].points,
+           (unsigned long)stats.tier[HISTORY_MINUTE].points, (unsigned long)stats.tier[HISTORY_HOUR].points,
+           (unsigned long)s_mount_ms);
+
+  if (s_task_storage.create(writer_task, "history", nullptr, kWriterPriority, &s_task, MEM_BUDGET_HISTORY) != pdPASS) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+    return ESP_ERR_NO_MEM;
+  }
+  const esp_err_t err = attr_ingest_subscribe(on_report, nullptr);
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+esp_err_t history_record(const history_key_t* key, uint32_t t, double value) {
+  if (!key || key->network > 0x0F) {  // stored in a nibble
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  const Sample sample = {*key, t, value};
+  if (xQueueSend(s_queue, &sample, 0) != pdTRUE) {
+    count(&s_dropped);
+    return ESP_ERR_TIMEOUT;
+  }
+  return ESP_OK;
+}
+
+size_t history_query(const history_key_t* key, history_tier_t tier, uint32_t from, uint32_t to,
+                     history_point_t* out_points, size_t max_points, history_query_stats_t* out_stats) {
+  history_query_stats_t stats = {};
+  size_t count = 0;
+  if (key && out_points && tier < HISTORY_TIERS && s_task) {
+    const int64_t start_us = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    count = s_store.query(*key, tier, from, to, out_points, max_points, &stats);
+    xSemaphoreGive(s_lock);
+    stats.elapsed_us = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+  }
+  if (out_stats) {
+    *out_stats = stats;
+  }
+  return count;
+}
+
+size_t history_get_series(history_series_t* out_series, size_t max_series) {
+  if (!out_series || !s_task) {
+    return 0;
+  }
+  size_t count = 0;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  while (count < max_series && s_store.series(static_cast<int>(count), &out_series[count])) {
+    count++;
+  }
+  xSemaphoreGive(s_lock);
+  return count;
+}
+
+esp_err_t history_flush(void) {
+  if (!s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_store.flush();
+  xSemaphoreGive(s_lock);
+  return ESP_OK;
+}
+
+void history_get_stats(history_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  *out_stats = {};
+  if (s_task) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_store.fill_stats(out_stats);
+    xSemaphoreGive(s_lock);
+    out_stats->mounted = true;
+  }
+  out_stats->region_bytes = s_region_bytes;
+  out_stats->mount_ms = s_mount_ms;
+  portENTER_CRITICAL(&s_count_lock);
+  out_stats->dropped = s_dropped;
+  out_stats->unsupported = s_unsupported;
+  portEXIT_CRITICAL(&s_count_lock);
+}
+
+uint32_t history_now(void) {
+  const time_t wall = time(nullptr);
+  if (wall >= kClockSet) {
+    return static_cast<uint32_t>(wall);
+  }
+  return s_base_s + static_cast<uint32_t>(esp_timer_get_time() / 1000000);
+}
+
+#else
+
+esp_err_t history_init(void) {
+  return ESP_OK;
+}
+
+esp_err_t history_record(const history_key_t* key, uint32_t t, double value) {
+  (void)key;
+  (void)t;
+  (void)value;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+size_t history_query(const history_key_t* key, history_tier_t tier, uint32_t from, uint32_t to,
+                     history_point_t* out_points, size_t max_points, history_query_stats_t* out_stats) {
+  (void)key;
+  (void)tier;
+  (void)from;
+  (void)to;
+  (void)out_points;
+  (void)max_points;
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+  return 0;
+}
+
+size_t history_get_series(history_series_t* out_series, size_t max_series) {
+  (void)out_series;
+  (void)max_series;
+  return 0;
+}
+
+esp_err_t history_flush(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void history_get_stats(history_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+uint32_t history_now(void) {
+  return static_cast<uint32_t>(time(nullptr));
+}
+
+#endif  // CONFIG_APP_ENABLE_UART_LINK
+
+const char* history_tier_name(history_tier_t tier) {
+  switch (tier) {
+    case HISTORY_RAW:
+      return "raw";
+    case HISTORY_MINUTE:
+      return "1m";
+    case HISTORY_HOUR:
+      return "1h";
+    default:
+      return "?";
+  }
+}
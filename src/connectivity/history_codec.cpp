@@ -0,0 +1,266 @@
+#include "history_codec.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kNoWindow = 0xFF;
+constexpr uint8_t kCount = 3;
+// Aggregates store the count first, so a decoder knows whether min and max follow.
+constexpr uint8_t kAggregateOrder[HistoryEncoder::kMaxFields] = {kCount, 0, 1, 2};
+
+uint64_t bits_of(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double value_of(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint8_t leading_zeros(uint64_t x) {
+  return static_cast<uint8_t>(__builtin_clzll(x));
+}
+
+uint8_t trailing_zeros(uint64_t x) {
+  return static_cast<uint8_t>(__builtin_ctzll(x));
+}
+
+}  // namespace
+
+HistoryEncoder::HistoryEncoder(uint8_t fields) : fields_(fields < 1 ? 1 : fields > kMaxFields ? kMaxFields : fields) {
+  reset();
+}
+
+void HistoryEncoder::reset() {
+  memset(data_, 0, sizeof(data_));
+  count_ = 0;
+  first_t_ = 0;
+  state_ = {};
+  for (Field& field : state_.field) {
+    field.leading = kNoWindow;
+  }
+}
+
+bool HistoryEncoder::append(uint32_t t, const double* values) {
+  if (count_ == UINT16_MAX) {
+    return false;
+  }
+  const State saved = state_;
+  if (count_ == 0) {
+    first_t_ = t;
+    state_.last_t = t;
+  } else {
+    put_timestamp(t);
+  }
+  const bool aggregate = fields_ == kMaxFields;
+  const bool single = aggregate && values[kCount] == 1.0;
+  for (uint8_t k = 0; k < fields_; ++k) {
+    const uint8_t i = aggregate ? kAggregateOrder[k] : k;
+    if (single && (i == 1 || i == 2)) {
+      state_.field[i].last = bits_of(values[0]);  // min and max of one sample are the sum
+      continue;
+    }
+    put_value(state_.field[i], values[i]);
+  }
+  if (state_.bits > kCapacity * 8) {
+    // Did not fit: clear what was written past the old end and forget it.
+    const uint32_t keep = saved.bits;
+    if (keep % 8) {
+      data_[keep / 8] &= static_cast<uint8_t>(0xFF << (8 - keep % 8));
+    }
+    const size_t from = (keep + 7) / 8;
+    memset(data_ + from, 0, kCapacity - from);
+    state_ = saved;
+    if (count_ == 0) {
+      first_t_ = 0;
+    }
+    return false;
+  }
+  count_++;
+  return true;
+}
+
+void HistoryEncoder::put(uint64_t value, uint8_t width) {
+  for (int bit = width - 1; bit >= 0; --bit) {
+    if (state_.bits < kCapacity * 8 && ((value >> bit) & 1)) {
+      data_[state_.bits / 8] |= static_cast<uint8_t>(0x80 >> (state_.bits % 8));
+    }
+    state_.bits++;  // keeps counting past the end so append() can tell
+  }
+}
+
+void HistoryEncoder::put_timestamp(uint32_t t) {
+  if (t < state_.last_t) {
+    t = state_.last_t;  // never backwards
+  }
+  const int64_t delta = static_cast<int64_t>(t) - state_.last_t;
+  const int64_t dod = delta - state_.last_delta;
+  if (dod == 0) {
+    put(0b0, 1);
+  } else if (dod >= -63 && dod <= 64) {
+    put(0b10, 2);
+    put(static_cast<uint64_t>(dod + 63), 7);
+  } else if (dod >= -255 && dod <= 256) {
+    put(0b110, 3);
+    put(static_cast<uint64_t>(dod + 255), 9);
+  } else if (dod >= -2047 && dod <= 2048) {
+    put(0b1110, 4);
+    put(static_cast<uint64_t>(dod + 2047), 12);
+  } else {
+    put(0b1111, 4);
+    put(static_cast<uint64_t>(delta), 32);  // the gap itself
+  }
+  state_.last_delta = delta;
+  state_.last_t = t;
+}
+
+void HistoryEncoder::put_value(Field& field, double value) {
+  const uint64_t bits = bits_of(value);
+  if (count_ == 0) {
+    put(bits, 64);
+    field.last = bits;
+    return;
+  }
+  const uint64_t x = bits ^ field.last;
+  field.last = bits;
+  if (x == 0) {
+    put(0b0, 1);
+    return;
+  }
+  uint8_t leading = leading_zeros(x);
+  const uint8_t trailing = trailing_zeros(x);
+  if (leading > 31) {
+    leading = 31;  // 5 bits
+  }
+  if (field.leading != kNoWindow && leading >= field.leading && trailing >= field.trailing) {
+    put(0b10, 2);
+    put(x >> field.trailing, static_cast<uint8_t>(64 - field.leading - field.trailing));
+    return;
+  }
+  const uint8_t meaningful = static_cast<uint8_t>(64 - leading - trailing);
+  put(0b11, 2);
+  put(leading, 5);
+  put(meaningful & 0x3F, 6);  // 64 is stored as 0
+  put(x >> trailing, meaningful);
+  field.leading = leading;
+  field.trailing = trailing;
+}
+
+HistoryDecoder::HistoryDecoder(const uint8_t* data, size_t len, uint8_t fields, uint32_t first_t, uint16_t count)
+    : data_(data),
+      bits_(static_cast<uint32_t>(len * 8)),
+      fields_(fields < 1 ? 1 : fields > HistoryEncoder::kMaxFields ? HistoryEncoder::kMaxFields : fields),
+      remaining_(count),
+      last_t_(first_t) {
+  for (Field& field : field_) {
+    field.leading = kNoWindow;
+  }
+}
+
+bool HistoryDecoder::get(uint8_t width, uint64_t* out) {
+  if (pos_ + width > bits_) {
+    return false;
+  }
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < width; ++i, ++pos_) {
+    value = (value << 1) | ((data_[pos_ / 8] >> (7 - pos_ % 8)) & 1);
+  }
+  *out = value;
+  return true;
+}
+
+bool HistoryDecoder::get_value(Field& field, double* out) {
+  uint64_t bits;
+  if (read_ == 0) {
+    if (!get(64, &bits)) {
+      return false;
+    }
+    field.last = bits;
+    field.leading = kNoWindow;
+    *out = value_of(bits);
+    return true;
+  }
+  uint64_t flag;
+  if (!get(1, &flag)) {
+    return false;
+  }
+  if (flag == 0) {
+    *out = value_of(field.last);
+    return true;
+  }
+  if (!get(1, &flag)) {
+    return false;
+  }
+  if (flag == 1) {
+    uint64_t leading;
+    uint64_t meaningful;
+    if (!get(5, &leading) || !get(6, &meaningful)) {
+      return false;
+    }
+    if (meaningful == 0) {
+      meaningful = 64;
+    }
+    if (leading + meaningful > 64) {
+      return false;
+    }
+    field.leading = static_cast<uint8_t>(leading);
+    field.trailing = static_cast<uint8_t>(64 - leading - meaningful);
+  } else if (field.leading == kNoWindow) {
+    return false;
+  }
+  uint64_t x;
+  if (!get(static_cast<uint8_t>(64 - field.leading - field.trailing), &x)) {
+    return false;
+  }
+  field.last ^= x << field.trailing;
+  *out = value_of(field.last);
+  return true;
+}
+
+bool HistoryDecoder::next(uint32_t* t, double* values) {
+  if (remaining_ == 0) {
+    return false;
+  }
+  if (read_ > 0) {
+    uint64_t flag;
+    uint8_t prefix = 0;
+    while (prefix < 4) {
+      if (!get(1, &flag)) {
+        return false;
+      }
+      if (flag == 0) {
+        break;
+      }
+      prefix++;
+    }
+    static constexpr uint8_t kWidth[] = {0, 7, 9, 12, 32};
+    static constexpr int64_t kBias[] = {0, 63, 255, 2047, 0};
+    uint64_t raw = 0;
+    if (prefix > 0 && !get(kWidth[prefix], &raw)) {
+      return false;
+    }
+    const int64_t delta = prefix == 4 ? static_cast<int64_t>(raw) : last_delta_ + static_cast<int64_t>(raw) - kBias[prefix];
+    last_delta_ = delta;
+    last_t_ = static_cast<uint32_t>(last_t_ + delta);
+  }
+  *t = last_t_;
+  const bool aggregate = fields_ == HistoryEncoder::kMaxFields;
+  for (uint8_t k = 0; k < fields_; ++k) {
+    const uint8_t i = aggregate ? kAggregateOrder[k] : k;
+    if (aggregate && values[kCount] == 1.0 && (i == 1 || i == 2)) {
+      values[i] = values[0];
+      field_[i].last = bits_of(values[0]);
+      continue;
+    }
+    if (!get_value(field_[i], &values[i])) {
+      return false;
+    }
+  }
+  read_++;
+  remaining_--;
+  return true;
+}
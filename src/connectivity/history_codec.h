@@ -0,0 +1,106 @@
+#ifndef HISTORY_CODEC_H_
+#define HISTORY_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Gorilla-style compression for the payload of one history block. Timestamps (seconds)
+ * are stored as the change in the gap between samples, in buckets of 1, 9, 12, 16 or 36
+ * bits, so a sensor reporting on a steady period costs one bit per timestamp. Each value
+ * field is XORed with its previous value and only the bits that changed are kept; when
+ * they fall inside the previous window no position is stored. A raw sample has one field,
+ * an aggregate four (sum, min, max, count); an aggregate of one sample stores only its sum
+ * and count. The first timestamp lives in the block header, not the payload.
+ * Pure logic.
+ */
+class HistoryEncoder {
+ public:
+  static constexpr size_t kCapacity = 228;  // payload bytes of a 256-byte block
+  static constexpr int kMaxFields = 4;
+
+  explicit HistoryEncoder(uint8_t fields = 1);
+
+  // Starts an empty block; fields stays as configured.
+  void reset();
+  // Adds a sample; false (and nothing written) when it would not fit.
+  bool append(uint32_t t, const double* values);
+
+  uint16_t count() const {
+    return count_;
+  }
+  uint8_t fields() const {
+    return fields_;
+  }
+  uint32_t first_t() const {
+    return first_t_;
+  }
+  uint32_t last_t() const {
+    return state_.last_t;
+  }
+  // Payload bytes in use, including the partly filled last byte.
+  size_t bytes() const {
+    return (state_.bits + 7) / 8;
+  }
+  const uint8_t* data() const {
+    return data_;
+  }
+
+ private:
+  struct Field {
+    uint64_t last;
+    uint8_t leading;
+    uint8_t trailing;  // window of the last stored XOR; leading 0xFF until one exists
+  };
+
+  struct State {
+    uint32_t bits;
+    uint32_t last_t;
+    int64_t last_delta;
+    Field field[kMaxFields];
+  };
+
+  void put(uint64_t value, uint8_t width);
+  void put_timestamp(uint32_t t);
+  void put_value(Field& field, double value);
+
+  uint8_t data_[kCapacity];
+  uint8_t fields_;
+  uint16_t count_ = 0;
+  uint32_t first_t_ = 0;
+  State state_ = {};
+};
+
+/*
+ * Reads back a payload written by HistoryEncoder. The caller supplies what the block header
+ * records: the field count, the first timestamp and the number of samples.
+ */
+class HistoryDecoder {
+ public:
+  HistoryDecoder(const uint8_t* data, size_t len, uint8_t fields, uint32_t first_t, uint16_t count);
+
+  // Next sample; false at the end of the block or on a truncated payload.
+  bool next(uint32_t* t, double* values);
+
+ private:
+  struct Field {
+    uint64_t last;
+    uint8_t leading;
+    uint8_t trailing;
+  };
+
+  bool get(uint8_t width, uint64_t* out);
+  bool get_value(Field& field, double* out);
+
+  const uint8_t* data_;
+  uint32_t bits_;
+  uint32_t pos_ = 0;
+  uint8_t fields_;
+  uint16_t remaining_;
+  uint16_t read_ = 0;
+  uint32_t last_t_;
+  int64_t last_delta_ = 0;
+  Field field_[HistoryEncoder::kMaxFields] = {};
+};
+
+#endif  // HISTORY_CODEC_H_
@@ -0,0 +1,517 @@
+#include "history_store.h"
+
+#include <cstring>
+#include <new>
+
+namespace {
+
+constexpr uint16_t kBlockMagic = 0x4842;  // "HB"
+constexpr uint16_t kErased = 0xFFFF;
+constexpr uint32_t kPeriod[HistoryStore::kTiers] = {0, 60, 3600};
+constexpr uint8_t kFields[HistoryStore::kTiers] = {1, 4, 4};  // raw value; sum, min, max, count
+
+// CRC-16/CCITT-FALSE, bitwise; a block is 256 bytes.
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= static_cast<uint16_t>(data[i] << 8);
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+bool overlaps(uint32_t first, uint32_t last, uint32_t from, uint32_t to) {
+  return last >= from && first <= to;
+}
+
+}  // namespace
+
+HistoryStore::~HistoryStore() {
+  release();
+}
+
+void HistoryStore::release() {
+  if (owns_ram_) {
+    delete[] series_;
+    delete[] sectors_;
+  }
+  series_ = nullptr;
+  sectors_ = nullptr;
+  owns_ram_ = false;
+}
+
+history_key_t HistoryStore::key_of(const BlockHeader& header) {
+  return {static_cast<uint8_t>(header.tier >> 4), header.short_addr, header.endpoint, header.cluster,
+          header.attribute};
+}
+
+uint64_t HistoryStore::mask_of(const history_key_t& key) {
+  uint32_t h = 2166136261u;  // FNV-1a
+  const uint16_t parts[] = {key.network, key.short_addr, key.endpoint, key.cluster, key.attribute};
+  for (uint16_t part : parts) {
+    h = (h ^ (part & 0xFF)) * 16777619u;
+    h = (h ^ (part >> 8)) * 16777619u;
+  }
+  return 1ull << (h % 64);
+}
+
+bool HistoryStore::same(const history_key_t& a, const history_key_t& b) {
+  return a.network == b.network && a.short_addr == b.short_addr && a.endpoint == b.endpoint &&
+         a.cluster == b.cluster && a.attribute == b.attribute;
+}
+
+uint16_t HistoryStore::crc_of(const BlockHeader& header, const uint8_t* payload) {
+  const uint8_t* raw = reinterpret_cast<const uint8_t*>(&header);
+  uint16_t crc = crc16(0xFFFF, raw, offsetof(BlockHeader, crc));
+  crc = crc16(crc, raw + offsetof(BlockHeader, seq), sizeof(BlockHeader) - offsetof(BlockHeader, seq));
+  return crc16(crc, payload, header.bytes);
+}
+
+bool HistoryStore::mount(const Flash& flash, uint32_t region_bytes, int max_series) {
+  release();
+  const uint32_t sector_count = region_bytes / kSectorBytes;
+  if (sector_count < kMinSectors || max_series <= 0) {
+    return false;
+  }
+  Sector* sectors = new (std::nothrow) Sector[sector_count];
+  Series* series = new (std::nothrow) Series[max_series];
+  if (!sectors || !series) {
+    delete[] series;
+    delete[] sectors;
+    return false;
+  }
+  owns_ram_ = true;
+  return mount_into(flash, region_bytes, series, max_series, sectors, sector_count);
+}
+
+bool HistoryStore::mount_into(const Flash& flash, uint32_t region_bytes, Series* series, int max_series,
+                              Sector* sectors, uint32_t max_sectors) {
+  sector_count_ = region_bytes / kSectorBytes;
+  if (sector_count_ > max_sectors) {
+    sector_count_ = max_sectors;
+  }
+  if (sector_count_ < kMinSectors || max_series <= 0) {
+    return false;
+  }
+  series_ = series;
+  sectors_ = sectors;
+  for (int i = 0; i < max_series; ++i) {
+    series_[i] = Series();
+  }
+  flash_ = flash;
+  max_series_ = max_series;
+  next_seq_ = 1;
+  newest_t_ = 0;
+  samples_ = 0;
+  evictions_ = 0;
+  flash_errors_ = 0;
+  corrupt_blocks_ = 0;
+
+  // A quarter for raw samples, an eighth for minutes and the rest for hours, which are
+  // what a month-long chart reads.
+  const uint32_t raw = sector_count_ / 4;
+  const uint32_t minute = sector_count_ / 8;
+  rings_[HISTORY_RAW] = {0, raw, 0, 0, 0};
+  rings_[HISTORY_MINUTE] = {raw, minute, raw, 0, 0};
+  rings_[HISTORY_HOUR] = {raw + minute, sector_count_ - raw - minute, raw + minute, 0, 0};
+
+  for (int t = 0; t < kTiers; ++t) {
+    Ring& ring = rings_[t];
+    uint32_t head_seq = 0;
+    for (uint32_t i = ring.first; i < ring.first + ring.sectors; ++i) {
+      const uint32_t seq = scan_sector(i, static_cast<history_tier_t>(t));
+      if (seq > head_seq) {
+        head_seq = seq;
+        ring.head = i;
+      }
+      if (seq >= next_seq_) {
+        next_seq_ = seq + 1;
+      }
+    }
+    if (head_seq == 0) {
+      // Nothing of ours: start at the first sector, erasing it, whatever it holds.
+      ring.head = ring.first + ring.sectors - 1;
+      sectors_[ring.head].blocks = kBlocksPerSector;
+    }
+  }
+  return true;
+}
+
+void HistoryStore::forget_sector(uint32_t index) {
+  sectors_[index] = {UINT32_MAX, 0, 0, 0, 0, 0};
+}
+
+void HistoryStore::index_block(uint32_t index, const BlockHeader& header) {
+  Sector& sector = sectors_[index];
+  const history_key_t key = key_of(header);
+  if (header.t_first < sector.t_min) {
+    sector.t_min = header.t_first;
+  }
+  if (header.t_last > sector.t_max) {
+    sector.t_max = header.t_last;
+  }
+  if (header.t_last > newest_t_) {
+    newest_t_ = header.t_last;
+  }
+  sector.series_mask |= mask_of(key);
+  sector.points += header.count;
+  sector.payload_bytes = static_cast<uint16_t>(sector.payload_bytes + header.bytes);
+}
+
+bool HistoryStore::read_block(uint32_t index, int block, BlockHeader* header, bool with_payload) {
+  const uint32_t offset = index * kSectorBytes + block * kBlockBytes;
+  if (!flash_.read(flash_.ctx, offset, header, sizeof(*header))) {
+    flash_errors_++;
+    return false;
+  }
+  if (header->magic != kBlockMagic || tier_of(*header) >= kTiers || header->bytes > HistoryEncoder::kCapacity) {
+    return false;
+  }
+  if (!with_payload) {
+    return true;
+  }
+  uint8_t* payload = scratch_ + sizeof(BlockHeader);
+  if (!flash_.read(flash_.ctx, offset + sizeof(BlockHeader), payload, header->bytes)) {
+    flash_errors_++;
+    return false;
+  }
+  if (crc_of(*header, payload) != header->crc) {
+    corrupt_blocks_++;
+    return false;
+  }
+  return true;
+}
+
+uint32_t HistoryStore::scan_sector(uint32_t index, history_tier_t tier) {
+  forget_sector(index);
+  uint32_t max_seq = 0;
+  for (int b = 0; b < kBlocksPerSector; ++b) {
+    BlockHeader header = {};
+    if (!read_block(index, b, &header, true)) {
+      if (header.magic != kErased) {
+        sectors_[index].blocks = static_cast<uint8_t>(b + 1);  // occupied, so never written over
+      }
+      continue;
+    }
+    sectors_[index].blocks = static_cast<uint8_t>(b + 1);
+    if (tier_of(header) != tier) {
+      continue;  // left over from a different layout
+    }
+    index_block(index, header);
+    if (header.seq > max_seq) {
+      max_seq = header.seq;
+    }
+  }
+  return max_seq;
+}
+
+bool HistoryStore::write_block(history_tier_t tier, const BlockHeader& header, const uint8_t* payload) {
+  Ring& ring = rings_[tier];
+  if (sectors_[ring.head].blocks >= kBlocksPerSector) {
+    ring.head = ring.first + (ring.head - ring.first + 1) % ring.sectors;
+    forget_sector(ring.head);
+  }
+  Sector& sector = sectors_[ring.head];
+  const uint32_t sector_offset = ring.head * kSectorBytes;
+  if (sector.blocks == 0) {
+    // Dropping the oldest sector of the ring, or claiming one never written.
+    if (!flash_.erase(flash_.ctx, sector_offset, kSectorBytes)) {
+      flash_errors_++;
+      return false;
+    }
+    ring.erases++;
+  }
+  memcpy(scratch_, &header, sizeof(header));
+  memcpy(scratch_ + sizeof(header), payload, header.bytes);
+  const uint32_t offset = sector_offset + sector.blocks * kBlockBytes;
+  sector.blocks++;  // even on failure: the block may be half written
+  if (!flash_.write(flash_.ctx, offset, scratch_, sizeof(header) + header.bytes)) {
+    flash_errors_++;
+    return false;
+  }
+  index_block(ring.head, header);
+  ring.blocks_written++;
+  return true;
+}
+
+void HistoryStore::write_open(Series& series, history_tier_t tier) {
+  HistoryEncoder& open = series.open[tier];
+  if (open.count() == 0) {
+    return;
+  }
+  BlockHeader header = {};
+  header.magic = kBlockMagic;
+  header.tier = static_cast<uint8_t>(series.key.network << 4 | tier);
+  header.endpoint = series.key.endpoint;
+  header.short_addr = series.key.short_addr;
+  header.cluster = series.key.cluster;
+  header.attribute = series.key.attribute;
+  header.count = open.count();
+  header.bytes = static_cast<uint16_t>(open.bytes());
+  header.seq = next_seq_++;
+  header.t_first = open.first_t();
+  header.t_last = open.last_t();
+  header.crc = crc_of(header, open.data());
+  write_block(tier, header, open.data());
+  open.reset();  // a failed write loses the block rather than wedging the series
+}
+
+void HistoryStore::add_point(Series& series, history_tier_t tier, uint32_t t, const double* values) {
+  if (series.open[tier].append(t, values)) {
+    return;
+  }
+  write_open(series, tier);
+  series.open[tier].append(t, values);
+}
+
+void HistoryStore::close_bucket(Series& series, history_tier_t tier) {
+  Bucket& bucket = series.bucket[tier];
+  if (bucket.count == 0) {
+    return;
+  }
+  const double values[] = {bucket.sum, bucket.min, bucket.max, static_cast<double>(bucket.count)};
+  add_point(series, tier, bucket.start, values);
+  bucket = {};
+}
+
+HistoryStore::Series* HistoryStore::find(const history_key_t& key, bool claim) {
+  Series* free_series = nullptr;
+  Series* idle = nullptr;
+  for (int i = 0; i < max_series_; ++i) {
+    Series& series = series_[i];
+    if (!series.used) {
+      if (!free_series) {
+        free_series = &series;
+      }
+      continue;
+    }
+    if (same(series.key, key)) {
+      return &series;
+    }
+    if (!idle || series.last_t < idle->last_t) {
+      idle = &series;
+    }
+  }
+  if (!claim) {
+    return nullptr;
+  }
+  Series* claimed = free_series;
+  if (!claimed) {
+    claimed = idle;
+    for (int t = HISTORY_MINUTE; t < kTiers; ++t) {
+      close_bucket(*claimed, static_cast<history_tier_t>(t));
+    }
+    for (int t = 0; t < kTiers; ++t) {
+      write_open(*claimed, static_cast<history_tier_t>(t));
+    }
+    evictions_++;
+  }
+  *claimed = Series();
+  claimed->used = true;
+  claimed->key = key;
+  for (int t = 0; t < kTiers; ++t) {
+    claimed->open[t] = HistoryEncoder(kFields[t]);
+  }
+  return claimed;
+}
+
+void HistoryStore::record(const history_key_t& key, uint32_t t, double value) {
+  if (!series_) {
+    return;
+  }
+  Series& series = *find(key, true);
+  if (series.samples && t < series.last_t) {
+    t = series.last_t;
+  }
+  add_point(series, HISTORY_RAW, t, &value);
+  for (int i = HISTORY_MINUTE; i < kTiers; ++i) {
+    const history_tier_t tier = static_cast<history_tier_t>(i);
+    Bucket& bucket = series.bucket[tier];
+    const uint32_t start = t - t % kPeriod[tier];
+    if (bucket.count && bucket.start != start) {
+      close_bucket(series, tier);
+    }
+    if (bucket.count == 0) {
+      bucket = {start, 0, 0, value, value};
+    }
+    bucket.count++;
+    bucket.sum += value;
+    if (value < bucket.min) {
+      bucket.min = value;
+    }
+    if (value > bucket.max) {
+      bucket.max = value;
+    }
+  }
+  series.samples++;
+  series.last_t = t;
+  series.last_value = value;
+  samples_++;
+  if (t > newest_t_) {
+    newest_t_ = t;
+  }
+}
+
+void HistoryStore::flush() {
+  if (!series_) {
+    return;
+  }
+  for (int i = 0; i < max_series_; ++i) {
+    Series& series = series_[i];
+    if (!series.used) {
+      continue;
+    }
+    for (int t = HISTORY_MINUTE; t < kTiers; ++t) {
+      close_bucket(series, static_cast<history_tier_t>(t));
+    }
+    for (int t = 0; t < kTiers; ++t) {
+      write_open(series, static_cast<history_tier_t>(t));
+    }
+  }
+}
+
+namespace {
+
+// Appends a decoded sample, merging aggregates of the same period (split by a flush).
+bool emit(history_tier_t tier, uint32_t t, const double* values, history_point_t* out, size_t* count,
+          size_t max) {
+  history_point_t point;
+  if (tier == HISTORY_RAW) {
+    point = {t, values[0], values[0], values[0], 1};
+  } else {
+    const uint32_t n = static_cast<uint32_t>(values[3]);
+    point = {t, n ? values[0] / n : 0, values[1], values[2], n};
+    if (*count > 0 && out[*count - 1].t == t) {
+      history_point_t& last = out[*count - 1];
+      const uint32_t total = last.count + n;
+      last.mean = total ? (last.mean * last.count + values[0]) / total : 0;
+      last.min = point.min < last.min ? point.min : last.min;
+      last.max = point.max > last.max ? point.max : last.max;
+      last.count = total;
+      return true;
+    }
+  }
+  if (*count == max) {
+    return false;
+  }
+  out[(*count)++] = point;
+  return true;
+}
+
+}  // namespace
+
+size_t HistoryStore::query(const history_key_t& key, history_tier_t tier, uint32_t from, uint32_t to, history_point_t* out, size_t max,
+                           history_query_stats_t* stats) {
+  history_query_stats_t local = {};
+  size_t count = 0;
+  if (!series_ || !out || max == 0 || tier >= kTiers) {
+    return 0;
+  }
+  const Ring& ring = rings_[tier];
+  const uint64_t mask = mask_of(key);
+  double values[HistoryEncoder::kMaxFields];
+  bool room = true;
+  // Oldest sector first: the one after the head.
+  for (uint32_t k = 1; k <= ring.sectors && room; ++k) {
+    const uint32_t index = ring.first + (ring.head - ring.first + k) % ring.sectors;
+    const Sector& sector = sectors_[index];
+    if (sector.points == 0 || !(sector.series_mask & mask) || !overlaps(sector.t_min, sector.t_max, from, to)) {
+      local.sectors_skipped++;
+      continue;
+    }
+    for (int b = 0; b < sector.blocks && room; ++b) {
+      BlockHeader header;
+      local.headers_read++;
+      if (!read_block(index, b, &header, false) || tier_of(header) != tier || !same(key_of(header), key) ||
+          !overlaps(header.t_first, header.t_last, from, to) || !read_block(index, b, &header, true)) {
+        continue;
+      }
+      local.blocks_decoded++;
+      HistoryDecoder decoder(scratch_ + sizeof(BlockHeader), header.bytes, kFields[tier], header.t_first, header.count);
+      uint32_t t;
+      while (room && decoder.next(&t, values)) {
+        if (t >= from && t <= to) {
+          room = emit(tier, t, values, out, &count, max);
+        }
+      }
+    }
+  }
+  Series* series = find(key, false);
+  if (series && room) {
+    const HistoryEncoder& open = series->open[tier];
+    HistoryDecoder decoder(open.data(), open.bytes(), open.fields(), open.first_t(), open.count());
+    uint32_t t;
+    while (room && decoder.next(&t, values)) {
+      if (t >= from && t <= to) {
+        room = emit(tier, t, values, out, &count, max);
+      }
+    }
+    const Bucket& bucket = series->bucket[tier];
+    if (room && tier != HISTORY_RAW && bucket.count && bucket.start >= from && bucket.start <= to) {
+      const double partial[] = {bucket.sum, bucket.min, bucket.max, static_cast<double>(bucket.count)};
+      emit(tier, bucket.start, partial, out, &count, max);
+    }
+  }
+  if (stats) {
+    *stats = local;
+  }
+  return count;
+}
+
+int HistoryStore::series_count() const {
+  int count = 0;
+  for (int i = 0; i < max_series_; ++i) {
+    count += series_[i].used ? 1 : 0;
+  }
+  return count;
+}
+
+bool HistoryStore::series(int index, history_series_t* out) const {
+  for (int i = 0; i < max_series_; ++i) {
+    if (!series_[i].used) {
+      continue;
+    }
+    if (index-- == 0) {
+      *out = {series_[i].key, series_[i].samples, series_[i].last_t, series_[i].last_value};
+      return true;
+    }
+  }
+  return false;
+}
+
+void HistoryStore::fill_stats(history_stats_t* out) const {
+  out->samples = samples_;
+  out->series = series_ ? static_cast<uint32_t>(series_count()) : 0;
+  out->max_series = static_cast<uint32_t>(max_series_);
+  out->evictions = evictions_;
+  out->flash_errors = flash_errors_;
+  out->corrupt_blocks = corrupt_blocks_;
+  for (int t = 0; t < kTiers; ++t) {
+    out->tier[t] = {};
+  }
+  if (!sectors_) {
+    return;
+  }
+  for (int t = 0; t < kTiers; ++t) {
+    const Ring& ring = rings_[t];
+    history_tier_stats_t& tier = out->tier[t];
+    tier.sectors = ring.sectors;
+    tier.blocks_written = ring.blocks_written;
+    tier.erases = ring.erases;
+    uint32_t oldest = UINT32_MAX;
+    for (uint32_t i = ring.first; i < ring.first + ring.sectors; ++i) {
+      const Sector& sector = sectors_[i];
+      if (sector.points == 0) {
+        continue;
+      }
+      tier.blocks += sector.blocks;
+      tier.points += sector.points;
+      tier.payload_bytes += sector.payload_bytes;
+      if (sector.t_min < oldest) {
+        oldest = sector.t_min;
+      }
+    }
+    tier.oldest_t = oldest == UINT32_MAX ? 0 : oldest;
+  }
+}
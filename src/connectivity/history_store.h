@@ -0,0 +1,178 @@
+#ifndef HISTORY_STORE_H_
+#define HISTORY_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "history_codec.h"
+#include "include/history.h"
+
+/*
+ * Time-series store for sensor history in a region of flash. Samples are compressed into
+ * fixed 256-byte blocks (see HistoryEncoder), one open block per series and tier in RAM,
+ * and each full block is appended to its tier's ring of 4 KB sectors; when a ring wraps,
+ * its oldest sector is erased. Every sample also feeds a 1-minute and a 1-hour aggregate
+ * (sum, min, max, count), written to their own rings when the period closes, so hourly
+ * history outlives the raw samples by far. A RAM index keeps each sector's time span and
+ * a 64-bit series filter; a query reads the headers of only the sectors that can hold the
+ * series in range, and decodes only the blocks that do. mount() rebuilds the index and the
+ * ring heads from the block headers.
+ * Pure logic; the caller supplies the flash, the clock and the locking.
+ */
+class HistoryStore {
+ public:
+  static constexpr uint32_t kBlockBytes = 256;
+  static constexpr uint32_t kSectorBytes = 4096;
+  static constexpr int kBlocksPerSector = kSectorBytes / kBlockBytes;
+  static constexpr int kTiers = HISTORY_TIERS;
+  static constexpr uint32_t kMinSectors = 8;
+
+  // Offsets are relative to the start of the region; false on any flash error.
+  struct Flash {
+    bool (*read)(void* ctx, uint32_t offset, void* out, size_t len);
+    bool (*write)(void* ctx, uint32_t offset, const void* data, size_t len);
+    bool (*erase)(void* ctx, uint32_t offset, size_t len);
+    void* ctx;
+  };
+
+  HistoryStore() = default;
+  ~HistoryStore();
+  HistoryStore(const HistoryStore&) = delete;
+  HistoryStore& operator=(const HistoryStore&) = delete;
+
+  // RAM for kMaxSeries open series and the index of up to kMaxSectors sectors, for a
+  // caller that keeps it out of the heap. The store only borrows it.
+  template <int kMaxSeries, uint32_t kMaxSectors>
+  struct Storage;
+
+  // Claims a region of region_bytes (whole sectors, at least kMinSectors) and RAM for
+  // max_series open series, then scans the region. False if the RAM is not there.
+  bool mount(const Flash& flash, uint32_t region_bytes, int max_series);
+  // As above, in storage; sectors past kMaxSectors are left unused.
+  template <int kMaxSeries, uint32_t kMaxSectors>
+  bool mount(const Flash& flash, uint32_t region_bytes, Storage<kMaxSeries, kMaxSectors>& storage) {
+    release();
+    return mount_into(flash, region_bytes, storage.series, kMaxSeries, storage.sectors, kMaxSectors);
+  }
+  bool mounted() const {
+    return series_ != nullptr;
+  }
+
+  // Times must not go backwards per series; a sample older than the last is stored at the last time.
+  void record(const history_key_t& key, uint32_t t, double value);
+  // Writes every open block and aggregate in progress, partly filled or not. Later samples
+  // for an unfinished period add a second aggregate with the same start; queries merge them.
+  void flush();
+
+  // Points of one series with from <= t <= to, oldest first, including what is still in RAM.
+  size_t query(const history_key_t& key, history_tier_t tier, uint32_t from, uint32_t to, history_point_t* out,
+               size_t max, history_query_stats_t* stats = nullptr);
+
+  int series_count() const;
+  bool series(int index, history_series_t* out) const;
+  // Newest timestamp on flash or in RAM; 0 for an empty store.
+  uint32_t newest_t() const {
+    return newest_t_;
+  }
+  // Store and per-tier fields only; the caller fills in the rest.
+  void fill_stats(history_stats_t* out) const;
+
+ private:
+  struct __attribute__((packed)) BlockHeader {
+    uint16_t magic;
+    uint8_t tier;  // low nibble; the high one holds the series' network, 0 in older blocks
+    uint8_t endpoint;
+    uint16_t short_addr;
+    uint16_t cluster;
+    uint16_t attribute;
+    uint16_t count;
+    uint16_t bytes;  // payload bytes
+    uint16_t crc;    // of the header up to here, then seq onwards, then the payload
+    uint32_t seq;
+    uint32_t t_first;
+    uint32_t t_last;
+  };
+  static_assert(sizeof(BlockHeader) + HistoryEncoder::kCapacity == kBlockBytes, "block layout");
+
+  struct Bucket {
+    uint32_t start;
+    uint32_t count;
+    double sum;
+    double min;
+    double max;
+  };
+
+  struct Series {
+    bool used;
+    history_key_t key;
+    uint32_t samples;
+    uint32_t last_t;
+    double last_value;
+    Bucket bucket[kTiers];  // minute and hour; the raw one is unused
+    HistoryEncoder open[kTiers];
+  };
+
+  struct Sector {
+    uint32_t t_min;
+    uint32_t t_max;
+    uint64_t series_mask;
+    uint32_t points;
+    uint16_t payload_bytes;
+    uint8_t blocks;  // written, valid or not; the next write goes after them
+  };
+
+  struct Ring {
+    uint32_t first;    // sector index into sectors_
+    uint32_t sectors;
+    uint32_t head;     // sector being filled
+    uint32_t blocks_written;
+    uint32_t erases;
+  };
+
+  static history_key_t key_of(const BlockHeader& header);
+  static history_tier_t tier_of(const BlockHeader& header) {
+    return static_cast<history_tier_t>(header.tier & 0x0F);
+  }
+  static uint64_t mask_of(const history_key_t& key);
+  static bool same(const history_key_t& a, const history_key_t& b);
+  static uint16_t crc_of(const BlockHeader& header, const uint8_t* payload);
+
+  void release();
+  bool mount_into(const Flash& flash, uint32_t region_bytes, Series* series, int max_series, Sector* sectors,
+                  uint32_t max_sectors);
+
+  Series* find(const history_key_t& key, bool claim);
+  void add_point(Series& series, history_tier_t tier, uint32_t t, const double* values);
+  void close_bucket(Series& series, history_tier_t tier);
+  void write_open(Series& series, history_tier_t tier);
+  bool write_block(history_tier_t tier, const BlockHeader& header, const uint8_t* payload);
+  bool read_block(uint32_t index, int block, BlockHeader* header, bool with_payload);
+  // Indexes the valid blocks of a sector; returns the highest sequence number found, 0 for none.
+  uint32_t scan_sector(uint32_t index, history_tier_t tier);
+  void forget_sector(uint32_t index);
+  void index_block(uint32_t index, const BlockHeader& header);
+
+  Flash flash_ = {};
+  Series* series_ = nullptr;
+  int max_series_ = 0;
+  Sector* sectors_ = nullptr;
+  uint32_t sector_count_ = 0;
+  bool owns_ram_ = false;  // series_ and sectors_ came from mount(), not from a Storage
+  Ring rings_[kTiers] = {};
+  uint32_t next_seq_ = 1;
+  uint32_t newest_t_ = 0;
+  uint32_t samples_ = 0;
+  uint32_t evictions_ = 0;
+  uint32_t flash_errors_ = 0;
+  uint32_t corrupt_blocks_ = 0;
+  uint8_t scratch_[kBlockBytes];
+};
+
+template <int kMaxSeries, uint32_t kMaxSectors>
+struct HistoryStore::Storage {
+  static_assert(kMaxSeries > 0 && kMaxSectors >= kMinSectors, "storage too small");
+  Series series[kMaxSeries];
+  Sector sectors[kMaxSectors];
+};
+
+#endif  // HISTORY_STORE_H_
@@ -0,0 +1,88 @@
+#ifndef ATTR_INGEST_H_
+#define ATTR_INGEST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "zb_command_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ATTR_INGEST_ANY 0xFFFF  // rule wildcard for cluster or attribute
+
+/*
+ * Change filter for one attribute, or a family of them via ATTR_INGEST_ANY. A value is
+ * significant when it moved from the last forwarded value by at least the larger of the
+ * two deadbands; with both 0 any change is. Non-integer ZCL types compare byte for byte.
+ */
+typedef struct {
+  uint16_t cluster;
+  uint16_t attribute;
+  uint32_t deadband_abs;       // raw ZCL units, e.g. 10 = 0.1 degC for temperature
+  uint16_t deadband_permille;  // of the last forwarded value
+  uint32_t min_interval_ms;    // forward at most once per interval; the latest value wins
+  uint32_t max_interval_ms;    // forward an unchanged value once this old; 0 = never
+} attr_ingest_rule_t;
+
+typedef struct {
+  uint32_t received;   // reports decoded from ATTR_UPDATE frames
+  uint32_t forwarded;  // handed to subscribers
+  uint32_t filtered;   // within the deadband of the last forwarded value
+  uint32_t coalesced;  // replaced by a newer value inside the minimum interval
+  uint32_t held;       // waiting for their interval to close, now
+  uint32_t untracked;  // forwarded unfiltered because every table entry was holding a value
+  uint32_t evictions;  // idle attributes dropped from the table for new ones
+  uint32_t malformed_frames;
+  uint32_t entries;  // attributes tracked, now
+  uint32_t devices;
+} attr_ingest_stats_t;
+
+typedef struct {
+  uint8_t network;  // zb_devices network: uart_link index or ZB_DEVICES_NATIVE
+  uint16_t short_addr;
+  uint32_t received;
+  uint32_t forwarded;
+  uint32_t filtered;
+  uint32_t coalesced;
+} attr_ingest_device_t;
+
+/*
+ * Receives every forwarded report. network is the zb_devices network it came from, so
+ * report->source is only unique together with it. rx_us is the esp_timer time the value
+ * arrived; pass both to zb_command_send() for commands the report triggers. Runs on the
+ * link RX task, or the esp_timer task for values released at the end of their interval,
+ * so do not block.
+ */
+typedef void (*attr_ingest_cb_t)(uint8_t network, const zb_attr_report_t* report, int64_t rx_us, void* ctx);
+
+/**
+ * @brief Filter ATTR_UPDATE frames from the H2 and fan the remaining reports out to
+ *        subscribers. Call after uart_link_init().
+ */
+esp_err_t attr_ingest_init(void);
+
+/**
+ * @brief Register a consumer (rules, persistence, bridges). Up to four; call at startup.
+ */
+esp_err_t attr_ingest_subscribe(attr_ingest_cb_t cb, void* ctx);
+
+/**
+ * @brief Add a rule, or replace the one with the same cluster and attribute. The most
+ *        specific rule applies; ANY/ANY replaces the Kconfig default.
+ */
+esp_err_t attr_ingest_set_rule(const attr_ingest_rule_t* rule);
+size_t attr_ingest_get_rules(attr_ingest_rule_t* out_rules, size_t max_rules);
+
+void attr_ingest_get_stats(attr_ingest_stats_t* out_stats);
+/* Per-device counters, busiest first; returns the number written. */
+size_t attr_ingest_get_devices(attr_ingest_device_t* out_devices, size_t max_devices);
+void attr_ingest_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ATTR_INGEST_H_
@@ -1,11 +1,26 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "esp_err.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct {
+  uint16_t interval_ms;  // 3..10240; 0 = controller default
+  uint16_t window_ms;    // <= interval_ms; 0 = controller default
+  bool passive;          // listen only, no scan requests on the air
+} bluetooth_scan_params_t;
+
+typedef struct {
+  uint32_t adverts;  // advertising reports since boot
+  uint32_t scan_ms;  // time spent scanning since boot, the running scan included
+  bool scanning;
+} bluetooth_scan_stats_t;
+
 /**
  * @brief Initialize the Bluetooth stack (NimBLE)
  * @return ESP_OK on success
@@ -19,6 +34,17 @@ esp_err_t bluetooth_manager_init(void);
  */
 esp_err_t bluetooth_manager_start_scan(int duration_sec);
 
+/**
+ * @brief Set the interval, window and mode used by the next scan.
+ * @return ESP_ERR_INVALID_ARG if the window exceeds the interval or either is out of range
+ */
+esp_err_t bluetooth_manager_set_scan_params(const bluetooth_scan_params_t* params);
+
+/**
+ * @brief Advertising reports and scan time, for per-policy rates
+ */
+void bluetooth_manager_get_scan_stats(bluetooth_scan_stats_t* out_stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,68 @@
+#ifndef H2_LOG_H_
+#define H2_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Latest counter snapshot from the H2. */
+typedef struct {
+  bool valid;             // at least one snapshot received since boot
+  uint32_t age_ms;        // since the snapshot arrived
+  uint32_t h2_uptime_ms;  // H2 uptime when it was taken
+  uint32_t zb_queue_depth;
+  uint32_t zb_queue_high_water;
+  uint32_t mac_retries;  // cumulative
+  uint32_t mac_tx_failures;
+  uint32_t child_count;
+  uint32_t neighbor_count;
+  uint32_t free_heap;
+  uint32_t min_free_heap;
+  uint32_t log_dropped;  // records the H2 discarded, cumulative
+} h2_metrics_t;
+
+typedef struct {
+  uint32_t records;       // log records received
+  uint32_t printed;       // handed to the log pipeline
+  uint32_t rate_limited;  // dropped by the C6 rate limit
+  uint32_t h2_dropped;    // gaps the H2 reported in its record stream
+  uint32_t metrics_frames;
+  uint32_t malformed_frames;
+  uint32_t bytes;  // log and metrics payload bytes
+  uint8_t level;   // esp_log_level_t requested from the H2
+  uint16_t max_records_per_s;
+  uint16_t metrics_period_ms;
+} h2_log_stats_t;
+
+/**
+ * @brief Start accepting the H2 log and metrics stream. H2 records are written through
+ *        esp_log with tag "H2", so they share the deferred log pipeline and its level
+ *        filter. Call after uart_link_init().
+ */
+esp_err_t h2_log_init(void);
+
+/**
+ * @brief Set what the H2 sends: records at or above level, at most max_records_per_s,
+ *        and a metrics snapshot every metrics_period_ms (0 = off). The C6 enforces the
+ *        same rate on what it prints. Resent whenever the link comes up.
+ */
+esp_err_t h2_log_configure(uint8_t level, uint16_t max_records_per_s, uint16_t metrics_period_ms);
+
+void h2_log_get_stats(h2_log_stats_t* out_stats);
+void h2_log_get_metrics(h2_metrics_t* out_metrics);
+
+/**
+ * @brief Print the most recent H2 records (kept even when the "H2" tag is filtered).
+ */
+void h2_log_print_tail(uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // H2_LOG_H_
@@ -0,0 +1,88 @@
+#ifndef H2_OTA_H_
+#define H2_OTA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Images are staged in the first megabyte of the storage partition; history.h owns the rest.
+#define H2_OTA_STAGING_BYTES 0x100000
+
+typedef enum {
+  H2_OTA_IDLE = 0,    // nothing staged
+  H2_OTA_STAGING,     // image being written into the storage partition
+  H2_OTA_STAGED,      // verified image waiting to be sent
+  H2_OTA_CONNECTING,  // BEGIN sent; waiting for the H2's resume offset
+  H2_OTA_STREAMING,
+  H2_OTA_VERIFYING,  // all bytes acknowledged; H2 checking the image CRC
+  H2_OTA_DONE,       // H2 accepted the image and switches partitions
+  H2_OTA_FAILED,
+} h2_ota_state_t;
+
+typedef struct {
+  h2_ota_state_t state;
+  uint32_t image_size;
+  uint32_t image_crc32;
+  uint32_t staged_bytes;
+  uint32_t acked_bytes;   // bytes the H2 has confirmed
+  uint32_t resumed_from;  // offset the H2 already held when the transfer (re)started
+  uint32_t chunks_sent;
+  uint32_t retransmits;
+  uint32_t timeouts;
+  uint32_t elapsed_ms;   // since h2_ota_start()
+  uint32_t bytes_per_s;  // acknowledged payload rate
+  uint8_t failure;       // H2 status code (or 0xFF for timeout) when FAILED
+} h2_ota_status_t;
+
+/**
+ * @brief Find the staging partition and pick up a previously staged image.
+ *        Call after uart_link_init().
+ */
+esp_err_t h2_ota_init(void);
+
+/**
+ * @brief Start staging an H2 image of image_size bytes into the storage partition.
+ *        Sectors are erased as the writes reach them.
+ */
+esp_err_t h2_ota_stage_begin(uint32_t image_size);
+
+/**
+ * @brief Append image bytes; calls must be sequential.
+ */
+esp_err_t h2_ota_stage_write(const void* data, size_t len);
+
+/**
+ * @brief Read the staged image back, check its CRC32 and mark it ready.
+ *
+ * @param expected_crc32 CRC32 supplied with the image, or 0 to accept the computed one.
+ * @return ESP_ERR_INVALID_CRC on mismatch, ESP_ERR_INVALID_SIZE if fewer bytes were written.
+ */
+esp_err_t h2_ota_stage_finish(uint32_t expected_crc32);
+
+/**
+ * @brief Send the staged image to the H2 on the primary link in the background. A transfer
+ *        that was interrupted resumes from the offset the H2 reports.
+ */
+esp_err_t h2_ota_start(void);
+/**
+ * @brief Same, on the given UART link. Every link has its own relay; they all read the one
+ *        staged image and may run at once. Staging waits until none is running.
+ */
+esp_err_t h2_ota_start_on(uint8_t link);
+
+esp_err_t h2_ota_abort(void);
+esp_err_t h2_ota_abort_on(uint8_t link);
+void h2_ota_get_status(h2_ota_status_t* out_status);
+void h2_ota_get_status_on(uint8_t link, h2_ota_status_t* out_status);
+const char* h2_ota_state_name(h2_ota_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // H2_OTA_H_
@@ -0,0 +1,124 @@
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  HISTORY_RAW = 0,  // every forwarded report
+  HISTORY_MINUTE,   // one aggregate per series and minute
+  HISTORY_HOUR,
+} history_tier_t;
+
+#define HISTORY_TIERS 3
+
+/* One series: an attribute of a device endpoint. Short addresses are per network. */
+typedef struct {
+  uint8_t network;  // zb_devices network, 0-15: uart_link index or ZB_DEVICES_NATIVE
+  uint16_t short_addr;
+  uint8_t endpoint;
+  uint16_t cluster;
+  uint16_t attribute;
+} history_key_t;
+
+/*
+ * A sample, or the aggregate of a minute or hour starting at t. Raw points carry the
+ * value in mean, min and max with count 1. Times are seconds; see history_now().
+ */
+typedef struct {
+  uint32_t t;
+  double mean;
+  double min;
+  double max;
+  uint32_t count;
+} history_point_t;
+
+typedef struct {
+  history_key_t key;
+  uint32_t samples;  // recorded since boot
+  uint32_t last_t;
+  double last_value;
+} history_series_t;
+
+typedef struct {
+  uint32_t sectors;
+  uint32_t blocks;          // on flash now
+  uint32_t points;          // on flash now
+  uint32_t payload_bytes;   // compressed size of those points
+  uint32_t blocks_written;  // since boot
+  uint32_t erases;          // since boot
+  uint32_t oldest_t;        // 0 while empty
+} history_tier_stats_t;
+
+typedef struct {
+  bool mounted;
+  uint32_t region_bytes;
+  uint32_t mount_ms;
+  uint32_t samples;      // recorded since boot
+  uint32_t series;       // open in RAM
+  uint32_t max_series;
+  uint32_t evictions;    // idle series written out early to make room
+  uint32_t dropped;      // reports lost to a full queue
+  uint32_t unsupported;  // reports of non-numeric attributes
+  uint32_t flash_errors;
+  uint32_t corrupt_blocks;
+  history_tier_stats_t tier[HISTORY_TIERS];
+} history_stats_t;
+
+typedef struct {
+  uint32_t sectors_skipped;  // ruled out by the in-RAM index
+  uint32_t headers_read;
+  uint32_t blocks_decoded;
+  uint32_t elapsed_us;
+} history_query_stats_t;
+
+/**
+ * @brief Mount the history region behind the H2 staging area of the storage partition,
+ *        start the writer task and record every report attr_ingest forwards.
+ *        Call after attr_ingest_init().
+ */
+esp_err_t history_init(void);
+
+/**
+ * @brief Queue a sample from a source other than Zigbee attribute reports.
+ */
+esp_err_t history_record(const history_key_t* key, uint32_t t, double value);
+
+/**
+ * @brief Points of one series with from <= t <= to, oldest first, up to max; includes what
+ *        has not reached flash yet. Blocks the caller while flash is read.
+ */
+size_t history_query(const history_key_t* key, history_tier_t tier, uint32_t from, uint32_t to,
+                     history_point_t* out_points, size_t max_points, history_query_stats_t* out_stats);
+
+/* Series open in RAM; returns the number written. */
+size_t history_get_series(history_series_t* out_series, size_t max_series);
+
+/**
+ * @brief Write every partly filled block to flash, e.g. before a restart. Each flush costs
+ *        up to three partly used blocks per series, so do not call it periodically.
+ */
+esp_err_t history_flush(void);
+
+void history_get_stats(history_stats_t* out_stats);
+
+/**
+ * @brief Seconds used for timestamps: the system clock once it has been set, before that
+ *        the newest stored timestamp plus uptime, so history stays ordered across reboots.
+ */
+uint32_t history_now(void);
+
+const char* history_tier_name(history_tier_t tier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HISTORY_H_
@@ -0,0 +1,72 @@
+#ifndef OTA_CLIENT_H_
+#define OTA_CLIENT_H_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  OTA_CLIENT_IDLE = 0,
+  OTA_CLIENT_DOWNLOADING,  // receiving into the inactive slot
+  OTA_CLIENT_RESUMING,     // connection lost; waiting for WiFi to re-request the rest
+  OTA_CLIENT_VERIFYING,    // image complete; checking it before switching otadata
+  OTA_CLIENT_READY,        // boot partition switched; runs after the next restart
+  OTA_CLIENT_FAILED,
+} ota_client_state_t;
+
+typedef struct {
+  ota_client_state_t state;
+  char partition[17];       // label of the slot being written, "h2" for an H2 image
+  uint32_t image_size;      // from Content-Length/Content-Range, 0 while unknown
+  uint32_t received_bytes;  // bytes taken from the network
+  uint32_t written_bytes;   // bytes committed to flash
+  uint32_t resumes;         // ranged requests after a dropped connection
+  uint32_t elapsed_ms;      // since ota_client_start()
+  uint32_t bytes_per_s;     // written bytes over elapsed time
+  uint32_t net_wait_ms;     // flash writer idle, waiting for the network
+  uint32_t flash_wait_ms;   // download stalled, both buffers waiting for flash
+  esp_err_t error;          // reason when FAILED
+} ota_client_status_t;
+
+/**
+ * @brief If the running image is still pending verification after an update, start a check
+ *        that confirms it once WiFi is connected and the H2 link is up, or rolls back to the
+ *        previous image after CONFIG_APP_OTA_HEALTH_TIMEOUT_S. Call after WiFi init.
+ */
+esp_err_t ota_client_init(void);
+
+/**
+ * @brief Download a firmware image over HTTP(S) into the inactive OTA slot in the background.
+ *        Network receive and flash writes overlap through two buffers; a dropped connection
+ *        resumes with a Range request. The boot partition only changes once the image has
+ *        been verified.
+ *
+ * @param url http:// or https:// URL of the .bin image.
+ * @param sha256_hex Optional expected SHA-256 of the image (64 hex characters), or NULL.
+ * @return ESP_ERR_INVALID_STATE if an update is already running.
+ */
+esp_err_t ota_client_start(const char* url, const char* sha256_hex);
+
+/**
+ * @brief Download an ESP32-H2 image the same way, into the H2 staging area instead of an
+ *        OTA slot. Once it is staged, h2_ota_start() relays it over the UART link.
+ *        The server must send Content-Length.
+ *
+ * @param crc32 Expected CRC32 of the image, or 0 to accept the one computed from flash.
+ * @return ESP_ERR_INVALID_STATE if a download or an H2 transfer is already running.
+ */
+esp_err_t ota_client_fetch_h2(const char* url, uint32_t crc32);
+
+esp_err_t ota_client_abort(void);
+void ota_client_get_status(ota_client_status_t* out_status);
+const char* ota_client_state_name(ota_client_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OTA_CLIENT_H_
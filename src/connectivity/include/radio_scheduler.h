@@ -0,0 +1,82 @@
+#ifndef RADIO_SCHEDULER_H_
+#define RADIO_SCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  RADIO_PRIORITY_WIFI = 0,  // WiFi latency first
+  RADIO_PRIORITY_BALANCED,
+  RADIO_PRIORITY_BLE,  // BLE presence first
+  RADIO_PRIORITY_COUNT,
+} radio_priority_t;
+
+typedef struct {
+  radio_priority_t priority;
+  uint8_t ble_share_pct;  // BLE scan window as a share of the scan interval
+  uint16_t scan_interval_ms;
+  uint16_t scan_window_ms;
+  bool passive;
+  const char* coex;  // coexistence preference: "wifi", "balance" or "bt"
+  uint32_t ps_idle_ms;
+  uint32_t ps_sleep_ms;  // 0 = never past MIN_MODEM
+  uint8_t ps_floor;      // least power save allowed, a wifi_ps_type_t
+} radio_scheduler_plan_t;
+
+typedef struct {
+  uint32_t active_ms;   // time this priority was selected
+  uint32_t scan_ms;     // BLE scan time under it
+  uint32_t ble_air_ms;  // scan time at the scan window share: the radio time BLE was given
+  uint32_t adverts;     // advertising reports received
+  uint32_t pings;       // bench echo requests to the gateway
+  uint32_t ping_lost;
+  uint32_t rtt_p50_ms;
+  uint32_t rtt_p90_ms;
+  uint32_t rtt_max_ms;
+  uint32_t rx_bytes;  // bench download
+  uint32_t rx_ms;
+} radio_scheduler_stats_t;
+
+/**
+ * @brief Apply CONFIG_APP_RADIO_PRIORITY. Call after wifi_manager_init() and
+ *        bluetooth_manager_init().
+ */
+esp_err_t radio_scheduler_init(void);
+
+/**
+ * @brief Switch priority: BLE scan parameters (from the next scan), WiFi power save
+ *        timing and the coexistence preference change together.
+ * @param ble_share_pct Scan window share, 1-100; 0 keeps the priority's own.
+ */
+esp_err_t radio_scheduler_set_priority(radio_priority_t priority, uint8_t ble_share_pct);
+
+void radio_scheduler_get_plan(radio_scheduler_plan_t* out_plan);
+
+/**
+ * @brief What a priority delivered while selected, bench results included.
+ */
+void radio_scheduler_get_stats(radio_priority_t priority, radio_scheduler_stats_t* out_stats);
+void radio_scheduler_reset_stats(void);
+
+/**
+ * @brief Measure a priority: one BLE scan while the gateway is pinged for `seconds`,
+ *        then, with CONFIG_APP_RADIO_BENCH_URL set, downloaded from for up to `seconds`.
+ *        Results accrue to the priority's stats; the previous priority is restored.
+ *        Blocks until done.
+ * @return ESP_ERR_INVALID_STATE without a WiFi connection or while another bench runs
+ */
+esp_err_t radio_scheduler_bench(radio_priority_t priority, uint8_t ble_share_pct, uint32_t seconds);
+
+const char* radio_scheduler_priority_name(radio_priority_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_SCHEDULER_H_
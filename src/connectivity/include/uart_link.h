@@ -2,6 +2,7 @@
 #define UART_LINK_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #if __has_include("esp_err.h")
@@ -14,9 +15,90 @@ typedef int esp_err_t;
 extern "C" {
 #endif
 
+/*
+ * The hub drives up to two co-processor links, each on its own UART with its own tasks,
+ * queues and counters. Functions without an index act on the primary link; suspend,
+ * resume, debug and the resets apply to every link.
+ */
+#define UART_LINK_MAX_LINKS 2
+#define UART_LINK_PRIMARY 0
+
+/* Negotiation state of the link, driven by the link task. */
+typedef enum {
+  UART_LINK_STATE_DOWN = 0,
+  UART_LINK_STATE_HELLO,        // HELLO sent, waiting for the peer before handshaking
+  UART_LINK_STATE_HANDSHAKING,  // handshake retried with jittered exponential backoff
+  UART_LINK_STATE_UP,
+  UART_LINK_STATE_DEGRADED,  // negotiated, but the supervisor reports a poor link
+} uart_link_state_t;
+
+/* Peer liveness as judged by the link supervisor. */
+typedef enum {
+  UART_LINK_PEER_UNKNOWN = 0,  // nothing received since init/resume
+  UART_LINK_PEER_ALIVE,
+  UART_LINK_PEER_QUIET,  // silent past the keepalive; probing
+  UART_LINK_PEER_DEAD,   // probes unanswered; rehandshake in progress
+} uart_link_peer_state_t;
+
+typedef enum {
+  UART_LINK_EVENT_PEER_ALIVE = 0,
+  UART_LINK_EVENT_PEER_QUIET,
+  UART_LINK_EVENT_PEER_DEAD,
+  UART_LINK_EVENT_DEGRADED,   // CRC/drop ratio over threshold or loopback seen
+  UART_LINK_EVENT_RECOVERED,  // error ratio back below half the threshold
+  UART_LINK_EVENT_STATE_CHANGED,  // see uart_link_get_state()
+} uart_link_event_t;
+
+/* Logical channels multiplexed over the link, highest priority first. */
+typedef enum {
+  UART_LINK_CHANNEL_COMMAND = 0,  // device commands and CLI text; never waits behind more than one fragment
+  UART_LINK_CHANNEL_EVENT,        // Zigbee signals and attribute updates
+  UART_LINK_CHANNEL_BULK,         // OTA images, table sync, log streaming
+  UART_LINK_CHANNEL_COUNT,
+} uart_link_channel_t;
+
+/*
+ * Hops of a Zigbee round trip through the hub. H2 times come from STAMPED frames; the link
+ * hops compare them with C6 times and need the clocks synchronised.
+ */
+typedef enum {
+  UART_LINK_HOP_H2_RX = 0,  // Zigbee frame received on the H2 -> its report written to the UART
+  UART_LINK_HOP_LINK_UP,    // H2 UART write -> C6 frame received
+  UART_LINK_HOP_DISPATCH,   // C6 frame received -> its handler returned
+  UART_LINK_HOP_HUB,        // event received on the C6 -> command queued in response
+  UART_LINK_HOP_LINK_DOWN,  // command queued on the C6 -> request read by the H2
+  UART_LINK_HOP_H2_TX,      // request read by the H2 -> command sent over the air
+  UART_LINK_HOP_COUNT,
+} uart_link_hop_t;
+
+typedef struct {
+  uint32_t messages_tx;
+  uint32_t fragments_tx;
+  uint32_t bytes_tx;        // message bytes, headers excluded
+  uint32_t refused;         // enqueue attempts that found the queue full (retries count again)
+  uint32_t dropped;         // queued messages too large for a peer without channel support
+  uint32_t credit_stalls;   // times the peer's credits ran out with data queued
+  uint32_t last_wait_us;    // queued until the last fragment was handed to the UART
+  uint32_t max_wait_us;
+  uint32_t messages_rx;
+  uint32_t messages_rx_dropped;  // lost to a missing fragment
+  uint16_t queued_bytes;
+  uint16_t credits;  // fragments the peer will still accept (0xFFFF without channel support)
+} uart_link_channel_stats_t;
+
+/*
+ * Called from a link's supervisor task; keep it short and non-blocking. Up to four may be
+ * registered, shared by all links; uart_link_current() tells which link raised the event.
+ */
+typedef void (*uart_link_event_cb_t)(uart_link_event_t event, void* ctx);
+
+/* Called from a link's RX task for frame types the link does not handle itself; see uart_link_current(). */
+typedef void (*uart_link_frame_handler_t)(uint8_t type, const uint8_t* payload, uint16_t len, void* ctx);
+
 typedef struct {
   bool initialized;
   bool suspended;
+  uint8_t port;  // UART controller
   bool debug_enabled;
   bool handshake_received;
   bool handshake_ok;
@@ -30,11 +112,141 @@ typedef struct {
   uint32_t loopback_frames;
   int64_t last_rx_us;
   int64_t last_tx_us;
+  uint32_t bytes_rx;   // raw bytes read from the UART, framed or not
+  uint32_t bytes_tx;   // encoded frame bytes queued for transmission
+  uint32_t tx_errors;  // send_frame() calls that failed after validation
+  uint8_t peer_state;  // uart_link_peer_state_t
+  bool degraded;
+  uint32_t heartbeats_sent;
+  uint32_t heartbeats_suppressed;  // fixed-interval heartbeats skipped because traffic proved liveness
+  uint32_t peer_dead_events;
+  uint32_t degraded_events;
+  uint32_t bad_permille;  // CRC errors + drops per received frame in the last judged window
+  uint8_t link_state;     // uart_link_state_t
+  uint32_t link_up_count;
+  uint32_t handshakes_sent;
+  uint32_t handshake_mismatches;
+  uint32_t last_time_to_up_ms;  // from losing the link (or boot) until UP
+  uint32_t max_time_to_up_ms;
+  bool compression;                  // peer accepts compressed frames, so TX uses them
+  uint32_t compressed_frames_tx;
+  uint32_t compressed_raw_bytes_tx;  // payload bytes before compression
+  uint32_t compressed_bytes_tx;      // the same payloads on the wire
+  uint32_t compressed_frames_rx;
+  uint32_t compressed_raw_bytes_rx;
+  uint32_t compressed_bytes_rx;
+  uint32_t decompress_errors;
+  uint32_t rx_overflows;  // UART FIFO or driver buffer overflows; the bytes in flight were lost
+  bool channels;  // peer speaks the channel framing, so messages may span several frames
+  bool clock_sync;  // peer answers clock sync heartbeats
 } uart_link_stats_t;
 
+/* Counter deltas over a sliding window ending now. */
+typedef struct {
+  uint32_t window_ms;  // span actually covered (shorter than requested right after boot)
+  uint32_t frames_rx;
+  uint32_t bytes_rx;
+  uint32_t frames_tx;
+  uint32_t bytes_tx;
+  uint32_t crc_errors;
+  uint32_t dropped_frames;
+} uart_link_window_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t mean;
+  uint32_t p50;
+  uint32_t p90;
+  uint32_t p99;
+  uint32_t max;
+} uart_link_histogram_t;
+
+#define UART_LINK_METRIC_WINDOWS 3
+
+typedef struct {
+  uart_link_window_t windows[UART_LINK_METRIC_WINDOWS];  // last 1 s, 10 s and 60 s
+  uart_link_histogram_t frame_bytes;                     // encoded size of every frame, both directions
+  uart_link_histogram_t rx_interarrival_us;              // gap between consecutive valid RX frames
+  uart_link_histogram_t tx_latency_us;                   // send_frame() entry until the frame left the FIFO
+} uart_link_metrics_t;
+
+typedef struct {
+  bool synced;
+  int64_t offset_us;  // H2 clock minus C6 clock, now
+  int32_t drift_ppb;  // H2 clock rate relative to the C6
+  uint32_t error_us;  // bound on the offset error: half the round trip of the trusted exchange
+  uint32_t age_ms;    // since the trusted exchange
+  uint32_t samples;
+  uint32_t rejected;  // exchanges too slow or inconsistent to use
+  uint32_t jumps;     // times the H2 clock jumped and the estimate started over
+} uart_link_clock_t;
+
+typedef struct {
+  uart_link_clock_t clock;
+  uart_link_histogram_t hops_us[UART_LINK_HOP_COUNT];
+  uint32_t stamped_frames;
+  uint32_t unsynced_frames;  // stamped frames that arrived before the clocks were synchronised
+} uart_link_latency_t;
+
+/* H2 timestamps of the frame being dispatched, on the C6 clock (esp_timer microseconds). */
+typedef struct {
+  int64_t c6_rx_us;  // frame received
+  int64_t h2_rx_us;  // H2 input: Zigbee frame for events, UART request for responses
+  int64_t h2_tx_us;  // H2 output: UART write for events, radio transmit for responses
+  bool synced;       // h2_* are meaningful only when the clocks are synchronised
+} uart_link_stamp_t;
+
+/* Frame codec cost and gain over a built-in sample of Zigbee link traffic. */
+typedef struct {
+  uint32_t iterations;
+  uint32_t frames;                    // sample frames per iteration
+  uint32_t raw_bytes;                 // sample payload bytes per iteration
+  uint32_t compressed_bytes;          // the same payloads compressed
+  uint32_t compress_cycles_per_kb;    // per KB of uncompressed payload
+  uint32_t decompress_cycles_per_kb;  // per KB of uncompressed payload
+  uint32_t plain_payload_bps;         // payload bytes/s the wire carries uncompressed
+  uint32_t compressed_payload_bps;    // payload bytes/s with compression
+  uint32_t cpu_mhz;
+} uart_link_codec_bench_t;
+
+/*
+ * Primary link under flash writes: frames looped back inside its UART while NVS is
+ * rewritten. Lost bytes show up as overflows, then as CRC errors or missing frames.
+ */
+typedef struct {
+  uint32_t duration_ms;
+  uint32_t baud;
+  bool iram_profile;  // built with APP_UART_LINK_IRAM_PROFILE
+  uint32_t frames_sent;
+  uint32_t frames_received;  // passed the CRC
+  uint32_t frames_lost;      // sent and never received intact
+  uint32_t crc_errors;
+  uint32_t fifo_overflows;  // hardware RX FIFO filled before the UART ISR emptied it
+  uint32_t buffer_full;     // driver RX buffer filled before the RX task read it
+  uint32_t flash_writes;    // NVS blob writes with commit
+  uint32_t max_flash_write_us;
+  uint32_t max_parse_us;      // longest time to frame one chunk read from the driver
+  uint32_t avg_parse_cycles;  // per received frame
+  uint32_t max_read_gap_us;   // longest wait between two reads that returned data
+  uint32_t cpu_mhz;
+} uart_link_stress_t;
+
+/* Brings up every configured link; each negotiates in the background. */
 esp_err_t uart_link_init(void);
+uint8_t uart_link_count(void);
+/* Index of the link whose task is running: valid in frame handlers and event callbacks, else -1. */
+int uart_link_current(void);
+/* Restarts negotiation on every link and waits up to timeout_ms for all to come UP; only the caller blocks. */
 esp_err_t uart_link_run_startup_check(uint32_t timeout_ms);
+uart_link_state_t uart_link_get_state(void);
+uart_link_state_t uart_link_get_state_on(uint8_t link);
+const char* uart_link_state_name(uint8_t state);
 void uart_link_get_stats(uart_link_stats_t* out_stats);
+void uart_link_get_stats_on(uint8_t link, uart_link_stats_t* out_stats);
+void uart_link_get_metrics(uart_link_metrics_t* out_metrics);
+void uart_link_get_metrics_on(uint8_t link, uart_link_metrics_t* out_metrics);
+void uart_link_reset_metrics(void);
 void uart_link_print_status(void);
 esp_err_t uart_link_send_heartbeat(void);
 esp_err_t uart_link_send_text(const char* text);
@@ -43,7 +255,44 @@ esp_err_t uart_link_resume(void);
 void uart_link_set_debug(bool enable);
 bool uart_link_is_debug_enabled(void);
 bool uart_link_handshake_ok(void);
+bool uart_link_handshake_ok_on(uint8_t link);
 esp_err_t uart_link_send_manual_handshake(void);
+esp_err_t uart_link_register_event_cb(uart_link_event_cb_t cb, void* ctx);
+esp_err_t uart_link_register_frame_handler(uint8_t type, uart_link_frame_handler_t handler, void* ctx);
+/* Sends one frame; blocks until it has left the UART FIFO. ESP_ERR_INVALID_STATE while suspended. */
+esp_err_t uart_link_send_frame(uint8_t type, const void* payload, size_t len);
+esp_err_t uart_link_send_frame_on(uint8_t link, uint8_t type, const void* payload, size_t len);
+/*
+ * Queues a message on a channel; the TX task fragments it and interleaves it with the
+ * other channels by priority. Messages may be up to CONFIG_APP_UART_LINK_MAX_MESSAGE bytes
+ * when the peer speaks channels, one frame otherwise. Waits up to timeout_ms for queue
+ * space; ESP_ERR_TIMEOUT if none came free.
+ */
+esp_err_t uart_link_channel_send(uart_link_channel_t channel, uint8_t type, const void* payload, size_t len,
+                                 uint32_t timeout_ms);
+esp_err_t uart_link_channel_send_on(uint8_t link, uart_link_channel_t channel, uint8_t type, const void* payload,
+                                    size_t len, uint32_t timeout_ms);
+esp_err_t uart_link_get_channel_stats(uart_link_channel_t channel, uart_link_channel_stats_t* out_stats);
+esp_err_t uart_link_get_channel_stats_on(uint8_t link, uart_link_channel_t channel,
+                                         uart_link_channel_stats_t* out_stats);
+void uart_link_reset_channel_stats(void);
+const char* uart_link_channel_name(uint8_t channel);
+const char* uart_link_peer_state_name(uint8_t state);
+esp_err_t uart_link_codec_benchmark(uint32_t iterations, uart_link_codec_bench_t* out_result);
+/*
+ * Suspends every link, runs the flash stress for duration_ms on the primary link's UART in
+ * internal loopback and resumes the links, which then renegotiate. The peer's RX pin sees
+ * the test frames too; their type is one the protocol does not define.
+ */
+esp_err_t uart_link_flash_stress(uint32_t duration_ms, uart_link_stress_t* out_result);
+void uart_link_get_latency(uart_link_latency_t* out_latency);
+void uart_link_get_latency_on(uint8_t link, uart_link_latency_t* out_latency);
+void uart_link_reset_latency(void);
+/* Recorded on the link whose task calls it, otherwise on the primary link. */
+void uart_link_record_hop(uart_link_hop_t hop, uint32_t us);
+const char* uart_link_hop_name(uint8_t hop);
+/* Only from a frame handler: false unless the frame arrived in a STAMPED envelope. */
+bool uart_link_frame_stamp(uart_link_stamp_t* out_stamp);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,35 @@
 #define WIFI_MANAGER_H
 
 #include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Indexes below follow wifi_ps_type_t: WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM. */
+#define WIFI_MANAGER_PS_MODES 3
+
+/* Handed out by wifi_manager_command_begin(); pass it back when the command is answered. */
+typedef struct {
+  int64_t start_us;
+  uint8_t ps_mode;  // power save mode in effect when the command arrived
+} wifi_manager_command_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t p50_us;
+  uint32_t p90_us;
+  uint32_t max_us;
+} wifi_manager_latency_t;
+
+typedef struct {
+  bool adaptive;  // false while wifi_manager_force_ps() holds a mode
+  uint8_t mode;   // applied now
+  uint32_t pins;
+  uint32_t pending;  // commands begun and not yet ended
+  uint32_t switches;
+  uint32_t rejected;  // modes the driver refused; the previous one stayed in effect
+  uint32_t residency_ms[WIFI_MANAGER_PS_MODES];
+  wifi_manager_latency_t latency[WIFI_MANAGER_PS_MODES];  // by the mode the command arrived in
+} wifi_manager_ps_stats_t;
 
 /**
  * @brief Initialize the WiFi Manager.
@@ -50,4 +79,59 @@ esp_err_t wifi_manager_get_rssi(int* rssi);
  */
 esp_err_t wifi_manager_scan(void);
 
+/**
+ * @brief Report interactive traffic (an API request, a client session).
+ *        Power save drops to NONE at once and steps back down after
+ *        CONFIG_APP_WIFI_PS_IDLE_MS without traffic.
+ */
+void wifi_manager_note_activity(void);
+
+/**
+ * @brief Mark an inbound command as pending; power save stays NONE until every
+ *        pending command has ended.
+ * @return Token to pass to wifi_manager_command_end().
+ */
+wifi_manager_command_t wifi_manager_command_begin(void);
+
+/**
+ * @brief End a command from wifi_manager_command_begin() and record its latency
+ *        under the power save mode it arrived in.
+ */
+void wifi_manager_command_end(const wifi_manager_command_t* command);
+
+/**
+ * @brief Hold power save at NONE for a latency-critical session (pin = true) or
+ *        release one hold (pin = false). Holds nest.
+ */
+void wifi_manager_pin_low_latency(bool pin);
+
+/**
+ * @brief Force a power save mode (a wifi_ps_type_t) until wifi_manager_auto_ps().
+ * @return ESP_ERR_INVALID_ARG for an unknown mode.
+ */
+esp_err_t wifi_manager_force_ps(uint8_t mode);
+
+/**
+ * @brief Return power save to the adaptive policy.
+ */
+esp_err_t wifi_manager_auto_ps(void);
+
+/**
+ * @brief Replace the adaptive timing (CONFIG_APP_WIFI_PS_IDLE_MS / _SLEEP_MS). The radio
+ *        scheduler uses this.
+ */
+esp_err_t wifi_manager_set_ps_profile(uint32_t idle_ms, uint32_t sleep_ms);
+
+/**
+ * @brief The least power save mode ever applied, forced modes included (a wifi_ps_type_t):
+ *        WIFI_PS_MIN_MODEM with Bluetooth enabled, since the driver then refuses NONE.
+ */
+uint8_t wifi_manager_ps_floor(void);
+
+/**
+ * @brief Power save mode, residency per mode and command latency per mode.
+ */
+void wifi_manager_get_ps_stats(wifi_manager_ps_stats_t* out_stats);
+void wifi_manager_reset_ps_stats(void);
+
 #endif  // WIFI_MANAGER_H
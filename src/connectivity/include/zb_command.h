@@ -0,0 +1,185 @@
+#ifndef ZB_COMMAND_H_
+#define ZB_COMMAND_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "zb_command_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  bool supported;  // peer advertised typed commands in the handshake
+  uint32_t sent;
+  uint32_t completed;  // responses received, whatever their status
+  uint32_t failed;     // timed out or lost to a link drop
+  uint32_t late;       // responses that arrived after the caller gave up
+  uint32_t malformed;
+  uint32_t no_slot;  // sends refused with all requests in flight
+  uint32_t in_flight;
+  uint32_t last_round_trip_us;
+  uint32_t avg_round_trip_us;
+  uint32_t max_round_trip_us;
+} zb_command_stats_t;
+
+typedef struct {
+  uint32_t iterations;
+  uint32_t completed;
+  uint32_t min_round_trip_us;
+  uint32_t avg_round_trip_us;
+  uint32_t max_round_trip_us;
+} zb_command_bench_t;
+
+typedef struct {
+  uint16_t rate_per_s;  // per device
+  uint8_t burst;
+  uint32_t offered;    // commands passed to zb_command_stage()
+  uint32_t sent_now;   // sent at once: device under its rate with nothing staged
+  uint32_t deferred;   // sent from the stage when the device's bucket refilled
+  uint32_t flushed;    // of those, sent early so a bypassing command did not overtake them
+  uint32_t coalesced;  // replaced by a newer command for the same target before going out
+  uint32_t bypassed;   // not mergeable (toggle, bind, read) or no room to stage; sent at once
+  uint32_t restaged;   // back in the stage after the command channel or the tracker was full
+  uint32_t send_errors;
+  uint32_t staged;        // waiting now
+  uint32_t avg_delay_ms;  // deferred commands, from the arrival of the command sent
+  uint32_t max_delay_ms;
+} zb_stage_stats_t;
+
+#define ZB_STAGE_BENCH_SCENARIOS 3
+
+/* One synthetic flood run through a private stager on a simulated clock. */
+typedef struct {
+  const char* name;
+  uint32_t commands;
+  uint32_t frames;  // commands that would have gone on the wire
+  uint32_t link_bytes_saved;
+  uint32_t avg_delay_ms;    // each frame, from the arrival of the command it carried
+  uint32_t max_delay_ms;
+  uint32_t final_delay_ms;  // last command of the flood until the stage was empty
+  bool final_state_sent;    // every device got the last value it was sent
+} zb_stage_bench_scenario_t;
+
+typedef struct {
+  uint16_t rate_per_s;
+  uint8_t burst;
+  uint32_t flush_ms;
+  zb_stage_bench_scenario_t scenarios[ZB_STAGE_BENCH_SCENARIOS];
+} zb_stage_bench_t;
+
+/**
+ * @brief Route typed command responses to their requests. Call after uart_link_init()
+ *        and before zigbee_manager_start(). Every command names the network it goes to:
+ *        a uart_link index or ZB_DEVICES_NATIVE (see zb_devices.h), because short
+ *        addresses are only unique within one network.
+ */
+esp_err_t zb_command_init(void);
+
+/**
+ * @brief True once the primary H2 has advertised typed commands in an accepted handshake.
+ */
+bool zb_command_supported(void);
+
+void zb_command_get_stats(zb_command_stats_t* out_stats);
+void zb_command_reset_stats(void);
+const char* zb_command_status_name(uint8_t status);
+const char* zb_command_name(uint8_t command);
+
+/**
+ * @brief Send SET_MODE queries back to back and time the round trips. Blocks the caller.
+ */
+esp_err_t zb_command_benchmark(uint32_t iterations, zb_command_bench_t* out_result);
+
+/**
+ * @brief Fire-and-forget send through the staging area: level, colour and on/off commands
+ *        to one target replace each other while they wait, and each device is held to
+ *        the rate limit. Each device receives its commands in the order they were staged.
+ *        Nobody waits for the response; use ZbCommand for that.
+ *
+ * @return ESP_ERR_TIMEOUT if the command channel stayed full; the command was not sent, and
+ *         anything staged for its device before it is still staged.
+ */
+esp_err_t zb_command_stage(uint8_t network, uint8_t command, const void* request, uint16_t len);
+esp_err_t zb_command_set_rate_limit(uint16_t rate_per_s, uint8_t burst);
+void zb_command_get_stage_stats(zb_stage_stats_t* out_stats);
+
+/**
+ * @brief Replay slider and runaway-automation floods through a stager with the current
+ *        limits on a simulated clock. Touches neither the link nor the live stage.
+ */
+esp_err_t zb_command_stage_benchmark(zb_stage_bench_t* out_result);
+
+#ifdef __cplusplus
+}
+
+/*
+ * Future-like handle for one typed command. The response is written into the handle's slot
+ * by the RX task; wait() blocks only the caller. The slot is held until the handle is
+ * destroyed, so keep handles short-lived: there are eight slots.
+ */
+class ZbCommand {
+ public:
+  ZbCommand() = default;
+  ZbCommand(ZbCommand&& other);
+  ZbCommand& operator=(ZbCommand&& other);
+  ZbCommand(const ZbCommand&) = delete;
+  ZbCommand& operator=(const ZbCommand&) = delete;
+  ~ZbCommand();
+
+  /*
+   * Queues the request on the command channel of network's link, or hands it to the native
+   * network. cause_us is the esp_timer time at which the event this command reacts to arrived,
+   * if any; it feeds the link's HUB latency hop.
+   */
+  static ZbCommand send(uint8_t network, uint8_t command, const void* request, uint16_t len, int64_t cause_us = 0);
+
+  /*
+   * Blocks up to timeout_ms for the response. ESP_OK once the command completed, whatever
+   * status() says; ESP_ERR_TIMEOUT if it did not, in which case the request is written off.
+   * Returns the send error for a handle whose request never went out.
+   */
+  esp_err_t wait(uint32_t timeout_ms);
+  bool ready() const;
+  zb_cmd_status_t status() const;
+  uint8_t detail() const;
+  uint32_t round_trip_us() const;
+  esp_err_t send_error() const {
+    return error_;
+  }
+
+  // Copies the response body; false unless the status is OK and the body is a T.
+  template <typename T>
+  bool response(T* out) const {
+    return copy_response(out, sizeof(T));
+  }
+
+ private:
+  ZbCommand(int slot, esp_err_t error) : slot_(slot), error_(error) {}
+  bool copy_response(void* out, uint16_t len) const;
+  void release();
+
+  int slot_ = -1;
+  esp_err_t error_ = ESP_ERR_INVALID_STATE;
+};
+
+// One overload per request struct in ZB_COMMAND_LIST, e.g. zb_command_send(network, zb_cmd_on_off_t{...}).
+#define ZB_CMD_SEND_OVERLOAD(id, name, req, rsp)                                           \
+  inline ZbCommand zb_command_send(uint8_t network, const req& request, int64_t cause_us = 0) { \
+    return ZbCommand::send(network, ZB_CMD_##name, &request, sizeof(request), cause_us);     \
+  }
+ZB_COMMAND_LIST(ZB_CMD_SEND_OVERLOAD)
+#undef ZB_CMD_SEND_OVERLOAD
+
+#define ZB_CMD_STAGE_OVERLOAD(id, name, req, rsp)                               \
+  inline esp_err_t zb_command_stage(uint8_t network, const req& request) {     \
+    return zb_command_stage(network, ZB_CMD_##name, &request, sizeof(request)); \
+  }
+ZB_COMMAND_LIST(ZB_CMD_STAGE_OVERLOAD)
+#undef ZB_CMD_STAGE_OVERLOAD
+
+#endif  // __cplusplus
+
+#endif  // ZB_COMMAND_H_
@@ -0,0 +1,211 @@
+#ifndef ZB_COMMAND_SCHEMA_H_
+#define ZB_COMMAND_SCHEMA_H_
+
+/*
+ * Typed device commands between the hub (C6) and the Zigbee co-processor (H2).
+ *
+ * This header is the schema for both firmwares: plain C, packed little-endian structs,
+ * and one X-macro list that generates the command ids and the request/response pairing.
+ * Every struct size is pinned below, so a layout change breaks the build on both sides
+ * instead of the wire.
+ *
+ * A REQUEST frame is zb_cmd_header_t followed by the command's request struct. The H2
+ * answers every request with one RESPONSE frame: zb_rsp_header_t with the same command
+ * and request id, then the response struct when status is ZB_CMD_STATUS_OK (nothing for
+ * zb_rsp_none_t).
+ *
+ * Unsolicited attribute reports travel the other way in ATTR_UPDATE frames: one or more
+ * zb_attr_report_t back to back.
+ */
+
+#include <stdint.h>
+
+#ifndef UART_LINK_MSG_ZB_REQUEST
+#define UART_LINK_MSG_ZB_REQUEST 0x21   // C6 -> H2
+#define UART_LINK_MSG_ZB_RESPONSE 0x22  // H2 -> C6
+#endif
+#ifndef UART_LINK_HANDSHAKE_FLAG_TYPED_COMMANDS
+#define UART_LINK_HANDSHAKE_FLAG_TYPED_COMMANDS 0x08  // peer answers ZB_REQUEST frames
+#endif
+
+#ifdef __cplusplus
+#define ZB_SCHEMA_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define ZB_SCHEMA_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  ZB_CMD_STATUS_OK = 0,
+  ZB_CMD_STATUS_UNKNOWN_COMMAND = 1,
+  ZB_CMD_STATUS_BAD_LENGTH = 2,
+  ZB_CMD_STATUS_BUSY = 3,
+  ZB_CMD_STATUS_NO_DEVICE = 4,  // short address not in the H2's tables
+  ZB_CMD_STATUS_ZCL_ERROR = 5,  // device answered with a ZCL error; see zb_rsp_header_t.detail
+  ZB_CMD_STATUS_NO_ROUTE = 6,   // device did not answer over the air
+  // Local only, never on the wire.
+  ZB_CMD_STATUS_TIMEOUT = 0xFD,
+  ZB_CMD_STATUS_LINK_DOWN = 0xFE,
+} zb_cmd_status_t;
+
+typedef enum {
+  ZB_ROLE_QUERY = 0,  // SET_MODE with this role only reports the current one
+  ZB_ROLE_ROUTER = 1,
+  ZB_ROLE_END_DEVICE = 2,
+} zb_role_t;
+
+typedef enum {
+  ZB_ON_OFF_OFF = 0,
+  ZB_ON_OFF_ON = 1,
+  ZB_ON_OFF_TOGGLE = 2,
+} zb_on_off_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t command;  // zb_cmd_id_t
+  uint8_t flags;    // reserved, 0
+  uint16_t request_id;
+} zb_cmd_header_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t command;
+  uint8_t status;  // zb_cmd_status_t
+  uint16_t request_id;
+  uint8_t detail;  // ZCL status for ZB_CMD_STATUS_ZCL_ERROR, else 0
+} zb_rsp_header_t;
+
+/* Destination of a device command: network address and endpoint. */
+typedef struct __attribute__((packed)) {
+  uint16_t short_addr;
+  uint8_t endpoint;
+} zb_cmd_target_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t role;  // zb_role_t
+} zb_cmd_set_mode_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t role;  // zb_role_t now in effect
+  uint8_t restart_pending;  // 1 when the new role applies after the H2 restarts
+} zb_rsp_mode_t;
+
+typedef struct __attribute__((packed)) {
+  zb_cmd_target_t target;
+  uint8_t action;  // zb_on_off_t
+} zb_cmd_on_off_t;
+
+typedef struct __attribute__((packed)) {
+  zb_cmd_target_t target;
+  uint8_t level;  // 0..254
+  uint16_t transition_ds;  // tenths of a second
+} zb_cmd_level_t;
+
+typedef struct __attribute__((packed)) {
+  zb_cmd_target_t target;
+  uint16_t x;  // CIE 1931 x * 65536
+  uint16_t y;
+  uint16_t transition_ds;
+} zb_cmd_color_t;
+
+typedef struct __attribute__((packed)) {
+  uint64_t src_ieee;
+  uint8_t src_endpoint;
+  uint16_t cluster;
+  uint64_t dst_ieee;
+  uint8_t dst_endpoint;
+} zb_cmd_bind_t;
+
+typedef struct __attribute__((packed)) {
+  zb_cmd_target_t target;
+  uint16_t cluster;
+  uint16_t attribute;
+} zb_cmd_read_attr_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t cluster;
+  uint16_t attribute;
+  uint8_t zcl_type;  // ZCL data type id
+  uint8_t length;    // bytes used in value
+  uint8_t value[8];  // little-endian, as on the air
+} zb_rsp_read_attr_t;
+
+/* One attribute report from a device; the value is laid out as in zb_rsp_read_attr_t. */
+typedef struct __attribute__((packed)) {
+  zb_cmd_target_t source;
+  zb_rsp_read_attr_t attr;
+} zb_attr_report_t;
+
+/* Placeholder for commands whose only answer is the status: the response ends after its header. */
+typedef struct __attribute__((packed)) {
+  uint8_t unused[1];
+} zb_rsp_none_t;
+
+/*
+ * X(id, NAME, request struct, response struct). Append only; ids are never reused.
+ * zb_rsp_none_t means the response carries no body.
+ */
+#define ZB_COMMAND_LIST(X)                                 \
+  X(0x01, SET_MODE, zb_cmd_set_mode_t, zb_rsp_mode_t)      \
+  X(0x10, ON_OFF, zb_cmd_on_off_t, zb_rsp_none_t)          \
+  X(0x11, LEVEL, zb_cmd_level_t, zb_rsp_none_t)            \
+  X(0x12, COLOR, zb_cmd_color_t, zb_rsp_none_t)            \
+  X(0x20, BIND, zb_cmd_bind_t, zb_rsp_none_t)              \
+  X(0x30, READ_ATTR, zb_cmd_read_attr_t, zb_rsp_read_attr_t)
+
+typedef enum {
+#define ZB_CMD_ENUM(id, name, req, rsp) ZB_CMD_##name = id,
+  ZB_COMMAND_LIST(ZB_CMD_ENUM)
+#undef ZB_CMD_ENUM
+} zb_cmd_id_t;
+
+/* Request body size for a command id, 0 for unknown ids. The H2 answers BAD_LENGTH on a mismatch. */
+static inline uint16_t zb_cmd_request_size(uint8_t command) {
+  switch (command) {
+#define ZB_CMD_SIZE(id, name, req, rsp) \
+  case id:                              \
+    return sizeof(req);
+    ZB_COMMAND_LIST(ZB_CMD_SIZE)
+#undef ZB_CMD_SIZE
+    default:
+      return 0;
+  }
+}
+
+/* Largest request and response body in the list; sizes the buffers on both sides. */
+typedef union {
+#define ZB_CMD_UNION(id, name, req, rsp) req name;
+  ZB_COMMAND_LIST(ZB_CMD_UNION)
+#undef ZB_CMD_UNION
+} zb_cmd_any_request_t;
+
+typedef union {
+#define ZB_RSP_UNION(id, name, req, rsp) rsp name;
+  ZB_COMMAND_LIST(ZB_RSP_UNION)
+#undef ZB_RSP_UNION
+} zb_cmd_any_response_t;
+
+// Wire layout, checked on both sides. Structs are sent as they sit in memory.
+ZB_SCHEMA_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire format is little-endian");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_header_t) == 4, "zb_cmd_header_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_rsp_header_t) == 5, "zb_rsp_header_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_target_t) == 3, "zb_cmd_target_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_set_mode_t) == 1, "zb_cmd_set_mode_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_rsp_mode_t) == 2, "zb_rsp_mode_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_on_off_t) == 4, "zb_cmd_on_off_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_level_t) == 6, "zb_cmd_level_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_color_t) == 9, "zb_cmd_color_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_bind_t) == 20, "zb_cmd_bind_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_read_attr_t) == 7, "zb_cmd_read_attr_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_rsp_read_attr_t) == 14, "zb_rsp_read_attr_t layout");
+ZB_SCHEMA_ASSERT(sizeof(zb_attr_report_t) == 17, "zb_attr_report_t layout");
+// Every request fits one plain frame, so commands never need channel fragmentation.
+ZB_SCHEMA_ASSERT(sizeof(zb_cmd_header_t) + sizeof(zb_cmd_any_request_t) <= 128, "request exceeds one frame");
+ZB_SCHEMA_ASSERT(sizeof(zb_rsp_header_t) + sizeof(zb_cmd_any_response_t) <= 128, "response exceeds one frame");
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ZB_COMMAND_SCHEMA_H_
@@ -0,0 +1,68 @@
+#ifndef ZB_DEVICES_H_
+#define ZB_DEVICES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Network of devices on the C6's own radio (APP_ZIGBEE_NATIVE_NETWORK). Every UART link runs
+ * its own PAN too and is network <link index>; a device is its network plus its short address.
+ */
+#define ZB_DEVICES_NATIVE 0x0F
+
+typedef struct {
+  uint8_t network;  // uart_link index or ZB_DEVICES_NATIVE
+  uint16_t short_addr;
+  bool pinned;      // set by zb_devices_pin(), not learned
+  uint32_t age_ms;  // since the last frame from the device
+} zb_device_route_t;
+
+typedef struct {
+  uint32_t devices;
+  uint32_t learned;
+  uint32_t evicted;
+  uint32_t resolved;   // bare short addresses found on one network
+  uint32_t unknown;    // found on none
+  uint32_t ambiguous;  // found on several
+} zb_devices_stats_t;
+
+/**
+ * @brief Record that a frame from short_addr arrived on network. Called by the frame handlers
+ *        that decode device addresses; cheap enough for every report.
+ */
+void zb_devices_note(uint8_t network, uint16_t short_addr);
+
+/**
+ * @brief Network of a device known only by its short address, e.g. typed at the console.
+ *
+ * @return ESP_ERR_NOT_FOUND if no network has been heard from it, ESP_ERR_INVALID_STATE if
+ *         more than one has a device with that address.
+ */
+esp_err_t zb_devices_resolve(uint16_t short_addr, uint8_t* out_network);
+
+/* Links plus the native network when it is built in. */
+uint8_t zb_devices_networks(void);
+/* A link index below uart_link_count(), or ZB_DEVICES_NATIVE when it is built in. */
+bool zb_devices_network_valid(uint8_t network);
+const char* zb_devices_network_name(uint8_t network);
+
+/* Keep a device that only ever receives commands; pinned devices are never evicted. */
+esp_err_t zb_devices_pin(uint8_t network, uint16_t short_addr);
+esp_err_t zb_devices_forget(uint8_t network, uint16_t short_addr);
+
+/* Known devices in address order; returns the number written. */
+size_t zb_devices_list(zb_device_route_t* out_routes, size_t max_routes);
+void zb_devices_get_stats(zb_devices_stats_t* out_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ZB_DEVICES_H_
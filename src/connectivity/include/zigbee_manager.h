@@ -1,16 +1,37 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "esp_err.h"
+#include "uart_link.h"
+
+typedef struct {
+  bool enabled;  // built with APP_ZIGBEE_NATIVE_NETWORK
+  bool up;       // network formed or rejoined after a reboot
+  uint16_t pan_id;
+  uint8_t channel;
+  uint32_t devices_announced;
+  uint32_t requests;
+  uint32_t answered;
+  uint32_t refused;
+  uint32_t timeouts;
+  uint32_t late;
+  uint32_t reports;
+  uint32_t pending;
+} zigbee_manager_stats_t;
 
 /**
- * @brief Initialize the Zigbee stack as a Coordinator.
+ * @brief Configure the Zigbee platform for the C6's own 802.15.4 radio. The network
+ *        formed on it is a second one next to the H2's, reached through zb_devices and
+ *        zb_command like a co-processor link (see ZB_DEVICES_NATIVE).
  *
- * @return esp_err_t ESP_OK on success.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED without APP_ZIGBEE_NATIVE_NETWORK.
  */
 esp_err_t zigbee_manager_init(void);
 
 /**
- * @brief Start the Zigbee stack.
+ * @brief Start the Zigbee stack as a Coordinator.
  *
  * @return esp_err_t ESP_OK on success.
  */
@@ -20,3 +41,18 @@ esp_err_t zigbee_manager_start(void);
  * @brief Print the current Zigbee network status to the log/console.
  */
 void zigbee_manager_print_status(void);
+
+bool zigbee_manager_is_up(void);
+void zigbee_manager_get_stats(zigbee_manager_stats_t* out_stats);
+
+/**
+ * @brief Hand a ZB_REQUEST frame to the native network. The ZB_RESPONSE comes back
+ *        through the frame handler registered for it, from the Zigbee task.
+ */
+esp_err_t zigbee_manager_send_request(const void* frame, uint16_t len);
+
+/**
+ * @brief Receive ZB_RESPONSE and ATTR_UPDATE frames from the native network, laid out
+ *        as the H2 sends them. Register before zigbee_manager_start().
+ */
+esp_err_t zigbee_manager_register_frame_handler(uint8_t type, uart_link_frame_handler_t handler, void* ctx);
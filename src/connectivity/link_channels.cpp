@@ -0,0 +1,317 @@
+#include "link_channels.h"
+
+#include <cstring>
+
+namespace {
+
+// Ring record: u16 length, u8 type, u8 pad, u32 enqueue time, then the message.
+constexpr uint16_t kRecordHeader = 8;
+
+struct RecordHeader {
+  uint16_t length;
+  uint8_t type;
+  uint8_t pad;
+  uint32_t enqueue_us;
+};
+static_assert(sizeof(RecordHeader) == kRecordHeader, "record header layout");
+
+}  // namespace
+
+ChannelScheduler::ChannelScheduler(uint16_t frame_payload) : frame_payload_(frame_payload) {}
+
+void ChannelScheduler::configure(uint8_t channel, const ChannelConfig& config) {
+  if (channel >= kMaxChannels) {
+    return;
+  }
+  channels_[channel] = Channel();
+  channels_[channel].config = config;
+}
+
+void ChannelScheduler::set_framing(bool enabled) {
+  framing_ = enabled;
+  for (Channel& ch : channels_) {
+    ch.sent = 0;
+    ch.next_seq = 0;
+    ch.peer_seq = 0;
+    ch.stalled = false;
+  }
+}
+
+uint16_t ChannelScheduler::max_message() const {
+  return framing_ ? UINT16_MAX : frame_payload_;
+}
+
+void ChannelScheduler::read(const Channel& ch, uint16_t offset, uint8_t* out, uint16_t len) const {
+  const uint16_t size = ch.config.storage_size;
+  uint16_t pos = static_cast<uint16_t>((ch.head + offset) % size);
+  const uint16_t first = len < size - pos ? len : static_cast<uint16_t>(size - pos);
+  memcpy(out, ch.config.storage + pos, first);
+  memcpy(out + first, ch.config.storage, len - first);
+}
+
+void ChannelScheduler::write(Channel& ch, uint16_t offset, const uint8_t* in, uint16_t len) {
+  const uint16_t size = ch.config.storage_size;
+  uint16_t pos = static_cast<uint16_t>((ch.head + offset) % size);
+  const uint16_t first = len < size - pos ? len : static_cast<uint16_t>(size - pos);
+  memcpy(ch.config.storage + pos, in, first);
+  memcpy(ch.config.storage, in + first, len - first);
+}
+
+void ChannelScheduler::pop(Channel& ch, uint16_t len) {
+  const uint16_t record = kRecordHeader + len;
+  ch.head = static_cast<uint16_t>((ch.head + record) % ch.config.storage_size);
+  ch.used -= record;
+  ch.sent = 0;
+}
+
+bool ChannelScheduler::has_credit(const Channel& ch) const {
+  return !framing_ || static_cast<uint16_t>(ch.next_seq - ch.peer_seq) < channel_wire::kInitialCredits;
+}
+
+bool ChannelScheduler::enqueue(uint8_t channel, uint8_t type, const uint8_t* data, uint16_t len, uint32_t now_us) {
+  if (channel >= kMaxChannels || (len && !data)) {
+    return false;
+  }
+  Channel& ch = channels_[channel];
+  const uint32_t needed = static_cast<uint32_t>(kRecordHeader) + len;
+  if (!ch.config.storage || len > max_message() || needed > static_cast<uint32_t>(ch.config.storage_size - ch.used)) {
+    ch.stats.refused++;
+    return false;
+  }
+  const RecordHeader header = {len, type, 0, now_us};
+  write(ch, ch.used, reinterpret_cast<const uint8_t*>(&header), kRecordHeader);
+  if (len) {
+    write(ch, static_cast<uint16_t>(ch.used + kRecordHeader), data, len);
+  }
+  ch.used = static_cast<uint16_t>(ch.used + needed);
+  return true;
+}
+
+bool ChannelScheduler::next(uint32_t now_us, Fragment* out, uint8_t* buffer) {
+  for (;;) {
+    Channel* best = nullptr;
+    uint8_t best_index = 0;
+    for (uint8_t i = 0; i < kMaxChannels; ++i) {
+      Channel& ch = channels_[i];
+      if (!ch.used) {
+        continue;
+      }
+      if (!has_credit(ch)) {
+        if (!ch.stalled) {
+          ch.stalled = true;
+          ch.probe_us = now_us;
+          ch.stats.credit_stalls++;
+        }
+        continue;
+      }
+      if (!best || ch.config.priority < best->config.priority) {
+        best = &ch;
+        best_index = i;
+      }
+    }
+    if (!best) {
+      return false;
+    }
+
+    Channel& ch = *best;
+    RecordHeader record;
+    read(ch, 0, reinterpret_cast<uint8_t*>(&record), kRecordHeader);
+    if (!framing_) {
+      if (record.length > frame_payload_) {
+        // Queued while the peer spoke channels; it cannot be delivered as one plain frame.
+        ch.stats.dropped++;
+        pop(ch, record.length);
+        continue;
+      }
+      read(ch, kRecordHeader, buffer, record.length);
+      *out = {best_index, record.type, record.length, true};
+      ch.stats.bytes += record.length;
+    } else {
+      const uint16_t room = static_cast<uint16_t>(frame_payload_ - sizeof(channel_wire::FragmentHeader));
+      const uint16_t left = static_cast<uint16_t>(record.length - ch.sent);
+      const uint16_t chunk = left < room ? left : room;
+      const bool last = ch.sent + chunk == record.length;
+      channel_wire::FragmentHeader header;
+      header.channel_flags =
+          static_cast<uint8_t>(best_index | (ch.sent == 0 ? channel_wire::kFirst : 0) | (last ? channel_wire::kLast : 0));
+      header.type = record.type;
+      header.seq = ch.next_seq++;
+      header.total = record.length;
+      memcpy(buffer, &header, sizeof(header));
+      read(ch, static_cast<uint16_t>(kRecordHeader + ch.sent), buffer + sizeof(header), chunk);
+      ch.sent = static_cast<uint16_t>(ch.sent + chunk);
+      *out = {best_index, UART_LINK_MSG_CHANNEL_DATA, static_cast<uint16_t>(sizeof(header) + chunk), last};
+      ch.stats.bytes += chunk;
+    }
+    ch.stats.fragments++;
+    if (out->last) {
+      const uint32_t wait = now_us - record.enqueue_us;
+      ch.stats.messages++;
+      ch.stats.last_wait_us = wait;
+      if (wait > ch.stats.max_wait_us) {
+        ch.stats.max_wait_us = wait;
+      }
+      pop(ch, record.length);
+    }
+    return true;
+  }
+}
+
+void ChannelScheduler::on_credit(uint8_t channel, uint16_t peer_seq) {
+  if (channel >= kMaxChannels) {
+    return;
+  }
+  Channel& ch = channels_[channel];
+  // Only forward, and never past what was sent: stale or foreign grants are ignored.
+  const uint16_t advance = static_cast<uint16_t>(peer_seq - ch.peer_seq);
+  const uint16_t outstanding = static_cast<uint16_t>(ch.next_seq - ch.peer_seq);
+  if (advance > outstanding) {
+    return;
+  }
+  ch.peer_seq = peer_seq;
+  if (has_credit(ch)) {
+    ch.stalled = false;
+  }
+}
+
+bool ChannelScheduler::credit_probe(uint32_t now_us, uint8_t* channel, channel_wire::Credit* request) {
+  if (!framing_) {
+    return false;
+  }
+  for (uint8_t i = 0; i < kMaxChannels; ++i) {
+    Channel& ch = channels_[i];
+    if (!ch.stalled || !ch.used || now_us - ch.probe_us < kCreditProbeUs) {
+      continue;
+    }
+    ch.probe_us = now_us;
+    *channel = i;
+    request->channel_flags = static_cast<uint8_t>(i | channel_wire::kCreditRequest);
+    request->reserved = 0;
+    request->seq = ch.next_seq;
+    return true;
+  }
+  return false;
+}
+
+bool ChannelScheduler::pending() const {
+  for (const Channel& ch : channels_) {
+    if (ch.used && has_credit(ch)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t ChannelScheduler::queued_bytes(uint8_t channel) const {
+  return channel < kMaxChannels ? channels_[channel].used : 0;
+}
+
+uint16_t ChannelScheduler::free_bytes(uint8_t channel) const {
+  if (channel >= kMaxChannels) {
+    return 0;
+  }
+  const Channel& ch = channels_[channel];
+  const uint16_t free = static_cast<uint16_t>(ch.config.storage_size - ch.used);
+  return free > kRecordHeader ? static_cast<uint16_t>(free - kRecordHeader) : 0;
+}
+
+uint16_t ChannelScheduler::credits(uint8_t channel) const {
+  if (channel >= kMaxChannels) {
+    return 0;
+  }
+  if (!framing_) {
+    return UINT16_MAX;
+  }
+  const Channel& ch = channels_[channel];
+  return static_cast<uint16_t>(channel_wire::kInitialCredits - static_cast<uint16_t>(ch.next_seq - ch.peer_seq));
+}
+
+void ChannelScheduler::reset_stats() {
+  for (Channel& ch : channels_) {
+    ch.stats = {};
+  }
+}
+
+void ChannelReassembler::begin(uint8_t* buffer, uint16_t capacity) {
+  buffer_ = buffer;
+  capacity_ = capacity;
+  reset();
+}
+
+void ChannelReassembler::reset() {
+  active_ = false;
+  filled_ = 0;
+  expected_ = 0;
+  reported_ = 0;
+}
+
+void ChannelReassembler::discard() {
+  if (active_) {
+    active_ = false;
+    dropped_++;
+  }
+}
+
+bool ChannelReassembler::feed(const uint8_t* payload, uint16_t len, Message* out) {
+  channel_wire::FragmentHeader header;
+  if (!payload || len < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, payload, sizeof(header));
+  const uint8_t* data = payload + sizeof(header);
+  const uint16_t data_len = static_cast<uint16_t>(len - sizeof(header));
+
+  const uint16_t gap = static_cast<uint16_t>(header.seq - expected_);
+  if (gap >= 0x8000) {
+    return false;  // duplicate or from before a resync
+  }
+  if (gap) {
+    discard();
+  }
+  expected_ = static_cast<uint16_t>(header.seq + 1);
+
+  if (header.channel_flags & channel_wire::kFirst) {
+    discard();
+    if (header.total > capacity_) {
+      dropped_++;
+      return false;
+    }
+    active_ = true;
+    filled_ = 0;
+    total_ = header.total;
+    type_ = header.type;
+  } else if (!active_) {
+    return false;  // tail of a message already discarded
+  }
+  if (header.total != total_ || header.type != type_ || filled_ + data_len > total_) {
+    discard();
+    return false;
+  }
+  memcpy(buffer_ + filled_, data, data_len);
+  filled_ = static_cast<uint16_t>(filled_ + data_len);
+  if (!(header.channel_flags & channel_wire::kLast)) {
+    return false;
+  }
+  if (filled_ != total_) {
+    discard();
+    return false;
+  }
+  active_ = false;
+  messages_++;
+  out->type = type_;
+  out->length = total_;
+  return true;
+}
+
+void ChannelReassembler::on_credit_request(uint16_t sender_seq) {
+  const uint16_t gap = static_cast<uint16_t>(sender_seq - expected_);
+  if (gap == 0 || gap >= 0x8000) {
+    return;
+  }
+  discard();
+  expected_ = sender_seq;
+}
+
+bool ChannelReassembler::credit_due() const {
+  return static_cast<uint16_t>(expected_ - reported_) >= channel_wire::kInitialCredits / 2;
+}
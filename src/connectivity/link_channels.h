@@ -0,0 +1,186 @@
+#ifndef LINK_CHANNELS_H_
+#define LINK_CHANNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Frame types for channel traffic (until the shared protocol header carries them).
+#ifndef UART_LINK_MSG_CHANNEL_DATA
+#define UART_LINK_MSG_CHANNEL_DATA 0x40
+#define UART_LINK_MSG_CHANNEL_CREDIT 0x41
+#endif
+
+namespace channel_wire {
+
+constexpr uint8_t kChannelMask = 0x0F;
+constexpr uint8_t kFirst = 0x10;  // first fragment of a message
+constexpr uint8_t kLast = 0x20;   // last fragment of a message
+constexpr uint8_t kCreditRequest = 0x80;
+// Fragments a sender may have outstanding per channel. Both sides restart at sequence 0
+// after every accepted handshake.
+constexpr uint16_t kInitialCredits = 8;
+
+// Precedes the fragment data in a CHANNEL_DATA frame.
+struct __attribute__((packed)) FragmentHeader {
+  uint8_t channel_flags;
+  uint8_t type;   // type of the carried message, as it would appear in a plain frame
+  uint16_t seq;   // per-channel fragment sequence
+  uint16_t total;  // message length
+};
+
+// Grant: seq is the next fragment sequence the receiver expects. A request carries the
+// sender's next sequence instead; the receiver writes off anything before it as lost
+// (the UART is in order, so it has seen all it ever will) and answers with a grant.
+struct __attribute__((packed)) Credit {
+  uint8_t channel_flags;
+  uint8_t reserved;
+  uint16_t seq;
+};
+
+}  // namespace channel_wire
+
+/*
+ * Sender side of the logical channels multiplexed over the UART link.
+ *
+ * Each channel queues whole messages in its own byte ring. next() hands out one
+ * fragment at a time from the highest-priority channel that has data and credits, so a
+ * large transfer is interleaved fragment by fragment and a new high-priority message
+ * waits for at most the fragment already on the wire. Peers without channel support get
+ * plain frames of the message type instead, which limits messages to one frame.
+ * Pure logic: the caller owns the clock, the storage, the locking and the UART.
+ */
+class ChannelScheduler {
+ public:
+  static constexpr uint8_t kMaxChannels = 4;
+  static constexpr uint32_t kCreditProbeUs = 200000;
+
+  struct ChannelConfig {
+    uint8_t priority = 0;  // lower is sent first
+    uint8_t* storage = nullptr;
+    uint16_t storage_size = 0;  // holds queued messages plus 8 bytes each
+  };
+
+  struct Fragment {
+    uint8_t channel;
+    uint8_t type;    // frame type to send: CHANNEL_DATA, or the message type when unframed
+    uint16_t length;  // bytes written to the caller's buffer
+    bool last;        // finishes the message
+  };
+
+  struct ChannelStats {
+    uint32_t messages;
+    uint32_t fragments;
+    uint32_t bytes;
+    uint32_t refused;        // enqueue() calls that found the ring full
+    uint32_t dropped;        // queued messages discarded (too big for an unframed peer)
+    uint32_t credit_stalls;  // times the channel ran out of credits with data queued
+    uint32_t last_wait_us;   // enqueue to last fragment handed out
+    uint32_t max_wait_us;
+  };
+
+  ChannelScheduler() = default;
+  // frame_payload: largest payload one frame carries.
+  explicit ChannelScheduler(uint16_t frame_payload);
+
+  void configure(uint8_t channel, const ChannelConfig& config);
+  // Framing and credits follow the peer's handshake. Sequences restart at 0 and a
+  // partly sent message is sent again from its start.
+  void set_framing(bool enabled);
+  bool framing() const {
+    return framing_;
+  }
+  // Largest message enqueue() accepts with the current framing.
+  uint16_t max_message() const;
+
+  bool enqueue(uint8_t channel, uint8_t type, const uint8_t* data, uint16_t len, uint32_t now_us);
+  // Writes the next frame payload into buffer (at least frame_payload bytes); false if
+  // nothing can be sent now.
+  bool next(uint32_t now_us, Fragment* out, uint8_t* buffer);
+  void on_credit(uint8_t channel, uint16_t peer_seq);
+  // Channels stalled on credits long enough to ask the peer again; fills the request.
+  bool credit_probe(uint32_t now_us, uint8_t* channel, channel_wire::Credit* request);
+
+  bool pending() const;
+  uint16_t queued_bytes(uint8_t channel) const;
+  uint16_t free_bytes(uint8_t channel) const;
+  uint16_t credits(uint8_t channel) const;
+  const ChannelStats& stats(uint8_t channel) const {
+    return channels_[channel].stats;
+  }
+  void reset_stats();
+
+ private:
+  struct Channel {
+    ChannelConfig config;
+    uint16_t head = 0;  // oldest record
+    uint16_t used = 0;
+    uint16_t sent = 0;      // bytes of the head message already handed out
+    uint16_t next_seq = 0;
+    uint16_t peer_seq = 0;  // next sequence the peer expects
+    bool stalled = false;
+    uint32_t probe_us = 0;
+    ChannelStats stats = {};
+  };
+
+  void read(const Channel& ch, uint16_t offset, uint8_t* out, uint16_t len) const;
+  void write(Channel& ch, uint16_t offset, const uint8_t* in, uint16_t len);
+  void pop(Channel& ch, uint16_t len);
+  bool has_credit(const Channel& ch) const;
+
+  uint16_t frame_payload_ = 128;
+  bool framing_ = false;
+  Channel channels_[kMaxChannels];
+};
+
+/*
+ * Receiver side of one channel: checks fragment sequence and reassembles messages into
+ * the caller's buffer. A gap discards the message in progress; the next FIRST fragment
+ * starts over. Every fragment seen, delivered or not, returns its credit to the sender.
+ */
+class ChannelReassembler {
+ public:
+  struct Message {
+    uint8_t type;
+    uint16_t length;
+  };
+
+  void begin(uint8_t* buffer, uint16_t capacity);
+  void reset();
+  // payload: CHANNEL_DATA frame payload (header + data). True when *out is complete in buffer().
+  bool feed(const uint8_t* payload, uint16_t len, Message* out);
+  // Sender asked for credits: fragments before sender_seq are not coming.
+  void on_credit_request(uint16_t sender_seq);
+
+  uint16_t expected_seq() const {
+    return expected_;
+  }
+  bool credit_due() const;
+  void credit_reported() {
+    reported_ = expected_;
+  }
+  const uint8_t* buffer() const {
+    return buffer_;
+  }
+  uint32_t messages() const {
+    return messages_;
+  }
+  uint32_t dropped() const {
+    return dropped_;
+  }
+
+ private:
+  void discard();
+
+  uint8_t* buffer_ = nullptr;
+  uint16_t capacity_ = 0;
+  uint16_t filled_ = 0;
+  uint16_t total_ = 0;
+  uint8_t type_ = 0;
+  bool active_ = false;
+  uint16_t expected_ = 0;
+  uint16_t reported_ = 0;
+  uint32_t messages_ = 0;
+  uint32_t dropped_ = 0;  // messages lost to gaps or bad headers
+};
+
+#endif  // LINK_CHANNELS_H_
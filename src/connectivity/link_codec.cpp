@@ -0,0 +1,173 @@
+#include "link_codec.h"
+
+#include <cstring>
+
+namespace link_codec {
+namespace {
+
+// Most frequent tokens last: ties in match length go to the nearest candidate, and the
+// chain walk starts there. Plain text only; the dictionary is never transmitted.
+constexpr char kDictionary[] =
+    "lumi.sensor_TRADFRI bulb manufacturer=model=sw_build=power_source=battery=mains "
+    "IAS_ZONE OCCUPANCY HUMIDITY TEMPERATURE_MEASUREMENT COLOR_CONTROL LEVEL_CONTROL ON_OFF BASIC "
+    "cluster=0x0000 cluster=0x0001 cluster=0x0402 cluster=0x0405 cluster=0x0406 cluster=0x0500 "
+    "cluster=0x0300 cluster=0x0008 cluster=0x0006 attr=0x0000 attr=0x0001 type=bool type=u8 type=u16 "
+    "{\"ieee\":\"00:12:4b:00:\",\"short\":\"0x\",\"ep\":1,\"cluster\":\"0x0006\",\"attr\":\"0x0000\",\"value\":}"
+    "leave rejoin steering formation mode:router mode:end status=OK status=FAIL lqi= rssi=- "
+    "zdo_signal=DEVICE_ANNCE attr_report ep=1 value= short=0x ieee=00:12:4b:00:";
+
+constexpr size_t kDictionaryLen = sizeof(kDictionary) - 1;
+static_assert(kDictionaryLen <= kMaxDictionary, "dictionary larger than the workspace allows");
+static_assert(kDictionaryLen + kMaxDecoded <= kMaxDistance, "window must cover dictionary and payload");
+static_assert(kMaxDictionary + kMaxDecoded <= 32767, "positions must fit in int16_t");
+
+constexpr int kMaxChain = 32;
+
+// Byte at `index` of dictionary ++ input.
+inline uint8_t history_at(const uint8_t* in, size_t index) {
+  return index < kDictionaryLen ? static_cast<uint8_t>(kDictionary[index]) : in[index - kDictionaryLen];
+}
+
+inline uint32_t hash3(uint8_t a, uint8_t b, uint8_t c) {
+  return ((a << 4) ^ (b << 2) ^ c) & (kHashSize - 1);
+}
+
+void insert(Workspace* ws, const uint8_t* in, size_t index) {
+  const uint32_t h = hash3(history_at(in, index), history_at(in, index + 1), history_at(in, index + 2));
+  ws->prev[index] = ws->head[h];
+  ws->head[h] = static_cast<int16_t>(index);
+}
+
+}  // namespace
+
+size_t dictionary_size() {
+  return kDictionaryLen;
+}
+
+size_t compress(const uint8_t* in, size_t len, uint8_t* out, size_t out_cap, Workspace* workspace) {
+  if (!in || !out || !workspace || len < kMinMatch || len > kMaxDecoded) {
+    return 0;
+  }
+  Workspace* ws = workspace;
+  memset(ws->head, 0xFF, sizeof(ws->head));
+  for (size_t i = 0; i + 2 < kDictionaryLen; ++i) {
+    insert(ws, in, i);
+  }
+
+  const size_t end = kDictionaryLen + len;
+  size_t pos = kDictionaryLen;
+  size_t o = 0;
+  size_t flags_at = 0;
+  uint8_t bit = 0;
+  while (pos < end) {
+    if (bit == 0) {
+      if (o >= out_cap) {
+        return 0;
+      }
+      flags_at = o++;
+      out[flags_at] = 0;
+    }
+    size_t best_len = 0;
+    size_t best_dist = 0;
+    const size_t limit = end - pos < kMaxMatch ? end - pos : kMaxMatch;
+    if (limit >= kMinMatch) {
+      const uint32_t h = hash3(history_at(in, pos), history_at(in, pos + 1), history_at(in, pos + 2));
+      int candidate = ws->head[h];
+      for (int chain = 0; candidate >= 0 && chain < kMaxChain; ++chain) {
+        const size_t c = static_cast<size_t>(candidate);
+        size_t n = 0;
+        while (n < limit && history_at(in, c + n) == history_at(in, pos + n)) {
+          ++n;
+        }
+        if (n > best_len) {
+          best_len = n;
+          best_dist = pos - c;
+          if (n == limit) {
+            break;
+          }
+        }
+        candidate = ws->prev[c];
+      }
+    }
+    if (best_len >= kMinMatch) {
+      if (o + 2 > out_cap) {
+        return 0;
+      }
+      const size_t d = best_dist - 1;
+      out[o++] = static_cast<uint8_t>(((best_len - kMinMatch) << 4) | (d >> 8));
+      out[o++] = static_cast<uint8_t>(d & 0xFF);
+      out[flags_at] |= static_cast<uint8_t>(1u << bit);
+      for (size_t k = 0; k < best_len; ++k, ++pos) {
+        if (pos + 2 < end) {
+          insert(ws, in, pos);
+        }
+      }
+    } else {
+      if (o >= out_cap) {
+        return 0;
+      }
+      out[o++] = in[pos - kDictionaryLen];
+      if (pos + 2 < end) {
+        insert(ws, in, pos);
+      }
+      ++pos;
+    }
+    bit = (bit + 1) & 7;
+  }
+  return o < len ? o : 0;
+}
+
+void Decoder::begin(uint8_t* out, size_t out_cap) {
+  out_ = out;
+  cap_ = out_cap;
+  pos_ = 0;
+  flags_ = 0;
+  items_left_ = 0;
+  have_high_ = false;
+  error_ = false;
+}
+
+bool Decoder::feed(const uint8_t* in, size_t len) {
+  if (error_) {
+    return false;
+  }
+  for (size_t i = 0; i < len; ++i) {
+    const uint8_t byte = in[i];
+    if (have_high_) {
+      have_high_ = false;
+      const size_t length = (high_ >> 4) + kMinMatch;
+      const size_t distance = ((static_cast<size_t>(high_ & 0x0F) << 8) | byte) + 1;
+      if (distance > pos_ + kDictionaryLen || pos_ + length > cap_) {
+        error_ = true;
+        return false;
+      }
+      // Byte by byte: overlapping matches (distance < length) repeat the pattern.
+      for (size_t k = 0; k < length; ++k, ++pos_) {
+        out_[pos_] = distance > pos_ ? static_cast<uint8_t>(kDictionary[kDictionaryLen - (distance - pos_)])
+                                     : out_[pos_ - distance];
+      }
+      continue;
+    }
+    if (items_left_ == 0) {
+      flags_ = byte;
+      items_left_ = 8;
+      continue;
+    }
+    const bool match = flags_ & 1;
+    flags_ >>= 1;
+    --items_left_;
+    if (match) {
+      high_ = byte;
+      have_high_ = true;
+    } else {
+      if (pos_ >= cap_) {
+        error_ = true;
+        return false;
+      }
+      out_[pos_++] = byte;
+    }
+  }
+  return true;
+}
+
+}  // namespace link_codec
@@ -0,0 +1,70 @@
+#ifndef LINK_CODEC_H_
+#define LINK_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Per-frame payload compression for the UART link.
+ *
+ * LZSS with a 4 KB window whose oldest part is a static dictionary of Zigbee
+ * tokens (cluster names and IDs, signal keys, IEEE prefixes), so even a single
+ * short frame finds matches. Stream layout: a flags byte (LSB first, 1 = match)
+ * followed by up to eight items; a literal is one byte, a match is two bytes
+ * holding a 4-bit length (3..18) and a 12-bit distance (1..4096) back from the
+ * current output position, reaching into the dictionary when it passes the start.
+ *
+ * The decoder is streaming: feed() accepts the input in any split and writes
+ * straight into the caller's buffer, which is also its only history.
+ */
+namespace link_codec {
+
+constexpr uint8_t kCompressedFlag = 0x80;  // OR-ed into the frame type byte
+constexpr size_t kMaxDecoded = 512;        // largest payload a compressed frame may expand to
+constexpr size_t kMinInput = 24;           // shorter payloads are sent as-is
+
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 18;
+constexpr size_t kMaxDistance = 4096;
+constexpr size_t kHashSize = 256;
+constexpr size_t kMaxDictionary = 1024;
+
+// Hash chains over dictionary + input; about 3 KB, so callers keep one static and serialize use.
+struct Workspace {
+  int16_t head[kHashSize];
+  int16_t prev[kMaxDictionary + kMaxDecoded];
+};
+
+// Returns the compressed size, or 0 if the result would not be smaller than the input
+// or does not fit in out_cap.
+size_t compress(const uint8_t* in, size_t len, uint8_t* out, size_t out_cap, Workspace* workspace);
+
+class Decoder {
+ public:
+  void begin(uint8_t* out, size_t out_cap);
+  // False once the stream is corrupt or would overflow the output buffer.
+  bool feed(const uint8_t* in, size_t len);
+  // True when everything fed so far ended on an item boundary without errors.
+  bool finish() const {
+    return !error_ && !have_high_;
+  }
+  size_t size() const {
+    return pos_;
+  }
+
+ private:
+  uint8_t* out_ = nullptr;
+  size_t cap_ = 0;
+  size_t pos_ = 0;
+  uint8_t flags_ = 0;
+  uint8_t items_left_ = 0;  // items still covered by flags_
+  uint8_t high_ = 0;        // first byte of a match split across feed() calls
+  bool have_high_ = false;
+  bool error_ = false;
+};
+
+size_t dictionary_size();
+
+}  // namespace link_codec
+
+#endif  // LINK_CODEC_H_
@@ -0,0 +1,35 @@
+#include "link_framer.h"
+
+LinkFramer::Result LinkFramer::push(const uint8_t* data, size_t len, size_t* consumed, uart_link_frame_t* out) {
+  for (size_t i = 0; i < len; ++i) {
+    const uint8_t byte = data[i];
+    if (length_ == 0 && byte != UART_LINK_PREAMBLE) {
+      continue;
+    }
+    if (length_ >= sizeof(buffer_)) {
+      reset();
+      *consumed = i + 1;
+      return Result::kOverrun;
+    }
+    buffer_[length_++] = byte;
+    if (length_ >= 5 && expected_ == 0) {
+      const uint16_t payload_len = (static_cast<uint16_t>(buffer_[3]) << 8) | buffer_[4];
+      const size_t total = 1 + 1 + 1 + 2 + payload_len + 2;
+      if (payload_len > UART_LINK_MAX_PAYLOAD || total > sizeof(buffer_)) {
+        bad_length_ = payload_len;
+        reset();
+        *consumed = i + 1;
+        return Result::kBadLength;
+      }
+      expected_ = total;
+    }
+    if (expected_ && length_ == expected_) {
+      const bool ok = uart_link_try_parse(buffer_, length_, out);
+      reset();
+      *consumed = i + 1;
+      return ok ? Result::kFrame : Result::kCrcError;
+    }
+  }
+  *consumed = len;
+  return Result::kNeedMore;
+}
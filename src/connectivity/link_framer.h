@@ -0,0 +1,54 @@
+#ifndef LINK_FRAMER_H_
+#define LINK_FRAMER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "uart_link_protocol.h"
+
+/*
+ * Byte-level framing of the UART link: skips to the preamble, checks the length field and
+ * runs the protocol's CRC check once a frame is complete. It is the only link code that
+ * touches every received byte, so it lives in its own object: with
+ * APP_UART_LINK_IRAM_PROFILE, linker.lf places this object, including its copy of the
+ * protocol's parser, in IRAM and its constants in DRAM. Of what a complete frame triggers,
+ * only the link counters join it there; decoding, dispatch and logs stay in flash with the
+ * caller.
+ *
+ * No RTOS or driver dependencies; the caller owns one framer per RX stream.
+ */
+class LinkFramer {
+ public:
+  enum class Result : uint8_t {
+    kNeedMore,   // all input consumed without completing a frame
+    kFrame,      // *out holds a frame that passed the CRC
+    kCrcError,   // a complete frame failed the CRC or was malformed
+    kBadLength,  // the length field is over UART_LINK_MAX_PAYLOAD; the frame was dropped
+    kOverrun,    // a frame outgrew the buffer; the bytes so far were dropped
+  };
+
+  void reset() {
+    length_ = 0;
+    expected_ = 0;
+  }
+
+  /**
+   * Consume bytes from data until one frame completes or something goes wrong. Sets
+   * *consumed to the bytes used; call again with the rest of the input. The framer is
+   * ready for the next frame whatever the result.
+   */
+  Result push(const uint8_t* data, size_t len, size_t* consumed, uart_link_frame_t* out);
+
+  // Length field of the last kBadLength result.
+  uint16_t bad_length() const {
+    return bad_length_;
+  }
+
+ private:
+  uint8_t buffer_[UART_LINK_MAX_PAYLOAD + 8];
+  size_t length_ = 0;
+  size_t expected_ = 0;
+  uint16_t bad_length_ = 0;
+};
+
+#endif  // LINK_FRAMER_H_
@@ -0,0 +1,135 @@
+#include "link_state_machine.h"
+
+namespace {
+
+bool at_or_after(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+}  // namespace
+
+LinkStateMachine::LinkStateMachine(const Config& config) : config_(config) {}
+
+void LinkStateMachine::enter(State state) {
+  state_ = state;
+}
+
+uint32_t LinkStateMachine::jittered(uint32_t delay_ms, uint32_t random) const {
+  // Spread retries over delay * (1 +/- jitter) so both ends never retry in lockstep.
+  const uint32_t span = delay_ms * config_.jitter_percent / 100;
+  if (span == 0) {
+    return delay_ms;
+  }
+  return delay_ms - span + random % (2 * span + 1);
+}
+
+void LinkStateMachine::start(uint32_t now_ms) {
+  enter(State::kDown);
+  down_since_ms_ = now_ms;
+  backoff_ms_ = config_.initial_backoff_ms;
+  due_now_ = true;
+}
+
+void LinkStateMachine::restart(uint32_t now_ms) {
+  if (is_up()) {
+    down_since_ms_ = now_ms;
+  }
+  enter(State::kHandshaking);
+  backoff_ms_ = config_.initial_backoff_ms;
+  due_now_ = true;
+}
+
+void LinkStateMachine::lose_link(uint32_t now_ms) {
+  if (is_up()) {
+    down_since_ms_ = now_ms;
+  }
+  backoff_ms_ = config_.initial_backoff_ms;
+  due_now_ = true;
+}
+
+void LinkStateMachine::on_peer_hello(uint32_t now_ms) {
+  // A HELLO while UP means the co-processor rebooted; renegotiate right away.
+  lose_link(now_ms);
+  enter(State::kHandshaking);
+}
+
+void LinkStateMachine::on_handshake(bool ok, uint32_t now_ms) {
+  if (!ok) {
+    // Incompatible settings will not fix themselves quickly; retry at the slow end.
+    stats_.mismatches++;
+    if (is_up()) {
+      down_since_ms_ = now_ms;
+    }
+    enter(State::kHandshaking);
+    backoff_ms_ = config_.max_backoff_ms;
+    due_now_ = false;
+    deadline_ms_ = now_ms + backoff_ms_;
+    return;
+  }
+  if (is_up()) {
+    return;
+  }
+  const uint32_t elapsed = now_ms - down_since_ms_;
+  stats_.up_count++;
+  stats_.last_time_to_up_ms = elapsed;
+  if (elapsed > stats_.max_time_to_up_ms) {
+    stats_.max_time_to_up_ms = elapsed;
+  }
+  backoff_ms_ = config_.initial_backoff_ms;
+  enter(degraded_ ? State::kDegraded : State::kUp);
+}
+
+void LinkStateMachine::on_peer_dead(uint32_t now_ms) {
+  if (!is_up()) {
+    return;  // already negotiating on its own schedule
+  }
+  lose_link(now_ms);
+  enter(State::kDown);
+}
+
+void LinkStateMachine::on_degraded() {
+  degraded_ = true;
+  if (state_ == State::kUp) {
+    enter(State::kDegraded);
+  }
+}
+
+void LinkStateMachine::on_recovered() {
+  degraded_ = false;
+  if (state_ == State::kDegraded) {
+    enter(State::kUp);
+  }
+}
+
+LinkStateMachine::Action LinkStateMachine::poll(uint32_t now_ms, uint32_t random) {
+  Action action = {false, false, false, UINT32_MAX};
+  if (!is_up() && (due_now_ || at_or_after(now_ms, deadline_ms_))) {
+    due_now_ = false;
+    switch (state_) {
+      case State::kDown:
+        // Announce ourselves first; a peer that answers with HELLO skips the wait.
+        action.send_hello = true;
+        enter(State::kHello);
+        deadline_ms_ = now_ms + jittered(backoff_ms_, random);
+        break;
+      case State::kHello:
+      case State::kHandshaking:
+        action.send_handshake = true;
+        stats_.handshakes_sent++;
+        if (state_ == State::kHandshaking) {
+          backoff_ms_ = backoff_ms_ >= config_.max_backoff_ms / 2 ? config_.max_backoff_ms : backoff_ms_ * 2;
+        }
+        enter(State::kHandshaking);
+        deadline_ms_ = now_ms + jittered(backoff_ms_, random);
+        break;
+      default:
+        break;
+    }
+  }
+  if (!is_up()) {
+    action.next_poll_ms = due_now_ || at_or_after(now_ms, deadline_ms_) ? 0 : deadline_ms_ - now_ms;
+  }
+  action.state_changed = state_ != reported_;
+  reported_ = state_;
+  return action;
+}
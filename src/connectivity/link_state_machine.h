@@ -0,0 +1,83 @@
+#ifndef LINK_STATE_MACHINE_H_
+#define LINK_STATE_MACHINE_H_
+
+#include <cstdint>
+
+/*
+ * Link negotiation state machine: DOWN -> HELLO -> HANDSHAKING -> UP <-> DEGRADED.
+ *
+ * Like LinkSupervisor it is pure logic: inputs are frame events from the RX task and
+ * supervisor verdicts, the caller supplies the clock and a random word for jitter, and
+ * poll() says which frame to send and when to poll again. Retries back off
+ * exponentially from initial_backoff_ms to max_backoff_ms with +/- jitter_percent, so a
+ * co-processor reset is renegotiated within dead-peer detection plus one max backoff
+ * (immediately if the peer announces itself with HELLO).
+ */
+class LinkStateMachine {
+ public:
+  enum class State : uint8_t { kDown, kHello, kHandshaking, kUp, kDegraded };
+
+  struct Config {
+    uint32_t initial_backoff_ms = 250;
+    uint32_t max_backoff_ms = 8000;
+    uint32_t jitter_percent = 25;
+  };
+
+  struct Action {
+    bool send_hello;
+    bool send_handshake;
+    bool state_changed;     // state differs from the one reported by the previous poll
+    uint32_t next_poll_ms;  // UINT32_MAX while UP/DEGRADED: nothing scheduled
+  };
+
+  struct Stats {
+    uint32_t handshakes_sent;
+    uint32_t mismatches;          // handshakes received with incompatible settings
+    uint32_t up_count;            // transitions into UP from a negotiating state
+    uint32_t last_time_to_up_ms;  // from losing the link (or boot) until UP
+    uint32_t max_time_to_up_ms;
+  };
+
+  LinkStateMachine() = default;
+  explicit LinkStateMachine(const Config& config);
+
+  // Begin negotiating from DOWN (boot, resume).
+  void start(uint32_t now_ms);
+  // Force a fresh handshake now, e.g. on operator request.
+  void restart(uint32_t now_ms);
+
+  void on_peer_hello(uint32_t now_ms);
+  void on_handshake(bool ok, uint32_t now_ms);
+  void on_peer_dead(uint32_t now_ms);
+  void on_degraded();
+  void on_recovered();
+
+  Action poll(uint32_t now_ms, uint32_t random);
+
+  State state() const {
+    return state_;
+  }
+  bool is_up() const {
+    return state_ == State::kUp || state_ == State::kDegraded;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  void enter(State state);
+  void lose_link(uint32_t now_ms);
+  uint32_t jittered(uint32_t delay_ms, uint32_t random) const;
+
+  Config config_;
+  State state_ = State::kDown;
+  State reported_ = State::kDown;
+  bool degraded_ = false;  // supervisor verdict, remembered while negotiating
+  bool due_now_ = true;    // next poll acts immediately regardless of deadline
+  uint32_t deadline_ms_ = 0;
+  uint32_t backoff_ms_ = 0;
+  uint32_t down_since_ms_ = 0;
+  Stats stats_ = {};
+};
+
+#endif  // LINK_STATE_MACHINE_H_
@@ -0,0 +1,254 @@
+#include "link_stats.h"
+
+namespace {
+
+constexpr uint32_t kWindowSeconds[UART_LINK_METRIC_WINDOWS] = {1, 10, 60};
+
+void fill_histogram(const debug::Histogram<>& histogram, uart_link_histogram_t* out) {
+  const auto summary = histogram.summarize();
+  out->count = summary.count;
+  out->min = summary.min;
+  out->mean = summary.mean;
+  out->p50 = summary.p50;
+  out->p90 = summary.p90;
+  out->p99 = summary.p99;
+  out->max = summary.max;
+}
+
+}  // namespace
+
+void LinkStats::rx_begin() {
+  rx_seq_.store(rx_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void LinkStats::rx_end() {
+  rx_seq_.store(rx_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+LinkStats::RxSnapshot LinkStats::rx_snapshot() const {
+  RxSnapshot snapshot;
+  uint32_t seq;
+  do {
+    seq = rx_seq_.load(std::memory_order_acquire);
+    snapshot.frames = rx_frames_.load(std::memory_order_relaxed);
+    snapshot.bytes = rx_bytes_.load(std::memory_order_relaxed);
+    snapshot.crc_errors = rx_crc_errors_.load(std::memory_order_relaxed);
+    snapshot.dropped = rx_dropped_.load(std::memory_order_relaxed);
+    snapshot.loopback = rx_loopback_.load(std::memory_order_relaxed);
+    const uint32_t lo = rx_last_lo_.load(std::memory_order_relaxed);
+    const uint32_t hi = rx_last_hi_.load(std::memory_order_relaxed);
+    snapshot.last_us = static_cast<int64_t>((static_cast<uint64_t>(hi) << 32) | lo);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) || seq != rx_seq_.load(std::memory_order_relaxed));
+  return snapshot;
+}
+
+void LinkStats::rx_bytes(size_t count) {
+  rx_begin();
+  bump(rx_bytes_, static_cast<uint32_t>(count));
+  rx_end();
+}
+
+void LinkStats::rx_frame(uint16_t payload_len, int64_t now_us) {
+  const int64_t last_us = static_cast<int64_t>(
+      (static_cast<uint64_t>(rx_last_hi_.load(std::memory_order_relaxed)) << 32) |
+      rx_last_lo_.load(std::memory_order_relaxed));
+  const bool first = rx_frames_.load(std::memory_order_relaxed) == 0;
+  rx_begin();
+  bump(rx_frames_);
+  rx_last_lo_.store(static_cast<uint32_t>(now_us), std::memory_order_relaxed);
+  rx_last_hi_.store(static_cast<uint32_t>(static_cast<uint64_t>(now_us) >> 32), std::memory_order_relaxed);
+  rx_end();
+  frame_bytes_.record(payload_len + kFrameOverhead);
+  if (!first && now_us >= last_us) {
+    const int64_t gap = now_us - last_us;
+    rx_interarrival_us_.record(gap > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(gap));
+  }
+}
+
+void LinkStats::rx_crc_error() {
+  rx_begin();
+  bump(rx_crc_errors_);
+  rx_end();
+}
+
+void LinkStats::rx_dropped() {
+  rx_begin();
+  bump(rx_dropped_);
+  rx_end();
+}
+
+void LinkStats::rx_loopback() {
+  rx_begin();
+  bump(rx_loopback_);
+  rx_end();
+}
+
+void LinkStats::rx_compressed(size_t raw_len, size_t packed_len) {
+  bump(rx_compressed_frames_);
+  bump(rx_compressed_raw_, static_cast<uint32_t>(raw_len));
+  bump(rx_compressed_bytes_, static_cast<uint32_t>(packed_len));
+}
+
+void LinkStats::rx_decode_error() {
+  bump(rx_decode_errors_);
+}
+
+void LinkStats::rx_overflow() {
+  bump(rx_overflows_);
+}
+
+void LinkStats::tx_frame(size_t encoded_len, uint32_t latency_us, int64_t now_us) {
+  tx_frames_.fetch_add(1, std::memory_order_relaxed);
+  tx_bytes_.fetch_add(static_cast<uint32_t>(encoded_len), std::memory_order_relaxed);
+  tx_last_ms_.store(static_cast<uint32_t>(now_us / 1000), std::memory_order_relaxed);
+  frame_bytes_.record(static_cast<uint32_t>(encoded_len));
+  tx_latency_us_.record(latency_us);
+}
+
+void LinkStats::tx_error() {
+  tx_errors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkStats::tx_compressed(size_t raw_len, size_t packed_len) {
+  tx_compressed_frames_.fetch_add(1, std::memory_order_relaxed);
+  tx_compressed_raw_.fetch_add(static_cast<uint32_t>(raw_len), std::memory_order_relaxed);
+  tx_compressed_bytes_.fetch_add(static_cast<uint32_t>(packed_len), std::memory_order_relaxed);
+}
+
+LinkStats::Totals LinkStats::totals_now(int64_t now_us) const {
+  const RxSnapshot rx = rx_snapshot();
+  Totals totals;
+  totals.time_ms = static_cast<uint32_t>(now_us / 1000);
+  totals.frames_rx = rx.frames;
+  totals.bytes_rx = rx.bytes;
+  totals.frames_tx = tx_frames_.load(std::memory_order_relaxed);
+  totals.bytes_tx = tx_bytes_.load(std::memory_order_relaxed);
+  totals.crc_errors = rx.crc_errors;
+  totals.dropped = rx.dropped;
+  return totals;
+}
+
+void LinkStats::tick(int64_t now_us) {
+  const Totals totals = totals_now(now_us);
+  const uint32_t ticks = window_ticks_.load(std::memory_order_relaxed);
+  TotalsSlot& slot = window_[ticks % kWindowSlots];
+  window_seq_.store(window_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.time_ms.store(totals.time_ms, std::memory_order_relaxed);
+  slot.frames_rx.store(totals.frames_rx, std::memory_order_relaxed);
+  slot.bytes_rx.store(totals.bytes_rx, std::memory_order_relaxed);
+  slot.frames_tx.store(totals.frames_tx, std::memory_order_relaxed);
+  slot.bytes_tx.store(totals.bytes_tx, std::memory_order_relaxed);
+  slot.crc_errors.store(totals.crc_errors, std::memory_order_relaxed);
+  slot.dropped.store(totals.dropped, std::memory_order_relaxed);
+  window_ticks_.store(ticks + 1, std::memory_order_relaxed);
+  window_seq_.store(window_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Totals recorded `ticks_back` ticks before the newest one (clamped to the oldest kept).
+bool LinkStats::totals_at(uint32_t ticks_back, Totals* out) const {
+  uint32_t seq;
+  do {
+    seq = window_seq_.load(std::memory_order_acquire);
+    const uint32_t ticks = window_ticks_.load(std::memory_order_relaxed);
+    if (ticks == 0) {
+      return false;
+    }
+    const uint32_t kept = ticks < kWindowSlots ? ticks : kWindowSlots;
+    if (ticks_back >= kept) {
+      ticks_back = kept - 1;
+    }
+    const TotalsSlot& slot = window_[(ticks - 1 - ticks_back) % kWindowSlots];
+    out->time_ms = slot.time_ms.load(std::memory_order_relaxed);
+    out->frames_rx = slot.frames_rx.load(std::memory_order_relaxed);
+    out->bytes_rx = slot.bytes_rx.load(std::memory_order_relaxed);
+    out->frames_tx = slot.frames_tx.load(std::memory_order_relaxed);
+    out->bytes_tx = slot.bytes_tx.load(std::memory_order_relaxed);
+    out->crc_errors = slot.crc_errors.load(std::memory_order_relaxed);
+    out->dropped = slot.dropped.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) || seq != window_seq_.load(std::memory_order_relaxed));
+  return true;
+}
+
+void LinkStats::fill(uart_link_stats_t* out) const {
+  const RxSnapshot rx = rx_snapshot();
+  out->frames_rx = rx.frames;
+  out->bytes_rx = rx.bytes;
+  out->crc_errors = rx.crc_errors;
+  out->dropped_frames = rx.dropped;
+  out->loopback_frames = rx.loopback;
+  out->last_rx_us = rx.last_us;
+  out->frames_tx = tx_frames_.load(std::memory_order_relaxed);
+  out->bytes_tx = tx_bytes_.load(std::memory_order_relaxed);
+  out->tx_errors = tx_errors_.load(std::memory_order_relaxed);
+  out->last_tx_us = static_cast<int64_t>(tx_last_ms_.load(std::memory_order_relaxed)) * 1000;
+  out->compressed_frames_rx = rx_compressed_frames_.load(std::memory_order_relaxed);
+  out->compressed_raw_bytes_rx = rx_compressed_raw_.load(std::memory_order_relaxed);
+  out->compressed_bytes_rx = rx_compressed_bytes_.load(std::memory_order_relaxed);
+  out->decompress_errors = rx_decode_errors_.load(std::memory_order_relaxed);
+  out->rx_overflows = rx_overflows_.load(std::memory_order_relaxed);
+  out->compressed_frames_tx = tx_compressed_frames_.load(std::memory_order_relaxed);
+  out->compressed_raw_bytes_tx = tx_compressed_raw_.load(std::memory_order_relaxed);
+  out->compressed_bytes_tx = tx_compressed_bytes_.load(std::memory_order_relaxed);
+}
+
+void LinkStats::fill_metrics(uart_link_metrics_t* out, int64_t now_us) const {
+  const Totals now = totals_now(now_us);
+  for (size_t i = 0; i < UART_LINK_METRIC_WINDOWS; ++i) {
+    uart_link_window_t& window = out->windows[i];
+    window = {};
+    Totals then;
+    // Measured from "now", so the span is between n and n + 1 seconds; window_ms has the exact figure.
+    if (!totals_at(kWindowSeconds[i], &then)) {
+      continue;
+    }
+    window.window_ms = now.time_ms - then.time_ms;
+    window.frames_rx = now.frames_rx - then.frames_rx;
+    window.bytes_rx = now.bytes_rx - then.bytes_rx;
+    window.frames_tx = now.frames_tx - then.frames_tx;
+    window.bytes_tx = now.bytes_tx - then.bytes_tx;
+    window.crc_errors = now.crc_errors - then.crc_errors;
+    window.dropped_frames = now.dropped - then.dropped;
+  }
+  fill_histogram(frame_bytes_, &out->frame_bytes);
+  fill_histogram(rx_interarrival_us_, &out->rx_interarrival_us);
+  fill_histogram(tx_latency_us_, &out->tx_latency_us);
+}
+
+void LinkStats::reset_metrics() {
+  frame_bytes_.reset();
+  rx_interarrival_us_.reset();
+  tx_latency_us_.reset();
+}
+
+void LinkStats::hop(uint8_t hop, uint32_t us) {
+  if (hop < UART_LINK_HOP_COUNT) {
+    hops_us_[hop].record(us);
+  }
+}
+
+void LinkStats::stamped_frame(bool synced) {
+  stamped_frames_.fetch_add(1, std::memory_order_relaxed);
+  if (!synced) {
+    unsynced_frames_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void LinkStats::fill_latency(uart_link_latency_t* out) const {
+  for (uint8_t i = 0; i < UART_LINK_HOP_COUNT; ++i) {
+    fill_histogram(hops_us_[i], &out->hops_us[i]);
+  }
+  out->stamped_frames = stamped_frames_.load(std::memory_order_relaxed);
+  out->unsynced_frames = unsynced_frames_.load(std::memory_order_relaxed);
+}
+
+void LinkStats::reset_latency() {
+  for (auto& histogram : hops_us_) {
+    histogram.reset();
+  }
+  stamped_frames_.store(0, std::memory_order_relaxed);
+  unsynced_frames_.store(0, std::memory_order_relaxed);
+}
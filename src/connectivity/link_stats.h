@@ -0,0 +1,139 @@
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "../debug/include/debug/Histogram.h"
+#include "include/uart_link.h"
+
+/*
+ * UART link counters without locks on the hot path.
+ *
+ * RX counters have a single writer (the RX task) and are published through a sequence
+ * counter, so a reader copies a consistent block without stopping the writer. TX counters
+ * may be bumped from any task and are plain 32-bit atomics; the last TX time is kept in ms
+ * for that reason. A 1 Hz tick keeps 60 s of cumulative totals for the sliding-window
+ * rates, and three log-bucketed histograms (32-bit atomics too) record frame size, RX
+ * inter-arrival and TX latency. One more histogram per uart_link_hop_t breaks down the
+ * latency of stamped Zigbee traffic.
+ */
+class LinkStats {
+ public:
+  static constexpr size_t kFrameOverhead = 7;  // preamble, type, seq, length, CRC16
+
+  // RX task only.
+  void rx_bytes(size_t count);
+  void rx_frame(uint16_t payload_len, int64_t now_us);
+  void rx_crc_error();
+  void rx_dropped();
+  void rx_loopback();
+  void rx_compressed(size_t raw_len, size_t packed_len);
+  void rx_decode_error();
+  void rx_overflow();
+
+  // Any task.
+  void tx_frame(size_t encoded_len, uint32_t latency_us, int64_t now_us);
+  void tx_error();
+  void tx_compressed(size_t raw_len, size_t packed_len);
+
+  // Periodic sampler for the sliding windows; call once per second from one context.
+  void tick(int64_t now_us);
+
+  void fill(uart_link_stats_t* out) const;
+  void fill_metrics(uart_link_metrics_t* out, int64_t now_us) const;
+  void reset_metrics();
+
+  // Latency breakdown; any task.
+  void hop(uint8_t hop, uint32_t us);
+  void stamped_frame(bool synced);
+  void fill_latency(uart_link_latency_t* out) const;
+  void reset_latency();
+
+ private:
+  struct RxSnapshot {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t crc_errors;
+    uint32_t dropped;
+    uint32_t loopback;
+    int64_t last_us;
+  };
+
+  struct Totals {
+    uint32_t time_ms;
+    uint32_t frames_rx;
+    uint32_t bytes_rx;
+    uint32_t frames_tx;
+    uint32_t bytes_tx;
+    uint32_t crc_errors;
+    uint32_t dropped;
+  };
+
+  // Ring entries are written by tick() only; fields are atomics so readers never race.
+  struct TotalsSlot {
+    std::atomic<uint32_t> time_ms{0};
+    std::atomic<uint32_t> frames_rx{0};
+    std::atomic<uint32_t> bytes_rx{0};
+    std::atomic<uint32_t> frames_tx{0};
+    std::atomic<uint32_t> bytes_tx{0};
+    std::atomic<uint32_t> crc_errors{0};
+    std::atomic<uint32_t> dropped{0};
+  };
+
+  static constexpr size_t kWindowSlots = 64;  // >= 60 one-second ticks, power of two
+
+  void rx_begin();
+  void rx_end();
+  RxSnapshot rx_snapshot() const;
+  Totals totals_now(int64_t now_us) const;
+  bool totals_at(uint32_t ticks_back, Totals* out) const;
+
+  static void bump(std::atomic<uint32_t>& counter, uint32_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+
+  // RX block: odd sequence while the RX task is updating it.
+  std::atomic<uint32_t> rx_seq_{0};
+  std::atomic<uint32_t> rx_frames_{0};
+  std::atomic<uint32_t> rx_bytes_{0};
+  std::atomic<uint32_t> rx_crc_errors_{0};
+  std::atomic<uint32_t> rx_dropped_{0};
+  std::atomic<uint32_t> rx_loopback_{0};
+  std::atomic<uint32_t> rx_last_lo_{0};
+  std::atomic<uint32_t> rx_last_hi_{0};
+
+  std::atomic<uint32_t> tx_frames_{0};
+  std::atomic<uint32_t> tx_bytes_{0};
+  std::atomic<uint32_t> tx_errors_{0};
+  std::atomic<uint32_t> tx_last_ms_{0};  // 64-bit atomics are not lock-free on the C6
+
+  // Compression counters (payload bytes before/after); not part of the windowed totals.
+  std::atomic<uint32_t> rx_compressed_frames_{0};
+  std::atomic<uint32_t> rx_compressed_raw_{0};
+  std::atomic<uint32_t> rx_compressed_bytes_{0};
+  std::atomic<uint32_t> rx_decode_errors_{0};
+  std::atomic<uint32_t> rx_overflows_{0};  // bytes lost before the RX task saw them
+  std::atomic<uint32_t> tx_compressed_frames_{0};
+  std::atomic<uint32_t> tx_compressed_raw_{0};
+  std::atomic<uint32_t> tx_compressed_bytes_{0};
+
+  std::atomic<uint32_t> window_seq_{0};
+  std::atomic<uint32_t> window_ticks_{0};
+  TotalsSlot window_[kWindowSlots];
+
+  debug::Histogram<> frame_bytes_;
+  debug::Histogram<> rx_interarrival_us_;
+  debug::Histogram<> tx_latency_us_;
+
+  debug::Histogram<> hops_us_[UART_LINK_HOP_COUNT];
+  std::atomic<uint32_t> stamped_frames_{0};
+  std::atomic<uint32_t> unsynced_frames_{0};
+};
+
+// Every counter above and in debug::Histogram is a 32-bit atomic. Wider ones are library
+// calls behind a critical section on the C6.
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "LinkStats hot path must not lock");
+
+#endif  // LINK_STATS_H_
@@ -0,0 +1,144 @@
+#include "link_supervisor.h"
+
+namespace {
+
+constexpr uint32_t kMinPollMs = 10;
+
+// Wrap-safe "a is at or after b" for millisecond timestamps.
+bool at_or_after(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+uint32_t remaining(uint32_t elapsed, uint32_t period) {
+  return elapsed >= period ? 0 : period - elapsed;
+}
+
+}  // namespace
+
+LinkSupervisor::LinkSupervisor(const Config& config) : config_(config) {}
+
+void LinkSupervisor::reset(uint32_t now_ms) {
+  state_ = PeerState::kUnknown;
+  start_ms_ = now_ms;
+  seen_rx_ = false;
+  last_rx_ms_ = 0;
+  last_heartbeat_ms_ = now_ms;
+  fixed_slot_ms_ = now_ms;
+  heartbeat_since_slot_ = false;
+  window_start_ms_ = 0;
+  stats_.probes_unanswered = 0;
+}
+
+void LinkSupervisor::heartbeat_sent(uint32_t now_ms) {
+  last_heartbeat_ms_ = now_ms;
+  heartbeat_since_slot_ = true;
+  stats_.heartbeats_sent++;
+  if (state_ == PeerState::kQuiet || state_ == PeerState::kDead) {
+    stats_.probes_unanswered++;
+  }
+}
+
+uint32_t LinkSupervisor::evaluate_quality(uint32_t now_ms, const Observation& observation) {
+  if (window_start_ms_ == 0) {
+    window_start_ms_ = now_ms ? now_ms : 1;
+    window_base_ = observation;
+    return 0;
+  }
+  if (now_ms - window_start_ms_ < config_.degrade_window_ms) {
+    return 0;
+  }
+  const uint32_t frames = observation.frames_rx - window_base_.frames_rx;
+  const uint32_t bad =
+      (observation.crc_errors - window_base_.crc_errors) + (observation.dropped - window_base_.dropped);
+  const uint32_t loopback = observation.loopback - window_base_.loopback;
+  window_start_ms_ = now_ms ? now_ms : 1;
+  window_base_ = observation;
+  if (frames + bad < config_.min_window_frames && loopback == 0) {
+    return 0;  // too little traffic to judge; keep the current verdict
+  }
+  const uint32_t permille = frames + bad ? static_cast<uint32_t>((static_cast<uint64_t>(bad) * 1000) / (frames + bad)) : 0;
+  stats_.bad_permille = permille;
+  if (!degraded_ && (permille >= config_.degraded_permille || loopback > 0)) {
+    degraded_ = true;
+    stats_.degraded_events++;
+    return kEventDegraded;
+  }
+  if (degraded_ && permille < config_.degraded_permille / 2 && loopback == 0) {
+    degraded_ = false;
+    return kEventRecovered;
+  }
+  return 0;
+}
+
+LinkSupervisor::Decision LinkSupervisor::poll(uint32_t now_ms, const Observation& observation) {
+  Decision decision = {false, 0, config_.keepalive_ms};
+
+  // Any frame from the peer newer than what we knew (and than the last reset) proves liveness.
+  if (observation.last_rx_ms != 0 && at_or_after(observation.last_rx_ms, start_ms_) &&
+      (!seen_rx_ || !at_or_after(last_rx_ms_, observation.last_rx_ms))) {
+    seen_rx_ = true;
+    last_rx_ms_ = observation.last_rx_ms;
+    stats_.probes_unanswered = 0;
+  }
+
+  const uint32_t silence = now_ms - (seen_rx_ ? last_rx_ms_ : start_ms_);
+  const uint32_t dead_after = quiet_after_ms() + config_.dead_after_probes * config_.probe_interval_ms;
+  PeerState next = state_;
+  if (silence < quiet_after_ms()) {
+    next = seen_rx_ ? PeerState::kAlive : PeerState::kUnknown;
+  } else if (silence >= dead_after && stats_.probes_unanswered >= config_.dead_after_probes) {
+    next = PeerState::kDead;
+  } else if (state_ != PeerState::kDead) {
+    next = PeerState::kQuiet;
+  }
+  if (next != state_) {
+    if (next == PeerState::kAlive) {
+      decision.events |= kEventAlive;
+    } else if (next == PeerState::kQuiet) {
+      decision.events |= kEventQuiet;
+    } else if (next == PeerState::kDead) {
+      decision.events |= kEventDead;
+      stats_.dead_events++;
+    }
+    state_ = next;
+  }
+
+  const uint32_t since_heartbeat = now_ms - last_heartbeat_ms_;
+  uint32_t next_poll = config_.keepalive_ms;
+  if (state_ == PeerState::kQuiet) {
+    // Probe quickly so a missing peer is noticed within dead_after_probes intervals.
+    decision.send_heartbeat = since_heartbeat >= config_.probe_interval_ms;
+    next_poll = decision.send_heartbeat ? config_.probe_interval_ms
+                                        : remaining(since_heartbeat, config_.probe_interval_ms);
+  } else {
+    // Alive, unknown or dead: only keep the peer fed when nothing else went out.
+    const uint32_t last_tx = at_or_after(observation.last_tx_ms, last_heartbeat_ms_) ? observation.last_tx_ms
+                                                                                     : last_heartbeat_ms_;
+    const uint32_t tx_silence = now_ms - last_tx;
+    decision.send_heartbeat = tx_silence >= config_.keepalive_ms;
+    next_poll = decision.send_heartbeat ? config_.keepalive_ms : remaining(tx_silence, config_.keepalive_ms);
+    if (state_ != PeerState::kDead) {
+      const uint32_t until_quiet = remaining(silence, quiet_after_ms());
+      if (until_quiet < next_poll) {
+        next_poll = until_quiet;
+      }
+    }
+  }
+
+  // Bookkeeping against the old fixed schedule: one heartbeat per keepalive period.
+  if (now_ms - fixed_slot_ms_ >= config_.keepalive_ms) {
+    if (!heartbeat_since_slot_ && !decision.send_heartbeat) {
+      stats_.heartbeats_suppressed++;
+    }
+    heartbeat_since_slot_ = false;
+    fixed_slot_ms_ = now_ms;
+  }
+
+  decision.events |= evaluate_quality(now_ms, observation);
+  const uint32_t until_window = remaining(now_ms - window_start_ms_, config_.degrade_window_ms);
+  if (until_window < next_poll) {
+    next_poll = until_window;
+  }
+  decision.next_poll_ms = next_poll < kMinPollMs ? kMinPollMs : next_poll;
+  return decision;
+}
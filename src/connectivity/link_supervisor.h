@@ -0,0 +1,108 @@
+#ifndef LINK_SUPERVISOR_H_
+#define LINK_SUPERVISOR_H_
+
+#include <cstdint>
+
+/*
+ * Link supervisor: decides when a heartbeat is worth sending and whether the peer is
+ * still there. It has no RTOS or driver dependencies; the caller feeds it the clock and
+ * the cumulative link counters, so it runs unchanged in host tests.
+ *
+ * - While frames arrive from the peer, liveness is proven and heartbeats are only sent
+ *   if we have not transmitted anything for keepalive_ms.
+ * - Once the peer has been silent for keepalive_ms + probe_interval_ms the link is
+ *   QUIET and heartbeats go out every probe_interval_ms.
+ * - After dead_after_probes unanswered probes the peer is DEAD (reported once).
+ * - CRC errors and drops per received frame, or any loopback, over a degrade window
+ *   raise DEGRADED; the ratio must fall below half the threshold to recover.
+ */
+class LinkSupervisor {
+ public:
+  enum class PeerState : uint8_t { kUnknown, kAlive, kQuiet, kDead };
+
+  enum Event : uint32_t {
+    kEventAlive = 1u << 0,
+    kEventQuiet = 1u << 1,
+    kEventDead = 1u << 2,
+    kEventDegraded = 1u << 3,
+    kEventRecovered = 1u << 4,
+  };
+
+  struct Config {
+    uint32_t keepalive_ms = 2000;
+    uint32_t probe_interval_ms = 500;
+    uint32_t dead_after_probes = 4;
+    uint32_t degraded_permille = 50;
+    uint32_t degrade_window_ms = 10000;
+    uint32_t min_window_frames = 20;
+  };
+
+  // Cumulative link counters and timestamps (ms since boot, 0 = never).
+  struct Observation {
+    uint32_t last_rx_ms;
+    uint32_t last_tx_ms;
+    uint32_t frames_rx;
+    uint32_t crc_errors;
+    uint32_t dropped;
+    uint32_t loopback;
+  };
+
+  struct Decision {
+    bool send_heartbeat;
+    uint32_t events;        // Event bits raised by this poll
+    uint32_t next_poll_ms;  // how long the caller may sleep before polling again
+  };
+
+  struct Stats {
+    uint32_t heartbeats_sent;
+    uint32_t heartbeats_suppressed;  // fixed-interval heartbeats that traffic made unnecessary
+    uint32_t probes_unanswered;      // probes sent since the last frame from the peer
+    uint32_t dead_events;
+    uint32_t degraded_events;
+    uint32_t bad_permille;           // CRC + drops per received frame in the last judged window
+  };
+
+  LinkSupervisor() = default;
+  explicit LinkSupervisor(const Config& config);
+
+  // Restart supervision (e.g. after suspend/resume); the peer is UNKNOWN until it speaks.
+  void reset(uint32_t now_ms);
+
+  // Evaluate the link; the caller sends the heartbeat when asked and reports it with heartbeat_sent().
+  Decision poll(uint32_t now_ms, const Observation& observation);
+  void heartbeat_sent(uint32_t now_ms);
+
+  PeerState peer_state() const {
+    return state_;
+  }
+  bool degraded() const {
+    return degraded_;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  const Config& config() const {
+    return config_;
+  }
+
+ private:
+  uint32_t quiet_after_ms() const {
+    return config_.keepalive_ms + config_.probe_interval_ms;
+  }
+  uint32_t evaluate_quality(uint32_t now_ms, const Observation& observation);
+
+  Config config_;
+  PeerState state_ = PeerState::kUnknown;
+  bool degraded_ = false;
+  uint32_t start_ms_ = 0;
+  uint32_t last_rx_ms_ = 0;
+  uint32_t last_heartbeat_ms_ = 0;
+  uint32_t fixed_slot_ms_ = 0;  // when the old fixed-period heartbeat would fire next
+  bool heartbeat_since_slot_ = false;
+  bool seen_rx_ = false;
+  uint32_t window_start_ms_ = 0;
+  Observation window_base_ = {};
+  Stats stats_ = {};
+};
+
+#endif  // LINK_SUPERVISOR_H_
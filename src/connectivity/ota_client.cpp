@@ -0,0 +1,620 @@
+#include "include/ota_client.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define DEBUG_TAG "OTA"
+#include "../debug/include/debug/Debug.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "include/h2_ota.h"
+#include "include/uart_link.h"
+#include "include/wifi_manager.h"
+#include "mbedtls/sha256.h"
+#include "sdkconfig.h"
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+
+#ifndef CONFIG_APP_OTA_BUFFER_SIZE
+#define CONFIG_APP_OTA_BUFFER_SIZE 4096
+#endif
+#ifndef CONFIG_APP_OTA_MAX_RESUMES
+#define CONFIG_APP_OTA_MAX_RESUMES 8
+#endif
+#ifndef CONFIG_APP_OTA_RECV_TIMEOUT_MS
+#define CONFIG_APP_OTA_RECV_TIMEOUT_MS 10000
+#endif
+#ifndef CONFIG_APP_OTA_HEALTH_TIMEOUT_S
+#define CONFIG_APP_OTA_HEALTH_TIMEOUT_S 120
+#endif
+
+namespace {
+const char* kTag = DEBUG_TAG;
+
+constexpr size_t kBufferSize = CONFIG_APP_OTA_BUFFER_SIZE;
+constexpr uint8_t kBuffers = 2;  // one filling from the network while the other is written to flash
+constexpr UBaseType_t kTaskPriority = 2;  // below the UART link and the OTA relay; WiFi/lwIP run far above
+constexpr uint32_t kWifiWaitMs = 60000;   // how long a resume waits for the network to come back
+constexpr uint32_t kResumeDelayMs = 1000;
+constexpr uint32_t kHealthPollMs = 1000;
+
+// Where the image goes: the hub's inactive slot, or the H2 staging area for h2_ota to relay.
+enum class Target : uint8_t { kSelf, kH2 };
+
+// Handed from the download task to the writer; len 0 ends the stream.
+struct Block {
+  uint8_t index;
+  uint32_t len;
+};
+
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+ota_client_state_t s_state = OTA_CLIENT_IDLE;
+esp_err_t s_error = ESP_OK;
+uint32_t s_image_size = 0;
+uint32_t s_received = 0;
+uint32_t s_written = 0;
+uint32_t s_resumes = 0;
+int64_t s_start_us = 0;
+int64_t s_end_us = 0;
+int64_t s_net_wait_us = 0;
+int64_t s_flash_wait_us = 0;
+
+Target s_target = Target::kSelf;
+const esp_partition_t* s_partition = nullptr;  // kSelf only
+esp_ota_handle_t s_handle = 0;
+uint32_t s_expected_crc32 = 0;  // kH2 only; 0 accepts the computed CRC
+char* s_url = nullptr;
+bool s_check_sha = false;
+uint8_t s_expected_sha[32];
+mbedtls_sha256_context s_sha;
+
+uint8_t* s_buffers[kBuffers];
+QueueHandle_t s_free_queue = nullptr;  // buffer indices ready to be filled
+QueueHandle_t s_full_queue = nullptr;  // Blocks ready to be written
+TaskHandle_t s_task = nullptr;
+volatile bool s_abort = false;
+volatile esp_err_t s_write_error = ESP_OK;
+
+void set_state(ota_client_state_t state) {
+  portENTER_CRITICAL(&s_lock);
+  s_state = state;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void add_wait(int64_t* counter, int64_t since_us) {
+  const int64_t waited = esp_timer_get_time() - since_us;
+  portENTER_CRITICAL(&s_lock);
+  *counter += waited;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+bool parse_sha256(const char* hex, uint8_t* out) {
+  if (strlen(hex) != 64) {
+    return false;
+  }
+  for (int i = 0; i < 32; ++i) {
+    unsigned int byte = 0;
+    if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+      return false;
+    }
+    out[i] = static_cast<uint8_t>(byte);
+  }
+  return true;
+}
+
+// Drains full buffers into the OTA slot. Erase happens sector by sector inside
+// esp_ota_write (sequential-writes mode), so it overlaps the next network read too.
+void writer_task(void* arg) {
+  const TaskHandle_t downloader = static_cast<TaskHandle_t>(arg);
+  Block block;
+  for (;;) {
+    const int64_t idle_since = esp_timer_get_time();
+    xQueueReceive(s_full_queue, &block, portMAX_DELAY);
+    add_wait(&s_net_wait_us, idle_since);
+    if (block.len == 0) {
+      break;
+    }
+    if (s_write_error == ESP_OK) {
+      const uint8_t* data = s_buffers[block.index];
+      const esp_err_t err = s_target == Target::kH2 ? h2_ota_stage_write(data, block.len)
+                                                    : esp_ota_write(s_handle, data, block.len);
+      if (err == ESP_OK) {
+        if (s_check_sha) {
+          mbedtls_sha256_update(&s_sha, data, block.len);
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_written += block.len;
+        portEXIT_CRITICAL(&s_lock);
+      } else {
+        ESP_LOGE(kTag, "Flash write at %" PRIu32 " failed: %s", s_written, esp_err_to_name(err));
+        s_write_error = err;
+      }
+    }
+    xQueueSend(s_free_queue, &block.index, 0);
+  }
+  xTaskNotifyGive(downloader);
+  vTaskDelete(nullptr);
+}
+
+// Blocks until the writer returns a buffer; false if the update is being torn down.
+bool take_free_buffer(uint8_t* index) {
+  const int64_t since = esp_timer_get_time();
+  while (xQueueReceive(s_free_queue, index, pdMS_TO_TICKS(100)) != pdTRUE) {
+    if (s_abort || s_write_error != ESP_OK) {
+      return false;
+    }
+  }
+  add_wait(&s_flash_wait_us, since);
+  return true;
+}
+
+// Opens the image at `offset`. On success *total is the full image size (0 if the server did not say).
+esp_err_t open_at(esp_http_client_handle_t client, uint32_t offset, uint32_t* total) {
+  if (offset) {
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%" PRIu32 "-", offset);
+    esp_http_client_set_header(client, "Range", range);
+  }
+  esp_err_t err = esp_http_client_open(client, 0);
+  if (err != ESP_OK) {
+    return err;
+  }
+  const int64_t length = esp_http_client_fetch_headers(client);
+  const int status = esp_http_client_get_status_code(client);
+  if (offset == 0 && status == 200) {
+    *total = length > 0 ? static_cast<uint32_t>(length) : 0;
+    return ESP_OK;
+  }
+  if (offset && status == 206) {
+    char* value = nullptr;
+    unsigned long first = 0, last = 0, size = 0;
+    if (esp_http_client_get_header(client, "Content-Range", &value) == ESP_OK && value &&
+        sscanf(value, "bytes %lu-%lu/%lu", &first, &last, &size) == 3) {
+      if (first != offset) {
+        ESP_LOGE(kTag, "Server resumed at %lu, asked for %" PRIu32, first, offset);
+        return ESP_ERR_INVALID_RESPONSE;
+      }
+      *total = static_cast<uint32_t>(size);
+    } else {
+      *total = length > 0 ? offset + static_cast<uint32_t>(length) : 0;
+    }
+    return ESP_OK;
+  }
+  if (offset && status == 200) {
+    // The slot cannot be rewound mid-stream, so a server without Range support cannot resume.
+    ESP_LOGE(kTag, "Server ignored the Range request; cannot resume");
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  ESP_LOGE(kTag, "HTTP status %d", status);
+  return ESP_ERR_INVALID_RESPONSE;
+}
+
+bool wait_for_wifi() {
+  for (uint32_t waited = 0; waited < kWifiWaitMs && !s_abort; waited += 500) {
+    if (wifi_manager_is_connected()) {
+      return true;
+    }
+    vTaskDelay(pdMS_TO_TICKS(500));
+  }
+  return false;
+}
+
+// Streams the body into buffers until the image is complete. Dropped connections are
+// re-requested from the first byte not yet handed to the writer.
+esp_err_t download() {
+  esp_http_client_config_t config = {};
+  config.url = s_url;
+  config.timeout_ms = CONFIG_APP_OTA_RECV_TIMEOUT_MS;
+  config.keep_alive_enable = true;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+  config.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+
+  for (;;) {
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+      return ESP_ERR_NO_MEM;
+    }
+    uint32_t total = 0;
+    esp_err_t err = open_at(client, s_received, &total);
+    if (err == ESP_OK && !total && s_target == Target::kH2) {
+      // Staging erases and sizes the area up front.
+      ESP_LOGE(kTag, "Server sent no Content-Length; H2 images need one");
+      err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err == ESP_OK && total) {
+      if (s_image_size && total != s_image_size) {
+        ESP_LOGE(kTag, "Image size changed from %" PRIu32 " to %" PRIu32 " between requests", s_image_size, total);
+        err = ESP_ERR_INVALID_RESPONSE;
+      } else if (s_target == Target::kSelf && total > s_partition->size) {
+        ESP_LOGE(kTag, "Image (%" PRIu32 " bytes) larger than slot %s", total, s_partition->label);
+        err = ESP_ERR_INVALID_SIZE;
+      } else if (s_target == Target::kH2 && !s_image_size && h2_ota_stage_begin(total) != ESP_OK) {
+        ESP_LOGE(kTag, "Cannot stage a %" PRIu32 "-byte H2 image", total);
+        err = ESP_ERR_INVALID_SIZE;
+      } else {
+        portENTER_CRITICAL(&s_lock);
+        s_image_size = total;
+        portEXIT_CRITICAL(&s_lock);
+      }
+    }
+    if (err == ESP_ERR_NOT_SUPPORTED || err == ESP_ERR_INVALID_RESPONSE || err == ESP_ERR_INVALID_SIZE) {
+      esp_http_client_cleanup(client);
+      return err;
+    }
+
+    bool complete = false;
+    if (err == ESP_OK) {
+      set_state(OTA_CLIENT_DOWNLOADING);
+      uint8_t index = 0;
+      while (!complete && take_free_buffer(&index)) {
+        uint8_t* buffer = s_buffers[index];
+        uint32_t fill = 0;
+        bool dropped = false;
+        while (fill < kBufferSize) {
+          const int n = esp_http_client_read(client, reinterpret_cast<char*>(buffer + fill), kBufferSize - fill);
+          if (n > 0) {
+            fill += n;
+          } else {
+            complete = n == 0 && esp_http_client_is_complete_data_received(client);
+            dropped = !complete;
+            break;
+          }
+          if (s_abort) {
+            break;
+          }
+        }
+        if (fill) {
+          const Block block = {index, fill};
+          xQueueSend(s_full_queue, &block, portMAX_DELAY);
+          portENTER_CRITICAL(&s_lock);
+          s_received += fill;
+          portEXIT_CRITICAL(&s_lock);
+        } else {
+          xQueueSend(s_free_queue, &index, 0);
+        }
+        if (s_image_size && s_received >= s_image_size) {
+          complete = true;
+        }
+        if (dropped || s_abort) {
+          break;
+        }
+      }
+    }
+    esp_http_client_cleanup(client);
+
+    if (s_abort) {
+      return ESP_ERR_INVALID_STATE;
+    }
+    if (s_write_error != ESP_OK) {
+      return s_write_error;
+    }
+    if (complete) {
+      return ESP_OK;
+    }
+    if (s_resumes >= CONFIG_APP_OTA_MAX_RESUMES) {
+      ESP_LOGE(kTag, "Giving up after %" PRIu32 " resumes", s_resumes);
+      return ESP_ERR_TIMEOUT;
+    }
+    set_state(OTA_CLIENT_RESUMING);
+    ESP_LOGW(kTag, "Connection lost at %" PRIu32 " bytes (%s); resuming", s_received, esp_err_to_name(err));
+    if (!wait_for_wifi()) {
+      return s_abort ? ESP_ERR_INVALID_STATE : ESP_ERR_TIMEOUT;
+    }
+    vTaskDelay(pdMS_TO_TICKS(kResumeDelayMs));
+    portENTER_CRITICAL(&s_lock);
+    ++s_resumes;
+    portEXIT_CRITICAL(&s_lock);
+  }
+}
+
+// Everything the bootloader would check, plus the optional SHA-256, before otadata changes.
+esp_err_t verify_and_switch() {
+  set_state(OTA_CLIENT_VERIFYING);
+  if (s_image_size && s_written != s_image_size) {
+    ESP_LOGE(kTag, "Wrote %" PRIu32 " of %" PRIu32 " bytes", s_written, s_image_size);
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if (s_check_sha) {
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s_sha, digest);
+    if (memcmp(digest, s_expected_sha, sizeof(digest)) != 0) {
+      ESP_LOGE(kTag, "SHA-256 mismatch");
+      return ESP_ERR_INVALID_CRC;
+    }
+  }
+  if (s_target == Target::kH2) {
+    // Reads the staged bytes back and checks them against the CRC32 given with the image.
+    return h2_ota_stage_finish(s_expected_crc32);
+  }
+  // Checks the image header, segment checksums, the appended hash and (with secure boot) the signature.
+  esp_err_t err = esp_ota_end(s_handle);
+  s_handle = 0;
+  if (err != ESP_OK) {
+    ESP_LOGE(kTag, "Image validation failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  esp_app_desc_t desc;
+  if (esp_ota_get_partition_description(s_partition, &desc) == ESP_OK) {
+    ESP_LOGI(kTag, "New image: %s %s (%s %s)", desc.project_name, desc.version, desc.date, desc.time);
+  }
+  err = esp_ota_set_boot_partition(s_partition);
+  if (err != ESP_OK) {
+    ESP_LOGE(kTag, "Could not switch boot partition: %s", esp_err_to_name(err));
+  }
+  return err;
+}
+
+void download_task(void*) {
+  TaskHandle_t writer = nullptr;
+  // H2 staging starts once the download knows the image size.
+  esp_err_t err = ESP_OK;
+  if (s_target == Target::kSelf) {
+    err = esp_ota_begin(s_partition, OTA_WITH_SEQUENTIAL_WRITES, &s_handle);
+  }
+  if (err == ESP_OK &&
+      xTaskCreate(writer_task, "ota_write", 4096, xTaskGetCurrentTaskHandle(), kTaskPriority, &writer) != pdPASS) {
+    err = ESP_ERR_NO_MEM;
+  }
+  if (err == ESP_OK) {
+    // Modem sleep would hold every TCP window's ACKs until the next beacon.
+    wifi_manager_pin_low_latency(true);
+    err = download();
+    wifi_manager_pin_low_latency(false);
+    const Block end = {0, 0};
+    xQueueSend(s_full_queue, &end, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // writer has flushed everything queued before `end`
+    if (err == ESP_OK) {
+      err = s_write_error != ESP_OK ? s_write_error : verify_and_switch();
+    }
+  }
+  if (s_handle) {
+    esp_ota_abort(s_handle);
+    s_handle = 0;
+  }
+  mbedtls_sha256_free(&s_sha);
+
+  s_end_us = esp_timer_get_time();
+  portENTER_CRITICAL(&s_lock);
+  s_error = err;
+  s_state = err == ESP_OK ? OTA_CLIENT_READY : OTA_CLIENT_FAILED;
+  portEXIT_CRITICAL(&s_lock);
+
+  const uint32_t elapsed_ms = static_cast<uint32_t>((s_end_us - s_start_us) / 1000);
+  if (err == ESP_OK && s_target == Target::kH2) {
+    ESP_LOGI(kTag, "H2 image staged: %" PRIu32 " bytes in %" PRIu32 " ms (%" PRIu32 " resumes); h2_ota start sends it",
+             s_written, elapsed_ms, s_resumes);
+  } else if (err == ESP_OK) {
+    const uint32_t kb_per_s = elapsed_ms ? static_cast<uint32_t>(static_cast<uint64_t>(s_written) / elapsed_ms) : 0;
+    ESP_LOGI(kTag, "Update ready in %s: %" PRIu32 " bytes in %" PRIu32 " ms (%" PRIu32 ".%02" PRIu32 " MB/s, %" PRIu32
+                   " resumes); restart to run it",
+             s_partition->label, s_written, elapsed_ms, kb_per_s / 1000, (kb_per_s % 1000) / 10, s_resumes);
+  } else if (s_abort) {
+    ESP_LOGW(kTag, "Update aborted after %" PRIu32 " bytes", s_written);
+  } else {
+    ESP_LOGE(kTag, "Update failed after %" PRIu32 " bytes: %s", s_written, esp_err_to_name(err));
+  }
+
+  vQueueDelete(s_free_queue);
+  vQueueDelete(s_full_queue);
+  s_free_queue = s_full_queue = nullptr;
+  for (uint8_t i = 0; i < kBuffers; ++i) {
+    free(s_buffers[i]);
+    s_buffers[i] = nullptr;
+  }
+  free(s_url);
+  s_url = nullptr;
+  s_task = nullptr;
+  vTaskDelete(nullptr);
+}
+
+// The updated image has proven itself once it reaches the network and the co-processor.
+bool healthy() {
+#if CONFIG_APP_ENABLE_UART_LINK
+  const uart_link_state_t link = uart_link_get_state();
+  if (link != UART_LINK_STATE_UP && link != UART_LINK_STATE_DEGRADED) {
+    return false;
+  }
+#endif
+  return wifi_manager_is_connected();
+}
+
+// Runs only on the first boot of an updated image. The bootloader reverts the image on the next
+// reset until it is confirmed, so an image that hangs or crashes before this passes is rolled back.
+void health_task(void*) {
+  const int64_t deadline_us = esp_timer_get_time() + CONFIG_APP_OTA_HEALTH_TIMEOUT_S * 1000000LL;
+  while (!healthy()) {
+    if (esp_timer_get_time() > deadline_us) {
+      ESP_LOGE(kTag, "Updated image not healthy after %d s (WiFi %s); rolling back", CONFIG_APP_OTA_HEALTH_TIMEOUT_S,
+               wifi_manager_is_connected() ? "up" : "down");
+      esp_ota_mark_app_invalid_rollback_and_reboot();
+      break;  // only returns if there is no image to roll back to
+    }
+    vTaskDelay(pdMS_TO_TICKS(kHealthPollMs));
+  }
+  if (healthy()) {
+    const esp_err_t err = esp_ota_mark_app_valid_cancel_rollback();
+    ESP_LOGI(kTag, "Updated image healthy; confirmed: %s", esp_err_to_name(err));
+  }
+  vTaskDelete(nullptr);
+}
+
+}  // namespace
+
+esp_err_t ota_client_init(void) {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  esp_ota_img_states_t state;
+  if (running && esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+    ESP_LOGI(kTag, "Updated image in %s pending verification; confirming once WiFi and the H2 link are up",
+             running->label);
+    if (xTaskCreate(health_task, "ota_health", 3072, nullptr, kTaskPriority, nullptr) != pdPASS) {
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  return ESP_OK;
+}
+
+namespace {
+
+esp_err_t start(const char* url, const char* sha256_hex, Target target, uint32_t crc32) {
+  if (!url || (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  uint8_t expected[32];
+  if (sha256_hex && !parse_sha256(sha256_hex, expected)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const esp_partition_t* partition = nullptr;
+  if (target == Target::kSelf) {
+    partition = esp_ota_get_next_update_partition(nullptr);
+    if (!partition) {
+      return ESP_ERR_NOT_FOUND;
+    }
+  } else {
+    for (uint8_t link = 0; link < UART_LINK_MAX_LINKS; ++link) {
+      h2_ota_status_t h2;
+      h2_ota_get_status_on(link, &h2);
+      if (h2.state >= H2_OTA_CONNECTING && h2.state <= H2_OTA_VERIFYING) {
+        return ESP_ERR_INVALID_STATE;  // the staging area is being sent
+      }
+    }
+  }
+
+  s_url = strdup(url);
+  s_free_queue = xQueueCreate(kBuffers, sizeof(uint8_t));
+  s_full_queue = xQueueCreate(kBuffers + 1, sizeof(Block));  // room for the end marker
+  bool ok = s_url && s_free_queue && s_full_queue;
+  for (uint8_t i = 0; i < kBuffers; ++i) {
+    s_buffers[i] = static_cast<uint8_t*>(malloc(kBufferSize));
+    ok = ok && s_buffers[i];
+    if (s_free_queue) {
+      xQueueSend(s_free_queue, &i, 0);
+    }
+  }
+  if (!ok) {
+    for (uint8_t i = 0; i < kBuffers; ++i) {
+      free(s_buffers[i]);
+      s_buffers[i] = nullptr;
+    }
+    if (s_free_queue) {
+      vQueueDelete(s_free_queue);
+    }
+    if (s_full_queue) {
+      vQueueDelete(s_full_queue);
+    }
+    s_free_queue = s_full_queue = nullptr;
+    free(s_url);
+    s_url = nullptr;
+    return ESP_ERR_NO_MEM;
+  }
+
+  s_target = target;
+  s_expected_crc32 = crc32;
+  s_check_sha = sha256_hex != nullptr;
+  memcpy(s_expected_sha, expected, sizeof(expected));
+  mbedtls_sha256_init(&s_sha);
+  mbedtls_sha256_starts(&s_sha, 0);
+  s_partition = partition;
+  s_abort = false;
+  s_write_error = ESP_OK;
+  portENTER_CRITICAL(&s_lock);
+  s_state = OTA_CLIENT_DOWNLOADING;
+  s_error = ESP_OK;
+  s_image_size = s_received = s_written = s_resumes = 0;
+  s_net_wait_us = s_flash_wait_us = 0;
+  portEXIT_CRITICAL(&s_lock);
+  s_start_us = esp_timer_get_time();
+  s_end_us = 0;
+  // HTTPS handshakes need the larger stack.
+  if (xTaskCreate(download_task, "ota_dl", 8192, nullptr, kTaskPriority, &s_task) != pdPASS) {
+    s_task = nullptr;
+    set_state(OTA_CLIENT_IDLE);
+    return ESP_ERR_NO_MEM;
+  }
+  ESP_LOGI(kTag, "Updating %s from %s", partition ? partition->label : "H2 staging", url);
+  return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t ota_client_start(const char* url, const char* sha256_hex) {
+  DEBUG_FUNC_ENTER();
+  const esp_err_t err = start(url, sha256_hex, Target::kSelf, 0);
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+esp_err_t ota_client_fetch_h2(const char* url, uint32_t crc32) {
+  DEBUG_FUNC_ENTER();
+  const esp_err_t err = start(url, nullptr, Target::kH2, crc32);
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+esp_err_t ota_client_abort(void) {
+  if (!s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  s_abort = true;
+  return ESP_OK;
+}
+
+void ota_client_get_status(ota_client_status_t* out_status) {
+  if (!out_status) {
+    return;
+  }
+  memset(out_status, 0, sizeof(*out_status));
+  portENTER_CRITICAL(&s_lock);
+  out_status->state = s_state;
+  out_status->error = s_error;
+  out_status->image_size = s_image_size;
+  out_status->received_bytes = s_received;
+  out_status->written_bytes = s_written;
+  out_status->resumes = s_resumes;
+  out_status->net_wait_ms = static_cast<uint32_t>(s_net_wait_us / 1000);
+  out_status->flash_wait_ms = static_cast<uint32_t>(s_flash_wait_us / 1000);
+  portEXIT_CRITICAL(&s_lock);
+  if (s_target == Target::kH2) {
+    strncpy(out_status->partition, "h2", sizeof(out_status->partition) - 1);
+  } else if (s_partition) {
+    strncpy(out_status->partition, s_partition->label, sizeof(out_status->partition) - 1);
+  }
+  if (out_status->state != OTA_CLIENT_IDLE && s_start_us) {
+    const int64_t end_us = s_end_us ? s_end_us : esp_timer_get_time();
+    out_status->elapsed_ms = static_cast<uint32_t>((end_us - s_start_us) / 1000);
+    if (out_status->elapsed_ms) {
+      out_status->bytes_per_s =
+          static_cast<uint32_t>(static_cast<uint64_t>(out_status->written_bytes) * 1000 / out_status->elapsed_ms);
+    }
+  }
+}
+
+const char* ota_client_state_name(ota_client_state_t state) {
+  switch (state) {
+    case OTA_CLIENT_IDLE:
+      return "idle";
+    case OTA_CLIENT_DOWNLOADING:
+      return "downloading";
+    case OTA_CLIENT_RESUMING:
+      return "resuming";
+    case OTA_CLIENT_VERIFYING:
+      return "verifying";
+    case OTA_CLIENT_READY:
+      return "ready (restart to run)";
+    case OTA_CLIENT_FAILED:
+      return "failed";
+    default:
+      return "unknown";
+  }
+}
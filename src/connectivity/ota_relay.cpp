@@ -0,0 +1,199 @@
+#include "ota_relay.h"
+
+namespace {
+
+bool at_or_after(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+}  // namespace
+
+OtaRelay::OtaRelay(const Config& config) : config_(config) {}
+
+void OtaRelay::start(uint32_t image_size, uint32_t image_crc32) {
+  phase_ = Phase::kBegin;
+  size_ = image_size;
+  crc_ = image_crc32;
+  acked_ = 0;
+  next_send_ = 0;
+  high_sent_ = 0;
+  rewound_to_ = UINT32_MAX;
+  request_ = true;
+  armed_ = false;
+  retries_ = 0;
+  failure_ = ota_wire::kOk;
+  stats_ = {};
+}
+
+void OtaRelay::pause() {
+  if (!active()) {
+    return;
+  }
+  phase_ = Phase::kBegin;
+  next_send_ = acked_;
+  request_ = true;
+  armed_ = false;
+  retries_ = 0;
+}
+
+void OtaRelay::abort(uint8_t status) {
+  phase_ = Phase::kFailed;
+  failure_ = status;
+  armed_ = false;
+}
+
+bool OtaRelay::expired(uint32_t now_ms) const {
+  return armed_ && at_or_after(now_ms, deadline_ms_);
+}
+
+void OtaRelay::arm(uint32_t now_ms) {
+  armed_ = true;
+  deadline_ms_ = now_ms + config_.ack_timeout_ms;
+}
+
+bool OtaRelay::timed_out(uint32_t now_ms) {
+  if (!expired(now_ms)) {
+    return false;
+  }
+  armed_ = false;
+  stats_.timeouts++;
+  if (++retries_ > config_.max_retries) {
+    abort(ota_wire::kTimeout);
+  }
+  return true;
+}
+
+bool OtaRelay::next(uint32_t now_ms, Output* out) {
+  switch (phase_) {
+    case Phase::kBegin:
+    case Phase::kVerifying: {
+      if (!request_ && !timed_out(now_ms)) {
+        return false;
+      }
+      if (!active()) {
+        return false;
+      }
+      request_ = false;
+      arm(now_ms);
+      out->type = phase_ == Phase::kBegin ? UART_LINK_MSG_OTA_BEGIN : UART_LINK_MSG_OTA_END;
+      out->offset = phase_ == Phase::kBegin ? 0 : size_;
+      out->length = 0;
+      return true;
+    }
+    case Phase::kStreaming: {
+      if (timed_out(now_ms)) {
+        if (!active()) {
+          return false;
+        }
+        next_send_ = acked_;  // go back to the first unacknowledged chunk
+      }
+      const uint32_t in_flight = next_send_ - acked_;
+      if (next_send_ >= size_ || in_flight >= static_cast<uint32_t>(config_.window) * config_.chunk_size) {
+        return false;
+      }
+      const uint32_t remaining = size_ - next_send_;
+      out->type = UART_LINK_MSG_OTA_CHUNK;
+      out->offset = next_send_;
+      out->length = static_cast<uint16_t>(remaining < config_.chunk_size ? remaining : config_.chunk_size);
+      if (next_send_ < high_sent_) {
+        stats_.retransmits++;
+      }
+      next_send_ += out->length;
+      if (next_send_ > high_sent_) {
+        high_sent_ = next_send_;
+      }
+      stats_.chunks_sent++;
+      if (!armed_) {
+        arm(now_ms);
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+void OtaRelay::on_ack(const ota_wire::Ack& ack, uint32_t now_ms) {
+  if (!active()) {
+    return;
+  }
+  if (ack.status == ota_wire::kVerifyFailed || ack.status == ota_wire::kNoSpace) {
+    abort(ack.status);
+    return;
+  }
+  const uint32_t offset = ack.offset < size_ ? ack.offset : size_;
+  if (phase_ == Phase::kBegin && ack.op == UART_LINK_MSG_OTA_BEGIN) {
+    if (ack.status != ota_wire::kOk) {
+      return;  // busy: the armed timer resends BEGIN
+    }
+    acked_ = offset;
+    next_send_ = offset;
+    stats_.resumed_from = offset;
+    retries_ = 0;
+    armed_ = false;
+    if (acked_ == size_) {
+      phase_ = Phase::kVerifying;
+      request_ = true;
+    } else {
+      phase_ = Phase::kStreaming;
+    }
+    return;
+  }
+  if (phase_ == Phase::kStreaming && ack.op == UART_LINK_MSG_OTA_CHUNK) {
+    if (ack.status == ota_wire::kRetry) {
+      stats_.naks++;
+      if (offset >= acked_) {
+        acked_ = offset;
+      }
+      if (rewound_to_ != offset && next_send_ > offset) {
+        rewound_to_ = offset;
+        next_send_ = offset;
+        arm(now_ms);
+      }
+      return;
+    }
+    if (ack.status != ota_wire::kOk || offset <= acked_) {
+      return;
+    }
+    acked_ = offset;
+    retries_ = 0;
+    if (rewound_to_ != UINT32_MAX && acked_ > rewound_to_) {
+      rewound_to_ = UINT32_MAX;
+    }
+    if (next_send_ < acked_) {
+      next_send_ = acked_;
+    }
+    if (acked_ == size_) {
+      phase_ = Phase::kVerifying;
+      request_ = true;
+      armed_ = false;
+    } else if (acked_ < next_send_) {
+      arm(now_ms);
+    } else {
+      armed_ = false;
+    }
+    return;
+  }
+  if (phase_ == Phase::kVerifying && ack.op == UART_LINK_MSG_OTA_END && ack.status == ota_wire::kOk &&
+      offset == size_) {
+    phase_ = Phase::kDone;
+    armed_ = false;
+  }
+}
+
+uint32_t OtaRelay::idle_ms(uint32_t now_ms) const {
+  if (!active()) {
+    return UINT32_MAX;
+  }
+  if (request_) {
+    return 0;
+  }
+  if (phase_ == Phase::kStreaming && next_send_ < size_ &&
+      next_send_ - acked_ < static_cast<uint32_t>(config_.window) * config_.chunk_size) {
+    return 0;
+  }
+  if (!armed_) {
+    return config_.ack_timeout_ms;
+  }
+  return at_or_after(now_ms, deadline_ms_) ? 0 : deadline_ms_ - now_ms;
+}
@@ -0,0 +1,144 @@
+#ifndef OTA_RELAY_H_
+#define OTA_RELAY_H_
+
+#include <cstdint>
+
+// Frame types for relaying a firmware image to the H2 (until the shared protocol header carries them).
+#ifndef UART_LINK_MSG_OTA_BEGIN
+#define UART_LINK_MSG_OTA_BEGIN 0x30
+#define UART_LINK_MSG_OTA_CHUNK 0x31
+#define UART_LINK_MSG_OTA_END 0x32
+#define UART_LINK_MSG_OTA_ACK 0x33
+#endif
+
+namespace ota_wire {
+
+enum Status : uint8_t {
+  kOk = 0,
+  kRetry = 1,        // chunk rejected (CRC, gap); resend from ack.offset
+  kVerifyFailed = 2,  // whole-image CRC mismatch; the H2 keeps its running slot
+  kNoSpace = 3,
+  kBusy = 4,
+  kTimeout = 0xFF,  // local only: the H2 stopped answering
+};
+
+// H2 answers with the offset it already holds for this image, so an interrupted
+// transfer resumes instead of starting over.
+struct __attribute__((packed)) Begin {
+  uint32_t image_size;
+  uint32_t image_crc32;
+  uint16_t chunk_size;
+  uint8_t window;
+};
+
+// Followed by the chunk data; crc16 covers the data so the H2 can check what it wrote to flash.
+struct __attribute__((packed)) ChunkHeader {
+  uint32_t offset;
+  uint16_t crc16;
+};
+
+struct __attribute__((packed)) End {
+  uint32_t image_size;
+  uint32_t image_crc32;
+};
+
+// Cumulative: offset is the first byte the H2 does not have yet.
+struct __attribute__((packed)) Ack {
+  uint8_t op;  // frame type being acknowledged
+  uint8_t status;
+  uint32_t offset;
+};
+
+}  // namespace ota_wire
+
+/*
+ * Sender side of the image relay: a sliding window of chunks with cumulative
+ * acknowledgements and go-back-N on timeout or NAK. Pure logic; the caller owns the
+ * clock, the image bytes and the link, so it runs against a simulated H2 on host.
+ */
+class OtaRelay {
+ public:
+  enum class Phase : uint8_t { kIdle, kBegin, kStreaming, kVerifying, kDone, kFailed };
+
+  struct Config {
+    uint16_t chunk_size = 116;  // one bulk-channel fragment: 128 less the fragment and chunk headers
+    uint8_t window = 8;         // chunks in flight; covers the H2's flash write + ack turnaround
+    uint32_t ack_timeout_ms = 600;
+    uint8_t max_retries = 6;    // consecutive timeouts without progress before giving up
+  };
+
+  struct Output {
+    uint8_t type;  // UART_LINK_MSG_OTA_BEGIN/CHUNK/END
+    uint32_t offset;
+    uint16_t length;  // chunk data bytes for CHUNK
+  };
+
+  struct Stats {
+    uint32_t chunks_sent;
+    uint32_t retransmits;  // chunks sent again after go-back-N
+    uint32_t timeouts;
+    uint32_t naks;
+    uint32_t resumed_from;  // offset the H2 reported on the last BEGIN
+  };
+
+  OtaRelay() = default;
+  explicit OtaRelay(const Config& config);
+
+  void start(uint32_t image_size, uint32_t image_crc32);
+  // Link went away mid-transfer: renegotiate with BEGIN, keeping progress and stats.
+  void pause();
+  void abort(uint8_t status);
+
+  // Next frame to send now; false if the window is full or nothing is due.
+  bool next(uint32_t now_ms, Output* out);
+  void on_ack(const ota_wire::Ack& ack, uint32_t now_ms);
+  // Milliseconds until next() may have something to send without an ack arriving.
+  uint32_t idle_ms(uint32_t now_ms) const;
+
+  Phase phase() const {
+    return phase_;
+  }
+  bool active() const {
+    return phase_ == Phase::kBegin || phase_ == Phase::kStreaming || phase_ == Phase::kVerifying;
+  }
+  uint32_t acked() const {
+    return acked_;
+  }
+  uint32_t image_size() const {
+    return size_;
+  }
+  uint32_t image_crc32() const {
+    return crc_;
+  }
+  uint8_t failure() const {
+    return failure_;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  const Config& config() const {
+    return config_;
+  }
+
+ private:
+  bool expired(uint32_t now_ms) const;
+  void arm(uint32_t now_ms);
+  bool timed_out(uint32_t now_ms);
+
+  Config config_;
+  Phase phase_ = Phase::kIdle;
+  uint32_t size_ = 0;
+  uint32_t crc_ = 0;
+  uint32_t acked_ = 0;      // H2 holds [0, acked_)
+  uint32_t next_send_ = 0;  // next chunk offset to transmit
+  uint32_t high_sent_ = 0;  // highest offset ever sent, to count retransmits
+  uint32_t rewound_to_ = UINT32_MAX;  // last NAK rewind; repeats for in-flight chunks are ignored
+  bool request_ = true;     // BEGIN/END due without waiting for the timer
+  bool armed_ = false;
+  uint32_t deadline_ms_ = 0;
+  uint8_t retries_ = 0;
+  uint8_t failure_ = ota_wire::kOk;
+  Stats stats_ = {};
+};
+
+#endif  // OTA_RELAY_H_
@@ -0,0 +1,83 @@
+#include "radio_plan.h"
+
+namespace {
+
+struct Preset {
+  uint16_t scan_interval_ms;
+  uint8_t ble_share_pct;
+  bool passive;
+  RadioPlan::Coex coex;
+  uint32_t ps_idle_ms;
+  uint32_t ps_sleep_ms;
+};
+
+// WiFi first: short passive scans (no scan requests on the air) and the station never
+// sleeps past DTIM. BLE first: the scanner holds the radio most of the time and the
+// station gets out of its way quickly. Balanced timing comes from the caller.
+constexpr Preset kPresets[RadioPlan::kPriorityCount] = {
+    {320, 10, true, RadioPlan::Coex::kPreferWifi, 5000, 0},
+    {100, 30, false, RadioPlan::Coex::kBalance, 0, 0},
+    {100, 90, false, RadioPlan::Coex::kPreferBt, 1000, 5000},
+};
+
+constexpr uint16_t kMinWindowMs = 3;
+
+}  // namespace
+
+RadioPlan::Plan RadioPlan::make(Priority priority, uint8_t share_pct, uint32_t balanced_idle_ms,
+                                uint32_t balanced_sleep_ms) {
+  const Preset& preset = kPresets[static_cast<int>(priority)];
+  Plan plan = {};
+  plan.priority = priority;
+  plan.ble_share_pct = share_pct == 0 ? preset.ble_share_pct : (share_pct > 100 ? 100 : share_pct);
+  plan.scan_interval_ms = preset.scan_interval_ms;
+  const uint32_t window = static_cast<uint32_t>(preset.scan_interval_ms) * plan.ble_share_pct / 100;
+  plan.scan_window_ms = window < kMinWindowMs ? kMinWindowMs : static_cast<uint16_t>(window);
+  plan.passive = preset.passive;
+  plan.coex = preset.coex;
+  if (priority == Priority::kBalanced) {
+    plan.ps_idle_ms = balanced_idle_ms;
+    plan.ps_sleep_ms = balanced_sleep_ms;
+  } else {
+    plan.ps_idle_ms = preset.ps_idle_ms;
+    plan.ps_sleep_ms = preset.ps_sleep_ms;
+  }
+  return plan;
+}
+
+RadioPlan::RadioPlan(const Plan& plan, uint32_t now_ms, const Counters& counters)
+    : plan_(plan), last_ms_(now_ms), last_(counters) {}
+
+void RadioPlan::select(const Plan& plan, uint32_t now_ms, const Counters& counters) {
+  sample(now_ms, counters);
+  plan_ = plan;
+}
+
+void RadioPlan::sample(uint32_t now_ms, const Counters& counters) {
+  Account& account = accounts_[static_cast<int>(plan_.priority)];
+  const uint32_t scan_ms = counters.scan_ms - last_.scan_ms;
+  account.active_ms += now_ms - last_ms_;
+  account.scan_ms += scan_ms;
+  account.ble_air_pct_ms += static_cast<uint64_t>(scan_ms) * plan_.ble_share_pct;
+  account.adverts += counters.adverts - last_.adverts;
+  last_ms_ = now_ms;
+  last_ = counters;
+}
+
+void RadioPlan::reset(uint32_t now_ms, const Counters& counters) {
+  for (Account& account : accounts_) {
+    account = {};
+  }
+  last_ms_ = now_ms;
+  last_ = counters;
+}
+
+RadioPlan::Totals RadioPlan::totals(Priority priority) const {
+  const Account& account = accounts_[static_cast<int>(priority)];
+  Totals totals = {};
+  totals.active_ms = account.active_ms;
+  totals.scan_ms = account.scan_ms;
+  totals.ble_air_ms = static_cast<uint32_t>(account.ble_air_pct_ms / 100);
+  totals.adverts = account.adverts;
+  return totals;
+}
@@ -0,0 +1,83 @@
+#ifndef RADIO_PLAN_H_
+#define RADIO_PLAN_H_
+
+#include <cstdint>
+
+/*
+ * How the single 2.4 GHz radio is split between WiFi and BLE scanning, and what each
+ * split delivered.
+ *
+ * make() turns a declared priority into one plan for both sides: BLE scan interval,
+ * window and mode, WiFi power save timing and the coexistence preference. The BLE share
+ * of airtime is the scan window over the scan interval while a scan runs.
+ *
+ * The active priority accrues wall time, scan time, BLE airtime (scan time at its share)
+ * and advertising reports. The counters are sampled from the BLE side as running totals,
+ * so nothing has to be hooked per advert. Pure logic; the caller supplies the clock and
+ * the locking.
+ */
+class RadioPlan {
+ public:
+  enum class Priority : uint8_t { kWifi, kBalanced, kBle };
+  static constexpr int kPriorityCount = 3;
+  enum class Coex : uint8_t { kPreferWifi, kBalance, kPreferBt };
+
+  struct Plan {
+    Priority priority;
+    uint8_t ble_share_pct;  // scan window / scan interval
+    uint16_t scan_interval_ms;
+    uint16_t scan_window_ms;
+    bool passive;
+    Coex coex;
+    uint32_t ps_idle_ms;
+    uint32_t ps_sleep_ms;  // 0 = never past MIN_MODEM
+  };
+
+  // Running totals from the BLE side.
+  struct Counters {
+    uint32_t adverts;
+    uint32_t scan_ms;
+  };
+
+  struct Totals {
+    uint32_t active_ms;
+    uint32_t scan_ms;
+    uint32_t ble_air_ms;
+    uint32_t adverts;
+  };
+
+  /**
+   * The plan for a priority. share_pct 0 keeps the priority's own share; balanced_idle_ms
+   * and balanced_sleep_ms are the configured power save timing the balanced plan keeps.
+   */
+  static Plan make(Priority priority, uint8_t share_pct, uint32_t balanced_idle_ms, uint32_t balanced_sleep_ms);
+
+  RadioPlan() = default;
+  RadioPlan(const Plan& plan, uint32_t now_ms, const Counters& counters);
+
+  // Closes the books on the current plan, then accrues to the new one.
+  void select(const Plan& plan, uint32_t now_ms, const Counters& counters);
+  // Attributes time and counter deltas since the last sample to the current plan.
+  void sample(uint32_t now_ms, const Counters& counters);
+  void reset(uint32_t now_ms, const Counters& counters);
+
+  const Plan& plan() const {
+    return plan_;
+  }
+  Totals totals(Priority priority) const;
+
+ private:
+  struct Account {
+    uint32_t active_ms;
+    uint32_t scan_ms;
+    uint64_t ble_air_pct_ms;  // scan ms times share, so short samples do not round away
+    uint32_t adverts;
+  };
+
+  Plan plan_ = {};
+  uint32_t last_ms_ = 0;
+  Counters last_ = {};
+  Account accounts_[kPriorityCount] = {};
+};
+
+#endif  // RADIO_PLAN_H_
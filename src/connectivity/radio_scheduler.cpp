@@ -0,0 +1,366 @@
+#include "radio_scheduler.h"
+
+#include <atomic>
+#include <cstring>
+
+#define DEBUG_TAG "RADIO"
+#include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/Histogram.h"
+#include "../debug/include/debug/MemBudget.h"
+#include "../debug/include/debug/StaticAlloc.h"
+#include "bluetooth_manager.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ping/ping_sock.h"
+#include "radio_plan.h"
+#include "sdkconfig.h"
+#include "wifi_manager.h"
+
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+#include "esp_coexist.h"
+#endif
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+
+#ifndef CONFIG_APP_WIFI_PS_IDLE_MS
+#define CONFIG_APP_WIFI_PS_IDLE_MS 2000
+#endif
+#ifndef CONFIG_APP_WIFI_PS_SLEEP_MS
+#define CONFIG_APP_WIFI_PS_SLEEP_MS 30000
+#endif
+#ifndef CONFIG_APP_RADIO_BLE_SHARE_PCT
+#define CONFIG_APP_RADIO_BLE_SHARE_PCT 0
+#endif
+#ifndef CONFIG_APP_RADIO_BENCH_URL
+#define CONFIG_APP_RADIO_BENCH_URL ""
+#endif
+
+namespace {
+
+const char* kTag = DEBUG_TAG;
+
+static_assert(static_cast<int>(RadioPlan::Priority::kWifi) == RADIO_PRIORITY_WIFI &&
+                  static_cast<int>(RadioPlan::Priority::kBalanced) == RADIO_PRIORITY_BALANCED &&
+                  static_cast<int>(RadioPlan::Priority::kBle) == RADIO_PRIORITY_BLE,
+              "plan priorities index like radio_priority_t");
+static_assert(RadioPlan::kPriorityCount == RADIO_PRIORITY_COUNT, "one account per priority");
+
+constexpr const char* kPriorityNames[RADIO_PRIORITY_COUNT] = {"wifi", "balanced", "ble"};
+constexpr const char* kCoexNames[] = {"wifi", "balance", "bt"};
+
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+constexpr esp_coex_prefer_t kCoexPrefer[] = {ESP_COEX_PREFER_WIFI, ESP_COEX_PREFER_BALANCE, ESP_COEX_PREFER_BT};
+#endif
+
+constexpr uint32_t kPingIntervalMs = 200;
+constexpr uint32_t kRxBufferSize = 1024;
+
+#if CONFIG_APP_RADIO_PRIORITY_WIFI
+constexpr RadioPlan::Priority kBootPriority = RadioPlan::Priority::kWifi;
+#elif CONFIG_APP_RADIO_PRIORITY_BLE
+constexpr RadioPlan::Priority kBootPriority = RadioPlan::Priority::kBle;
+#else
+constexpr RadioPlan::Priority kBootPriority = RadioPlan::Priority::kBalanced;
+#endif
+
+// The plan and its accounts; every access holds s_mutex. Bench results are written by
+// the bench and its ping session only, one bench at a time.
+RadioPlan s_plan;
+debug::StaticMutex s_mutex_storage;
+SemaphoreHandle_t s_mutex = nullptr;
+
+struct BenchAccount {
+  std::atomic<uint32_t> pings{0};
+  std::atomic<uint32_t> lost{0};
+  uint32_t rx_bytes = 0;
+  uint32_t rx_ms = 0;
+};
+debug::Histogram<> s_rtt_ms[RADIO_PRIORITY_COUNT];
+BenchAccount s_bench[RADIO_PRIORITY_COUNT];
+std::atomic<bool> s_bench_running{false};
+TaskHandle_t s_bench_task = nullptr;  // woken when the ping session ends
+uint8_t s_rx_buffer[kRxBufferSize];
+
+uint32_t now_ms() {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+RadioPlan::Counters ble_counters() {
+  bluetooth_scan_stats_t stats;
+  bluetooth_manager_get_scan_stats(&stats);
+  return {stats.adverts, stats.scan_ms};
+}
+
+RadioPlan::Plan make_plan(RadioPlan::Priority priority, uint8_t share_pct) {
+  return RadioPlan::make(priority, share_pct ? share_pct : CONFIG_APP_RADIO_BLE_SHARE_PCT, CONFIG_APP_WIFI_PS_IDLE_MS,
+                         CONFIG_APP_WIFI_PS_SLEEP_MS);
+}
+
+// Caller holds s_mutex.
+esp_err_t apply(const RadioPlan::Plan& plan) {
+  bluetooth_scan_params_t scan = {};
+  scan.interval_ms = plan.scan_interval_ms;
+  scan.window_ms = plan.scan_window_ms;
+  scan.passive = plan.passive;
+  esp_err_t err = bluetooth_manager_set_scan_params(&scan);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = wifi_manager_set_ps_profile(plan.ps_idle_ms, plan.ps_sleep_ms);
+  if (err != ESP_OK) {
+    return err;
+  }
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+  err = esp_coex_preference_set(kCoexPrefer[static_cast<int>(plan.coex)]);
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "Coexistence preference not set: %s", esp_err_to_name(err));
+  }
+#endif
+  ESP_LOGI(kTag, "Priority %s: BLE %s scan %u/%u ms (%u%%), WiFi PS idle %lu ms, sleep %lu ms, coex %s",
+           kPriorityNames[static_cast<int>(plan.priority)], plan.passive ? "passive" : "active", plan.scan_window_ms,
+           plan.scan_interval_ms, plan.ble_share_pct, static_cast<unsigned long>(plan.ps_idle_ms),
+           static_cast<unsigned long>(plan.ps_sleep_ms), kCoexNames[static_cast<int>(plan.coex)]);
+  return ESP_OK;
+}
+
+void on_ping_success(esp_ping_handle_t handle, void* args) {
+  const intptr_t index = reinterpret_cast<intptr_t>(args);
+  uint32_t elapsed_ms = 0;
+  esp_ping_get_profile(handle, ESP_PING_PROF_TIMEGAP, &elapsed_ms, sizeof(elapsed_ms));
+  s_rtt_ms[index].record(elapsed_ms);
+  s_bench[index].pings.fetch_add(1, std::memory_order_relaxed);
+}
+
+void on_ping_timeout(esp_ping_handle_t handle, void* args) {
+  const intptr_t index = reinterpret_cast<intptr_t>(args);
+  s_bench[index].pings.fetch_add(1, std::memory_order_relaxed);
+  s_bench[index].lost.fetch_add(1, std::memory_order_relaxed);
+}
+
+void on_ping_end(esp_ping_handle_t handle, void* args) {
+  xTaskNotifyGive(s_bench_task);
+}
+
+esp_err_t ping_gateway(int index, uint32_t seconds) {
+  esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  esp_netif_ip_info_t info;
+  if (!netif || esp_netif_get_ip_info(netif, &info) != ESP_OK || info.gw.addr == 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+  ip_addr_set_ip4_u32(&config.target_addr, info.gw.addr);
+  config.count = seconds * 1000 / kPingIntervalMs;
+  config.interval_ms = kPingIntervalMs;
+
+  esp_ping_callbacks_t cbs = {};
+  cbs.on_ping_success = on_ping_success;
+  cbs.on_ping_timeout = on_ping_timeout;
+  cbs.on_ping_end = on_ping_end;
+  cbs.cb_args = reinterpret_cast<void*>(static_cast<intptr_t>(index));
+
+  esp_ping_handle_t ping = nullptr;
+  s_bench_task = xTaskGetCurrentTaskHandle();
+  esp_err_t err = esp_ping_new_session(&config, &cbs, &ping);
+  if (err != ESP_OK) {
+    return err;
+  }
+  esp_ping_start(ping);
+  // Every request ends in a reply or a timeout; the margin covers the last timeout.
+  if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(seconds * 1000 + config.timeout_ms + 1000))) {
+    esp_ping_stop(ping);
+    ESP_LOGW(kTag, "Ping session did not end in time");
+  }
+  esp_ping_delete_session(ping);
+  return ESP_OK;
+}
+
+esp_err_t download(int index, uint32_t seconds) {
+  esp_http_client_config_t config = {};
+  config.url = CONFIG_APP_RADIO_BENCH_URL;
+  config.timeout_ms = 5000;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+  config.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+  esp_http_client_handle_t client = esp_http_client_init(&config);
+  if (!client) {
+    return ESP_ERR_NO_MEM;
+  }
+  esp_err_t err = esp_http_client_open(client, 0);
+  if (err == ESP_OK) {
+    esp_http_client_fetch_headers(client);
+    const int64_t start_us = esp_timer_get_time();
+    const int64_t deadline_us = start_us + static_cast<int64_t>(seconds) * 1000000;
+    uint32_t bytes = 0;
+    while (esp_timer_get_time() < deadline_us) {
+      const int n = esp_http_client_read(client, reinterpret_cast<char*>(s_rx_buffer), sizeof(s_rx_buffer));
+      if (n <= 0) {
+        break;
+      }
+      bytes += n;
+    }
+    s_bench[index].rx_bytes += bytes;
+    s_bench[index].rx_ms += static_cast<uint32_t>((esp_timer_get_time() - start_us) / 1000);
+  }
+  esp_http_client_cleanup(client);
+  return err;
+}
+
+}  // namespace
+
+esp_err_t radio_scheduler_init(void) {
+  DEBUG_FUNC_ENTER();
+  s_mutex = s_mutex_storage.create(MEM_BUDGET_NET);
+  if (!s_mutex) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+    return ESP_ERR_NO_MEM;
+  }
+  mem_budget_charge(MEM_BUDGET_NET, MEM_BUDGET_BUFFER, sizeof(s_rtt_ms) + sizeof(s_bench) + sizeof(s_rx_buffer),
+                    false);
+  const RadioPlan::Plan plan = make_plan(kBootPriority, 0);
+  s_plan = RadioPlan(plan, now_ms(), ble_counters());
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  const esp_err_t err = apply(plan);
+  xSemaphoreGive(s_mutex);
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+esp_err_t radio_scheduler_set_priority(radio_priority_t priority, uint8_t ble_share_pct) {
+  if (priority >= RADIO_PRIORITY_COUNT || ble_share_pct > 100) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_mutex) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  const RadioPlan::Plan plan = make_plan(static_cast<RadioPlan::Priority>(priority), ble_share_pct);
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  s_plan.select(plan, now_ms(), ble_counters());
+  const esp_err_t err = apply(plan);
+  xSemaphoreGive(s_mutex);
+  return err;
+}
+
+void radio_scheduler_get_plan(radio_scheduler_plan_t* out_plan) {
+  if (!out_plan) {
+    return;
+  }
+  *out_plan = {};
+  if (!s_mutex) {
+    return;
+  }
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  const RadioPlan::Plan plan = s_plan.plan();
+  xSemaphoreGive(s_mutex);
+  out_plan->priority = static_cast<radio_priority_t>(plan.priority);
+  out_plan->ble_share_pct = plan.ble_share_pct;
+  out_plan->scan_interval_ms = plan.scan_interval_ms;
+  out_plan->scan_window_ms = plan.scan_window_ms;
+  out_plan->passive = plan.passive;
+  out_plan->coex = kCoexNames[static_cast<int>(plan.coex)];
+  out_plan->ps_idle_ms = plan.ps_idle_ms;
+  out_plan->ps_sleep_ms = plan.ps_sleep_ms;
+  out_plan->ps_floor = wifi_manager_ps_floor();
+}
+
+void radio_scheduler_get_stats(radio_priority_t priority, radio_scheduler_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  *out_stats = {};
+  if (priority >= RADIO_PRIORITY_COUNT || !s_mutex) {
+    return;
+  }
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  s_plan.sample(now_ms(), ble_counters());
+  const RadioPlan::Totals totals = s_plan.totals(static_cast<RadioPlan::Priority>(priority));
+  xSemaphoreGive(s_mutex);
+  out_stats->active_ms = totals.active_ms;
+  out_stats->scan_ms = totals.scan_ms;
+  out_stats->ble_air_ms = totals.ble_air_ms;
+  out_stats->adverts = totals.adverts;
+
+  const BenchAccount& bench = s_bench[priority];
+  const auto rtt = s_rtt_ms[priority].summarize();
+  out_stats->pings = bench.pings.load(std::memory_order_relaxed);
+  out_stats->ping_lost = bench.lost.load(std::memory_order_relaxed);
+  out_stats->rtt_p50_ms = rtt.p50;
+  out_stats->rtt_p90_ms = rtt.p90;
+  out_stats->rtt_max_ms = rtt.max;
+  out_stats->rx_bytes = bench.rx_bytes;
+  out_stats->rx_ms = bench.rx_ms;
+}
+
+void radio_scheduler_reset_stats(void) {
+  if (!s_mutex || s_bench_running.load()) {
+    return;
+  }
+  for (int i = 0; i < RADIO_PRIORITY_COUNT; ++i) {
+    s_rtt_ms[i].reset();
+    s_bench[i].pings = 0;
+    s_bench[i].lost = 0;
+    s_bench[i].rx_bytes = 0;
+    s_bench[i].rx_ms = 0;
+  }
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  s_plan.reset(now_ms(), ble_counters());
+  xSemaphoreGive(s_mutex);
+}
+
+esp_err_t radio_scheduler_bench(radio_priority_t priority, uint8_t ble_share_pct, uint32_t seconds) {
+  if (priority >= RADIO_PRIORITY_COUNT || seconds == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_mutex || !wifi_manager_is_connected()) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  bool idle = false;
+  if (!s_bench_running.compare_exchange_strong(idle, true)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  const RadioPlan::Plan previous = s_plan.plan();
+  xSemaphoreGive(s_mutex);
+  esp_err_t err = radio_scheduler_set_priority(priority, ble_share_pct);
+
+  const bool with_download = CONFIG_APP_RADIO_BENCH_URL[0] != '\0';
+  const uint32_t scan_seconds = with_download ? 2 * seconds : seconds;
+  if (err == ESP_OK) {
+    err = bluetooth_manager_start_scan(static_cast<int>(scan_seconds));
+  }
+  const uint32_t scan_end_ms = now_ms() + scan_seconds * 1000;
+  if (err == ESP_OK) {
+    ESP_LOGI(kTag, "Bench %s: ping gateway for %lu s%s", kPriorityNames[priority], static_cast<unsigned long>(seconds),
+             with_download ? ", then download" : "");
+    err = ping_gateway(priority, seconds);
+    if (err == ESP_OK && with_download) {
+      const esp_err_t dl = download(priority, seconds);
+      if (dl != ESP_OK) {
+        ESP_LOGW(kTag, "Bench download failed: %s", esp_err_to_name(dl));
+      }
+    }
+    // Let the scan finish under the benched plan so its adverts are counted there.
+    const uint32_t deadline = scan_end_ms + 2000;
+    bluetooth_scan_stats_t scan;
+    bluetooth_manager_get_scan_stats(&scan);
+    while (scan.scanning && static_cast<int32_t>(deadline - now_ms()) > 0) {
+      vTaskDelay(pdMS_TO_TICKS(100));
+      bluetooth_manager_get_scan_stats(&scan);
+    }
+  }
+
+  radio_scheduler_set_priority(static_cast<radio_priority_t>(previous.priority), previous.ble_share_pct);
+  s_bench_running = false;
+  return err;
+}
+
+const char* radio_scheduler_priority_name(radio_priority_t priority) {
+  return priority < RADIO_PRIORITY_COUNT ? kPriorityNames[priority] : "?";
+}
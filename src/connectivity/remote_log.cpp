@@ -0,0 +1,66 @@
+#include "remote_log.h"
+
+#include <cstring>
+
+bool RemoteLogReader::next(Record* out) {
+  if (malformed_ || pos_ == len_) {
+    return false;
+  }
+  remote_log_wire::RecordHeader header;
+  if (len_ - pos_ < sizeof(header)) {
+    malformed_ = true;
+    return false;
+  }
+  memcpy(&header, data_ + pos_, sizeof(header));
+  const size_t body = static_cast<size_t>(header.tag_len) + header.msg_len;
+  if (len_ - pos_ - sizeof(header) < body) {
+    malformed_ = true;
+    return false;
+  }
+  const char* text = reinterpret_cast<const char*>(data_ + pos_ + sizeof(header));
+  out->timestamp_ms = header.timestamp_ms;
+  out->level = header.level;
+  out->dropped = header.dropped;
+  out->tag = text;
+  out->tag_len = header.tag_len;
+  out->msg = text + header.tag_len;
+  out->msg_len = header.msg_len;
+  pos_ += sizeof(header) + body;
+  return true;
+}
+
+RateLimiter::RateLimiter(uint16_t rate_per_s) : rate_(rate_per_s) {}
+
+void RateLimiter::set_rate(uint16_t rate_per_s, uint32_t now_ms) {
+  rate_ = rate_per_s;
+  tokens_milli_ = static_cast<uint32_t>(rate_per_s) * 1000;
+  last_ms_ = now_ms;
+  started_ = true;
+}
+
+void RateLimiter::refill(uint32_t now_ms) {
+  if (!started_) {
+    tokens_milli_ = static_cast<uint32_t>(rate_) * 1000;
+    last_ms_ = now_ms;
+    started_ = true;
+    return;
+  }
+  const uint32_t elapsed = now_ms - last_ms_;
+  last_ms_ = now_ms;
+  const uint32_t cap = static_cast<uint32_t>(rate_) * 1000;
+  // rate tokens per 1000 ms is `rate` thousandths per ms; clamp before multiplying.
+  const uint64_t added = static_cast<uint64_t>(elapsed < 1000 ? elapsed : 1000) * rate_;
+  tokens_milli_ = tokens_milli_ + added > cap ? cap : static_cast<uint32_t>(tokens_milli_ + added);
+}
+
+bool RateLimiter::allow(uint32_t now_ms) {
+  if (rate_ == 0) {
+    return true;
+  }
+  refill(now_ms);
+  if (tokens_milli_ < 1000) {
+    return false;
+  }
+  tokens_milli_ -= 1000;
+  return true;
+}
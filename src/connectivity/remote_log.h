@@ -0,0 +1,115 @@
+#ifndef REMOTE_LOG_H_
+#define REMOTE_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Frame types for the H2 diagnostics stream (until the shared protocol header carries them).
+#ifndef UART_LINK_MSG_H2_LOG
+#define UART_LINK_MSG_H2_LOG 0x50          // H2 -> C6: one or more log records
+#define UART_LINK_MSG_H2_METRICS 0x51      // H2 -> C6: counter snapshot
+#define UART_LINK_MSG_H2_LOG_CONFIG 0x52  // C6 -> H2: level, rate and metrics period
+#endif
+
+namespace remote_log_wire {
+
+// Record header; followed by tag_len tag bytes and msg_len message bytes, no terminators.
+// A LOG frame carries as many whole records as fit.
+struct __attribute__((packed)) RecordHeader {
+  uint32_t timestamp_ms;  // H2 uptime
+  uint8_t level;          // esp_log_level_t
+  uint8_t tag_len;
+  uint8_t msg_len;
+  uint8_t dropped;  // records the H2 discarded since the previous one (saturates at 255)
+};
+
+// METRICS frame: MetricsHeader, then Metric entries. Unknown ids are skipped.
+struct __attribute__((packed)) MetricsHeader {
+  uint32_t uptime_ms;
+};
+
+struct __attribute__((packed)) Metric {
+  uint8_t id;
+  uint32_t value;
+};
+
+enum MetricId : uint8_t {
+  kZbQueueDepth = 1,  // Zigbee stack task queue
+  kZbQueueHighWater = 2,
+  kMacRetries = 3,  // cumulative
+  kMacTxFailures = 4,
+  kChildCount = 5,
+  kNeighborCount = 6,
+  kFreeHeap = 7,
+  kMinFreeHeap = 8,
+  kLogDropped = 9,  // cumulative records the H2 discarded (rate limit or full buffer)
+  kMetricIdCount,
+};
+
+// The H2 drops records below min_level, sends at most max_records_per_s (bursts up to one
+// second's worth) and a METRICS frame every metrics_period_ms (0 = never).
+struct __attribute__((packed)) Config {
+  uint8_t min_level;
+  uint8_t reserved;
+  uint16_t max_records_per_s;
+  uint16_t metrics_period_ms;
+};
+
+}  // namespace remote_log_wire
+
+/*
+ * Walks the records in one H2_LOG frame payload. Stops at the first record that does
+ * not fit, which malformed() then reports.
+ */
+class RemoteLogReader {
+ public:
+  struct Record {
+    uint32_t timestamp_ms;
+    uint8_t level;
+    uint8_t dropped;
+    const char* tag;  // not NUL-terminated
+    uint8_t tag_len;
+    const char* msg;  // not NUL-terminated
+    uint8_t msg_len;
+  };
+
+  RemoteLogReader(const uint8_t* payload, size_t len) : data_(payload), len_(len) {}
+
+  bool next(Record* out);
+  bool malformed() const {
+    return malformed_;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t len_;
+  size_t pos_ = 0;
+  bool malformed_ = false;
+};
+
+/*
+ * Token bucket: `rate` events per second with a burst of one second's worth. Pure logic;
+ * the caller supplies the clock.
+ */
+class RateLimiter {
+ public:
+  RateLimiter() = default;
+  explicit RateLimiter(uint16_t rate_per_s);
+
+  void set_rate(uint16_t rate_per_s, uint32_t now_ms);
+  // Takes a token if one is available. rate 0 means unlimited.
+  bool allow(uint32_t now_ms);
+  uint16_t rate() const {
+    return rate_;
+  }
+
+ private:
+  void refill(uint32_t now_ms);
+
+  uint16_t rate_ = 0;
+  uint32_t tokens_milli_ = 0;  // thousandths of a token, so low rates refill smoothly
+  uint32_t last_ms_ = 0;
+  bool started_ = false;
+};
+
+#endif  // REMOTE_LOG_H_
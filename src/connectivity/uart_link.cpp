@@ -4,56 +4,133 @@
 
 #define DEBUG_TAG "ZB_LINK"
 #include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/StaticAlloc.h"
 #include "driver/uart.h"
-#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_intr_alloc.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "esp_rom_sys.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "led_driver.h"
+#include "nvs.h"
+#include "clock_sync.h"
+#include "link_channels.h"
+#include "link_codec.h"
+#include "link_framer.h"
+#include "link_state_machine.h"
+#include "link_stats.h"
+#include "link_supervisor.h"
 #include "sdkconfig.h"
 #include "uart_link_protocol.h"
+#include "zb_command_schema.h"
+
+#ifndef UART_LINK_HANDSHAKE_FLAG_COMPRESSION
+#define UART_LINK_HANDSHAKE_FLAG_COMPRESSION 0x02  // peer accepts link_codec payloads
+#endif
+#ifndef UART_LINK_HANDSHAKE_FLAG_CHANNELS
+#define UART_LINK_HANDSHAKE_FLAG_CHANNELS 0x04  // peer speaks CHANNEL_DATA/CHANNEL_CREDIT
+#endif
 
 #if CONFIG_APP_ENABLE_UART_LINK
 
 namespace {
 constexpr size_t kRxBufferSize = 512;
 constexpr size_t kTxBufferSize = 512;
-constexpr int kHeartbeatIntervalMs = 2000;
-constexpr uint32_t kHandshakePollDelayMs = 50;
-constexpr int64_t kHandshakeRetryIntervalUs = 750 * 1000;  // retry roughly every 750 ms if needed
+constexpr uint32_t kRxStackSize = 4096;
+constexpr uint32_t kTaskStackSize = 3072;  // link and TX tasks
+constexpr EventBits_t kLinkUpBit = 1 << 0;
+constexpr EventBits_t kLinkMismatchBit = 1 << 1;
+constexpr EventBits_t kTxSpaceBit = 1 << 2;  // the TX task freed channel queue space
 constexpr char kLocalHelloMsg[] = "C6 online";
+constexpr size_t kUartEventQueueLength = 16;
 
 #ifndef CONFIG_APP_UART_LINK_HANDSHAKE_TIMEOUT_MS
 #define CONFIG_APP_UART_LINK_HANDSHAKE_TIMEOUT_MS 3000
 #endif
+#ifndef CONFIG_APP_UART_LINK_KEEPALIVE_MS
+#define CONFIG_APP_UART_LINK_KEEPALIVE_MS 2000
+#endif
+#ifndef CONFIG_APP_UART_LINK_PROBE_INTERVAL_MS
+#define CONFIG_APP_UART_LINK_PROBE_INTERVAL_MS 500
+#endif
+#ifndef CONFIG_APP_UART_LINK_DEAD_AFTER_PROBES
+#define CONFIG_APP_UART_LINK_DEAD_AFTER_PROBES 4
+#endif
+#ifndef CONFIG_APP_UART_LINK_DEGRADED_PERMILLE
+#define CONFIG_APP_UART_LINK_DEGRADED_PERMILLE 50
+#endif
+#ifndef CONFIG_APP_UART_LINK_BACKOFF_MIN_MS
+#define CONFIG_APP_UART_LINK_BACKOFF_MIN_MS 250
+#endif
+#ifndef CONFIG_APP_UART_LINK_BACKOFF_MAX_MS
+#define CONFIG_APP_UART_LINK_BACKOFF_MAX_MS 8000
+#endif
+#ifndef CONFIG_APP_UART_LINK_MAX_MESSAGE
+#define CONFIG_APP_UART_LINK_MAX_MESSAGE 1024
+#endif
+#ifndef CONFIG_APP_UART_LINK_CLOCK_SYNC_MS
+#define CONFIG_APP_UART_LINK_CLOCK_SYNC_MS 2000
+#endif
+#ifndef CONFIG_APP_UART_LINK_UART_RTS_PIN
+#define CONFIG_APP_UART_LINK_UART_RTS_PIN UART_PIN_NO_CHANGE
+#endif
+#ifndef CONFIG_APP_UART_LINK_UART_CTS_PIN
+#define CONFIG_APP_UART_LINK_UART_CTS_PIN UART_PIN_NO_CHANGE
+#endif
+#ifndef CONFIG_APP_UART_LINK2_UART_RTS_PIN
+#define CONFIG_APP_UART_LINK2_UART_RTS_PIN UART_PIN_NO_CHANGE
+#endif
+#ifndef CONFIG_APP_UART_LINK2_UART_CTS_PIN
+#define CONFIG_APP_UART_LINK2_UART_CTS_PIN UART_PIN_NO_CHANGE
+#endif
+#ifndef CONFIG_APP_UART_LINK_FLASH_STALL_MS
+#define CONFIG_APP_UART_LINK_FLASH_STALL_MS 0
+#endif
+
+// With the IRAM profile the UART ISR keeps emptying the FIFO while a flash write holds off
+// the RX task, so the driver's RX buffer has to take everything that arrives meanwhile.
+constexpr size_t kStallBytes = CONFIG_APP_UART_LINK_UART_BAUDRATE / 10 * CONFIG_APP_UART_LINK_FLASH_STALL_MS / 1000;
+constexpr size_t kDriverRxBufferSize = kStallBytes > kRxBufferSize ? kStallBytes : kRxBufferSize;
+#if CONFIG_APP_UART_LINK_IRAM_PROFILE
+constexpr int kUartIntrFlags = ESP_INTR_FLAG_IRAM;
+constexpr bool kIramProfile = true;
+#else
+constexpr int kUartIntrFlags = 0;
+constexpr bool kIramProfile = false;
+#endif
 
 const char* kTag = DEBUG_TAG;
-uart_port_t link_uart() {
-  return static_cast<uart_port_t>(CONFIG_APP_UART_LINK_UART_PORT);
-}
 
-struct ParserState {
-  uint8_t buffer[UART_LINK_MAX_PAYLOAD + 8];
-  size_t length = 0;
-  size_t expected = 0;
+// Wiring and task names of one co-processor link.
+struct PortConfig {
+  int port;
+  int tx_pin;
+  int rx_pin;
+  int rts_pin;
+  int cts_pin;
+  const char* tag;
+  const char* rx_task;
+  const char* link_task;
+  const char* tx_task;
 };
 
-TaskHandle_t s_rx_task = nullptr;
-TaskHandle_t s_hb_task = nullptr;
-bool s_initialized = false;
-bool s_suspended = false;
-ParserState s_parser;
-uart_link_stats_t s_stats = {};
-#ifdef CONFIG_APP_UART_LINK_DEBUG_LOGS
-bool s_debug_frames = true;
-#else
-bool s_debug_frames = false;
+constexpr PortConfig kPorts[] = {
+    {CONFIG_APP_UART_LINK_UART_PORT, CONFIG_APP_UART_LINK_UART_TX_PIN, CONFIG_APP_UART_LINK_UART_RX_PIN,
+     CONFIG_APP_UART_LINK_UART_RTS_PIN, CONFIG_APP_UART_LINK_UART_CTS_PIN, DEBUG_TAG, "uart_link_rx", "uart_link",
+     "uart_link_tx"},
+#ifdef CONFIG_APP_UART_LINK2_ENABLE
+    {CONFIG_APP_UART_LINK2_UART_PORT, CONFIG_APP_UART_LINK2_UART_TX_PIN, CONFIG_APP_UART_LINK2_UART_RX_PIN,
+     CONFIG_APP_UART_LINK2_UART_RTS_PIN, CONFIG_APP_UART_LINK2_UART_CTS_PIN, "ZB_LINK2", "uart_link2_rx", "uart_link2",
+     "uart_link2_tx"},
 #endif
-static uint8_t s_local_secret = 0;
-
-esp_err_t send_frame(uart_link_msg_type_t type, const uint8_t* payload, uint16_t len);
+};
+constexpr uint8_t kLinkCount = sizeof(kPorts) / sizeof(kPorts[0]);
+static_assert(kLinkCount <= UART_LINK_MAX_LINKS, "more ports than UART_LINK_MAX_LINKS");
 
 struct HandshakeState {
   bool sent = false;
@@ -63,7 +140,119 @@ struct HandshakeState {
   int64_t last_sent_us = 0;
 };
 
-HandshakeState s_handshake;
+// Queue sizes per channel; bulk holds two full messages so the producer refills while one drains.
+constexpr uint16_t kMaxMessage = CONFIG_APP_UART_LINK_MAX_MESSAGE;
+constexpr uint16_t kChannelQueueBytes[UART_LINK_CHANNEL_COUNT] = {512, 512, 2 * (kMaxMessage + 8)};
+
+/*
+ * Everything one co-processor link owns. Its RX, TX and link tasks touch only their own
+ * Link, so two links share no lock on the data path and each runs at its UART's rate.
+ */
+struct Link {
+  uint8_t index = 0;
+  const PortConfig* config = nullptr;
+  TaskHandle_t rx_task = nullptr;
+  TaskHandle_t link_task = nullptr;
+  TaskHandle_t tx_task = nullptr;
+  LinkFramer framer;  // RX task only
+  uart_link_stats_t status = {};  // flags and handshake fields; counters live in stats
+  LinkStats stats;
+  // Supervisor, state machine and status are written by the link task and the RX task and
+  // read by get_stats(); every access takes the lock. Sends and callbacks happen outside it.
+  portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+  LinkSupervisor supervisor;
+  LinkStateMachine fsm;
+  EventGroupHandle_t events = nullptr;
+  QueueHandle_t uart_events = nullptr;  // driver events; drained by the RX task
+  volatile bool restart = false;
+  HandshakeState handshake;
+  // TX compresses only once the peer advertised support in an accepted handshake.
+  volatile bool compress_tx = false;
+  // Clock sync runs once the peer advertised it in an accepted handshake.
+  volatile bool clock_sync = false;
+  portMUX_TYPE clock_lock = portMUX_INITIALIZER_UNLOCKED;  // guards clock
+  ClockSync clock;
+  int64_t last_sync_us = 0;         // link task only
+  int64_t rx_frame_us = 0;          // RX task only: when the frame being handled arrived
+  uart_link_stamp_t rx_stamp = {};  // RX task only: valid while a STAMPED frame is dispatched
+  bool rx_stamped = false;
+  SemaphoreHandle_t codec_lock = nullptr;  // guards codec_workspace
+  link_codec::Workspace codec_workspace;
+  uint8_t rx_plain[link_codec::kMaxDecoded];  // RX task only
+  SemaphoreHandle_t channel_lock = nullptr;   // guards channels, credits_due and credit_seq
+  ChannelScheduler channels{UART_LINK_MAX_PAYLOAD};
+  // Credit grants the RX task owes the peer, one bit per channel; the TX task sends them.
+  uint8_t credits_due = 0;
+  uint16_t credit_seq[UART_LINK_CHANNEL_COUNT] = {};
+  uint8_t command_queue[kChannelQueueBytes[UART_LINK_CHANNEL_COMMAND]];
+  uint8_t event_queue[kChannelQueueBytes[UART_LINK_CHANNEL_EVENT]];
+  uint8_t bulk_queue[kChannelQueueBytes[UART_LINK_CHANNEL_BULK]];
+  uint8_t tx_payload[UART_LINK_MAX_PAYLOAD];  // TX task only
+  // RX task only.
+  ChannelReassembler reassemblers[UART_LINK_CHANNEL_COUNT];
+  uint8_t rx_messages[UART_LINK_CHANNEL_COUNT][kMaxMessage];
+  uint8_t rx_buffer[kRxBufferSize];
+  // Stacks and control blocks of the handles above under APP_STATIC_ALLOCATION, empty otherwise.
+  struct Storage {
+    debug::StaticTask<kRxStackSize> rx_task;
+    debug::StaticTask<kTaskStackSize> link_task;
+    debug::StaticTask<kTaskStackSize> tx_task;
+    debug::StaticEventGroup events;
+    debug::StaticMutex codec_lock;
+    debug::StaticMutex channel_lock;
+  } storage;
+
+  uart_port_t port() const {
+    return static_cast<uart_port_t>(config->port);
+  }
+  const char* tag() const {
+    return config->tag;
+  }
+};
+
+Link s_links[kLinkCount];
+bool s_initialized = false;
+volatile bool s_suspended = false;
+esp_timer_handle_t s_stats_timer = nullptr;
+struct EventListener {
+  uart_link_event_cb_t cb;
+  void* ctx;
+};
+constexpr size_t kMaxEventListeners = 4;
+// Registered at init time by other modules, then only read by the link and RX tasks.
+EventListener s_event_listeners[kMaxEventListeners] = {};
+#ifdef CONFIG_APP_UART_LINK_DEBUG_LOGS
+bool s_debug_frames = true;
+#else
+bool s_debug_frames = false;
+#endif
+static uint8_t s_local_secret = 0;
+
+struct FrameHandler {
+  uint8_t type;
+  uart_link_frame_handler_t fn;
+  void* ctx;
+};
+constexpr size_t kMaxFrameHandlers = 6;
+// Filled at init time by other modules, then only read by the RX tasks.
+FrameHandler s_frame_handlers[kMaxFrameHandlers] = {};
+
+Link* link_at(uint8_t index) {
+  return index < kLinkCount ? &s_links[index] : nullptr;
+}
+
+// The link whose task is running, so shared handlers and listeners can tell links apart.
+Link* current_link() {
+  const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (Link& link : s_links) {
+    if (self == link.rx_task || self == link.link_task || self == link.tx_task) {
+      return &link;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t send_frame(Link& link, uart_link_msg_type_t type, const uint8_t* payload, uint16_t len);
 
 const char* frame_type_name(uint8_t type) {
   switch (type) {
@@ -81,6 +270,16 @@ const char* frame_type_name(uint8_t type) {
       return "ATTR_UPDATE";
     case UART_LINK_MSG_COMMAND:
       return "COMMAND";
+    case UART_LINK_MSG_ZB_REQUEST:
+      return "ZB_REQUEST";
+    case UART_LINK_MSG_ZB_RESPONSE:
+      return "ZB_RESPONSE";
+    case UART_LINK_MSG_STAMPED:
+      return "STAMPED";
+    case UART_LINK_MSG_CHANNEL_DATA:
+      return "CHANNEL_DATA";
+    case UART_LINK_MSG_CHANNEL_CREDIT:
+      return "CHANNEL_CREDIT";
     default:
       return "UNKNOWN";
   }
@@ -97,10 +296,10 @@ const char* role_to_string(uint8_t role) {
   }
 }
 
-void log_handshake_details(const char* label, const uart_link_handshake_t& hs) {
+void log_handshake_details(const Link& link, const char* label, const uart_link_handshake_t& hs) {
   const bool flow = (hs.flags & UART_LINK_HANDSHAKE_FLAG_FLOW_CTRL) != 0;
-  ESP_LOGI(kTag, "%s: version=%u role=%s (0x%02X) baud=%u flags=0x%02X secret=0x%02X flow_ctrl=%s", label, hs.version,
-           role_to_string(hs.role), hs.role, hs.baud_rate, hs.flags, hs.secret, flow ? "on" : "off");
+  ESP_LOGI(link.tag(), "%s: version=%u role=%s (0x%02X) baud=%u flags=0x%02X secret=0x%02X flow_ctrl=%s", label,
+           hs.version, role_to_string(hs.role), hs.role, hs.baud_rate, hs.flags, hs.secret, flow ? "on" : "off");
 }
 
 uint8_t local_handshake_flags() {
@@ -108,6 +307,12 @@ uint8_t local_handshake_flags() {
 #ifdef CONFIG_APP_UART_LINK_USE_HW_FLOWCTRL
   flags |= UART_LINK_HANDSHAKE_FLAG_FLOW_CTRL;
 #endif
+#ifdef CONFIG_APP_UART_LINK_COMPRESSION
+  flags |= UART_LINK_HANDSHAKE_FLAG_COMPRESSION;
+#endif
+  flags |= UART_LINK_HANDSHAKE_FLAG_CHANNELS;
+  flags |= UART_LINK_HANDSHAKE_FLAG_TYPED_COMMANDS;
+  flags |= UART_LINK_HANDSHAKE_FLAG_CLOCK_SYNC;
   return flags;
 }
 
@@ -127,41 +332,134 @@ bool is_local_handshake(const uart_link_handshake_t& candidate) {
   return memcmp(&candidate, &local, sizeof(local)) == 0;
 }
 
-void log_frame_debug(const char* dir, uint8_t type, uint16_t len) {
+void log_frame_debug(const Link& link, const char* dir, uint8_t type, uint16_t len) {
   if (!s_debug_frames) {
     return;
   }
-  ESP_LOGI(kTag, "[%s] type=%s (0x%02X) len=%u", dir, frame_type_name(type), type, len);
+  ESP_LOGI(link.tag(), "[%s] type=%s (0x%02X) len=%u", dir, frame_type_name(type), type, len);
+}
+
+uint32_t to_ms(int64_t us) {
+  return static_cast<uint32_t>(us / 1000);
+}
+
+// Feed an RX-side event to the state machine and wake the link task to act on it.
+template <typename Fn>
+void link_fsm_event(Link& link, Fn&& apply) {
+  const uint32_t now_ms = to_ms(esp_timer_get_time());
+  portENTER_CRITICAL(&link.lock);
+  apply(link.fsm, now_ms);
+  portEXIT_CRITICAL(&link.lock);
+  if (link.link_task) {
+    xTaskNotifyGive(link.link_task);
+  }
+}
+
+void wake_tx(Link& link) {
+  if (link.tx_task) {
+    xTaskNotifyGive(link.tx_task);
+  }
 }
 
-void process_handshake(const uart_link_handshake_t& remote) {
-  log_handshake_details("Remote handshake", remote);
+// Both sides restart channel sequences on every accepted handshake.
+void set_channel_framing(Link& link, bool enabled) {
+  for (ChannelReassembler& reassembler : link.reassemblers) {
+    reassembler.reset();
+  }
+  xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+  link.channels.set_framing(enabled);
+  link.credits_due = 0;
+  xSemaphoreGive(link.channel_lock);
+  wake_tx(link);
+}
+
+// The RX task must not wait on the UART TX: it hands the grant to the TX task, which sends it
+// ahead of any probe or fragment. A grant not yet sent is replaced by the newer sequence.
+void queue_credit(Link& link, uint8_t channel) {
+  ChannelReassembler& reassembler = link.reassemblers[channel];
+  reassembler.credit_reported();
+  xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+  link.credit_seq[channel] = reassembler.expected_seq();
+  link.credits_due |= 1u << channel;
+  xSemaphoreGive(link.channel_lock);
+  wake_tx(link);
+}
+
+void dispatch_frame(Link& link, uint8_t type, const uint8_t* payload, uint16_t len);
+
+void handle_channel_data(Link& link, const uint8_t* payload, uint16_t len) {
+  const uint8_t channel = len ? payload[0] & channel_wire::kChannelMask : UART_LINK_CHANNEL_COUNT;
+  if (channel >= UART_LINK_CHANNEL_COUNT) {
+    ESP_LOGW(link.tag(), "Channel data for unknown channel (%u bytes)", len);
+    return;
+  }
+  ChannelReassembler& reassembler = link.reassemblers[channel];
+  ChannelReassembler::Message message;
+  if (reassembler.feed(payload, len, &message)) {
+    if (message.type == UART_LINK_MSG_CHANNEL_DATA || message.type == UART_LINK_MSG_CHANNEL_CREDIT) {
+      ESP_LOGW(link.tag(), "Nested channel frame on channel %u dropped", channel);
+    } else {
+      dispatch_frame(link, message.type, reassembler.buffer(), message.length);
+    }
+  }
+  if (reassembler.credit_due()) {
+    queue_credit(link, channel);
+  }
+}
+
+void handle_channel_credit(Link& link, const uint8_t* payload, uint16_t len) {
+  channel_wire::Credit credit;
+  if (len != sizeof(credit)) {
+    ESP_LOGW(link.tag(), "Invalid credit payload len=%u", len);
+    return;
+  }
+  memcpy(&credit, payload, sizeof(credit));
+  const uint8_t channel = credit.channel_flags & channel_wire::kChannelMask;
+  if (channel >= UART_LINK_CHANNEL_COUNT) {
+    return;
+  }
+  if (credit.channel_flags & channel_wire::kCreditRequest) {
+    link.reassemblers[channel].on_credit_request(credit.seq);
+    queue_credit(link, channel);
+    return;
+  }
+  xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+  link.channels.on_credit(channel, credit.seq);
+  xSemaphoreGive(link.channel_lock);
+  wake_tx(link);
+}
+
+void process_handshake(Link& link, const uart_link_handshake_t& remote) {
+  const char* tag = link.tag();
+  log_handshake_details(link, "Remote handshake", remote);
   if (is_local_handshake(remote)) {
     ESP_LOGW(
-        kTag,
+        tag,
         "Ignoring loopback handshake that matches local role/config. Check UART wiring (RX pin is seeing local TX).");
-    s_stats.loopback_frames++;
+    link.stats.rx_loopback();
     return;
   }
-  s_handshake.received = true;
-  s_handshake.remote = remote;
-  s_stats.handshake_received = true;
-  s_stats.remote_role = remote.role;
-  s_stats.remote_flags = remote.flags;
-  s_stats.remote_baud = remote.baud_rate;
+  link.handshake.received = true;
+  link.handshake.remote = remote;
+  portENTER_CRITICAL(&link.lock);
+  link.status.handshake_received = true;
+  link.status.remote_role = remote.role;
+  link.status.remote_flags = remote.flags;
+  link.status.remote_baud = remote.baud_rate;
+  portEXIT_CRITICAL(&link.lock);
 
   bool ok = true;
   if (remote.version != UART_LINK_VERSION) {
     ok = false;
-    ESP_LOGE(kTag, "Handshake mismatch: version %u (expected %u)", remote.version, UART_LINK_VERSION);
+    ESP_LOGE(tag, "Handshake mismatch: version %u (expected %u)", remote.version, UART_LINK_VERSION);
   }
   if (remote.role != UART_LINK_ROLE_ZIGBEE_COPROC) {
     ok = false;
-    ESP_LOGE(kTag, "Handshake mismatch: expected Zigbee co-processor role, got %s", role_to_string(remote.role));
+    ESP_LOGE(tag, "Handshake mismatch: expected Zigbee co-processor role, got %s", role_to_string(remote.role));
   }
   if (remote.baud_rate != CONFIG_APP_UART_LINK_UART_BAUDRATE) {
     ok = false;
-    ESP_LOGE(kTag, "Handshake mismatch: baud %u (expected %u)", remote.baud_rate, CONFIG_APP_UART_LINK_UART_BAUDRATE);
+    ESP_LOGE(tag, "Handshake mismatch: baud %u (expected %u)", remote.baud_rate, CONFIG_APP_UART_LINK_UART_BAUDRATE);
   }
   const bool remote_flow = (remote.flags & UART_LINK_HANDSHAKE_FLAG_FLOW_CTRL) != 0;
 #ifdef CONFIG_APP_UART_LINK_USE_HW_FLOWCTRL
@@ -171,116 +469,243 @@ void process_handshake(const uart_link_handshake_t& remote) {
 #endif
   if (remote_flow != local_flow) {
     ok = false;
-    ESP_LOGE(kTag, "Handshake mismatch: flow control remote=%d local=%d", remote_flow, local_flow);
+    ESP_LOGE(tag, "Handshake mismatch: flow control remote=%d local=%d", remote_flow, local_flow);
   }
 
-  s_handshake.ok = ok;
-  s_stats.handshake_ok = ok;
+  link.handshake.ok = ok;
+  portENTER_CRITICAL(&link.lock);
+  link.status.handshake_ok = ok;
+  portEXIT_CRITICAL(&link.lock);
+#ifdef CONFIG_APP_UART_LINK_COMPRESSION
+  link.compress_tx = ok && (remote.flags & UART_LINK_HANDSHAKE_FLAG_COMPRESSION) != 0;
+#endif
   if (ok) {
-    ESP_LOGI(kTag, "Handshake OK with %s (baud=%u, flags=0x%02X)", role_to_string(remote.role), remote.baud_rate,
+    set_channel_framing(link, (remote.flags & UART_LINK_HANDSHAKE_FLAG_CHANNELS) != 0);
+    // The H2 may have restarted with a new clock; estimate from scratch.
+    portENTER_CRITICAL(&link.clock_lock);
+    link.clock.reset();
+    portEXIT_CRITICAL(&link.clock_lock);
+    link.clock_sync = (remote.flags & UART_LINK_HANDSHAKE_FLAG_CLOCK_SYNC) != 0;
+  }
+  if (!ok) {
+    xEventGroupSetBits(link.events, kLinkMismatchBit);
+  }
+  link_fsm_event(link, [ok](LinkStateMachine& fsm, uint32_t now_ms) { fsm.on_handshake(ok, now_ms); });
+  if (ok) {
+    ESP_LOGI(tag, "Handshake OK with %s (baud=%u, flags=0x%02X)", role_to_string(remote.role), remote.baud_rate,
              remote.flags);
   }
 }
 
-esp_err_t send_handshake_frame() {
+esp_err_t send_handshake_frame(Link& link) {
   const uart_link_handshake_t payload = build_local_handshake();
-  log_handshake_details("Sending handshake", payload);
+  log_handshake_details(link, "Sending handshake", payload);
   const esp_err_t err =
-      send_frame(UART_LINK_MSG_HANDSHAKE, reinterpret_cast<const uint8_t*>(&payload), sizeof(payload));
+      send_frame(link, UART_LINK_MSG_HANDSHAKE, reinterpret_cast<const uint8_t*>(&payload), sizeof(payload));
   if (err == ESP_OK) {
-    s_handshake.sent = true;
-    s_handshake.last_sent_us = esp_timer_get_time();
+    link.handshake.sent = true;
+    link.handshake.last_sent_us = esp_timer_get_time();
   }
   return err;
 }
 
-void reset_parser() {
-  s_parser.length = 0;
-  s_parser.expected = 0;
+void reset_parser(Link& link) {
+  link.framer.reset();
 }
 
-void handle_frame(const uart_link_frame_t& frame) {
-  s_stats.frames_rx++;
-  s_stats.last_rx_us = esp_timer_get_time();
-  led_driver_mark_activity(LED_ACTIVITY_RX);
-  log_frame_debug("RX", frame.type, frame.payload_len);
-  switch (frame.type) {
+void handle_clock_sync(Link& link, const uint8_t* payload) {
+  clock_wire::Sync reply;
+  memcpy(&reply, payload, sizeof(reply));
+  portENTER_CRITICAL(&link.clock_lock);
+  link.clock.add_sample(static_cast<int64_t>(reply.t1_us), static_cast<int64_t>(reply.t2_us),
+                        static_cast<int64_t>(reply.t3_us), link.rx_frame_us);
+  portEXIT_CRITICAL(&link.clock_lock);
+}
+
+uint32_t clamp_hop(int64_t us) {
+  // Offset error can make a short hop come out slightly negative.
+  return us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(us));
+}
+
+// Unwraps an H2-timestamped frame, records the hops it covers and dispatches the inner frame.
+void handle_stamped(Link& link, const uint8_t* payload, uint16_t len) {
+  clock_wire::StampHeader header;
+  if (len < sizeof(header)) {
+    ESP_LOGW(link.tag(), "Short STAMPED frame (%u bytes)", len);
+    return;
+  }
+  memcpy(&header, payload, sizeof(header));
+  if (header.type == UART_LINK_MSG_STAMPED) {
+    return;
+  }
+  portENTER_CRITICAL(&link.clock_lock);
+  const bool synced = link.clock.estimate().valid;
+  const int64_t h2_rx = link.clock.remote32_to_local(header.rx_us, link.rx_frame_us);
+  const int64_t h2_tx = link.clock.remote32_to_local(header.tx_us, link.rx_frame_us);
+  portEXIT_CRITICAL(&link.clock_lock);
+  link.stats.stamped_frame(synced);
+  link.rx_stamp = {link.rx_frame_us, h2_rx, h2_tx, synced};
+  link.rx_stamped = true;
+  if (header.type != UART_LINK_MSG_ZB_RESPONSE) {
+    // Events; responses cover the other direction and their handler records those hops.
+    link.stats.hop(UART_LINK_HOP_H2_RX, header.tx_us - header.rx_us);
+    if (synced) {
+      link.stats.hop(UART_LINK_HOP_LINK_UP, clamp_hop(link.rx_frame_us - h2_tx));
+    }
+  }
+  dispatch_frame(link, header.type, payload + sizeof(header), static_cast<uint16_t>(len - sizeof(header)));
+  link.rx_stamped = false;
+  link.stats.hop(UART_LINK_HOP_DISPATCH, clamp_hop(esp_timer_get_time() - link.rx_frame_us));
+}
+
+void dispatch_frame(Link& link, uint8_t type, const uint8_t* payload, uint16_t len) {
+  switch (type) {
     case UART_LINK_MSG_HELLO: {
-      ESP_LOGI(kTag, "HELLO frame from H2 (%.*s)", frame.payload_len,
-               frame.payload_len ? (const char*)frame.payload : "");
-      const bool hello_loopback = frame.payload_len == (sizeof(kLocalHelloMsg) - 1) &&
-                                  memcmp(frame.payload, kLocalHelloMsg, sizeof(kLocalHelloMsg) - 1) == 0;
+      ESP_LOGI(link.tag(), "HELLO frame from H2 (%.*s)", len, len ? (const char*)payload : "");
+      const bool hello_loopback = len == (sizeof(kLocalHelloMsg) - 1) &&
+                                  memcmp(payload, kLocalHelloMsg, sizeof(kLocalHelloMsg) - 1) == 0;
       if (hello_loopback) {
-        ESP_LOGW(kTag, "Detected HELLO loopback (received own '%s' banner). Verify TX/RX crossover and ground sharing.",
+        ESP_LOGW(link.tag(),
+                 "Detected HELLO loopback (received own '%s' banner). Verify TX/RX crossover and ground sharing.",
                  kLocalHelloMsg);
-        s_stats.loopback_frames++;
+        link.stats.rx_loopback();
+      } else {
+        link_fsm_event(link, [](LinkStateMachine& fsm, uint32_t now_ms) { fsm.on_peer_hello(now_ms); });
       }
       break;
     }
     case UART_LINK_MSG_HEARTBEAT:
-      ESP_LOGD(kTag, "Heartbeat ack (%u bytes)", frame.payload_len);
+      if (link.clock_sync && len == sizeof(clock_wire::Sync) && payload[0] == UART_LINK_HEARTBEAT_CLOCK_SYNC) {
+        handle_clock_sync(link, payload);
+      } else {
+        ESP_LOGD(link.tag(), "Heartbeat ack (%u bytes)", len);
+      }
       break;
     case UART_LINK_MSG_HANDSHAKE: {
-      if (frame.payload_len != sizeof(uart_link_handshake_t)) {
-        ESP_LOGW(kTag, "Invalid handshake payload len=%u", frame.payload_len);
+      if (len != sizeof(uart_link_handshake_t)) {
+        ESP_LOGW(link.tag(), "Invalid handshake payload len=%u", len);
         break;
       }
       uart_link_handshake_t remote = {};
-      memcpy(&remote, frame.payload, sizeof(remote));
-      process_handshake(remote);
+      memcpy(&remote, payload, sizeof(remote));
+      process_handshake(link, remote);
       break;
     }
     case UART_LINK_MSG_ZB_SIGNAL:
-      ESP_LOGI(kTag, "Zigbee signal: %.*s", frame.payload_len, (const char*)frame.payload);
+      ESP_LOGI(link.tag(), "Zigbee signal: %.*s", len, (const char*)payload);
+      break;
+    case UART_LINK_MSG_STAMPED:
+      handle_stamped(link, payload, len);
+      break;
+    case UART_LINK_MSG_CHANNEL_DATA:
+      handle_channel_data(link, payload, len);
+      break;
+    case UART_LINK_MSG_CHANNEL_CREDIT:
+      handle_channel_credit(link, payload, len);
       break;
     default:
-      ESP_LOGW(kTag, "Unhandled frame type 0x%02X (%u bytes)", frame.type, frame.payload_len);
+      for (const FrameHandler& handler : s_frame_handlers) {
+        if (handler.fn && handler.type == type) {
+          handler.fn(type, payload, len, handler.ctx);
+          return;
+        }
+      }
+      ESP_LOGW(link.tag(), "Unhandled frame type 0x%02X (%u bytes)", type, len);
       break;
   }
 }
 
-void push_bytes(const uint8_t* data, size_t len) {
-  for (size_t i = 0; i < len; ++i) {
-    const uint8_t byte = data[i];
-    if (s_parser.length == 0 && byte != UART_LINK_PREAMBLE) {
-      continue;
-    }
-    if (s_parser.length >= sizeof(s_parser.buffer)) {
-      reset_parser();
-      s_stats.dropped_frames++;
-      continue;
-    }
-    s_parser.buffer[s_parser.length++] = byte;
-    if (s_parser.length >= 5 && s_parser.expected == 0) {
-      const uint16_t payload_len = (static_cast<uint16_t>(s_parser.buffer[3]) << 8) | s_parser.buffer[4];
-      const size_t total = 1 + 1 + 1 + 2 + payload_len + 2;
-      if (payload_len > UART_LINK_MAX_PAYLOAD || total > sizeof(s_parser.buffer)) {
-        ESP_LOGW(kTag, "Invalid payload length %u", payload_len);
-        reset_parser();
-        s_stats.dropped_frames++;
-        continue;
-      }
-      s_parser.expected = total;
-    }
-    if (s_parser.expected && s_parser.length == s_parser.expected) {
-      uart_link_frame_t frame = {};
-      if (uart_link_try_parse(s_parser.buffer, s_parser.length, &frame)) {
-        handle_frame(frame);
-      } else {
-        s_stats.crc_errors++;
-        ESP_LOGW(kTag, "CRC mismatch or malformed frame");
-      }
-      reset_parser();
+void handle_frame(Link& link, const uart_link_frame_t& frame) {
+  DEBUG_PROFILE();
+  link.rx_frame_us = esp_timer_get_time();
+  link.stats.rx_frame(frame.payload_len, link.rx_frame_us);
+  led_driver_mark_activity(LED_ACTIVITY_RX);
+  log_frame_debug(link, "RX", frame.type, frame.payload_len);
+  if (!(frame.type & link_codec::kCompressedFlag)) {
+    dispatch_frame(link, frame.type, frame.payload, frame.payload_len);
+    return;
+  }
+#ifdef CONFIG_APP_UART_LINK_COMPRESSION
+  link_codec::Decoder decoder;
+  decoder.begin(link.rx_plain, sizeof(link.rx_plain));
+  if (!decoder.feed(frame.payload, frame.payload_len) || !decoder.finish()) {
+    link.stats.rx_decode_error();
+    ESP_LOGW(link.tag(), "Corrupt compressed frame type 0x%02X (%u bytes)", frame.type, frame.payload_len);
+    return;
+  }
+  link.stats.rx_compressed(decoder.size(), frame.payload_len);
+  dispatch_frame(link, frame.type & ~link_codec::kCompressedFlag, link.rx_plain,
+                 static_cast<uint16_t>(decoder.size()));
+#else
+  link.stats.rx_decode_error();
+  ESP_LOGW(link.tag(), "Compressed frame type 0x%02X received but compression is disabled", frame.type);
+#endif
+}
+
+void push_bytes(Link& link, const uint8_t* data, size_t len) {
+  DEBUG_PROFILE();
+  uart_link_frame_t frame;
+  while (len) {
+    size_t consumed = 0;
+    switch (link.framer.push(data, len, &consumed, &frame)) {
+      case LinkFramer::Result::kNeedMore:
+        break;
+      case LinkFramer::Result::kFrame:
+        handle_frame(link, frame);
+        break;
+      case LinkFramer::Result::kCrcError:
+        link.stats.rx_crc_error();
+        ESP_LOGW(link.tag(), "CRC mismatch or malformed frame");
+        break;
+      case LinkFramer::Result::kBadLength:
+        ESP_LOGW(link.tag(), "Invalid payload length %u", link.framer.bad_length());
+        link.stats.rx_dropped();
+        break;
+      case LinkFramer::Result::kOverrun:
+        link.stats.rx_dropped();
+        break;
     }
+    data += consumed;
+    len -= consumed;
   }
 }
 
-esp_err_t send_frame(uart_link_msg_type_t type, const uint8_t* payload, uint16_t len) {
-  if (len > UART_LINK_MAX_PAYLOAD) {
+// Control frames stay readable on the wire and are never worth compressing.
+bool compressible(const Link& link, uart_link_msg_type_t type, uint16_t len) {
+  return link.compress_tx && len >= link_codec::kMinInput && type != UART_LINK_MSG_HELLO &&
+         type != UART_LINK_MSG_HEARTBEAT && type != UART_LINK_MSG_HANDSHAKE && type != UART_LINK_MSG_CHANNEL_CREDIT;
+}
+
+size_t compress_payload(Link& link, const uint8_t* payload, uint16_t len, uint8_t* out, size_t out_cap) {
+  xSemaphoreTake(link.codec_lock, portMAX_DELAY);
+  const size_t packed = link_codec::compress(payload, len, out, out_cap, &link.codec_workspace);
+  xSemaphoreGive(link.codec_lock);
+  return packed;
+}
+
+// Payloads up to link_codec::kMaxDecoded are accepted if they compress to a single frame.
+esp_err_t send_frame(Link& link, uart_link_msg_type_t type, const uint8_t* payload, uint16_t len) {
+  DEBUG_PROFILE();
+  const int64_t start_us = esp_timer_get_time();
+  if (len > link_codec::kMaxDecoded) {
     return ESP_ERR_INVALID_ARG;
   }
+  uint8_t type_byte = static_cast<uint8_t>(type);
+  uint8_t packed[UART_LINK_MAX_PAYLOAD];
+  if (compressible(link, type, len)) {
+    const size_t packed_len = compress_payload(link, payload, len, packed, sizeof(packed));
+    if (packed_len) {
+      link.stats.tx_compressed(len, packed_len);
+      type_byte |= link_codec::kCompressedFlag;
+      payload = packed;
+      len = static_cast<uint16_t>(packed_len);
+    }
+  }
+  if (len > UART_LINK_MAX_PAYLOAD) {
+    return ESP_ERR_INVALID_SIZE;
+  }
   uart_link_frame_t frame{};
-  frame.type = static_cast<uint8_t>(type);
+  frame.type = type_byte;
   frame.payload_len = len;
   if (len) {
     memcpy(frame.payload, payload, len);
@@ -288,73 +713,294 @@ esp_err_t send_frame(uart_link_msg_type_t type, const uint8_t* payload, uint16_t
   uint8_t buffer[UART_LINK_MAX_PAYLOAD + 8] = {};
   const size_t written = uart_link_encode_frame(buffer, sizeof(buffer), &frame);
   if (!written) {
+    link.stats.tx_error();
     return ESP_FAIL;
   }
-  const int bytes = uart_write_bytes(link_uart(), reinterpret_cast<const char*>(buffer), written);
+  const int bytes = uart_write_bytes(link.port(), reinterpret_cast<const char*>(buffer), written);
   if (bytes < 0 || static_cast<size_t>(bytes) != written) {
+    link.stats.tx_error();
     return ESP_FAIL;
   }
-  uart_wait_tx_done(link_uart(), pdMS_TO_TICKS(20));
-  s_stats.frames_tx++;
-  s_stats.last_tx_us = esp_timer_get_time();
+  uart_wait_tx_done(link.port(), pdMS_TO_TICKS(20));
+  const int64_t done_us = esp_timer_get_time();
+  link.stats.tx_frame(written, static_cast<uint32_t>(done_us - start_us), done_us);
   led_driver_mark_activity(LED_ACTIVITY_TX);
-  log_frame_debug("TX", type, len);
+  log_frame_debug(link, "TX", type, len);
   return ESP_OK;
 }
 
-void rx_task(void*) {
-  uint8_t* rx_buffer = static_cast<uint8_t*>(heap_caps_malloc(kRxBufferSize, MALLOC_CAP_INTERNAL));
-  if (!rx_buffer) {
-    ESP_LOGE(kTag, "Failed to allocate RX buffer");
-    vTaskDelete(nullptr);
-    return;
+// Overflows lose bytes before the framer sees them; it resynchronises on its own, at the
+// cost of a CRC error or a missing frame, so they are only counted here.
+void drain_uart_events(Link& link) {
+  uart_event_t event;
+  while (xQueueReceive(link.uart_events, &event, 0) == pdTRUE) {
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+      link.stats.rx_overflow();
+      ESP_LOGW(link.tag(), "RX %s overflowed; bytes lost", event.type == UART_FIFO_OVF ? "FIFO" : "buffer");
+    }
   }
+}
+
+void rx_task(void* arg) {
+  Link& link = *static_cast<Link*>(arg);
   while (true) {
     if (s_suspended) {
       vTaskDelay(pdMS_TO_TICKS(200));
       continue;
     }
-    const int len = uart_read_bytes(link_uart(), rx_buffer, kRxBufferSize, pdMS_TO_TICKS(100));
+    const int len = uart_read_bytes(link.port(), link.rx_buffer, kRxBufferSize, pdMS_TO_TICKS(100));
     if (len > 0) {
+      link.stats.rx_bytes(len);
       if (s_debug_frames) {
-        ESP_LOGI(kTag, "[RX_CHUNK] %d bytes", len);
+        ESP_LOGI(link.tag(), "[RX_CHUNK] %d bytes", len);
       }
-      push_bytes(rx_buffer, len);
+      push_bytes(link, link.rx_buffer, len);
     }
+    drain_uart_events(link);
   }
 }
 
-void heartbeat_task(void*) {
-  const char msg[] = "hb";
+uint32_t now_us32() {
+  return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+// Sends credit grants the RX task queued, then channel traffic one frame at a time, re-picking
+// the highest-priority channel after each, so a queued command waits for at most the fragment
+// already on the wire.
+// send_frame() returns once the frame has left the FIFO, which keeps the driver's TX
+// buffer from queueing bulk fragments ahead of it.
+void tx_task(void* arg) {
+  Link& link = *static_cast<Link*>(arg);
   while (true) {
-    if (!s_suspended) {
-      /*
-      // Auto-handshake disabled for manual debugging
-      if (!s_handshake.ok) {
-        const int64_t now = esp_timer_get_time();
-        if (!s_handshake.sent || (now - s_handshake.last_sent_us) >= kHandshakeRetryIntervalUs) {
-          ESP_LOGI(kTag, "No valid handshake yet; retrying Zigbee handshake frame");
-          send_handshake_frame();
-        }
+    if (s_suspended) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+      continue;
+    }
+    const uint32_t now_us = now_us32();
+    ChannelScheduler::Fragment fragment;
+    uint8_t probe_channel = 0;
+    channel_wire::Credit probe;
+    bool queued = false;
+    channel_wire::Credit grants[UART_LINK_CHANNEL_COUNT];
+    uint8_t grant_count = 0;
+    xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < UART_LINK_CHANNEL_COUNT; ++i) {
+      if (link.credits_due & (1u << i)) {
+        grants[grant_count++] = {i, 0, link.credit_seq[i]};
       }
-      */
-      send_frame(UART_LINK_MSG_HEARTBEAT, reinterpret_cast<const uint8_t*>(msg), sizeof(msg) - 1);
     }
-    vTaskDelay(pdMS_TO_TICKS(kHeartbeatIntervalMs));
+    link.credits_due = 0;
+    const bool send_probe = link.channels.credit_probe(now_us, &probe_channel, &probe);
+    const bool send = link.channels.next(now_us, &fragment, link.tx_payload);
+    for (uint8_t i = 0; i < UART_LINK_CHANNEL_COUNT; ++i) {
+      queued = queued || link.channels.queued_bytes(i);
+    }
+    xSemaphoreGive(link.channel_lock);
+
+    // Grants first: the peer's sender may be stalled on them.
+    for (uint8_t i = 0; i < grant_count; ++i) {
+      send_frame(link, static_cast<uart_link_msg_type_t>(UART_LINK_MSG_CHANNEL_CREDIT),
+                 reinterpret_cast<const uint8_t*>(&grants[i]), sizeof(grants[i]));
+    }
+    if (send_probe) {
+      ESP_LOGD(link.tag(), "Channel %u out of credits; asking the peer", probe_channel);
+      send_frame(link, static_cast<uart_link_msg_type_t>(UART_LINK_MSG_CHANNEL_CREDIT),
+                 reinterpret_cast<const uint8_t*>(&probe), sizeof(probe));
+    }
+    if (send) {
+      if (fragment.last) {
+        xEventGroupSetBits(link.events, kTxSpaceBit);
+      }
+      // A lost fragment costs its message; callers that need delivery acknowledge end to end.
+      send_frame(link, static_cast<uart_link_msg_type_t>(fragment.type), link.tx_payload, fragment.length);
+      continue;
+    }
+    // Waiting on credits: wake for the next probe even if no grant arrives.
+    ulTaskNotifyTake(pdTRUE, queued ? pdMS_TO_TICKS(ChannelScheduler::kCreditProbeUs / 1000) : portMAX_DELAY);
   }
 }
 
-}  // namespace
+void stats_tick(void*) {
+  const int64_t now_us = esp_timer_get_time();
+  for (Link& link : s_links) {
+    link.stats.tick(now_us);
+  }
+}
 
-esp_err_t uart_link_init(void) {
-  printf("DEBUG: Inside uart_link_init\n");
-  DEBUG_FUNC_ENTER();
-  if (s_initialized) {
-    DEBUG_FUNC_EXIT_RC(ESP_OK);
-    return ESP_OK;
+LinkSupervisor::Config supervisor_config() {
+  LinkSupervisor::Config config;
+  config.keepalive_ms = CONFIG_APP_UART_LINK_KEEPALIVE_MS;
+  config.probe_interval_ms = CONFIG_APP_UART_LINK_PROBE_INTERVAL_MS;
+  config.dead_after_probes = CONFIG_APP_UART_LINK_DEAD_AFTER_PROBES;
+  config.degraded_permille = CONFIG_APP_UART_LINK_DEGRADED_PERMILLE;
+  return config;
+}
+
+LinkStateMachine::Config link_fsm_config() {
+  LinkStateMachine::Config config;
+  config.initial_backoff_ms = CONFIG_APP_UART_LINK_BACKOFF_MIN_MS;
+  config.max_backoff_ms = CONFIG_APP_UART_LINK_BACKOFF_MAX_MS;
+  return config;
+}
+
+// Runs on the link's own task, so listeners can ask uart_link_current() which link it was.
+void emit_event(uart_link_event_t event) {
+  for (const EventListener& listener : s_event_listeners) {
+    if (listener.cb) {
+      listener.cb(event, listener.ctx);
+    }
   }
-  printf("DEBUG: Calling esp_random\n");
-  s_local_secret = (uint8_t)(esp_random() & 0xFF);
+}
+
+void handle_supervisor_events(Link& link, uint32_t events) {
+  const char* tag = link.tag();
+  if (events & LinkSupervisor::kEventAlive) {
+    ESP_LOGI(tag, "Peer alive");
+    emit_event(UART_LINK_EVENT_PEER_ALIVE);
+  }
+  if (events & LinkSupervisor::kEventQuiet) {
+    ESP_LOGW(tag, "Peer quiet for %u ms; probing every %u ms",
+             static_cast<unsigned>(CONFIG_APP_UART_LINK_KEEPALIVE_MS + CONFIG_APP_UART_LINK_PROBE_INTERVAL_MS),
+             static_cast<unsigned>(CONFIG_APP_UART_LINK_PROBE_INTERVAL_MS));
+    emit_event(UART_LINK_EVENT_PEER_QUIET);
+  }
+  if (events & LinkSupervisor::kEventDead) {
+    ESP_LOGW(tag, "Peer dead after %u unanswered probes; renegotiating",
+             static_cast<unsigned>(CONFIG_APP_UART_LINK_DEAD_AFTER_PROBES));
+    link.handshake.ok = false;
+    link.handshake.received = false;
+    portENTER_CRITICAL(&link.lock);
+    link.status.handshake_ok = false;
+    link.status.handshake_received = false;
+    portEXIT_CRITICAL(&link.lock);
+    emit_event(UART_LINK_EVENT_PEER_DEAD);
+  }
+  if (events & LinkSupervisor::kEventDegraded) {
+    ESP_LOGW(tag, "Link degraded (%lu errors per 1000 frames)",
+             static_cast<unsigned long>(link.supervisor.stats().bad_permille));
+    emit_event(UART_LINK_EVENT_DEGRADED);
+  }
+  if (events & LinkSupervisor::kEventRecovered) {
+    ESP_LOGI(tag, "Link quality recovered");
+    emit_event(UART_LINK_EVENT_RECOVERED);
+  }
+}
+
+void report_state_change(Link& link) {
+  portENTER_CRITICAL(&link.lock);
+  const LinkStateMachine::State state = link.fsm.state();
+  const uint32_t time_to_up_ms = link.fsm.stats().last_time_to_up_ms;
+  portEXIT_CRITICAL(&link.lock);
+  if (state == LinkStateMachine::State::kUp || state == LinkStateMachine::State::kDegraded) {
+    xEventGroupSetBits(link.events, kLinkUpBit);
+  } else {
+    xEventGroupClearBits(link.events, kLinkUpBit);
+  }
+  if (state == LinkStateMachine::State::kUp) {
+    ESP_LOGI(link.tag(), "Link UP (%lu ms to negotiate)", static_cast<unsigned long>(time_to_up_ms));
+  } else {
+    ESP_LOGI(link.tag(), "Link %s", uart_link_state_name(static_cast<uint8_t>(state)));
+  }
+  emit_event(UART_LINK_EVENT_STATE_CHANGED);
+}
+
+// Milliseconds until the next clock sync exchange is due (UINT32_MAX when not negotiated).
+uint32_t clock_sync_in_ms(const Link& link) {
+  if (!link.clock_sync) {
+    return UINT32_MAX;
+  }
+  const int64_t elapsed_ms = (esp_timer_get_time() - link.last_sync_us) / 1000;
+  return elapsed_ms >= CONFIG_APP_UART_LINK_CLOCK_SYNC_MS
+             ? 0
+             : static_cast<uint32_t>(CONFIG_APP_UART_LINK_CLOCK_SYNC_MS - elapsed_ms);
+}
+
+// With clock sync negotiated every heartbeat is a sync request, and traffic does not
+// suppress the exchange; otherwise the heartbeat carries a short text.
+esp_err_t send_heartbeat(Link& link, const char* text, size_t len) {
+  if (!link.clock_sync) {
+    return send_frame(link, UART_LINK_MSG_HEARTBEAT, reinterpret_cast<const uint8_t*>(text),
+                      static_cast<uint16_t>(len));
+  }
+  clock_wire::Sync request = {};
+  request.marker = UART_LINK_HEARTBEAT_CLOCK_SYNC;
+  link.last_sync_us = esp_timer_get_time();
+  request.t1_us = static_cast<uint64_t>(link.last_sync_us);
+  return send_frame(link, UART_LINK_MSG_HEARTBEAT, reinterpret_cast<const uint8_t*>(&request), sizeof(request));
+}
+
+// Runs the supervisor and the negotiation state machine; sleeps until the next deadline or
+// until the RX task reports a HELLO/handshake.
+void link_task(void* arg) {
+  Link& link = *static_cast<Link*>(arg);
+  const char msg[] = "hb";
+  const uint32_t start_ms = to_ms(esp_timer_get_time());
+  portENTER_CRITICAL(&link.lock);
+  link.supervisor.reset(start_ms);
+  link.fsm.start(start_ms);
+  portEXIT_CRITICAL(&link.lock);
+  while (true) {
+    if (s_suspended) {
+      link.restart = true;
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+      continue;
+    }
+    uart_link_stats_t counters = {};
+    link.stats.fill(&counters);
+    const LinkSupervisor::Observation observation = {
+        to_ms(counters.last_rx_us), to_ms(counters.last_tx_us), counters.frames_rx,
+        counters.crc_errors,        counters.dropped_frames,    counters.loopback_frames,
+    };
+    const uint32_t now_ms = to_ms(esp_timer_get_time());
+    portENTER_CRITICAL(&link.lock);
+    if (link.restart) {
+      link.restart = false;
+      link.supervisor.reset(now_ms);
+      link.fsm.start(now_ms);
+    }
+    const LinkSupervisor::Decision decision = link.supervisor.poll(now_ms, observation);
+    if (decision.events & LinkSupervisor::kEventDead) {
+      link.fsm.on_peer_dead(now_ms);
+    }
+    if (decision.events & LinkSupervisor::kEventDegraded) {
+      link.fsm.on_degraded();
+    }
+    if (decision.events & LinkSupervisor::kEventRecovered) {
+      link.fsm.on_recovered();
+    }
+    const LinkStateMachine::Action action = link.fsm.poll(now_ms, esp_random());
+    const bool up = link.fsm.is_up();
+    portEXIT_CRITICAL(&link.lock);
+
+    handle_supervisor_events(link, decision.events);
+    if (action.state_changed) {
+      report_state_change(link);
+    }
+    if (action.send_hello) {
+      send_frame(link, UART_LINK_MSG_HELLO, reinterpret_cast<const uint8_t*>(kLocalHelloMsg),
+                 sizeof(kLocalHelloMsg) - 1);
+    }
+    if (action.send_handshake) {
+      send_handshake_frame(link);
+    } else if (up && (decision.send_heartbeat || clock_sync_in_ms(link) == 0)) {
+      // While negotiating, HELLO/handshake frames already serve as probes.
+      if (send_heartbeat(link, msg, sizeof(msg) - 1) == ESP_OK) {
+        portENTER_CRITICAL(&link.lock);
+        link.supervisor.heartbeat_sent(to_ms(esp_timer_get_time()));
+        portEXIT_CRITICAL(&link.lock);
+      }
+    }
+    uint32_t sleep_ms = action.next_poll_ms < decision.next_poll_ms ? action.next_poll_ms : decision.next_poll_ms;
+    if (up && clock_sync_in_ms(link) < sleep_ms) {
+      sleep_ms = clock_sync_in_ms(link);
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep_ms));
+  }
+}
+
+esp_err_t start_link(Link& link, uint8_t index) {
+  link.index = index;
+  link.config = &kPorts[index];
   uart_config_t uart_config = {};
   uart_config.baud_rate = CONFIG_APP_UART_LINK_UART_BAUDRATE;
   uart_config.data_bits = UART_DATA_8_BITS;
@@ -367,75 +1013,352 @@ esp_err_t uart_link_init(void) {
   uart_config.flow_ctrl = UART_HW_FLOWCTRL_CTS_RTS;
 #endif
   printf("DEBUG: Calling uart_param_config\n");
-  ESP_ERROR_CHECK(uart_param_config(link_uart(), &uart_config));
+  ESP_ERROR_CHECK(uart_param_config(link.port(), &uart_config));
 #ifdef CONFIG_APP_UART_LINK_USE_HW_FLOWCTRL
-  ESP_ERROR_CHECK(uart_set_pin(link_uart(), CONFIG_APP_UART_LINK_UART_TX_PIN, CONFIG_APP_UART_LINK_UART_RX_PIN,
-                               CONFIG_APP_UART_LINK_UART_RTS_PIN, CONFIG_APP_UART_LINK_UART_CTS_PIN));
+  ESP_ERROR_CHECK(
+      uart_set_pin(link.port(), link.config->tx_pin, link.config->rx_pin, link.config->rts_pin, link.config->cts_pin));
 #else
-  printf("DEBUG: Calling uart_set_pin TX=%d RX=%d\n", CONFIG_APP_UART_LINK_UART_TX_PIN,
-         CONFIG_APP_UART_LINK_UART_RX_PIN);
-  ESP_ERROR_CHECK(uart_set_pin(link_uart(), CONFIG_APP_UART_LINK_UART_TX_PIN, CONFIG_APP_UART_LINK_UART_RX_PIN,
-                               UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+  printf("DEBUG: Calling uart_set_pin TX=%d RX=%d\n", link.config->tx_pin, link.config->rx_pin);
+  ESP_ERROR_CHECK(
+      uart_set_pin(link.port(), link.config->tx_pin, link.config->rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
 #endif
-  printf("DEBUG: Calling uart_driver_install for port %d\n", link_uart());
-  ESP_ERROR_CHECK(uart_driver_install(link_uart(), kRxBufferSize, kTxBufferSize, 0, nullptr, 0));
+  printf("DEBUG: Calling uart_driver_install for port %d\n", link.port());
+  ESP_ERROR_CHECK(uart_driver_install(link.port(), kDriverRxBufferSize, kTxBufferSize, kUartEventQueueLength,
+                                      &link.uart_events, kUartIntrFlags));
+  mem_budget_charge(MEM_BUDGET_LINK, MEM_BUDGET_BUFFER, kDriverRxBufferSize + kTxBufferSize, true);
 
-  reset_parser();
-  s_stats = {};
-  s_stats.initialized = true;
-  s_stats.debug_enabled = s_debug_frames;
+  reset_parser(link);
+  link.status = {};
+  link.status.initialized = true;
+  link.status.port = static_cast<uint8_t>(link.config->port);
+  link.supervisor = LinkSupervisor(supervisor_config());
+  link.fsm = LinkStateMachine(link_fsm_config());
+  link.events = link.storage.events.create(MEM_BUDGET_LINK);
+  link.codec_lock = link.storage.codec_lock.create(MEM_BUDGET_LINK);
+  link.channel_lock = link.storage.channel_lock.create(MEM_BUDGET_LINK);
+  if (!link.events || !link.codec_lock || !link.channel_lock) {
+    return ESP_ERR_NO_MEM;
+  }
+  mem_budget_charge(MEM_BUDGET_LINK, MEM_BUDGET_BUFFER, sizeof(Link) - sizeof(Link::Storage), false);
+  link.status.debug_enabled = s_debug_frames;
+  uint8_t* const channel_queues[UART_LINK_CHANNEL_COUNT] = {link.command_queue, link.event_queue, link.bulk_queue};
+  for (uint8_t i = 0; i < UART_LINK_CHANNEL_COUNT; ++i) {
+    ChannelScheduler::ChannelConfig config;
+    config.priority = i;
+    config.storage = channel_queues[i];
+    config.storage_size = kChannelQueueBytes[i];
+    link.channels.configure(i, config);
+    link.reassemblers[i].begin(link.rx_messages[i], kMaxMessage);
+  }
 
-  BaseType_t created = xTaskCreate(rx_task, "uart_link_rx", 4096, nullptr, 5, &s_rx_task);
+  BaseType_t created =
+      link.storage.rx_task.create(rx_task, link.config->rx_task, &link, 5, &link.rx_task, MEM_BUDGET_LINK);
   if (created != pdPASS) {
-    DEBUG_FUNC_EXIT_RC(ESP_FAIL);
     return ESP_FAIL;
   }
-  created = xTaskCreate(heartbeat_task, "uart_link_hb", 2048, nullptr, 4, &s_hb_task);
+  created =
+      link.storage.link_task.create(link_task, link.config->link_task, &link, 4, &link.link_task, MEM_BUDGET_LINK);
   if (created != pdPASS) {
-    DEBUG_FUNC_EXIT_RC(ESP_FAIL);
     return ESP_FAIL;
   }
+  created = link.storage.tx_task.create(tx_task, link.config->tx_task, &link, 4, &link.tx_task, MEM_BUDGET_LINK);
+  if (created != pdPASS) {
+    return ESP_FAIL;
+  }
+  ESP_LOGI(link.tag(), "UART bridge ready on UART%d (TX=%d RX=%d)", link.port(), link.config->tx_pin,
+           link.config->rx_pin);
+  return ESP_OK;
+}
 
-  ESP_ERROR_CHECK(
-      send_frame(UART_LINK_MSG_HELLO, reinterpret_cast<const uint8_t*>(kLocalHelloMsg), sizeof(kLocalHelloMsg) - 1));
-  ESP_ERROR_CHECK(send_handshake_frame());
-  ESP_LOGI(kTag, "UART bridge ready on UART%d (TX=%d RX=%d)", link_uart(), CONFIG_APP_UART_LINK_UART_TX_PIN,
-           CONFIG_APP_UART_LINK_UART_RX_PIN);
+// Flash stress: the calling task sends, one task reads and frames at the RX task's
+// priority, one rewrites an NVS blob below it.
+constexpr uint8_t kStressFrameType = 0x7E;  // not a uart_link_msg_type_t
+constexpr uint16_t kStressPayload = 96;
+constexpr size_t kStressBlobBytes = 2048;
+constexpr char kStressNamespace[] = "zb_stress";
+constexpr char kStressKey[] = "blob";
+
+struct StressRun {
+  Link* link = nullptr;
+  volatile bool stop = false;
+  SemaphoreHandle_t done = nullptr;  // given by each worker as it exits
+  uart_link_stress_t result = {};
+  uint64_t parse_cycles = 0;
+};
+
+void stress_rx_task(void* arg) {
+  StressRun& run = *static_cast<StressRun*>(arg);
+  Link& link = *run.link;
+  LinkFramer framer;
+  uart_link_frame_t frame;
+  uint32_t max_parse_cycles = 0;
+  int64_t last_data_us = 0;
+  while (!run.stop) {
+    const int len = uart_read_bytes(link.port(), link.rx_buffer, kRxBufferSize, pdMS_TO_TICKS(20));
+    if (len > 0) {
+      const int64_t now_us = esp_timer_get_time();
+      if (last_data_us && now_us - last_data_us > run.result.max_read_gap_us) {
+        run.result.max_read_gap_us = static_cast<uint32_t>(now_us - last_data_us);
+      }
+      last_data_us = now_us;
+      const uint32_t start = esp_cpu_get_cycle_count();
+      for (size_t offset = 0; offset < static_cast<size_t>(len);) {
+        size_t consumed = 0;
+        const LinkFramer::Result result = framer.push(link.rx_buffer + offset, len - offset, &consumed, &frame);
+        if (result == LinkFramer::Result::kFrame && frame.type == kStressFrameType) {
+          run.result.frames_received++;
+        } else if (result == LinkFramer::Result::kCrcError) {
+          run.result.crc_errors++;
+        }
+        offset += consumed;
+      }
+      const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+      run.parse_cycles += cycles;
+      if (cycles > max_parse_cycles) {
+        max_parse_cycles = cycles;
+      }
+    }
+    uart_event_t event;
+    while (xQueueReceive(link.uart_events, &event, 0) == pdTRUE) {
+      if (event.type == UART_FIFO_OVF) {
+        run.result.fifo_overflows++;
+      } else if (event.type == UART_BUFFER_FULL) {
+        run.result.buffer_full++;
+      }
+    }
+  }
+  run.result.max_parse_us = max_parse_cycles / esp_rom_get_cpu_ticks_per_us();
+  xSemaphoreGive(run.done);
+  vTaskDelete(nullptr);
+}
+
+void stress_flash_task(void* arg) {
+  StressRun& run = *static_cast<StressRun*>(arg);
+  // Static to keep it off the task's stack; only one run at a time.
+  static uint8_t blob[kStressBlobBytes];
+  nvs_handle_t nvs;
+  if (nvs_open(kStressNamespace, NVS_READWRITE, &nvs) == ESP_OK) {
+    while (!run.stop) {
+      // NVS skips writes that match what is stored, so every pass changes the blob.
+      memset(blob, static_cast<int>(run.result.flash_writes), sizeof(blob));
+      const int64_t start_us = esp_timer_get_time();
+      if (nvs_set_blob(nvs, kStressKey, blob, sizeof(blob)) != ESP_OK || nvs_commit(nvs) != ESP_OK) {
+        break;
+      }
+      const uint32_t elapsed_us = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+      if (elapsed_us > run.result.max_flash_write_us) {
+        run.result.max_flash_write_us = elapsed_us;
+      }
+      run.result.flash_writes++;
+      vTaskDelay(1);
+    }
+    nvs_erase_key(nvs, kStressKey);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+  xSemaphoreGive(run.done);
+  vTaskDelete(nullptr);
+}
+
+}  // namespace
+
+esp_err_t uart_link_init(void) {
+  printf("DEBUG: Inside uart_link_init\n");
+  DEBUG_FUNC_ENTER();
+  if (s_initialized) {
+    DEBUG_FUNC_EXIT_RC(ESP_OK);
+    return ESP_OK;
+  }
+  printf("DEBUG: Calling esp_random\n");
+  s_local_secret = (uint8_t)(esp_random() & 0xFF);
+
+  const esp_timer_create_args_t stats_timer_args = {
+      .callback = &stats_tick,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "uart_link_stats",
+      .skip_unhandled_events = true,
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&stats_timer_args, &s_stats_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(s_stats_timer, 1000 * 1000));
+
+  for (uint8_t i = 0; i < kLinkCount; ++i) {
+    const esp_err_t err = start_link(s_links[i], i);
+    if (err != ESP_OK) {
+      DEBUG_FUNC_EXIT_RC(err);
+      return err;
+    }
+  }
   s_initialized = true;
   DEBUG_FUNC_EXIT_RC(ESP_OK);
   return ESP_OK;
 }
 
+uint8_t uart_link_count(void) {
+  return kLinkCount;
+}
+
+int uart_link_current(void) {
+  const Link* link = current_link();
+  return link ? link->index : -1;
+}
+
 void uart_link_get_stats(uart_link_stats_t* out_stats) {
+  uart_link_get_stats_on(UART_LINK_PRIMARY, out_stats);
+}
+
+void uart_link_get_stats_on(uint8_t index, uart_link_stats_t* out_stats) {
   DEBUG_FUNC_ENTER();
   DEBUG_PARAM_PTR("out_stats", out_stats);
   if (!out_stats) {
     DEBUG_FUNC_EXIT();
     return;
   }
-  *out_stats = s_stats;
+  Link* found = link_at(index);
+  if (!found) {
+    memset(out_stats, 0, sizeof(*out_stats));
+    DEBUG_FUNC_EXIT();
+    return;
+  }
+  Link& link = *found;
+  portENTER_CRITICAL(&link.lock);
+  *out_stats = link.status;
+  const LinkSupervisor::Stats supervisor = link.supervisor.stats();
+  out_stats->peer_state = static_cast<uint8_t>(link.supervisor.peer_state());
+  out_stats->degraded = link.supervisor.degraded();
+  const LinkStateMachine::Stats negotiation = link.fsm.stats();
+  out_stats->link_state = static_cast<uint8_t>(link.fsm.state());
+  portEXIT_CRITICAL(&link.lock);
+  link.stats.fill(out_stats);
+  out_stats->handshakes_sent = negotiation.handshakes_sent;
+  out_stats->handshake_mismatches = negotiation.mismatches;
+  out_stats->link_up_count = negotiation.up_count;
+  out_stats->last_time_to_up_ms = negotiation.last_time_to_up_ms;
+  out_stats->max_time_to_up_ms = negotiation.max_time_to_up_ms;
+  out_stats->compression = link.compress_tx;
+  out_stats->channels = link.channels.framing();
+  out_stats->clock_sync = link.clock_sync;
+  out_stats->heartbeats_sent = supervisor.heartbeats_sent;
+  out_stats->heartbeats_suppressed = supervisor.heartbeats_suppressed;
+  out_stats->peer_dead_events = supervisor.dead_events;
+  out_stats->degraded_events = supervisor.degraded_events;
+  out_stats->bad_permille = supervisor.bad_permille;
   DEBUG_FUNC_EXIT();
 }
 
+void uart_link_get_metrics(uart_link_metrics_t* out_metrics) {
+  uart_link_get_metrics_on(UART_LINK_PRIMARY, out_metrics);
+}
+
+void uart_link_get_metrics_on(uint8_t index, uart_link_metrics_t* out_metrics) {
+  if (!out_metrics) {
+    return;
+  }
+  Link* link = link_at(index);
+  if (!link) {
+    memset(out_metrics, 0, sizeof(*out_metrics));
+    return;
+  }
+  link->stats.fill_metrics(out_metrics, esp_timer_get_time());
+}
+
+void uart_link_reset_metrics(void) {
+  for (Link& link : s_links) {
+    link.stats.reset_metrics();
+  }
+}
+
+void uart_link_get_latency(uart_link_latency_t* out_latency) {
+  uart_link_get_latency_on(UART_LINK_PRIMARY, out_latency);
+}
+
+void uart_link_get_latency_on(uint8_t index, uart_link_latency_t* out_latency) {
+  if (!out_latency) {
+    return;
+  }
+  Link* found = link_at(index);
+  if (!found) {
+    memset(out_latency, 0, sizeof(*out_latency));
+    return;
+  }
+  Link& link = *found;
+  link.stats.fill_latency(out_latency);
+  const int64_t now_us = esp_timer_get_time();
+  portENTER_CRITICAL(&link.clock_lock);
+  const ClockSync::Estimate estimate = link.clock.estimate();
+  uart_link_clock_t& clock = out_latency->clock;
+  clock.synced = link.clock_sync && estimate.valid;
+  clock.offset_us = link.clock.offset_at(now_us);
+  clock.drift_ppb = estimate.drift_ppb;
+  clock.error_us = estimate.delay_us / 2;
+  clock.age_ms = estimate.valid ? static_cast<uint32_t>((now_us - estimate.at_us) / 1000) : 0;
+  clock.samples = link.clock.samples();
+  clock.rejected = link.clock.rejected();
+  clock.jumps = link.clock.jumps();
+  portEXIT_CRITICAL(&link.clock_lock);
+}
+
+void uart_link_reset_latency(void) {
+  for (Link& link : s_links) {
+    link.stats.reset_latency();
+  }
+}
+
+void uart_link_record_hop(uart_link_hop_t hop, uint32_t us) {
+  // Frame handlers record on the link that delivered the frame; any other task on the primary.
+  Link* link = current_link();
+  (link ? *link : s_links[UART_LINK_PRIMARY]).stats.hop(static_cast<uint8_t>(hop), us);
+}
+
+bool uart_link_frame_stamp(uart_link_stamp_t* out_stamp) {
+  // rx_stamp is only written by the RX task, which is also the task running frame handlers.
+  const Link* link = current_link();
+  if (!out_stamp || !link || !link->rx_stamped) {
+    return false;
+  }
+  *out_stamp = link->rx_stamp;
+  return true;
+}
+
 void uart_link_print_status(void) {
   DEBUG_FUNC_ENTER();
-  uart_link_stats_t stats;
-  uart_link_get_stats(&stats);
-  ESP_LOGI(kTag, "initialized=%d suspended=%d tx=%lu rx=%lu dropped=%lu crc_errors=%lu last_rx=%lldus last_tx=%lldus",
-           stats.initialized, stats.suspended, stats.frames_tx, stats.frames_rx, stats.dropped_frames, stats.crc_errors,
-           stats.last_rx_us, stats.last_tx_us);
-  ESP_LOGI(kTag,
-           "debug=%d handshake_received=%d handshake_ok=%d remote_role=0x%02X remote_baud=%u remote_flags=0x%02X "
-           "loopbacks=%lu",
-           stats.debug_enabled, stats.handshake_received, stats.handshake_ok, stats.remote_role, stats.remote_baud,
-           stats.remote_flags, stats.loopback_frames);
+  for (uint8_t i = 0; i < kLinkCount; ++i) {
+    const char* tag = s_links[i].tag();
+    uart_link_stats_t stats;
+    uart_link_get_stats_on(i, &stats);
+    ESP_LOGI(tag, "initialized=%d suspended=%d tx=%lu rx=%lu dropped=%lu crc_errors=%lu last_rx=%lldus last_tx=%lldus",
+             stats.initialized, stats.suspended, stats.frames_tx, stats.frames_rx, stats.dropped_frames,
+             stats.crc_errors, stats.last_rx_us, stats.last_tx_us);
+    ESP_LOGI(tag, "bytes_rx=%lu bytes_tx=%lu tx_errors=%lu rx_overflows=%lu", stats.bytes_rx, stats.bytes_tx,
+             stats.tx_errors, stats.rx_overflows);
+    ESP_LOGI(tag, "peer=%s degraded=%d hb_sent=%lu hb_suppressed=%lu dead_events=%lu bad_permille=%lu",
+             uart_link_peer_state_name(stats.peer_state), stats.degraded, stats.heartbeats_sent,
+             stats.heartbeats_suppressed, stats.peer_dead_events, stats.bad_permille);
+    ESP_LOGI(tag, "link=%s up_count=%lu handshakes=%lu mismatches=%lu time_to_up=%lums (max %lums)",
+             uart_link_state_name(stats.link_state), stats.link_up_count, stats.handshakes_sent,
+             stats.handshake_mismatches, stats.last_time_to_up_ms, stats.max_time_to_up_ms);
+    ESP_LOGI(tag, "compression=%d tx=%lu frames %lu->%lu B rx=%lu frames %lu->%lu B decode_errors=%lu",
+             stats.compression, stats.compressed_frames_tx, stats.compressed_raw_bytes_tx, stats.compressed_bytes_tx,
+             stats.compressed_frames_rx, stats.compressed_bytes_rx, stats.compressed_raw_bytes_rx,
+             stats.decompress_errors);
+    ESP_LOGI(tag,
+             "debug=%d handshake_received=%d handshake_ok=%d remote_role=0x%02X remote_baud=%u remote_flags=0x%02X "
+             "loopbacks=%lu",
+             stats.debug_enabled, stats.handshake_received, stats.handshake_ok, stats.remote_role, stats.remote_baud,
+             stats.remote_flags, stats.loopback_frames);
+  }
   DEBUG_FUNC_EXIT();
 }
 
 esp_err_t uart_link_send_heartbeat(void) {
   DEBUG_FUNC_ENTER();
+  if (s_suspended) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_INVALID_STATE);
+    return ESP_ERR_INVALID_STATE;
+  }
   const char hb[] = "manual";
-  const esp_err_t result = send_frame(UART_LINK_MSG_HEARTBEAT, reinterpret_cast<const uint8_t*>(hb), sizeof(hb) - 1);
+  const esp_err_t result = send_frame(s_links[UART_LINK_PRIMARY], UART_LINK_MSG_HEARTBEAT,
+                                      reinterpret_cast<const uint8_t*>(hb), sizeof(hb) - 1);
   DEBUG_FUNC_EXIT_RC(result);
   return result;
 }
@@ -447,8 +1370,8 @@ esp_err_t uart_link_send_text(const char* text) {
     DEBUG_FUNC_EXIT_RC(ESP_ERR_INVALID_ARG);
     return ESP_ERR_INVALID_ARG;
   }
-  const size_t len = strnlen(text, UART_LINK_MAX_PAYLOAD);
-  const esp_err_t result = send_frame(UART_LINK_MSG_COMMAND, reinterpret_cast<const uint8_t*>(text), len);
+  const size_t len = strnlen(text, kMaxMessage);
+  const esp_err_t result = uart_link_channel_send(UART_LINK_CHANNEL_COMMAND, UART_LINK_MSG_COMMAND, text, len, 100);
   DEBUG_FUNC_EXIT_RC(result);
   return result;
 }
@@ -456,15 +1379,24 @@ esp_err_t uart_link_send_text(const char* text) {
 esp_err_t uart_link_suspend(void) {
   DEBUG_FUNC_ENTER();
   s_suspended = true;
-  s_stats.suspended = true;
+  for (Link& link : s_links) {
+    portENTER_CRITICAL(&link.lock);
+    link.status.suspended = true;
+    portEXIT_CRITICAL(&link.lock);
+  }
   DEBUG_FUNC_EXIT();
   return ESP_OK;
 }
 
 esp_err_t uart_link_resume(void) {
   DEBUG_FUNC_ENTER();
+  for (Link& link : s_links) {
+    link.restart = true;
+    portENTER_CRITICAL(&link.lock);
+    link.status.suspended = false;
+    portEXIT_CRITICAL(&link.lock);
+  }
   s_suspended = false;
-  s_stats.suspended = false;
   DEBUG_FUNC_EXIT();
   return ESP_OK;
 }
@@ -479,34 +1411,338 @@ esp_err_t uart_link_run_startup_check(uint32_t timeout_ms) {
   if (timeout_ms == 0) {
     timeout_ms = CONFIG_APP_UART_LINK_HANDSHAKE_TIMEOUT_MS;
   }
-  esp_err_t result = send_handshake_frame();
-  if (result != ESP_OK) {
-    DEBUG_FUNC_EXIT_RC(result);
-    return result;
+  // Only the caller waits; negotiation itself runs in the link tasks, all links at once.
+  for (Link& link : s_links) {
+    xEventGroupClearBits(link.events, kLinkUpBit | kLinkMismatchBit);
+    link_fsm_event(link, [](LinkStateMachine& fsm, uint32_t now_ms) { fsm.restart(now_ms); });
+  }
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+  esp_err_t result = ESP_OK;
+  for (Link& link : s_links) {
+    const TickType_t waited = xTaskGetTickCount() - start;
+    const EventBits_t bits = xEventGroupWaitBits(link.events, kLinkUpBit | kLinkMismatchBit, pdFALSE, pdFALSE,
+                                                 waited < timeout ? timeout - waited : 0);
+    if (bits & kLinkMismatchBit) {
+      result = ESP_FAIL;
+    } else if (!(bits & kLinkUpBit) && result == ESP_OK) {
+      result = ESP_ERR_TIMEOUT;
+    }
+  }
+  DEBUG_FUNC_EXIT_RC(result);
+  return result;
+}
+
+esp_err_t uart_link_codec_benchmark(uint32_t iterations, uart_link_codec_bench_t* out_result) {
+  if (!out_result || iterations == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  Link& link = s_links[UART_LINK_PRIMARY];
+  if (!link.codec_lock) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  // Shapes seen on the link: ZDO signals, attribute reports and a device-table snapshot.
+  static const char* const kSamples[] = {
+      "zdo_signal=DEVICE_ANNCE short=0x1a2b ieee=00:12:4b:00:1c:aa:bb:cc",
+      "attr_report ep=1 cluster=0x0006 attr=0x0000 type=bool value=1 short=0x1a2b lqi=200 rssi=-61",
+      "{\"ieee\":\"00:12:4b:00:1c:aa:bb:cc\",\"short\":\"0x1a2b\",\"ep\":1,\"cluster\":\"0x0402\",\"attr\":"
+      "\"0x0000\",\"value\":2150}",
+      "{\"ieee\":\"00:12:4b:00:22:11:0f:01\",\"short\":\"0x7c10\",\"ep\":1,\"cluster\":\"0x0006\",\"attr\":"
+      "\"0x0000\",\"value\":1},{\"ieee\":\"00:12:4b:00:22:11:0f:02\",\"short\":\"0x7c11\",\"ep\":1,\"cluster\":"
+      "\"0x0008\",\"attr\":\"0x0000\",\"value\":254},{\"ieee\":\"00:12:4b:00:22:11:0f:03\",\"short\":\"0x7c12\","
+      "\"ep\":1,\"cluster\":\"0x0300\",\"attr\":\"0x0003\",\"value\":24939}",
+  };
+  constexpr size_t kSampleCount = sizeof(kSamples) / sizeof(kSamples[0]);
+  // Static to spare the console task's stack; only the CLI runs the benchmark.
+  static uint8_t packed[kSampleCount][UART_LINK_MAX_PAYLOAD];
+  static uint8_t plain[link_codec::kMaxDecoded];
+  size_t packed_len[kSampleCount] = {};
+  uint32_t raw_total = 0;
+  uint32_t packed_total = 0;
+  uint64_t plain_wire = 0;
+  uint64_t packed_wire = 0;
+  uint64_t compress_cycles = 0;
+  uint64_t decompress_cycles = 0;
+
+  xSemaphoreTake(link.codec_lock, portMAX_DELAY);
+  for (uint32_t it = 0; it < iterations; ++it) {
+    for (size_t i = 0; i < kSampleCount; ++i) {
+      const size_t len = strlen(kSamples[i]);
+      const uint32_t start = esp_cpu_get_cycle_count();
+      packed_len[i] = link_codec::compress(reinterpret_cast<const uint8_t*>(kSamples[i]), len, packed[i],
+                                           sizeof(packed[i]), &link.codec_workspace);
+      compress_cycles += esp_cpu_get_cycle_count() - start;
+    }
+  }
+  xSemaphoreGive(link.codec_lock);
+
+  for (size_t i = 0; i < kSampleCount; ++i) {
+    const size_t len = strlen(kSamples[i]);
+    const size_t frames = (len + UART_LINK_MAX_PAYLOAD - 1) / UART_LINK_MAX_PAYLOAD;
+    raw_total += len;
+    plain_wire += len + frames * LinkStats::kFrameOverhead;
+    if (!packed_len[i]) {
+      packed_total += len;
+      packed_wire += len + frames * LinkStats::kFrameOverhead;
+      continue;
+    }
+    packed_total += packed_len[i];
+    packed_wire += packed_len[i] + LinkStats::kFrameOverhead;
+    for (uint32_t it = 0; it < iterations; ++it) {
+      link_codec::Decoder decoder;
+      const uint32_t start = esp_cpu_get_cycle_count();
+      decoder.begin(plain, sizeof(plain));
+      decoder.feed(packed[i], packed_len[i]);
+      decompress_cycles += esp_cpu_get_cycle_count() - start;
+    }
+  }
+
+  const uint64_t raw_kb_x_iter = static_cast<uint64_t>(raw_total) * iterations;
+  const uint32_t wire_bps = CONFIG_APP_UART_LINK_UART_BAUDRATE / 10;  // 8N1
+  out_result->iterations = iterations;
+  out_result->frames = kSampleCount;
+  out_result->raw_bytes = raw_total;
+  out_result->compressed_bytes = packed_total;
+  out_result->compress_cycles_per_kb = static_cast<uint32_t>(compress_cycles * 1024 / raw_kb_x_iter);
+  out_result->decompress_cycles_per_kb = static_cast<uint32_t>(decompress_cycles * 1024 / raw_kb_x_iter);
+  out_result->plain_payload_bps = static_cast<uint32_t>(static_cast<uint64_t>(wire_bps) * raw_total / plain_wire);
+  out_result->compressed_payload_bps = static_cast<uint32_t>(static_cast<uint64_t>(wire_bps) * raw_total / packed_wire);
+  out_result->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+  return ESP_OK;
+}
+
+esp_err_t uart_link_flash_stress(uint32_t duration_ms, uart_link_stress_t* out_result) {
+  if (!out_result || duration_ms == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  // Static: a worker that misses the deadline below still points at it.
+  static StressRun run;
+  if (run.done && run.link) {
+    return ESP_ERR_INVALID_STATE;  // an earlier run's workers never finished
+  }
+  if (!run.done) {
+    run.done = xSemaphoreCreateCounting(2, 0);
+    if (!run.done) {
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  Link& link = s_links[UART_LINK_PRIMARY];
+  const bool was_suspended = s_suspended;
+  uart_link_suspend();
+  // The RX task looks at the flag between reads of at most 100 ms; the TX task after each frame.
+  vTaskDelay(pdMS_TO_TICKS(150));
+  uart_set_loop_back(link.port(), true);
+  uart_flush_input(link.port());
+  xQueueReset(link.uart_events);
+
+  run.link = &link;
+  run.stop = false;
+  run.result = {};
+  run.parse_cycles = 0;
+  esp_err_t err = ESP_OK;
+  int workers = 0;
+  if (xTaskCreate(stress_rx_task, "zb_stress_rx", kTaskStackSize, &run, 5, nullptr) == pdPASS) {
+    ++workers;
+  } else {
+    err = ESP_ERR_NO_MEM;
+  }
+  if (err == ESP_OK && xTaskCreate(stress_flash_task, "zb_stress_nvs", kTaskStackSize, &run, 3, nullptr) == pdPASS) {
+    ++workers;
+  } else {
+    err = ESP_ERR_NO_MEM;
+  }
+
+  uart_link_frame_t frame = {};
+  frame.type = kStressFrameType;
+  frame.payload_len = kStressPayload;
+  uint8_t encoded[UART_LINK_MAX_PAYLOAD + 8];
+  const int64_t start_us = esp_timer_get_time();
+  while (err == ESP_OK && esp_timer_get_time() - start_us < static_cast<int64_t>(duration_ms) * 1000) {
+    frame.seq = static_cast<uint8_t>(run.result.frames_sent);
+    memset(frame.payload, frame.seq, kStressPayload);
+    const size_t len = uart_link_encode_frame(encoded, sizeof(encoded), &frame);
+    // Blocks while the driver's TX buffer is full, which paces the loop to the baud rate.
+    if (uart_write_bytes(link.port(), reinterpret_cast<const char*>(encoded), len) == static_cast<int>(len)) {
+      run.result.frames_sent++;
+    }
+  }
+  uart_wait_tx_done(link.port(), pdMS_TO_TICKS(500));
+  vTaskDelay(pdMS_TO_TICKS(50));  // let the reader take the last bytes
+  run.stop = true;
+  bool finished = true;
+  for (int i = 0; i < workers; ++i) {
+    finished = xSemaphoreTake(run.done, pdMS_TO_TICKS(2000)) == pdTRUE && finished;
+  }
+
+  uart_set_loop_back(link.port(), false);
+  uart_flush_input(link.port());
+  xQueueReset(link.uart_events);
+  if (!was_suspended) {
+    uart_link_resume();
+  }
+  if (!finished) {
+    return ESP_ERR_TIMEOUT;
+  }
+  run.link = nullptr;
+  if (err != ESP_OK) {
+    return err;
+  }
+  *out_result = run.result;
+  out_result->duration_ms = duration_ms;
+  out_result->baud = CONFIG_APP_UART_LINK_UART_BAUDRATE;
+  out_result->iram_profile = kIramProfile;
+  out_result->frames_lost =
+      run.result.frames_sent > run.result.frames_received ? run.result.frames_sent - run.result.frames_received : 0;
+  out_result->avg_parse_cycles =
+      run.result.frames_received ? static_cast<uint32_t>(run.parse_cycles / run.result.frames_received) : 0;
+  out_result->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+  return ESP_OK;
+}
+
+esp_err_t uart_link_register_frame_handler(uint8_t type, uart_link_frame_handler_t handler, void* ctx) {
+  if (!handler || (type & link_codec::kCompressedFlag)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (FrameHandler& slot : s_frame_handlers) {
+    if (!slot.fn || slot.type == type) {
+      slot.type = type;
+      slot.ctx = ctx;
+      slot.fn = handler;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t uart_link_send_frame(uint8_t type, const void* payload, size_t len) {
+  return uart_link_send_frame_on(UART_LINK_PRIMARY, type, payload, len);
+}
+
+esp_err_t uart_link_send_frame_on(uint8_t index, uint8_t type, const void* payload, size_t len) {
+  // Suspended links are not ours to write to: zb_stress has the primary UART in loopback.
+  if (!s_initialized || s_suspended) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (index >= kLinkCount || (len && !payload) || len > link_codec::kMaxDecoded ||
+      (type & link_codec::kCompressedFlag)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return send_frame(s_links[index], static_cast<uart_link_msg_type_t>(type),
+                    static_cast<const uint8_t*>(payload), static_cast<uint16_t>(len));
+}
+
+esp_err_t uart_link_channel_send(uart_link_channel_t channel, uint8_t type, const void* payload, size_t len,
+                                 uint32_t timeout_ms) {
+  return uart_link_channel_send_on(UART_LINK_PRIMARY, channel, type, payload, len, timeout_ms);
+}
+
+esp_err_t uart_link_channel_send_on(uint8_t index, uart_link_channel_t channel, uint8_t type, const void* payload,
+                                    size_t len, uint32_t timeout_ms) {
+  if (!s_initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (index >= kLinkCount || channel >= UART_LINK_CHANNEL_COUNT || (len && !payload) ||
+      (type & link_codec::kCompressedFlag) || type == UART_LINK_MSG_CHANNEL_DATA ||
+      type == UART_LINK_MSG_CHANNEL_CREDIT) {
+    return ESP_ERR_INVALID_ARG;
   }
-  const int64_t deadline = esp_timer_get_time() + static_cast<int64_t>(timeout_ms) * 1000;
+  Link& link = s_links[index];
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
   while (true) {
-    if (s_handshake.received) {
-      result = s_handshake.ok ? ESP_OK : ESP_FAIL;
-      DEBUG_FUNC_EXIT_RC(result);
-      return result;
-    }
-    const int64_t now = esp_timer_get_time();
-    if (!s_handshake.ok && (now - s_handshake.last_sent_us) >= kHandshakeRetryIntervalUs) {
-      ESP_LOGI(kTag, "Startup check: retrying handshake frame");
-      send_handshake_frame();
-    }
-    if (now >= deadline) {
-      DEBUG_FUNC_EXIT_RC(ESP_ERR_TIMEOUT);
+    xEventGroupClearBits(link.events, kTxSpaceBit);
+    xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+    const uint16_t limit = link.channels.max_message() < kMaxMessage ? link.channels.max_message() : kMaxMessage;
+    const bool fits = len <= limit;
+    const bool queued = fits && link.channels.enqueue(channel, type, static_cast<const uint8_t*>(payload),
+                                                      static_cast<uint16_t>(len), now_us32());
+    xSemaphoreGive(link.channel_lock);
+    if (!fits) {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    if (queued) {
+      wake_tx(link);
+      return ESP_OK;
+    }
+    const TickType_t waited = xTaskGetTickCount() - start;
+    if (waited >= timeout) {
       return ESP_ERR_TIMEOUT;
     }
-    vTaskDelay(pdMS_TO_TICKS(kHandshakePollDelayMs));
+    // Short slices: another sender may clear the bit between the TX task setting it and this wait.
+    const TickType_t slice = pdMS_TO_TICKS(20) ? pdMS_TO_TICKS(20) : 1;
+    xEventGroupWaitBits(link.events, kTxSpaceBit, pdFALSE, pdFALSE,
+                        timeout - waited < slice ? timeout - waited : slice);
+  }
+}
+
+esp_err_t uart_link_get_channel_stats(uart_link_channel_t channel, uart_link_channel_stats_t* out_stats) {
+  return uart_link_get_channel_stats_on(UART_LINK_PRIMARY, channel, out_stats);
+}
+
+esp_err_t uart_link_get_channel_stats_on(uint8_t index, uart_link_channel_t channel,
+                                         uart_link_channel_stats_t* out_stats) {
+  if (!out_stats || index >= kLinkCount || channel >= UART_LINK_CHANNEL_COUNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  Link& link = s_links[index];
+  if (!link.channel_lock) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+  const ChannelScheduler::ChannelStats& stats = link.channels.stats(channel);
+  out_stats->messages_tx = stats.messages;
+  out_stats->fragments_tx = stats.fragments;
+  out_stats->bytes_tx = stats.bytes;
+  out_stats->refused = stats.refused;
+  out_stats->dropped = stats.dropped;
+  out_stats->credit_stalls = stats.credit_stalls;
+  out_stats->last_wait_us = stats.last_wait_us;
+  out_stats->max_wait_us = stats.max_wait_us;
+  out_stats->queued_bytes = link.channels.queued_bytes(channel);
+  out_stats->credits = link.channels.credits(channel);
+  xSemaphoreGive(link.channel_lock);
+  // Written by the RX task only; a torn read is off by one message at worst.
+  out_stats->messages_rx = link.reassemblers[channel].messages();
+  out_stats->messages_rx_dropped = link.reassemblers[channel].dropped();
+  return ESP_OK;
+}
+
+void uart_link_reset_channel_stats(void) {
+  for (Link& link : s_links) {
+    if (!link.channel_lock) {
+      continue;
+    }
+    xSemaphoreTake(link.channel_lock, portMAX_DELAY);
+    link.channels.reset_stats();
+    xSemaphoreGive(link.channel_lock);
   }
 }
 
+uart_link_state_t uart_link_get_state(void) {
+  return uart_link_get_state_on(UART_LINK_PRIMARY);
+}
+
+uart_link_state_t uart_link_get_state_on(uint8_t index) {
+  Link* link = link_at(index);
+  if (!link) {
+    return UART_LINK_STATE_DOWN;
+  }
+  portENTER_CRITICAL(&link->lock);
+  const LinkStateMachine::State state = link->fsm.state();
+  portEXIT_CRITICAL(&link->lock);
+  return static_cast<uart_link_state_t>(state);
+}
+
 void uart_link_set_debug(bool enable) {
   s_debug_frames = enable;
-  s_stats.debug_enabled = enable;
+  for (Link& link : s_links) {
+    portENTER_CRITICAL(&link.lock);
+    link.status.debug_enabled = enable;
+    portEXIT_CRITICAL(&link.lock);
+  }
   ESP_LOGI(kTag, "UART debug logging %s", enable ? "enabled" : "disabled");
 }
 
@@ -515,14 +1751,42 @@ bool uart_link_is_debug_enabled(void) {
 }
 
 bool uart_link_handshake_ok(void) {
-  return s_handshake.ok;
+  return uart_link_handshake_ok_on(UART_LINK_PRIMARY);
+}
+
+bool uart_link_handshake_ok_on(uint8_t index) {
+  const Link* link = link_at(index);
+  return link && link->handshake.ok;
 }
 
 esp_err_t uart_link_send_manual_handshake(void) {
-  ESP_LOGI(kTag, "Manual handshake requested");
-  ESP_LOGI(kTag, "UART Config: TX Pin: %d, RX Pin: %d", CONFIG_APP_UART_LINK_UART_TX_PIN,
-           CONFIG_APP_UART_LINK_UART_RX_PIN);
-  return send_handshake_frame();
+  if (s_suspended) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_err_t result = ESP_OK;
+  for (Link& link : s_links) {
+    ESP_LOGI(link.tag(), "Manual handshake requested");
+    ESP_LOGI(link.tag(), "UART Config: TX Pin: %d, RX Pin: %d", kPorts[link.index].tx_pin, kPorts[link.index].rx_pin);
+    const esp_err_t err = send_handshake_frame(link);
+    if (result == ESP_OK) {
+      result = err;
+    }
+  }
+  return result;
+}
+
+esp_err_t uart_link_register_event_cb(uart_link_event_cb_t cb, void* ctx) {
+  if (!cb) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (EventListener& listener : s_event_listeners) {
+    if (!listener.cb || listener.cb == cb) {
+      listener.ctx = ctx;
+      listener.cb = cb;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
 }
 
 #else
@@ -531,12 +1795,62 @@ esp_err_t uart_link_init(void) {
   return ESP_OK;
 }
 
+uint8_t uart_link_count(void) {
+  return 0;
+}
+
+int uart_link_current(void) {
+  return -1;
+}
+
 void uart_link_get_stats(uart_link_stats_t* out_stats) {
   if (out_stats) {
     memset(out_stats, 0, sizeof(*out_stats));
   }
 }
 
+void uart_link_get_stats_on(uint8_t index, uart_link_stats_t* out_stats) {
+  (void)index;
+  uart_link_get_stats(out_stats);
+}
+
+void uart_link_get_metrics(uart_link_metrics_t* out_metrics) {
+  if (out_metrics) {
+    memset(out_metrics, 0, sizeof(*out_metrics));
+  }
+}
+
+void uart_link_get_metrics_on(uint8_t index, uart_link_metrics_t* out_metrics) {
+  (void)index;
+  uart_link_get_metrics(out_metrics);
+}
+
+void uart_link_reset_metrics(void) {
+}
+
+void uart_link_get_latency(uart_link_latency_t* out_latency) {
+  if (out_latency) {
+    memset(out_latency, 0, sizeof(*out_latency));
+  }
+}
+
+void uart_link_get_latency_on(uint8_t index, uart_link_latency_t* out_latency) {
+  (void)index;
+  uart_link_get_latency(out_latency);
+}
+
+void uart_link_reset_latency(void) {}
+
+void uart_link_record_hop(uart_link_hop_t hop, uint32_t us) {
+  (void)hop;
+  (void)us;
+}
+
+bool uart_link_frame_stamp(uart_link_stamp_t* out_stamp) {
+  (void)out_stamp;
+  return false;
+}
+
 void uart_link_print_status(void) {
 }
 
@@ -568,8 +1882,153 @@ bool uart_link_handshake_ok(void) {
   return false;
 }
 
+bool uart_link_handshake_ok_on(uint8_t index) {
+  (void)index;
+  return false;
+}
+
 esp_err_t uart_link_send_manual_handshake(void) {
   return ESP_ERR_NOT_SUPPORTED;
 }
 
+esp_err_t uart_link_register_event_cb(uart_link_event_cb_t cb, void* ctx) {
+  (void)cb;
+  (void)ctx;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+uart_link_state_t uart_link_get_state(void) {
+  return UART_LINK_STATE_DOWN;
+}
+
+uart_link_state_t uart_link_get_state_on(uint8_t index) {
+  (void)index;
+  return UART_LINK_STATE_DOWN;
+}
+
+esp_err_t uart_link_register_frame_handler(uint8_t type, uart_link_frame_handler_t handler, void* ctx) {
+  (void)type;
+  (void)handler;
+  (void)ctx;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_link_send_frame(uint8_t type, const void* payload, size_t len) {
+  (void)type;
+  (void)payload;
+  (void)len;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_link_send_frame_on(uint8_t index, uint8_t type, const void* payload, size_t len) {
+  (void)index;
+  return uart_link_send_frame(type, payload, len);
+}
+
+esp_err_t uart_link_codec_benchmark(uint32_t iterations, uart_link_codec_bench_t* out_result) {
+  (void)iterations;
+  (void)out_result;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_link_flash_stress(uint32_t duration_ms, uart_link_stress_t* out_result) {
+  (void)duration_ms;
+  (void)out_result;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_link_channel_send(uart_link_channel_t channel, uint8_t type, const void* payload, size_t len,
+                                 uint32_t timeout_ms) {
+  (void)channel;
+  (void)type;
+  (void)payload;
+  (void)len;
+  (void)timeout_ms;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_link_channel_send_on(uint8_t index, uart_link_channel_t channel, uint8_t type, const void* payload,
+                                    size_t len, uint32_t timeout_ms) {
+  (void)index;
+  return uart_link_channel_send(channel, type, payload, len, timeout_ms);
+}
+
+esp_err_t uart_link_get_channel_stats(uart_link_channel_t channel, uart_link_channel_stats_t* out_stats) {
+  (void)channel;
+  (void)out_stats;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_link_get_channel_stats_on(uint8_t index, uart_link_channel_t channel,
+                                         uart_link_channel_stats_t* out_stats) {
+  (void)index;
+  return uart_link_get_channel_stats(channel, out_stats);
+}
+
+void uart_link_reset_channel_stats(void) {}
+
 #endif  // CONFIG_APP_ENABLE_UART_LINK
+
+const char* uart_link_channel_name(uint8_t channel) {
+  switch (channel) {
+    case UART_LINK_CHANNEL_COMMAND:
+      return "command";
+    case UART_LINK_CHANNEL_EVENT:
+      return "event";
+    case UART_LINK_CHANNEL_BULK:
+      return "bulk";
+    default:
+      return "?";
+  }
+}
+
+const char* uart_link_hop_name(uint8_t hop) {
+  switch (hop) {
+    case UART_LINK_HOP_H2_RX:
+      return "h2_rx";
+    case UART_LINK_HOP_LINK_UP:
+      return "link_up";
+    case UART_LINK_HOP_DISPATCH:
+      return "dispatch";
+    case UART_LINK_HOP_HUB:
+      return "hub";
+    case UART_LINK_HOP_LINK_DOWN:
+      return "link_down";
+    case UART_LINK_HOP_H2_TX:
+      return "h2_tx";
+    default:
+      return "?";
+  }
+}
+
+const char* uart_link_peer_state_name(uint8_t state) {
+  switch (state) {
+    case UART_LINK_PEER_UNKNOWN:
+      return "unknown";
+    case UART_LINK_PEER_ALIVE:
+      return "alive";
+    case UART_LINK_PEER_QUIET:
+      return "quiet";
+    case UART_LINK_PEER_DEAD:
+      return "dead";
+    default:
+      return "?";
+  }
+}
+
+const char* uart_link_state_name(uint8_t state) {
+  switch (state) {
+    case UART_LINK_STATE_DOWN:
+      return "DOWN";
+    case UART_LINK_STATE_HELLO:
+      return "HELLO";
+    case UART_LINK_STATE_HANDSHAKING:
+      return "HANDSHAKING";
+    case UART_LINK_STATE_UP:
+      return "UP";
+    case UART_LINK_STATE_DEGRADED:
+      return "DEGRADED";
+    default:
+      return "?";
+  }
+}
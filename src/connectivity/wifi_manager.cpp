@@ -4,21 +4,105 @@
 
 #define DEBUG_TAG "WIFI_MGR"
 #include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/Histogram.h"
+#include "../debug/include/debug/MemBudget.h"
+#include "../debug/include/debug/StaticAlloc.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
+#include "sdkconfig.h"
+#include "wifi_ps_policy.h"
+
+#ifndef CONFIG_APP_WIFI_PS_IDLE_MS
+#define CONFIG_APP_WIFI_PS_IDLE_MS 2000
+#endif
+#ifndef CONFIG_APP_WIFI_PS_SLEEP_MS
+#define CONFIG_APP_WIFI_PS_SLEEP_MS 30000
+#endif
 
 static const char* TAG = DEBUG_TAG;
 
 static bool s_is_connected = false;
 static bool s_retry_enabled = true;
 
+/* Scan results are printed from here rather than allocated per scan; further APs are only counted. */
+static const uint16_t kMaxScanResults = 20;
+static wifi_ap_record_t s_scan_results[kMaxScanResults];
+
+/* Power save: the policy picks the mode, these apply it. Every access holds s_ps_mutex. */
+static_assert(static_cast<int>(WifiPsPolicy::Mode::kNone) == WIFI_PS_NONE &&
+                  static_cast<int>(WifiPsPolicy::Mode::kMin) == WIFI_PS_MIN_MODEM &&
+                  static_cast<int>(WifiPsPolicy::Mode::kMax) == WIFI_PS_MAX_MODEM,
+              "policy modes index like wifi_ps_type_t");
+static_assert(WifiPsPolicy::kModeCount == WIFI_MANAGER_PS_MODES, "one residency slot per mode");
+static WifiPsPolicy s_ps;
+static debug::StaticMutex s_ps_mutex_storage;
+static SemaphoreHandle_t s_ps_mutex = nullptr;
+static esp_timer_handle_t s_ps_timer = nullptr;
+static uint32_t s_ps_timer_due_ms = 0;
+static debug::Histogram<> s_command_latency_us[WIFI_MANAGER_PS_MODES];
+
+// The WiFi driver refuses WIFI_PS_NONE while the BT controller shares the radio.
+#if CONFIG_BT_ENABLED
+static const WifiPsPolicy::Mode kPsFloor = WifiPsPolicy::Mode::kMin;
+#else
+static const WifiPsPolicy::Mode kPsFloor = WifiPsPolicy::Mode::kNone;
+#endif
+
+static uint32_t now_ms(void) {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+/* Caller holds s_ps_mutex. Applies a changed mode and arms the timer for the next idle step. */
+static void ps_apply(const WifiPsPolicy::Decision& decision, uint32_t now) {
+  if (decision.changed) {
+    const esp_err_t err = esp_wifi_set_ps(static_cast<wifi_ps_type_t>(decision.mode));
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Failed to set power save mode %d: %s", static_cast<int>(decision.mode), esp_err_to_name(err));
+      s_ps.rejected(decision);
+    }
+  }
+  if (!decision.next_poll_ms) {
+    return;
+  }
+  // A later deadline keeps the armed timer: it fires early and the poll re-arms it. An
+  // earlier one (shorter idle times, auto after a forced mode) replaces it.
+  const uint32_t due = now + decision.next_poll_ms;
+  if (esp_timer_is_active(s_ps_timer)) {
+    if (static_cast<int32_t>(due - s_ps_timer_due_ms) >= 0) {
+      return;
+    }
+    esp_timer_stop(s_ps_timer);
+  }
+  s_ps_timer_due_ms = due;
+  esp_timer_start_once(s_ps_timer, static_cast<uint64_t>(decision.next_poll_ms) * 1000);
+}
+
+template <typename Fn>
+static void ps_update(Fn&& fn) {
+  if (!s_ps_mutex) {
+    return;
+  }
+  xSemaphoreTake(s_ps_mutex, portMAX_DELAY);
+  const uint32_t now = now_ms();
+  fn(now);
+  ps_apply(s_ps.poll(now), now);
+  xSemaphoreGive(s_ps_mutex);
+}
+
+static void ps_timer_cb(void*) {
+  ps_update([](uint32_t) {});
+}
+
 /* Signal for WiFi events */
 static void event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
+  DEBUG_PROFILE();
   if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
     ESP_LOGI(TAG, "WiFi Started");
     esp_wifi_connect();
@@ -41,20 +125,21 @@ static void event_handler(void* arg, esp_event_base_t event_base, int32_t event_
     ESP_LOGI(TAG, "Scan done. Found %d APs.", number);
 
     if (number > 0) {
-      wifi_ap_record_t* ap_info = (wifi_ap_record_t*)malloc(sizeof(wifi_ap_record_t) * number);
-      if (ap_info != NULL) {
-        esp_err_t err = esp_wifi_scan_get_ap_records(&number, ap_info);
-        if (err == ESP_OK) {
-          for (int i = 0; i < number; i++) {
-            ESP_LOGI(TAG, "SSID: %-32s | RSSI: %d | Ch: %d | Auth: %d", ap_info[i].ssid, ap_info[i].rssi,
-                     ap_info[i].primary, ap_info[i].authmode);
-          }
-        } else {
-          ESP_LOGE(TAG, "Failed to get AP records: %s", esp_err_to_name(err));
+      const uint16_t found = number;
+      if (number > kMaxScanResults) {
+        number = kMaxScanResults;
+      }
+      esp_err_t err = esp_wifi_scan_get_ap_records(&number, s_scan_results);
+      if (err == ESP_OK) {
+        for (int i = 0; i < number; i++) {
+          ESP_LOGI(TAG, "SSID: %-32s | RSSI: %d | Ch: %d | Auth: %d", s_scan_results[i].ssid, s_scan_results[i].rssi,
+                   s_scan_results[i].primary, s_scan_results[i].authmode);
+        }
+        if (found > number) {
+          ESP_LOGI(TAG, "(%d more not shown)", found - number);
         }
-        free(ap_info);
       } else {
-        ESP_LOGE(TAG, "Failed to allocate memory for scan results");
+        ESP_LOGE(TAG, "Failed to get AP records: %s", esp_err_to_name(err));
       }
     }
   }
@@ -77,11 +162,35 @@ esp_err_t wifi_manager_init(void) {
   wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
   ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
-  // Use MAX_MODEM power save for improved station stability
-  ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MAX_MODEM));
+  WifiPsPolicy::Config ps_config;
+  ps_config.idle_ms = CONFIG_APP_WIFI_PS_IDLE_MS;
+  ps_config.sleep_ms = CONFIG_APP_WIFI_PS_SLEEP_MS;
+  ps_config.floor = kPsFloor;
+  // esp_wifi_init() leaves the station in MIN_MODEM; the first poll moves it from there.
+  s_ps = WifiPsPolicy(ps_config, now_ms(), WifiPsPolicy::Mode::kMin);
+#ifndef CONFIG_APP_WIFI_PS_ADAPTIVE
+  // Fixed MAX_MODEM, as before the adaptive policy; `wifi_ps auto` still enables it.
+  s_ps.set_manual(WifiPsPolicy::Mode::kMax);
+#endif
+  const esp_timer_create_args_t ps_timer_args = {
+      .callback = &ps_timer_cb,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "wifi_ps",
+      .skip_unhandled_events = true,
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&ps_timer_args, &s_ps_timer));
+  s_ps_mutex = s_ps_mutex_storage.create(MEM_BUDGET_NET);
+  if (!s_ps_mutex) {
+    DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+    return ESP_ERR_NO_MEM;
+  }
+  ps_update([](uint32_t) {});
 
   ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL));
   ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL));
+  mem_budget_charge(MEM_BUDGET_NET, MEM_BUDGET_BUFFER, sizeof(s_scan_results), false);
+  mem_budget_charge(MEM_BUDGET_NET, MEM_BUDGET_BUFFER, sizeof(s_command_latency_us), false);
 
   DEBUG_FUNC_EXIT();
   return ESP_OK;
@@ -154,10 +263,13 @@ esp_err_t wifi_manager_set_credentials(const char* ssid, const char* password) {
 
 esp_err_t wifi_manager_scan(void) {
   DEBUG_FUNC_ENTER();
-  // Disable retry mechanism to prevent interference with the scan
-  s_retry_enabled = false;
-  esp_wifi_disconnect();
-  vTaskDelay(pdMS_TO_TICKS(100));  // Allow time for disconnection
+  // A connected station scans between beacons and keeps its link. Only a station still
+  // retrying is stopped, since each retry would abort the scan.
+  if (!s_is_connected) {
+    s_retry_enabled = false;
+    esp_wifi_disconnect();
+    vTaskDelay(pdMS_TO_TICKS(100));  // Allow time for disconnection
+  }
 
   wifi_scan_config_t scan_config = {};
   scan_config.show_hidden = true;
@@ -173,3 +285,102 @@ esp_err_t wifi_manager_scan(void) {
   DEBUG_FUNC_EXIT_RC(err);
   return err;
 }
+
+void wifi_manager_note_activity(void) {
+  ps_update([](uint32_t now) { s_ps.activity(now); });
+}
+
+wifi_manager_command_t wifi_manager_command_begin(void) {
+  wifi_manager_command_t command = {esp_timer_get_time(), WIFI_PS_NONE};
+  ps_update([&command](uint32_t now) {
+    // The mode the request arrived in is the one that delayed it.
+    command.ps_mode = static_cast<uint8_t>(s_ps.mode());
+    s_ps.command_begin(now);
+  });
+  return command;
+}
+
+void wifi_manager_command_end(const wifi_manager_command_t* command) {
+  if (!command) {
+    return;
+  }
+  const int64_t elapsed_us = esp_timer_get_time() - command->start_us;
+  if (command->ps_mode < WIFI_MANAGER_PS_MODES) {
+    s_command_latency_us[command->ps_mode].record(elapsed_us > UINT32_MAX ? UINT32_MAX
+                                                                          : static_cast<uint32_t>(elapsed_us));
+  }
+  ps_update([](uint32_t now) { s_ps.command_end(now); });
+}
+
+void wifi_manager_pin_low_latency(bool pin) {
+  ps_update([pin](uint32_t now) { s_ps.pin(pin, now); });
+}
+
+esp_err_t wifi_manager_force_ps(uint8_t mode) {
+  if (mode >= WIFI_MANAGER_PS_MODES) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_ps_mutex) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  ps_update([mode](uint32_t) { s_ps.set_manual(static_cast<WifiPsPolicy::Mode>(mode)); });
+  return ESP_OK;
+}
+
+esp_err_t wifi_manager_auto_ps(void) {
+  if (!s_ps_mutex) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  ps_update([](uint32_t now) { s_ps.clear_manual(now); });
+  return ESP_OK;
+}
+
+esp_err_t wifi_manager_set_ps_profile(uint32_t idle_ms, uint32_t sleep_ms) {
+  if (!s_ps_mutex) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  WifiPsPolicy::Config config;
+  config.idle_ms = idle_ms;
+  config.sleep_ms = sleep_ms;
+  config.floor = kPsFloor;
+  ps_update([&config](uint32_t) { s_ps.set_config(config); });
+  return ESP_OK;
+}
+
+uint8_t wifi_manager_ps_floor(void) {
+  return static_cast<uint8_t>(kPsFloor);
+}
+
+void wifi_manager_get_ps_stats(wifi_manager_ps_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  *out_stats = {};
+  if (!s_ps_mutex) {
+    return;
+  }
+  xSemaphoreTake(s_ps_mutex, portMAX_DELAY);
+  const WifiPsPolicy::Stats stats = s_ps.stats(now_ms());
+  out_stats->adaptive = !s_ps.manual();
+  out_stats->mode = static_cast<uint8_t>(s_ps.mode());
+  xSemaphoreGive(s_ps_mutex);
+  out_stats->pins = stats.pins;
+  out_stats->pending = stats.pending;
+  out_stats->switches = stats.switches;
+  out_stats->rejected = stats.rejected;
+  for (int i = 0; i < WIFI_MANAGER_PS_MODES; ++i) {
+    out_stats->residency_ms[i] = stats.residency_ms[i];
+    const auto summary = s_command_latency_us[i].summarize();
+    out_stats->latency[i].count = summary.count;
+    out_stats->latency[i].p50_us = summary.p50;
+    out_stats->latency[i].p90_us = summary.p90;
+    out_stats->latency[i].max_us = summary.max;
+  }
+}
+
+void wifi_manager_reset_ps_stats(void) {
+  for (auto& histogram : s_command_latency_us) {
+    histogram.reset();
+  }
+  ps_update([](uint32_t now) { s_ps.reset_stats(now); });
+}
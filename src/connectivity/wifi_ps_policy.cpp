@@ -0,0 +1,116 @@
+#include "wifi_ps_policy.h"
+
+WifiPsPolicy::WifiPsPolicy(const Config& config, uint32_t now_ms, Mode applied)
+    : config_(config), applied_(applied), last_activity_ms_(now_ms), applied_since_ms_(now_ms) {}
+
+void WifiPsPolicy::activity(uint32_t now_ms) {
+  last_activity_ms_ = now_ms;
+}
+
+void WifiPsPolicy::command_begin(uint32_t now_ms) {
+  ++pending_;
+  activity(now_ms);
+}
+
+void WifiPsPolicy::command_end(uint32_t now_ms) {
+  if (pending_) {
+    --pending_;
+  }
+  activity(now_ms);
+}
+
+void WifiPsPolicy::pin(bool on, uint32_t now_ms) {
+  if (on) {
+    ++pins_;
+  } else if (pins_) {
+    --pins_;
+  }
+  // An ended session gets the same idle window as any other traffic.
+  activity(now_ms);
+}
+
+void WifiPsPolicy::set_manual(Mode mode) {
+  manual_ = true;
+  manual_mode_ = mode;
+}
+
+void WifiPsPolicy::clear_manual(uint32_t now_ms) {
+  manual_ = false;
+  activity(now_ms);
+}
+
+void WifiPsPolicy::set_config(const Config& config) {
+  config_ = config;
+}
+
+WifiPsPolicy::Mode WifiPsPolicy::desired(uint32_t now_ms, uint32_t* next_poll_ms) const {
+  *next_poll_ms = 0;
+  if (manual_) {
+    return manual_mode_;
+  }
+  if (pins_ || pending_) {
+    return Mode::kNone;
+  }
+  const uint32_t idle = now_ms - last_activity_ms_;
+  if (idle < config_.idle_ms) {
+    *next_poll_ms = config_.idle_ms - idle;
+    return Mode::kNone;
+  }
+  if (config_.sleep_ms == 0) {
+    return Mode::kMin;
+  }
+  if (idle < config_.sleep_ms) {
+    *next_poll_ms = config_.sleep_ms - idle;
+    return Mode::kMin;
+  }
+  return Mode::kMax;
+}
+
+WifiPsPolicy::Decision WifiPsPolicy::poll(uint32_t now_ms) {
+  Decision decision;
+  decision.mode = desired(now_ms, &decision.next_poll_ms);
+  if (decision.mode < config_.floor) {
+    decision.mode = config_.floor;
+  }
+  decision.previous = applied_;
+  decision.changed = decision.mode != applied_;
+  if (decision.changed) {
+    residency_ms_[static_cast<int>(applied_)] += now_ms - applied_since_ms_;
+    applied_since_ms_ = now_ms;
+    applied_ = decision.mode;
+    ++switches_;
+  }
+  return decision;
+}
+
+void WifiPsPolicy::rejected(const Decision& decision) {
+  if (!decision.changed || applied_ != decision.mode) {
+    return;
+  }
+  // poll() closed the previous stretch at this instant; it simply carries on.
+  applied_ = decision.previous;
+  --switches_;
+  ++rejected_;
+}
+
+WifiPsPolicy::Stats WifiPsPolicy::stats(uint32_t now_ms) const {
+  Stats stats = {};
+  for (int i = 0; i < kModeCount; ++i) {
+    stats.residency_ms[i] = residency_ms_[i];
+  }
+  stats.residency_ms[static_cast<int>(applied_)] += now_ms - applied_since_ms_;
+  stats.switches = switches_;
+  stats.rejected = rejected_;
+  stats.pins = pins_;
+  stats.pending = pending_;
+  return stats;
+}
+
+void WifiPsPolicy::reset_stats(uint32_t now_ms) {
+  for (uint32_t& ms : residency_ms_) {
+    ms = 0;
+  }
+  switches_ = 0;
+  rejected_ = 0;
+  applied_since_ms_ = now_ms;
+}
@@ -0,0 +1,92 @@
+#ifndef WIFI_PS_POLICY_H_
+#define WIFI_PS_POLICY_H_
+
+#include <cstdint>
+
+/*
+ * Adaptive WiFi power save: which modem sleep mode the station should be in.
+ *
+ * - Interactive traffic, a pending command or a low-latency pin holds kNone, so inbound
+ *   frames are not held back until the next DTIM beacon.
+ * - idle_ms after the last activity with nothing pending or pinned, the station drops to
+ *   kMin (wakes every DTIM); sleep_ms after it, to kMax (listen interval). sleep_ms 0
+ *   stays at kMin.
+ * - A manual mode overrides all of the above until cleared.
+ * - A floor is the least power save the driver accepts (with BT enabled it refuses NONE);
+ *   every mode above, manual included, is raised to it.
+ * - A mode the driver refused is handed back with rejected(); the policy keeps accounting
+ *   the mode still in effect and asks again at the next poll.
+ *
+ * Time spent in each applied mode is accumulated for tuning. Pure logic; the caller
+ * supplies the clock and the locking and applies the mode it is told to.
+ */
+class WifiPsPolicy {
+ public:
+  enum class Mode : uint8_t { kNone, kMin, kMax };
+  static constexpr int kModeCount = 3;
+
+  struct Config {
+    uint32_t idle_ms = 2000;
+    uint32_t sleep_ms = 30000;
+    Mode floor = Mode::kNone;
+  };
+
+  struct Decision {
+    Mode mode;
+    Mode previous;          // applied before this poll; still in effect if the driver refuses mode
+    bool changed;           // differs from the mode applied before; apply it
+    uint32_t next_poll_ms;  // when the mode may change without new input; 0 = only on input
+  };
+
+  struct Stats {
+    uint32_t residency_ms[kModeCount];
+    uint32_t switches;
+    uint32_t rejected;
+    uint32_t pins;
+    uint32_t pending;
+  };
+
+  WifiPsPolicy() = default;
+  WifiPsPolicy(const Config& config, uint32_t now_ms, Mode applied);
+
+  void activity(uint32_t now_ms);
+  void command_begin(uint32_t now_ms);
+  void command_end(uint32_t now_ms);
+  void pin(bool on, uint32_t now_ms);
+  void set_manual(Mode mode);
+  void clear_manual(uint32_t now_ms);
+  // Takes effect at the next poll; the idle clock keeps running.
+  void set_config(const Config& config);
+
+  // Decide the mode for now and account it as applied from now on.
+  Decision poll(uint32_t now_ms);
+  // The driver refused a changed decision: account decision.previous as applied again.
+  void rejected(const Decision& decision);
+
+  Mode mode() const {
+    return applied_;
+  }
+  bool manual() const {
+    return manual_;
+  }
+  // Residency including the current stretch up to now_ms.
+  Stats stats(uint32_t now_ms) const;
+  void reset_stats(uint32_t now_ms);
+
+ private:
+  Mode desired(uint32_t now_ms, uint32_t* next_poll_ms) const;
+
+  Config config_;
+  Mode applied_ = Mode::kNone;
+  Mode manual_mode_ = Mode::kNone;
+  bool manual_ = false;
+  uint32_t last_activity_ms_ = 0;
+  uint32_t applied_since_ms_ = 0;
+  uint32_t pins_ = 0;
+  uint32_t pending_ = 0;
+  uint32_t residency_ms_[kModeCount] = {};
+  uint32_t switches_ = 0;
+  uint32_t rejected_ = 0;
+};
+
+#endif  // WIFI_PS_POLICY_H_
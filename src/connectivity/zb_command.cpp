@@ -0,0 +1,811 @@
+#include "include/zb_command.h"
+
+#include <cstddef>
+#include <cstring>
+
+#define DEBUG_TAG "ZB_CMD"
+#include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/StaticAlloc.h"
+#include "cmd_stager.h"
+#include "command_tracker.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "include/uart_link.h"
+#include "include/zb_devices.h"
+#include "include/zigbee_manager.h"
+#include "sdkconfig.h"
+
+#if CONFIG_APP_ENABLE_UART_LINK
+
+#ifndef CONFIG_APP_ZB_STAGE_RATE
+#define CONFIG_APP_ZB_STAGE_RATE 10
+#endif
+#ifndef CONFIG_APP_ZB_STAGE_BURST
+#define CONFIG_APP_ZB_STAGE_BURST 3
+#endif
+#ifndef CONFIG_APP_ZB_STAGE_FLUSH_MS
+#define CONFIG_APP_ZB_STAGE_FLUSH_MS 20
+#endif
+
+namespace {
+const char* kTag = DEBUG_TAG;
+
+constexpr uint32_t kQueueTimeoutMs = 100;  // same budget as uart_link_send_text()
+constexpr uint32_t kBenchTimeoutMs = 1000;
+constexpr uint32_t kStageSendTimeoutMs = 10;  // from the esp_timer task; keep it short
+constexpr size_t kStageBatch = 4;
+
+// Guards s_tracker and s_slot_link; the RX tasks complete slots, callers open, wait on and release them.
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+CommandTracker s_tracker;
+uint8_t s_slot_link[CommandTracker::kSlots] = {};  // network each request went out on
+EventGroupHandle_t s_done = nullptr;  // one bit per tracker slot
+debug::StaticEventGroup s_done_storage;
+
+// Guards s_stager and s_stage_send_errors.
+portMUX_TYPE s_stage_lock = portMUX_INITIALIZER_UNLOCKED;
+CommandStager s_stager;
+uint32_t s_stage_send_errors = 0;
+esp_timer_handle_t s_stage_timer = nullptr;
+// Held from taking commands out of s_stager until they are queued on the link, so a command
+// for a device never overtakes one released for it just before.
+SemaphoreHandle_t s_stage_send_lock = nullptr;
+debug::StaticMutex s_stage_send_lock_storage;
+CommandStager::Command s_flushed[CommandStager::kSlots];  // under s_stage_send_lock
+
+uint32_t now_us() {
+  return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+EventBits_t slot_bit(int slot) {
+  return static_cast<EventBits_t>(1u << slot);
+}
+
+void on_response(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  portENTER_CRITICAL(&s_lock);
+  const int slot = s_tracker.on_response(payload, len, now_us());
+  const uint32_t sent_us = s_tracker.sent_us(slot);
+  // A detached slot is free again already and may have a new owner by the time the bit is set.
+  const bool owned = s_tracker.state(slot) == CommandTracker::State::kDone;
+  portEXIT_CRITICAL(&s_lock);
+  if (slot < 0) {
+    return;
+  }
+  uart_link_stamp_t stamp;
+  if (uart_link_frame_stamp(&stamp) && stamp.synced) {
+    // 32-bit differences: both ends are within seconds of each other.
+    uart_link_record_hop(UART_LINK_HOP_LINK_DOWN, static_cast<uint32_t>(stamp.h2_rx_us) - sent_us);
+    uart_link_record_hop(UART_LINK_HOP_H2_TX, static_cast<uint32_t>(stamp.h2_tx_us - stamp.h2_rx_us));
+  }
+  if (owned) {
+    xEventGroupSetBits(s_done, slot_bit(slot));
+  }
+}
+
+void on_link_event(uart_link_event_t event, void*) {
+  const int link = uart_link_current();
+  if (event != UART_LINK_EVENT_STATE_CHANGED || link < 0) {
+    return;
+  }
+  const uart_link_state_t state = uart_link_get_state_on(static_cast<uint8_t>(link));
+  if (state == UART_LINK_STATE_UP || state == UART_LINK_STATE_DEGRADED) {
+    return;
+  }
+  // The H2 may have restarted; nothing in flight on its link will be answered.
+  const uint32_t now = now_us();
+  uint32_t failed = 0;
+  portENTER_CRITICAL(&s_lock);
+  for (int slot = 0; slot < CommandTracker::kSlots; ++slot) {
+    if (s_slot_link[slot] == link && s_tracker.fail(slot, ZB_CMD_STATUS_LINK_DOWN, now) &&
+        s_tracker.state(slot) == CommandTracker::State::kDone) {
+      failed |= slot_bit(slot);
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (failed) {
+    xEventGroupSetBits(s_done, static_cast<EventBits_t>(failed));
+  }
+}
+
+// network is a zb_devices network: a uart_link index or ZB_DEVICES_NATIVE.
+bool link_supported(uint8_t network) {
+  if (!zb_devices_network_valid(network)) {
+    return false;
+  }
+  if (network == ZB_DEVICES_NATIVE) {
+    return zigbee_manager_is_up();
+  }
+  uart_link_stats_t stats;
+  uart_link_get_stats_on(network, &stats);
+  return stats.handshake_ok && (stats.remote_flags & UART_LINK_HANDSHAKE_FLAG_TYPED_COMMANDS) != 0;
+}
+
+// Claims a slot and queues the request on the command channel of the network's link, or hands it
+// to the native network. Returns the slot, or -1 with *err set.
+int submit(uint8_t link, uint8_t command, const void* request, uint16_t len, bool detached, uint32_t timeout_ms,
+           esp_err_t* err) {
+  uint8_t frame[sizeof(zb_cmd_header_t) + sizeof(zb_cmd_any_request_t)];
+  zb_cmd_header_t header;
+  portENTER_CRITICAL(&s_lock);
+  const int slot = s_tracker.open(command, now_us(), &header, detached);
+  if (slot >= 0) {
+    s_slot_link[slot] = link;
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (slot < 0) {
+    *err = ESP_ERR_NO_MEM;
+    return -1;
+  }
+  if (!detached) {
+    xEventGroupClearBits(s_done, slot_bit(slot));
+  }
+  memcpy(frame, &header, sizeof(header));
+  if (len) {
+    memcpy(frame + sizeof(header), request, len);
+  }
+  if (link == ZB_DEVICES_NATIVE) {
+    *err = zigbee_manager_send_request(frame, sizeof(header) + len);
+  } else {
+    *err = uart_link_channel_send_on(link, UART_LINK_CHANNEL_COMMAND, UART_LINK_MSG_ZB_REQUEST, frame,
+                                     sizeof(header) + len, timeout_ms);
+  }
+  if (*err != ESP_OK) {
+    portENTER_CRITICAL(&s_lock);
+    if (detached && *err != ESP_ERR_TIMEOUT) {
+      // Nobody waits for it: the tracker counts it failed and frees the slot.
+      s_tracker.fail(slot, ZB_CMD_STATUS_LINK_DOWN, now_us());
+    } else {
+      s_tracker.release(slot);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return -1;
+  }
+  return slot;
+}
+
+// The command channel queue or every tracker slot was full; the command may go out later.
+bool retryable(esp_err_t err) {
+  return err == ESP_ERR_TIMEOUT || err == ESP_ERR_NO_MEM;
+}
+
+esp_err_t stage_send(uint8_t network, uint8_t command, const void* request, uint16_t len, uint32_t timeout_ms) {
+  esp_err_t err;
+  if (submit(network, command, request, len, true, timeout_ms, &err) >= 0) {
+    return ESP_OK;
+  }
+  ESP_LOGD(kTag, "Staged %s not sent: %s", zb_command_name(command), esp_err_to_name(err));
+  return err;
+}
+
+// Sends commands released from the stage in order. If one cannot go out for now, it and the
+// rest go back to the stage; returns false then.
+bool stage_send_released(const CommandStager::Command* commands, size_t count, uint32_t timeout_ms) {
+  for (size_t i = 0; i < count; ++i) {
+    const CommandStager::Command& command = commands[i];
+    const esp_err_t err = stage_send(command.network, command.command, command.body, command.len, timeout_ms);
+    if (err == ESP_OK) {
+      continue;
+    }
+    uint32_t lost = 0;
+    portENTER_CRITICAL(&s_stage_lock);
+    for (size_t j = retryable(err) ? i : i + 1; j < count; ++j) {
+      lost += s_stager.restage(commands[j]) ? 0 : 1;
+    }
+    s_stage_send_errors += lost + (retryable(err) ? 0 : 1);
+    portEXIT_CRITICAL(&s_stage_lock);
+    return false;
+  }
+  return true;
+}
+
+void arm_stage_timer() {
+  // One-shot: inactive while its callback runs, so a command staged meanwhile re-arms it.
+  // ESP_ERR_INVALID_STATE only means it is already armed.
+  esp_timer_start_once(s_stage_timer, CONFIG_APP_ZB_STAGE_FLUSH_MS * 1000);
+}
+
+void stage_tick(void*) {
+  // A caller is sending for the stage right now; look again next tick rather than block this task.
+  if (xSemaphoreTake(s_stage_send_lock, 0) != pdTRUE) {
+    arm_stage_timer();
+    return;
+  }
+  CommandStager::Command due[kStageBatch];
+  size_t count;
+  bool sent;
+  do {
+    portENTER_CRITICAL(&s_stage_lock);
+    count = s_stager.take_due(static_cast<uint32_t>(esp_timer_get_time() / 1000), due, kStageBatch);
+    portEXIT_CRITICAL(&s_stage_lock);
+    sent = stage_send_released(due, count, kStageSendTimeoutMs);
+  } while (sent && count == kStageBatch);
+  xSemaphoreGive(s_stage_send_lock);
+  portENTER_CRITICAL(&s_stage_lock);
+  const size_t left = s_stager.staged();
+  portEXIT_CRITICAL(&s_stage_lock);
+  if (left) {
+    arm_stage_timer();
+  }
+}
+
+}  // namespace
+
+ZbCommand::ZbCommand(ZbCommand&& other) : slot_(other.slot_), error_(other.error_) {
+  other.slot_ = -1;
+  other.error_ = ESP_ERR_INVALID_STATE;
+}
+
+ZbCommand& ZbCommand::operator=(ZbCommand&& other) {
+  if (this != &other) {
+    release();
+    slot_ = other.slot_;
+    error_ = other.error_;
+    other.slot_ = -1;
+    other.error_ = ESP_ERR_INVALID_STATE;
+  }
+  return *this;
+}
+
+ZbCommand::~ZbCommand() {
+  release();
+}
+
+void ZbCommand::release() {
+  if (slot_ < 0) {
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_tracker.release(slot_);
+  portEXIT_CRITICAL(&s_lock);
+  slot_ = -1;
+}
+
+ZbCommand ZbCommand::send(uint8_t network, uint8_t command, const void* request, uint16_t len, int64_t cause_us) {
+  if (!s_done) {
+    return ZbCommand(-1, ESP_ERR_INVALID_STATE);
+  }
+  if ((len && !request) || len > sizeof(zb_cmd_any_request_t)) {
+    return ZbCommand(-1, ESP_ERR_INVALID_ARG);
+  }
+  if (!link_supported(network)) {
+    return ZbCommand(-1, ESP_ERR_NOT_SUPPORTED);
+  }
+  esp_err_t err;
+  const int slot = submit(network, command, request, len, false, kQueueTimeoutMs, &err);
+  if (slot < 0) {
+    return ZbCommand(-1, err);
+  }
+  if (cause_us > 0) {
+    uart_link_record_hop(UART_LINK_HOP_HUB, static_cast<uint32_t>(esp_timer_get_time() - cause_us));
+  }
+  return ZbCommand(slot, ESP_OK);
+}
+
+esp_err_t ZbCommand::wait(uint32_t timeout_ms) {
+  if (slot_ < 0) {
+    return error_;
+  }
+  xEventGroupWaitBits(s_done, slot_bit(slot_), pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+  portENTER_CRITICAL(&s_lock);
+  // Re-check under the lock: the response may land between the wait timing out and here.
+  const bool timed_out = s_tracker.fail(slot_, ZB_CMD_STATUS_TIMEOUT, now_us());
+  portEXIT_CRITICAL(&s_lock);
+  return timed_out ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+bool ZbCommand::ready() const {
+  if (slot_ < 0) {
+    return true;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const bool done = s_tracker.state(slot_) == CommandTracker::State::kDone;
+  portEXIT_CRITICAL(&s_lock);
+  return done;
+}
+
+zb_cmd_status_t ZbCommand::status() const {
+  if (slot_ < 0) {
+    return ZB_CMD_STATUS_LINK_DOWN;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const uint8_t status = s_tracker.result(slot_).status;
+  portEXIT_CRITICAL(&s_lock);
+  return static_cast<zb_cmd_status_t>(status);
+}
+
+uint8_t ZbCommand::detail() const {
+  if (slot_ < 0) {
+    return 0;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const uint8_t detail = s_tracker.result(slot_).detail;
+  portEXIT_CRITICAL(&s_lock);
+  return detail;
+}
+
+uint32_t ZbCommand::round_trip_us() const {
+  if (slot_ < 0) {
+    return 0;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const uint32_t rtt = s_tracker.result(slot_).round_trip_us;
+  portEXIT_CRITICAL(&s_lock);
+  return rtt;
+}
+
+bool ZbCommand::copy_response(void* out, uint16_t len) const {
+  if (slot_ < 0 || !out) {
+    return false;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const CommandTracker::Result& result = s_tracker.result(slot_);
+  const bool ok = s_tracker.state(slot_) == CommandTracker::State::kDone && result.status == ZB_CMD_STATUS_OK &&
+                  result.length == len;
+  if (ok) {
+    memcpy(out, s_tracker.body(slot_), len);
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return ok;
+}
+
+esp_err_t zb_command_init(void) {
+  DEBUG_FUNC_ENTER();
+  if (!s_done) {
+    s_done = s_done_storage.create(MEM_BUDGET_ZIGBEE);
+    if (!s_done) {
+      DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+      return ESP_ERR_NO_MEM;
+    }
+    mem_budget_charge(MEM_BUDGET_ZIGBEE, MEM_BUDGET_BUFFER, sizeof(s_tracker) + sizeof(s_stager), false);
+  }
+  if (!s_stage_send_lock) {
+    s_stage_send_lock = s_stage_send_lock_storage.create(MEM_BUDGET_ZIGBEE);
+    if (!s_stage_send_lock) {
+      DEBUG_FUNC_EXIT_RC(ESP_ERR_NO_MEM);
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  s_stager.configure(CONFIG_APP_ZB_STAGE_RATE, CONFIG_APP_ZB_STAGE_BURST);
+  esp_err_t err = ESP_OK;
+  if (!s_stage_timer) {
+    const esp_timer_create_args_t stage_timer_args = {
+        .callback = &stage_tick,
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "zb_stage",
+        .skip_unhandled_events = true,
+    };
+    err = esp_timer_create(&stage_timer_args, &s_stage_timer);
+  }
+  if (err == ESP_OK) {
+    err = uart_link_register_frame_handler(UART_LINK_MSG_ZB_RESPONSE, on_response, nullptr);
+  }
+  if (err == ESP_OK) {
+    err = uart_link_register_event_cb(on_link_event, nullptr);
+  }
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+  if (err == ESP_OK) {
+    err = zigbee_manager_register_frame_handler(UART_LINK_MSG_ZB_RESPONSE, on_response, nullptr);
+  }
+#endif
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
+}
+
+bool zb_command_supported(void) {
+  return link_supported(UART_LINK_PRIMARY);
+}
+
+void zb_command_get_stats(zb_command_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  memset(out_stats, 0, sizeof(*out_stats));
+  out_stats->supported = zb_command_supported();
+  portENTER_CRITICAL(&s_lock);
+  const CommandTracker::Stats stats = s_tracker.stats();
+  for (int i = 0; i < CommandTracker::kSlots; ++i) {
+    if (s_tracker.state(i) == CommandTracker::State::kPending) {
+      out_stats->in_flight++;
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  out_stats->sent = stats.sent;
+  out_stats->completed = stats.completed;
+  out_stats->failed = stats.failed;
+  out_stats->late = stats.late;
+  out_stats->malformed = stats.malformed;
+  out_stats->no_slot = stats.no_slot;
+  out_stats->last_round_trip_us = stats.last_round_trip_us;
+  out_stats->max_round_trip_us = stats.max_round_trip_us;
+  out_stats->avg_round_trip_us =
+      stats.completed ? static_cast<uint32_t>(stats.total_round_trip_us / stats.completed) : 0;
+}
+
+void zb_command_reset_stats(void) {
+  portENTER_CRITICAL(&s_lock);
+  s_tracker.reset_stats();
+  portEXIT_CRITICAL(&s_lock);
+  portENTER_CRITICAL(&s_stage_lock);
+  s_stager.reset_stats();
+  s_stage_send_errors = 0;
+  portEXIT_CRITICAL(&s_stage_lock);
+}
+
+esp_err_t zb_command_benchmark(uint32_t iterations, zb_command_bench_t* out_result) {
+  if (!out_result || iterations == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(out_result, 0, sizeof(*out_result));
+  out_result->iterations = iterations;
+  out_result->min_round_trip_us = UINT32_MAX;
+  uint64_t total_us = 0;
+  const zb_cmd_set_mode_t query = {ZB_ROLE_QUERY};
+  for (uint32_t i = 0; i < iterations; ++i) {
+    ZbCommand command = zb_command_send(UART_LINK_PRIMARY, query);
+    esp_err_t err = command.wait(kBenchTimeoutMs);
+    if (err != ESP_OK) {
+      ESP_LOGW(kTag, "Benchmark stopped after %u round trips: %s", static_cast<unsigned>(i), esp_err_to_name(err));
+      break;
+    }
+    const uint32_t rtt = command.round_trip_us();
+    out_result->completed++;
+    total_us += rtt;
+    if (rtt < out_result->min_round_trip_us) {
+      out_result->min_round_trip_us = rtt;
+    }
+    if (rtt > out_result->max_round_trip_us) {
+      out_result->max_round_trip_us = rtt;
+    }
+  }
+  if (!out_result->completed) {
+    out_result->min_round_trip_us = 0;
+    return ESP_ERR_TIMEOUT;
+  }
+  out_result->avg_round_trip_us = static_cast<uint32_t>(total_us / out_result->completed);
+  return ESP_OK;
+}
+
+esp_err_t zb_command_stage(uint8_t network, uint8_t command, const void* request, uint16_t len) {
+  if (!s_done || !s_stage_timer) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if ((len && !request) || len > sizeof(zb_cmd_any_request_t)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!link_supported(network)) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (xSemaphoreTake(s_stage_send_lock, pdMS_TO_TICKS(kQueueTimeoutMs)) != pdTRUE) {
+    return ESP_ERR_TIMEOUT;
+  }
+  const uint32_t now_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  size_t flush_count = 0;
+  portENTER_CRITICAL(&s_stage_lock);
+  const CommandStager::Verdict verdict = s_stager.offer(network, command, request, len, now_ms);
+  if (verdict == CommandStager::Verdict::kFlushFirst) {
+    zb_cmd_target_t target;
+    CommandStager::target_of(command, request, len, &target);
+    flush_count = s_stager.take_device(network, target.short_addr, now_ms, s_flushed, CommandStager::kSlots);
+  }
+  portEXIT_CRITICAL(&s_stage_lock);
+  esp_err_t err = ESP_OK;
+  if (verdict == CommandStager::Verdict::kSendNow || verdict == CommandStager::Verdict::kFlushFirst) {
+    // Sending this one after a flushed command that went back to the stage would reorder them.
+    err = stage_send_released(s_flushed, flush_count, kQueueTimeoutMs)
+              ? stage_send(network, command, request, len, kQueueTimeoutMs)
+              : ESP_ERR_TIMEOUT;
+    if (err != ESP_OK) {
+      portENTER_CRITICAL(&s_stage_lock);
+      s_stage_send_errors++;
+      portEXIT_CRITICAL(&s_stage_lock);
+    }
+  }
+  xSemaphoreGive(s_stage_send_lock);
+  if (verdict == CommandStager::Verdict::kStaged || flush_count) {
+    arm_stage_timer();
+  }
+  return err;
+}
+
+esp_err_t zb_command_set_rate_limit(uint16_t rate_per_s, uint8_t burst) {
+  if (rate_per_s == 0 || rate_per_s > 1000 || burst == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_stage_lock);
+  s_stager.configure(rate_per_s, burst);
+  portEXIT_CRITICAL(&s_stage_lock);
+  return ESP_OK;
+}
+
+void zb_command_get_stage_stats(zb_stage_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  portENTER_CRITICAL(&s_stage_lock);
+  const CommandStager::Stats stats = s_stager.stats();
+  out_stats->rate_per_s = s_stager.rate_per_s();
+  out_stats->burst = s_stager.burst();
+  out_stats->staged = s_stager.staged();
+  out_stats->send_errors = s_stage_send_errors;
+  portEXIT_CRITICAL(&s_stage_lock);
+  out_stats->offered = stats.offered;
+  out_stats->sent_now = stats.sent_now;
+  out_stats->deferred = stats.deferred;
+  out_stats->flushed = stats.flushed;
+  out_stats->coalesced = stats.coalesced;
+  out_stats->bypassed = stats.bypassed;
+  out_stats->restaged = stats.restaged;
+  out_stats->avg_delay_ms = stats.deferred ? static_cast<uint32_t>(stats.total_delay_ms / stats.deferred) : 0;
+  out_stats->max_delay_ms = stats.max_delay_ms;
+}
+
+namespace {
+
+constexpr uint32_t kFrameOverhead = 7;  // uart_link framing: preamble, type, seq, length, CRC16
+
+struct FloodRun {
+  zb_stage_bench_scenario_t* result;
+  uint64_t total_delay_ms;
+  uint8_t last_value[4];  // per simulated device, by short address 1..4
+  uint8_t sent_value[4];
+  uint32_t sent_bytes;
+};
+
+void flood_sent(FloodRun& run, uint8_t command, const uint8_t* body, uint16_t len, uint32_t now_ms,
+                uint32_t arrived_ms) {
+  zb_stage_bench_scenario_t& result = *run.result;
+  const uint32_t delay_ms = now_ms - arrived_ms;
+  result.frames++;
+  run.sent_bytes += kFrameOverhead + sizeof(zb_cmd_header_t) + len;
+  run.total_delay_ms += delay_ms;
+  if (delay_ms > result.max_delay_ms) {
+    result.max_delay_ms = delay_ms;
+  }
+  zb_cmd_target_t target;
+  memcpy(&target, body, sizeof(target));
+  if (command == ZB_CMD_LEVEL) {
+    run.sent_value[target.short_addr - 1] = body[offsetof(zb_cmd_level_t, level)];
+  } else if (command == ZB_CMD_COLOR) {
+    run.sent_value[target.short_addr - 1] = body[offsetof(zb_cmd_color_t, x) + 1];
+  }
+}
+
+// As zb_command_stage(): a command that must not overtake staged ones goes out after them.
+void flood_offer(CommandStager& stager, FloodRun& run, uint8_t command, const void* request, uint16_t len,
+                 uint32_t now_ms) {
+  const CommandStager::Verdict verdict = stager.offer(UART_LINK_PRIMARY, command, request, len, now_ms);
+  if (verdict == CommandStager::Verdict::kFlushFirst) {
+    zb_cmd_target_t target;
+    CommandStager::target_of(command, request, len, &target);
+    CommandStager::Command flushed[kStageBatch];
+    size_t count;
+    while ((count = stager.take_device(UART_LINK_PRIMARY, target.short_addr, now_ms, flushed, kStageBatch)) > 0) {
+      for (size_t i = 0; i < count; ++i) {
+        flood_sent(run, flushed[i].command, flushed[i].body, flushed[i].len, now_ms, flushed[i].staged_ms);
+      }
+    }
+  }
+  if (verdict == CommandStager::Verdict::kSendNow || verdict == CommandStager::Verdict::kFlushFirst) {
+    flood_sent(run, command, static_cast<const uint8_t*>(request), len, now_ms, now_ms);
+  }
+}
+
+/*
+ * Scenario 0: a UI slider dragged across one bulb, 30 level commands/s for 3 s.
+ * Scenario 1: the same slider on a colour picker for a group of four bulbs.
+ * Scenario 2: a runaway automation, 100 level commands/s for 5 s plus "on" every 500 ms.
+ */
+void run_flood(int scenario, uint16_t rate_per_s, uint8_t burst, zb_stage_bench_scenario_t* result) {
+  static const char* const kNames[ZB_STAGE_BENCH_SCENARIOS] = {"slider, 1 bulb", "colour, 4 bulbs",
+                                                               "runaway automation"};
+  CommandStager stager;
+  stager.configure(rate_per_s, burst);
+  FloodRun run = {};
+  run.result = result;
+  *result = {};
+  result->name = kNames[scenario];
+  const int devices = scenario == 1 ? 4 : 1;
+  const uint32_t period_ms = scenario == 2 ? 10 : 33;
+  const uint32_t duration_ms = scenario == 2 ? 5000 : 3000;
+  const uint32_t last_command_ms = (duration_ms - 1) / period_ms * period_ms;
+  uint32_t wire_bytes = 0;  // what every command sent as its own frame would have cost
+  bool drained = false;
+  CommandStager::Command due[kStageBatch];
+
+  for (uint32_t now = 0; now < duration_ms + 2000; ++now) {
+    if (now < duration_ms && now % period_ms == 0) {
+      const uint8_t value = static_cast<uint8_t>(now * 254 / duration_ms);
+      for (int device = 0; device < devices; ++device) {
+        const zb_cmd_target_t target = {static_cast<uint16_t>(device + 1), 1};
+        const zb_cmd_level_t level = {target, value, 0};
+        const zb_cmd_color_t color = {target, static_cast<uint16_t>(value << 8), 0x5000, 0};
+        const uint8_t command = scenario == 1 ? ZB_CMD_COLOR : ZB_CMD_LEVEL;
+        const uint8_t* body = scenario == 1 ? reinterpret_cast<const uint8_t*>(&color)
+                                            : reinterpret_cast<const uint8_t*>(&level);
+        const uint16_t len = scenario == 1 ? sizeof(color) : sizeof(level);
+        result->commands++;
+        wire_bytes += kFrameOverhead + sizeof(zb_cmd_header_t) + len;
+        run.last_value[device] = value;
+        flood_offer(stager, run, command, body, len, now);
+      }
+      if (scenario == 2 && now % 500 == 0) {
+        const zb_cmd_on_off_t on = {{1, 1}, ZB_ON_OFF_ON};
+        result->commands++;
+        wire_bytes += kFrameOverhead + sizeof(zb_cmd_header_t) + sizeof(on);
+        flood_offer(stager, run, ZB_CMD_ON_OFF, &on, sizeof(on), now);
+      }
+    }
+    if (now % CONFIG_APP_ZB_STAGE_FLUSH_MS != 0) {
+      continue;
+    }
+    size_t count;
+    while ((count = stager.take_due(now, due, kStageBatch)) > 0) {
+      for (size_t i = 0; i < count; ++i) {
+        flood_sent(run, due[i].command, due[i].body, due[i].len, now, due[i].staged_ms);
+      }
+    }
+    if (!drained && now >= last_command_ms && stager.staged() == 0) {
+      drained = true;
+      result->final_delay_ms = now - last_command_ms;
+    }
+  }
+  result->link_bytes_saved = wire_bytes - run.sent_bytes;
+  result->avg_delay_ms = result->frames ? static_cast<uint32_t>(run.total_delay_ms / result->frames) : 0;
+  result->final_state_sent = memcmp(run.last_value, run.sent_value, devices) == 0;
+}
+
+}  // namespace
+
+esp_err_t zb_command_stage_benchmark(zb_stage_bench_t* out_result) {
+  if (!out_result) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_stage_lock);
+  out_result->rate_per_s = s_stager.rate_per_s();
+  out_result->burst = s_stager.burst();
+  portEXIT_CRITICAL(&s_stage_lock);
+  out_result->flush_ms = CONFIG_APP_ZB_STAGE_FLUSH_MS;
+  for (int i = 0; i < ZB_STAGE_BENCH_SCENARIOS; ++i) {
+    run_flood(i, out_result->rate_per_s, out_result->burst, &out_result->scenarios[i]);
+  }
+  return ESP_OK;
+}
+
+#else
+
+ZbCommand::ZbCommand(ZbCommand&& other) : slot_(-1), error_(other.error_) {}
+
+ZbCommand& ZbCommand::operator=(ZbCommand&& other) {
+  error_ = other.error_;
+  return *this;
+}
+
+ZbCommand::~ZbCommand() {}
+
+void ZbCommand::release() {}
+
+ZbCommand ZbCommand::send(uint8_t network, uint8_t command, const void* request, uint16_t len, int64_t cause_us) {
+  (void)network;
+  (void)command;
+  (void)request;
+  (void)len;
+  (void)cause_us;
+  return ZbCommand(-1, ESP_ERR_NOT_SUPPORTED);
+}
+
+esp_err_t ZbCommand::wait(uint32_t timeout_ms) {
+  (void)timeout_ms;
+  return error_;
+}
+
+bool ZbCommand::ready() const {
+  return true;
+}
+
+zb_cmd_status_t ZbCommand::status() const {
+  return ZB_CMD_STATUS_LINK_DOWN;
+}
+
+uint8_t ZbCommand::detail() const {
+  return 0;
+}
+
+uint32_t ZbCommand::round_trip_us() const {
+  return 0;
+}
+
+bool ZbCommand::copy_response(void* out, uint16_t len) const {
+  (void)out;
+  (void)len;
+  return false;
+}
+
+esp_err_t zb_command_init(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool zb_command_supported(void) {
+  return false;
+}
+
+void zb_command_get_stats(zb_command_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+void zb_command_reset_stats(void) {}
+
+esp_err_t zb_command_benchmark(uint32_t iterations, zb_command_bench_t* out_result) {
+  (void)iterations;
+  (void)out_result;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t zb_command_stage(uint8_t network, uint8_t command, const void* request, uint16_t len) {
+  (void)network;
+  (void)command;
+  (void)request;
+  (void)len;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t zb_command_set_rate_limit(uint16_t rate_per_s, uint8_t burst) {
+  (void)rate_per_s;
+  (void)burst;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void zb_command_get_stage_stats(zb_stage_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+esp_err_t zb_command_stage_benchmark(zb_stage_bench_t* out_result) {
+  (void)out_result;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif  // CONFIG_APP_ENABLE_UART_LINK
+
+const char* zb_command_status_name(uint8_t status) {
+  switch (status) {
+    case ZB_CMD_STATUS_OK:
+      return "ok";
+    case ZB_CMD_STATUS_UNKNOWN_COMMAND:
+      return "unknown command";
+    case ZB_CMD_STATUS_BAD_LENGTH:
+      return "bad length";
+    case ZB_CMD_STATUS_BUSY:
+      return "busy";
+    case ZB_CMD_STATUS_NO_DEVICE:
+      return "no such device";
+    case ZB_CMD_STATUS_ZCL_ERROR:
+      return "zcl error";
+    case ZB_CMD_STATUS_NO_ROUTE:
+      return "no route";
+    case ZB_CMD_STATUS_TIMEOUT:
+      return "timeout";
+    case ZB_CMD_STATUS_LINK_DOWN:
+      return "link down";
+    default:
+      return "unknown";
+  }
+}
+
+const char* zb_command_name(uint8_t command) {
+  switch (command) {
+#define ZB_CMD_NAME(id, name, req, rsp) \
+  case id:                              \
+    return #name;
+    ZB_COMMAND_LIST(ZB_CMD_NAME)
+#undef ZB_CMD_NAME
+    default:
+      return "UNKNOWN";
+  }
+}
@@ -0,0 +1,177 @@
+#include "include/zb_devices.h"
+
+#include <cstring>
+
+#define DEBUG_TAG "ZB_DEV"
+#include "../debug/include/debug/Debug.h"
+#include "device_registry.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "include/uart_link.h"
+#include "sdkconfig.h"
+
+#if CONFIG_APP_ENABLE_UART_LINK
+
+static_assert(ZB_DEVICES_NATIVE >= UART_LINK_MAX_LINKS && ZB_DEVICES_NATIVE != DeviceRegistry::kUnknown &&
+                  ZB_DEVICES_NATIVE != DeviceRegistry::kAmbiguous,
+              "native network collides with a link");
+
+namespace {
+const char* kTag = DEBUG_TAG;
+
+// Guards s_registry; the RX tasks note devices, command senders look them up.
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+DeviceRegistry s_registry;
+
+uint32_t now_ms() {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+}  // namespace
+
+void zb_devices_note(uint8_t network, uint16_t short_addr) {
+  portENTER_CRITICAL(&s_lock);
+  const bool added = s_registry.note(network, short_addr, now_ms());
+  portEXIT_CRITICAL(&s_lock);
+  if (added && zb_devices_networks() > 1) {
+    ESP_LOGI(kTag, "Device 0x%04X joined network %s", short_addr, zb_devices_network_name(network));
+  }
+}
+
+esp_err_t zb_devices_resolve(uint16_t short_addr, uint8_t* out_network) {
+  if (!out_network) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const uint8_t network = s_registry.resolve(short_addr);
+  portEXIT_CRITICAL(&s_lock);
+  if (network == DeviceRegistry::kUnknown) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (network == DeviceRegistry::kAmbiguous) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  *out_network = network;
+  return ESP_OK;
+}
+
+uint8_t zb_devices_networks(void) {
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+  return uart_link_count() + 1;
+#else
+  return uart_link_count();
+#endif
+}
+
+bool zb_devices_network_valid(uint8_t network) {
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+  if (network == ZB_DEVICES_NATIVE) {
+    return true;
+  }
+#endif
+  return network < uart_link_count();
+}
+
+esp_err_t zb_devices_pin(uint8_t network, uint16_t short_addr) {
+  if (!zb_devices_network_valid(network)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const bool ok = s_registry.pin(network, short_addr, now_ms());
+  portEXIT_CRITICAL(&s_lock);
+  return ok ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t zb_devices_forget(uint8_t network, uint16_t short_addr) {
+  portENTER_CRITICAL(&s_lock);
+  const bool found = s_registry.forget(network, short_addr);
+  portEXIT_CRITICAL(&s_lock);
+  return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+size_t zb_devices_list(zb_device_route_t* out_routes, size_t max_routes) {
+  if (!out_routes) {
+    return 0;
+  }
+  const uint32_t now = now_ms();
+  portENTER_CRITICAL(&s_lock);
+  const size_t count = s_registry.size() < max_routes ? s_registry.size() : max_routes;
+  for (size_t i = 0; i < count; ++i) {
+    const DeviceRegistry::Entry& entry = s_registry.entry(i);
+    out_routes[i] = {entry.network, entry.short_addr, entry.pinned, now - entry.seen_ms};
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return count;
+}
+
+void zb_devices_get_stats(zb_devices_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  const DeviceRegistry::Stats stats = s_registry.stats();
+  out_stats->devices = s_registry.size();
+  portEXIT_CRITICAL(&s_lock);
+  out_stats->learned = stats.learned;
+  out_stats->evicted = stats.evicted;
+  out_stats->resolved = stats.resolved;
+  out_stats->unknown = stats.unknown;
+  out_stats->ambiguous = stats.ambiguous;
+}
+
+#else
+
+void zb_devices_note(uint8_t network, uint16_t short_addr) {
+  (void)network;
+  (void)short_addr;
+}
+
+esp_err_t zb_devices_resolve(uint16_t short_addr, uint8_t* out_network) {
+  (void)short_addr;
+  (void)out_network;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+uint8_t zb_devices_networks(void) {
+  return 0;
+}
+
+bool zb_devices_network_valid(uint8_t network) {
+  (void)network;
+  return false;
+}
+
+esp_err_t zb_devices_pin(uint8_t network, uint16_t short_addr) {
+  (void)network;
+  (void)short_addr;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t zb_devices_forget(uint8_t network, uint16_t short_addr) {
+  (void)network;
+  (void)short_addr;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+size_t zb_devices_list(zb_device_route_t* out_routes, size_t max_routes) {
+  (void)out_routes;
+  (void)max_routes;
+  return 0;
+}
+
+void zb_devices_get_stats(zb_devices_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+#endif  // CONFIG_APP_ENABLE_UART_LINK
+
+const char* zb_devices_network_name(uint8_t network) {
+  static const char* const kLinks[] = {"0", "1", "2", "3"};
+  if (network == ZB_DEVICES_NATIVE) {
+    return "c6";
+  }
+  return network < sizeof(kLinks) / sizeof(kLinks[0]) ? kLinks[network] : "?";
+}
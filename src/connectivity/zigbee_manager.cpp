@@ -1,61 +1,269 @@
 #include "zigbee_manager.h"
 
+#include <cstring>
+
+#define DEBUG_TAG "ZIGBEE_MANAGER"
+#include "../debug/include/debug/Debug.h"
+#include "../debug/include/debug/StaticAlloc.h"
 #include "esp_log.h"
-#include "esp_zigbee_core.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "include/zb_devices.h"
+#include "sdkconfig.h"
+
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+
+#if !CONFIG_ZB_ENABLED || !CONFIG_ZB_ZCZR
+#error "APP_ZIGBEE_NATIVE_NETWORK needs ZB_ENABLED with the coordinator library (ZB_ZCZR)"
+#endif
+
+#include "esp_zigbee_core.h"
+#include "zigbee_network.h"
+
+#ifndef CONFIG_APP_ZIGBEE_NATIVE_CHANNEL
+#define CONFIG_APP_ZIGBEE_NATIVE_CHANNEL 25
+#endif
+#ifndef CONFIG_APP_ZIGBEE_NATIVE_MAX_CHILDREN
+#define CONFIG_APP_ZIGBEE_NATIVE_MAX_CHILDREN 10
+#endif
 
-static const char* TAG = "ZIGBEE_MANAGER";
+namespace {
+const char* kTag = DEBUG_TAG;
 
 /* Zigbee configuration */
-#define MAX_CHILDREN 10
-#define INSTALL_CODE_POLICY_ENABLE false
-#define HA_ESP_LIGHT_ENDPOINT 10
-#define ESP_ZB_PRIMARY_CHANNEL_MASK ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK
+constexpr bool kInstallCodePolicy = false;
+constexpr uint8_t kHubEndpoint = 10;  // source of every command the hub sends
+constexpr uint32_t kTickMs = 250;     // resolution of the request timeout
+constexpr uint32_t kLockTimeoutMs = 100;
+constexpr int kBindTransactionBase = 0x100;  // above the 8-bit ZCL sequence numbers
+constexpr size_t kMaxHandlers = 4;
+constexpr uint32_t kTaskStackSize = 4096;
+
+struct Handler {
+  uint8_t type;
+  uart_link_frame_handler_t handler;
+  void* ctx;
+};
+
+Handler s_handlers[kMaxHandlers] = {};  // written at startup only
+volatile bool s_up = false;
+uint32_t s_announced = 0;  // Zigbee task only
+debug::StaticTask<kTaskStackSize> s_task_storage;
+
+uint32_t now_ms() {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+void dispatch(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  for (const Handler& entry : s_handlers) {
+    if (entry.handler && entry.type == type) {
+      entry.handler(type, payload, len, entry.ctx);
+    }
+  }
+}
+
+esp_zb_zcl_basic_cmd_t basic_cmd(const zb_cmd_target_t& target) {
+  esp_zb_zcl_basic_cmd_t cmd = {};
+  cmd.dst_addr_u.addr_short = target.short_addr;
+  cmd.dst_endpoint = target.endpoint;
+  cmd.src_endpoint = kHubEndpoint;
+  return cmd;
+}
+
+void copy_value(const esp_zb_zcl_attribute_data_t& data, zb_rsp_read_attr_t* out) {
+  out->zcl_type = static_cast<uint8_t>(data.type);
+  // Strings and arrays do not fit the report; keep their first bytes as the H2 does.
+  out->length = static_cast<uint8_t>(data.size < sizeof(out->value) ? data.size : sizeof(out->value));
+  if (data.value) {
+    memcpy(out->value, data.value, out->length);
+  }
+}
+
+void bind_done(esp_zb_zdp_status_t status, void* user_ctx);
+
+// ZBOSS behind ZigbeeStack. Called with the Zigbee lock held; the ZCL sequence number is the transaction.
+class ZbossStack : public ZigbeeStack {
+ public:
+  int on_off(const zb_cmd_target_t& target, uint8_t action) override {
+    esp_zb_zcl_on_off_cmd_t cmd = {};
+    cmd.zcl_basic_cmd = basic_cmd(target);
+    cmd.address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT;
+    switch (action) {
+      case ZB_ON_OFF_OFF:
+        cmd.on_off_cmd_id = ESP_ZB_ZCL_CMD_ON_OFF_OFF_ID;
+        break;
+      case ZB_ON_OFF_ON:
+        cmd.on_off_cmd_id = ESP_ZB_ZCL_CMD_ON_OFF_ON_ID;
+        break;
+      default:
+        cmd.on_off_cmd_id = ESP_ZB_ZCL_CMD_ON_OFF_TOGGLE_ID;
+        break;
+    }
+    return esp_zb_zcl_on_off_cmd_req(&cmd);
+  }
+
+  int level(const zb_cmd_target_t& target, uint8_t level, uint16_t transition_ds) override {
+    esp_zb_zcl_move_to_level_cmd_t cmd = {};
+    cmd.zcl_basic_cmd = basic_cmd(target);
+    cmd.address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT;
+    cmd.level = level;
+    cmd.transition_time = transition_ds;
+    return esp_zb_zcl_level_move_to_level_with_onoff_cmd_req(&cmd);
+  }
+
+  int color(const zb_cmd_target_t& target, uint16_t x, uint16_t y, uint16_t transition_ds) override {
+    esp_zb_zcl_color_move_to_color_cmd_t cmd = {};
+    cmd.zcl_basic_cmd = basic_cmd(target);
+    cmd.address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT;
+    cmd.color_x = x;
+    cmd.color_y = y;
+    cmd.transition_time = transition_ds;
+    return esp_zb_zcl_color_move_to_color_cmd_req(&cmd);
+  }
+
+  int bind(const zb_cmd_bind_t& bind) override {
+    esp_zb_zdo_bind_req_param_t req = {};
+    memcpy(req.src_address, &bind.src_ieee, sizeof(req.src_address));
+    req.src_endp = bind.src_endpoint;
+    req.cluster_id = bind.cluster;
+    req.dst_addr_mode = ESP_ZB_ZDO_BIND_DST_ADDR_MODE_64_BIT_EXTENDED;
+    memcpy(req.dst_address_u.addr_long, &bind.dst_ieee, sizeof(req.dst_address_u.addr_long));
+    req.dst_endp = bind.dst_endpoint;
+    // The request goes to the device holding the binding table: the source.
+    req.req_dst_addr = esp_zb_address_short_by_ieee(req.src_address);
+    if (req.req_dst_addr == 0xFFFF) {
+      return -1;
+    }
+    const int transaction = kBindTransactionBase + (next_bind_++ & 0xFF);
+    esp_zb_zdo_device_bind_req(&req, bind_done, reinterpret_cast<void*>(static_cast<intptr_t>(transaction)));
+    return transaction;
+  }
+
+  int read_attr(const zb_cmd_target_t& target, uint16_t cluster, uint16_t attribute) override {
+    read_attr_id_ = attribute;
+    esp_zb_zcl_read_attr_cmd_t cmd = {};
+    cmd.zcl_basic_cmd = basic_cmd(target);
+    cmd.address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT;
+    cmd.clusterID = cluster;
+    cmd.attr_number = 1;
+    cmd.attr_field = &read_attr_id_;
+    return esp_zb_zcl_read_attr_cmd_req(&cmd);
+  }
+
+ private:
+  uint16_t read_attr_id_ = 0;
+  uint8_t next_bind_ = 0;
+};
+
+// Guarded by the Zigbee lock: callers outside the Zigbee task acquire it first.
+ZbossStack s_stack;
+ZigbeeNetwork s_network(s_stack, dispatch, nullptr);
+
+void bind_done(esp_zb_zdp_status_t status, void* user_ctx) {
+  s_network.on_status(static_cast<int>(reinterpret_cast<intptr_t>(user_ctx)), static_cast<uint8_t>(status));
+}
+
+esp_err_t on_action(esp_zb_core_action_callback_id_t callback_id, const void* message) {
+  switch (callback_id) {
+    case ESP_ZB_CORE_CMD_DEFAULT_RESP_CB_ID: {
+      const auto* rsp = static_cast<const esp_zb_zcl_cmd_default_resp_message_t*>(message);
+      s_network.on_status(rsp->info.header.tsn, static_cast<uint8_t>(rsp->status_code));
+      break;
+    }
+    case ESP_ZB_CORE_CMD_READ_ATTR_RESP_CB_ID: {
+      const auto* rsp = static_cast<const esp_zb_zcl_cmd_read_attr_resp_message_t*>(message);
+      const esp_zb_zcl_read_attr_resp_variable_t* variable = rsp->variables;
+      if (!variable) {
+        s_network.on_status(rsp->info.header.tsn, static_cast<uint8_t>(rsp->info.status));
+        break;
+      }
+      zb_rsp_read_attr_t attr = {};
+      attr.cluster = rsp->info.cluster;
+      attr.attribute = variable->attribute.id;
+      copy_value(variable->attribute.data, &attr);
+      s_network.on_read_attr(rsp->info.header.tsn, static_cast<uint8_t>(variable->status), attr);
+      break;
+    }
+    case ESP_ZB_CORE_REPORT_ATTR_CB_ID: {
+      const auto* report = static_cast<const esp_zb_zcl_report_attr_message_t*>(message);
+      zb_attr_report_t out = {};
+      out.source.short_addr = report->src_address.u.short_addr;
+      out.source.endpoint = report->src_endpoint;
+      out.attr.cluster = report->cluster;
+      out.attr.attribute = report->attribute.id;
+      copy_value(report->attribute.data, &out.attr);
+      s_network.on_report(out);
+      break;
+    }
+    default:
+      ESP_LOGD(kTag, "Unhandled action 0x%x", callback_id);
+      break;
+  }
+  return ESP_OK;
+}
+
+void tick(uint8_t) {
+  s_network.tick(now_ms());
+  esp_zb_scheduler_alarm(tick, 0, kTickMs);
+}
+
+void bdb_start_top_level_commissioning_cb(uint8_t mode_mask) {
+  ESP_ERROR_CHECK(esp_zb_bdb_start_top_level_commissioning(mode_mask));
+}
 
-static void esp_zb_task(void* pvParameters) {
+void esp_zb_task(void* pvParameters) {
   /* Initialize Zigbee stack */
-  esp_zb_cfg_t zb_nwk_cfg = {
-      .esp_zb_role = ESP_ZB_DEVICE_TYPE_COORDINATOR,
-      .install_code_policy = INSTALL_CODE_POLICY_ENABLE,
-      .nwk_cfg =
-          {
-              .zczr_cfg =
-                  {
-                      .max_children = MAX_CHILDREN,
-                  },
-          },
-  };
+  esp_zb_cfg_t zb_nwk_cfg = {};
+  zb_nwk_cfg.esp_zb_role = ESP_ZB_DEVICE_TYPE_COORDINATOR;
+  zb_nwk_cfg.install_code_policy = kInstallCodePolicy;
+  zb_nwk_cfg.nwk_cfg.zczr_cfg.max_children = CONFIG_APP_ZIGBEE_NATIVE_MAX_CHILDREN;
   esp_zb_init(&zb_nwk_cfg);
 
-  /* Create a custom Zigbee cluster list */
+  /* Basic server plus the client clusters the typed commands drive */
   esp_zb_attribute_list_t* basic_cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_BASIC);
   esp_zb_basic_cluster_add_attr(basic_cluster, ESP_ZB_ZCL_ATTR_BASIC_MANUFACTURER_NAME_ID, (void*)"Espressif");
   esp_zb_basic_cluster_add_attr(basic_cluster, ESP_ZB_ZCL_ATTR_BASIC_MODEL_IDENTIFIER_ID, (void*)"Esp32C6_Hub");
 
   esp_zb_cluster_list_t* cluster_list = esp_zb_zcl_cluster_list_create();
   esp_zb_cluster_list_add_basic_cluster(cluster_list, basic_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+  esp_zb_cluster_list_add_on_off_cluster(cluster_list, esp_zb_on_off_cluster_create(NULL),
+                                         ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
+  esp_zb_cluster_list_add_level_cluster(cluster_list, esp_zb_level_cluster_create(NULL),
+                                        ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
+  esp_zb_cluster_list_add_color_control_cluster(cluster_list, esp_zb_color_control_cluster_create(NULL),
+                                                ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
 
   esp_zb_ep_list_t* ep_list = esp_zb_ep_list_create();
-  esp_zb_endpoint_config_t endpoint_config = {.endpoint = HA_ESP_LIGHT_ENDPOINT,
+  esp_zb_endpoint_config_t endpoint_config = {.endpoint = kHubEndpoint,
                                               .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
-                                              .app_device_id = ESP_ZB_HA_ON_OFF_LIGHT_DEVICE_ID,
+                                              .app_device_id = ESP_ZB_HA_REMOTE_CONTROL_DEVICE_ID,
                                               .app_device_version = 0};
   esp_zb_ep_list_add_ep(ep_list, cluster_list, endpoint_config);
 
   /* Register the device */
   esp_zb_device_register(ep_list);
 
-  esp_zb_core_action_handler_register(NULL);  // No specific action handler for now
+  esp_zb_core_action_handler_register(on_action);
 
-  esp_zb_set_primary_network_channel_set(ESP_ZB_PRIMARY_CHANNEL_MASK);
+  esp_zb_set_primary_network_channel_set(1u << CONFIG_APP_ZIGBEE_NATIVE_CHANNEL);
 
   ESP_ERROR_CHECK(esp_zb_start(false));
 
+  esp_zb_scheduler_alarm(tick, 0, kTickMs);
   esp_zb_stack_main_loop();
 }
 
+void network_up() {
+  s_up = true;
+  ESP_LOGI(kTag, "Native network up (PAN ID 0x%04hx, channel %d)", esp_zb_get_pan_id(),
+           esp_zb_get_current_channel());
+}
+
+}  // namespace
+
 esp_err_t zigbee_manager_init(void) {
+  DEBUG_FUNC_ENTER();
   /* Zigbee Platform Configuration */
   esp_zb_platform_config_t config = {
       .radio_config =
@@ -69,20 +277,18 @@ esp_err_t zigbee_manager_init(void) {
               .host_uart_config = {},
           },
   };
-  ESP_ERROR_CHECK(esp_zb_platform_config(&config));
-
-  return ESP_OK;
+  const esp_err_t err = esp_zb_platform_config(&config);
+  DEBUG_FUNC_EXIT_RC(err);
+  return err;
 }
 
 esp_err_t zigbee_manager_start(void) {
-  xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
+  if (s_task_storage.create(esp_zb_task, "Zigbee_main", NULL, 5, NULL, MEM_BUDGET_ZIGBEE) != pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
   return ESP_OK;
 }
 
-static void bdb_start_top_level_commissioning_cb(uint8_t mode_mask) {
-  ESP_ERROR_CHECK(esp_zb_bdb_start_top_level_commissioning(mode_mask));
-}
-
 void esp_zb_app_signal_handler(esp_zb_app_signal_t* signal_struct) {
   uint32_t* p_sg_p = signal_struct->p_app_signal;
   esp_err_t err_status = signal_struct->esp_err_status;
@@ -90,62 +296,172 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t* signal_struct) {
 
   switch (sig_type) {
     case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
-      ESP_LOGI(TAG, "Zigbee stack initialized");
+      ESP_LOGI(kTag, "Zigbee stack initialized");
       esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
       break;
     case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
     case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
       if (err_status == ESP_OK) {
-        ESP_LOGI(TAG, "Device started up in %s factory-reset mode", esp_zb_bdb_is_factory_new() ? "" : "non");
+        ESP_LOGI(kTag, "Device started up in %s factory-reset mode", esp_zb_bdb_is_factory_new() ? "" : "non");
         if (esp_zb_bdb_is_factory_new()) {
-          ESP_LOGI(TAG, "Start network formation");
+          ESP_LOGI(kTag, "Start network formation");
           esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_FORMATION);
         } else {
-          ESP_LOGI(TAG, "Device rebooted");
+          ESP_LOGI(kTag, "Device rebooted");
+          network_up();
         }
       } else {
-        ESP_LOGE(TAG, "Failed to initialize Zigbee stack (status: %s)", esp_err_to_name(err_status));
+        ESP_LOGE(kTag, "Failed to initialize Zigbee stack (status: %s)", esp_err_to_name(err_status));
       }
       break;
     case ESP_ZB_BDB_SIGNAL_FORMATION:
       if (err_status == ESP_OK) {
         esp_zb_ieee_addr_t extended_pan_id;
         esp_zb_get_extended_pan_id(extended_pan_id);
-        ESP_LOGI(TAG,
+        ESP_LOGI(kTag,
                  "Formed network successfully (Extended PAN ID: %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x, PAN ID: "
                  "0x%04hx, Channel:%d, Short Address: 0x%04hx)",
                  extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4], extended_pan_id[3],
                  extended_pan_id[2], extended_pan_id[1], extended_pan_id[0], esp_zb_get_pan_id(),
                  esp_zb_get_current_channel(), esp_zb_get_short_address());
+        network_up();
         esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
       } else {
-        ESP_LOGI(TAG, "Restart network formation (status: %s)", esp_err_to_name(err_status));
+        ESP_LOGI(kTag, "Restart network formation (status: %s)", esp_err_to_name(err_status));
         esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb,
                                ESP_ZB_BDB_MODE_NETWORK_FORMATION, 1000);
       }
       break;
     case ESP_ZB_BDB_SIGNAL_STEERING:
       if (err_status == ESP_OK) {
-        ESP_LOGI(TAG, "Network steering started");
+        ESP_LOGI(kTag, "Network steering started");
       }
       break;
+    case ESP_ZB_ZDO_SIGNAL_DEVICE_ANNCE: {
+      const esp_zb_zdo_signal_device_annce_params_t* params =
+          (esp_zb_zdo_signal_device_annce_params_t*)esp_zb_app_signal_get_params(p_sg_p);
+      s_announced++;
+      ESP_LOGI(kTag, "Device 0x%04hx joined the native network", params->device_short_addr);
+      zb_devices_note(ZB_DEVICES_NATIVE, params->device_short_addr);
+      break;
+    }
     default:
-      ESP_LOGI(TAG, "ZDO signal: 0x%x, status: %s", sig_type, esp_err_to_name(err_status));
+      ESP_LOGI(kTag, "ZDO signal: 0x%x, status: %s", sig_type, esp_err_to_name(err_status));
       break;
   }
 }
 
 void zigbee_manager_print_status(void) {
+  if (!esp_zb_lock_acquire(pdMS_TO_TICKS(kLockTimeoutMs))) {
+    ESP_LOGW(kTag, "Status: Zigbee stack busy");
+    return;
+  }
   if (esp_zb_bdb_is_factory_new()) {
-    ESP_LOGI(TAG, "Status: Factory New Device");
+    ESP_LOGI(kTag, "Status: Factory New Device");
   } else {
     esp_zb_ieee_addr_t ext_pan_id;
     esp_zb_get_extended_pan_id(ext_pan_id);
-    ESP_LOGI(TAG, "Status: Joined/Formed Network");
-    ESP_LOGI(TAG, "Extended PAN ID: %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x", ext_pan_id[7], ext_pan_id[6],
+    ESP_LOGI(kTag, "Status: Joined/Formed Network");
+    ESP_LOGI(kTag, "Extended PAN ID: %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x", ext_pan_id[7], ext_pan_id[6],
              ext_pan_id[5], ext_pan_id[4], ext_pan_id[3], ext_pan_id[2], ext_pan_id[1], ext_pan_id[0]);
-    ESP_LOGI(TAG, "PAN ID: 0x%04x", esp_zb_get_pan_id());
-    ESP_LOGI(TAG, "Channel: %d", esp_zb_get_current_channel());
-    ESP_LOGI(TAG, "Short Address: 0x%04x", esp_zb_get_short_address());
+    ESP_LOGI(kTag, "PAN ID: 0x%04x", esp_zb_get_pan_id());
+    ESP_LOGI(kTag, "Channel: %d", esp_zb_get_current_channel());
+    ESP_LOGI(kTag, "Short Address: 0x%04x", esp_zb_get_short_address());
+  }
+  esp_zb_lock_release();
+}
+
+bool zigbee_manager_is_up(void) {
+  return s_up;
+}
+
+void zigbee_manager_get_stats(zigbee_manager_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
   }
+  memset(out_stats, 0, sizeof(*out_stats));
+  out_stats->enabled = true;
+  out_stats->up = s_up;
+  if (!esp_zb_lock_acquire(pdMS_TO_TICKS(kLockTimeoutMs))) {
+    return;
+  }
+  if (s_up) {
+    out_stats->pan_id = esp_zb_get_pan_id();
+    out_stats->channel = esp_zb_get_current_channel();
+  }
+  const ZigbeeNetwork::Stats stats = s_network.stats();
+  out_stats->pending = s_network.pending();
+  out_stats->devices_announced = s_announced;
+  esp_zb_lock_release();
+  out_stats->requests = stats.requests;
+  out_stats->answered = stats.answered;
+  out_stats->refused = stats.refused;
+  out_stats->timeouts = stats.timeouts;
+  out_stats->late = stats.late;
+  out_stats->reports = stats.reports;
 }
+
+esp_err_t zigbee_manager_send_request(const void* frame, uint16_t len) {
+  if (!frame) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_up) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!esp_zb_lock_acquire(pdMS_TO_TICKS(kLockTimeoutMs))) {
+    return ESP_ERR_TIMEOUT;
+  }
+  s_network.request(static_cast<const uint8_t*>(frame), len, now_ms());
+  esp_zb_lock_release();
+  return ESP_OK;
+}
+
+esp_err_t zigbee_manager_register_frame_handler(uint8_t type, uart_link_frame_handler_t handler, void* ctx) {
+  if (!handler) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (Handler& entry : s_handlers) {
+    if (!entry.handler) {
+      entry = {type, handler, ctx};
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+#else
+
+esp_err_t zigbee_manager_init(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t zigbee_manager_start(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void zigbee_manager_print_status(void) {}
+
+bool zigbee_manager_is_up(void) {
+  return false;
+}
+
+void zigbee_manager_get_stats(zigbee_manager_stats_t* out_stats) {
+  if (out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+  }
+}
+
+esp_err_t zigbee_manager_send_request(const void* frame, uint16_t len) {
+  (void)frame;
+  (void)len;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t zigbee_manager_register_frame_handler(uint8_t type, uart_link_frame_handler_t handler, void* ctx) {
+  (void)type;
+  (void)handler;
+  (void)ctx;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif  // CONFIG_APP_ZIGBEE_NATIVE_NETWORK
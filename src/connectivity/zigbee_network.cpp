@@ -0,0 +1,161 @@
+#include "zigbee_network.h"
+
+#include <cstring>
+
+#include "uart_link_protocol.h"
+
+void ZigbeeNetwork::respond(uint8_t command, uint16_t request_id, uint8_t status, uint8_t detail, const void* body,
+                            uint16_t len) {
+  uint8_t frame[sizeof(zb_rsp_header_t) + sizeof(zb_cmd_any_response_t)];
+  const zb_rsp_header_t header = {command, status, request_id, detail};
+  memcpy(frame, &header, sizeof(header));
+  if (len) {
+    memcpy(frame + sizeof(header), body, len);
+  }
+  sink_(UART_LINK_MSG_ZB_RESPONSE, frame, static_cast<uint16_t>(sizeof(header) + len), ctx_);
+}
+
+int ZigbeeNetwork::start(uint8_t command, const uint8_t* body) {
+  switch (command) {
+    case ZB_CMD_ON_OFF: {
+      zb_cmd_on_off_t request;
+      memcpy(&request, body, sizeof(request));
+      return stack_.on_off(request.target, request.action);
+    }
+    case ZB_CMD_LEVEL: {
+      zb_cmd_level_t request;
+      memcpy(&request, body, sizeof(request));
+      return stack_.level(request.target, request.level, request.transition_ds);
+    }
+    case ZB_CMD_COLOR: {
+      zb_cmd_color_t request;
+      memcpy(&request, body, sizeof(request));
+      return stack_.color(request.target, request.x, request.y, request.transition_ds);
+    }
+    case ZB_CMD_BIND: {
+      zb_cmd_bind_t request;
+      memcpy(&request, body, sizeof(request));
+      return stack_.bind(request);
+    }
+    case ZB_CMD_READ_ATTR: {
+      zb_cmd_read_attr_t request;
+      memcpy(&request, body, sizeof(request));
+      return stack_.read_attr(request.target, request.cluster, request.attribute);
+    }
+    default:
+      return -1;
+  }
+}
+
+ZigbeeNetwork::Pending* ZigbeeNetwork::find(int transaction) {
+  for (Pending& entry : pending_) {
+    if (entry.used && entry.transaction == transaction) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+void ZigbeeNetwork::request(const uint8_t* frame, uint16_t len, uint32_t now_ms) {
+  if (len < sizeof(zb_cmd_header_t)) {
+    stats_.refused++;
+    return;
+  }
+  zb_cmd_header_t header;
+  memcpy(&header, frame, sizeof(header));
+  stats_.requests++;
+  const uint16_t expected = zb_cmd_request_size(header.command);
+  uint8_t status = ZB_CMD_STATUS_OK;
+  if (expected == 0 || header.command == ZB_CMD_SET_MODE) {
+    status = ZB_CMD_STATUS_UNKNOWN_COMMAND;
+  } else if (len - sizeof(header) != expected) {
+    status = ZB_CMD_STATUS_BAD_LENGTH;
+  }
+  Pending* slot = nullptr;
+  if (status == ZB_CMD_STATUS_OK) {
+    for (Pending& entry : pending_) {
+      if (!entry.used) {
+        slot = &entry;
+        break;
+      }
+    }
+    if (!slot) {
+      status = ZB_CMD_STATUS_BUSY;
+    }
+  }
+  int transaction = -1;
+  if (status == ZB_CMD_STATUS_OK) {
+    transaction = start(header.command, frame + sizeof(header));
+    if (transaction < 0) {
+      status = ZB_CMD_STATUS_BUSY;
+    }
+  }
+  if (status != ZB_CMD_STATUS_OK) {
+    stats_.refused++;
+    respond(header.command, header.request_id, status, 0, nullptr, 0);
+    return;
+  }
+  // A stack that reuses a transaction id before answering the old one has forgotten it.
+  Pending* stale = find(transaction);
+  if (stale) {
+    stale->used = false;
+  }
+  *slot = {true, transaction, header.command, header.request_id, now_ms};
+}
+
+void ZigbeeNetwork::on_status(int transaction, uint8_t zcl_status) {
+  Pending* entry = find(transaction);
+  if (!entry) {
+    stats_.late++;
+    return;
+  }
+  entry->used = false;
+  stats_.answered++;
+  if (zcl_status != 0) {
+    respond(entry->command, entry->request_id, ZB_CMD_STATUS_ZCL_ERROR, zcl_status, nullptr, 0);
+    return;
+  }
+  // A read answered with a bare status has no value to return.
+  const uint8_t status = entry->command == ZB_CMD_READ_ATTR ? ZB_CMD_STATUS_ZCL_ERROR : ZB_CMD_STATUS_OK;
+  respond(entry->command, entry->request_id, status, 0, nullptr, 0);
+}
+
+void ZigbeeNetwork::on_read_attr(int transaction, uint8_t zcl_status, const zb_rsp_read_attr_t& attr) {
+  Pending* entry = find(transaction);
+  if (!entry || entry->command != ZB_CMD_READ_ATTR) {
+    stats_.late++;
+    return;
+  }
+  entry->used = false;
+  stats_.answered++;
+  if (zcl_status != 0) {
+    respond(entry->command, entry->request_id, ZB_CMD_STATUS_ZCL_ERROR, zcl_status, nullptr, 0);
+    return;
+  }
+  respond(entry->command, entry->request_id, ZB_CMD_STATUS_OK, 0, &attr, sizeof(attr));
+}
+
+void ZigbeeNetwork::on_report(const zb_attr_report_t& report) {
+  stats_.reports++;
+  sink_(UART_LINK_MSG_ATTR_UPDATE, reinterpret_cast<const uint8_t*>(&report), sizeof(report), ctx_);
+}
+
+void ZigbeeNetwork::tick(uint32_t now_ms) {
+  for (Pending& entry : pending_) {
+    if (entry.used && now_ms - entry.sent_ms >= kTimeoutMs) {
+      entry.used = false;
+      stats_.timeouts++;
+      respond(entry.command, entry.request_id, ZB_CMD_STATUS_NO_ROUTE, 0, nullptr, 0);
+    }
+  }
+}
+
+size_t ZigbeeNetwork::pending() const {
+  size_t count = 0;
+  for (const Pending& entry : pending_) {
+    if (entry.used) {
+      count++;
+    }
+  }
+  return count;
+}
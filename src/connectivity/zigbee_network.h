@@ -0,0 +1,89 @@
+#ifndef ZIGBEE_NETWORK_H_
+#define ZIGBEE_NETWORK_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "zb_command_schema.h"
+
+/*
+ * The calls ZigbeeNetwork makes into a Zigbee stack: ZBOSS on the C6's own radio, a mock
+ * on the host. Each request returns a transaction id the stack later answers with
+ * ZigbeeNetwork::on_status() or on_read_attr(), or -1 when the stack refused it.
+ */
+class ZigbeeStack {
+ public:
+  virtual ~ZigbeeStack() = default;
+  virtual int on_off(const zb_cmd_target_t& target, uint8_t action) = 0;
+  virtual int level(const zb_cmd_target_t& target, uint8_t level, uint16_t transition_ds) = 0;
+  virtual int color(const zb_cmd_target_t& target, uint16_t x, uint16_t y, uint16_t transition_ds) = 0;
+  virtual int bind(const zb_cmd_bind_t& bind) = 0;
+  virtual int read_attr(const zb_cmd_target_t& target, uint16_t cluster, uint16_t attribute) = 0;
+};
+
+/*
+ * A Zigbee network run by the hub itself, behind the same typed command frames as an H2 on
+ * a UART link: request() takes a ZB_REQUEST frame, and the answer leaves through the sink
+ * as a ZB_RESPONSE frame once the device has replied, or with NO_ROUTE after kTimeoutMs.
+ * Attribute reports leave as ATTR_UPDATE frames. SET_MODE is refused; this network is
+ * always the coordinator. request() calls straight into the stack and the stack's
+ * callbacks land in on_status(), on_read_attr() and on_report(), so every call is made
+ * with the stack's lock held (esp_zb_lock on the C6, or from the Zigbee task itself).
+ */
+class ZigbeeNetwork {
+ public:
+  static constexpr size_t kPending = 8;  // matches the hub's command slots
+  static constexpr uint32_t kTimeoutMs = 3000;
+
+  // Receives frames laid out as the H2 sends them; payload is only valid during the call.
+  using Sink = void (*)(uint8_t type, const uint8_t* payload, uint16_t len, void* ctx);
+
+  struct Stats {
+    uint32_t requests;
+    uint32_t answered;  // requests the device replied to, whatever the ZCL status
+    uint32_t refused;   // bad frames, SET_MODE, stack refusals, no free slot
+    uint32_t timeouts;
+    uint32_t late;  // replies for a transaction that had already timed out
+    uint32_t reports;
+  };
+
+  ZigbeeNetwork(ZigbeeStack& stack, Sink sink, void* ctx) : stack_(stack), sink_(sink), ctx_(ctx) {}
+
+  void request(const uint8_t* frame, uint16_t len, uint32_t now_ms);
+  // Reply to transaction: ZCL status 0 is success, anything else a ZCL error.
+  void on_status(int transaction, uint8_t zcl_status);
+  void on_read_attr(int transaction, uint8_t zcl_status, const zb_rsp_read_attr_t& attr);
+  void on_report(const zb_attr_report_t& report);
+  // Answers requests that have waited kTimeoutMs; call a few times a second.
+  void tick(uint32_t now_ms);
+
+  size_t pending() const;
+  const Stats& stats() const {
+    return stats_;
+  }
+  void reset_stats() {
+    stats_ = {};
+  }
+
+ private:
+  struct Pending {
+    bool used;
+    int transaction;
+    uint8_t command;
+    uint16_t request_id;
+    uint32_t sent_ms;
+  };
+
+  void respond(uint8_t command, uint16_t request_id, uint8_t status, uint8_t detail, const void* body,
+               uint16_t len);
+  int start(uint8_t command, const uint8_t* body);
+  Pending* find(int transaction);
+
+  ZigbeeStack& stack_;
+  Sink sink_;
+  void* ctx_;
+  Pending pending_[kPending] = {};
+  Stats stats_ = {};
+};
+
+#endif  // ZIGBEE_NETWORK_H_
@@ -0,0 +1,762 @@
+#include "debug/DeferredLog.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "debug/StaticAlloc.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_APP_DEFERRED_LOG_SLOTS
+#define CONFIG_APP_DEFERRED_LOG_SLOTS 64
+#endif
+
+#ifndef CONFIG_APP_DEFERRED_LOG_TASK_PRIORITY
+#define CONFIG_APP_DEFERRED_LOG_TASK_PRIORITY 1
+#endif
+
+#ifndef CONFIG_ESP_CONSOLE_UART_BAUDRATE
+#define CONFIG_ESP_CONSOLE_UART_BAUDRATE 115200
+#endif
+
+namespace {
+
+constexpr size_t kSlotCount = CONFIG_APP_DEFERRED_LOG_SLOTS;
+constexpr size_t kSlotDataWords = 28;  // 112 bytes of arguments, 128-byte slots on the C6
+constexpr size_t kLineBufferSize = 256;
+constexpr size_t kMaxSpecLength = 24;
+constexpr uint32_t kIdlePollMs = 20;
+constexpr uint32_t kWriterStackSize = 3072;
+constexpr uint32_t kNullString = 0xFFFF;
+
+static_assert((kSlotCount & (kSlotCount - 1)) == 0, "CONFIG_APP_DEFERRED_LOG_SLOTS must be a power of two");
+
+/* Format string scanning shared by capture and formatting, so both sides agree on argument layout. */
+
+enum class ArgKind : uint8_t {
+  kPercent,
+  kInt,
+  kLong,
+  kLongLong,
+  kSize,
+  kPtrDiff,
+  kIntMax,
+  kDouble,
+  kLongDouble,
+  kString,
+  kPointer,
+  kUnsupported,
+};
+
+struct Spec {
+  const char* begin = nullptr;
+  size_t length = 0;
+  bool star_width = false;
+  bool star_precision = false;
+  int precision = -1;
+  ArgKind kind = ArgKind::kUnsupported;
+};
+
+bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Finds the next conversion spec at or after `p`. Returns the position right after it, or nullptr at the end.
+const char* next_spec(const char* p, Spec* spec) {
+  while (*p && *p != '%') {
+    ++p;
+  }
+  if (!*p) {
+    return nullptr;
+  }
+  *spec = Spec{};
+  spec->begin = p++;
+  if (*p == '%') {
+    spec->kind = ArgKind::kPercent;
+    spec->length = 2;
+    return p + 1;
+  }
+  while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+    ++p;
+  }
+  if (*p == '*') {
+    spec->star_width = true;
+    ++p;
+  } else {
+    while (is_digit(*p)) {
+      ++p;
+    }
+  }
+  if (*p == '.') {
+    ++p;
+    if (*p == '*') {
+      spec->star_precision = true;
+      ++p;
+    } else {
+      spec->precision = 0;
+      while (is_digit(*p)) {
+        spec->precision = spec->precision * 10 + (*p - '0');
+        ++p;
+      }
+    }
+  }
+  int longs = 0;
+  char size_mod = 0;
+  while (*p == 'h' || *p == 'l' || *p == 'j' || *p == 'z' || *p == 't' || *p == 'L') {
+    if (*p == 'l') {
+      ++longs;
+    } else {
+      size_mod = *p;
+    }
+    ++p;
+  }
+  const char conv = *p;
+  if (!conv) {
+    return nullptr;
+  }
+  ++p;
+  spec->length = static_cast<size_t>(p - spec->begin);
+  switch (conv) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+      if (size_mod == 'z') {
+        spec->kind = ArgKind::kSize;
+      } else if (size_mod == 't') {
+        spec->kind = ArgKind::kPtrDiff;
+      } else if (size_mod == 'j') {
+        spec->kind = ArgKind::kIntMax;
+      } else if (longs >= 2) {
+        spec->kind = ArgKind::kLongLong;
+      } else if (longs == 1) {
+        spec->kind = ArgKind::kLong;
+      } else {
+        spec->kind = ArgKind::kInt;
+      }
+      break;
+    case 'c':
+      spec->kind = ArgKind::kInt;
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec->kind = size_mod == 'L' ? ArgKind::kLongDouble : ArgKind::kDouble;
+      break;
+    case 's':
+      spec->kind = longs ? ArgKind::kUnsupported : ArgKind::kString;
+      break;
+    case 'p':
+      spec->kind = ArgKind::kPointer;
+      break;
+    default:
+      spec->kind = ArgKind::kUnsupported;
+      break;
+  }
+  return p;
+}
+
+struct Record {
+  std::atomic<uint32_t> sequence{0};
+  const char* fmt = nullptr;
+  uint32_t timestamp_ms = 0;  // esp_log_timestamp() units, taken when the line was logged
+  uint16_t used_words = 0;
+  uint8_t truncated = 0;
+  uint8_t reserved = 0;
+  uint32_t data[kSlotDataWords] = {};
+};
+
+class ArgWriter {
+ public:
+  explicit ArgWriter(Record& record) : record_(record) {
+  }
+
+  template <typename T>
+  bool put(T value) {
+    constexpr size_t words = (sizeof(T) + 3) / 4;
+    if (record_.used_words + words > kSlotDataWords) {
+      return false;
+    }
+    memcpy(&record_.data[record_.used_words], &value, sizeof(T));
+    record_.used_words += words;
+    return true;
+  }
+
+  bool put_string(const char* str, int precision) {
+    if (!str) {
+      return put(kNullString);
+    }
+    // One header word with the length, then the bytes plus a terminator.
+    if (static_cast<size_t>(record_.used_words) + 2 > kSlotDataWords) {
+      return false;
+    }
+    const size_t room = (kSlotDataWords - record_.used_words - 1) * 4 - 1;
+    size_t limit = room;
+    if (precision >= 0 && static_cast<size_t>(precision) < limit) {
+      limit = static_cast<size_t>(precision);
+    }
+    const size_t len = strnlen(str, limit);
+    if (len == room && str[len] != '\0') {
+      record_.truncated = 1;
+    }
+    record_.data[record_.used_words++] = static_cast<uint32_t>(len);
+    char* dst = reinterpret_cast<char*>(&record_.data[record_.used_words]);
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    record_.used_words += (len + 1 + 3) / 4;
+    return true;
+  }
+
+ private:
+  Record& record_;
+};
+
+class ArgReader {
+ public:
+  explicit ArgReader(const Record& record) : record_(record) {
+  }
+
+  template <typename T>
+  bool get(T* value) {
+    constexpr size_t words = (sizeof(T) + 3) / 4;
+    if (pos_ + words > record_.used_words) {
+      return false;
+    }
+    memcpy(value, &record_.data[pos_], sizeof(T));
+    pos_ += words;
+    return true;
+  }
+
+  bool get_string(const char** str) {
+    uint32_t len = 0;
+    if (!get(&len)) {
+      return false;
+    }
+    if (len == kNullString) {
+      *str = nullptr;
+      return true;
+    }
+    const size_t words = (len + 1 + 3) / 4;
+    if (pos_ + words > record_.used_words) {
+      return false;
+    }
+    *str = reinterpret_cast<const char*>(&record_.data[pos_]);
+    pos_ += words;
+    return true;
+  }
+
+ private:
+  const Record& record_;
+  size_t pos_ = 0;
+};
+
+bool capture_args(const char* fmt, va_list args, Record& record) {
+  ArgWriter writer(record);
+  Spec spec;
+  const char* p = fmt;
+  while ((p = next_spec(p, &spec)) != nullptr) {
+    if (spec.kind == ArgKind::kPercent) {
+      continue;
+    }
+    if (spec.star_width && !writer.put(va_arg(args, int))) {
+      return false;
+    }
+    int precision = spec.precision;
+    if (spec.star_precision) {
+      precision = va_arg(args, int);
+      if (!writer.put(precision)) {
+        return false;
+      }
+    }
+    bool ok = false;
+    switch (spec.kind) {
+      case ArgKind::kInt:
+        ok = writer.put(va_arg(args, int));
+        break;
+      case ArgKind::kLong:
+        ok = writer.put(va_arg(args, long));
+        break;
+      case ArgKind::kLongLong:
+        ok = writer.put(va_arg(args, long long));
+        break;
+      case ArgKind::kSize:
+        ok = writer.put(va_arg(args, size_t));
+        break;
+      case ArgKind::kPtrDiff:
+        ok = writer.put(va_arg(args, ptrdiff_t));
+        break;
+      case ArgKind::kIntMax:
+        ok = writer.put(va_arg(args, intmax_t));
+        break;
+      case ArgKind::kDouble:
+        ok = writer.put(va_arg(args, double));
+        break;
+      case ArgKind::kLongDouble:
+        ok = writer.put(va_arg(args, long double));
+        break;
+      case ArgKind::kPointer:
+        ok = writer.put(va_arg(args, void*));
+        break;
+      case ArgKind::kString:
+        ok = writer.put_string(va_arg(args, const char*), precision);
+        break;
+      default:
+        break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class LineBuffer {
+ public:
+  LineBuffer(char* buf, size_t cap) : buf_(buf), cap_(cap) {
+    buf_[0] = '\0';
+  }
+
+  void append(const char* text, size_t len) {
+    const size_t room = cap_ - 1 - len_;
+    if (len > room) {
+      len = room;
+    }
+    memcpy(buf_ + len_, text, len);
+    len_ += len;
+    buf_[len_] = '\0';
+  }
+
+  template <typename T>
+  void append_arg(const char* spec, const Spec& s, int width, int precision, T value) {
+    char* dst = buf_ + len_;
+    const size_t room = cap_ - len_;
+    int n = 0;
+    if (s.star_width && s.star_precision) {
+      n = snprintf(dst, room, spec, width, precision, value);
+    } else if (s.star_width) {
+      n = snprintf(dst, room, spec, width, value);
+    } else if (s.star_precision) {
+      n = snprintf(dst, room, spec, precision, value);
+    } else {
+      n = snprintf(dst, room, spec, value);
+    }
+    if (n > 0) {
+      len_ += static_cast<size_t>(n) < room ? static_cast<size_t>(n) : room - 1;
+    }
+  }
+
+  size_t length() const {
+    return len_;
+  }
+
+ private:
+  char* buf_;
+  size_t cap_;
+  size_t len_ = 0;
+};
+
+template <typename T>
+bool format_value(ArgReader& reader, LineBuffer& line, const char* spec, const Spec& s, int width, int precision) {
+  T value{};
+  if (!reader.get(&value)) {
+    return false;
+  }
+  line.append_arg(spec, s, width, precision, value);
+  return true;
+}
+
+// True when fmt starts with an esp_log header ("I (%lu) TAG: ", optionally coloured), whose
+// time argument was captured with the rest when the line was logged.
+bool has_log_header(const char* fmt) {
+  if (fmt[0] == '\033') {
+    fmt = strchr(fmt, 'm');
+    if (!fmt) {
+      return false;
+    }
+    ++fmt;
+  }
+  return fmt[0] != '\0' && strchr("EWIDV", fmt[0]) && fmt[1] == ' ' && fmt[2] == '(';
+}
+
+size_t format_record(const Record& record, char* out, size_t cap) {
+  LineBuffer line(out, cap);
+  if (!has_log_header(record.fmt)) {
+    // Lines without a header get the capture time, not the time the writer got to them.
+    char stamp[16];
+    const int n = snprintf(stamp, sizeof(stamp), "(%lu) ", static_cast<unsigned long>(record.timestamp_ms));
+    line.append(stamp, static_cast<size_t>(n));
+  }
+  ArgReader reader(record);
+  Spec spec;
+  const char* literal = record.fmt;
+  const char* p = record.fmt;
+  bool complete = true;
+  while ((p = next_spec(p, &spec)) != nullptr) {
+    line.append(literal, static_cast<size_t>(spec.begin - literal));
+    literal = p;
+    if (spec.kind == ArgKind::kPercent) {
+      line.append("%", 1);
+      continue;
+    }
+    if (spec.kind == ArgKind::kUnsupported || spec.length >= kMaxSpecLength) {
+      complete = false;
+      break;
+    }
+    char spec_text[kMaxSpecLength];
+    memcpy(spec_text, spec.begin, spec.length);
+    spec_text[spec.length] = '\0';
+    int width = 0;
+    int precision = 0;
+    if ((spec.star_width && !reader.get(&width)) || (spec.star_precision && !reader.get(&precision))) {
+      complete = false;
+      break;
+    }
+    bool ok = false;
+    switch (spec.kind) {
+      case ArgKind::kInt:
+        ok = format_value<int>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kLong:
+        ok = format_value<long>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kLongLong:
+        ok = format_value<long long>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kSize:
+        ok = format_value<size_t>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kPtrDiff:
+        ok = format_value<ptrdiff_t>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kIntMax:
+        ok = format_value<intmax_t>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kDouble:
+        ok = format_value<double>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kLongDouble:
+        ok = format_value<long double>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kPointer:
+        ok = format_value<void*>(reader, line, spec_text, spec, width, precision);
+        break;
+      case ArgKind::kString: {
+        const char* str = nullptr;
+        ok = reader.get_string(&str);
+        if (ok) {
+          line.append_arg(spec_text, spec, width, precision, str ? str : "(null)");
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    if (!ok) {
+      complete = false;
+      break;
+    }
+  }
+  if (complete) {
+    line.append(literal, strlen(literal));
+  } else {
+    static const char kTruncated[] = " <truncated>\n";
+    line.append(kTruncated, sizeof(kTruncated) - 1);
+  }
+  return line.length();
+}
+
+/*
+ * Bounded multi-producer ring (per-slot sequence numbers). Producers never block: a full
+ * ring is reported to the caller. Consumption is serialized by s_drain_lock.
+ */
+template <size_t N>
+class Ring {
+ public:
+  void reset() {
+    for (size_t i = 0; i < N; ++i) {
+      slots_[i].sequence.store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+    }
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_release);
+  }
+
+  bool push(const char* fmt, va_list args, uint32_t timestamp_ms, bool* truncated) {
+    uint32_t pos = head_.load(std::memory_order_relaxed);
+    Record* slot = nullptr;
+    while (true) {
+      slot = &slots_[pos & (N - 1)];
+      const uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+      const int32_t diff = static_cast<int32_t>(seq - pos);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->fmt = fmt;
+    slot->timestamp_ms = timestamp_ms;
+    slot->used_words = 0;
+    slot->truncated = 0;
+    if (!capture_args(fmt, args, *slot)) {
+      slot->truncated = 1;
+    }
+    *truncated = slot->truncated != 0;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  template <typename Fn>
+  bool consume(Fn&& fn) {
+    const uint32_t pos = tail_.load(std::memory_order_relaxed);
+    Record& slot = slots_[pos & (N - 1)];
+    const uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+    if (static_cast<int32_t>(seq - (pos + 1)) < 0) {
+      return false;
+    }
+    fn(static_cast<const Record&>(slot));
+    slot.sequence.store(pos + N, std::memory_order_release);
+    tail_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t occupancy() const {
+    return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  Record slots_[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
+
+Ring<kSlotCount> s_rings[portNUM_PROCESSORS];
+Ring<4> s_bench_ring;
+vprintf_like_t s_sink = nullptr;
+SemaphoreHandle_t s_drain_lock = nullptr;
+TaskHandle_t s_writer_task = nullptr;
+debug::StaticMutex s_drain_lock_storage;
+debug::StaticTask<kWriterStackSize> s_writer_storage;
+std::atomic<bool> s_ready{false};
+std::atomic<uint32_t> s_captured{0};
+std::atomic<uint32_t> s_written{0};
+std::atomic<uint32_t> s_dropped{0};
+std::atomic<uint32_t> s_truncated{0};
+std::atomic<uint32_t> s_high_water{0};
+std::atomic<uint32_t> s_hold_spills{0};
+std::atomic<bool> s_hold{false};
+uint32_t s_reported_drops = 0;
+char s_line[kLineBufferSize];
+
+int call_sink(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  const int rc = s_sink ? s_sink(fmt, args) : vprintf(fmt, args);
+  va_end(args);
+  return rc;
+}
+
+void note_occupancy(uint32_t occupancy) {
+  uint32_t seen = s_high_water.load(std::memory_order_relaxed);
+  while (occupancy > seen && !s_high_water.compare_exchange_weak(seen, occupancy, std::memory_order_relaxed)) {
+  }
+}
+
+// Caller holds s_drain_lock.
+uint32_t drain_locked() {
+  uint32_t count = 0;
+  for (auto& ring : s_rings) {
+    while (ring.consume([](const Record& record) { format_record(record, s_line, sizeof(s_line)); })) {
+      call_sink("%s", s_line);
+      ++count;
+    }
+  }
+  const uint32_t dropped = s_dropped.load(std::memory_order_relaxed);
+  if (dropped != s_reported_drops) {
+    call_sink("W (%lu) DLOG: %lu log lines dropped (ring full)\n", (unsigned long)(esp_timer_get_time() / 1000),
+              (unsigned long)(dropped - s_reported_drops));
+    s_reported_drops = dropped;
+  }
+  s_written.fetch_add(count, std::memory_order_relaxed);
+  return count;
+}
+
+bool held_below_spill_mark() {
+  if (!s_hold.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  if (deferred_log_pending() * 4 < kSlotCount * portNUM_PROCESSORS * 3) {
+    return true;
+  }
+  s_hold_spills.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void writer_task(void*) {
+  while (true) {
+    if (held_below_spill_mark() || deferred_log_flush() == 0) {
+      vTaskDelay(pdMS_TO_TICKS(kIdlePollMs));
+    }
+  }
+}
+
+int bench_format(char* out, size_t cap, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  const int rc = vsnprintf(out, cap, fmt, args);
+  va_end(args);
+  return rc;
+}
+
+uint32_t now_ms() {
+  return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+bool bench_capture(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  bool truncated = false;
+  const bool ok = s_bench_ring.push(fmt, args, now_ms(), &truncated);
+  va_end(args);
+  return ok;
+}
+
+}  // namespace
+
+esp_err_t deferred_log_init(vprintf_like_t sink) {
+  if (s_ready.load(std::memory_order_acquire)) {
+    return ESP_OK;
+  }
+  s_sink = sink;
+  for (auto& ring : s_rings) {
+    ring.reset();
+  }
+  if (!s_drain_lock) {
+    s_drain_lock = s_drain_lock_storage.create(MEM_BUDGET_DEBUG);
+    if (!s_drain_lock) {
+      return ESP_ERR_NO_MEM;
+    }
+    mem_budget_charge(MEM_BUDGET_DEBUG, MEM_BUDGET_BUFFER, sizeof(s_rings), false);
+  }
+  if (s_writer_storage.create(writer_task, "log_writer", nullptr, CONFIG_APP_DEFERRED_LOG_TASK_PRIORITY,
+                              &s_writer_task, MEM_BUDGET_DEBUG) != pdPASS) {
+    return ESP_FAIL;
+  }
+  s_ready.store(true, std::memory_order_release);
+  return ESP_OK;
+}
+
+int deferred_log_vprintf(const char* fmt, va_list args) {
+  if (!s_ready.load(std::memory_order_acquire)) {
+    return s_sink ? s_sink(fmt, args) : vprintf(fmt, args);
+  }
+  // esp_log ignores the result, so the line is not measured: that would be the format pass
+  // the ring exists to take off the caller.
+  const int core = portNUM_PROCESSORS > 1 ? xPortGetCoreID() : 0;
+  auto& ring = s_rings[core];
+  bool truncated = false;
+  if (!ring.push(fmt, args, now_ms(), &truncated)) {
+    s_dropped.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  s_captured.fetch_add(1, std::memory_order_relaxed);
+  if (truncated) {
+    s_truncated.fetch_add(1, std::memory_order_relaxed);
+  }
+  note_occupancy(ring.occupancy());
+  return 0;
+}
+
+uint32_t deferred_log_flush(void) {
+  if (!s_ready.load(std::memory_order_acquire)) {
+    return 0;
+  }
+  xSemaphoreTake(s_drain_lock, portMAX_DELAY);
+  const uint32_t count = drain_locked();
+  xSemaphoreGive(s_drain_lock);
+  return count;
+}
+
+uint32_t deferred_log_pending(void) {
+  uint32_t pending = 0;
+  for (const auto& ring : s_rings) {
+    pending += ring.occupancy();
+  }
+  return pending;
+}
+
+void deferred_log_set_hold(bool hold) {
+  s_hold.store(hold, std::memory_order_relaxed);
+}
+
+bool deferred_log_is_held(void) {
+  return s_hold.load(std::memory_order_relaxed);
+}
+
+void deferred_log_get_stats(deferred_log_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  out_stats->captured = s_captured.load(std::memory_order_relaxed);
+  out_stats->written = s_written.load(std::memory_order_relaxed);
+  out_stats->dropped = s_dropped.load(std::memory_order_relaxed);
+  out_stats->truncated = s_truncated.load(std::memory_order_relaxed);
+  out_stats->high_water = s_high_water.load(std::memory_order_relaxed);
+  out_stats->capacity = kSlotCount * portNUM_PROCESSORS;
+  out_stats->hold_spills = s_hold_spills.load(std::memory_order_relaxed);
+}
+
+esp_err_t deferred_log_benchmark(uint32_t iterations, deferred_log_bench_t* out_result) {
+  if (!out_result || iterations == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // Same shape as the hot UART link log in handle_frame().
+  static const char kFmt[] = "I (%lu) %s: Zigbee signal: %.*s\n";
+  static const char kTag[] = "ZB_LINK";
+  static const char kPayload[] = "zdo_signal=DEVICE_ANNCE short=0x1a2b ieee=00:12:4b:00:1c:aa:bb:cc";
+  const int payload_len = static_cast<int>(sizeof(kPayload) - 1);
+  char scratch[kLineBufferSize];
+
+  uint64_t format_total = 0;
+  int line_bytes = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const uint32_t start = esp_cpu_get_cycle_count();
+    line_bytes = bench_format(scratch, sizeof(scratch), kFmt, (unsigned long)i, kTag, payload_len, kPayload);
+    format_total += esp_cpu_get_cycle_count() - start;
+  }
+
+  s_bench_ring.reset();
+  uint64_t capture_total = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const uint32_t start = esp_cpu_get_cycle_count();
+    bench_capture(kFmt, (unsigned long)i, kTag, payload_len, kPayload);
+    capture_total += esp_cpu_get_cycle_count() - start;
+    s_bench_ring.consume([](const Record&) {});
+  }
+
+  out_result->iterations = iterations;
+  out_result->line_bytes = line_bytes > 0 ? static_cast<uint32_t>(line_bytes) : 0;
+  out_result->format_cycles = static_cast<uint32_t>(format_total / iterations);
+  out_result->capture_cycles = static_cast<uint32_t>(capture_total / iterations);
+  out_result->console_wire_us =
+      static_cast<uint32_t>((uint64_t)out_result->line_bytes * 10 * 1000000 / CONFIG_ESP_CONSOLE_UART_BAUDRATE);
+  out_result->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+  return ESP_OK;
+}
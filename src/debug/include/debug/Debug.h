@@ -16,6 +16,64 @@
 
 #define DEBUG_BOOL_STR(value) ((value) ? "true" : "false")
 
+#ifdef __cplusplus
+
+/*
+ * C++: the level comes from the per-tag table in Trace.h (DEBUG_LEVEL for unlisted tags) and is
+ * resolved at compile time. Enabled sites record a binary event into the trace ring ('trace dump');
+ * disabled sites compile to nothing.
+ *   1 enter/exit, 2 parameters, 4 heap snapshots, 5 call sites
+ * DEBUG_PROFILE() zones and the heap snapshot table ('prof dump') are switched by
+ * CONFIG_APP_PROFILE_ZONES instead, for every tag.
+ */
+#include "Profile.h"
+#include "Trace.h"
+
+#define DEBUG_CONCAT_INNER(a, b) a##b
+#define DEBUG_CONCAT(a, b) DEBUG_CONCAT_INNER(a, b)
+
+#define DEBUG_TRACE_LEVEL (::debug::trace::level_for(DEBUG_TAG, DEBUG_LEVEL))
+#define DEBUG_TRACE_EVENT(min_level, kind, label, arg)                                                        \
+  do {                                                                                                        \
+    if constexpr (DEBUG_TRACE_LEVEL >= (min_level)) {                                                         \
+      ::debug::trace::record(::debug::trace::Kind::kind, ::debug::trace::tag_id(DEBUG_TAG), __func__, label, \
+                             static_cast<int32_t>(arg));                                                     \
+    }                                                                                                         \
+  } while (0)
+
+#define DEBUG_FUNC_ENTER() DEBUG_TRACE_EVENT(1, kEnter, nullptr, 0)
+#define DEBUG_FUNC_EXIT() DEBUG_TRACE_EVENT(1, kExit, nullptr, 0)
+#define DEBUG_FUNC_EXIT_RC(rc) DEBUG_TRACE_EVENT(1, kExitRc, nullptr, (rc))
+
+#define DEBUG_PARAM_INT(name, value) DEBUG_TRACE_EVENT(2, kParamInt, name, (value))
+#define DEBUG_PARAM_UINT(name, value) DEBUG_TRACE_EVENT(2, kParamUint, name, (value))
+#define DEBUG_PARAM_BOOL(name, value) DEBUG_TRACE_EVENT(2, kParamBool, name, ((value) ? 1 : 0))
+#define DEBUG_PARAM_STR(name, value) DEBUG_TRACE_EVENT(2, kParamStr, name, ::debug::trace::pack_str(value))
+#define DEBUG_PARAM_PTR(name, value) DEBUG_TRACE_EVENT(2, kParamPtr, name, ::debug::trace::ptr_bits(value))
+
+#if defined(CONFIG_APP_PROFILE_ZONES)
+// Times the rest of the enclosing scope into a zone called `name` (a string literal or __func__).
+#define DEBUG_PROFILE_ZONE(name) DEBUG_PROFILE_ZONE_ID(name, __COUNTER__)
+#define DEBUG_PROFILE_ZONE_ID(name, id)                                 \
+  static ::debug::profile::Zone DEBUG_CONCAT(_debug_zone_, id){name}; \
+  ::debug::profile::Scope DEBUG_CONCAT(_debug_scope_, id) {           \
+    DEBUG_CONCAT(_debug_zone_, id)                                    \
+  }
+#define DEBUG_MEM_SNAPSHOT(label)                                                                     \
+  do {                                                                                                \
+    ::debug::profile::mem_snapshot(label);                                                            \
+    DEBUG_TRACE_EVENT(4, kMem, label, ::debug::trace::free_internal_heap());                          \
+  } while (0)
+#else
+#define DEBUG_PROFILE_ZONE(name) ((void)0)
+#define DEBUG_MEM_SNAPSHOT(label) DEBUG_TRACE_EVENT(4, kMem, label, ::debug::trace::free_internal_heap())
+#endif
+#define DEBUG_PROFILE() DEBUG_PROFILE_ZONE(__func__)
+#define DEBUG_STACK_TRACE() \
+  DEBUG_TRACE_EVENT(5, kStack, nullptr, ::debug::trace::ptr_bits(__builtin_return_address(0)))
+
+#else  // C: global DEBUG_LEVEL, logged through ESP_LOGD
+
 #if DEBUG_LEVEL >= 1
 #define DEBUG_FUNC_ENTER() ESP_LOGD(DEBUG_TAG, "ENTER %s", __func__)
 #define DEBUG_FUNC_EXIT() ESP_LOGD(DEBUG_TAG, "EXIT %s", __func__)
@@ -64,4 +122,6 @@
 #define DEBUG_STACK_TRACE() ((void)0)
 #endif
 
+#endif  // __cplusplus
+
 #endif  // DEBUG_DEBUG_H_
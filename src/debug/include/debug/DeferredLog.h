@@ -0,0 +1,93 @@
+#ifndef DEBUG_DEFERRED_LOG_H_
+#define DEBUG_DEFERRED_LOG_H_
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred (binary) logging backend.
+ *
+ * deferred_log_vprintf() is meant to be installed behind esp_log_set_vprintf().
+ * Instead of formatting, it walks the format string, copies the raw arguments
+ * (strings by value, everything else as machine words) plus the format pointer
+ * and a timestamp into a lock-free per-core ring, and returns. A low-priority
+ * writer task formats the records later and hands the text to the sink. Lines
+ * without an esp_log header are prefixed with "(<ms>) ", the time they were logged.
+ */
+
+typedef struct {
+  uint32_t captured;     // records stored in the ring
+  uint32_t written;      // records formatted and handed to the sink
+  uint32_t dropped;      // records lost because the ring was full
+  uint32_t truncated;    // records whose arguments did not fit in one slot
+  uint32_t high_water;   // maximum ring occupancy seen (slots)
+  uint32_t capacity;     // ring capacity (slots, all cores)
+  uint32_t hold_spills;  // times a held ring reached 3/4 full and was written out anyway
+} deferred_log_stats_t;
+
+typedef struct {
+  uint32_t iterations;
+  uint32_t line_bytes;       // formatted length of the benchmark line
+  uint32_t format_cycles;    // mean cycles per synchronous vsnprintf of the line
+  uint32_t capture_cycles;   // mean cycles per deferred capture of the same line
+  uint32_t console_wire_us;  // time the line occupies the console UART at its baud rate
+  uint32_t cpu_mhz;
+} deferred_log_bench_t;
+
+/**
+ * @brief Allocate the rings and start the writer task.
+ *
+ * @param sink Function that receives formatted lines (usually the vprintf that
+ *             esp_log_set_vprintf() returned). NULL selects vprintf.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t deferred_log_init(vprintf_like_t sink);
+
+/**
+ * @brief esp_log vprintf hook. Captures the record and returns without waiting for the
+ *        console. Falls back to the sink synchronously until deferred_log_init() ran.
+ * @return 0 once captured (the line length is not known until the writer formats it),
+ *         or -1 if the ring was full and the line dropped.
+ */
+int deferred_log_vprintf(const char* fmt, va_list args);
+
+/**
+ * @brief Format and write every pending record from the calling task.
+ * @return Number of records written.
+ */
+uint32_t deferred_log_flush(void);
+
+/**
+ * @brief Number of records currently waiting in the rings.
+ */
+uint32_t deferred_log_pending(void);
+
+/**
+ * @brief Hold records in the rings instead of writing them (e.g. while the user edits a
+ *        console line). Records are kept, not dropped; a held ring that reaches 3/4 full is
+ *        written out anyway so a long hold cannot turn into drops.
+ */
+void deferred_log_set_hold(bool hold);
+bool deferred_log_is_held(void);
+
+void deferred_log_get_stats(deferred_log_stats_t* out_stats);
+
+/**
+ * @brief Compare the per-call cost of synchronous formatting and deferred capture.
+ *        Uses a private ring, so nothing reaches the console.
+ */
+esp_err_t deferred_log_benchmark(uint32_t iterations, deferred_log_bench_t* out_result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DEBUG_DEFERRED_LOG_H_
@@ -0,0 +1,148 @@
+#ifndef DEBUG_HISTOGRAM_H_
+#define DEBUG_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace debug {
+
+/*
+ * Log-linear histogram of 32-bit samples (cycles, microseconds, byte counts).
+ *
+ * Values below 2 * 2^SubBits get a bucket each; above that every power of two is
+ * split into 2^SubBits buckets, so percentiles are accurate to 1 / 2^SubBits of the
+ * value. Recording is a handful of relaxed 32-bit atomics, which are lock-free on the
+ * C6 (64-bit ones take a critical section there), and never blocks, so it is safe from
+ * any task. There is no running sum for that reason: sum and mean are estimated from the
+ * bucket midpoints, exact below kLinearBuckets and within 1 / 2^(SubBits + 1) above.
+ * Readers may see a sample counted in `count` but not yet in its bucket; summaries are
+ * approximate by design.
+ */
+template <unsigned SubBits = 2>
+class Histogram {
+ public:
+  static constexpr unsigned kSubBuckets = 1u << SubBits;
+  static constexpr unsigned kLinearBuckets = 2 * kSubBuckets;
+  static constexpr unsigned kBuckets = kLinearBuckets + (32 - (SubBits + 1)) * kSubBuckets;
+
+  struct Summary {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint64_t sum;  // estimated from the buckets
+  };
+
+  constexpr Histogram() = default;
+
+  void record(uint32_t value) {
+    buckets_[bucket_for(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t seen = min_.load(std::memory_order_relaxed);
+    while (value < seen && !min_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+    seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint32_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  // Upper bound of the bucket holding the `percent`th percentile, clamped to the observed maximum.
+  uint32_t percentile(uint32_t percent) const {
+    const uint32_t total = count();
+    if (total == 0) {
+      return 0;
+    }
+    const uint64_t rank = (static_cast<uint64_t>(total) * percent + 99) / 100;
+    const uint32_t max = max_.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < kBuckets; ++i) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen >= rank && seen > 0) {
+        const uint32_t upper = bucket_upper(i);
+        return upper < max ? upper : max;
+      }
+    }
+    return max;
+  }
+
+  Summary summarize() const {
+    Summary summary = {};
+    summary.count = count();
+    if (summary.count == 0) {
+      return summary;
+    }
+    uint64_t counted = 0;
+    for (unsigned i = 0; i < kBuckets; ++i) {
+      const uint32_t n = buckets_[i].load(std::memory_order_relaxed);
+      counted += n;
+      summary.sum += static_cast<uint64_t>(n) * (bucket_lower(i) + (bucket_upper(i) - bucket_lower(i)) / 2);
+    }
+    summary.min = min_.load(std::memory_order_relaxed);
+    summary.max = max_.load(std::memory_order_relaxed);
+    summary.mean = counted ? static_cast<uint32_t>(summary.sum / counted) : 0;
+    summary.p50 = percentile(50);
+    summary.p90 = percentile(90);
+    summary.p99 = percentile(99);
+    return summary;
+  }
+
+  void reset() {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    min_.store(UINT32_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  static constexpr unsigned bucket_for(uint32_t value) {
+    if (value < kLinearBuckets) {
+      return value;
+    }
+    const unsigned exponent = 31 - static_cast<unsigned>(__builtin_clz(value));
+    const unsigned sub = (value >> (exponent - SubBits)) & (kSubBuckets - 1);
+    return kLinearBuckets + (exponent - (SubBits + 1)) * kSubBuckets + sub;
+  }
+
+  static constexpr uint32_t bucket_lower(unsigned index) {
+    if (index < kLinearBuckets) {
+      return index;
+    }
+    const unsigned offset = index - kLinearBuckets;
+    const unsigned exponent = offset / kSubBuckets + SubBits + 1;
+    return static_cast<uint32_t>(kSubBuckets + offset % kSubBuckets) << (exponent - SubBits);
+  }
+
+  static constexpr uint32_t bucket_upper(unsigned index) {
+    if (index < kLinearBuckets) {
+      return index;
+    }
+    const unsigned exponent = (index - kLinearBuckets) / kSubBuckets + SubBits + 1;
+    return bucket_lower(index) + ((1u << (exponent - SubBits)) - 1);
+  }
+
+ private:
+  std::atomic<uint32_t> buckets_[kBuckets] = {};
+  std::atomic<uint32_t> count_{0};
+  std::atomic<uint32_t> min_{UINT32_MAX};
+  std::atomic<uint32_t> max_{0};
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Histogram::record() must not lock");
+
+static_assert(Histogram<>::bucket_for(7) == 7 && Histogram<>::bucket_for(8) == 8, "linear range");
+static_assert(Histogram<>::bucket_lower(Histogram<>::bucket_for(1000)) <= 1000 &&
+                  Histogram<>::bucket_upper(Histogram<>::bucket_for(1000)) >= 1000,
+              "bucket bounds");
+static_assert(Histogram<>::bucket_for(UINT32_MAX) == Histogram<>::kBuckets - 1, "top bucket");
+
+}  // namespace debug
+
+#endif  // DEBUG_HISTOGRAM_H_
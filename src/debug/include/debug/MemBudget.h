@@ -0,0 +1,67 @@
+#ifndef DEBUG_MEM_BUDGET_H_
+#define DEBUG_MEM_BUDGET_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * RAM ledger of the long-lived objects each subsystem creates at boot.
+ *
+ * Every task stack, kernel object (TCB, queue, mutex, event group) and fixed buffer is
+ * charged here when it is created, tagged with whether it was reserved at link time
+ * (CONFIG_APP_STATIC_ALLOCATION, see StaticAlloc.h) or taken from the heap. 'mem' and
+ * the boot report print the table and the static total against
+ * CONFIG_APP_STATIC_RAM_BUDGET_KB. The CI check of the same budget is the 'ram_budget'
+ * build target, which reads the linker map instead.
+ */
+
+typedef enum {
+  MEM_BUDGET_LINK = 0,  // UART links to the co-processors
+  MEM_BUDGET_ZIGBEE,    // command routing and the native network
+  MEM_BUDGET_HISTORY,
+  MEM_BUDGET_NET,       // WiFi and BLE
+  MEM_BUDGET_DEBUG,     // deferred log, telemetry
+  MEM_BUDGET_CLI,       // response arena
+  MEM_BUDGET_SUBSYSTEM_COUNT,
+} mem_budget_subsystem_t;
+
+typedef enum {
+  MEM_BUDGET_STACK = 0,
+  MEM_BUDGET_KERNEL,  // TCBs and queue/semaphore/event group control blocks
+  MEM_BUDGET_BUFFER,  // queue storage, rings, tables
+  MEM_BUDGET_KIND_COUNT,
+} mem_budget_kind_t;
+
+typedef struct {
+  uint32_t bytes[MEM_BUDGET_KIND_COUNT];
+  uint32_t heap_bytes;  // part of the above taken from the heap
+  uint16_t objects;
+} mem_budget_entry_t;
+
+/**
+ * @brief Record `bytes` held by `subsystem` for the rest of the uptime.
+ */
+void mem_budget_charge(mem_budget_subsystem_t subsystem, mem_budget_kind_t kind, uint32_t bytes, bool from_heap);
+
+void mem_budget_get(mem_budget_subsystem_t subsystem, mem_budget_entry_t* out_entry);
+
+/**
+ * @brief Bytes charged as reserved at link time, over all subsystems.
+ */
+uint32_t mem_budget_static_total(void);
+
+/**
+ * @brief Print the per-subsystem table, the static total against the budget and the heap state.
+ *        Warns when the static total is over CONFIG_APP_STATIC_RAM_BUDGET_KB.
+ */
+void mem_budget_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DEBUG_MEM_BUDGET_H_
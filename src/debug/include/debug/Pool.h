@@ -0,0 +1,449 @@
+#ifndef DEBUG_POOL_H_
+#define DEBUG_POOL_H_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/*
+ * Fixed-block pools and bump arenas.
+ *
+ * A Pool hands out blocks of one size from storage reserved with it, in O(1) and without
+ * locks: the free list is a tagged index head swapped with compare-and-swap, so alloc and
+ * free are safe from any task and never block. A PoolSet puts a few pools of growing
+ * block size behind one allocate(bytes). An Arena is a bump allocator over one buffer for
+ * the objects of a single request (a CLI or API response): each allocation is a pointer
+ * bump and the whole request is released at once by rewinding or resetting it.
+ * PoolAllocator and ArenaAllocator adapt both to STL containers.
+ *
+ * Pools and arenas register themselves on first use and are listed by 'pool'; usage,
+ * high-water mark and failed allocations are kept per pool and arena.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  DEBUG_POOL_BENCH_FRAME = 0,  // one 64-byte message allocated and freed per frame
+  DEBUG_POOL_BENCH_CHURN,      // 160-byte records with 32 live, replaced oldest first
+  DEBUG_POOL_BENCH_RESPONSE,   // 24 allocations of 16-800 bytes, then all released
+  DEBUG_POOL_BENCH_COUNT,
+} debug_pool_bench_scenario_t;
+
+typedef struct {
+  uint32_t iterations;
+  uint32_t cpu_mhz;
+  uint32_t malloc_cycles[DEBUG_POOL_BENCH_COUNT];  // mean cycles per allocate + free with malloc/free
+  uint32_t pool_cycles[DEBUG_POOL_BENCH_COUNT];    // the same with a pool (an arena for RESPONSE)
+} debug_pool_bench_t;
+
+/**
+ * @brief Print every registered pool and arena: geometry, in use, high-water mark, failures.
+ */
+void debug_pool_dump(void);
+
+/**
+ * @brief Restart the high-water marks at current use and clear the counters.
+ */
+void debug_pool_reset(void);
+
+/**
+ * @brief Time hub-typical allocation patterns with malloc/free and with a pool or arena.
+ *        The pools it uses are its own, taken from the heap for the run and not listed.
+ */
+esp_err_t debug_pool_benchmark(uint32_t iterations, debug_pool_bench_t* out_result);
+
+#ifdef __cplusplus
+}
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+namespace debug::pool {
+
+struct Stats {
+  const char* name;
+  uint32_t block_bytes;  // 0 for an arena
+  uint32_t capacity;     // blocks, or bytes for an arena
+  uint32_t in_use;       // blocks, or bytes for an arena
+  uint32_t high_water;
+  uint32_t allocs;
+  uint32_t failures;
+};
+
+class Pool;
+class Arena;
+void register_pool(Pool* pool);
+void register_arena(Arena* arena);
+
+[[noreturn]] inline void exhausted() {
+  std::abort();  // what operator new does without exceptions
+}
+
+class Pool {
+ public:
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+
+  // nullptr when every block is taken.
+  void* allocate() {
+    if (!linked_.load(std::memory_order_acquire)) {
+      register_pool(this);
+    }
+    uint32_t head = head_.load(std::memory_order_acquire);
+    while (head & kIndexMask) {
+      const uint16_t index = static_cast<uint16_t>((head & kIndexMask) - 1);
+      const uint32_t next = ((head & ~kIndexMask) + kTagStep) | next_[index].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+        return taken(index);
+      }
+    }
+    // Blocks never handed out yet are taken in order, so nothing has to be set up front.
+    uint32_t fresh = fresh_.load(std::memory_order_relaxed);
+    while (fresh < blocks_) {
+      if (fresh_.compare_exchange_weak(fresh, fresh + 1, std::memory_order_relaxed)) {
+        return taken(static_cast<uint16_t>(fresh));
+      }
+    }
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // block must come from this pool; nullptr is ignored.
+  void deallocate(void* block) {
+    if (!block) {
+      return;
+    }
+    const uint16_t index = static_cast<uint16_t>((static_cast<uint8_t*>(block) - storage_) / stride_);
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+      next_[index].store(static_cast<uint16_t>(head & kIndexMask), std::memory_order_relaxed);
+      next = ((head & ~kIndexMask) + kTagStep) | (index + 1u);
+    } while (!head_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    in_use_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  bool owns(const void* block) const {
+    const uint8_t* p = static_cast<const uint8_t*>(block);
+    return p >= storage_ && p < storage_ + static_cast<size_t>(stride_) * blocks_;
+  }
+
+  const char* name() const {
+    return name_;
+  }
+  uint32_t block_bytes() const {
+    return stride_;
+  }
+  Stats stats() const {
+    return {name_,
+            stride_,
+            blocks_,
+            in_use_.load(std::memory_order_relaxed),
+            high_water_.load(std::memory_order_relaxed),
+            allocs_.load(std::memory_order_relaxed),
+            failures_.load(std::memory_order_relaxed)};
+  }
+  void reset_stats() {
+    high_water_.store(in_use_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    allocs_.store(0, std::memory_order_relaxed);
+    failures_.store(0, std::memory_order_relaxed);
+  }
+  Pool* next() const {
+    return next_pool_;
+  }
+
+ protected:
+  // stride is a multiple of the strictest alignment; next holds one link per block.
+  Pool(const char* name, uint8_t* storage, uint32_t stride, uint16_t blocks, std::atomic<uint16_t>* next)
+      : name_(name), storage_(storage), stride_(stride), blocks_(blocks), next_(next) {}
+  // Keeps a pool that does not live forever out of the list.
+  void unlist() {
+    linked_.store(true, std::memory_order_release);
+  }
+
+ private:
+  friend void register_pool(Pool* pool);
+
+  // The head holds block index + 1 (0: empty) and a tag bumped on every swap, so a head
+  // that was popped and pushed back in between is not mistaken for the one read.
+  static constexpr uint32_t kIndexMask = 0xFFFF;
+  static constexpr uint32_t kTagStep = 0x10000;
+
+  void* taken(uint16_t index) {
+    allocs_.fetch_add(1, std::memory_order_relaxed);
+    const uint32_t used = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t seen = high_water_.load(std::memory_order_relaxed);
+    while (used > seen && !high_water_.compare_exchange_weak(seen, used, std::memory_order_relaxed)) {
+    }
+    return storage_ + static_cast<size_t>(stride_) * index;
+  }
+
+  const char* name_;
+  uint8_t* storage_;
+  uint32_t stride_;
+  uint16_t blocks_;
+  std::atomic<uint16_t>* next_;
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> fresh_{0};
+  std::atomic<uint32_t> in_use_{0};
+  std::atomic<uint32_t> high_water_{0};
+  std::atomic<uint32_t> allocs_{0};
+  std::atomic<uint32_t> failures_{0};
+  std::atomic<bool> linked_{false};
+  Pool* next_pool_ = nullptr;
+};
+
+// kBlocks blocks of at least kBlockBytes, reserved with the object (in .bss for a static).
+template <size_t kBlockBytes, uint16_t kBlocks>
+class FixedPool : public Pool {
+ public:
+  static_assert(kBlocks > 0 && kBlocks < 0xFFFF, "16-bit block index");
+  static constexpr uint32_t kStride =
+      (kBlockBytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  explicit FixedPool(const char* name) : Pool(name, storage_, kStride, kBlocks, links_) {}
+
+ private:
+  alignas(std::max_align_t) uint8_t storage_[kStride * kBlocks];
+  std::atomic<uint16_t> links_[kBlocks] = {};
+};
+
+// Size classes: allocate(bytes) takes a block from the smallest pool that fits and has one
+// free, falling back to larger classes when it is exhausted. Pools go smallest first.
+template <size_t kClasses>
+class PoolSet {
+ public:
+  explicit PoolSet(Pool* const (&pools)[kClasses]) {
+    for (size_t i = 0; i < kClasses; ++i) {
+      pools_[i] = pools[i];
+    }
+  }
+
+  void* allocate(size_t bytes) {
+    for (Pool* pool : pools_) {
+      if (bytes <= pool->block_bytes()) {
+        if (void* block = pool->allocate()) {
+          return block;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  void deallocate(void* block) {
+    for (Pool* pool : pools_) {
+      if (pool->owns(block)) {
+        pool->deallocate(block);
+        return;
+      }
+    }
+  }
+
+ private:
+  Pool* pools_[kClasses];
+};
+
+/*
+ * Bump allocator for the objects of one request. Owned by one task at a time; nothing is
+ * freed individually. Take a mark() before the request and rewind() to it after, or use
+ * an ArenaScope; reset() releases everything.
+ */
+class Arena {
+ public:
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // nullptr when the rest of the buffer is too small.
+  void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+    if (!linked_) {
+      register_arena(this);
+    }
+    const size_t start = (used_ + align - 1) & ~(align - 1);
+    if (start > capacity_ || bytes > capacity_ - start) {
+      failures_++;
+      return nullptr;
+    }
+    used_ = start + bytes;
+    allocs_++;
+    if (used_ > high_water_) {
+      high_water_ = static_cast<uint32_t>(used_);
+    }
+    return buffer_ + start;
+  }
+
+  template <typename T>
+  T* allocate_array(size_t count) {
+    if (count > capacity_ / sizeof(T)) {
+      failures_++;
+      return nullptr;
+    }
+    return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  size_t mark() const {
+    return used_;
+  }
+  void rewind(size_t mark) {
+    if (mark < used_) {
+      used_ = mark;
+    }
+  }
+  void reset() {
+    used_ = 0;
+  }
+
+  // Whole Ts that still fit.
+  template <typename T>
+  size_t room_for() const {
+    const size_t start = (used_ + alignof(T) - 1) & ~(alignof(T) - 1);
+    return start < capacity_ ? (capacity_ - start) / sizeof(T) : 0;
+  }
+
+  const char* name() const {
+    return name_;
+  }
+  Stats stats() const {
+    return {name_,
+            0,
+            static_cast<uint32_t>(capacity_),
+            static_cast<uint32_t>(used_),
+            high_water_,
+            allocs_,
+            failures_};
+  }
+  void reset_stats() {
+    high_water_ = static_cast<uint32_t>(used_);
+    allocs_ = 0;
+    failures_ = 0;
+  }
+  Arena* next() const {
+    return next_arena_;
+  }
+
+ protected:
+  Arena(const char* name, uint8_t* buffer, size_t capacity) : name_(name), buffer_(buffer), capacity_(capacity) {}
+  void unlist() {
+    linked_ = true;
+  }
+
+ private:
+  friend void register_arena(Arena* arena);
+
+  const char* name_;
+  uint8_t* buffer_;
+  size_t capacity_;
+  size_t used_ = 0;
+  uint32_t high_water_ = 0;
+  uint32_t allocs_ = 0;
+  uint32_t failures_ = 0;
+  bool linked_ = false;
+  Arena* next_arena_ = nullptr;
+};
+
+template <size_t kBytes>
+class ArenaBuffer : public Arena {
+ public:
+  explicit ArenaBuffer(const char* name) : Arena(name, buffer_, kBytes) {}
+
+ private:
+  alignas(std::max_align_t) uint8_t buffer_[kBytes];
+};
+
+// Releases everything allocated from the arena during the scope.
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena& arena) : arena_(arena), mark_(arena.mark()) {}
+  ~ArenaScope() {
+    arena_.rewind(mark_);
+  }
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  Arena& arena_;
+  size_t mark_;
+};
+
+// For node containers (std::list, std::map, std::set): one element per block.
+// Running out of blocks aborts, as the default allocator does without exceptions.
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  explicit PoolAllocator(Pool& pool) : pool_(&pool) {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool()) {}
+
+  T* allocate(size_t count) {
+    void* block = count * sizeof(T) <= pool_->block_bytes() ? pool_->allocate() : nullptr;
+    if (!block) {
+      exhausted();
+    }
+    return static_cast<T*>(block);
+  }
+  void deallocate(T* block, size_t) {
+    pool_->deallocate(block);
+  }
+
+  Pool* pool() const {
+    return pool_;
+  }
+  template <typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return pool_ == other.pool();
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>& other) const {
+    return pool_ != other.pool();
+  }
+
+ private:
+  Pool* pool_;
+};
+
+// For containers built during one request. deallocate() is a no-op, so a growing vector
+// leaves its old buffers behind until the arena is rewound; reserve() up front.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t count) {
+    T* block = arena_->allocate_array<T>(count);
+    if (!block) {
+      exhausted();
+    }
+    return block;
+  }
+  void deallocate(T*, size_t) {
+  }
+
+  Arena* arena() const {
+    return arena_;
+  }
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  Arena* arena_;
+};
+
+}  // namespace debug::pool
+
+#endif  // __cplusplus
+
+#endif  // DEBUG_POOL_H_
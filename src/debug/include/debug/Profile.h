@@ -0,0 +1,120 @@
+#ifndef DEBUG_PROFILE_H_
+#define DEBUG_PROFILE_H_
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+/*
+ * Scoped profiling zones.
+ *
+ * DEBUG_PROFILE() (see Debug.h) opens a zone named after the enclosing function that
+ * lasts until the end of the scope. Each zone is a static object that times itself with
+ * the CPU cycle counter and keeps a cycle histogram; zones register themselves on first
+ * use and are listed by 'prof dump'. DEBUG_MEM_SNAPSHOT(label) records free and largest
+ * internal heap blocks per label into a small table printed alongside.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Print every zone (count, min/p50/p99/max/mean cycles, total time) and the heap snapshot table.
+ */
+void debug_profile_dump(void);
+
+/**
+ * @brief Clear all zone histograms and heap snapshots. Zones stay registered.
+ */
+void debug_profile_reset(void);
+
+#ifdef __cplusplus
+}
+
+#include <atomic>
+
+#include "Histogram.h"
+
+#if defined(ESP_PLATFORM)
+#include "esp_cpu.h"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace debug::profile {
+
+// Free-running counter: CPU cycles on target, TSC ticks (or nanoseconds) on host builds.
+inline uint32_t now_cycles() {
+#if defined(ESP_PLATFORM)
+  return esp_cpu_get_cycle_count();
+#elif defined(__x86_64__) || defined(__i386__)
+  return static_cast<uint32_t>(__rdtsc());
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint32_t>(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+class Zone;
+void register_zone(Zone* zone);
+
+class Zone {
+ public:
+  constexpr explicit Zone(const char* name) : name_(name) {}
+  Zone(const Zone&) = delete;
+  Zone& operator=(const Zone&) = delete;
+
+  void record(uint32_t cycles) {
+    if (!linked_.load(std::memory_order_acquire)) {
+      register_zone(this);
+    }
+    histogram_.record(cycles);
+  }
+
+  const char* name() const {
+    return name_;
+  }
+  const Histogram<>& histogram() const {
+    return histogram_;
+  }
+  Histogram<>& histogram() {
+    return histogram_;
+  }
+  Zone* next() const {
+    return next_;
+  }
+
+ private:
+  friend void register_zone(Zone* zone);
+
+  const char* name_;
+  Zone* next_ = nullptr;
+  std::atomic<bool> linked_{false};
+  Histogram<> histogram_;
+};
+
+class Scope {
+ public:
+  explicit Scope(Zone& zone) : zone_(zone), start_(now_cycles()) {}
+  ~Scope() {
+    zone_.record(now_cycles() - start_);
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  Zone& zone_;
+  uint32_t start_;
+};
+
+void mem_snapshot(const char* label);
+
+}  // namespace debug::profile
+
+#endif  // __cplusplus
+
+#endif  // DEBUG_PROFILE_H_
@@ -0,0 +1,134 @@
+#ifndef DEBUG_STATIC_ALLOC_H_
+#define DEBUG_STATIC_ALLOC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MemBudget.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+namespace debug {
+
+/*
+ * Storage for the kernel objects a module creates once at boot and keeps for the whole
+ * uptime. Declare one as a file-scope static next to the handle it creates:
+ *
+ *   debug::StaticTask<4096> s_writer_storage;
+ *   ...
+ *   s_writer_storage.create(writer_task, "history", nullptr, 3, &s_task, MEM_BUDGET_HISTORY);
+ *
+ * With CONFIG_APP_STATIC_ALLOCATION the stack, TCB and queue storage live in the object,
+ * i.e. in .bss, and the *CreateStatic calls use them; the heap is never touched. Without
+ * it the object is empty and create() falls back to the heap calls. Either way the bytes
+ * are charged to the MemBudget ledger. create() must succeed at most once per object;
+ * these objects are never deleted.
+ */
+
+#if CONFIG_APP_STATIC_ALLOCATION
+constexpr bool kStaticAllocation = true;
+#else
+constexpr bool kStaticAllocation = false;
+#endif
+
+// kStackBytes is the stack size in bytes, as ESP-IDF's xTaskCreate takes it.
+template <uint32_t kStackBytes>
+class StaticTask {
+ public:
+  BaseType_t create(TaskFunction_t fn, const char* name, void* arg, UBaseType_t priority, TaskHandle_t* out_handle,
+                    mem_budget_subsystem_t subsystem) {
+#if CONFIG_APP_STATIC_ALLOCATION
+    TaskHandle_t handle = xTaskCreateStatic(fn, name, kStackBytes, arg, priority, stack_, &tcb_);
+    if (!handle) {
+      return pdFAIL;
+    }
+    if (out_handle) {
+      *out_handle = handle;
+    }
+#else
+    if (xTaskCreate(fn, name, kStackBytes, arg, priority, out_handle) != pdPASS) {
+      return pdFAIL;
+    }
+#endif
+    mem_budget_charge(subsystem, MEM_BUDGET_STACK, kStackBytes, !kStaticAllocation);
+    mem_budget_charge(subsystem, MEM_BUDGET_KERNEL, sizeof(StaticTask_t), !kStaticAllocation);
+    return pdPASS;
+  }
+
+ private:
+#if CONFIG_APP_STATIC_ALLOCATION
+  StackType_t stack_[kStackBytes / sizeof(StackType_t)];
+  StaticTask_t tcb_;
+#endif
+};
+
+template <typename T, UBaseType_t kLength>
+class StaticQueue {
+ public:
+  QueueHandle_t create(mem_budget_subsystem_t subsystem) {
+#if CONFIG_APP_STATIC_ALLOCATION
+    QueueHandle_t handle = xQueueCreateStatic(kLength, sizeof(T), storage_, &queue_);
+#else
+    QueueHandle_t handle = xQueueCreate(kLength, sizeof(T));
+#endif
+    if (handle) {
+      mem_budget_charge(subsystem, MEM_BUDGET_BUFFER, kLength * sizeof(T), !kStaticAllocation);
+      mem_budget_charge(subsystem, MEM_BUDGET_KERNEL, sizeof(StaticQueue_t), !kStaticAllocation);
+    }
+    return handle;
+  }
+
+ private:
+#if CONFIG_APP_STATIC_ALLOCATION
+  uint8_t storage_[kLength * sizeof(T)];
+  StaticQueue_t queue_;
+#endif
+};
+
+class StaticMutex {
+ public:
+  SemaphoreHandle_t create(mem_budget_subsystem_t subsystem) {
+#if CONFIG_APP_STATIC_ALLOCATION
+    SemaphoreHandle_t handle = xSemaphoreCreateMutexStatic(&mutex_);
+#else
+    SemaphoreHandle_t handle = xSemaphoreCreateMutex();
+#endif
+    if (handle) {
+      mem_budget_charge(subsystem, MEM_BUDGET_KERNEL, sizeof(StaticSemaphore_t), !kStaticAllocation);
+    }
+    return handle;
+  }
+
+ private:
+#if CONFIG_APP_STATIC_ALLOCATION
+  StaticSemaphore_t mutex_;
+#endif
+};
+
+class StaticEventGroup {
+ public:
+  EventGroupHandle_t create(mem_budget_subsystem_t subsystem) {
+#if CONFIG_APP_STATIC_ALLOCATION
+    EventGroupHandle_t handle = xEventGroupCreateStatic(&group_);
+#else
+    EventGroupHandle_t handle = xEventGroupCreate();
+#endif
+    if (handle) {
+      mem_budget_charge(subsystem, MEM_BUDGET_KERNEL, sizeof(StaticEventGroup_t), !kStaticAllocation);
+    }
+    return handle;
+  }
+
+ private:
+#if CONFIG_APP_STATIC_ALLOCATION
+  StaticEventGroup_t group_;
+#endif
+};
+
+}  // namespace debug
+
+#endif  // DEBUG_STATIC_ALLOC_H_
@@ -0,0 +1,90 @@
+#ifndef DEBUG_TELEMETRY_H_
+#define DEBUG_TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * System telemetry sampler.
+ *
+ * A low-priority task wakes every CONFIG_APP_TELEMETRY_PERIOD_MS, reads the FreeRTOS
+ * run-time counters and stack high-water marks of every task plus the heap state per
+ * capability, and appends a compact sample to a RAM ring (CPU % and stack headroom per
+ * task, free/largest/minimum heap). 'top' prints the latest sample and the history.
+ *
+ * Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS;
+ * without them telemetry_start() returns ESP_ERR_NOT_SUPPORTED.
+ */
+
+#define TELEMETRY_TASK_NAME_LEN 16
+
+typedef struct {
+  uint32_t uptime_ms;           // time of the newest sample
+  uint32_t period_ms;           // sampling period
+  uint32_t samples;             // samples taken since start or the last reset
+  uint16_t cpu_busy_permille;   // 1000 - idle share over the last period
+  uint16_t task_count;          // tasks alive in the newest sample
+  uint32_t internal_free;       // MALLOC_CAP_INTERNAL
+  uint32_t internal_min_free;   // lowest internal free since boot
+  uint32_t internal_largest;    // largest allocatable internal block
+  uint32_t dma_free;            // MALLOC_CAP_DMA
+  uint32_t spiram_free;         // MALLOC_CAP_SPIRAM, 0 when there is no PSRAM
+  uint8_t internal_frag_pct;    // 100 - largest * 100 / free
+} telemetry_summary_t;
+
+typedef struct {
+  char name[TELEMETRY_TASK_NAME_LEN];
+  uint16_t cpu_permille;        // share of the last period
+  uint16_t peak_cpu_permille;   // highest share of any period
+  uint32_t stack_free;          // high-water mark: bytes never touched
+  uint32_t priority;
+  bool alive;
+} telemetry_task_info_t;
+
+/**
+ * @brief Start the sampler task. Safe to call more than once.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED when run-time stats are disabled.
+ */
+esp_err_t telemetry_start(void);
+
+/**
+ * @brief Take a sample now (in addition to the periodic ones).
+ */
+esp_err_t telemetry_sample_now(void);
+
+esp_err_t telemetry_get_summary(telemetry_summary_t* out_summary);
+
+/**
+ * @brief Look up the newest figures for one task by name.
+ * @return ESP_ERR_NOT_FOUND if the task was never sampled.
+ */
+esp_err_t telemetry_get_task(const char* name, telemetry_task_info_t* out_info);
+
+/**
+ * @brief Print the newest sample as a 'top'-style table.
+ */
+void telemetry_print_top(void);
+
+/**
+ * @brief Print up to `max_samples` of the history (oldest first); 0 prints all of it.
+ *        With `task` set, print that task's CPU and stack columns instead of the busiest task.
+ */
+void telemetry_print_history(uint32_t max_samples, const char* task);
+
+/**
+ * @brief Drop the history and the per-task peaks.
+ */
+void telemetry_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DEBUG_TELEMETRY_H_
@@ -0,0 +1,151 @@
+#ifndef DEBUG_TRACE_H_
+#define DEBUG_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/*
+ * Binary function trace ring.
+ *
+ * Debug.h turns DEBUG_FUNC_ENTER/EXIT and DEBUG_PARAM_* into fixed-size events
+ * (function, label, timestamp, one 32-bit argument) written into a flight-recorder
+ * ring. Whether a call site records anything is decided at compile time from the
+ * translation unit's DEBUG_TAG, so disabled modules pay nothing.
+ */
+
+#ifndef CONFIG_APP_TRACE_RING_ENTRIES
+#define CONFIG_APP_TRACE_RING_ENTRIES 256
+#endif
+#ifndef CONFIG_APP_TRACE_LEVEL_ZB_LINK
+#define CONFIG_APP_TRACE_LEVEL_ZB_LINK 0
+#endif
+#ifndef CONFIG_APP_TRACE_LEVEL_WIFI_MGR
+#define CONFIG_APP_TRACE_LEVEL_WIFI_MGR 0
+#endif
+#ifndef CONFIG_APP_TRACE_LEVEL_BT_MGR
+#define CONFIG_APP_TRACE_LEVEL_BT_MGR 0
+#endif
+#ifndef CONFIG_APP_TRACE_LEVEL_CLI
+#define CONFIG_APP_TRACE_LEVEL_CLI 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint32_t recorded;  // events written since boot or the last clear
+  uint32_t capacity;  // ring entries
+  bool enabled;       // runtime switch (compile-time levels still apply)
+} debug_trace_stats_t;
+
+typedef struct {
+  uint32_t iterations;
+  uint32_t traced_cycles;      // mean cycles per recorded trace event
+  uint32_t log_format_cycles;  // mean cycles to format the equivalent ESP_LOGD line
+  uint32_t cpu_mhz;
+} debug_trace_bench_t;
+
+void debug_trace_set_enabled(bool enable);
+void debug_trace_clear(void);
+
+/**
+ * @brief Print the newest events (oldest first) to stdout.
+ * @param max_events Upper bound on events printed; 0 prints the whole ring.
+ */
+void debug_trace_dump(uint32_t max_events);
+
+void debug_trace_get_stats(debug_trace_stats_t* out_stats);
+
+/**
+ * @brief Measure the cost of one traced call. Uses a private ring so the flight
+ *        recorder is left untouched.
+ */
+esp_err_t debug_trace_benchmark(uint32_t iterations, debug_trace_bench_t* out_result);
+
+#ifdef __cplusplus
+}
+
+namespace debug::trace {
+
+enum class Kind : uint8_t {
+  kEnter,
+  kExit,
+  kExitRc,
+  kParamInt,
+  kParamUint,
+  kParamBool,
+  kParamStr,
+  kParamPtr,
+  kMem,
+  kStack,
+};
+
+struct TagLevel {
+  const char* tag;
+  int level;
+};
+
+// Per-module compile-time levels (menuconfig → Application Configuration → Function tracing).
+inline constexpr TagLevel kTagLevels[] = {
+    {"ZB_LINK", CONFIG_APP_TRACE_LEVEL_ZB_LINK},
+    {"WIFI_MGR", CONFIG_APP_TRACE_LEVEL_WIFI_MGR},
+    {"BT_MGR", CONFIG_APP_TRACE_LEVEL_BT_MGR},
+    {"CLI", CONFIG_APP_TRACE_LEVEL_CLI},
+};
+inline constexpr uint8_t kUnknownTag = 0xFF;
+
+constexpr bool tag_equal(const char* a, const char* b) {
+  while (*a && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return *a == *b;
+}
+
+// Level for `tag`, or `fallback` (the translation unit's DEBUG_LEVEL) for unlisted tags.
+constexpr int level_for(const char* tag, int fallback) {
+  for (const auto& entry : kTagLevels) {
+    if (tag_equal(entry.tag, tag)) {
+      return entry.level;
+    }
+  }
+  return fallback;
+}
+
+constexpr uint8_t tag_id(const char* tag) {
+  for (uint8_t i = 0; i < sizeof(kTagLevels) / sizeof(kTagLevels[0]); ++i) {
+    if (tag_equal(kTagLevels[i].tag, tag)) {
+      return i;
+    }
+  }
+  return kUnknownTag;
+}
+
+// Keeps the first four characters of a string parameter, which is usually enough to tell values apart.
+inline int32_t pack_str(const char* value) {
+  uint32_t packed = 0;
+  if (value) {
+    for (int i = 0; i < 4 && value[i]; ++i) {
+      packed |= static_cast<uint32_t>(static_cast<uint8_t>(value[i])) << (8 * i);
+    }
+  }
+  return static_cast<int32_t>(packed);
+}
+
+inline int32_t ptr_bits(const void* value) {
+  return static_cast<int32_t>(reinterpret_cast<uintptr_t>(value));
+}
+
+int32_t free_internal_heap();
+
+void record(Kind kind, uint8_t tag, const char* func, const char* label, int32_t arg);
+
+}  // namespace debug::trace
+
+#endif  // __cplusplus
+
+#endif  // DEBUG_TRACE_H_
@@ -0,0 +1,112 @@
+#include "debug/MemBudget.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_APP_STATIC_RAM_BUDGET_KB
+#define CONFIG_APP_STATIC_RAM_BUDGET_KB 160
+#endif
+
+namespace {
+
+const char* kTag = "MEM";
+
+constexpr uint32_t kBudgetBytes = CONFIG_APP_STATIC_RAM_BUDGET_KB * 1024u;
+#if CONFIG_APP_STATIC_ALLOCATION
+constexpr const char* kMode = "static";
+#else
+constexpr const char* kMode = "heap";
+#endif
+constexpr const char* kNames[MEM_BUDGET_SUBSYSTEM_COUNT] = {"link", "zigbee", "history", "net", "debug", "cli"};
+
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+mem_budget_entry_t s_entries[MEM_BUDGET_SUBSYSTEM_COUNT] = {};
+
+uint32_t total(const mem_budget_entry_t& entry) {
+  uint32_t bytes = 0;
+  for (uint32_t kind_bytes : entry.bytes) {
+    bytes += kind_bytes;
+  }
+  return bytes;
+}
+
+}  // namespace
+
+void mem_budget_charge(mem_budget_subsystem_t subsystem, mem_budget_kind_t kind, uint32_t bytes, bool from_heap) {
+  if (subsystem >= MEM_BUDGET_SUBSYSTEM_COUNT || kind >= MEM_BUDGET_KIND_COUNT) {
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  mem_budget_entry_t& entry = s_entries[subsystem];
+  entry.bytes[kind] += bytes;
+  if (from_heap) {
+    entry.heap_bytes += bytes;
+  }
+  entry.objects++;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void mem_budget_get(mem_budget_subsystem_t subsystem, mem_budget_entry_t* out_entry) {
+  if (!out_entry) {
+    return;
+  }
+  if (subsystem >= MEM_BUDGET_SUBSYSTEM_COUNT) {
+    *out_entry = {};
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  *out_entry = s_entries[subsystem];
+  portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t mem_budget_static_total(void) {
+  uint32_t bytes = 0;
+  portENTER_CRITICAL(&s_lock);
+  for (const mem_budget_entry_t& entry : s_entries) {
+    bytes += total(entry) - entry.heap_bytes;
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return bytes;
+}
+
+void mem_budget_print(void) {
+  mem_budget_entry_t entries[MEM_BUDGET_SUBSYSTEM_COUNT];
+  portENTER_CRITICAL(&s_lock);
+  for (size_t i = 0; i < MEM_BUDGET_SUBSYSTEM_COUNT; ++i) {
+    entries[i] = s_entries[i];
+  }
+  portEXIT_CRITICAL(&s_lock);
+
+  printf("%-8s %7s %8s %8s %8s %8s %8s\n", "SUBSYS", "OBJECTS", "STACKS", "KERNEL", "BUFFERS", "TOTAL", "ON HEAP");
+  mem_budget_entry_t sum = {};
+  for (size_t i = 0; i < MEM_BUDGET_SUBSYSTEM_COUNT; ++i) {
+    const mem_budget_entry_t& entry = entries[i];
+    printf("%-8s %7u %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", kNames[i], entry.objects,
+           entry.bytes[MEM_BUDGET_STACK], entry.bytes[MEM_BUDGET_KERNEL], entry.bytes[MEM_BUDGET_BUFFER],
+           total(entry), entry.heap_bytes);
+    for (size_t kind = 0; kind < MEM_BUDGET_KIND_COUNT; ++kind) {
+      sum.bytes[kind] += entry.bytes[kind];
+    }
+    sum.heap_bytes += entry.heap_bytes;
+    sum.objects += entry.objects;
+  }
+  printf("%-8s %7u %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", "total", sum.objects,
+         sum.bytes[MEM_BUDGET_STACK], sum.bytes[MEM_BUDGET_KERNEL], sum.bytes[MEM_BUDGET_BUFFER], total(sum),
+         sum.heap_bytes);
+
+  const uint32_t reserved = total(sum) - sum.heap_bytes;
+  printf("\nReserved at link time: %" PRIu32 " of %" PRIu32 " bytes budgeted (%s allocation)\n", reserved,
+         kBudgetBytes, kMode);
+  printf("Heap internal: %u free, %u min, %u largest block\n",
+         static_cast<unsigned>(heap_caps_get_free_size(MALLOC_CAP_INTERNAL)),
+         static_cast<unsigned>(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL)),
+         static_cast<unsigned>(heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL)));
+  if (reserved > kBudgetBytes) {
+    ESP_LOGW(kTag, "Static RAM over budget by %" PRIu32 " bytes (APP_STATIC_RAM_BUDGET_KB)", reserved - kBudgetBytes);
+  }
+}
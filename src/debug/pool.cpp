@@ -0,0 +1,191 @@
+#include "debug/Pool.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <new>
+
+#include "debug/Profile.h"
+#include "esp_rom_sys.h"
+
+namespace debug::pool {
+namespace {
+
+std::atomic<Pool*> s_pools{nullptr};
+std::atomic<Arena*> s_arenas{nullptr};
+
+// Keeps the benchmark's malloc/free pairs from being optimised away.
+void* volatile s_sink = nullptr;
+
+constexpr uint32_t kFrameBytes = 64;
+constexpr uint32_t kRecordBytes = 160;  // about a BLE scan entry
+constexpr size_t kLiveRecords = 32;
+constexpr uint32_t kResponseSizes[] = {16,  48,  800, 24, 64,  32,  128, 16,  256, 40, 24, 96,
+                                       512, 16,  64,  48, 200, 32,  16,  640, 24,  80, 16, 320};
+constexpr size_t kResponseAllocs = sizeof(kResponseSizes) / sizeof(kResponseSizes[0]);
+
+// Heap-allocated for the run, so they stay out of the list.
+struct BenchFramePool : FixedPool<kFrameBytes, 4> {
+  BenchFramePool() : FixedPool("bench_frame") {
+    unlist();
+  }
+};
+struct BenchRecordPool : FixedPool<kRecordBytes, kLiveRecords> {
+  BenchRecordPool() : FixedPool("bench_record") {
+    unlist();
+  }
+};
+struct BenchArena : ArenaBuffer<8192> {
+  BenchArena() : ArenaBuffer("bench_response") {
+    unlist();
+  }
+};
+
+void print_row(const Stats& stats) {
+  if (stats.block_bytes) {
+    printf("%-16s %6" PRIu32 " x %-6" PRIu32 " %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %8" PRIu32 "\n", stats.name,
+           stats.capacity, stats.block_bytes, stats.in_use, stats.high_water, stats.allocs, stats.failures);
+  } else {
+    printf("%-16s %9" PRIu32 " bytes %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %8" PRIu32 "\n", stats.name,
+           stats.capacity, stats.in_use, stats.high_water, stats.allocs, stats.failures);
+  }
+}
+
+uint32_t bench_frame(uint32_t iterations, Pool* pool) {
+  const uint32_t start = profile::now_cycles();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    void* frame = pool ? pool->allocate() : malloc(kFrameBytes);
+    s_sink = frame;
+    if (pool) {
+      pool->deallocate(frame);
+    } else {
+      free(frame);
+    }
+  }
+  return (profile::now_cycles() - start) / iterations;
+}
+
+uint32_t bench_churn(uint32_t iterations, Pool* pool) {
+  void* live[kLiveRecords];
+  for (void*& record : live) {
+    record = pool ? pool->allocate() : malloc(kRecordBytes);
+  }
+  const uint32_t start = profile::now_cycles();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    void*& record = live[i % kLiveRecords];
+    if (pool) {
+      pool->deallocate(record);
+      record = pool->allocate();
+    } else {
+      free(record);
+      record = malloc(kRecordBytes);
+    }
+    s_sink = record;
+  }
+  const uint32_t cycles = (profile::now_cycles() - start) / iterations;
+  for (void* record : live) {
+    if (pool) {
+      pool->deallocate(record);
+    } else {
+      free(record);
+    }
+  }
+  return cycles;
+}
+
+uint32_t bench_response(uint32_t iterations, Arena* arena) {
+  void* parts[kResponseAllocs];
+  const uint32_t start = profile::now_cycles();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    if (arena) {
+      ArenaScope scope(*arena);
+      for (size_t j = 0; j < kResponseAllocs; ++j) {
+        s_sink = arena->allocate(kResponseSizes[j]);
+      }
+    } else {
+      for (size_t j = 0; j < kResponseAllocs; ++j) {
+        parts[j] = malloc(kResponseSizes[j]);
+        s_sink = parts[j];
+      }
+      for (void* part : parts) {
+        free(part);
+      }
+    }
+  }
+  return (profile::now_cycles() - start) / (iterations * kResponseAllocs);
+}
+
+}  // namespace
+
+void register_pool(Pool* pool) {
+  if (pool->linked_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  Pool* head = s_pools.load(std::memory_order_relaxed);
+  do {
+    pool->next_pool_ = head;
+  } while (!s_pools.compare_exchange_weak(head, pool, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void register_arena(Arena* arena) {
+  arena->linked_ = true;
+  Arena* head = s_arenas.load(std::memory_order_relaxed);
+  do {
+    arena->next_arena_ = head;
+  } while (!s_arenas.compare_exchange_weak(head, arena, std::memory_order_release, std::memory_order_relaxed));
+}
+
+}  // namespace debug::pool
+
+using debug::pool::Arena;
+using debug::pool::Pool;
+
+void debug_pool_dump(void) {
+  Pool* pools = debug::pool::s_pools.load(std::memory_order_acquire);
+  Arena* arenas = debug::pool::s_arenas.load(std::memory_order_acquire);
+  if (!pools && !arenas) {
+    printf("No pool or arena used yet\n");
+    return;
+  }
+  printf("%-16s %15s %8s %8s %10s %8s\n", "NAME", "SIZE", "IN USE", "PEAK", "ALLOCS", "FAILED");
+  for (Pool* pool = pools; pool; pool = pool->next()) {
+    debug::pool::print_row(pool->stats());
+  }
+  for (Arena* arena = arenas; arena; arena = arena->next()) {
+    debug::pool::print_row(arena->stats());
+  }
+}
+
+void debug_pool_reset(void) {
+  for (Pool* pool = debug::pool::s_pools.load(std::memory_order_acquire); pool; pool = pool->next()) {
+    pool->reset_stats();
+  }
+  for (Arena* arena = debug::pool::s_arenas.load(std::memory_order_acquire); arena; arena = arena->next()) {
+    arena->reset_stats();
+  }
+}
+
+esp_err_t debug_pool_benchmark(uint32_t iterations, debug_pool_bench_t* out_result) {
+  if (!out_result || iterations == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  auto* frames = new (std::nothrow) debug::pool::BenchFramePool();
+  auto* records = new (std::nothrow) debug::pool::BenchRecordPool();
+  auto* arena = new (std::nothrow) debug::pool::BenchArena();
+  esp_err_t err = ESP_ERR_NO_MEM;
+  if (frames && records && arena) {
+    *out_result = {};
+    out_result->iterations = iterations;
+    out_result->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+    out_result->malloc_cycles[DEBUG_POOL_BENCH_FRAME] = debug::pool::bench_frame(iterations, nullptr);
+    out_result->pool_cycles[DEBUG_POOL_BENCH_FRAME] = debug::pool::bench_frame(iterations, frames);
+    out_result->malloc_cycles[DEBUG_POOL_BENCH_CHURN] = debug::pool::bench_churn(iterations, nullptr);
+    out_result->pool_cycles[DEBUG_POOL_BENCH_CHURN] = debug::pool::bench_churn(iterations, records);
+    out_result->malloc_cycles[DEBUG_POOL_BENCH_RESPONSE] = debug::pool::bench_response(iterations, nullptr);
+    out_result->pool_cycles[DEBUG_POOL_BENCH_RESPONSE] = debug::pool::bench_response(iterations, arena);
+    err = ESP_OK;
+  }
+  delete frames;
+  delete records;
+  delete arena;
+  return err;
+}
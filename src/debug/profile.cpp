@@ -0,0 +1,148 @@
+#include "debug/Profile.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+
+namespace debug::profile {
+namespace {
+
+constexpr size_t kMemSlots = 16;
+
+struct MemSlot {
+  std::atomic<const char*> label{nullptr};
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> last_free{0};
+  std::atomic<uint32_t> min_free{UINT32_MAX};
+  std::atomic<uint32_t> min_largest{UINT32_MAX};
+};
+
+std::atomic<Zone*> s_zones{nullptr};
+MemSlot s_mem[kMemSlots];
+std::atomic<uint32_t> s_mem_overflow{0};
+
+void store_min(std::atomic<uint32_t>& target, uint32_t value) {
+  uint32_t seen = target.load(std::memory_order_relaxed);
+  while (value < seen && !target.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+  }
+}
+
+MemSlot* find_mem_slot(const char* label) {
+  for (auto& slot : s_mem) {
+    const char* current = slot.label.load(std::memory_order_acquire);
+    if (current == nullptr) {
+      if (slot.label.compare_exchange_strong(current, label, std::memory_order_acq_rel)) {
+        return &slot;
+      }
+    }
+    if (current == label || strcmp(current, label) == 0) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+// Cycles spent by an empty zone, so short zones can be read against the instrumentation cost.
+uint32_t measure_overhead() {
+  static Histogram<> scratch;
+  constexpr uint32_t kRounds = 64;
+  const uint32_t start = now_cycles();
+  for (uint32_t i = 0; i < kRounds; ++i) {
+    const uint32_t begin = now_cycles();
+    scratch.record(now_cycles() - begin);
+  }
+  return (now_cycles() - start) / kRounds;
+}
+
+}  // namespace
+
+void register_zone(Zone* zone) {
+  if (zone->linked_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  Zone* head = s_zones.load(std::memory_order_relaxed);
+  do {
+    zone->next_ = head;
+  } while (!s_zones.compare_exchange_weak(head, zone, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void mem_snapshot(const char* label) {
+  if (label == nullptr) {
+    label = "?";
+  }
+  MemSlot* slot = find_mem_slot(label);
+  if (!slot) {
+    s_mem_overflow.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const uint32_t free_bytes = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  const uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  slot->count.fetch_add(1, std::memory_order_relaxed);
+  slot->last_free.store(free_bytes, std::memory_order_relaxed);
+  store_min(slot->min_free, free_bytes);
+  store_min(slot->min_largest, largest);
+}
+
+}  // namespace debug::profile
+
+using debug::profile::Zone;
+
+void debug_profile_dump(void) {
+  const uint32_t mhz = esp_rom_get_cpu_ticks_per_us() ? esp_rom_get_cpu_ticks_per_us() : 1;
+  Zone* zone = debug::profile::s_zones.load(std::memory_order_acquire);
+  if (!zone) {
+    printf("No profiling zones have run yet\n");
+  } else {
+    printf("Zones in cycles at %" PRIu32 " MHz (empty zone costs ~%" PRIu32 " cycles)\n", mhz,
+           debug::profile::measure_overhead());
+    printf("%-20s %8s %8s %8s %8s %8s %8s %10s\n", "zone", "count", "min", "p50", "p99", "max", "mean", "total ms");
+    for (; zone; zone = zone->next()) {
+      const auto summary = zone->histogram().summarize();
+      if (summary.count == 0) {
+        printf("%-20s %8s\n", zone->name(), "0");
+        continue;
+      }
+      const uint64_t total_us = summary.sum / mhz;
+      printf("%-20s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %6" PRIu32
+             ".%03" PRIu32 "\n",
+             zone->name(), summary.count, summary.min, summary.p50, summary.p99, summary.max, summary.mean,
+             static_cast<uint32_t>(total_us / 1000), static_cast<uint32_t>(total_us % 1000));
+    }
+  }
+
+  bool header = false;
+  for (const auto& slot : debug::profile::s_mem) {
+    const char* label = slot.label.load(std::memory_order_acquire);
+    if (!label || slot.count.load(std::memory_order_relaxed) == 0) {
+      continue;
+    }
+    if (!header) {
+      printf("\n%-20s %8s %10s %10s %12s\n", "heap snapshot", "count", "last free", "min free", "min largest");
+      header = true;
+    }
+    printf("%-20s %8" PRIu32 " %10" PRIu32 " %10" PRIu32 " %12" PRIu32 "\n", label,
+           slot.count.load(std::memory_order_relaxed), slot.last_free.load(std::memory_order_relaxed),
+           slot.min_free.load(std::memory_order_relaxed), slot.min_largest.load(std::memory_order_relaxed));
+  }
+  const uint32_t overflow = debug::profile::s_mem_overflow.load(std::memory_order_relaxed);
+  if (overflow) {
+    printf("%" PRIu32 " heap snapshots dropped (table full)\n", overflow);
+  }
+}
+
+void debug_profile_reset(void) {
+  for (Zone* zone = debug::profile::s_zones.load(std::memory_order_acquire); zone; zone = zone->next()) {
+    zone->histogram().reset();
+  }
+  for (auto& slot : debug::profile::s_mem) {
+    slot.count.store(0, std::memory_order_relaxed);
+    slot.last_free.store(0, std::memory_order_relaxed);
+    slot.min_free.store(UINT32_MAX, std::memory_order_relaxed);
+    slot.min_largest.store(UINT32_MAX, std::memory_order_relaxed);
+  }
+  debug::profile::s_mem_overflow.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,451 @@
+#include "debug/Telemetry.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "debug/StaticAlloc.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_APP_TELEMETRY_PERIOD_MS
+#define CONFIG_APP_TELEMETRY_PERIOD_MS 2000
+#endif
+#ifndef CONFIG_APP_TELEMETRY_HISTORY
+#define CONFIG_APP_TELEMETRY_HISTORY 30
+#endif
+#ifndef CONFIG_APP_TELEMETRY_MAX_TASKS
+#define CONFIG_APP_TELEMETRY_MAX_TASKS 24
+#endif
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+namespace {
+
+const char* kTag = "TELEMETRY";
+
+constexpr uint32_t kPeriodMs = CONFIG_APP_TELEMETRY_PERIOD_MS;
+constexpr size_t kHistory = CONFIG_APP_TELEMETRY_HISTORY;
+constexpr size_t kMaxTasks = CONFIG_APP_TELEMETRY_MAX_TASKS;
+constexpr uint32_t kSamplerStackSize = 3072;
+constexpr uint32_t kLowStackBytes = 256;
+constexpr uint16_t kAbsent = 0xFFFF;
+
+using RunTime = configRUN_TIME_COUNTER_TYPE;
+
+struct TaskSlot {
+  TaskHandle_t handle;
+  char name[TELEMETRY_TASK_NAME_LEN];
+  RunTime last_runtime;
+  uint32_t stack_free;
+  uint32_t priority;
+  uint16_t cpu_permille;
+  uint16_t peak_permille;
+  bool alive;
+  bool idle;
+  bool warned_stack;
+};
+
+// One history entry; per-task columns are indexed by TaskSlot.
+struct Sample {
+  uint32_t uptime_ms;
+  uint16_t busy_permille;
+  uint16_t task_count;
+  uint32_t internal_free;
+  uint32_t internal_min_free;
+  uint32_t internal_largest;
+  uint32_t dma_free;
+  uint32_t spiram_free;
+  uint16_t cpu_permille[kMaxTasks];
+  uint16_t stack_free[kMaxTasks];  // bytes, saturated at 0xFFFE
+};
+
+SemaphoreHandle_t s_lock = nullptr;
+TaskHandle_t s_sampler_task = nullptr;
+debug::StaticMutex s_lock_storage;
+debug::StaticTask<kSamplerStackSize> s_sampler_storage;
+TaskStatus_t s_status[kMaxTasks];
+TaskSlot s_slots[kMaxTasks];
+Sample s_history[kHistory];
+uint32_t s_samples = 0;  // appended since start/reset; newest is s_history[(s_samples - 1) % kHistory]
+RunTime s_last_total = 0;
+bool s_primed = false;
+uint32_t s_overflows = 0;
+
+uint8_t frag_pct(uint32_t free_bytes, uint32_t largest) {
+  if (free_bytes == 0 || largest >= free_bytes) {
+    return 0;
+  }
+  return static_cast<uint8_t>(100 - (static_cast<uint64_t>(largest) * 100) / free_bytes);
+}
+
+void forget_slot_history(size_t slot) {
+  for (auto& sample : s_history) {
+    sample.cpu_permille[slot] = kAbsent;
+    sample.stack_free[slot] = kAbsent;
+  }
+}
+
+// Slot for a task: same handle and name as before, else an unused slot or one whose task was gone last sample.
+int slot_for(const TaskStatus_t& status, const bool* seen) {
+  int claimable = -1;
+  for (size_t i = 0; i < kMaxTasks; ++i) {
+    TaskSlot& slot = s_slots[i];
+    if (slot.handle == status.xHandle && strncmp(slot.name, status.pcTaskName, sizeof(slot.name) - 1) == 0) {
+      return static_cast<int>(i);
+    }
+    if (claimable < 0 && !seen[i] && (slot.handle == nullptr || !slot.alive)) {
+      claimable = static_cast<int>(i);
+    }
+  }
+  if (claimable < 0) {
+    return -1;
+  }
+  TaskSlot& slot = s_slots[claimable];
+  slot = {};
+  slot.handle = status.xHandle;
+  strncpy(slot.name, status.pcTaskName, sizeof(slot.name) - 1);
+  slot.last_runtime = status.ulRunTimeCounter;
+  slot.idle = strncmp(slot.name, "IDLE", 4) == 0;
+  forget_slot_history(claimable);
+  return claimable;
+}
+
+void take_sample_locked() {
+  RunTime total = 0;
+  const UBaseType_t count = uxTaskGetSystemState(s_status, kMaxTasks, &total);
+  if (count == 0) {
+    // More tasks than CONFIG_APP_TELEMETRY_MAX_TASKS; FreeRTOS fills nothing in that case.
+    if (s_overflows++ == 0) {
+      ESP_LOGW(kTag, "More than %u tasks; raise APP_TELEMETRY_MAX_TASKS", static_cast<unsigned>(kMaxTasks));
+    }
+    return;
+  }
+  const uint64_t total_delta = static_cast<uint64_t>(static_cast<RunTime>(total - s_last_total)) * portNUM_PROCESSORS;
+  s_last_total = total;
+
+  bool seen[kMaxTasks] = {};
+  Sample& sample = s_history[s_samples % kHistory];
+  for (size_t i = 0; i < kMaxTasks; ++i) {
+    sample.cpu_permille[i] = kAbsent;
+    sample.stack_free[i] = kAbsent;
+  }
+
+  uint32_t idle_permille = 0;
+  uint16_t alive = 0;
+  for (UBaseType_t t = 0; t < count; ++t) {
+    const TaskStatus_t& status = s_status[t];
+    const int index = slot_for(status, seen);
+    if (index < 0) {
+      continue;
+    }
+    seen[index] = true;
+    TaskSlot& slot = s_slots[index];
+    const RunTime delta = status.ulRunTimeCounter - slot.last_runtime;
+    slot.last_runtime = status.ulRunTimeCounter;
+    uint32_t permille = total_delta ? static_cast<uint32_t>((static_cast<uint64_t>(delta) * 1000) / total_delta) : 0;
+    if (permille > 1000) {
+      permille = 1000;
+    }
+    slot.cpu_permille = static_cast<uint16_t>(permille);
+    slot.stack_free = static_cast<uint32_t>(status.usStackHighWaterMark) * sizeof(StackType_t);
+    slot.priority = status.uxCurrentPriority;
+    if (s_primed && slot.cpu_permille > slot.peak_permille) {
+      slot.peak_permille = slot.cpu_permille;
+    }
+    if (slot.idle) {
+      idle_permille += permille;
+    }
+    if (slot.stack_free < kLowStackBytes && !slot.warned_stack) {
+      slot.warned_stack = true;
+      ESP_LOGW(kTag, "Task '%s' has only %" PRIu32 " bytes of stack left", slot.name, slot.stack_free);
+    }
+    sample.cpu_permille[index] = slot.cpu_permille;
+    sample.stack_free[index] = static_cast<uint16_t>(slot.stack_free < kAbsent ? slot.stack_free : kAbsent - 1);
+    ++alive;
+  }
+
+  for (size_t i = 0; i < kMaxTasks; ++i) {
+    s_slots[i].alive = seen[i];
+  }
+
+  if (!s_primed) {
+    // The first pass only establishes the run-time baseline.
+    s_primed = true;
+    return;
+  }
+  idle_permille /= portNUM_PROCESSORS;
+  sample.uptime_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  sample.busy_permille = static_cast<uint16_t>(idle_permille < 1000 ? 1000 - idle_permille : 0);
+  sample.task_count = alive;
+  sample.internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  sample.internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  sample.internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  sample.dma_free = heap_caps_get_free_size(MALLOC_CAP_DMA);
+  sample.spiram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  ++s_samples;
+}
+
+void sampler_task(void*) {
+  TickType_t last_wake = xTaskGetTickCount();
+  while (true) {
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(kPeriodMs));
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    take_sample_locked();
+    xSemaphoreGive(s_lock);
+  }
+}
+
+const Sample* newest_locked() {
+  return s_samples ? &s_history[(s_samples - 1) % kHistory] : nullptr;
+}
+
+int find_slot_locked(const char* name) {
+  for (size_t i = 0; i < kMaxTasks; ++i) {
+    if (s_slots[i].handle && strncmp(s_slots[i].name, name, sizeof(s_slots[i].name) - 1) == 0) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void print_permille(uint32_t permille) {
+  printf("%3" PRIu32 ".%" PRIu32, permille / 10, permille % 10);
+}
+
+}  // namespace
+
+esp_err_t telemetry_start(void) {
+  if (s_sampler_task) {
+    return ESP_OK;
+  }
+  if (!s_lock) {
+    s_lock = s_lock_storage.create(MEM_BUDGET_DEBUG);
+    if (!s_lock) {
+      return ESP_ERR_NO_MEM;
+    }
+    mem_budget_charge(MEM_BUDGET_DEBUG, MEM_BUDGET_BUFFER, sizeof(s_status) + sizeof(s_slots) + sizeof(s_history),
+                      false);
+  }
+  take_sample_locked();
+  if (s_sampler_storage.create(sampler_task, "telemetry", nullptr, 1, &s_sampler_task, MEM_BUDGET_DEBUG) != pdPASS) {
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+esp_err_t telemetry_sample_now(void) {
+  if (!s_sampler_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  take_sample_locked();
+  xSemaphoreGive(s_lock);
+  return ESP_OK;
+}
+
+esp_err_t telemetry_get_summary(telemetry_summary_t* out_summary) {
+  if (!out_summary) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_sampler_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  const Sample* sample = newest_locked();
+  *out_summary = {};
+  out_summary->period_ms = kPeriodMs;
+  out_summary->samples = s_samples;
+  if (sample) {
+    out_summary->uptime_ms = sample->uptime_ms;
+    out_summary->cpu_busy_permille = sample->busy_permille;
+    out_summary->task_count = sample->task_count;
+    out_summary->internal_free = sample->internal_free;
+    out_summary->internal_min_free = sample->internal_min_free;
+    out_summary->internal_largest = sample->internal_largest;
+    out_summary->dma_free = sample->dma_free;
+    out_summary->spiram_free = sample->spiram_free;
+    out_summary->internal_frag_pct = frag_pct(sample->internal_free, sample->internal_largest);
+  }
+  xSemaphoreGive(s_lock);
+  return sample ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t telemetry_get_task(const char* name, telemetry_task_info_t* out_info) {
+  if (!name || !out_info) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_sampler_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  const int index = find_slot_locked(name);
+  if (index >= 0) {
+    const TaskSlot& slot = s_slots[index];
+    *out_info = {};
+    memcpy(out_info->name, slot.name, sizeof(out_info->name));
+    out_info->cpu_permille = slot.cpu_permille;
+    out_info->peak_cpu_permille = slot.peak_permille;
+    out_info->stack_free = slot.stack_free;
+    out_info->priority = slot.priority;
+    out_info->alive = slot.alive;
+  }
+  xSemaphoreGive(s_lock);
+  return index >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void telemetry_print_top(void) {
+  if (!s_sampler_task) {
+    printf("Telemetry not running\n");
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  const Sample* sample = newest_locked();
+  if (!sample) {
+    xSemaphoreGive(s_lock);
+    printf("No telemetry sample yet (period %" PRIu32 " ms)\n", kPeriodMs);
+    return;
+  }
+  printf("Uptime %" PRIu32 ".%" PRIu32 " s, sampled every %" PRIu32 " ms, CPU busy ", sample->uptime_ms / 1000,
+         (sample->uptime_ms % 1000) / 100, kPeriodMs);
+  print_permille(sample->busy_permille);
+  printf("%%, %u tasks\n", sample->task_count);
+  printf("Heap internal: %" PRIu32 " free, %" PRIu32 " min, %" PRIu32 " largest block (%u%% fragmented)\n",
+         sample->internal_free, sample->internal_min_free, sample->internal_largest,
+         frag_pct(sample->internal_free, sample->internal_largest));
+  printf("Heap DMA: %" PRIu32 " free", sample->dma_free);
+  if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM)) {
+    printf(", SPIRAM: %" PRIu32 " free", sample->spiram_free);
+  }
+  printf("\n\n%-16s %6s %6s %11s %5s\n", "TASK", "CPU%", "PEAK%", "STACK FREE", "PRIO");
+
+  // Busiest first; the table is small enough for a selection pass per row.
+  bool printed[kMaxTasks] = {};
+  for (size_t row = 0; row < kMaxTasks; ++row) {
+    int best = -1;
+    for (size_t i = 0; i < kMaxTasks; ++i) {
+      if (printed[i] || !s_slots[i].alive) {
+        continue;
+      }
+      if (best < 0 || s_slots[i].cpu_permille > s_slots[best].cpu_permille) {
+        best = static_cast<int>(i);
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+    printed[best] = true;
+    const TaskSlot& slot = s_slots[best];
+    printf("%-16s ", slot.name);
+    print_permille(slot.cpu_permille);
+    printf("  ");
+    print_permille(slot.peak_permille);
+    printf(" %11" PRIu32 " %5" PRIu32 "%s\n", slot.stack_free, slot.priority,
+           slot.stack_free < kLowStackBytes ? "  <-- low stack" : "");
+  }
+  xSemaphoreGive(s_lock);
+}
+
+void telemetry_print_history(uint32_t max_samples, const char* task) {
+  if (!s_sampler_task) {
+    printf("Telemetry not running\n");
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  const int task_slot = task ? find_slot_locked(task) : -1;
+  if (task && task_slot < 0) {
+    xSemaphoreGive(s_lock);
+    printf("Task '%s' has not been sampled\n", task);
+    return;
+  }
+  uint32_t count = s_samples < kHistory ? s_samples : kHistory;
+  if (max_samples && max_samples < count) {
+    count = max_samples;
+  }
+  if (task_slot >= 0) {
+    printf("%10s %6s %9s %9s %5s  %s: %6s %11s\n", "uptime s", "busy%", "int free", "largest", "frag", task, "CPU%",
+           "STACK FREE");
+  } else {
+    printf("%10s %6s %9s %9s %5s  %s\n", "uptime s", "busy%", "int free", "largest", "frag", "busiest task");
+  }
+  for (uint32_t n = s_samples - count; n != s_samples; ++n) {
+    const Sample& sample = s_history[n % kHistory];
+    printf("%6" PRIu32 ".%03" PRIu32 " ", sample.uptime_ms / 1000, sample.uptime_ms % 1000);
+    print_permille(sample.busy_permille);
+    printf("  %9" PRIu32 " %9" PRIu32 " %4u%%  ", sample.internal_free, sample.internal_largest,
+           frag_pct(sample.internal_free, sample.internal_largest));
+    int column = task_slot;
+    if (column < 0) {
+      for (size_t i = 0; i < kMaxTasks; ++i) {
+        if (sample.cpu_permille[i] == kAbsent || s_slots[i].idle) {
+          continue;
+        }
+        if (column < 0 || sample.cpu_permille[i] > sample.cpu_permille[column]) {
+          column = static_cast<int>(i);
+        }
+      }
+    }
+    if (column < 0 || sample.cpu_permille[column] == kAbsent) {
+      printf("-\n");
+      continue;
+    }
+    if (task_slot < 0) {
+      printf("%s ", s_slots[column].name);
+      print_permille(sample.cpu_permille[column]);
+      printf("%%\n");
+    } else {
+      printf("%*s  ", static_cast<int>(strlen(task)), "");
+      print_permille(sample.cpu_permille[column]);
+      printf(" %11u\n", sample.stack_free[column]);
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+void telemetry_reset(void) {
+  if (!s_sampler_task) {
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_samples = 0;
+  for (auto& slot : s_slots) {
+    slot.peak_permille = 0;
+    slot.warned_stack = false;
+  }
+  xSemaphoreGive(s_lock);
+}
+
+#else  // run-time stats disabled
+
+esp_err_t telemetry_start(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t telemetry_sample_now(void) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t telemetry_get_summary(telemetry_summary_t* out_summary) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t telemetry_get_task(const char* name, telemetry_task_info_t* out_info) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void telemetry_print_top(void) {
+  printf("Telemetry needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS\n");
+}
+
+void telemetry_print_history(uint32_t max_samples, const char* task) {
+  telemetry_print_top();
+}
+
+void telemetry_reset(void) {}
+
+#endif
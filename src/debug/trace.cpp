@@ -0,0 +1,246 @@
+#include "debug/Trace.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+namespace debug::trace {
+namespace {
+
+constexpr size_t kEntries = CONFIG_APP_TRACE_RING_ENTRIES;
+static_assert((kEntries & (kEntries - 1)) == 0, "CONFIG_APP_TRACE_RING_ENTRIES must be a power of two");
+
+struct Event {
+  std::atomic<uint32_t> sequence{0};  // index + 1 once the event is complete, 0 while being written
+  uint32_t timestamp_us = 0;
+  const char* func = nullptr;
+  const char* label = nullptr;
+  int32_t arg = 0;
+  Kind kind = Kind::kEnter;
+  uint8_t tag = kUnknownTag;
+};
+
+struct EventCopy {
+  uint32_t timestamp_us;
+  const char* func;
+  const char* label;
+  int32_t arg;
+  Kind kind;
+  uint8_t tag;
+};
+
+// Overwriting ring: writers claim an index with one fetch_add and never wait.
+template <size_t N>
+class EventRing {
+ public:
+  void record(Kind kind, uint8_t tag, const char* func, const char* label, int32_t arg) {
+    const uint32_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    Event& event = events_[index & (N - 1)];
+    event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_release);
+    event.timestamp_us = static_cast<uint32_t>(esp_timer_get_time());
+    event.func = func;
+    event.label = label;
+    event.arg = arg;
+    event.kind = kind;
+    event.tag = tag;
+    event.sequence.store(index + 1, std::memory_order_release);
+  }
+
+  bool read(uint32_t index, EventCopy* out) const {
+    const Event& event = events_[index & (N - 1)];
+    if (event.sequence.load(std::memory_order_acquire) != index + 1) {
+      return false;
+    }
+    *out = {event.timestamp_us, event.func, event.label, event.arg, event.kind, event.tag};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return event.sequence.load(std::memory_order_relaxed) == index + 1;
+  }
+
+  uint32_t head() const {
+    return head_.load(std::memory_order_acquire);
+  }
+
+  void clear() {
+    for (auto& event : events_) {
+      event.sequence.store(0, std::memory_order_relaxed);
+    }
+    head_.store(0, std::memory_order_release);
+  }
+
+ private:
+  std::atomic<uint32_t> head_{0};
+  Event events_[N];
+};
+
+EventRing<kEntries> s_ring;
+EventRing<8> s_bench_ring;
+std::atomic<bool> s_enabled{true};
+
+const char* kind_name(Kind kind) {
+  switch (kind) {
+    case Kind::kEnter:
+      return "ENTER";
+    case Kind::kExit:
+      return "EXIT";
+    case Kind::kExitRc:
+      return "EXIT";
+    case Kind::kParamInt:
+    case Kind::kParamUint:
+    case Kind::kParamBool:
+    case Kind::kParamStr:
+    case Kind::kParamPtr:
+      return "PARAM";
+    case Kind::kMem:
+      return "MEM";
+    case Kind::kStack:
+      return "STACK";
+    default:
+      return "?";
+  }
+}
+
+const char* tag_name(uint8_t tag) {
+  if (tag < sizeof(kTagLevels) / sizeof(kTagLevels[0])) {
+    return kTagLevels[tag].tag;
+  }
+  return "-";
+}
+
+void print_event(const EventCopy& event, uint32_t newest_us) {
+  const uint32_t age_us = newest_us - event.timestamp_us;
+  printf("%8" PRIu32 ".%03" PRIu32 " ms ago  %-8s %-7s %s", age_us / 1000, age_us % 1000, tag_name(event.tag),
+         kind_name(event.kind), event.func ? event.func : "?");
+  const char* label = event.label ? event.label : "";
+  switch (event.kind) {
+    case Kind::kExitRc:
+      printf(" rc=%" PRId32, event.arg);
+      break;
+    case Kind::kParamInt:
+      printf(" %s=%" PRId32, label, event.arg);
+      break;
+    case Kind::kParamUint:
+      printf(" %s=%" PRIu32, label, static_cast<uint32_t>(event.arg));
+      break;
+    case Kind::kParamBool:
+      printf(" %s=%s", label, event.arg ? "true" : "false");
+      break;
+    case Kind::kParamStr: {
+      char text[5] = {};
+      const uint32_t packed = static_cast<uint32_t>(event.arg);
+      for (int i = 0; i < 4; ++i) {
+        text[i] = static_cast<char>((packed >> (8 * i)) & 0xFF);
+      }
+      printf(" %s=\"%s%s\"", label, text, text[3] ? "..." : "");
+      break;
+    }
+    case Kind::kParamPtr:
+    case Kind::kStack:
+      printf(" %s=0x%08" PRIx32, event.kind == Kind::kStack ? "caller" : label, static_cast<uint32_t>(event.arg));
+      break;
+    case Kind::kMem:
+      printf(" [%s] internal_free=%" PRId32, label, event.arg);
+      break;
+    default:
+      break;
+  }
+  printf("\n");
+}
+
+}  // namespace
+
+int32_t free_internal_heap() {
+  return static_cast<int32_t>(heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+}
+
+void record(Kind kind, uint8_t tag, const char* func, const char* label, int32_t arg) {
+  if (!s_enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  s_ring.record(kind, tag, func, label, arg);
+}
+
+}  // namespace debug::trace
+
+using debug::trace::EventCopy;
+using debug::trace::s_bench_ring;
+using debug::trace::s_enabled;
+using debug::trace::s_ring;
+
+void debug_trace_set_enabled(bool enable) {
+  s_enabled.store(enable, std::memory_order_relaxed);
+}
+
+void debug_trace_clear(void) {
+  s_ring.clear();
+}
+
+void debug_trace_dump(uint32_t max_events) {
+  const uint32_t head = s_ring.head();
+  uint32_t count = head < debug::trace::kEntries ? head : debug::trace::kEntries;
+  if (max_events && max_events < count) {
+    count = max_events;
+  }
+  if (count == 0) {
+    printf("Trace ring is empty\n");
+    return;
+  }
+  EventCopy newest = {};
+  if (!s_ring.read(head - 1, &newest)) {
+    newest.timestamp_us = static_cast<uint32_t>(esp_timer_get_time());
+  }
+  uint32_t skipped = 0;
+  for (uint32_t index = head - count; index != head; ++index) {
+    EventCopy event;
+    if (!s_ring.read(index, &event)) {
+      ++skipped;
+      continue;
+    }
+    debug::trace::print_event(event, newest.timestamp_us);
+  }
+  printf("%" PRIu32 " events shown, %" PRIu32 " overwritten while reading, %" PRIu32 " recorded in total\n",
+         count - skipped, skipped, head);
+}
+
+void debug_trace_get_stats(debug_trace_stats_t* out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  out_stats->recorded = s_ring.head();
+  out_stats->capacity = debug::trace::kEntries;
+  out_stats->enabled = s_enabled.load(std::memory_order_relaxed);
+}
+
+esp_err_t debug_trace_benchmark(uint32_t iterations, debug_trace_bench_t* out_result) {
+  if (!out_result || iterations == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  static const char kLabel[] = "timeout_ms";
+  uint64_t traced_total = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const uint32_t start = esp_cpu_get_cycle_count();
+    s_bench_ring.record(debug::trace::Kind::kParamUint, 0, __func__, kLabel, static_cast<int32_t>(i));
+    traced_total += esp_cpu_get_cycle_count() - start;
+  }
+
+  // What the previous ESP_LOGD-based macro paid just to format the same event.
+  char line[96];
+  uint64_t format_total = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const uint32_t start = esp_cpu_get_cycle_count();
+    snprintf(line, sizeof(line), "D (%lu) %s: PARAM %s=%u\n", (unsigned long)i, "ZB_LINK", kLabel, (unsigned)i);
+    format_total += esp_cpu_get_cycle_count() - start;
+  }
+
+  out_result->iterations = iterations;
+  out_result->traced_cycles = static_cast<uint32_t>(traced_total / iterations);
+  out_result->log_format_cycles = static_cast<uint32_t>(format_total / iterations);
+  out_result->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+  return ESP_OK;
+}
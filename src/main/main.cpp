@@ -1,15 +1,25 @@
 #include <stdio.h>
 
+#include "attr_ingest.h"
 #include "bluetooth_manager.h"
 #include "cli_manager.h"
+#include "debug/MemBudget.h"
+#include "debug/Telemetry.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "h2_log.h"
+#include "h2_ota.h"
+#include "history.h"
 #include "led_driver.h"
 #include "nvs_flash.h"
+#include "ota_client.h"
+#include "radio_scheduler.h"
 #include "sdkconfig.h"
 #include "uart_link.h"
 #include "wifi_manager.h"
+#include "zb_command.h"
+#include "zigbee_manager.h"
 
 static const char* TAG = "MAIN";
 
@@ -25,6 +35,11 @@ extern "C" void app_main(void) {
   }
   ESP_ERROR_CHECK(ret);
 
+  esp_err_t telemetry = telemetry_start();
+  if (telemetry != ESP_OK) {
+    ESP_LOGW(TAG, "Telemetry sampler not started: %s", esp_err_to_name(telemetry));
+  }
+
   // Initialize Drivers
   ESP_ERROR_CHECK(led_driver_init());
   ESP_ERROR_CHECK(led_driver_set_state_color(0, 0, 20));
@@ -48,19 +63,41 @@ extern "C" void app_main(void) {
     ESP_LOGW(TAG, "WiFi not connected (no credentials?). Use CLI to provision.");
   }
 
+  // An image an OTA update just installed is kept only once WiFi and the H2 link come up.
+  if (ota_client_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Could not start the OTA health check");
+  }
+
   ESP_ERROR_CHECK(bluetooth_manager_init());
+  if (radio_scheduler_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Radio priority not applied; BLE scans use controller defaults");
+  }
 #if CONFIG_APP_ENABLE_UART_LINK
   printf("DEBUG: Calling uart_link_init\n");
   ESP_ERROR_CHECK(uart_link_init());
   printf("DEBUG: uart_link_init returned\n");
-  esp_err_t hs = uart_link_run_startup_check(CONFIG_APP_UART_LINK_HANDSHAKE_TIMEOUT_MS);
-  if (hs == ESP_OK) {
-    ESP_LOGI(TAG, "UART handshake with Zigbee co-processor OK");
-  } else if (hs == ESP_ERR_TIMEOUT) {
-    ESP_LOGW(TAG, "UART handshake timed out; use 'zb_check' to retry");
-  } else {
-    ESP_LOGE(TAG, "UART handshake failed: %s", esp_err_to_name(hs));
+  ESP_LOGI(TAG, "Zigbee co-processor link negotiating in the background ('zb_info' shows state)");
+  if (h2_ota_init() != ESP_OK) {
+    ESP_LOGW(TAG, "H2 OTA relay unavailable");
+  }
+  if (h2_log_init() != ESP_OK) {
+    ESP_LOGW(TAG, "H2 log stream unavailable");
   }
+  if (zb_command_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Typed Zigbee commands unavailable");
+  }
+  if (attr_ingest_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Attribute report filter unavailable");
+  }
+  if (history_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Sensor history unavailable");
+  }
+#if CONFIG_APP_ZIGBEE_NATIVE_NETWORK
+  // After zb_command and attr_ingest, which take its responses and reports.
+  if (zigbee_manager_init() != ESP_OK || zigbee_manager_start() != ESP_OK) {
+    ESP_LOGW(TAG, "Native Zigbee network unavailable");
+  }
+#endif
 #else
   ESP_LOGI(TAG, "Zigbee UART link disabled via menuconfig.");
 #endif
@@ -68,6 +105,9 @@ extern "C" void app_main(void) {
   // Initialize CLI
   ESP_ERROR_CHECK(cli_manager_init());
 
+  // Every long-lived task, queue and buffer exists by now.
+  mem_budget_print();
+
   while (1) {
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
@@ -0,0 +1,190 @@
+// AttrFilter: deadbands, the minimum interval with the latest value winning, the maximum
+// interval refresh, rule specificity, the same short address on two networks, eviction, a
+// full table, and an hour of chatty sensors.
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "attr_filter.h"
+#include "check.h"
+
+namespace {
+
+using Verdict = AttrFilter::Verdict;
+
+constexpr uint8_t kInt16 = 0x29;
+constexpr uint8_t kUint64 = 0x27;
+constexpr uint8_t kString = 0x42;
+constexpr uint8_t kNet = 0;  // the primary link
+const attr_ingest_rule_t kFallback = {ATTR_INGEST_ANY, ATTR_INGEST_ANY, 0, 0, 1000, 60000};
+const attr_ingest_rule_t kTemperature = {0x0402, 0x0000, 10, 0, 1000, 300000};
+
+zb_cmd_target_t source(uint16_t device) {
+  zb_cmd_target_t target = {};
+  target.short_addr = device;
+  target.endpoint = 1;
+  return target;
+}
+
+zb_attr_report_t report(uint16_t device, uint16_t cluster, uint16_t attribute, int16_t value) {
+  zb_attr_report_t out = {};
+  out.source = source(device);
+  out.attr.cluster = cluster;
+  out.attr.attribute = attribute;
+  out.attr.zcl_type = kInt16;
+  out.attr.length = sizeof(value);
+  memcpy(out.attr.value, &value, sizeof(value));
+  return out;
+}
+
+int16_t value_of(const zb_rsp_read_attr_t& attr) {
+  int16_t value;
+  memcpy(&value, attr.value, sizeof(value));
+  return value;
+}
+
+void test_rules() {
+  AttrFilter filter(kFallback);
+  CHECK(filter.set_rule(kTemperature));
+  AttrFilter::Released out[8];
+
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2000), 0) == Verdict::kForward);
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2005), 2000) == Verdict::kFiltered);  // inside the deadband
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2010), 3000) == Verdict::kForward);
+  // Inside the minimum interval: held, and the latest value replaces the one before.
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2050), 3100) == Verdict::kHeld);
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2060), 3200) == Verdict::kHeld);
+  CHECK_EQ(filter.take_due(3500, out, 8), 0u);
+  CHECK_EQ(filter.take_due(4000, out, 8), 1u);
+  CHECK_EQ(value_of(out[0].report.attr), 2060);
+  CHECK_EQ(out[0].rx_ms, 3200u);
+  // A held value that drifts back into the deadband is dropped when its interval closes.
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2100), 4100) == Verdict::kHeld);
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2062), 4200) == Verdict::kHeld);
+  CHECK_EQ(filter.take_due(5000, out, 8), 0u);
+  // Unchanged past the maximum interval: refreshed.
+  CHECK(filter.offer(kNet, report(1, 0x0402, 0, 2060), 5000 + 300000) == Verdict::kForward);
+
+  // The fallback rule forwards any change and filters repeats.
+  CHECK(filter.offer(kNet, report(2, 0x0006, 0, 1), 0) == Verdict::kForward);
+  CHECK(filter.offer(kNet, report(2, 0x0006, 0, 1), 5000) == Verdict::kFiltered);
+  CHECK(filter.offer(kNet, report(2, 0x0006, 0, 0), 6000) == Verdict::kForward);
+
+  // A cluster-wide permille deadband on negative values.
+  CHECK(filter.set_rule({0x0B04, ATTR_INGEST_ANY, 1, 20, 0, 0}));
+  CHECK(&filter.rule_for(0x0B04, 0x050B) == &filter.rule(2));
+  CHECK(filter.offer(kNet, report(3, 0x0B04, 0x050B, -1000), 0) == Verdict::kForward);
+  CHECK(filter.offer(kNet, report(3, 0x0B04, 0x050B, -1019), 10) == Verdict::kFiltered);
+  CHECK(filter.offer(kNet, report(3, 0x0B04, 0x050B, -1020), 20) == Verdict::kForward);
+
+  // Non-numeric values compare by bytes.
+  zb_attr_report_t text = report(4, 0x0000, 5, 0);
+  text.attr.zcl_type = kString;
+  CHECK(filter.offer(kNet, text, 0) == Verdict::kForward);
+  CHECK(filter.offer(kNet, text, 2000) == Verdict::kFiltered);
+  text.attr.value[1] = 9;
+  CHECK(filter.offer(kNet, text, 4000) == Verdict::kForward);
+
+  // 64-bit counters at their extremes do not overflow the permille deadband.
+  CHECK(filter.set_rule({0x0702, ATTR_INGEST_ANY, 0, 10, 0, 0}));
+  zb_attr_report_t meter = report(5, 0x0702, 0, 0);
+  meter.attr.zcl_type = kUint64;
+  meter.attr.length = 8;
+  memset(meter.attr.value, 0xFF, 8);
+  CHECK(filter.offer(kNet, meter, 0) == Verdict::kForward);
+  meter.attr.value[0] = 0;
+  CHECK(filter.offer(kNet, meter, 1) == Verdict::kFiltered);
+
+  attr_ingest_stats_t stats;
+  filter.fill_stats(&stats);
+  CHECK_EQ(stats.received, stats.forwarded + stats.filtered + stats.coalesced + stats.held);
+}
+
+void test_networks() {
+  AttrFilter filter(kFallback);
+  CHECK(filter.set_rule(kTemperature));
+  // Device 1 on link 0 and device 1 on link 1 are different sensors: neither filters the other.
+  CHECK(filter.offer(0, report(1, 0x0402, 0, 2000), 0) == Verdict::kForward);
+  CHECK(filter.offer(1, report(1, 0x0402, 0, 2000), 0) == Verdict::kForward);
+  CHECK(filter.offer(1, report(1, 0x0402, 0, 2005), 500) == Verdict::kFiltered);
+  CHECK(filter.offer(0, report(1, 0x0402, 0, 2100), 600) == Verdict::kHeld);
+  CHECK(filter.offer(1, report(1, 0x0402, 0, 2200), 700) == Verdict::kHeld);
+  AttrFilter::Released out[8];
+  CHECK_EQ(filter.take_due(1000, out, 8), 2u);
+  for (int i = 0; i < 2; ++i) {
+    CHECK_EQ(value_of(out[i].report.attr), out[i].network ? 2200 : 2100);
+  }
+  CHECK(out[0].network != out[1].network);
+  attr_ingest_stats_t stats;
+  filter.fill_stats(&stats);
+  CHECK_EQ(stats.entries, 2u);
+  CHECK_EQ(stats.devices, 2u);
+}
+
+void test_table_limits() {
+  attr_ingest_stats_t stats;
+  AttrFilter evicting(kFallback);
+  for (int i = 0; i < AttrFilter::kEntries + 10; ++i) {
+    evicting.offer(kNet, report(static_cast<uint16_t>(100 + i), 0x0402, 0, 1), static_cast<uint32_t>(i));
+  }
+  evicting.fill_stats(&stats);
+  CHECK_EQ(stats.entries, static_cast<uint32_t>(AttrFilter::kEntries));
+  CHECK_EQ(stats.evictions, 10u);
+  CHECK_EQ(stats.devices, static_cast<uint32_t>(AttrFilter::kDevices));
+
+  // With every entry holding a value, a new attribute is forwarded untracked.
+  AttrFilter full(kFallback);
+  for (int i = 0; i < AttrFilter::kEntries; ++i) {
+    full.offer(kNet, report(static_cast<uint16_t>(i), 1, 0, 1), 0);
+    full.offer(kNet, report(static_cast<uint16_t>(i), 1, 0, 2), 10);
+  }
+  CHECK(full.offer(kNet, report(999, 1, 0, 1), 20) == Verdict::kForward);
+  full.fill_stats(&stats);
+  CHECK_EQ(stats.untracked, 1u);
+  CHECK_EQ(stats.held, static_cast<uint32_t>(AttrFilter::kEntries));
+  AttrFilter::Released out[8];
+  size_t released = 0;
+  size_t batch;
+  while ((batch = full.take_due(2000, out, 8)) > 0) {
+    released += batch;
+  }
+  full.fill_stats(&stats);
+  CHECK_EQ(released, static_cast<size_t>(AttrFilter::kEntries));
+  CHECK_EQ(stats.held, 0u);
+}
+
+// A temperature sensor with 0.01 degC resolution and a noisy power meter, both at 2 Hz.
+void test_chatty_sensors() {
+  AttrFilter filter(kFallback);
+  filter.set_rule(kTemperature);
+  filter.set_rule({0x0B04, 0x050B, 1, 20, 1000, 300000});
+  std::mt19937 rng(1);
+  std::normal_distribution<double> noise(0, 3);
+  double temperature = 2150;
+  double power = 1200;
+  AttrFilter::Released out[8];
+  for (uint32_t t = 0; t < 3600 * 1000; t += 500) {
+    temperature += noise(rng) * 0.3;
+    power += noise(rng) * 2;
+    filter.offer(kNet, report(10, 0x0402, 0, static_cast<int16_t>(temperature)), t);
+    filter.offer(kNet, report(11, 0x0B04, 0x050B, static_cast<int16_t>(power)), t);
+    filter.take_due(t, out, 8);
+  }
+  attr_ingest_stats_t stats;
+  filter.fill_stats(&stats);
+  const double filtered = 100.0 * (stats.received - stats.forwarded) / stats.received;
+  printf("1 h of 2 sensors at 2 Hz: %u reports, %u forwarded (%.1f%% filtered)\n", stats.received,
+         stats.forwarded, filtered);
+  CHECK_EQ(stats.received, 14400u);
+  CHECK(filtered > 90);
+}
+
+}  // namespace
+
+int main() {
+  test_rules();
+  test_networks();
+  test_table_limits();
+  test_chatty_sensors();
+  return check_result("attr_filter_test");
+}
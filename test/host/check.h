@@ -0,0 +1,43 @@
+#ifndef HOST_TEST_CHECK_H_
+#define HOST_TEST_CHECK_H_
+
+#include <cstdio>
+
+/*
+ * Minimal assertions for the host tests: a failed CHECK reports and counts, the test keeps
+ * going, and main() returns check_result() so ctest sees the failure.
+ */
+inline int& check_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      ++check_failures();                                                      \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                                              \
+  do {                                                                                              \
+    const auto check_a_ = (a);                                                                      \
+    const auto check_b_ = (b);                                                                      \
+    if (!(check_a_ == check_b_)) {                                                                  \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, \
+              static_cast<long long>(check_a_), static_cast<long long>(check_b_));                  \
+      ++check_failures();                                                                           \
+    }                                                                                               \
+  } while (0)
+
+inline int check_result(const char* name) {
+  if (check_failures()) {
+    printf("%s: %d check(s) failed\n", name, check_failures());
+    return 1;
+  }
+  printf("%s: ok\n", name);
+  return 0;
+}
+
+#endif  // HOST_TEST_CHECK_H_
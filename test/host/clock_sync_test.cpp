@@ -0,0 +1,137 @@
+// ClockSync against a simulated H2 clock with skew, queueing jitter and long-queue outliers:
+// offset and drift accuracy, 32-bit stamp mapping, rejected samples and an H2 clock jump.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "check.h"
+#include "clock_sync.h"
+
+namespace {
+
+constexpr double kExchangeUs = 2e6;    // APP_UART_LINK_CLOCK_SYNC_MS
+constexpr double kWireUs = 32 * 86.8;  // 25-byte heartbeat with framing at 115200
+constexpr double kOutlierUs = 30000;   // a leg stuck behind a long queue
+constexpr double kMaxOffsetErrUs = 1000;
+constexpr double kMaxDriftErrPpm = 5;
+
+// remote = offset0 + local * (1 + skew)
+struct Peer {
+  double offset0_us;
+  double skew;
+  double remote(double local_us) const {
+    return offset0_us + local_us * (1.0 + skew);
+  }
+};
+
+struct RunResult {
+  double mean_err_us;
+  double worst_err_us;   // after the first 2 minutes
+  double drift_err_ppm;  // after the first 5 minutes
+  double stamp_age_us;   // a stamp taken 3 ms ago, mapped back
+};
+
+// Ten minutes of exchanges; each leg has 0-1.5 ms queueing and a 10% chance of an outlier.
+RunResult run(double skew_ppm, double offset0_us, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> queue(0, 1500);
+  std::uniform_real_distribution<double> turnaround(50, 400);
+  std::uniform_real_distribution<double> unit(0, 1);
+  const Peer peer = {offset0_us, skew_ppm * 1e-6};
+  ClockSync sync;
+  RunResult result = {};
+  double err_sum = 0;
+  int err_count = 0;
+  for (int i = 0; i < 300; ++i) {
+    const double t1 = 5e6 + i * kExchangeUs + queue(rng);
+    const double up = kWireUs + queue(rng) + (unit(rng) < 0.1 ? kOutlierUs : 0);
+    const double t2 = peer.remote(t1 + up);
+    const double t3 = t2 + turnaround(rng);
+    const double down = kWireUs + queue(rng) + (unit(rng) < 0.1 ? kOutlierUs : 0);
+    const double t4 = t1 + up + (t3 - t2) / (1 + peer.skew) + down;
+    sync.add_sample(static_cast<int64_t>(t1), static_cast<int64_t>(t2), static_cast<int64_t>(t3),
+                    static_cast<int64_t>(t4));
+    // Right after the exchange and just before the next one.
+    for (double ahead_us : {0.0, 1.5e6}) {
+      const double now = t4 + ahead_us;
+      const double estimate = static_cast<double>(sync.offset_at(static_cast<int64_t>(now)));
+      const double err = fabs(estimate - (peer.remote(now) - now));
+      if (i >= 60) {
+        result.worst_err_us = fmax(result.worst_err_us, err);
+        err_sum += err;
+        ++err_count;
+      }
+    }
+    if (i >= 150) {
+      result.drift_err_ppm = fmax(result.drift_err_ppm, fabs(sync.estimate().drift_ppb / 1000.0 - skew_ppm));
+    }
+  }
+  result.mean_err_us = err_sum / err_count;
+  const double now = 5e6 + 300 * kExchangeUs + 10000;
+  const uint32_t stamp = static_cast<uint32_t>(static_cast<uint64_t>(peer.remote(now - 3000)));
+  result.stamp_age_us = now - static_cast<double>(sync.remote32_to_local(stamp, static_cast<int64_t>(now)));
+  return result;
+}
+
+bool within_bounds(const RunResult& result) {
+  return result.worst_err_us < kMaxOffsetErrUs && result.drift_err_ppm < kMaxDriftErrPpm &&
+         fabs(result.stamp_age_us - 3000) < kMaxOffsetErrUs;
+}
+
+void test_estimator() {
+  struct Case {
+    double skew_ppm;
+    double offset0_us;
+  };
+  // The last offsets go beyond 2^32 us, where the 32-bit stamps wrap.
+  const Case cases[] = {{0, 123456789}, {40, -987654321}, {-100, 4e9 + 12345}, {100, 71.6 * 60e6}};
+  unsigned seed = 1;
+  for (const Case& c : cases) {
+    const RunResult result = run(c.skew_ppm, c.offset0_us, seed++);
+    printf("skew %+6.1f ppm: mean %.0f us, worst %.0f us after 2 min, drift error %.2f ppm, stamp %.0f us ago\n",
+           c.skew_ppm, result.mean_err_us, result.worst_err_us, result.drift_err_ppm, result.stamp_age_us);
+    CHECK(within_bounds(result));
+  }
+  int outside = 0;
+  for (unsigned s = 10; s < 200; ++s) {
+    outside += within_bounds(run(static_cast<int>(s * 37 % 200) - 100, s * 1e8, s)) ? 0 : 1;
+  }
+  printf("190 random runs, |skew| <= 100 ppm: %d outside 1 ms / 5 ppm\n", outside);
+  CHECK_EQ(outside, 0);
+}
+
+void test_rejects() {
+  ClockSync sync;
+  CHECK(!sync.add_sample(100, 0, 0, 50));      // reply before request
+  CHECK(!sync.add_sample(0, 0, 0, 10000000));  // 10 s round trip
+  CHECK(!sync.estimate().valid);
+  CHECK_EQ(sync.rejected(), 2u);
+}
+
+// The H2 reboots and its clock jumps back an hour: the fit starts over instead of
+// reading the jump as drift.
+void test_clock_jump() {
+  ClockSync sync;
+  for (int64_t i = 0; i < 40; ++i) {
+    const int64_t t1 = i * 2000000;
+    const int64_t remote = i < 20 ? t1 : t1 - 3600000000LL;
+    sync.add_sample(t1, remote + 5000, remote + 5100, t1 + 200);
+  }
+  printf("after a 1 h jump: offset %lld us, drift %d ppb, jumps %u\n",
+         static_cast<long long>(sync.estimate().offset_us), static_cast<int>(sync.estimate().drift_ppb),
+         sync.jumps());
+  CHECK(sync.jumps() >= 1);
+  // ((t2 - t1) + (t3 - t4)) / 2 = 4950 us, an hour back.
+  CHECK(std::llabs(sync.estimate().offset_us - (4950 - 3600000000LL)) < 1000);
+  CHECK(std::abs(sync.estimate().drift_ppb) < 1000);
+}
+
+}  // namespace
+
+int main() {
+  test_estimator();
+  test_rejects();
+  test_clock_jump();
+  return check_result("clock_sync_test");
+}
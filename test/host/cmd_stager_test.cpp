@@ -0,0 +1,327 @@
+// CommandStager: the token bucket, latest-wins coalescing, the same short address on two
+// networks, per-device arrival order when a toggle or read overtakes staged commands,
+// restaging after a failed send, and the on-device flood scenarios driven the way
+// zb_command_stage() and the stage timer drive the stager.
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "cmd_stager.h"
+
+namespace {
+
+using Verdict = CommandStager::Verdict;
+
+constexpr size_t kStageBatch = 4;  // as in zb_command.cpp
+constexpr uint32_t kFlushMs = 20;  // APP_ZB_STAGE_FLUSH_MS
+constexpr uint8_t kNet = 0;        // the primary link
+
+zb_cmd_level_t level(uint16_t device, uint8_t value, uint16_t seq = 0) {
+  return {{device, 1}, value, seq};
+}
+
+uint8_t level_of(const CommandStager::Command& command) {
+  zb_cmd_level_t body;
+  memcpy(&body, command.body, sizeof(body));
+  return body.level;
+}
+
+void test_bucket_and_coalescing() {
+  CommandStager stager;
+  stager.configure(10, 2);
+  zb_cmd_level_t l = level(1, 10);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &l, sizeof(l), 0) == Verdict::kSendNow);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &l, sizeof(l), 1) == Verdict::kSendNow);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &l, sizeof(l), 2) == Verdict::kStaged);
+  const zb_cmd_on_off_t on = {{1, 1}, ZB_ON_OFF_ON};
+  CHECK(stager.offer(kNet, ZB_CMD_ON_OFF, &on, sizeof(on), 5) == Verdict::kStaged);
+  // The newer level replaces the staged one and takes its arrival time: it now goes out after "on".
+  l.level = 20;
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &l, sizeof(l), 8) == Verdict::kCoalesced);
+  CommandStager::Command out[4];
+  CHECK_EQ(stager.take_due(50, out, 4), 0u);
+  CHECK_EQ(stager.take_due(100, out, 4), 1u);
+  CHECK_EQ(out[0].command, ZB_CMD_ON_OFF);
+  CHECK_EQ(stager.take_due(200, out, 4), 1u);
+  CHECK_EQ(out[0].command, ZB_CMD_LEVEL);
+  CHECK_EQ(level_of(out[0]), 20);
+  CHECK_EQ(out[0].staged_ms, 8u);
+  CHECK_EQ(stager.stats().max_delay_ms, 192u);
+  CHECK_EQ(stager.staged(), 0u);
+  // Other devices have their own buckets.
+  const zb_cmd_level_t other = level(2, 10);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &other, sizeof(other), 201) == Verdict::kSendNow);
+}
+
+void test_networks() {
+  CommandStager stager;
+  stager.configure(10, 1);
+  CommandStager::Command out[4];
+  // Device 1 on link 0 and device 1 on link 1 are two devices: separate buckets, no coalescing.
+  const zb_cmd_level_t a = level(1, 10);
+  const zb_cmd_level_t b = level(1, 20);
+  CHECK(stager.offer(0, ZB_CMD_LEVEL, &a, sizeof(a), 0) == Verdict::kSendNow);
+  CHECK(stager.offer(1, ZB_CMD_LEVEL, &b, sizeof(b), 0) == Verdict::kSendNow);
+  CHECK(stager.offer(0, ZB_CMD_LEVEL, &a, sizeof(a), 10) == Verdict::kStaged);
+  CHECK(stager.offer(1, ZB_CMD_LEVEL, &b, sizeof(b), 20) == Verdict::kStaged);
+  CHECK_EQ(stager.staged(), 2u);
+  CHECK_EQ(stager.stats().coalesced, 0u);
+  // A toggle flushes only its own network's device.
+  const zb_cmd_on_off_t toggle = {{1, 1}, ZB_ON_OFF_TOGGLE};
+  CHECK(stager.offer(1, ZB_CMD_ON_OFF, &toggle, sizeof(toggle), 30) == Verdict::kFlushFirst);
+  CHECK_EQ(stager.take_device(1, 1, 30, out, 4), 1u);
+  CHECK_EQ(out[0].network, 1);
+  CHECK_EQ(level_of(out[0]), 20);
+  CHECK_EQ(stager.take_due(100, out, 4), 1u);
+  CHECK_EQ(out[0].network, 0);
+  CHECK_EQ(level_of(out[0]), 10);
+}
+
+void test_bypass_keeps_order() {
+  CommandStager stager;
+  stager.configure(5, 1);
+  CommandStager::Command out[CommandStager::kSlots];
+  const zb_cmd_level_t first = level(1, 10);
+  const zb_cmd_level_t second = level(1, 20);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &first, sizeof(first), 0) == Verdict::kSendNow);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &second, sizeof(second), 10) == Verdict::kStaged);
+  // A toggle for another device is not held back by device 1's stage.
+  const zb_cmd_on_off_t elsewhere = {{2, 1}, ZB_ON_OFF_TOGGLE};
+  CHECK(stager.offer(kNet, ZB_CMD_ON_OFF, &elsewhere, sizeof(elsewhere), 20) == Verdict::kSendNow);
+  // A toggle or read for device 1 must not overtake its staged level.
+  const zb_cmd_on_off_t toggle = {{1, 1}, ZB_ON_OFF_TOGGLE};
+  CHECK(stager.offer(kNet, ZB_CMD_ON_OFF, &toggle, sizeof(toggle), 30) == Verdict::kFlushFirst);
+  CHECK_EQ(stager.take_device(kNet, 1, 30, out, CommandStager::kSlots), 1u);
+  CHECK_EQ(level_of(out[0]), 20);
+  CHECK_EQ(stager.staged(), 0u);
+  const zb_cmd_read_attr_t read = {{1, 1}, 0x0008, 0x0000};
+  CHECK(stager.offer(kNet, ZB_CMD_READ_ATTR, &read, sizeof(read), 40) == Verdict::kSendNow);
+  // The flush spent the bucket: the next level waits for it to refill.
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &first, sizeof(first), 50) == Verdict::kStaged);
+  CHECK_EQ(stager.stats().flushed, 1u);
+
+  // With every slot taken, a new target on a staged device bypasses the stage behind a flush.
+  CommandStager full;
+  full.configure(1, 1);
+  for (uint16_t i = 0; i < CommandStager::kSlots + 1; ++i) {
+    const zb_cmd_level_t l = {{1, static_cast<uint8_t>(i + 1)}, 1, 0};
+    full.offer(kNet, ZB_CMD_LEVEL, &l, sizeof(l), 0);
+  }
+  CHECK_EQ(full.staged(), static_cast<size_t>(CommandStager::kSlots));
+  const zb_cmd_level_t extra = {{1, 200}, 1, 0};
+  CHECK(full.offer(kNet, ZB_CMD_LEVEL, &extra, sizeof(extra), 1) == Verdict::kFlushFirst);
+  CHECK_EQ(full.take_device(kNet, 1, 1, out, CommandStager::kSlots), static_cast<size_t>(CommandStager::kSlots));
+  // Oldest first.
+  CHECK_EQ(out[0].body[2], 2);
+  CHECK_EQ(out[CommandStager::kSlots - 1].body[2], CommandStager::kSlots + 1);
+}
+
+void test_restage() {
+  CommandStager stager;
+  stager.configure(10, 1);
+  CommandStager::Command out[4];
+  const zb_cmd_level_t a = level(1, 10);
+  const zb_cmd_color_t b = {{1, 1}, 0x1000, 0x2000, 0};
+  stager.offer(kNet, ZB_CMD_LEVEL, &a, sizeof(a), 0);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &a, sizeof(a), 10) == Verdict::kStaged);
+  CHECK(stager.offer(kNet, ZB_CMD_COLOR, &b, sizeof(b), 20) == Verdict::kStaged);
+  CHECK_EQ(stager.take_due(100, out, 4), 1u);
+  CHECK_EQ(out[0].command, ZB_CMD_LEVEL);
+  // The send failed: the level goes back ahead of the colour staged after it.
+  CHECK(stager.restage(out[0]));
+  CHECK_EQ(stager.take_due(200, out, 4), 1u);
+  CHECK_EQ(out[0].command, ZB_CMD_LEVEL);
+  CHECK_EQ(out[0].staged_ms, 10u);
+  // A newer level staged while the old one was out wins over the old one coming back.
+  const CommandStager::Command failed = out[0];
+  const zb_cmd_level_t newer = level(1, 99);
+  CHECK(stager.offer(kNet, ZB_CMD_LEVEL, &newer, sizeof(newer), 210) == Verdict::kStaged);
+  CHECK(stager.restage(failed));
+  CHECK_EQ(stager.staged(), 2u);
+  CHECK_EQ(stager.take_due(300, out, 4), 1u);
+  CHECK_EQ(out[0].command, ZB_CMD_COLOR);
+  CHECK_EQ(stager.take_due(400, out, 4), 1u);
+  CHECK_EQ(level_of(out[0]), 99);
+  CHECK_EQ(stager.stats().restaged, 2u);
+}
+
+struct Sent {
+  uint16_t device;
+  uint8_t command;
+  uint16_t seq;  // arrival order, carried in transition_ds
+  uint8_t value;
+};
+
+struct FloodResult {
+  uint32_t commands;
+  uint32_t frames;
+  uint32_t failed_sends;
+  uint32_t max_delay_ms;
+  bool in_order;
+  bool final_state_sent;
+};
+
+// Stands in for the command channel. A send for the stage fails (channel full, retryable) with the
+// given odds; a caller's own command always goes out, as a caller retries on ESP_ERR_TIMEOUT.
+class Wire {
+ public:
+  Wire(uint32_t fail_permille, uint32_t seed) : fail_permille_(fail_permille), rng_(seed) {}
+
+  bool send(uint8_t command, const uint8_t* body, uint32_t now_ms, uint32_t arrived_ms, bool may_fail,
+            FloodResult* result) {
+    if (may_fail && fail_permille_ && rng_() % 1000 < fail_permille_) {
+      result->failed_sends++;
+      return false;
+    }
+    zb_cmd_target_t target;
+    memcpy(&target, body, sizeof(target));
+    Sent sent = {target.short_addr, command, 0, 0};
+    if (command == ZB_CMD_LEVEL) {
+      zb_cmd_level_t l;
+      memcpy(&l, body, sizeof(l));
+      sent.seq = l.transition_ds;
+      sent.value = l.level;
+    } else if (command == ZB_CMD_READ_ATTR) {
+      zb_cmd_read_attr_t r;
+      memcpy(&r, body, sizeof(r));
+      sent.seq = r.attribute;
+    }
+    log.push_back(sent);
+    result->frames++;
+    if (now_ms - arrived_ms > result->max_delay_ms) {
+      result->max_delay_ms = now_ms - arrived_ms;
+    }
+    return true;
+  }
+
+  std::vector<Sent> log;
+
+ private:
+  uint32_t fail_permille_;
+  std::mt19937 rng_;
+};
+
+// As stage_send_released(): on a failure the rest goes back to the stage, so nothing overtakes it.
+bool send_released(CommandStager& stager, Wire& wire, const CommandStager::Command* commands, size_t count,
+                   uint32_t now_ms, FloodResult* result) {
+  for (size_t i = 0; i < count; ++i) {
+    if (!wire.send(commands[i].command, commands[i].body, now_ms, commands[i].staged_ms, true, result)) {
+      for (size_t j = i; j < count; ++j) {
+        stager.restage(commands[j]);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+// Level commands at period_ms to `devices` bulbs for duration_ms, with a read of each bulb every
+// read_every_ms that goes on for another 500 ms. A read that overtakes the last staged level,
+// with no newer level coming to replace it, is where order used to break.
+FloodResult flood(int devices, uint32_t period_ms, uint32_t duration_ms, uint32_t read_every_ms,
+                  uint32_t fail_permille, uint32_t seed) {
+  CommandStager stager;
+  stager.configure(5, 3);
+  Wire wire(fail_permille, seed);
+  FloodResult result = {};
+  uint16_t seq = 1;
+  uint8_t last_value[4] = {};
+  CommandStager::Command due[CommandStager::kSlots];
+  for (uint32_t now = 0; now < duration_ms + 3000; ++now) {
+    for (int d = 0; now < duration_ms + 500 && d < devices; ++d) {
+      const uint16_t device = static_cast<uint16_t>(d + 1);
+      uint8_t command = 0;
+      uint8_t body[sizeof(zb_cmd_any_request_t)];
+      uint16_t len = 0;
+      if (now < duration_ms && now % period_ms == 0) {
+        const zb_cmd_level_t l = level(device, static_cast<uint8_t>(now * 254 / duration_ms), seq++);
+        last_value[d] = l.level;
+        command = ZB_CMD_LEVEL;
+        len = sizeof(l);
+        memcpy(body, &l, len);
+      } else if (read_every_ms && now % read_every_ms == 7) {
+        const zb_cmd_read_attr_t r = {{device, 1}, 0x0008, seq++};
+        command = ZB_CMD_READ_ATTR;
+        len = sizeof(r);
+        memcpy(body, &r, len);
+      } else {
+        continue;
+      }
+      result.commands++;
+      const Verdict verdict = stager.offer(kNet, command, body, len, now);
+      size_t flushed = 0;
+      if (verdict == Verdict::kFlushFirst) {
+        flushed = stager.take_device(kNet, device, now, due, CommandStager::kSlots);
+      }
+      if (verdict == Verdict::kSendNow || verdict == Verdict::kFlushFirst) {
+        // Until the flush has gone out, the caller's command would overtake what went back to the stage.
+        while (!send_released(stager, wire, due, flushed, now, &result)) {
+          flushed = stager.take_device(kNet, device, now, due, CommandStager::kSlots);
+        }
+        wire.send(command, body, now, now, false, &result);
+      }
+    }
+    if (now % kFlushMs != 0) {
+      continue;
+    }
+    size_t count;
+    while ((count = stager.take_due(now, due, kStageBatch)) > 0) {
+      if (!send_released(stager, wire, due, count, now, &result)) {
+        break;
+      }
+    }
+  }
+  result.in_order = true;
+  uint16_t last_seq[5] = {};
+  uint8_t sent_value[4] = {};
+  for (const Sent& sent : wire.log) {
+    result.in_order = result.in_order && sent.seq > last_seq[sent.device];
+    last_seq[sent.device] = sent.seq;
+    if (sent.command == ZB_CMD_LEVEL) {
+      sent_value[sent.device - 1] = sent.value;
+    }
+  }
+  result.final_state_sent = memcmp(last_value, sent_value, devices) == 0 && stager.staged() == 0;
+  return result;
+}
+
+void test_floods() {
+  struct Case {
+    const char* name;
+    int devices;
+    uint32_t period_ms;
+    uint32_t duration_ms;
+    uint32_t read_every_ms;
+    uint32_t fail_permille;
+  };
+  const Case cases[] = {
+      {"slider, 1 bulb", 1, 33, 3000, 0, 0},
+      {"slider + reads, 4 bulbs", 4, 33, 3000, 250, 0},
+      {"runaway + reads", 1, 10, 5000, 100, 0},
+      {"runaway, 5% sends fail", 1, 10, 5000, 100, 50},
+      {"4 bulbs, 20% sends fail", 4, 33, 3000, 250, 200},
+  };
+  uint32_t seed = 1;
+  for (const Case& c : cases) {
+    const FloodResult result = flood(c.devices, c.period_ms, c.duration_ms, c.read_every_ms, c.fail_permille, seed++);
+    printf("%-24s %4u cmds -> %4u frames, %3u failed sends, max delay %3u ms, %s, final %s\n", c.name,
+           result.commands, result.frames, result.failed_sends, result.max_delay_ms,
+           result.in_order ? "in order" : "REORDERED", result.final_state_sent ? "sent" : "LOST");
+    CHECK(result.in_order);
+    CHECK(result.final_state_sent);
+    CHECK(result.frames < result.commands);
+  }
+}
+
+}  // namespace
+
+int main() {
+  test_bucket_and_coalescing();
+  test_networks();
+  test_bypass_keeps_order();
+  test_restage();
+  test_floods();
+  return check_result("cmd_stager_test");
+}
@@ -0,0 +1,153 @@
+// CommandTracker: out-of-order responses, local failures, late and stale responses, detached
+// slots, request id wrap, and what a typed command costs on the wire next to its text form.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "check.h"
+#include "command_tracker.h"
+
+namespace {
+
+constexpr double kByteMs = 10 / 115.2;  // 115200 8N1
+constexpr size_t kFrameOverhead = 7;    // preamble, type, seq, length, CRC16
+
+int respond(CommandTracker& tracker, const zb_cmd_header_t& request, uint8_t status, const void* body,
+            uint16_t len, uint32_t now_us) {
+  uint8_t payload[sizeof(zb_rsp_header_t) + sizeof(zb_cmd_any_response_t)];
+  const zb_rsp_header_t header = {request.command, status, request.request_id, 0};
+  memcpy(payload, &header, sizeof(header));
+  if (len) {
+    memcpy(payload + sizeof(header), body, len);
+  }
+  return tracker.on_response(payload, static_cast<uint16_t>(sizeof(header) + len), now_us);
+}
+
+void test_matching() {
+  CommandTracker tracker;
+  zb_cmd_header_t headers[CommandTracker::kSlots + 1];
+  for (int i = 0; i < CommandTracker::kSlots; ++i) {
+    CHECK_EQ(tracker.open(ZB_CMD_ON_OFF, 100, &headers[i]), i);
+  }
+  CHECK_EQ(tracker.open(ZB_CMD_ON_OFF, 100, &headers[CommandTracker::kSlots]), -1);
+  CHECK_EQ(tracker.stats().no_slot, 1u);
+
+  // Out of order, and a response whose command does not match its request.
+  CHECK_EQ(respond(tracker, headers[5], ZB_CMD_STATUS_OK, nullptr, 0, 900), 5);
+  CHECK_EQ(tracker.result(5).round_trip_us, 800u);
+  const zb_rsp_mode_t mode = {1, 0};
+  zb_cmd_header_t wrong = headers[2];
+  wrong.command = ZB_CMD_SET_MODE;
+  CHECK_EQ(respond(tracker, wrong, ZB_CMD_STATUS_OK, &mode, sizeof(mode), 950), -1);
+  CHECK_EQ(tracker.stats().malformed, 1u);
+
+  // Timed out locally, then answered: late.
+  CHECK(tracker.fail(2, ZB_CMD_STATUS_TIMEOUT, 1000));
+  CHECK_EQ(respond(tracker, headers[2], ZB_CMD_STATUS_OK, nullptr, 0, 1100), -1);
+  CHECK_EQ(tracker.stats().late, 1u);
+  tracker.release(2);
+
+  // A reused slot gets a new request id; the old id never matches it.
+  CHECK_EQ(tracker.open(ZB_CMD_SET_MODE, 2000, &headers[2]), 2);
+  CHECK_EQ(headers[2].request_id, CommandTracker::kSlots + 1);
+  zb_cmd_header_t stale = headers[2];
+  stale.request_id = 3;
+  CHECK_EQ(respond(tracker, stale, ZB_CMD_STATUS_OK, &mode, sizeof(mode), 2100), -1);
+  CHECK_EQ(respond(tracker, headers[2], ZB_CMD_STATUS_OK, &mode, sizeof(mode), 2500), 2);
+  CHECK_EQ(tracker.result(2).length, sizeof(mode));
+  CHECK_EQ(tracker.body(2)[0], 1);
+
+  // Link down: everything still pending fails at once.
+  const uint32_t woken = tracker.fail_all(ZB_CMD_STATUS_LINK_DOWN, 3000);
+  CHECK_EQ(woken, 0xFFu & ~(1u << 5) & ~(1u << 2));
+
+  uint8_t junk[64] = {};
+  CHECK_EQ(tracker.on_response(junk, 3, 0), -1);
+  CHECK_EQ(tracker.on_response(junk, sizeof(junk), 0), -1);
+}
+
+void test_detached() {
+  CommandTracker tracker;
+  zb_cmd_header_t header;
+  const int answered = tracker.open(ZB_CMD_LEVEL, 0, &header, true);
+  CHECK_EQ(respond(tracker, header, ZB_CMD_STATUS_OK, nullptr, 0, 500), answered);
+  CHECK(tracker.state(answered) == CommandTracker::State::kFree);
+  // A failed detached send frees its slot too.
+  const int failed = tracker.open(ZB_CMD_LEVEL, 0, &header, true);
+  CHECK(tracker.fail(failed, ZB_CMD_STATUS_LINK_DOWN, 10));
+  CHECK(tracker.state(failed) == CommandTracker::State::kFree);
+  CHECK_EQ(tracker.stats().failed, 1u);
+  // Unanswered detached requests are reclaimed once every slot is taken.
+  for (int i = 0; i < CommandTracker::kSlots; ++i) {
+    tracker.open(ZB_CMD_LEVEL, 0, &header, true);
+  }
+  CHECK_EQ(tracker.open(ZB_CMD_LEVEL, CommandTracker::kDetachedTimeoutUs - 1, &header), -1);
+  CHECK(tracker.open(ZB_CMD_LEVEL, CommandTracker::kDetachedTimeoutUs, &header) >= 0);
+
+  // Request ids wrap past 0, which never goes on the wire.
+  CommandTracker wrapping;
+  bool zero = false;
+  for (int i = 0; i < 70000; ++i) {
+    const int slot = wrapping.open(ZB_CMD_ON_OFF, 0, &header);
+    zero = zero || header.request_id == 0;
+    wrapping.release(slot);
+  }
+  CHECK(!zero);
+}
+
+void test_wire_cost() {
+  struct Row {
+    const char* name;
+    const char* text;
+    size_t typed;
+  };
+  const Row rows[] = {
+      {"mode set", "mode:router", sizeof(zb_cmd_set_mode_t)},
+      {"on/off", "onoff:0x7c10:1:on", sizeof(zb_cmd_on_off_t)},
+      {"level", "level:0x7c10:1:254:10", sizeof(zb_cmd_level_t)},
+      {"color", "color:0x7c10:1:24939:24701:10", sizeof(zb_cmd_color_t)},
+      {"bind", "bind:00124b0022110f01:1:0x0006:00124b0001020304:1", sizeof(zb_cmd_bind_t)},
+      {"read attr", "read:0x7c10:1:0x0006:0x0000", sizeof(zb_cmd_read_attr_t)},
+  };
+  for (const Row& row : rows) {
+    const size_t text = strlen(row.text) + kFrameOverhead;
+    const size_t typed = sizeof(zb_cmd_header_t) + row.typed + kFrameOverhead;
+    printf("%-10s text %2zu B (%.2f ms)  typed %2zu B (%.2f ms)\n", row.name, text, text * kByteMs, typed,
+           typed * kByteMs);
+    CHECK(typed < text);
+  }
+
+  // Encoding and parsing one level command: text through snprintf/sscanf, typed through memcpy.
+  constexpr int kRounds = 1000000;
+  volatile unsigned sink = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    char text[32];
+    unsigned addr, endpoint, value, transition;
+    snprintf(text, sizeof(text), "level:0x%x:1:254:10", 0x7c10 + (i & 7));
+    sscanf(text, "level:%x:%u:%u:%u", &addr, &endpoint, &value, &transition);
+    sink = sink + addr + value;
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    uint8_t wire[sizeof(zb_cmd_level_t)];
+    const zb_cmd_level_t command = {{static_cast<uint16_t>(0x7c10 + (i & 7)), 1}, 254, 10};
+    memcpy(wire, &command, sizeof(command));
+    zb_cmd_level_t parsed;
+    memcpy(&parsed, wire, sizeof(parsed));
+    sink = sink + parsed.target.short_addr + parsed.level;
+  }
+  const auto t2 = std::chrono::steady_clock::now();
+  printf("encode + parse a level command on the host: text %.1f ns, typed %.1f ns\n",
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / kRounds,
+         std::chrono::duration<double, std::nano>(t2 - t1).count() / kRounds);
+}
+
+}  // namespace
+
+int main() {
+  test_matching();
+  test_detached();
+  test_wire_cost();
+  return check_result("command_tracker_test");
+}
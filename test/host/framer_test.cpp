@@ -0,0 +1,118 @@
+// LinkFramer: a stream of frames of every payload length with leading garbage, a bad CRC and
+// an oversized length field mixed in, fed in chunk sizes from 1 to 200 bytes, then how long
+// framing a line-rate stream takes per byte on the host.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+#include "link_framer.h"
+#include "uart_link_protocol.h"
+
+namespace {
+
+std::vector<uint8_t> encode(uint8_t type, uint16_t len, uint8_t fill) {
+  uart_link_frame_t frame = {};
+  frame.type = type;
+  frame.payload_len = len;
+  memset(frame.payload, fill, len);
+  uint8_t buffer[UART_LINK_MAX_PAYLOAD + 8];
+  const size_t written = uart_link_encode_frame(buffer, sizeof(buffer), &frame);
+  return std::vector<uint8_t>(buffer, buffer + written);
+}
+
+void append(std::vector<uint8_t>* stream, const std::vector<uint8_t>& bytes) {
+  stream->insert(stream->end(), bytes.begin(), bytes.end());
+}
+
+void test_chunks() {
+  std::vector<uint8_t> stream = {1, 2, 3};
+  constexpr int kGood = UART_LINK_MAX_PAYLOAD + 1;
+  for (int i = 0; i < kGood; ++i) {
+    append(&stream, encode(0x10, static_cast<uint16_t>(i), static_cast<uint8_t>(i)));
+  }
+  std::vector<uint8_t> corrupt = encode(0x11, 10, 1);
+  corrupt[7] ^= 1;
+  append(&stream, corrupt);
+  // Preamble, type, seq and a length of 0x7FFF: dropped as soon as the length is read.
+  append(&stream, {UART_LINK_PREAMBLE, 1, 0, 0x7F, 0xFF});
+  append(&stream, encode(0x12, 5, 9));
+
+  int failures = 0;
+  for (size_t chunk = 1; chunk <= 200; ++chunk) {
+    LinkFramer framer;
+    uart_link_frame_t frame;
+    int frames = 0;
+    int crc_errors = 0;
+    int bad_lengths = 0;
+    bool ok = true;
+    for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+      const uint8_t* data = stream.data() + offset;
+      size_t len = std::min(chunk, stream.size() - offset);
+      while (len) {
+        size_t consumed = 0;
+        switch (framer.push(data, len, &consumed, &frame)) {
+          case LinkFramer::Result::kFrame:
+            ok = ok && frame.payload_len == (frames < kGood ? frames : 5);
+            ok = ok && (frame.payload_len == 0 || frame.payload[frame.payload_len - 1] ==
+                                                      (frames < kGood ? static_cast<uint8_t>(frames) : 9));
+            frames++;
+            break;
+          case LinkFramer::Result::kCrcError:
+            crc_errors++;
+            break;
+          case LinkFramer::Result::kBadLength:
+            bad_lengths++;
+            ok = ok && framer.bad_length() == 0x7FFF;
+            break;
+          default:
+            break;
+        }
+        ok = ok && consumed > 0 && consumed <= len;
+        data += consumed;
+        len -= consumed;
+      }
+    }
+    failures += !(ok && frames == kGood + 1 && crc_errors == 1 && bad_lengths == 1);
+  }
+  CHECK_EQ(failures, 0);
+}
+
+void test_throughput() {
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 4096; ++i) {
+    append(&stream, encode(0x12, 96, static_cast<uint8_t>(i)));
+  }
+  constexpr size_t kChunk = 256;  // the RX task's read size
+  constexpr int kRounds = 20;
+  LinkFramer framer;
+  uart_link_frame_t frame;
+  size_t frames = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (size_t offset = 0; offset < stream.size(); offset += kChunk) {
+      const uint8_t* data = stream.data() + offset;
+      size_t len = std::min(kChunk, stream.size() - offset);
+      while (len) {
+        size_t consumed = 0;
+        frames += framer.push(data, len, &consumed, &frame) == LinkFramer::Result::kFrame;
+        data += consumed;
+        len -= consumed;
+      }
+    }
+  }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  printf("framing 96-byte frames in %zu-byte reads on the host: %.2f ns per byte, %.0f ns per frame\n", kChunk,
+         ns / (static_cast<double>(stream.size()) * kRounds), ns / frames);
+  CHECK_EQ(frames, 4096u * kRounds);
+}
+
+}  // namespace
+
+int main() {
+  test_chunks();
+  test_throughput();
+  return check_result("framer_test");
+}
@@ -0,0 +1,407 @@
+// HistoryStore on a simulated 896 KB NOR flash region: a codec round trip over awkward gaps and
+// values, then 30 days of 100 sensors reporting every ~60 s with hourly aggregates checked
+// against brute force, query cost, a remount, series eviction, mounting into poisoned static
+// Storage, and one address on two networks. Prints the numbers quoted for the history store:
+// bytes per point, retention, ingest rate and flash reads per query.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "history_codec.h"
+#include "history_store.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kRegion = 0xE0000;  // storage partition past the 1 MB H2 staging area
+constexpr int kSeries = 100;
+constexpr uint32_t kDays = 30;
+constexpr uint32_t kStart = 1767225600;  // 2026-01-01
+constexpr double kFlashBytesPerUs = 20;  // 80 MHz QIO reads, roughly
+
+// NOR rules: a write can only clear bits, an erase sets a sector back to 0xFF.
+struct NorFlash {
+  std::vector<uint8_t> bytes;
+  uint64_t writes = 0;
+  uint64_t erases = 0;
+  uint64_t read_bytes = 0;
+  bool violation = false;
+};
+
+bool flash_read(void* ctx, uint32_t offset, void* out, size_t len) {
+  NorFlash& flash = *static_cast<NorFlash*>(ctx);
+  if (offset + len > flash.bytes.size()) {
+    return false;
+  }
+  memcpy(out, &flash.bytes[offset], len);
+  flash.read_bytes += len;
+  return true;
+}
+
+bool flash_write(void* ctx, uint32_t offset, const void* data, size_t len) {
+  NorFlash& flash = *static_cast<NorFlash*>(ctx);
+  if (offset + len > flash.bytes.size()) {
+    return false;
+  }
+  const uint8_t* in = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < len; ++i) {
+    flash.violation = flash.violation || (flash.bytes[offset + i] & in[i]) != in[i];
+    flash.bytes[offset + i] &= in[i];
+  }
+  flash.writes++;
+  return true;
+}
+
+bool flash_erase(void* ctx, uint32_t offset, size_t len) {
+  NorFlash& flash = *static_cast<NorFlash*>(ctx);
+  if (offset + len > flash.bytes.size()) {
+    return false;
+  }
+  memset(&flash.bytes[offset], 0xFF, len);
+  flash.erases++;
+  return true;
+}
+
+double us_since(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Random gaps from 0 s to years, and values that repeat, step, jump, flip sign or are NaN.
+// Round by round, 1 to 4 fields.
+void test_codec() {
+  std::mt19937 rng(1);
+  int mismatches = 0;
+  for (int round = 0; round < 2000; ++round) {
+    const int fields = 1 + round % 4;
+    HistoryEncoder encoder(fields);
+    std::vector<uint32_t> times;
+    std::vector<double> values;
+    uint32_t t = rng() % (1u << 30);
+    double v[4] = {};
+    for (;;) {
+      const uint32_t gaps[6] = {60, static_cast<uint32_t>(rng() % 200), static_cast<uint32_t>(rng() % 5000),
+                                static_cast<uint32_t>(rng() % 100000), 0, static_cast<uint32_t>(rng() % 0x7FFFFFF)};
+      if (!times.empty()) {
+        t += gaps[rng() % 6];
+      }
+      for (int i = 0; i < fields; ++i) {
+        switch (rng() % 5) {
+          case 0:
+            break;
+          case 1:
+            v[i] += static_cast<int>(rng() % 21) - 10;
+            break;
+          case 2:
+            v[i] = rng() / 7.0;
+            break;
+          case 3:
+            v[i] = -v[i];
+            break;
+          default:
+            v[i] = NAN;
+        }
+      }
+      // An aggregate (sum, min, max, count) of one sample has min and max equal to its sum.
+      if (fields == 4 && rng() % 3 == 0) {
+        v[3] = 1;
+      }
+      if (fields == 4 && v[3] == 1) {
+        v[1] = v[2] = v[0];
+      }
+      if (!encoder.append(t, v)) {
+        break;
+      }
+      times.push_back(t);
+      values.insert(values.end(), v, v + fields);
+    }
+    CHECK_EQ(encoder.count(), times.size());
+    CHECK(encoder.bytes() <= HistoryEncoder::kCapacity);
+    HistoryDecoder decoder(encoder.data(), encoder.bytes(), fields, encoder.first_t(), encoder.count());
+    uint32_t decoded_t;
+    double decoded[4];
+    for (size_t k = 0; k < times.size(); ++k) {
+      // Bit-exact, NaN included.
+      if (!decoder.next(&decoded_t, decoded) || decoded_t != times[k] ||
+          memcmp(decoded, &values[k * fields], fields * sizeof(double)) != 0) {
+        ++mismatches;
+        break;
+      }
+    }
+    CHECK(!decoder.next(&decoded_t, decoded));
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+struct Aggregate {
+  double sum = 0;
+  double min = INFINITY;
+  double max = -INFINITY;
+  uint32_t count = 0;
+};
+
+history_key_t key_of(int series) {
+  const bool power = series % 2;
+  return {0, static_cast<uint16_t>(0x1000 + series / 2), 1, static_cast<uint16_t>(power ? 0x0B04 : 0x0402),
+          static_cast<uint16_t>(power ? 0x050B : 0x0000)};
+}
+
+void test_thirty_days() {
+  NorFlash nor;
+  nor.bytes.resize(kRegion);
+  std::mt19937 junk(9);
+  for (uint8_t& byte : nor.bytes) {
+    byte = static_cast<uint8_t>(junk());  // an unformatted region
+  }
+  const HistoryStore::Flash flash = {flash_read, flash_write, flash_erase, &nor};
+  HistoryStore* store = new HistoryStore;
+  CHECK(store->mount(flash, kRegion, kSeries));
+
+  // Temperatures (0.01 degC) and power readings (W) as random walks, each reported every
+  // 57-63 s, as attr_ingest forwards them.
+  std::mt19937 rng(42);
+  std::vector<double> value(kSeries);
+  std::vector<uint32_t> next(kSeries);
+  for (int s = 0; s < kSeries; ++s) {
+    value[s] = s % 2 ? 100 + rng() % 2000 : 1800 + rng() % 800;
+    next[s] = kStart + rng() % 60;
+  }
+  constexpr int kWatched = 7;
+  std::vector<Aggregate> hours(kDays * 24);
+  std::vector<history_point_t> raw;
+  uint64_t samples = 0;
+  const uint32_t end = kStart + kDays * 86400;
+  const Clock::time_point ingest_start = Clock::now();
+  for (uint32_t now = kStart; now < end; ++now) {
+    for (int s = 0; s < kSeries; ++s) {
+      if (next[s] != now) {
+        continue;
+      }
+      next[s] = now + 57 + rng() % 7;
+      value[s] = s % 2 ? std::max(0.0, value[s] + static_cast<int>(rng() % 41) - 20)
+                       : value[s] + static_cast<int>(rng() % 31) - 15;
+      store->record(key_of(s), now, value[s]);
+      ++samples;
+      if (s == kWatched) {
+        Aggregate& hour = hours[(now - kStart) / 3600];
+        hour.sum += value[s];
+        hour.min = std::min(hour.min, value[s]);
+        hour.max = std::max(hour.max, value[s]);
+        hour.count++;
+        raw.push_back({now, value[s], value[s], value[s], 1});
+      }
+    }
+  }
+  const double ingest_us = us_since(ingest_start);
+  CHECK(!nor.violation);
+
+  history_stats_t stats;
+  store->fill_stats(&stats);
+  printf("30 days, %d series: %llu samples, %.2f us each on the host, %llu block writes, %llu erases\n", kSeries,
+         static_cast<unsigned long long>(samples), ingest_us / samples, static_cast<unsigned long long>(nor.writes),
+         static_cast<unsigned long long>(nor.erases));
+  static const char* const kTierNames[HISTORY_TIERS] = {"raw", "1m", "1h"};
+  double retained_days[HISTORY_TIERS];
+  for (int t = 0; t < HISTORY_TIERS; ++t) {
+    const auto& tier = stats.tier[t];
+    retained_days[t] = (end - tier.oldest_t) / 86400.0;
+    printf("  %-3s %3u sectors, %7u points, %.2f B/point compressed, %.2f B/point on flash, oldest %.1f days ago\n",
+           kTierNames[t], tier.sectors, tier.points,
+           static_cast<double>(tier.payload_bytes) / tier.points,
+           static_cast<double>(tier.blocks) * HistoryStore::kBlockBytes / tier.points, retained_days[t]);
+  }
+  CHECK(retained_days[HISTORY_RAW] > 0.5);
+  CHECK(static_cast<double>(stats.tier[HISTORY_RAW].payload_bytes) / stats.tier[HISTORY_RAW].points < 3);
+
+  const history_key_t watched = key_of(kWatched);
+  std::vector<history_point_t> points(50000);
+  history_query_stats_t query_stats;
+  auto query = [&](history_tier_t tier, uint32_t from, uint32_t to, const char* label) {
+    nor.read_bytes = 0;
+    const size_t n = store->query(watched, tier, from, to, points.data(), points.size(), &query_stats);
+    printf("  query %-18s %5zu points, %2u sectors skipped, %4u blocks decoded, %6llu B read (%.2f ms)\n", label, n,
+           query_stats.sectors_skipped, query_stats.blocks_decoded, static_cast<unsigned long long>(nor.read_bytes),
+           nor.read_bytes / kFlashBytesPerUs / 1000);
+    return n;
+  };
+
+  // Every retained hour matches the brute force. At this load the hour ring wraps after about
+  // four weeks, so the oldest day or two of the month are gone.
+  size_t n = query(HISTORY_HOUR, 0, UINT32_MAX, "1h, 30 days");
+  printf("  hours kept for one series: %zu of %u (%.1f days)\n", n, kDays * 24, n / 24.0);
+  CHECK(n >= 28 * 24);
+  int wrong = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const Aggregate& hour = hours[(points[i].t - kStart) / 3600];
+    wrong += points[i].count == hour.count && points[i].min == hour.min && points[i].max == hour.max &&
+                     std::fabs(points[i].mean - hour.sum / hour.count) < 1e-9
+                 ? 0
+                 : 1;
+  }
+  CHECK_EQ(wrong, 0);
+  CHECK(nor.read_bytes < 64 * 1024);
+
+  // The last raw hour is bit-exact.
+  n = query(HISTORY_RAW, end - 3600, end, "raw, last hour");
+  std::vector<history_point_t> want;
+  for (const history_point_t& point : raw) {
+    if (point.t >= end - 3600) {
+      want.push_back(point);
+    }
+  }
+  CHECK_EQ(n, want.size());
+  for (size_t i = 0; i < n && i < want.size(); ++i) {
+    CHECK(points[i].t == want[i].t && points[i].mean == want[i].mean);
+  }
+  CHECK(query(HISTORY_MINUTE, end - 86400, end, "1m, last day") > 0);
+  query(HISTORY_RAW, end - 6 * 3600, end - 5 * 3600, "raw, 5 h ago");
+
+  // Remount into RAM that is not zeroed: everything flushed is still there.
+  store->flush();
+  const size_t before = store->query(watched, HISTORY_HOUR, 0, UINT32_MAX, points.data(), points.size());
+  delete store;
+  store = new HistoryStore;
+  static HistoryStore::Storage<kSeries, kRegion / HistoryStore::kSectorBytes> storage;
+  memset(static_cast<void*>(&storage), 0xA5, sizeof(storage));
+  nor.read_bytes = 0;
+  const Clock::time_point mount_start = Clock::now();
+  CHECK(store->mount(flash, kRegion, storage));
+  printf("  mount scan: %.0f KB read, %.0f us on the host\n", nor.read_bytes / 1024.0, us_since(mount_start));
+  CHECK(store->newest_t() >= end - 70);
+  CHECK_EQ(store->query(watched, HISTORY_HOUR, 0, UINT32_MAX, points.data(), points.size()), before);
+
+  // After the reboot, the hour split by the flush merges back into one point.
+  for (uint32_t t = end; t < end + 7200; t += 60) {
+    store->record(watched, t, 500);
+  }
+  CHECK_EQ(store->query(watched, HISTORY_HOUR, end - 3600, UINT32_MAX, points.data(), points.size()), 3u);
+  CHECK_EQ(points[1].t, end - end % 3600);
+
+  // Many more series than RAM slots: idle ones are written out and evicted, and still queried.
+  for (int s = 0; s < 300; ++s) {
+    store->record({0, static_cast<uint16_t>(0x8000 + s), 1, 6, 0}, end + 7200 + s, s);
+  }
+  store->fill_stats(&stats);
+  CHECK(stats.evictions > 0);
+  CHECK_EQ(stats.corrupt_blocks, 0u);
+  CHECK_EQ(stats.flash_errors, 0u);
+  CHECK_EQ(store->query({0, 0x8000, 1, 6, 0}, HISTORY_RAW, 0, UINT32_MAX, points.data(), points.size()), 1u);
+  CHECK_EQ(points[0].mean, 0.0);
+  CHECK(!nor.violation);
+  delete store;
+}
+
+// APP_STATIC_ALLOCATION mounts into a Storage in .bss, which a reboot leaves holding whatever
+// was there. A store in Storage poisoned two ways, and capped below the region, must answer
+// exactly as a heap-mounted one and never touch flash past its last sector.
+void test_static_storage() {
+  constexpr int kStaticSeries = 8;
+  constexpr uint32_t kStaticSectors = 64;
+  using Storage = HistoryStore::Storage<kStaticSeries, kStaticSectors>;
+  static Storage poisoned[2];
+  memset(static_cast<void*>(&poisoned[0]), 0xA5, sizeof(Storage));
+  memset(static_cast<void*>(&poisoned[1]), 0x00, sizeof(Storage));
+
+  NorFlash heap_nor;
+  heap_nor.bytes.assign(kRegion, 0xFF);
+  HistoryStore* heap = new HistoryStore;
+  CHECK(heap->mount({flash_read, flash_write, flash_erase, &heap_nor}, kStaticSectors * HistoryStore::kSectorBytes,
+                    kStaticSeries));
+  NorFlash static_nor;
+  static_nor.bytes.assign(kRegion, 0xFF);
+  const HistoryStore::Flash flash = {flash_read, flash_write, flash_erase, &static_nor};
+  HistoryStore* in_storage = new HistoryStore;
+  CHECK(in_storage->mount(flash, kRegion, poisoned[0]));
+
+  // Two days of 12 series every 30 s: more series than slots, and the raw ring wraps.
+  std::mt19937 rng(5);
+  for (uint32_t t = kStart; t < kStart + 2 * 86400; t += 30) {
+    for (int s = 0; s < 12; ++s) {
+      const double value = static_cast<double>(rng() % 5000) / 10;
+      heap->record(key_of(s), t, value);
+      in_storage->record(key_of(s), t, value);
+    }
+  }
+  CHECK(static_nor.erases > 0);
+  CHECK(std::all_of(static_nor.bytes.begin() + kStaticSectors * HistoryStore::kSectorBytes, static_nor.bytes.end(),
+                    [](uint8_t byte) { return byte == 0xFF; }));
+
+  std::vector<history_point_t> want(4096);
+  std::vector<history_point_t> got(4096);
+  auto same = [&](HistoryStore* store) {
+    int mismatched = 0;
+    for (int s = 0; s < 12; ++s) {
+      for (int tier = 0; tier < HISTORY_TIERS; ++tier) {
+        const history_tier_t t = static_cast<history_tier_t>(tier);
+        const size_t n = heap->query(key_of(s), t, 0, UINT32_MAX, want.data(), want.size());
+        const size_t m = store->query(key_of(s), t, 0, UINT32_MAX, got.data(), got.size());
+        mismatched += n != m || memcmp(want.data(), got.data(), n * sizeof(history_point_t)) != 0;
+      }
+    }
+    return mismatched;
+  };
+  CHECK_EQ(same(in_storage), 0);
+
+  // A reboot: the other poisoned Storage, the same flash.
+  heap->flush();
+  in_storage->flush();
+  delete in_storage;
+  in_storage = new HistoryStore;
+  CHECK(in_storage->mount(flash, kRegion, poisoned[1]));
+  CHECK_EQ(same(in_storage), 0);
+  history_stats_t stats;
+  in_storage->fill_stats(&stats);
+  CHECK_EQ(stats.corrupt_blocks, 0u);
+  CHECK(!static_nor.violation);
+  printf("static storage: %zu B for %d series and %u sectors, answers match the heap mount\n", sizeof(Storage),
+         kStaticSeries, kStaticSectors);
+  delete in_storage;
+  delete heap;
+}
+
+// The same short address, endpoint and attribute on two networks: two series, before and after a
+// remount. Blocks written before the network was recorded carry 0 in its place: network 0.
+void test_networks() {
+  NorFlash nor;
+  nor.bytes.assign(kRegion, 0xFF);
+  const HistoryStore::Flash flash = {flash_read, flash_write, flash_erase, &nor};
+  HistoryStore* store = new HistoryStore;
+  CHECK(store->mount(flash, kRegion, 8));
+  const history_key_t on_link0 = {0, 0x1234, 1, 0x0402, 0x0000};
+  const history_key_t on_link1 = {1, 0x1234, 1, 0x0402, 0x0000};
+  const history_key_t native = {0x0F, 0x1234, 1, 0x0402, 0x0000};
+  for (uint32_t t = kStart; t < kStart + 600; t += 60) {
+    store->record(on_link0, t, 2000);
+    store->record(on_link1, t, 1500);
+  }
+  store->record(native, kStart, 100);
+  history_point_t points[32];
+  for (int pass = 0; pass < 2; ++pass) {
+    CHECK_EQ(store->query(on_link0, HISTORY_RAW, 0, UINT32_MAX, points, 32), 10u);
+    CHECK_EQ(points[9].mean, 2000.0);
+    CHECK_EQ(store->query(on_link1, HISTORY_RAW, 0, UINT32_MAX, points, 32), 10u);
+    CHECK_EQ(points[9].mean, 1500.0);
+    CHECK_EQ(store->query(native, HISTORY_RAW, 0, UINT32_MAX, points, 32), 1u);
+    CHECK_EQ(points[0].mean, 100.0);
+    store->flush();
+    delete store;
+    store = new HistoryStore;
+    CHECK(store->mount(flash, kRegion, 8));
+  }
+  delete store;
+}
+
+}  // namespace
+
+int main() {
+  test_codec();
+  test_thirty_days();
+  test_static_storage();
+  test_networks();
+  return check_result("history_test");
+}
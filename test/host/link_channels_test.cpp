@@ -0,0 +1,192 @@
+// ChannelScheduler and ChannelReassembler on a simulated 115200 baud wire: a command is never
+// stuck behind more than one bulk fragment, bulk transfers survive frame loss through credit
+// probes, and an H2 OTA chunk travels as exactly one fragment.
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "check.h"
+#include "link_channels.h"
+#include "ota_relay.h"
+
+namespace {
+
+constexpr uint16_t kFramePayload = 128;  // UART_LINK_MAX_PAYLOAD
+constexpr uint32_t kFrameOverhead = 7;   // preamble, type, seq, length, CRC16
+constexpr double kByteUs = 1e6 / 11520;  // 115200 8N1
+constexpr uint8_t kCommand = 0;
+constexpr uint8_t kBulk = 2;
+constexpr uint8_t kCommandType = 0x20;
+constexpr uint8_t kBulkType = 0x31;
+
+uint8_t s_storage[3][2048];
+uint8_t s_reassembly[3][1024];
+
+void configure(ChannelScheduler* tx) {
+  const uint16_t sizes[3] = {512, 512, 2048};
+  for (uint8_t channel = 0; channel < 3; ++channel) {
+    ChannelScheduler::ChannelConfig config;
+    config.priority = channel;
+    config.storage = s_storage[channel];
+    config.storage_size = sizes[channel];
+    tx->configure(channel, config);
+  }
+  tx->set_framing(true);
+}
+
+// The OTA relay's window of 8 chunks must fit the 8 initial bulk credits: one fragment per chunk.
+void test_ota_chunk_is_one_fragment() {
+  ChannelScheduler tx(kFramePayload);
+  configure(&tx);
+  uint8_t chunk[sizeof(ota_wire::ChunkHeader) + OtaRelay::Config().chunk_size] = {};
+  uint8_t frame[kFramePayload];
+  const uint8_t window = OtaRelay::Config().window;
+  for (uint8_t i = 0; i < window; ++i) {
+    CHECK(tx.enqueue(kBulk, UART_LINK_MSG_OTA_CHUNK, chunk, sizeof(chunk), 0));
+    ChannelScheduler::Fragment fragment;
+    CHECK(tx.next(0, &fragment, frame));
+    CHECK(fragment.last);
+    CHECK_EQ(fragment.length, kFramePayload);
+  }
+  CHECK_EQ(tx.stats(kBulk).fragments, window);
+  CHECK_EQ(tx.credits(kBulk), channel_wire::kInitialCredits - window);
+}
+
+struct Result {
+  uint32_t bulk_delivered;
+  uint32_t commands_sent;
+  uint32_t commands_delivered;
+  double max_command_ms;
+  double seconds;
+  uint32_t credit_stalls;
+};
+
+// 300 KB as 1 KB bulk messages with a command every 20-100 ms. Frames in both directions are
+// lost with probability loss_permille / 1000; the channel layer itself never retransmits.
+Result run(uint32_t loss_permille, uint32_t seed) {
+  constexpr uint32_t kBulkBytes = 300 * 1024;
+  constexpr uint16_t kBulkMessage = 1024;
+  std::mt19937 rng(seed);
+  auto lost = [&] { return rng() % 1000 < loss_permille; };
+
+  ChannelScheduler tx(kFramePayload);
+  configure(&tx);
+  ChannelReassembler rx[3];
+  for (uint8_t channel = 0; channel < 3; ++channel) {
+    rx[channel].begin(s_reassembly[channel], sizeof(s_reassembly[channel]));
+  }
+
+  static double command_sent_us[8192];
+  Result result = {};
+  uint32_t bulk_queued = 0;
+  double now_us = 0;
+  double wire_free_us = 0;
+  double next_command_us = 1000;
+  double credit_at_us[3] = {-1, -1, -1};
+  uint16_t credit_seq[3] = {};
+  uint8_t frame[kFramePayload];
+  while (now_us < 120e6) {
+    while (bulk_queued < kBulkBytes) {
+      static uint8_t message[kBulkMessage];
+      const uint16_t len = kBulkBytes - bulk_queued < kBulkMessage ? kBulkBytes - bulk_queued : kBulkMessage;
+      if (!tx.enqueue(kBulk, kBulkType, message, len, static_cast<uint32_t>(now_us))) {
+        break;
+      }
+      bulk_queued += len;
+    }
+    if (now_us >= next_command_us) {
+      char text[16];
+      const int len = snprintf(text, sizeof(text), "on %u", result.commands_sent);
+      if (tx.enqueue(kCommand, kCommandType, reinterpret_cast<uint8_t*>(text), static_cast<uint16_t>(len),
+                     static_cast<uint32_t>(now_us))) {
+        command_sent_us[result.commands_sent++] = now_us;
+      }
+      next_command_us += 20000 + rng() % 80000;
+    }
+    for (uint8_t channel = 0; channel < 3; ++channel) {
+      if (credit_at_us[channel] >= 0 && now_us >= credit_at_us[channel]) {
+        if (!lost()) {
+          tx.on_credit(channel, credit_seq[channel]);
+        }
+        credit_at_us[channel] = -1;
+      }
+    }
+    if (bulk_queued >= kBulkBytes && !tx.pending() && tx.queued_bytes(kBulk) == 0 &&
+        tx.queued_bytes(kCommand) == 0) {
+      break;
+    }
+    if (now_us < wire_free_us) {
+      now_us = wire_free_us < next_command_us ? wire_free_us : next_command_us;
+      continue;
+    }
+    uint8_t probe_channel;
+    channel_wire::Credit request;
+    if (tx.credit_probe(static_cast<uint32_t>(now_us), &probe_channel, &request) && !lost()) {
+      rx[probe_channel].on_credit_request(request.seq);
+      credit_seq[probe_channel] = rx[probe_channel].expected_seq();
+      rx[probe_channel].credit_reported();
+      credit_at_us[probe_channel] = now_us + 2000;
+    }
+    ChannelScheduler::Fragment fragment;
+    if (!tx.next(static_cast<uint32_t>(now_us), &fragment, frame)) {
+      now_us += 100;
+      continue;
+    }
+    wire_free_us = now_us + (fragment.length + kFrameOverhead) * kByteUs;
+    if (lost()) {
+      continue;
+    }
+    const uint8_t channel = frame[0] & channel_wire::kChannelMask;
+    ChannelReassembler::Message message;
+    if (rx[channel].feed(frame, fragment.length, &message)) {
+      if (message.type == kCommandType) {
+        char text[16] = {};
+        memcpy(text, rx[channel].buffer(), message.length < sizeof(text) - 1 ? message.length : sizeof(text) - 1);
+        unsigned id = 0;
+        sscanf(text, "on %u", &id);
+        const double latency_ms = (wire_free_us - command_sent_us[id]) / 1000;
+        result.max_command_ms = latency_ms > result.max_command_ms ? latency_ms : result.max_command_ms;
+        ++result.commands_delivered;
+      } else {
+        result.bulk_delivered += message.length;
+      }
+    }
+    if (rx[channel].credit_due()) {
+      credit_seq[channel] = rx[channel].expected_seq();
+      rx[channel].credit_reported();
+      credit_at_us[channel] = wire_free_us + 1000;
+    }
+  }
+  result.seconds = now_us / 1e6;
+  result.credit_stalls = tx.stats(kBulk).credit_stalls;
+  return result;
+}
+
+void test_priority_under_bulk() {
+  const double fragment_ms = (kFramePayload + kFrameOverhead) * kByteUs / 1000;
+  const double command_frame_ms = (sizeof(channel_wire::FragmentHeader) + 8 + kFrameOverhead) * kByteUs / 1000;
+  for (uint32_t loss : {0u, 10u, 50u}) {
+    const Result result = run(loss, loss + 1);
+    printf("loss %2u/1000: bulk %6u B in %5.1f s (%5.0f B/s), commands %u/%u, worst %.1f ms, stalls %u\n", loss,
+           result.bulk_delivered, result.seconds, result.bulk_delivered / result.seconds, result.commands_delivered,
+           result.commands_sent, result.max_command_ms, result.credit_stalls);
+    // Finished well inside the limit: no channel stayed stalled on lost credits.
+    CHECK(result.seconds < 60);
+    CHECK(result.commands_delivered > 0);
+    CHECK(result.max_command_ms <= fragment_ms + command_frame_ms);
+    if (loss == 0) {
+      CHECK_EQ(result.bulk_delivered, 300u * 1024);
+      CHECK_EQ(result.commands_delivered, result.commands_sent);
+      CHECK(result.bulk_delivered / result.seconds > 9500);
+    }
+  }
+  printf("one fragment %.1f ms on the wire\n", fragment_ms);
+}
+
+}  // namespace
+
+int main() {
+  test_ota_chunk_is_one_fragment();
+  test_priority_under_bulk();
+  return check_result("link_channels_test");
+}
@@ -0,0 +1,135 @@
+// link_codec: round trips of sample link traffic fed in every split, a random round-trip
+// fuzz, garbage input, and the compression ratio and speed on the samples.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "check.h"
+#include "link_codec.h"
+
+namespace {
+
+using link_codec::Decoder;
+
+link_codec::Workspace s_workspace;
+
+// The kinds of payload the H2 sends: signals, attribute reports and JSON batches.
+const char* const kSamples[] = {
+    "zdo_signal=DEVICE_ANNCE short=0x1a2b ieee=00:12:4b:00:1c:aa:bb:cc",
+    "attr_report ep=1 cluster=0x0006 attr=0x0000 type=bool value=1 short=0x1a2b lqi=200 rssi=-61",
+    "{\"ieee\":\"00:12:4b:00:1c:aa:bb:cc\",\"short\":\"0x1a2b\",\"ep\":1,\"cluster\":\"0x0402\",\"attr\":\"0x0000\","
+    "\"value\":2150}",
+    "{\"ieee\":\"00:12:4b:00:1c:aa:bb:cc\",\"short\":\"0x1a2b\",\"ep\":1,\"cluster\":\"0x0402\",\"attr\":\"0x0000\","
+    "\"value\":2150},{\"ieee\":\"00:12:4b:00:22:11:0f:01\",\"short\":\"0x7c10\",\"ep\":1,\"cluster\":\"0x0006\","
+    "\"attr\":\"0x0000\",\"value\":1},{\"ieee\":\"00:12:4b:00:22:11:0f:02\",\"short\":\"0x7c11\",\"ep\":1,"
+    "\"cluster\":\"0x0008\",\"attr\":\"0x0000\",\"value\":254}",
+};
+
+bool round_trip(const uint8_t* packed, size_t packed_len, size_t split, const uint8_t* raw, size_t raw_len) {
+  uint8_t decoded[link_codec::kMaxDecoded];
+  Decoder decoder;
+  decoder.begin(decoded, sizeof(decoded));
+  return decoder.feed(packed, split) && decoder.feed(packed + split, packed_len - split) && decoder.finish() &&
+         decoder.size() == raw_len && memcmp(decoded, raw, raw_len) == 0;
+}
+
+void test_samples() {
+  size_t raw_total = 0;
+  size_t packed_total = 0;
+  for (const char* sample : kSamples) {
+    const auto* raw = reinterpret_cast<const uint8_t*>(sample);
+    const size_t raw_len = strlen(sample);
+    uint8_t packed[link_codec::kMaxDecoded];
+    const size_t packed_len = link_codec::compress(raw, raw_len, packed, sizeof(packed), &s_workspace);
+    printf("sample %3zu -> %3zu bytes\n", raw_len, packed_len);
+    CHECK(packed_len > 0 && packed_len < raw_len);
+    for (size_t split = 0; split <= packed_len; ++split) {
+      CHECK(round_trip(packed, packed_len, split, raw, raw_len));
+    }
+    raw_total += raw_len;
+    packed_total += packed_len;
+  }
+  printf("samples compress %.2fx (dictionary %zu bytes)\n", static_cast<double>(raw_total) / packed_total,
+         link_codec::dictionary_size());
+  CHECK(raw_total >= packed_total * 2);
+}
+
+// Random payloads from narrow and wide alphabets mixed with dictionary text.
+void test_fuzz(std::mt19937& rng) {
+  static const char kText[] = "cluster=0x";
+  int failures = 0;
+  int compressed = 0;
+  for (int i = 0; i < 20000; ++i) {
+    uint8_t raw[link_codec::kMaxDecoded];
+    const size_t raw_len = rng() % (sizeof(raw) + 1);
+    const uint32_t alphabet = 1 + rng() % 255;
+    for (size_t j = 0; j < raw_len; ++j) {
+      raw[j] = rng() % 4 == 0 ? kText[rng() % (sizeof(kText) - 1)] : static_cast<uint8_t>(rng() % alphabet);
+    }
+    uint8_t packed[link_codec::kMaxDecoded + 64];
+    const size_t packed_len = link_codec::compress(raw, raw_len, packed, sizeof(packed), &s_workspace);
+    if (!packed_len) {
+      continue;  // not smaller: sent uncompressed
+    }
+    ++compressed;
+    if (!round_trip(packed, packed_len, rng() % (packed_len + 1), raw, raw_len)) {
+      ++failures;
+    }
+  }
+  CHECK_EQ(failures, 0);
+  printf("fuzz: %d of 20000 random payloads compressed\n", compressed);
+  CHECK(compressed > 100);
+}
+
+// Corrupt streams must be rejected or decode within the buffer, never overrun it.
+void test_garbage(std::mt19937& rng) {
+  for (int i = 0; i < 20000; ++i) {
+    uint8_t garbage[128];
+    for (uint8_t& byte : garbage) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    uint8_t decoded[link_codec::kMaxDecoded + 1];
+    decoded[link_codec::kMaxDecoded] = 0xEE;
+    Decoder decoder;
+    decoder.begin(decoded, link_codec::kMaxDecoded);
+    decoder.feed(garbage, rng() % sizeof(garbage));
+    CHECK(decoder.size() <= link_codec::kMaxDecoded);
+    CHECK(decoded[link_codec::kMaxDecoded] == 0xEE);
+  }
+}
+
+void bench() {
+  const auto* raw = reinterpret_cast<const uint8_t*>(kSamples[3]);
+  const size_t raw_len = strlen(kSamples[3]);
+  uint8_t packed[link_codec::kMaxDecoded];
+  constexpr int kRounds = 50000;
+  size_t packed_len = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    packed_len = link_codec::compress(raw, raw_len, packed, sizeof(packed), &s_workspace);
+  }
+  const double compress_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kRounds;
+  start = std::chrono::steady_clock::now();
+  uint8_t decoded[link_codec::kMaxDecoded];
+  for (int i = 0; i < kRounds; ++i) {
+    Decoder decoder;
+    decoder.begin(decoded, sizeof(decoded));
+    decoder.feed(packed, packed_len);
+  }
+  const double decode_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kRounds;
+  printf("bench: %zu byte payload, compress %.2f us, decode %.2f us\n", raw_len, compress_us, decode_us);
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  test_samples();
+  test_fuzz(rng);
+  test_garbage(rng);
+  bench();
+  return check_result("link_codec_test");
+}
@@ -0,0 +1,76 @@
+// LinkStats: a reader running against the RX writer and a TX writer only ever sees
+// consistent snapshots, and the sliding windows add up.
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "check.h"
+#include "link_stats.h"
+
+namespace {
+
+constexpr int64_t kStartUs = 1000000;
+constexpr int64_t kGapUs = 1000;
+
+LinkStats s_stats;
+
+void test_concurrent_snapshots() {
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> torn{0};
+  std::thread reader([&] {
+    uart_link_stats_t snapshot = {};
+    uint32_t last_frames = 0;
+    while (!stop.load()) {
+      s_stats.fill(&snapshot);
+      // The RX writer stamps frame n at kStartUs + (n - 1) * kGapUs, so the frame count and
+      // the last RX time in one snapshot must agree.
+      const bool rx_ok = snapshot.frames_rx == 0 ||
+                         (snapshot.last_rx_us - kStartUs) / kGapUs == static_cast<int64_t>(snapshot.frames_rx) - 1;
+      if (!rx_ok || snapshot.frames_rx < last_frames || snapshot.bytes_rx < snapshot.frames_rx * 30) {
+        torn.fetch_add(1);
+      }
+      last_frames = snapshot.frames_rx;
+    }
+  });
+  std::thread tx([] {
+    for (int i = 0; i < 100000; ++i) {
+      s_stats.tx_frame(20, 300 + i % 100, kStartUs + static_cast<int64_t>(i) * kGapUs);
+    }
+  });
+  int64_t now_us = kStartUs;
+  for (int i = 0; i < 200000; ++i) {
+    s_stats.rx_bytes(30);
+    s_stats.rx_frame(23, now_us);
+    now_us += kGapUs;
+    if (i % 1000 == 999) {
+      s_stats.tick(now_us);
+    }
+  }
+  tx.join();
+  stop.store(true);
+  reader.join();
+  CHECK_EQ(torn.load(), 0u);
+
+  uart_link_stats_t stats = {};
+  s_stats.fill(&stats);
+  CHECK_EQ(stats.frames_rx, 200000u);
+  CHECK_EQ(stats.frames_tx, 100000u);
+  CHECK_EQ(stats.bytes_tx, 2000000u);
+  // Kept in ms, reported in us.
+  CHECK_EQ(stats.last_tx_us, (kStartUs + 99999 * kGapUs) / 1000 * 1000);
+
+  uart_link_metrics_t metrics = {};
+  s_stats.fill_metrics(&metrics, now_us);
+  // One tick per 1000 frames at 1 ms apart: one second of ticks is 1000 frames.
+  CHECK_EQ(metrics.windows[0].frames_rx, 1000u);
+  CHECK_EQ(metrics.windows[1].frames_rx, 10000u);
+  CHECK_EQ(metrics.windows[2].frames_rx, 60000u);
+  CHECK_EQ(metrics.rx_interarrival_us.count, 199999u);
+}
+
+}  // namespace
+
+int main() {
+  test_concurrent_snapshots();
+  return check_result("link_stats_test");
+}
@@ -0,0 +1,180 @@
+// LinkSupervisor against a simulated peer: heartbeats suppressed by traffic, an idle link
+// kept alive, dead-peer detection and recovery, and the degraded hysteresis.
+#include <cstdio>
+
+#include "check.h"
+#include "link_supervisor.h"
+
+namespace {
+
+using PeerState = LinkSupervisor::PeerState;
+
+// A peer that answers every heartbeat after `rtt_ms` while it is up; the simulation
+// advances the clock to the supervisor's next poll or the next answer, whichever is first.
+struct Sim {
+  LinkSupervisor supervisor;
+  LinkSupervisor::Observation observation = {};
+  uint32_t now_ms;
+  bool peer_up = true;
+  uint32_t rtt_ms = 20;
+  uint32_t answer_at_ms = 0;  // 0 = nothing in flight
+  uint32_t heartbeats = 0;
+  uint32_t events = 0;
+  uint32_t dead_at_ms = 0;
+
+  explicit Sim(uint32_t start_ms) : now_ms(start_ms) {
+    supervisor.reset(start_ms);
+  }
+
+  void receive() {
+    observation.last_rx_ms = now_ms;
+    ++observation.frames_rx;
+  }
+
+  void transmit() {
+    observation.last_tx_ms = now_ms;
+  }
+
+  // Runs for `duration_ms`; `traffic_every_ms` > 0 adds frames both ways at that period.
+  void run(uint32_t duration_ms, uint32_t traffic_every_ms = 0) {
+    const uint32_t end_ms = now_ms + duration_ms;
+    uint32_t next_traffic_ms = now_ms;
+    while (static_cast<int32_t>(end_ms - now_ms) > 0) {
+      if (traffic_every_ms && now_ms == next_traffic_ms) {
+        transmit();
+        if (peer_up) {
+          receive();
+        }
+        next_traffic_ms += traffic_every_ms;
+      }
+      if (answer_at_ms && now_ms == answer_at_ms) {
+        answer_at_ms = 0;
+        if (peer_up) {
+          receive();
+        }
+      }
+      const LinkSupervisor::Decision decision = supervisor.poll(now_ms, observation);
+      events |= decision.events;
+      if ((decision.events & LinkSupervisor::kEventDead) && !dead_at_ms) {
+        dead_at_ms = now_ms;
+      }
+      if (decision.send_heartbeat) {
+        supervisor.heartbeat_sent(now_ms);
+        transmit();
+        ++heartbeats;
+        answer_at_ms = now_ms + rtt_ms;
+      }
+      uint32_t step = decision.next_poll_ms ? decision.next_poll_ms : 1;
+      if (answer_at_ms && answer_at_ms - now_ms < step) {
+        step = answer_at_ms - now_ms;
+      }
+      if (traffic_every_ms && next_traffic_ms - now_ms < step) {
+        step = next_traffic_ms - now_ms;
+      }
+      if (end_ms - now_ms < step) {
+        step = end_ms - now_ms;
+      }
+      now_ms += step;
+    }
+  }
+};
+
+// Frames every 100 ms both ways prove liveness; the fixed 2 s heartbeat is not needed.
+void test_traffic_suppresses_heartbeats(uint32_t start_ms) {
+  Sim sim(start_ms);
+  sim.run(60000, 100);
+  CHECK(sim.supervisor.peer_state() == PeerState::kAlive);
+  CHECK_EQ(sim.heartbeats, 0u);
+  CHECK(sim.supervisor.stats().heartbeats_suppressed >= 29);
+}
+
+// An idle link with a live peer sends one heartbeat per keepalive and never goes quiet.
+void test_idle_link_keepalive(uint32_t start_ms) {
+  Sim sim(start_ms);
+  sim.run(60000);
+  CHECK(sim.supervisor.peer_state() == PeerState::kAlive);
+  CHECK((sim.events & (LinkSupervisor::kEventQuiet | LinkSupervisor::kEventDead)) == 0);
+  const uint32_t keepalive_ms = sim.supervisor.config().keepalive_ms;
+  CHECK(sim.heartbeats >= 60000 / keepalive_ms - 1 && sim.heartbeats <= 60000 / keepalive_ms + 1);
+}
+
+// A peer that stops answering is QUIET after keepalive + one probe interval and DEAD after
+// the configured probes; it is reported once and ALIVE again on its next frame.
+void test_dead_peer(uint32_t start_ms) {
+  Sim sim(start_ms);
+  sim.run(10000, 100);
+  const LinkSupervisor::Config& config = sim.supervisor.config();
+  const uint32_t silent_from_ms = sim.observation.last_rx_ms;
+  sim.peer_up = false;
+  sim.events = 0;
+  sim.run(20000);
+  CHECK(sim.events & LinkSupervisor::kEventQuiet);
+  CHECK(sim.events & LinkSupervisor::kEventDead);
+  CHECK(sim.supervisor.peer_state() == PeerState::kDead);
+  CHECK_EQ(sim.supervisor.stats().dead_events, 1u);
+  const uint32_t detect_ms = sim.dead_at_ms - silent_from_ms;
+  const uint32_t bound_ms = config.keepalive_ms + (config.dead_after_probes + 1) * config.probe_interval_ms;
+  printf("dead peer detected after %u ms (bound %u ms)\n", detect_ms, bound_ms);
+  CHECK(detect_ms <= bound_ms);
+
+  sim.peer_up = true;
+  sim.events = 0;
+  sim.run(5000);
+  CHECK(sim.events & LinkSupervisor::kEventAlive);
+  CHECK(sim.supervisor.peer_state() == PeerState::kAlive);
+}
+
+// 1 CRC error in 3 frames degrades the link; it recovers only once the window is clean.
+void test_degraded_hysteresis(uint32_t start_ms) {
+  LinkSupervisor supervisor;
+  supervisor.reset(start_ms);
+  LinkSupervisor::Observation observation = {};
+  uint32_t now_ms = start_ms;
+  uint32_t degraded_events = 0;
+  uint32_t recovered_events = 0;
+  for (int i = 0; i < 400; ++i) {
+    now_ms += 100;
+    observation.last_rx_ms = now_ms;
+    observation.last_tx_ms = now_ms;
+    ++observation.frames_rx;
+    if (i < 200 && i % 3 == 0) {
+      ++observation.crc_errors;
+    }
+    const uint32_t events = supervisor.poll(now_ms, observation).events;
+    degraded_events += (events & LinkSupervisor::kEventDegraded) ? 1 : 0;
+    recovered_events += (events & LinkSupervisor::kEventRecovered) ? 1 : 0;
+    if (i == 199) {
+      CHECK(supervisor.degraded());
+    }
+  }
+  CHECK_EQ(degraded_events, 1u);
+  CHECK_EQ(recovered_events, 1u);
+  CHECK(!supervisor.degraded());
+
+  // Any loopback in a window is a wiring fault, however clean the rest of the traffic.
+  ++observation.loopback;
+  degraded_events = 0;
+  for (int i = 0; i < 110; ++i) {
+    now_ms += 100;
+    observation.last_rx_ms = now_ms;
+    ++observation.frames_rx;
+    degraded_events += (supervisor.poll(now_ms, observation).events & LinkSupervisor::kEventDegraded) ? 1 : 0;
+  }
+  CHECK_EQ(degraded_events, 1u);
+}
+
+void run_all(uint32_t start_ms) {
+  test_traffic_suppresses_heartbeats(start_ms);
+  test_idle_link_keepalive(start_ms);
+  test_dead_peer(start_ms);
+  test_degraded_hysteresis(start_ms);
+}
+
+}  // namespace
+
+int main() {
+  run_all(1000);
+  // The ms clock wraps after 49.7 days.
+  run_all(UINT32_MAX - 15000);
+  return check_result("link_supervisor_test");
+}
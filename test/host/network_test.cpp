@@ -0,0 +1,154 @@
+// ZigbeeNetwork against a mock stack: replies matched by transaction, ZCL errors, read
+// responses, malformed and refused requests, a full slot table, timeouts, late replies and
+// attribute reports, all checked as the ZB_RESPONSE / ATTR_UPDATE frames an H2 would send.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+#include "uart_link_protocol.h"
+#include "zigbee_network.h"
+
+namespace {
+
+struct MockStack : ZigbeeStack {
+  int next = 0;
+  bool refuse = false;
+  std::vector<zb_cmd_target_t> targets;
+
+  int issue(const zb_cmd_target_t& target) {
+    targets.push_back(target);
+    return refuse ? -1 : next++ & 0xFF;
+  }
+  int on_off(const zb_cmd_target_t& target, uint8_t) override {
+    return issue(target);
+  }
+  int level(const zb_cmd_target_t& target, uint8_t, uint16_t) override {
+    return issue(target);
+  }
+  int color(const zb_cmd_target_t& target, uint16_t, uint16_t, uint16_t) override {
+    return issue(target);
+  }
+  int bind(const zb_cmd_bind_t&) override {
+    return issue({0, 0});
+  }
+  int read_attr(const zb_cmd_target_t& target, uint16_t, uint16_t) override {
+    return issue(target);
+  }
+};
+
+struct Frame {
+  uint8_t type;
+  std::vector<uint8_t> payload;
+
+  zb_rsp_header_t header() const {
+    zb_rsp_header_t out = {};
+    memcpy(&out, payload.data(), sizeof(out));
+    return out;
+  }
+};
+
+std::vector<Frame> g_frames;
+
+void sink(uint8_t type, const uint8_t* payload, uint16_t len, void*) {
+  g_frames.push_back({type, std::vector<uint8_t>(payload, payload + len)});
+}
+
+template <typename T>
+void request(ZigbeeNetwork& network, uint8_t command, uint16_t request_id, const T& body, uint32_t now_ms,
+             uint16_t extra = 0) {
+  uint8_t frame[sizeof(zb_cmd_header_t) + sizeof(zb_cmd_any_request_t) + 1] = {};
+  const zb_cmd_header_t header = {command, 0, request_id};
+  memcpy(frame, &header, sizeof(header));
+  memcpy(frame + sizeof(header), &body, sizeof(body));
+  network.request(frame, static_cast<uint16_t>(sizeof(header) + sizeof(body) + extra), now_ms);
+}
+
+void test_replies() {
+  g_frames.clear();
+  MockStack stack;
+  ZigbeeNetwork network(stack, sink, nullptr);
+
+  request(network, ZB_CMD_ON_OFF, 7, zb_cmd_on_off_t{{0x1234, 1}, ZB_ON_OFF_ON}, 0);
+  CHECK(g_frames.empty());
+  CHECK_EQ(network.pending(), 1u);
+  CHECK_EQ(stack.targets[0].short_addr, 0x1234);
+  network.on_status(0, 0);
+  CHECK_EQ(g_frames.size(), 1u);
+  CHECK_EQ(g_frames[0].type, UART_LINK_MSG_ZB_RESPONSE);
+  CHECK_EQ(g_frames[0].header().request_id, 7);
+  CHECK_EQ(g_frames[0].header().status, ZB_CMD_STATUS_OK);
+  CHECK_EQ(g_frames[0].payload.size(), sizeof(zb_rsp_header_t));
+  // A second reply for the same transaction is late, not a response.
+  network.on_status(0, 0);
+  CHECK_EQ(network.stats().late, 1u);
+  CHECK_EQ(g_frames.size(), 1u);
+
+  request(network, ZB_CMD_LEVEL, 8, zb_cmd_level_t{{1, 1}, 100, 0}, 10);
+  network.on_status(1, 0x86);
+  CHECK_EQ(g_frames[1].header().status, ZB_CMD_STATUS_ZCL_ERROR);
+  CHECK_EQ(g_frames[1].header().detail, 0x86);
+
+  request(network, ZB_CMD_READ_ATTR, 9, zb_cmd_read_attr_t{{2, 1}, 0x0402, 0}, 20);
+  const zb_rsp_read_attr_t attr = {0x0402, 0, 0x29, 2, {0x10, 0x09}};
+  network.on_read_attr(2, 0, attr);
+  CHECK_EQ(g_frames[2].header().status, ZB_CMD_STATUS_OK);
+  CHECK_EQ(g_frames[2].payload.size(), sizeof(zb_rsp_header_t) + sizeof(attr));
+  CHECK(memcmp(g_frames[2].payload.data() + sizeof(zb_rsp_header_t), &attr, sizeof(attr)) == 0);
+
+  const zb_attr_report_t report = {{0x42, 1}, attr};
+  network.on_report(report);
+  CHECK_EQ(g_frames.back().type, UART_LINK_MSG_ATTR_UPDATE);
+  CHECK_EQ(g_frames.back().payload.size(), sizeof(report));
+  CHECK_EQ(network.stats().reports, 1u);
+}
+
+void test_refusals() {
+  g_frames.clear();
+  MockStack stack;
+  ZigbeeNetwork network(stack, sink, nullptr);
+
+  request(network, ZB_CMD_ON_OFF, 10, zb_cmd_on_off_t{{1, 1}, ZB_ON_OFF_ON}, 0, 1);
+  CHECK_EQ(g_frames[0].header().status, ZB_CMD_STATUS_BAD_LENGTH);
+  // This network is always the coordinator.
+  request(network, ZB_CMD_SET_MODE, 11, zb_cmd_set_mode_t{0}, 0);
+  CHECK_EQ(g_frames[1].header().status, ZB_CMD_STATUS_UNKNOWN_COMMAND);
+  stack.refuse = true;
+  request(network, ZB_CMD_ON_OFF, 12, zb_cmd_on_off_t{{1, 1}, ZB_ON_OFF_ON}, 0);
+  CHECK_EQ(g_frames[2].header().status, ZB_CMD_STATUS_BUSY);
+  stack.refuse = false;
+  CHECK_EQ(network.pending(), 0u);
+
+  // Every slot taken: the next request is refused, and the rest time out together.
+  for (uint16_t i = 0; i < ZigbeeNetwork::kPending; ++i) {
+    request(network, ZB_CMD_COLOR, static_cast<uint16_t>(100 + i), zb_cmd_color_t{{1, 1}, 1, 2, 0}, 1000);
+  }
+  CHECK_EQ(network.pending(), ZigbeeNetwork::kPending);
+  request(network, ZB_CMD_COLOR, 200, zb_cmd_color_t{{1, 1}, 1, 2, 0}, 1000);
+  CHECK_EQ(g_frames.size(), 4u);
+  CHECK_EQ(g_frames[3].header().status, ZB_CMD_STATUS_BUSY);
+  network.tick(1000 + ZigbeeNetwork::kTimeoutMs - 1);
+  CHECK_EQ(g_frames.size(), 4u);
+  network.tick(1000 + ZigbeeNetwork::kTimeoutMs);
+  CHECK_EQ(g_frames.size(), 4 + ZigbeeNetwork::kPending);
+  CHECK_EQ(g_frames.back().header().status, ZB_CMD_STATUS_NO_ROUTE);
+  CHECK_EQ(network.pending(), 0u);
+  CHECK_EQ(network.stats().timeouts, static_cast<uint32_t>(ZigbeeNetwork::kPending));
+  // The device answering after the timeout changes nothing.
+  network.on_status(stack.next - 1, 0);
+  CHECK_EQ(network.stats().late, 1u);
+  CHECK_EQ(g_frames.size(), 4 + ZigbeeNetwork::kPending);
+
+  const ZigbeeNetwork::Stats& stats = network.stats();
+  printf("%u requests: %u answered, %u refused, %u timed out\n", stats.requests, stats.answered, stats.refused,
+         stats.timeouts);
+  CHECK_EQ(stats.refused, 4u);
+}
+
+}  // namespace
+
+int main() {
+  test_replies();
+  test_refusals();
+  return check_result("network_test");
+}
@@ -0,0 +1,236 @@
+// OtaRelay against a simulated H2 on a 115200 baud wire: a 700 KB image with no loss,
+// with frame loss, across a link outage (resume), and the verify-failure and dead-H2 paths.
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "link_channels.h"
+#include "ota_relay.h"
+
+namespace {
+
+constexpr uint64_t kByteUs = 87;     // 115200 8N1
+// Preamble, type, seq, length and CRC16, plus the bulk channel's fragment header.
+constexpr uint32_t kFrameBytes = 7 + sizeof(channel_wire::FragmentHeader);
+constexpr uint64_t kH2TurnaroundUs = 300;
+
+uint32_t crc32(const uint8_t* data, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+struct Frame {
+  uint64_t at_us;
+  bool to_h2;
+  OtaRelay::Output out;
+  ota_wire::Ack ack;
+};
+
+struct Result {
+  OtaRelay::Phase phase;
+  uint8_t failure;
+  double seconds;
+  double bytes_per_s;
+  OtaRelay::Stats stats;
+};
+
+// One UART each way; the H2 writes in-order chunks, NAKs gaps and checks the CRC32 on END.
+class Sim {
+ public:
+  Sim(const std::vector<uint8_t>& image, uint32_t loss_permille, uint32_t seed)
+      : image_(image), h2_(image.size()), loss_permille_(loss_permille), rng_(seed) {}
+
+  bool corrupt_h2 = false;  // H2 flash returns a flipped byte on verify
+  bool h2_dead = false;     // H2 never answers
+  uint32_t outage_at = 0;   // acked offset at which the link drops once
+  uint64_t outage_us = 0;
+
+  Result run(const OtaRelay::Config& config) {
+    OtaRelay relay(config);
+    relay.start(static_cast<uint32_t>(image_.size()), crc32(image_.data(), image_.size()));
+    uint64_t now_us = 0;
+    uint64_t tx_free_us = 0;
+    uint64_t rx_free_us = 0;
+    uint64_t paused_us = 0;
+    bool outage_done = outage_at == 0;
+    while (relay.active() && now_us < 3600ull * 1000000) {
+      const uint32_t now_ms = static_cast<uint32_t>(now_us / 1000);
+      if (!outage_done && relay.acked() >= outage_at) {
+        // The link task pauses the relay; frames in flight are lost; the H2 keeps its data.
+        outage_done = true;
+        relay.pause();
+        wire_.clear();
+        now_us += outage_us;
+        paused_us += outage_us;
+        tx_free_us = rx_free_us = now_us;
+        continue;
+      }
+      OtaRelay::Output out;
+      if (tx_free_us <= now_us && relay.next(now_ms, &out)) {
+        const uint32_t bytes = kFrameBytes + (out.type == UART_LINK_MSG_OTA_CHUNK
+                                                  ? sizeof(ota_wire::ChunkHeader) + out.length
+                                                  : sizeof(ota_wire::Begin));
+        tx_free_us = now_us + bytes * kByteUs;
+        if (!lost()) {
+          wire_.push_back({tx_free_us, true, out, {}});
+        }
+        continue;
+      }
+      // Sleep until the wire frees, the relay's timer, or the next frame lands.
+      uint64_t wake_us = tx_free_us > now_us ? tx_free_us : now_us + relay.idle_ms(now_ms) * 1000ull;
+      if (wake_us == now_us) {
+        wake_us = now_us + 1000;
+      }
+      size_t first = wire_.size();
+      for (size_t i = 0; i < wire_.size(); ++i) {
+        if (first == wire_.size() || wire_[i].at_us < wire_[first].at_us) {
+          first = i;
+        }
+      }
+      if (first == wire_.size() || wire_[first].at_us > wake_us) {
+        now_us = wake_us;
+        continue;
+      }
+      const Frame frame = wire_[first];
+      wire_.erase(wire_.begin() + static_cast<long>(first));
+      if (frame.at_us > now_us) {
+        now_us = frame.at_us;
+      }
+      if (!frame.to_h2) {
+        relay.on_ack(frame.ack, static_cast<uint32_t>(now_us / 1000));
+      } else if (!h2_dead) {
+        const ota_wire::Ack ack = h2_receive(frame.out);
+        const uint64_t start_us = (rx_free_us > now_us ? rx_free_us : now_us) + kH2TurnaroundUs;
+        rx_free_us = start_us + (kFrameBytes + sizeof(ota_wire::Ack)) * kByteUs;
+        if (!lost()) {
+          wire_.push_back({rx_free_us, false, {}, ack});
+        }
+      }
+    }
+    Result result;
+    result.phase = relay.phase();
+    result.failure = relay.failure();
+    result.seconds = now_us / 1e6;
+    const double active_s = (now_us - paused_us) / 1e6;
+    result.bytes_per_s = active_s > 0 ? (relay.acked() - relay.stats().resumed_from) / active_s : 0;
+    result.stats = relay.stats();
+    return result;
+  }
+
+ private:
+  bool lost() {
+    return loss_permille_ && rng_() % 1000 < loss_permille_;
+  }
+
+  ota_wire::Ack h2_receive(const OtaRelay::Output& out) {
+    ota_wire::Ack ack = {out.type, ota_wire::kOk, have_};
+    if (out.type == UART_LINK_MSG_OTA_CHUNK) {
+      if (out.offset == have_) {
+        memcpy(&h2_[have_], &image_[out.offset], out.length);
+        have_ += out.length;
+      } else if (out.offset > have_) {
+        ack.status = ota_wire::kRetry;  // gap: a chunk before this one was lost
+      }
+      ack.offset = have_;
+    } else if (out.type == UART_LINK_MSG_OTA_END) {
+      std::vector<uint8_t> flash(h2_.begin(), h2_.begin() + have_);
+      if (corrupt_h2 && !flash.empty()) {
+        flash[flash.size() / 2] ^= 0x40;
+      }
+      const bool ok = have_ == image_.size() &&
+                      crc32(flash.data(), flash.size()) == crc32(image_.data(), image_.size());
+      ack.status = ok ? ota_wire::kOk : ota_wire::kVerifyFailed;
+    }
+    return ack;
+  }
+
+  const std::vector<uint8_t>& image_;
+  std::vector<uint8_t> h2_;
+  uint32_t have_ = 0;
+  uint32_t loss_permille_;
+  std::mt19937 rng_;
+  std::vector<Frame> wire_;
+};
+
+std::vector<uint8_t> make_image(size_t size) {
+  std::vector<uint8_t> image(size);
+  std::mt19937 rng(42);
+  for (uint8_t& byte : image) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  return image;
+}
+
+void report(const char* name, const Result& result) {
+  printf("%-12s %5.1f s  %6.0f B/s  chunks %u  retransmits %u  timeouts %u  naks %u  resumed at %u\n", name,
+         result.seconds, result.bytes_per_s, result.stats.chunks_sent, result.stats.retransmits,
+         result.stats.timeouts, result.stats.naks, result.stats.resumed_from);
+}
+
+void test_transfers(const OtaRelay::Config& config) {
+  const std::vector<uint8_t> image = make_image(700 * 1024);
+  const double wire_bytes_per_s = 1e6 / kByteUs;
+
+  Sim clean(image, 0, 1);
+  const Result ideal = clean.run(config);
+  report("no loss", ideal);
+  CHECK(ideal.phase == OtaRelay::Phase::kDone);
+  CHECK_EQ(ideal.stats.retransmits, 0u);
+  // Only the frame, fragment and chunk headers are overhead; the window must never stall the wire.
+  const double payload_share = static_cast<double>(config.chunk_size) /
+                               (config.chunk_size + sizeof(ota_wire::ChunkHeader) + kFrameBytes);
+  CHECK(ideal.bytes_per_s > 0.97 * payload_share * wire_bytes_per_s);
+
+  for (uint32_t loss : {5u, 30u}) {
+    Sim lossy(image, loss, loss);
+    const Result result = lossy.run(config);
+    char name[24];
+    snprintf(name, sizeof(name), "loss %u/1000", loss);
+    report(name, result);
+    CHECK(result.phase == OtaRelay::Phase::kDone);
+    CHECK(result.stats.retransmits > 0);
+  }
+
+  Sim outage(image, 0, 7);
+  outage.outage_at = static_cast<uint32_t>(image.size() * 3 / 10);
+  outage.outage_us = 2000000;
+  const Result resumed = outage.run(config);
+  report("2 s outage", resumed);
+  CHECK(resumed.phase == OtaRelay::Phase::kDone);
+  CHECK(resumed.stats.resumed_from >= outage.outage_at);
+}
+
+void test_failures(const OtaRelay::Config& config) {
+  const std::vector<uint8_t> image = make_image(64 * 1024);
+
+  Sim corrupt(image, 0, 3);
+  corrupt.corrupt_h2 = true;
+  const Result bad = corrupt.run(config);
+  CHECK(bad.phase == OtaRelay::Phase::kFailed);
+  CHECK_EQ(bad.failure, ota_wire::kVerifyFailed);
+
+  Sim dead(image, 0, 4);
+  dead.h2_dead = true;
+  const Result silent = dead.run(config);
+  CHECK(silent.phase == OtaRelay::Phase::kFailed);
+  CHECK_EQ(silent.failure, ota_wire::kTimeout);
+  CHECK_EQ(silent.stats.timeouts, static_cast<uint32_t>(config.max_retries) + 1);
+}
+
+}  // namespace
+
+int main() {
+  const OtaRelay::Config config;
+  printf("chunk %u bytes, window %u\n", config.chunk_size, config.window);
+  test_transfers(config);
+  test_failures(config);
+  return check_result("ota_relay_test");
+}
@@ -0,0 +1,225 @@
+// Pools and arenas: exhaustion and reuse, four threads freeing and allocating against each
+// other, PoolSet fallback, arena alignment and rewind, STL containers through the adapters,
+// then malloc against the pools for the scan-name churn bluetooth_manager now puts on them
+// and for the on-target bench patterns.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "debug/Pool.h"
+
+namespace {
+
+using namespace debug::pool;
+
+FixedPool<40, 64> s_blocks("test40");
+FixedPool<100, 16> s_small("test100");
+FixedPool<300, 8> s_large("test300");
+ArenaBuffer<1024> s_arena("test_response");
+
+void test_pool() {
+  std::set<void*> first;
+  for (int i = 0; i < 64; ++i) {
+    void* block = s_blocks.allocate();
+    CHECK(block && s_blocks.owns(block) && first.insert(block).second);
+    CHECK_EQ(reinterpret_cast<uintptr_t>(block) % alignof(std::max_align_t), 0u);
+  }
+  CHECK(s_blocks.allocate() == nullptr);
+  CHECK_EQ(s_blocks.stats().failures, 1u);
+  CHECK_EQ(s_blocks.stats().in_use, 64u);
+  for (void* block : first) {
+    s_blocks.deallocate(block);
+  }
+  CHECK_EQ(s_blocks.stats().in_use, 0u);
+  CHECK_EQ(s_blocks.stats().high_water, 64u);
+  std::set<void*> again;
+  for (int i = 0; i < 64; ++i) {
+    void* block = s_blocks.allocate();
+    CHECK(block && first.count(block) && again.insert(block).second);
+  }
+  for (void* block : again) {
+    s_blocks.deallocate(block);
+  }
+
+  // Each thread holds up to 16 blocks and checks nobody else wrote into them.
+  std::atomic<int> corrupted{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&corrupted, t] {
+      void* held[16] = {};
+      for (int i = 0; i < 500000; ++i) {
+        const int k = (i * 7 + t) % 16;
+        if (held[k]) {
+          corrupted += *static_cast<int*>(held[k]) != t * 1000 + k;
+          s_blocks.deallocate(held[k]);
+          held[k] = nullptr;
+        } else if ((held[k] = s_blocks.allocate())) {
+          *static_cast<int*>(held[k]) = t * 1000 + k;
+        }
+      }
+      for (void* block : held) {
+        s_blocks.deallocate(block);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  CHECK_EQ(corrupted.load(), 0);
+  CHECK_EQ(s_blocks.stats().in_use, 0u);
+  std::set<void*> all;
+  for (int i = 0; i < 64; ++i) {
+    CHECK(all.insert(s_blocks.allocate()).second);
+  }
+  CHECK(s_blocks.allocate() == nullptr);
+  for (void* block : all) {
+    s_blocks.deallocate(block);
+  }
+}
+
+void test_pool_set_and_arena() {
+  Pool* const classes[] = {&s_small, &s_large};
+  PoolSet<2> set(classes);
+  void* small = set.allocate(50);
+  void* large = set.allocate(200);
+  CHECK(s_small.owns(small));
+  CHECK(s_large.owns(large));
+  CHECK(set.allocate(400) == nullptr);
+  set.deallocate(small);
+  set.deallocate(large);
+  // A full class falls back to the next one up.
+  std::vector<void*> blocks;
+  for (int i = 0; i < 20; ++i) {
+    blocks.push_back(set.allocate(10));
+  }
+  CHECK(s_small.owns(blocks[0]));
+  CHECK(s_large.owns(blocks[19]));
+  for (void* block : blocks) {
+    set.deallocate(block);
+  }
+  set.deallocate(nullptr);
+
+  {
+    ArenaScope scope(s_arena);
+    char* text = static_cast<char*>(s_arena.allocate(3, 1));
+    double* values = s_arena.allocate_array<double>(4);
+    CHECK(text && values);
+    CHECK_EQ(reinterpret_cast<uintptr_t>(values) % alignof(double), 0u);
+    CHECK(s_arena.allocate(2000) == nullptr);
+  }
+  CHECK_EQ(s_arena.mark(), 0u);
+  CHECK_EQ(s_arena.stats().failures, 1u);
+  CHECK_EQ(s_arena.room_for<double>(), 128u);
+
+  {
+    std::list<int, PoolAllocator<int>> list{PoolAllocator<int>(s_blocks)};
+    for (int i = 0; i < 30; ++i) {
+      list.push_back(i);
+    }
+    CHECK_EQ(s_blocks.stats().in_use, 30u);
+  }
+  CHECK_EQ(s_blocks.stats().in_use, 0u);
+  {
+    using Pair = std::pair<const int, int>;
+    std::map<int, int, std::less<int>, PoolAllocator<Pair>> map{PoolAllocator<Pair>(s_blocks)};
+    for (int i = 0; i < 50; ++i) {
+      map[i] = i;
+    }
+    CHECK_EQ(map.size(), 50u);
+  }
+  {
+    ArenaScope scope(s_arena);
+    std::vector<int, ArenaAllocator<int>> values{ArenaAllocator<int>(s_arena)};
+    values.reserve(100);
+    for (int i = 0; i < 100; ++i) {
+      values.push_back(i);
+    }
+    CHECK(s_arena.mark() >= 400);
+  }
+  CHECK_EQ(s_arena.mark(), 0u);
+}
+
+// One BLE scan: 64 devices, most advertising a short name, a few long ones and some none,
+// each copied when first heard, then all released when the next scan starts. The size
+// classes are the ones bluetooth_manager uses.
+void test_scan_names() {
+  static FixedPool<16, 40> name_short("test_name16");
+  static FixedPool<48, 20> name_mid("test_name48");
+  static FixedPool<129, 6> name_long("test_name129");
+  Pool* const classes[] = {&name_short, &name_mid, &name_long};
+  PoolSet<3> names(classes);
+
+  static const char* const kNames[] = {"LYWSD03MMC", "Mi Band 7", "", "[TV] Samsung 7 Series (55)", "Tile",
+                                       "Bose QC35 II", "", "JBL Flip 5",
+                                       "Philips Hue ambiance E27 bulb, living room ceiling, left",
+                                       "ATC_1A2B3C", "", "iPhone"};
+  constexpr int kDevices = 64;
+  constexpr int kScans = 20000;
+  size_t lengths[kDevices];
+  for (int d = 0; d < kDevices; ++d) {
+    lengths[d] = strlen(kNames[(d * 5) % (sizeof(kNames) / sizeof(kNames[0]))]);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  char* held[kDevices];
+  int missed = 0;
+  const Clock::time_point t0 = Clock::now();
+  for (int scan = 0; scan < kScans; ++scan) {
+    for (int d = 0; d < kDevices; ++d) {
+      held[d] = lengths[d] ? static_cast<char*>(malloc(lengths[d] + 1)) : nullptr;
+    }
+    for (char* name : held) {
+      free(name);
+    }
+  }
+  const Clock::time_point t1 = Clock::now();
+  for (int scan = 0; scan < kScans; ++scan) {
+    for (int d = 0; d < kDevices; ++d) {
+      held[d] = lengths[d] ? static_cast<char*>(names.allocate(lengths[d] + 1)) : nullptr;
+      missed += lengths[d] && !held[d];
+    }
+    for (char* name : held) {
+      names.deallocate(name);
+    }
+  }
+  const Clock::time_point t2 = Clock::now();
+  const double per = 1e9 / (static_cast<double>(kScans) * kDevices);
+  printf("scan names, 64 devices: malloc %.1f ns, pool set %.1f ns per name; %d of %d names without a block\n",
+         std::chrono::duration<double>(t1 - t0).count() * per, std::chrono::duration<double>(t2 - t1).count() * per,
+         missed / kScans, kDevices);
+  printf("  name RAM: %zu B in classes, %zu B as 129-byte arrays\n",
+         sizeof(name_short) + sizeof(name_mid) + sizeof(name_long), static_cast<size_t>(kDevices) * 129);
+  CHECK_EQ(missed, 0);
+  CHECK_EQ(name_short.stats().in_use + name_mid.stats().in_use + name_long.stats().in_use, 0u);
+  CHECK(sizeof(name_short) + sizeof(name_mid) + sizeof(name_long) < static_cast<size_t>(kDevices) * 129 / 2);
+}
+
+void test_bench() {
+  debug_pool_bench_t result;
+  CHECK_EQ(debug_pool_benchmark(200000, &result), ESP_OK);
+  static const char* const kScenarios[DEBUG_POOL_BENCH_COUNT] = {"frame", "churn", "response"};
+  for (int i = 0; i < DEBUG_POOL_BENCH_COUNT; ++i) {
+    printf("%-9s malloc %4u  pool %4u ticks per allocate + free\n", kScenarios[i],
+           static_cast<unsigned>(result.malloc_cycles[i]), static_cast<unsigned>(result.pool_cycles[i]));
+  }
+  CHECK(result.pool_cycles[DEBUG_POOL_BENCH_RESPONSE] < result.malloc_cycles[DEBUG_POOL_BENCH_RESPONSE]);
+}
+
+}  // namespace
+
+int main() {
+  test_pool();
+  test_pool_set_and_arena();
+  test_scan_names();
+  test_bench();
+  debug_pool_dump();
+  return check_result("pool_test");
+}
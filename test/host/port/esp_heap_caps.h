@@ -0,0 +1,24 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#define MALLOC_CAP_INTERNAL (1<<11)
+#define MALLOC_CAP_SPIRAM (1<<10)
+#define MALLOC_CAP_8BIT (1<<2)
+#define MALLOC_CAP_DMA (1<<3)
+#define MALLOC_CAP_32BIT (1<<1)
+#define MALLOC_CAP_DEFAULT (1<<12)
+#define MALLOC_CAP_EXEC (1<<0)
+typedef struct { size_t total_free_bytes, total_allocated_bytes, largest_free_block, minimum_free_bytes, allocated_blocks, free_blocks, total_blocks; } multi_heap_info_t;
+#ifdef __cplusplus
+extern "C" {
+#endif
+void* heap_caps_malloc(size_t, uint32_t);
+void heap_caps_free(void*);
+size_t heap_caps_get_free_size(uint32_t);
+size_t heap_caps_get_total_size(uint32_t);
+size_t heap_caps_get_minimum_free_size(uint32_t);
+size_t heap_caps_get_largest_free_block(uint32_t);
+void heap_caps_get_info(multi_heap_info_t*, uint32_t);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+#include "FreeRTOS.h"
+typedef struct QueueDefinition* QueueHandle_t;
+#ifdef __cplusplus
+extern "C" {
+#endif
+QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t);
+QueueHandle_t xQueueCreateStatic(UBaseType_t, UBaseType_t, uint8_t*, StaticQueue_t*);
+BaseType_t xQueueSend(QueueHandle_t, const void*, TickType_t);
+BaseType_t xQueueSendToBack(QueueHandle_t, const void*, TickType_t);
+BaseType_t xQueueSendToFront(QueueHandle_t, const void*, TickType_t);
+BaseType_t xQueueReceive(QueueHandle_t, void*, TickType_t);
+BaseType_t xQueuePeek(QueueHandle_t, void*, TickType_t);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t);
+BaseType_t xQueueReset(QueueHandle_t);
+void vQueueDelete(QueueHandle_t);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,346 @@
+/*
+ * Host implementations of the ESP-IDF and FreeRTOS calls the modules under test make.
+ *
+ * Time is the host's monotonic clock; the "cycle counter" counts nanoseconds at a nominal
+ * 1000 MHz so cycle figures read as ns. Mutexes, binary semaphores, queues and event groups
+ * are real and thread-safe. Tasks are accepted but never scheduled: a test drives the code
+ * a task would run (a flush, a poll) itself, so every run is deterministic.
+ */
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point kBoot = Clock::now();
+
+int64_t elapsed_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - kBoot).count();
+}
+
+Clock::time_point deadline(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    return Clock::time_point::max();
+  }
+  return Clock::now() + std::chrono::milliseconds(pdTICKS_TO_MS(ticks));
+}
+
+vprintf_like_t s_log_vprintf = vprintf;
+
+}  // namespace
+
+// A mutex is a queue of one item the holder took, as in FreeRTOS; item_size 0 marks a semaphore.
+struct QueueDefinition {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length = 0;
+  UBaseType_t item_size = 0;
+};
+
+struct EventGroupDef_t {
+  std::mutex lock;
+  std::condition_variable changed;
+  EventBits_t bits = 0;
+};
+
+struct tskTaskControlBlock {
+  char name[configMAX_TASK_NAME_LEN];
+};
+
+extern "C" {
+
+const char* esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_FAIL:
+      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+      return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+      return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+      return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+      return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_CRC:
+      return "ESP_ERR_INVALID_CRC";
+    default:
+      return "ESP_ERR_UNKNOWN";
+  }
+}
+
+int64_t esp_timer_get_time(void) {
+  return elapsed_ns() / 1000;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+  return static_cast<esp_cpu_cycle_count_t>(elapsed_ns());
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void) {
+  return 1000;
+}
+
+void esp_rom_delay_us(uint32_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+  vprintf_like_t previous = s_log_vprintf;
+  s_log_vprintf = func;
+  return previous;
+}
+
+void esp_log_level_set(const char*, esp_log_level_t) {}
+
+uint32_t esp_log_timestamp(void) {
+  return static_cast<uint32_t>(elapsed_ns() / 1000000);
+}
+
+void esp_log_write(esp_log_level_t, const char*, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  s_log_vprintf(format, args);
+  va_end(args);
+}
+
+// No heap statistics on the host; the ledger's own numbers are what the tests check.
+void* heap_caps_malloc(size_t size, uint32_t) {
+  return malloc(size);
+}
+void heap_caps_free(void* ptr) {
+  free(ptr);
+}
+size_t heap_caps_get_free_size(uint32_t) {
+  return 0;
+}
+size_t heap_caps_get_total_size(uint32_t) {
+  return 0;
+}
+size_t heap_caps_get_minimum_free_size(uint32_t) {
+  return 0;
+}
+size_t heap_caps_get_largest_free_block(uint32_t) {
+  return 0;
+}
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t) {
+  memset(info, 0, sizeof(*info));
+}
+
+BaseType_t xPortGetCoreID(void) {
+  return 0;
+}
+BaseType_t xPortInIsrContext(void) {
+  return pdFALSE;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t, const char* name, uint32_t, void*, UBaseType_t, TaskHandle_t* out_handle) {
+  auto* task = new tskTaskControlBlock();
+  snprintf(task->name, sizeof(task->name), "%s", name);
+  if (out_handle) {
+    *out_handle = task;
+  }
+  return pdPASS;
+}
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* out_handle, BaseType_t) {
+  return xTaskCreate(fn, name, stack, arg, priority, out_handle);
+}
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t priority,
+                               StackType_t*, StaticTask_t*) {
+  TaskHandle_t handle = nullptr;
+  xTaskCreate(fn, name, stack, arg, priority, &handle);
+  return handle;
+}
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                           UBaseType_t priority, StackType_t* stack_buffer, StaticTask_t* tcb,
+                                           BaseType_t) {
+  return xTaskCreateStatic(fn, name, stack, arg, priority, stack_buffer, tcb);
+}
+void vTaskDelete(TaskHandle_t) {}
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+TickType_t xTaskGetTickCount(void) {
+  return pdMS_TO_TICKS(esp_log_timestamp());
+}
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  return nullptr;
+}
+char* pcTaskGetName(TaskHandle_t task) {
+  static char host[] = "host";
+  return task ? task->name : host;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  auto* queue = new QueueDefinition();
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t*, StaticQueue_t*) {
+  return xQueueCreate(length, item_size);
+}
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t wait) {
+  std::unique_lock<std::mutex> hold(queue->lock);
+  if (!queue->changed.wait_until(hold, deadline(wait), [queue] { return queue->items.size() < queue->length; })) {
+    return pdFAIL;
+  }
+  const auto* bytes = static_cast<const uint8_t*>(item);
+  queue->items.emplace_back(bytes, bytes + queue->item_size);
+  queue->changed.notify_all();
+  return pdPASS;
+}
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+  return xQueueSendToBack(queue, item, wait);
+}
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t wait) {
+  std::unique_lock<std::mutex> hold(queue->lock);
+  if (!queue->changed.wait_until(hold, deadline(wait), [queue] { return queue->items.size() < queue->length; })) {
+    return pdFAIL;
+  }
+  const auto* bytes = static_cast<const uint8_t*>(item);
+  queue->items.emplace_front(bytes, bytes + queue->item_size);
+  queue->changed.notify_all();
+  return pdPASS;
+}
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+  std::unique_lock<std::mutex> hold(queue->lock);
+  if (!queue->changed.wait_until(hold, deadline(wait), [queue] { return !queue->items.empty(); })) {
+    return pdFAIL;
+  }
+  if (queue->item_size) {
+    memcpy(item, queue->items.front().data(), queue->item_size);
+  }
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdPASS;
+}
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t wait) {
+  std::unique_lock<std::mutex> hold(queue->lock);
+  if (!queue->changed.wait_until(hold, deadline(wait), [queue] { return !queue->items.empty(); })) {
+    return pdFAIL;
+  }
+  memcpy(item, queue->items.front().data(), queue->item_size);
+  return pdPASS;
+}
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> hold(queue->lock);
+  return static_cast<UBaseType_t>(queue->items.size());
+}
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> hold(queue->lock);
+  return queue->length - static_cast<UBaseType_t>(queue->items.size());
+}
+BaseType_t xQueueReset(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> hold(queue->lock);
+  queue->items.clear();
+  queue->changed.notify_all();
+  return pdPASS;
+}
+void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+// A mutex starts with its one token available; a semaphore starts empty.
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  QueueHandle_t queue = xQueueCreate(1, 0);
+  queue->items.emplace_back();
+  return queue;
+}
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t*) {
+  return xSemaphoreCreateMutex();
+}
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  return xQueueCreate(1, 0);
+}
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t*) {
+  return xSemaphoreCreateBinary();
+}
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+  QueueHandle_t queue = xQueueCreate(max, 0);
+  for (UBaseType_t i = 0; i < initial; ++i) {
+    queue->items.emplace_back();
+  }
+  return queue;
+}
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t*) {
+  return xSemaphoreCreateCounting(max, initial);
+}
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait) {
+  return xQueueReceive(semaphore, nullptr, wait);
+}
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  return xQueueSendToBack(semaphore, nullptr, 0);
+}
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+  return uxQueueMessagesWaiting(semaphore);
+}
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  vQueueDelete(semaphore);
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+  return new EventGroupDef_t();
+}
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t*) {
+  return xEventGroupCreate();
+}
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> hold(group->lock);
+  group->bits |= bits;
+  group->changed.notify_all();
+  return group->bits;
+}
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> hold(group->lock);
+  const EventBits_t previous = group->bits;
+  group->bits &= ~bits;
+  return previous;
+}
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  std::lock_guard<std::mutex> hold(group->lock);
+  return group->bits;
+}
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all,
+                                TickType_t wait) {
+  std::unique_lock<std::mutex> hold(group->lock);
+  group->changed.wait_until(hold, deadline(wait), [group, bits, all] {
+    return all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+  });
+  const EventBits_t seen = group->bits;
+  if (clear) {
+    group->bits &= ~bits;
+  }
+  return seen;
+}
+
+}  // extern "C"
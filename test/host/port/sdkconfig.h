@@ -0,0 +1,7 @@
+#pragma once
+/*
+ * Host build configuration. Only what the modules under test read; everything else keeps
+ * the module's own #ifndef default, as a fresh menuconfig would.
+ */
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_ESP_CONSOLE_UART_BAUDRATE 115200
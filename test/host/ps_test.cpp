@@ -0,0 +1,185 @@
+// WifiPsPolicy: the idle steps NONE -> MIN -> MAX, pending commands and pins holding NONE,
+// forced modes, residency and switch accounting across a clock wrap, sleep_ms 0, the BT
+// floor, modes the driver refuses, and an hour of bursty traffic with the residency it gives.
+#include <cstdio>
+
+#include "check.h"
+#include "wifi_ps_policy.h"
+
+namespace {
+
+using Mode = WifiPsPolicy::Mode;
+
+WifiPsPolicy::Config config(uint32_t idle_ms, uint32_t sleep_ms, Mode floor = Mode::kNone) {
+  WifiPsPolicy::Config out;
+  out.idle_ms = idle_ms;
+  out.sleep_ms = sleep_ms;
+  out.floor = floor;
+  return out;
+}
+
+uint32_t total(const WifiPsPolicy::Stats& stats) {
+  return stats.residency_ms[0] + stats.residency_ms[1] + stats.residency_ms[2];
+}
+
+void test_steps() {
+  WifiPsPolicy policy(config(2000, 30000), 1000, Mode::kNone);
+  WifiPsPolicy::Decision decision = policy.poll(1000);
+  CHECK(decision.mode == Mode::kNone && !decision.changed);
+  CHECK_EQ(decision.next_poll_ms, 2000u);
+  decision = policy.poll(3000);
+  CHECK(decision.mode == Mode::kMin && decision.changed && decision.previous == Mode::kNone);
+  CHECK_EQ(decision.next_poll_ms, 28000u);
+  decision = policy.poll(31000);
+  CHECK(decision.mode == Mode::kMax && decision.changed);
+  CHECK_EQ(decision.next_poll_ms, 0u);
+
+  policy.activity(40000);
+  CHECK(policy.poll(40000).mode == Mode::kNone);
+  // A pending command holds NONE however long it takes; nothing to poll for meanwhile.
+  policy.command_begin(41000);
+  decision = policy.poll(50000);
+  CHECK(decision.mode == Mode::kNone);
+  CHECK_EQ(decision.next_poll_ms, 0u);
+  policy.command_end(50000);
+  CHECK(policy.poll(52000).mode == Mode::kMin);
+  policy.pin(true, 52000);
+  policy.pin(true, 52000);
+  CHECK(policy.poll(52000).mode == Mode::kNone);
+  policy.pin(false, 100000);
+  CHECK(policy.poll(200000).mode == Mode::kNone);
+  policy.pin(false, 200000);
+  CHECK(policy.poll(201999).mode == Mode::kNone);
+  CHECK(policy.poll(202000).mode == Mode::kMin);
+
+  policy.set_manual(Mode::kMax);
+  CHECK(policy.poll(202000).mode == Mode::kMax);
+  policy.activity(203000);
+  CHECK(policy.poll(203000).mode == Mode::kMax && policy.manual());
+  policy.clear_manual(204000);
+  CHECK(policy.poll(204000).mode == Mode::kNone && !policy.manual());
+
+  const WifiPsPolicy::Stats stats = policy.stats(205000);
+  CHECK_EQ(total(stats), 204000u);
+  CHECK_EQ(stats.switches, 8u);
+  CHECK_EQ(stats.residency_ms[static_cast<int>(Mode::kMax)], 9000u + 2000u);
+  policy.reset_stats(205000);
+  CHECK_EQ(total(policy.stats(206000)), 1000u);
+  CHECK_EQ(policy.stats(206000).switches, 0u);
+}
+
+void test_wrap_and_config() {
+  // The millisecond clock wraps after 49 days.
+  WifiPsPolicy wrapped(config(2000, 30000), 0xFFFFFF00u, Mode::kNone);
+  WifiPsPolicy::Decision decision = wrapped.poll(0x100);
+  CHECK(decision.mode == Mode::kNone);
+  CHECK_EQ(decision.next_poll_ms, 2000u - 0x200);
+  CHECK(wrapped.poll(0x100 + 2000).mode == Mode::kMin);
+  CHECK_EQ(total(wrapped.stats(0x100 + 2000)), 0x200u + 2000u);
+
+  WifiPsPolicy min_only(config(2000, 0), 0, Mode::kNone);
+  decision = min_only.poll(5000000);
+  CHECK(decision.mode == Mode::kMin);
+  CHECK_EQ(decision.next_poll_ms, 0u);
+
+  // Shorter idle times bring the next step forward; the caller must re-arm for it.
+  WifiPsPolicy policy(config(30000, 0), 0, Mode::kNone);
+  CHECK_EQ(policy.poll(1000).next_poll_ms, 29000u);
+  policy.set_config(config(2000, 0));
+  CHECK_EQ(policy.poll(1500).next_poll_ms, 500u);
+  CHECK(policy.poll(2000).mode == Mode::kMin);
+}
+
+void test_floor_and_rejected() {
+  // With BT enabled the driver refuses NONE: nothing, not even a forced mode, goes below MIN.
+  WifiPsPolicy policy(config(100, 0, Mode::kMin), 0, Mode::kMin);
+  policy.activity(10);
+  WifiPsPolicy::Decision decision = policy.poll(10);
+  CHECK(decision.mode == Mode::kMin && !decision.changed);
+  policy.set_manual(Mode::kNone);
+  CHECK(policy.poll(20).mode == Mode::kMin);
+  policy.set_manual(Mode::kMax);
+  CHECK(policy.poll(30).mode == Mode::kMax);
+  policy.clear_manual(40);
+  CHECK(policy.poll(40).mode == Mode::kMin);
+
+  // A refused mode: the previous one stays applied and is asked for again at the next poll.
+  WifiPsPolicy refused(config(100, 1000), 0, Mode::kMin);
+  decision = refused.poll(0);
+  CHECK(decision.mode == Mode::kNone && decision.changed && decision.previous == Mode::kMin);
+  refused.rejected(decision);
+  CHECK(refused.mode() == Mode::kMin);
+  decision = refused.poll(50);
+  CHECK(decision.mode == Mode::kNone && decision.changed);
+  WifiPsPolicy::Stats stats = refused.stats(50);
+  CHECK_EQ(stats.rejected, 1u);
+  CHECK_EQ(stats.switches, 1u);
+  CHECK_EQ(stats.residency_ms[static_cast<int>(Mode::kMin)], 50u);
+  CHECK_EQ(stats.residency_ms[static_cast<int>(Mode::kNone)], 0u);
+  // Handing back a decision that changed nothing is ignored.
+  refused.rejected(refused.poll(60));
+  CHECK_EQ(refused.stats(60).rejected, 1u);
+  CHECK(refused.mode() == Mode::kNone);
+}
+
+// One hour of a hub polled by a client: a burst of 5 requests, 200 ms apart, every 45 s on
+// average, plus a 20 s pinned session every 10 min. Time advances in 10 ms steps; polls happen
+// on input and at the deadline the policy asks for, as the firmware's timer does.
+void test_hour() {
+  WifiPsPolicy policy(config(2000, 30000), 0, Mode::kMin);
+  uint32_t due = 0;
+  uint32_t polls = 0;
+  uint32_t seed = 12345;
+  uint32_t next_burst = 0;
+  uint32_t burst_left = 0;
+  auto poll = [&](uint32_t now) {
+    const WifiPsPolicy::Decision decision = policy.poll(now);
+    due = decision.next_poll_ms ? now + decision.next_poll_ms : 0;
+    ++polls;
+  };
+  for (uint32_t now = 0; now < 3600000; now += 10) {
+    bool input = false;
+    if (now == next_burst) {
+      policy.activity(now);
+      input = true;
+      if (burst_left == 0) {
+        burst_left = 5;
+      }
+      if (--burst_left) {
+        next_burst = now + 200;
+      } else {
+        seed = seed * 1103515245 + 12345;
+        next_burst = now + 10000 + ((seed >> 8) % 70000) / 10 * 10;
+      }
+    }
+    if (now % 600000 == 300000) {
+      policy.pin(true, now);
+      input = true;
+    } else if (now % 600000 == 320000) {
+      policy.pin(false, now);
+      input = true;
+    }
+    if (input || (due && now >= due)) {
+      poll(now);
+    }
+  }
+  const WifiPsPolicy::Stats stats = policy.stats(3600000);
+  printf("an hour of bursts: none %.1f%%, min %.1f%%, max %.1f%%; %u switches in %u polls\n",
+         stats.residency_ms[0] / 36000.0, stats.residency_ms[1] / 36000.0, stats.residency_ms[2] / 36000.0,
+         stats.switches, polls);
+  CHECK_EQ(total(stats), 3600000u);
+  CHECK_EQ(stats.pins, 0u);
+  // Every burst (~2.8 s awake) and pinned session costs NONE time; the rest sleeps.
+  CHECK(stats.residency_ms[0] < 3600000u / 5);
+  CHECK(stats.residency_ms[2] > 3600000u / 4);
+}
+
+}  // namespace
+
+int main() {
+  test_steps();
+  test_wrap_and_config();
+  test_floor_and_rejected();
+  test_hour();
+  return check_result("ps_test");
+}
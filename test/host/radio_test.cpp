@@ -0,0 +1,116 @@
+// RadioPlan: the three priority presets, share overrides and their clamps, the power save
+// timing each plan hands to WifiPsPolicy, and airtime accounting across priority switches,
+// clock and counter wraps, many short samples and a reset.
+#include <cstdio>
+
+#include "check.h"
+#include "radio_plan.h"
+#include "wifi_ps_policy.h"
+
+namespace {
+
+using Priority = RadioPlan::Priority;
+
+void test_presets() {
+  const RadioPlan::Plan wifi = RadioPlan::make(Priority::kWifi, 0, 2000, 30000);
+  CHECK_EQ(wifi.scan_interval_ms, 320);
+  CHECK_EQ(wifi.scan_window_ms, 32);
+  CHECK(wifi.passive && wifi.coex == RadioPlan::Coex::kPreferWifi);
+  CHECK_EQ(wifi.ps_idle_ms, 5000u);
+  CHECK_EQ(wifi.ps_sleep_ms, 0u);
+
+  const RadioPlan::Plan balanced = RadioPlan::make(Priority::kBalanced, 0, 1234, 5678);
+  CHECK_EQ(balanced.scan_window_ms, 30);
+  CHECK(!balanced.passive && balanced.coex == RadioPlan::Coex::kBalance);
+  CHECK_EQ(balanced.ps_idle_ms, 1234u);
+  CHECK_EQ(balanced.ps_sleep_ms, 5678u);
+
+  const RadioPlan::Plan ble = RadioPlan::make(Priority::kBle, 0, 1234, 5678);
+  CHECK_EQ(ble.scan_window_ms, 90);
+  CHECK(ble.coex == RadioPlan::Coex::kPreferBt);
+  CHECK_EQ(ble.ps_idle_ms, 1000u);
+  CHECK_EQ(ble.ps_sleep_ms, 5000u);
+
+  // Overrides replace the share; 1% still scans for the controller's shortest window and
+  // anything past 100% is a window as long as the interval.
+  const RadioPlan::Plan half = RadioPlan::make(Priority::kBle, 50, 0, 0);
+  CHECK_EQ(half.ble_share_pct, 50);
+  CHECK_EQ(half.scan_window_ms, 50);
+  CHECK_EQ(RadioPlan::make(Priority::kBalanced, 1, 0, 0).scan_window_ms, 3);
+  const RadioPlan::Plan over = RadioPlan::make(Priority::kBalanced, 200, 0, 0);
+  CHECK_EQ(over.ble_share_pct, 100);
+  CHECK_EQ(over.scan_window_ms, 100);
+}
+
+// Each plan's timing drives the power save policy the way radio_scheduler hands it over.
+void test_power_save() {
+  WifiPsPolicy::Config config;
+  const RadioPlan::Plan wifi = RadioPlan::make(Priority::kWifi, 0, 2000, 30000);
+  config.idle_ms = wifi.ps_idle_ms;
+  config.sleep_ms = wifi.ps_sleep_ms;
+  WifiPsPolicy policy(config, 0, WifiPsPolicy::Mode::kNone);
+  CHECK(policy.poll(4999).mode == WifiPsPolicy::Mode::kNone);
+  CHECK(policy.poll(5000).mode == WifiPsPolicy::Mode::kMin);
+  CHECK(policy.poll(3600000).mode == WifiPsPolicy::Mode::kMin);
+
+  const RadioPlan::Plan ble = RadioPlan::make(Priority::kBle, 0, 2000, 30000);
+  config.idle_ms = ble.ps_idle_ms;
+  config.sleep_ms = ble.ps_sleep_ms;
+  config.floor = WifiPsPolicy::Mode::kMin;
+  policy.activity(3600000);
+  policy.set_config(config);
+  // The floor keeps BT builds out of NONE even while traffic is active.
+  CHECK(policy.poll(3600000).mode == WifiPsPolicy::Mode::kMin);
+  CHECK(policy.poll(3600000 + 5000).mode == WifiPsPolicy::Mode::kMax);
+}
+
+void test_accounting() {
+  const RadioPlan::Plan balanced = RadioPlan::make(Priority::kBalanced, 0, 0, 0);
+  const RadioPlan::Plan ble = RadioPlan::make(Priority::kBle, 0, 0, 0);
+  // The clock wraps in the first sample and the advert counter in the last.
+  const uint32_t t0 = 0xFFFFF000u;
+  RadioPlan plan(balanced, t0, {10, 100});
+  plan.sample(t0 + 1000, {60, 1100});
+  plan.select(ble, t0 + 3000, {100, 2100});
+  plan.sample(t0 + 5000, {0xFFFFFFF0u, 4100});
+  plan.sample(t0 + 6000, {0x10, 4100});
+
+  const RadioPlan::Totals totals_balanced = plan.totals(Priority::kBalanced);
+  CHECK_EQ(totals_balanced.active_ms, 3000u);
+  CHECK_EQ(totals_balanced.scan_ms, 2000u);
+  CHECK_EQ(totals_balanced.ble_air_ms, 600u);
+  CHECK_EQ(totals_balanced.adverts, 90u);
+  const RadioPlan::Totals totals_ble = plan.totals(Priority::kBle);
+  CHECK_EQ(totals_ble.active_ms, 3000u);
+  CHECK_EQ(totals_ble.scan_ms, 2000u);
+  CHECK_EQ(totals_ble.ble_air_ms, 1800u);
+  CHECK_EQ(totals_ble.adverts, 0xFFFFFFF0u - 100 + 0x20);
+  CHECK_EQ(plan.totals(Priority::kWifi).active_ms, 0u);
+
+  plan.reset(0, {0, 0});
+  CHECK_EQ(plan.totals(Priority::kBle).adverts, 0u);
+  CHECK_EQ(plan.totals(Priority::kBalanced).active_ms, 0u);
+
+  // A sample per millisecond at the wifi share: each is 0.1 ms of airtime, which must not
+  // round away.
+  const RadioPlan::Plan wifi = RadioPlan::make(Priority::kWifi, 0, 0, 0);
+  RadioPlan fine(wifi, 0, {0, 0});
+  for (uint32_t ms = 1; ms <= 60000; ++ms) {
+    fine.sample(ms, {ms / 10, ms});
+  }
+  const RadioPlan::Totals totals_wifi = fine.totals(Priority::kWifi);
+  printf("wifi priority, a minute of 1 ms samples: %u ms scanning, %u ms BLE airtime, %u adverts/s\n",
+         totals_wifi.scan_ms, totals_wifi.ble_air_ms, totals_wifi.adverts * 1000 / totals_wifi.scan_ms);
+  CHECK_EQ(totals_wifi.scan_ms, 60000u);
+  CHECK_EQ(totals_wifi.ble_air_ms, 6000u);
+  CHECK_EQ(totals_wifi.adverts, 6000u);
+}
+
+}  // namespace
+
+int main() {
+  test_presets();
+  test_power_save();
+  test_accounting();
+  return check_result("radio_test");
+}
@@ -0,0 +1,95 @@
+// DeviceRegistry: the same short address on two networks, bare-address resolution, pinning,
+// eviction of the least recently heard unpinned device, a table full of pinned devices, and
+// the cost of a lookup in a full table.
+#include <chrono>
+#include <cstdio>
+
+#include "check.h"
+#include "device_registry.h"
+
+namespace {
+
+void test_networks() {
+  static DeviceRegistry registry;
+  CHECK_EQ(registry.resolve(0x1234), DeviceRegistry::kUnknown);
+  CHECK(registry.note(0, 0x1234, 10));
+  CHECK(!registry.note(0, 0x1234, 20));
+  CHECK_EQ(registry.resolve(0x1234), 0);
+
+  // Another PAN assigned the same short address: a second device, not a move.
+  CHECK(registry.note(1, 0x1234, 30));
+  CHECK_EQ(registry.size(), 2u);
+  CHECK_EQ(registry.resolve(0x1234), DeviceRegistry::kAmbiguous);
+  CHECK(registry.note(0x0F, 0x1235, 40));
+  CHECK_EQ(registry.resolve(0x1235), 0x0F);
+  CHECK_EQ(registry.stats().resolved, 2u);
+  CHECK_EQ(registry.stats().unknown, 1u);
+  CHECK_EQ(registry.stats().ambiguous, 1u);
+
+  CHECK(registry.forget(0, 0x1234));
+  CHECK(!registry.forget(0, 0x1234));
+  CHECK_EQ(registry.resolve(0x1234), 1);
+
+  CHECK(registry.pin(1, 0x0001, 50));
+  CHECK(!registry.note(1, 0x0001, 60));
+  CHECK(registry.entry(0).pinned);
+  for (size_t i = 1; i < registry.size(); ++i) {
+    const DeviceRegistry::Entry& a = registry.entry(i - 1);
+    const DeviceRegistry::Entry& b = registry.entry(i);
+    CHECK(a.short_addr < b.short_addr || (a.short_addr == b.short_addr && a.network < b.network));
+  }
+}
+
+void test_eviction() {
+  static DeviceRegistry registry;
+  CHECK(registry.pin(1, 0x0001, 0));
+  for (uint32_t i = 0; i < 300; ++i) {
+    registry.note(static_cast<uint8_t>(i & 1), static_cast<uint16_t>(0x2000 + i), 100 + i);
+  }
+  CHECK_EQ(registry.size(), DeviceRegistry::kCapacity);
+  CHECK_EQ(registry.stats().evicted, 300u + 1 - DeviceRegistry::kCapacity);
+  // The pinned device was heard from least recently of all and still survives.
+  CHECK_EQ(registry.resolve(0x0001), 1);
+  CHECK_EQ(registry.resolve(0x2000), DeviceRegistry::kUnknown);
+  CHECK_EQ(registry.resolve(0x2000 + 299), 1);
+  // Hearing from a device again protects it from the next eviction.
+  const uint16_t oldest = static_cast<uint16_t>(0x2000 + 300 - (DeviceRegistry::kCapacity - 1));
+  registry.note(static_cast<uint8_t>((oldest - 0x2000) & 1), oldest, 1000);
+  registry.note(0, 0x3000, 1001);
+  CHECK(registry.resolve(oldest) != DeviceRegistry::kUnknown);
+  CHECK_EQ(registry.resolve(static_cast<uint16_t>(oldest + 1)), DeviceRegistry::kUnknown);
+
+  static DeviceRegistry pinned;
+  for (uint32_t i = 0; i < DeviceRegistry::kCapacity; ++i) {
+    CHECK(pinned.pin(0, static_cast<uint16_t>(i), i));
+  }
+  CHECK(!pinned.pin(0, 0x9999, 1));
+  CHECK(!pinned.note(0, 0x9999, 1));
+  CHECK_EQ(pinned.size(), DeviceRegistry::kCapacity);
+}
+
+void test_lookup_cost() {
+  static DeviceRegistry registry;
+  for (uint32_t i = 0; i < DeviceRegistry::kCapacity; ++i) {
+    registry.note(static_cast<uint8_t>(i & 1), static_cast<uint16_t>(i * 251), i);
+  }
+  constexpr int kRounds = 1000000;
+  volatile unsigned sink = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    sink = sink + registry.resolve(static_cast<uint16_t>((i % DeviceRegistry::kCapacity) * 251));
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  printf("resolve a short address in a full table of %zu on the host: %.1f ns\n", DeviceRegistry::kCapacity,
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / kRounds);
+  CHECK_EQ(registry.stats().resolved, static_cast<uint32_t>(kRounds));
+}
+
+}  // namespace
+
+int main() {
+  test_networks();
+  test_eviction();
+  test_lookup_cost();
+  return check_result("registry_test");
+}
@@ -0,0 +1,129 @@
+// RemoteLogReader and RateLimiter: records walked out of one H2_LOG payload, every truncation
+// of it and a record claiming more text than the frame holds, then the token bucket's burst,
+// smooth refill, rate changes, clock wrap and what a 10 s flood of H2 records gets through.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+#include "remote_log.h"
+
+namespace {
+
+void append_record(std::vector<uint8_t>* frame, uint32_t timestamp_ms, uint8_t level, const char* tag,
+                   const char* msg, uint8_t dropped) {
+  remote_log_wire::RecordHeader header = {timestamp_ms, level, static_cast<uint8_t>(strlen(tag)),
+                                          static_cast<uint8_t>(strlen(msg)), dropped};
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+  frame->insert(frame->end(), bytes, bytes + sizeof(header));
+  frame->insert(frame->end(), tag, tag + header.tag_len);
+  frame->insert(frame->end(), msg, msg + header.msg_len);
+}
+
+void test_reader() {
+  std::vector<uint8_t> frame;
+  append_record(&frame, 1000, 3, "ZB", "joined 0x1a2b", 0);
+  append_record(&frame, 1005, 2, "MAC", "", 4);
+  append_record(&frame, 1010, 1, "", "stack overflow in zb_task", 255);
+
+  RemoteLogReader reader(frame.data(), frame.size());
+  RemoteLogReader::Record record;
+  CHECK(reader.next(&record));
+  CHECK_EQ(record.timestamp_ms, 1000u);
+  CHECK_EQ(record.level, 3);
+  CHECK(record.tag_len == 2 && memcmp(record.tag, "ZB", 2) == 0);
+  CHECK(record.msg_len == 13 && memcmp(record.msg, "joined 0x1a2b", 13) == 0);
+  CHECK(reader.next(&record));
+  CHECK_EQ(record.msg_len, 0);
+  CHECK_EQ(record.dropped, 4);
+  CHECK(reader.next(&record));
+  CHECK_EQ(record.tag_len, 0);
+  CHECK_EQ(record.dropped, 255);
+  CHECK(!reader.next(&record));
+  CHECK(!reader.malformed());
+
+  // Every cut short of the full frame: the whole records before the cut come out, the one
+  // it splits is reported as malformed, and nothing past the cut is read.
+  const size_t ends[] = {sizeof(remote_log_wire::RecordHeader) + 15, sizeof(remote_log_wire::RecordHeader) * 2 + 18,
+                         frame.size()};
+  for (size_t len = 0; len < frame.size(); ++len) {
+    std::vector<uint8_t> cut(frame.begin(), frame.begin() + len);
+    RemoteLogReader partial(cut.data(), cut.size());
+    int whole = 0;
+    while (partial.next(&record)) {
+      CHECK(record.msg + record.msg_len <= reinterpret_cast<const char*>(cut.data() + cut.size()));
+      whole++;
+    }
+    const int expected = (len >= ends[0]) + (len >= ends[1]);
+    CHECK_EQ(whole, expected);
+    CHECK_EQ(partial.malformed(), len != 0 && len != ends[0] && len != ends[1]);
+  }
+
+  // A header whose lengths run past the frame.
+  std::vector<uint8_t> lying;
+  append_record(&lying, 1, 3, "ZB", "short", 0);
+  lying[sizeof(uint32_t) + 2] = 200;
+  RemoteLogReader bad(lying.data(), lying.size());
+  CHECK(!bad.next(&record));
+  CHECK(bad.malformed());
+  CHECK(!bad.next(&record));
+}
+
+void test_limiter() {
+  RateLimiter unlimited;
+  for (int i = 0; i < 10000; ++i) {
+    CHECK(unlimited.allow(0));
+  }
+
+  // A burst of one second's worth, then one token per 1000 / rate ms.
+  RateLimiter limiter(20);
+  int allowed = 0;
+  for (int i = 0; i < 100; ++i) {
+    allowed += limiter.allow(5000);
+  }
+  CHECK_EQ(allowed, 20);
+  CHECK(!limiter.allow(5049));
+  CHECK(limiter.allow(5050));
+  CHECK(!limiter.allow(5050));
+  // Idle time refills up to the burst, no further.
+  allowed = 0;
+  for (int i = 0; i < 100; ++i) {
+    allowed += limiter.allow(60000);
+  }
+  CHECK_EQ(allowed, 20);
+
+  // 3 per second refills a token every 333.3 ms without losing the fraction.
+  limiter.set_rate(3, 0);
+  allowed = 0;
+  for (uint32_t ms = 0; ms < 10000; ++ms) {
+    allowed += limiter.allow(ms);
+  }
+  CHECK_EQ(allowed, 3 + 30 - 1);
+
+  // Across the wrap of the millisecond clock.
+  limiter.set_rate(10, 0xFFFFFF00u);
+  for (int i = 0; i < 10; ++i) {
+    CHECK(limiter.allow(0xFFFFFF00u));
+  }
+  CHECK(!limiter.allow(0xFFFFFF00u));
+  CHECK(limiter.allow(0x100));
+
+  // An H2 in a fault loop logging 500 records/s for 10 s against the default limit.
+  limiter.set_rate(20, 0);
+  uint32_t passed = 0;
+  uint32_t offered = 0;
+  for (uint32_t ms = 0; ms < 10000; ms += 2) {
+    offered++;
+    passed += limiter.allow(ms);
+  }
+  printf("flood of %u records in 10 s at 20/s: %u passed, %u suppressed\n", offered, passed, offered - passed);
+  CHECK(passed >= 20 * 10 && passed <= 20 * 11);
+}
+
+}  // namespace
+
+int main() {
+  test_reader();
+  test_limiter();
+  return check_result("remote_log_test");
+}
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Check the application's static RAM against APP_STATIC_RAM_BUDGET_KB.
+
+Sums the .data/.sdata/.bss/.sbss input sections that the linker map places for each
+application component archive and fails when the total exceeds the budget from
+sdkconfig.json. Run through the build system as `idf.py ram_budget`, which builds the
+app first; CI runs it to catch RAM regressions.
+"""
+
+import argparse
+import json
+import re
+import sys
+from collections import defaultdict
+
+RAM_SECTION = re.compile(r"^ (\.s?(?:data|bss)(?:\.\S*)?|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+))?\s*$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)\s*$")
+ARCHIVE = re.compile(r"lib([\w-]+)\.a\(([^)]+)\)$")
+
+
+def ram_sections(map_path):
+    """Yields (component, object, size) for every placed RAM input section."""
+    with open(map_path, encoding="utf-8", errors="replace") as f:
+        in_map = False
+        pending = False
+        for line in f:
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+            if pending:
+                pending = False
+                match = CONTINUATION.match(line)
+                if match:
+                    yield from placed(*match.groups())
+                    continue
+            match = RAM_SECTION.match(line)
+            if not match:
+                continue
+            if match.group(2) is None:
+                pending = True  # long section name; address, size and file follow on the next line
+            else:
+                yield from placed(*match.group(2, 3, 4))
+
+
+def placed(address, size, source):
+    archive = ARCHIVE.search(source)
+    if archive and int(address, 16) and int(size, 16):
+        yield archive.group(1), archive.group(2), int(size, 16)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--map", required=True, help="linker map of the app")
+    parser.add_argument("--sdkconfig", required=True, help="build/config/sdkconfig.json")
+    parser.add_argument("--components", nargs="+", required=True, help="component archives to charge")
+    parser.add_argument("--objects", type=int, default=10, help="largest object files to list")
+    args = parser.parse_args()
+
+    with open(args.sdkconfig, encoding="utf-8") as f:
+        budget = json.load(f).get("APP_STATIC_RAM_BUDGET_KB", 160) * 1024
+
+    per_component = defaultdict(int)
+    per_object = defaultdict(int)
+    for component, obj, size in ram_sections(args.map):
+        if component in args.components:
+            per_component[component] += size
+            per_object[f"{component}/{obj}"] += size
+    total = sum(per_component.values())
+
+    print(f"{'COMPONENT':<16} {'BYTES':>8}")
+    for component in args.components:
+        print(f"{component:<16} {per_component[component]:>8}")
+    print(f"{'total':<16} {total:>8}")
+    if args.objects:
+        print("\nLargest objects:")
+        for obj, size in sorted(per_object.items(), key=lambda item: -item[1])[: args.objects]:
+            print(f"  {obj:<40} {size:>8}")
+    print(f"\nStatic RAM: {total} of {budget} bytes (APP_STATIC_RAM_BUDGET_KB)")
+    if total > budget:
+        print(f"error: over budget by {total - budget} bytes", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())